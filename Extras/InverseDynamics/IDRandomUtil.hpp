@@ -4,6 +4,8 @@
 namespace btInverseDynamics {
 /// seed random number generator
 void randomInit();
+/// seed random number generator with a fixed seed, for reproducible tests
+void randomInit(unsigned seed);
 /// Generate (not quite) uniformly distributed random integers in [low, high]
 /// Note: this is a low-quality implementation using only rand(), as
 /// C++11 <random> is not supported in bullet.
@@ -0,0 +1,89 @@
+#include "RandomTreeCreator.hpp"
+
+#include "IDRandomUtil.hpp"
+
+namespace btInverseDynamics {
+
+RandomTreeCreator::RandomTreeCreator(int num_bodies) : m_num_bodies(num_bodies) {
+    m_parent.resize(m_num_bodies);
+    m_joint_type.resize(m_num_bodies);
+    m_parent_r_parent_body_ref.resize(m_num_bodies);
+    m_body_T_parent_ref.resize(m_num_bodies);
+    m_body_axis_of_motion.resize(m_num_bodies);
+    m_mass.resize(m_num_bodies);
+    m_body_r_body_com.resize(m_num_bodies);
+    m_body_I_body.resize(m_num_bodies);
+
+    for (int i = 0; i < m_num_bodies; i++) {
+        m_parent[i] = i == 0 ? -1 : randomInt(0, i - 1);
+        m_joint_type[i] = FLOATING;
+        if (i > 0) {
+            switch (randomInt(0, 2)) {
+                case 0:
+                    m_joint_type[i] = REVOLUTE;
+                    break;
+                case 1:
+                    m_joint_type[i] = PRISMATIC;
+                    break;
+                default:
+                    m_joint_type[i] = FIXED;
+                    break;
+            }
+        }
+        for (int k = 0; k < 3; k++) {
+            m_parent_r_parent_body_ref[i](k) = randomFloat(-1.0, 1.0);
+            m_body_r_body_com[i](k) = randomFloat(-1.0, 1.0);
+        }
+        m_body_T_parent_ref[i] = transformX(randomFloat(-BT_ID_PI, BT_ID_PI)) *
+                                 transformY(randomFloat(-BT_ID_PI, BT_ID_PI)) *
+                                 transformZ(randomFloat(-BT_ID_PI, BT_ID_PI));
+        m_mass[i] = randomMass();
+        // shift a random inertia at the center of mass to the body origin
+        const mat33 tilde_r_com = tildeOperator(m_body_r_body_com[i]);
+        m_body_I_body[i] =
+            randomInertiaMatrix() + tilde_r_com.transpose() * tilde_r_com * m_mass[i];
+        m_body_axis_of_motion[i] = randomAxis();
+    }
+}
+
+RandomTreeCreator::~RandomTreeCreator() {}
+
+int RandomTreeCreator::getNumBodies(int* num_bodies) const {
+    *num_bodies = m_num_bodies;
+    return 0;
+}
+
+int RandomTreeCreator::getBody(int body_index, int* parent_index, JointType* joint_type,
+                               vec3* parent_r_parent_body_ref, mat33* body_T_parent_ref,
+                               vec3* body_axis_of_motion, idScalar* mass, vec3* body_r_body_com,
+                               mat33* body_I_body, int* user_int, void** user_ptr) const {
+    if (body_index < 0 || body_index >= m_num_bodies) {
+        error_message("invalid body index %d\n", body_index);
+        return -1;
+    }
+    *parent_index = m_parent[body_index];
+    *joint_type = m_joint_type[body_index];
+    *parent_r_parent_body_ref = m_parent_r_parent_body_ref[body_index];
+    *body_T_parent_ref = m_body_T_parent_ref[body_index];
+    *body_axis_of_motion = m_body_axis_of_motion[body_index];
+    *mass = m_mass[body_index];
+    *body_r_body_com = m_body_r_body_com[body_index];
+    *body_I_body = m_body_I_body[body_index];
+    *user_int = 0;
+    *user_ptr = 0;
+    return 0;
+}
+
+int addRandomUserForce(const int body_index, MultiBodyTree* tree) {
+    vec3 force;
+    vec3 moment;
+    for (int k = 0; k < 3; k++) {
+        force(k) = randomFloat(-1.0, 1.0);
+        moment(k) = randomFloat(-1.0, 1.0);
+    }
+    if (-1 == tree->addUserForce(body_index, force)) {
+        return -1;
+    }
+    return tree->addUserMoment(body_index, moment);
+}
+}
@@ -0,0 +1,45 @@
+#ifndef RANDOMTREECREATOR_HPP_
+#define RANDOMTREECREATOR_HPP_
+
+#include "MultiBodyTreeCreator.hpp"
+
+namespace btInverseDynamics {
+/// Creator class for a random tree with a floating base and all other joint types,
+/// drawn from the IDRandomUtil random number generator (seed it with randomInit
+/// for reproducible trees).
+/// The inertia w.r.t. the body origin is a random inertia at the center of mass shifted
+/// to the origin, so the mass properties are physically consistent.
+class RandomTreeCreator : public MultiBodyTreeCreator {
+public:
+    /// ctor
+    /// @param num_bodies number of bodies
+    RandomTreeCreator(int num_bodies);
+    /// dtor
+    ~RandomTreeCreator();
+    ///\copydoc MultiBodyTreeCreator::getNumBodies
+    int getNumBodies(int* num_bodies) const;
+    ///\copydoc MultiBodyTreeCreator::getBody
+    int getBody(int body_index, int* parent_index, JointType* joint_type,
+                vec3* parent_r_parent_body_ref, mat33* body_T_parent_ref, vec3* body_axis_of_motion,
+                idScalar* mass, vec3* body_r_body_com, mat33* body_I_body, int* user_int,
+                void** user_ptr) const;
+
+private:
+    int m_num_bodies;
+    idArray<int>::type m_parent;
+    idArray<JointType>::type m_joint_type;
+    idArray<vec3>::type m_parent_r_parent_body_ref;
+    idArray<mat33>::type m_body_T_parent_ref;
+    idArray<vec3>::type m_body_axis_of_motion;
+    idArray<idScalar>::type m_mass;
+    idArray<vec3>::type m_body_r_body_com;
+    idArray<mat33>::type m_body_I_body;
+};
+
+/// add a random user force and moment, with components in [-1, 1], to a body
+/// @param body_index index of the body
+/// @param tree the (finalized) tree
+/// @return 0 on success, -1 on error
+int addRandomUserForce(const int body_index, MultiBodyTree* tree);
+}
+#endif  // RANDOMTREECREATOR_HPP_
@@ -9,9 +9,7 @@
 #include "BulletDynamics/Featherstone/btMultiBodyPoint2Point.h"
 
 namespace btInverseDynamics {
-int compareInverseAndForwardDynamics(vecx &q, vecx &u, vecx &dot_u, btVector3 &gravity, bool verbose,
-                                     btMultiBody *btmb, MultiBodyTree *id_tree, double *pos_error,
-                                     double *acc_error) {
+
 // call function and return -1 if it does, printing an error_message
 #define RETURN_ON_FAILURE(x)                                                                       \
     do {                                                                                           \
@@ -21,26 +19,22 @@ int compareInverseAndForwardDynamics(vecx &q, vecx &u, vecx &dot_u, btVector3 &g
         }                                                                                          \
     } while (0)
 
-    if (verbose) {
-        printf("\n ===================================== \n");
-    }
-    vecx joint_forces(q.size());
-
-    // set positions and velocities for btMultiBody
+// set positions and velocities for btMultiBody.
+// The base state is taken from id_tree, so its kinematics must be up to date.
+static int setBulletState(vecx &q, vecx &u, bool verbose, btMultiBody *btmb,
+                          MultiBodyTree *id_tree, mat33 *world_T_base) {
     // base link
-    mat33 world_T_base;
     vec3 world_pos_base;
     btTransform base_transform;
     vec3 base_velocity;
     vec3 base_angular_velocity;
 
-    RETURN_ON_FAILURE(id_tree->setGravityInWorldFrame(gravity));
     RETURN_ON_FAILURE(id_tree->getBodyOrigin(0, &world_pos_base));
-    RETURN_ON_FAILURE(id_tree->getBodyTransform(0, &world_T_base));
+    RETURN_ON_FAILURE(id_tree->getBodyTransform(0, world_T_base));
     RETURN_ON_FAILURE(id_tree->getBodyAngularVelocity(0, &base_angular_velocity));
     RETURN_ON_FAILURE(id_tree->getBodyLinearVelocityCoM(0, &base_velocity));
 
-    base_transform.setBasis(world_T_base);
+    base_transform.setBasis(*world_T_base);
     base_transform.setOrigin(world_pos_base);
     btmb->setBaseWorldTransform(base_transform);
     btmb->setBaseOmega(base_angular_velocity);
@@ -78,20 +72,12 @@ int compareInverseAndForwardDynamics(vecx &q, vecx &u, vecx &dot_u, btVector3 &g
         error_message("error in number of dofs for btMultibody and MultiBodyTree\n");
         return -1;
     }
+    return 0;
+}
 
-    // run inverse dynamics to determine joint_forces for given q, u, dot_u
-    if (-1 == id_tree->calculateInverseDynamics(q, u, dot_u, &joint_forces)) {
-        error_message("calculating inverse dynamics\n");
-        return -1;
-    }
-
-    // set up bullet forward dynamics model
-    btScalar dt = 0;
-    btAlignedObjectArray<btScalar> scratch_r;
-    btAlignedObjectArray<btVector3> scratch_v;
-    btAlignedObjectArray<btMatrix3x3> scratch_m;
-    // this triggers switch between using either appliedConstraintForce or appliedForce
-    bool isConstraintPass = false;
+// apply gravity and generalized forces from MultiBodyTree to btMultiBody
+static int applyBulletForces(vecx &joint_forces, btVector3 &gravity, bool verbose,
+                             const mat33 &world_T_base, btMultiBody *btmb) {
     // apply gravity forces for btMultiBody model. Must be done manually.
     btmb->addBaseForce(btmb->getBaseMass() * gravity);
 
@@ -105,6 +91,7 @@ int compareInverseAndForwardDynamics(vecx &q, vecx &u, vecx &dot_u, btVector3 &g
     }
 
     // apply generalized forces
+    int q_index;
     if (btmb->hasFixedBase()) {
         q_index = 0;
     } else {
@@ -142,10 +129,23 @@ int compareInverseAndForwardDynamics(vecx &q, vecx &u, vecx &dot_u, btVector3 &g
     }
 
     // sanity check
-    if (q_index != q.size()) {
+    if (q_index != joint_forces.size()) {
         error_message("error in number of dofs for btMultibody and MultiBodyTree\n");
         return -1;
     }
+    return 0;
+}
+
+// run btMultiBody forward dynamics and compare the resulting generalized accelerations to dot_u
+static void calculateBulletAccelerationError(vecx &dot_u, bool verbose, const mat33 &world_T_base,
+                                             btMultiBody *btmb, double *acc_error) {
+    // set up bullet forward dynamics model
+    btScalar dt = 0;
+    btAlignedObjectArray<btScalar> scratch_r;
+    btAlignedObjectArray<btVector3> scratch_v;
+    btAlignedObjectArray<btMatrix3x3> scratch_m;
+    // this triggers switch between using either appliedConstraintForce or appliedForce
+    bool isConstraintPass = false;
 
     // run forward kinematics & forward dynamics
     btAlignedObjectArray<btQuaternion> world_to_local;
@@ -218,6 +218,29 @@ int compareInverseAndForwardDynamics(vecx &q, vecx &u, vecx &dot_u, btVector3 &g
     if (verbose) {
         printf("======dynamics-err: %e\n", *acc_error);
     }
+}
+
+int compareInverseAndForwardDynamics(vecx &q, vecx &u, vecx &dot_u, btVector3 &gravity, bool verbose,
+                                     btMultiBody *btmb, MultiBodyTree *id_tree, double *pos_error,
+                                     double *acc_error) {
+    if (verbose) {
+        printf("\n ===================================== \n");
+    }
+    vecx joint_forces(q.size());
+    mat33 world_T_base;
+
+    RETURN_ON_FAILURE(id_tree->setGravityInWorldFrame(gravity));
+    RETURN_ON_FAILURE(setBulletState(q, u, verbose, btmb, id_tree, &world_T_base));
+
+    // run inverse dynamics to determine joint_forces for given q, u, dot_u
+    if (-1 == id_tree->calculateInverseDynamics(q, u, dot_u, &joint_forces)) {
+        error_message("calculating inverse dynamics\n");
+        return -1;
+    }
+
+    RETURN_ON_FAILURE(applyBulletForces(joint_forces, gravity, verbose, world_T_base, btmb));
+    calculateBulletAccelerationError(dot_u, verbose, world_T_base, btmb, acc_error);
+
     *pos_error = 0.0;
 
     {
@@ -304,4 +327,123 @@ int compareInverseAndForwardDynamics(vecx &q, vecx &u, vecx &dot_u, btVector3 &g
 
     return 0;
 }
+
+int compareForwardDynamics(vecx &q, vecx &u, vecx &joint_forces, btVector3 &gravity, bool verbose,
+                           btMultiBody *btmb, MultiBodyTree *id_tree, double *acc_error) {
+    if (verbose) {
+        printf("\n ===================================== \n");
+    }
+    vecx dot_u(q.size());
+    mat33 world_T_base;
+
+    RETURN_ON_FAILURE(id_tree->setGravityInWorldFrame(gravity));
+    // this also updates the kinematics used to set the btMultiBody base state
+    if (-1 == id_tree->calculateForwardDynamics(q, u, joint_forces, &dot_u)) {
+        error_message("calculating forward dynamics\n");
+        return -1;
+    }
+
+    RETURN_ON_FAILURE(setBulletState(q, u, verbose, btmb, id_tree, &world_T_base));
+    RETURN_ON_FAILURE(applyBulletForces(joint_forces, gravity, verbose, world_T_base, btmb));
+    calculateBulletAccelerationError(dot_u, verbose, world_T_base, btmb, acc_error);
+
+    return 0;
+}
+
+int compareJacobians(vecx &q, vecx &u, bool verbose, btMultiBody *btmb, MultiBodyTree *id_tree,
+                     double *jac_error) {
+    if (verbose) {
+        printf("\n ===================================== \n");
+    }
+    mat33 world_T_base;
+
+    RETURN_ON_FAILURE(id_tree->calculateJacobians(q, u));
+    RETURN_ON_FAILURE(setBulletState(q, u, verbose, btmb, id_tree, &world_T_base));
+    btAlignedObjectArray<btQuaternion> world_to_local;
+    btAlignedObjectArray<btVector3> local_origin;
+    btmb->forwardKinematics(world_to_local, local_origin);
+
+    const int num_dofs = id_tree->numDoFs();
+    // btMultiBody jacobians always have 6 columns for the base
+    const int base_dofs = btmb->hasFixedBase() ? 0 : 6;
+    vec3 base_origin;
+    vec3 base_com;
+    RETURN_ON_FAILURE(id_tree->getBodyOrigin(0, &base_origin));
+    RETURN_ON_FAILURE(id_tree->getBodyCoM(0, &base_com));
+    const vec3 base_r_com = base_com - base_origin;
+
+    matxx jac_rot(3, num_dofs);
+    matxx jac_trans(3, num_dofs);
+    btAlignedObjectArray<btScalar> bt_jac;
+    bt_jac.resize(6 + btmb->getNumDofs());
+    btAlignedObjectArray<btScalar> scratch_r;
+    btAlignedObjectArray<btVector3> scratch_v;
+    btAlignedObjectArray<btMatrix3x3> scratch_m;
+    const btVector3 zero(0, 0, 0);
+
+    *jac_error = 0;
+    for (int body = 0; body < id_tree->numBodies(); body++) {
+        const int link = body - 1;
+        RETURN_ON_FAILURE(id_tree->getBodyJacobianRot(body, &jac_rot));
+        RETURN_ON_FAILURE(id_tree->getBodyJacobianTrans(body, &jac_trans));
+        vec3 origin;
+        vec3 com;
+        RETURN_ON_FAILURE(id_tree->getBodyOrigin(body, &origin));
+        RETURN_ON_FAILURE(id_tree->getBodyCoM(body, &com));
+        const vec3 r_com = com - origin;
+        // btMultiBody frames are located at the center of mass
+        const btVector3 bt_com = link < 0 ? btmb->getBasePos()
+                                          : btmb->getLink(link).m_cachedWorldTransform.getOrigin();
+
+        // rows 0..2: angular velocity, rows 3..5: linear velocity of the center of mass
+        for (int row = 0; row < 6; row++) {
+            btVector3 direction(0, 0, 0);
+            direction[row % 3] = 1;
+            btmb->fillConstraintJacobianMultiDof(link, bt_com, row < 3 ? direction : zero,
+                                                 row < 3 ? zero : direction, &bt_jac[0],
+                                                 scratch_r, scratch_v, scratch_m);
+            const btVector3 bt_jac_omega(bt_jac[0], bt_jac[1], bt_jac[2]);
+            const btVector3 bt_jac_vel(bt_jac[3], bt_jac[4], bt_jac[5]);
+            for (int col = 0; col < num_dofs; col++) {
+                vec3 id_jac_rot;
+                vec3 id_jac_trans;
+                for (int k = 0; k < 3; k++) {
+                    id_jac_rot(k) = jac_rot(k, col);
+                    id_jac_trans(k) = jac_trans(k, col);
+                }
+                const vec3 id_jac_com = id_jac_trans + id_jac_rot.cross(r_com);
+                const idScalar id_value = row < 3 ? id_jac_rot(row) : id_jac_com(row - 3);
+
+                // map the MultiBodyTree dof to btMultiBody's base and joint velocities
+                btScalar bt_value;
+                if (col >= base_dofs) {
+                    bt_value = bt_jac[6 + col - base_dofs];
+                } else {
+                    vec3 unit;
+                    setZero(unit);
+                    unit(col % 3) = 1;
+                    if (col < 3) {
+                        const vec3 omega = world_T_base * unit;
+                        bt_value = bt_jac_omega.dot(omega) + bt_jac_vel.dot(omega.cross(base_r_com));
+                    } else {
+                        bt_value = bt_jac_vel.dot(world_T_base * unit);
+                    }
+                }
+                if (verbose) {
+                    printf("body %d, row %d, col %d: bt= %e id= %e diff= %e\n", body, row, col,
+                           bt_value, id_value, bt_value - id_value);
+                }
+                const double error = std::fabs(bt_value - id_value);
+                if (error > *jac_error) {
+                    *jac_error = error;
+                }
+            }
+        }
+    }
+    if (verbose) {
+        printf("======jacobian-err: %e\n", *jac_error);
+    }
+
+    return 0;
+}
 }
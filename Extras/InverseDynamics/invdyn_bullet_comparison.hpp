@@ -30,5 +30,33 @@ class vecx;
 int compareInverseAndForwardDynamics(vecx &q, vecx &u, vecx &dot_u, btVector3 &gravity, bool verbose,
                                      btMultiBody *btmb, MultiBodyTree *id_tree, double *pos_error,
                                      double *acc_error);
+
+/// this function compares the forward dynamics computations implemented in btMultiBody to
+/// the forward dynamics implementation in MultiBodyTree (articulated body algorithm in both)
+/// @param q vector of generalized coordinates (matches id_tree)
+/// @param u vector of generalized speeds (matches id_tree)
+/// @param joint_forces vector of generalized forces (matches id_tree)
+/// @param gravity gravitational acceleration in world frame
+/// @param verbose print debug output if true
+/// @param btmb the bullet forward dynamics model
+/// @param id_tree the inverse dynamics model
+/// @param acc_error is set to the square root of the sum of squared differences of generalized
+///        accelerations
+/// @return -1 on error, 0 on success
+int compareForwardDynamics(vecx &q, vecx &u, vecx &joint_forces, btVector3 &gravity, bool verbose,
+                           btMultiBody *btmb, MultiBodyTree *id_tree, double *acc_error);
+
+/// this function compares the Jacobians of the angular velocity and the center of mass velocity
+/// of all bodies calculated by MultiBodyTree::calculateJacobians to those from
+/// btMultiBody::fillConstraintJacobianMultiDof
+/// @param q vector of generalized coordinates (matches id_tree)
+/// @param u vector of generalized speeds (matches id_tree)
+/// @param verbose print debug output if true
+/// @param btmb the bullet forward dynamics model
+/// @param id_tree the inverse dynamics model
+/// @param jac_error is set to the maximum absolute difference of all Jacobian elements
+/// @return -1 on error, 0 on success
+int compareJacobians(vecx &q, vecx &u, bool verbose, btMultiBody *btmb, MultiBodyTree *id_tree,
+                     double *jac_error);
 }
 #endif  // INVDYN_BULLET_COMPARISON_HPP
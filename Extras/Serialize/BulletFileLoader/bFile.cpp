@@ -118,6 +118,8 @@ bFile::~bFile()
 	}
 
 
+	clearConversionPlans();
+
 	delete mMemoryDNA;
 	delete mFileDNA;
 }
@@ -310,6 +312,8 @@ void bFile::parseInternal(int verboseMode, char* memDna,int memDnaLength)
 
 	
 	mFileDNA->initCmpFlags(mMemoryDNA);
+
+	clearConversionPlans();
 	
 	parseData();
 	
@@ -741,6 +745,19 @@ char* bFile::readStruct(char *head, bChunkInd&  dataChunk)
 				assert((strcmp(oldType, newType)==0) && "internal error, struct mismatch!");
 
 
+				const bConversionPlan* plan = getConversionPlan(dataChunk.dna_nr, reverseOld);
+				if (plan->m_identical && isDataInPlace(head))
+				{
+					// same layout, the pointers are resolved in the buffer itself
+					char *old = head;
+					for (int block=0; block<dataChunk.nr; block++)
+					{
+						mLibPointers.insert(old,(bStructHandle*)old);
+						old += oldLen;
+					}
+					return head;
+				}
+
 				numallocs++;
 				// numBlocks * length
 
@@ -751,12 +768,20 @@ char* bFile::readStruct(char *head, bChunkInd&  dataChunk)
 				// track allocated
 				addDataBlock(dataAlloc);
 
+				if (plan->m_identical)
+				{
+					memcpy(dataAlloc, head, dataChunk.nr*curLen);
+				}
+
 				char *cur = dataAlloc;
 				char *old = head;
 				for (int block=0; block<dataChunk.nr; block++)
 				{
-					bool fixupPointers = true;
-					parseStruct(cur, old, dataChunk.dna_nr, reverseOld, fixupPointers);
+					if (!plan->m_identical)
+					{
+						bool fixupPointers = true;
+						applyConversionPlan(*plan, cur, old, fixupPointers);
+					}
 					mLibPointers.insert(old,(bStructHandle*)cur);
 
 					cur += curLen;
@@ -781,6 +806,11 @@ char* bFile::readStruct(char *head, bChunkInd&  dataChunk)
 	}
 
 
+	if (isDataInPlace(head))
+	{
+		return head;
+	}
+
 	char *dataAlloc = new char[(dataChunk.len)+1];
 	memset(dataAlloc, 0, dataChunk.len+1);
 
@@ -800,18 +830,67 @@ void bFile::parseStruct(char *strcPtr, char *dtPtr, int old_dna, int new_dna, bo
 	if (old_dna == -1) return;
 	if (new_dna == -1) return;
 
-	//disable this, because we need to fixup pointers/ListBase
-	if (0)//mFileDNA->flagEqual(old_dna))
+	const bConversionPlan* plan = getConversionPlan(old_dna, new_dna);
+	applyConversionPlan(*plan, strcPtr, dtPtr, fixupPointers);
+}
+
+
+// ----------------------------------------------------- //
+const bConversionPlan* bFile::getConversionPlan(int old_dna, int new_dna)
+{
+	if (m_conversionPlans.size() != mFileDNA->getNumStructs())
 	{
-		short *strc = mFileDNA->getStruct(old_dna);
-		int len = mFileDNA->getLength(strc[0]);
+		clearConversionPlans();
+		m_conversionPlans.resize(mFileDNA->getNumStructs(), 0);
+	}
 
-		memcpy(strcPtr, dtPtr, len);
-		return;
+	bConversionPlan* plan = m_conversionPlans[old_dna];
+	if (plan)
+		return plan;
+
+	plan = new bConversionPlan();
+	btAlignedObjectArray<bConversionOp> ops;
+	compileConversionPlan(old_dna, new_dna, 0, 0, ops);
+
+	// merge copies of consecutive members into a single memcpy
+	for (int i=0; i<ops.size(); i++)
+	{
+		const bConversionOp& op = ops[i];
+		if (plan->m_ops.size() && op.m_opCode == BC_COPY)
+		{
+			bConversionOp& prev = plan->m_ops[plan->m_ops.size()-1];
+			if (prev.m_opCode == BC_COPY &&
+				prev.m_dstOffset+prev.m_size == op.m_dstOffset &&
+				prev.m_srcOffset+prev.m_size == op.m_srcOffset)
+			{
+				prev.m_size += op.m_size;
+				continue;
+			}
+		}
+		plan->m_ops.push_back(op);
 	}
 
-	// Ok, now build the struct
-	char *memType, *memName, *cpc, *cpo;
+	int oldLen = mFileDNA->getLength(mFileDNA->getStruct(old_dna)[0]);
+	int curLen = mMemoryDNA->getLength(mMemoryDNA->getStruct(new_dna)[0]);
+	plan->m_identical = oldLen == curLen &&
+		plan->m_ops.size() == 1 &&
+		plan->m_ops[0].m_opCode == BC_COPY &&
+		plan->m_ops[0].m_dstOffset == 0 &&
+		plan->m_ops[0].m_srcOffset == 0 &&
+		plan->m_ops[0].m_size == curLen;
+
+	m_conversionPlans[old_dna] = plan;
+	return plan;
+}
+
+
+// ----------------------------------------------------- //
+void bFile::compileConversionPlan(int old_dna, int new_dna, int dstOffset, int srcOffset, btAlignedObjectArray<bConversionOp>& ops)
+{
+	if (old_dna == -1) return;
+	if (new_dna == -1) return;
+
+	char *memType, *memName;
 	short *fileStruct, *filePtrOld, *memoryStruct, *firstStruct;
 	int elementLength, size, revType, old_nr, new_nr, fpLen;
 	short firstStructType;
@@ -830,7 +909,7 @@ void bFile::parseStruct(char *strcPtr, char *dtPtr, int old_dna, int new_dna, bo
 	elementLength = memoryStruct[1];
 	memoryStruct+=2;
 
-	cpc = strcPtr; cpo = 0;
+	int cpc = dstOffset;
 	for (int ele=0; ele<elementLength; ele++, memoryStruct+=2)
 	{
 		memType = mMemoryDNA->getType(memoryStruct[0]);
@@ -842,44 +921,162 @@ void bFile::parseStruct(char *strcPtr, char *dtPtr, int old_dna, int new_dna, bo
 
 		if (revType != -1 && memoryStruct[0]>=firstStructType && memName[0] != '*')
 		{
-			cpo = getFileElement(firstStruct, memName, memType, dtPtr, &filePtrOld);
-			if (cpo)
+			int cpo = getFileElement(firstStruct, memName, memType, &filePtrOld);
+			if (cpo>=0)
 			{
 				int arrayLen = mFileDNA->getArraySizeNew(filePtrOld[1]);
 				old_nr = mFileDNA->getReverseType(memType);
 				new_nr = revType;
 				fpLen = mFileDNA->getElementSize(filePtrOld[0], filePtrOld[1]);
-				if (arrayLen==1)
-				{
-					parseStruct(cpc, cpo, old_nr, new_nr,fixupPointers);
-				} else
+				for (int i=0;i<arrayLen;i++)
 				{
-					char* tmpCpc = cpc;
-					char* tmpCpo = cpo;
-
-					for (int i=0;i<arrayLen;i++)
-					{
-						parseStruct(tmpCpc, tmpCpo, old_nr, new_nr,fixupPointers);
-						tmpCpc += size/arrayLen;
-						tmpCpo += fpLen/arrayLen;
-					}
+					compileConversionPlan(old_nr, new_nr, cpc + i*(size/arrayLen), srcOffset + cpo + i*(fpLen/arrayLen), ops);
 				}
-				cpc+=size;
-				cpo+=fpLen;
 			}
-			else
-				cpc+=size;
 		}
 		else
 		{
-			getMatchingFileDNA(fileStruct, memName, memType, cpc, dtPtr,fixupPointers);
-			cpc+=size;
+			getMatchingFileDNA(fileStruct, memName, memType, cpc, srcOffset, ops);
+		}
+		cpc+=size;
+	}
+}
+
+
+// ----------------------------------------------------- //
+enum bElementType
+{
+	BE_UNKNOWN = -1,
+	BE_CHAR,
+	BE_SHORT,
+	BE_USHORT,
+	BE_INT,
+	BE_FLOAT,
+	BE_DOUBLE
+};
+
+static short getElementType(const char* type)
+{
+	if (strcmp(type, "char")==0)
+		return BE_CHAR;
+	if (strcmp(type, "short")==0)
+		return BE_SHORT;
+	if (strcmp(type, "ushort")==0)
+		return BE_USHORT;
+	if (strcmp(type, "int")==0 || strcmp(type, "long")==0)
+		return BE_INT;
+	if (strcmp(type, "float")==0)
+		return BE_FLOAT;
+	if (strcmp(type, "double")==0)
+		return BE_DOUBLE;
+	return BE_UNKNOWN;
+}
+
+static void convertElements(int arrayLen, short dstType, short srcType, const char *src, char *dst)
+{
+	for (int i=0; i<arrayLen; i++)
+	{
+		double value = 0.0;
+		switch (srcType)
+		{
+		case BE_CHAR:	value = *(const char*)src;				src += sizeof(char);			break;
+		case BE_SHORT:	value = *(const short*)src;				src += sizeof(short);			break;
+		case BE_USHORT:	value = *(const unsigned short*)src;	src += sizeof(unsigned short);	break;
+		case BE_INT:	value = *(const int*)src;				src += sizeof(int);				break;
+		case BE_FLOAT:	value = *(const float*)src;				src += sizeof(float);			break;
+		case BE_DOUBLE:	value = *(const double*)src;			src += sizeof(double);			break;
+		default: break;
+		}
+		switch (dstType)
+		{
+		case BE_CHAR:	*(char*)dst = (char)value;						dst += sizeof(char);			break;
+		case BE_SHORT:	*(short*)dst = (short)value;					dst += sizeof(short);			break;
+		case BE_USHORT:	*(unsigned short*)dst = (unsigned short)value;	dst += sizeof(unsigned short);	break;
+		case BE_INT:	*(int*)dst = (int)value;						dst += sizeof(int);				break;
+		case BE_FLOAT:	*(float*)dst = (float)value;					dst += sizeof(float);			break;
+		case BE_DOUBLE:	*(double*)dst = value;							dst += sizeof(double);			break;
+		default: break;
 		}
+	}
+}
+
+
+// ----------------------------------------------------- //
+void bFile::applyConversionPlan(const bConversionPlan& plan, char *strcPtr, char *dtPtr, bool fixupPointers)
+{
+	int ptrFile = mFileDNA->getPointerSize();
+	int ptrMem = mMemoryDNA->getPointerSize();
 
+	for (int i=0; i<plan.m_ops.size(); i++)
+	{
+		const bConversionOp& op = plan.m_ops[i];
+		char* strcData = strcPtr + op.m_dstOffset;
+		char* data = dtPtr + op.m_srcOffset;
+
+		switch (op.m_opCode)
+		{
+		case BC_COPY:
+			{
+				memcpy(strcData, data, op.m_size);
+				break;
+			}
+		case BC_CONVERT:
+			{
+				convertElements(op.m_arrayLen, op.m_dstType, op.m_srcType, data, strcData);
+				break;
+			}
+		case BC_POINTER:
+		case BC_POINTER_POINTER:
+			{
+				safeSwapPtr(strcData, data);
+				if (fixupPointers)
+				{
+					if (op.m_opCode == BC_POINTER_POINTER)
+						m_pointerPtrFixupArray.push_back(strcData);
+					else
+						m_pointerFixupArray.push_back(strcData);
+				}
+				break;
+			}
+		case BC_POINTER_ARRAY:
+			{
+				safeSwapPtr(strcData, data);
+				if (fixupPointers)
+				{
+					char *cpc = strcData;
+					char *cpo = data;
+					for (int a=0; a<op.m_arrayLen; a++)
+					{
+						safeSwapPtr(cpc, cpo);
+						m_pointerFixupArray.push_back(cpc);
+						cpc += ptrMem;
+						cpo += ptrFile;
+					}
+				}
+				break;
+			}
+		default:
+			{
+				btAssert(0);
+			}
+		}
 	}
 }
 
 
+// ----------------------------------------------------- //
+void bFile::clearConversionPlans()
+{
+	int i;
+	for (i=0; i<m_conversionPlans.size(); i++)
+		delete m_conversionPlans[i];
+	m_conversionPlans.clear();
+	for (i=0; i<m_pointerPlans.size(); i++)
+		delete m_pointerPlans[i];
+	m_pointerPlans.clear();
+}
+
+
 // ----------------------------------------------------- //
 static void getElement(int arrayLen, const char *cur, const char *old, char *oldPtr, char *curData)
 {
@@ -1011,11 +1208,11 @@ void bFile::safeSwapPtr(char *dst, const char *src)
 
 
 // ----------------------------------------------------- //
-void bFile::getMatchingFileDNA(short* dna_addr, const char* lookupName,  const char* lookupType, char *strcData, char *data, bool fixupPointers)
+void bFile::getMatchingFileDNA(short* dna_addr, const char* lookupName,  const char* lookupType, int dstOffset, int srcOffset, btAlignedObjectArray<bConversionOp>& ops)
 {
 	// find the matching memory dna data
-	// to the file being loaded. Fill the
-	// memory with the file data...
+	// to the file being loaded and add
+	// the operation to fill the memory with it
 
 	int len = dna_addr[1];
 	dna_addr+=2;
@@ -1039,71 +1236,55 @@ void bFile::getMatchingFileDNA(short* dna_addr, const char* lookupName,  const c
 
 		if (strcmp(lookupName, name)==0)
 		{
-			//int arrayLenold = mFileDNA->getArraySize((char*)name.c_str());
-			int arrayLen = mFileDNA->getArraySizeNew(dna_addr[1]);
-			//assert(arrayLenold == arrayLen);
-			
+			bConversionOp op;
+			op.m_dstOffset = dstOffset;
+			op.m_srcOffset = srcOffset;
+			op.m_size = eleLen;
+			op.m_arrayLen = mFileDNA->getArraySizeNew(dna_addr[1]);
+			op.m_dstType = BE_UNKNOWN;
+			op.m_srcType = BE_UNKNOWN;
+
 			if (name[0] == '*')
 			{
 				// cast pointers
-				int ptrFile = mFileDNA->getPointerSize();
-				int ptrMem = mMemoryDNA->getPointerSize();
-				safeSwapPtr(strcData,data);
-
-				if (fixupPointers)
-				{
-					if (arrayLen > 1)
-					{
-						//void **sarray = (void**)strcData;
-						//void **darray = (void**)data;
-				
-                        char *cpc, *cpo;
-						cpc = (char*)strcData;
-						cpo = (char*)data;
-						
-						for (int a=0; a<arrayLen; a++)
-						{
-							safeSwapPtr(cpc, cpo);
-							m_pointerFixupArray.push_back(cpc);
-							cpc += ptrMem;
-							cpo += ptrFile;
-						}
-					}
-					else
-					{
-						if (name[1] == '*')
-							m_pointerPtrFixupArray.push_back(strcData);
-						else
-							m_pointerFixupArray.push_back(strcData);
-					}
-				}
+				if (op.m_arrayLen > 1)
+					op.m_opCode = BC_POINTER_ARRAY;
+				else if (name[1] == '*')
+					op.m_opCode = BC_POINTER_POINTER;
 				else
-				{
-//					printf("skipped %s %s : %x\n",type.c_str(),name.c_str(),strcData);
-				}
-
+					op.m_opCode = BC_POINTER;
 			}
-
 			else if (strcmp(type, lookupType)==0)
-				memcpy(strcData, data, eleLen);
+			{
+				op.m_opCode = BC_COPY;
+			}
 			else
-				getElement(arrayLen, lookupType, type, data, strcData);
+			{
+				op.m_opCode = BC_CONVERT;
+				op.m_dstType = getElementType(lookupType);
+				op.m_srcType = getElementType(type);
+				//unknown types are left zero
+				if (op.m_dstType == BE_UNKNOWN || op.m_srcType == BE_UNKNOWN)
+					return;
+			}
+			ops.push_back(op);
 
 			// --
 			return;
 		}
-		data+=eleLen;
+		srcOffset+=eleLen;
 	}
 }
 
 
 // ----------------------------------------------------- //
-char* bFile::getFileElement(short *firstStruct, char *lookupName, char *lookupType, char *data, short **foundPos)
+int bFile::getFileElement(short *firstStruct, const char *lookupName, const char *lookupType, short **foundPos)
 {
 	short *old = firstStruct;//mFileDNA->getStruct(old_nr);
 	int elementLength = old[1];
 	old+=2;
 
+	int offset = 0;
 	for (int i=0; i<elementLength; i++, old+=2)
 	{
 		char* type = mFileDNA->getType(old[0]);
@@ -1116,13 +1297,13 @@ char* bFile::getFileElement(short *firstStruct, char *lookupName, char *lookupTy
 			{
 				if (foundPos)
 					*foundPos = old;
-				return data;
+				return offset;
 			}
-			return 0;
+			return -1;
 		}
-		data+=len;
+		offset+=len;
 	}
-	return 0;
+	return -1;
 }
 
 
@@ -1251,14 +1432,134 @@ void bFile::resolvePointersChunk(const bChunkInd& dataChunk, int verboseMode)
 	//char* structType = fileDna->getType(oldStruct[0]);
 
 	char* cur	= (char*)findLibPointer(dataChunk.oldPtr);
+	if (verboseMode & FD_VERBOSE_EXPORT_XML)
+	{
+		for (int block=0; block<dataChunk.nr; block++)
+		{
+			resolvePointersStructRecursive(cur,dataChunk.dna_nr, verboseMode,1);
+			cur += oldLen;
+		}
+		return;
+	}
+
+	const bConversionPlan* plan = getPointerPlan(dataChunk.dna_nr);
+	if (!plan->m_ops.size())
+		return;
 	for (int block=0; block<dataChunk.nr; block++)
 	{
-		resolvePointersStructRecursive(cur,dataChunk.dna_nr, verboseMode,1);
+		applyPointerPlan(*plan, cur);
 		cur += oldLen;
 	}
 }
 
 
+const bConversionPlan* bFile::getPointerPlan(int dna_nr)
+{
+	bParse::bDNA* fileDna = mFileDNA ? mFileDNA : mMemoryDNA;
+
+	if (m_pointerPlans.size() != fileDna->getNumStructs())
+	{
+		for (int i=0; i<m_pointerPlans.size(); i++)
+			delete m_pointerPlans[i];
+		m_pointerPlans.resize(fileDna->getNumStructs(), 0);
+	}
+
+	bConversionPlan* plan = m_pointerPlans[dna_nr];
+	if (!plan)
+	{
+		plan = new bConversionPlan();
+		compilePointerPlan(dna_nr, 0, plan->m_ops);
+		plan->m_identical = false;
+		m_pointerPlans[dna_nr] = plan;
+	}
+	return plan;
+}
+
+
+///collect the offsets of all pointers in a struct, same traversal as resolvePointersStructRecursive
+int bFile::compilePointerPlan(int dna_nr, int offset, btAlignedObjectArray<bConversionOp>& ops)
+{
+	bParse::bDNA* fileDna = mFileDNA ? mFileDNA : mMemoryDNA;
+
+	short	firstStructType = fileDna->getStruct(0)[0];
+	short int* oldStruct = fileDna->getStruct(dna_nr);
+
+	int elementLength = oldStruct[1];
+	oldStruct+=2;
+
+	int totalSize = 0;
+
+	for (int ele=0; ele<elementLength; ele++, oldStruct+=2)
+	{
+		char* memName = fileDna->getName(oldStruct[1]);
+		int arrayLen = fileDna->getArraySizeNew(oldStruct[1]);
+
+		if (memName[0] == '*')
+		{
+			bConversionOp op;
+			op.m_opCode = arrayLen > 1 ? BC_POINTER_ARRAY : (memName[1] == '*' ? BC_POINTER_POINTER : BC_POINTER);
+			op.m_dstOffset = offset+totalSize;
+			op.m_srcOffset = offset+totalSize;
+			op.m_size = 0;
+			op.m_arrayLen = arrayLen;
+			op.m_dstType = -1;
+			op.m_srcType = -1;
+			ops.push_back(op);
+		} else if (oldStruct[0]>=firstStructType)
+		{
+			int revType = fileDna->getReverseType(oldStruct[0]);
+			int byteOffset = 0;
+			for (int i=0;i<arrayLen;i++)
+			{
+				byteOffset += compilePointerPlan(revType, offset+totalSize+byteOffset, ops);
+			}
+		}
+
+		totalSize += fileDna->getElementSize(oldStruct[0], oldStruct[1]);
+	}
+
+	return totalSize;
+}
+
+
+void bFile::applyPointerPlan(const bConversionPlan& plan, char *strcPtr)
+{
+	for (int i=0; i<plan.m_ops.size(); i++)
+	{
+		const bConversionOp& op = plan.m_ops[i];
+		void** ptrptr = (void**)(strcPtr + op.m_dstOffset);
+
+		if (op.m_opCode == BC_POINTER_ARRAY)
+		{
+			for (int a=0; a<op.m_arrayLen; a++)
+			{
+				ptrptr[a] = findLibPointer(ptrptr[a]);
+			}
+			continue;
+		}
+
+		void* ptr = findLibPointer(*ptrptr);
+		if (ptr)
+		{
+			*(ptrptr) = ptr;
+			if (op.m_opCode == BC_POINTER_POINTER)
+			{
+				// This	will only work if the given	**array	is continuous
+				void **array= (void**)*(ptrptr);
+				void *np= array[0];
+				int	n=0;
+				while (np)
+				{
+					np= findLibPointer(array[n]);
+					if (np) array[n]= np;
+					n++;
+				}
+			}
+		}
+	}
+}
+
+
 int bFile::resolvePointersStructRecursive(char *strcPtr, int dna_nr, int verboseMode,int recursion)
 {
 	
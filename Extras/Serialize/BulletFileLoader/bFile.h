@@ -34,7 +34,8 @@ namespace bParse {
 		FD_VERSION_VARIES = 32,
 		FD_DOUBLE_PRECISION =64,
 		FD_BROKEN_DNA = 128,
-		FD_FILEDNA_IS_MEMDNA = 256
+		FD_FILEDNA_IS_MEMDNA = 256,
+		FD_DATA_IN_PLACE = 512
 	};
 
 	enum bFileVerboseMode
@@ -44,6 +45,37 @@ namespace bParse {
 		FD_VERBOSE_DUMP_CHUNKS = 4,
 		FD_VERBOSE_DUMP_FILE_INFO=8,
 	};
+	// ----------------------------------------------------- //
+	enum bConversionOpCode
+	{
+		BC_COPY = 0,
+		BC_CONVERT,
+		BC_POINTER,
+		BC_POINTER_POINTER,
+		BC_POINTER_ARRAY
+	};
+
+	///a single step of a precompiled struct conversion, offsets are relative to the start of the struct
+	struct bConversionOp
+	{
+		int		m_opCode;
+		int		m_dstOffset;
+		int		m_srcOffset;
+		int		m_size;
+		int		m_arrayLen;
+		short	m_dstType;
+		short	m_srcType;
+	};
+
+	///flat list of operations to convert a file DNA struct to a memory DNA struct (or to resolve its pointers),
+	///compiled once per struct so members are not matched by name for every element of every chunk
+	struct bConversionPlan
+	{
+		btAlignedObjectArray<bConversionOp>	m_ops;
+		///the file and memory layout are identical, the struct can be copied with a single memcpy
+		bool	m_identical;
+	};
+
 	// ----------------------------------------------------- //
 	class bFile
 	{
@@ -69,6 +101,11 @@ namespace bParse {
 		btAlignedObjectArray<bChunkInd>	m_chunks;
         btHashMap<btHashPtr, bChunkInd> m_chunkPtrPtrMap;
 
+		///conversion plans indexed by file DNA struct, compiled on first use
+		btAlignedObjectArray<bConversionPlan*>	m_conversionPlans;
+		///pointer fixup plans indexed by file DNA struct, compiled on first use
+		btAlignedObjectArray<bConversionPlan*>	m_pointerPlans;
+
         // 
 	
 		bPtrMap				mDataPointers;
@@ -93,8 +130,18 @@ namespace bParse {
 		//void swapPtr(char *dst, char *src);
 
 		void parseStruct(char *strcPtr, char *dtPtr, int old_dna, int new_dna, bool fixupPointers);
-		void getMatchingFileDNA(short* old, const char* lookupName, const char* lookupType, char *strcData, char *data, bool fixupPointers);
-		char* getFileElement(short *firstStruct, char *lookupName, char *lookupType, char *data, short **foundPos);
+		void getMatchingFileDNA(short* old, const char* lookupName, const char* lookupType, int dstOffset, int srcOffset, btAlignedObjectArray<bConversionOp>& ops);
+		int getFileElement(short *firstStruct, const char *lookupName, const char *lookupType, short **foundPos);
+
+		const bConversionPlan* getConversionPlan(int old_dna, int new_dna);
+		void compileConversionPlan(int old_dna, int new_dna, int dstOffset, int srcOffset, btAlignedObjectArray<bConversionOp>& ops);
+		void applyConversionPlan(const bConversionPlan& plan, char *strcPtr, char *dtPtr, bool fixupPointers);
+
+		const bConversionPlan* getPointerPlan(int dna_nr);
+		int compilePointerPlan(int dna_nr, int offset, btAlignedObjectArray<bConversionOp>& ops);
+		void applyPointerPlan(const bConversionPlan& plan, char *strcPtr);
+
+		void clearConversionPlans();
 
 
 		void swap(char *head, class bChunkInd& ch, bool ignoreEndianFlag);
@@ -134,6 +181,19 @@ namespace bParse {
 			mFlags |= FD_FILEDNA_IS_MEMDNA;
 		}
 
+		///structs that don't need conversion are used in place instead of being copied, if they are 16 byte aligned.
+		///The buffer has to be writable (pointers are resolved in place) and has to outlive the parsed data.
+		void setDataInPlace()
+		{
+			mFlags |= FD_DATA_IN_PLACE;
+		}
+
+		///unaligned chunk data is copied, the in place users expect the alignment of the memory structs
+		bool isDataInPlace(const char* head) const
+		{
+			return (mFlags & FD_DATA_IN_PLACE) && ((size_t)head & 15)==0;
+		}
+
 		bPtrMap&		getLibPointers()
 		{
 			return mLibPointers;
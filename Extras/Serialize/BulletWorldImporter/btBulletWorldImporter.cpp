@@ -22,6 +22,17 @@ subject to the following restrictions:
 #include "BulletCollision/Gimpact/btGImpactShape.h"
 #endif
 
+#if defined(WIN32) || defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 
 //#define USE_INTERNAL_EDGE_UTILITY
 #ifdef USE_INTERNAL_EDGE_UTILITY
@@ -77,6 +88,101 @@ bool	btBulletWorldImporter::loadFileFromMemory( char* memoryBuffer, int len)
 
 
 
+static char*	mapFile(const char* fileName, int* fileSize)
+{
+	char* data = 0;
+	*fileSize = 0;
+#if defined(WIN32) || defined(_WIN32)
+	HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return 0;
+	DWORD size = GetFileSize(file, 0);
+	if (size != INVALID_FILE_SIZE && size > 0)
+	{
+		//copy-on-write mapping, the parser resolves pointers in place
+		HANDLE mapping = CreateFileMappingA(file, 0, PAGE_WRITECOPY, 0, 0, 0);
+		if (mapping)
+		{
+			data = (char*)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+			CloseHandle(mapping);
+			if (data)
+				*fileSize = int(size);
+		}
+	}
+	CloseHandle(file);
+#else
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0)
+		return 0;
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0)
+	{
+		//copy-on-write mapping, the parser resolves pointers in place
+		void* ptr = mmap(0, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+		if (ptr != MAP_FAILED)
+		{
+			data = (char*)ptr;
+			*fileSize = int(st.st_size);
+		}
+	}
+	close(fd);
+#endif
+	return data;
+}
+
+static void	unmapFile(char* data, int fileSize)
+{
+#if defined(WIN32) || defined(_WIN32)
+	(void)fileSize;
+	UnmapViewOfFile(data);
+#else
+	munmap(data, fileSize);
+#endif
+}
+
+bool	btBulletWorldImporter::loadFileMapped(const char* fileName)
+{
+	int fileSize = 0;
+	char* data = mapFile(fileName, &fileSize);
+	if (!data)
+		return false;
+
+	m_mappedFiles.push_back(data);
+	m_mappedFileSizes.push_back(fileSize);
+
+	bParse::btBulletFile* bulletFile2 = new bParse::btBulletFile(data,fileSize);
+	bulletFile2->setDataInPlace();
+
+	bool result = loadFileFromMemory(bulletFile2);
+
+	delete bulletFile2;
+
+	return result;
+}
+
+bool	btBulletWorldImporter::isPersistentData(const void* ptr) const
+{
+	for (int i=0;i<m_mappedFiles.size();i++)
+	{
+		const char* data = m_mappedFiles[i];
+		if ((const char*)ptr >= data && (const char*)ptr < data + m_mappedFileSizes[i])
+			return true;
+	}
+	return false;
+}
+
+void	btBulletWorldImporter::deleteAllData()
+{
+	btWorldImporter::deleteAllData();
+
+	for (int i=0;i<m_mappedFiles.size();i++)
+	{
+		unmapFile(m_mappedFiles[i], m_mappedFileSizes[i]);
+	}
+	m_mappedFiles.clear();
+	m_mappedFileSizes.clear();
+}
+
 bool	btBulletWorldImporter::loadFileFromMemory(  bParse::btBulletFile* bulletFile2)
 {
 	bool ok = (bulletFile2->getFlags()& bParse::FD_OK)!=0;
@@ -110,11 +216,11 @@ bool	btBulletWorldImporter::convertAllObjects(  bParse::btBulletFile* bulletFile
 		if (bulletFile2->getFlags() & bParse::FD_DOUBLE_PRECISION)
 		{
 			btQuantizedBvhDoubleData* bvhData = (btQuantizedBvhDoubleData*)bulletFile2->m_bvhs[i];
-			bvh->deSerializeDouble(*bvhData);
+			convertBvhDouble(bvh,bvhData);
 		} else
 		{
 			btQuantizedBvhFloatData* bvhData = (btQuantizedBvhFloatData*)bulletFile2->m_bvhs[i];
-			bvh->deSerializeFloat(*bvhData);
+			convertBvhFloat(bvh,bvhData);
 		}
 		m_bvhMap.insert(bulletFile2->m_bvhs[i],bvh);
 	}
@@ -127,6 +233,11 @@ bool	btBulletWorldImporter::convertAllObjects(  bParse::btBulletFile* bulletFile
 	{
 		btCollisionShapeData* shapeData = (btCollisionShapeData*)bulletFile2->m_collisionShapes[i];
 		btCollisionShape* shape = convertCollisionShape(shapeData);
+		if (shape)
+		{
+			m_shapeMap.insert(shapeData,shape);
+		}
+
 		if (shape&& shapeData->m_name)
 		{
 			char* newname = duplicateName(shapeData->m_name);
@@ -39,7 +39,13 @@ namespace bParse
 ///See Bullet/Demos/SerializeDemo for a derived class that extract btSoftBody objects too.
 class btBulletWorldImporter : public btWorldImporter
 {
+protected:
 
+	///files mapped by loadFileMapped, released in deleteAllData
+	btAlignedObjectArray<char*>	m_mappedFiles;
+	btAlignedObjectArray<int>	m_mappedFileSizes;
+
+	virtual bool	isPersistentData(const void* ptr) const;
 
 public:
 	
@@ -56,6 +62,16 @@ public:
 
 	bool	loadFileFromMemory(bParse::btBulletFile* file);
 
+	///loadFileMapped maps the file into memory instead of reading it into a heap buffer.
+	///Structs that match the memory layout are used in place, and triangle arrays reference the mapping directly,
+	///so static geometry shares the page cache instead of being copied. Quantized bvh nodes are referenced too
+	///if they are 16 byte aligned in the file. Write the file with the BT_SERIALIZE_ALIGN_CHUNKS serialization flag
+	///to align all but the first chunk; unaligned structs, and files of another platform, are copied as usual.
+	///The mapping is private (copy-on-write) and stays alive until deleteAllData is called.
+	bool	loadFileMapped(const char* fileName);
+
+	virtual void	deleteAllData();
+
 	//call make sure bulletFile2 has been parsed, either using btBulletFile::parse or btBulletWorldImporter::loadFileFromMemory
 	virtual	bool	convertAllObjects(bParse::btBulletFile* file);
 
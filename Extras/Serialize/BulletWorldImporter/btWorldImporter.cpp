@@ -182,7 +182,8 @@ btCollisionShape* btWorldImporter::convertCollisionShape(  btCollisionShapeData*
 			btGImpactMeshShapeData* gimpactData = (btGImpactMeshShapeData*) shapeData;
 			if (gimpactData->m_gimpactSubType == CONST_GIMPACT_TRIMESH_SHAPE)
 			{
-				btStridingMeshInterfaceData* interfaceData = createStridingMeshInterfaceData(&gimpactData->m_meshInterface);
+				btStridingMeshInterfaceData* interfaceData = isPersistentData(gimpactData->m_meshInterface.m_meshPartsPtr) ?
+					&gimpactData->m_meshInterface : createStridingMeshInterfaceData(&gimpactData->m_meshInterface);
 				btTriangleIndexVertexArray* meshInterface = createMeshInterface(*interfaceData);
 				
 
@@ -404,7 +405,9 @@ btCollisionShape* btWorldImporter::convertCollisionShape(  btCollisionShapeData*
 		case TRIANGLE_MESH_SHAPE_PROXYTYPE:
 		{
 			btTriangleMeshShapeData* trimesh = (btTriangleMeshShapeData*)shapeData;
-			btStridingMeshInterfaceData* interfaceData = createStridingMeshInterfaceData(&trimesh->m_meshInterface);
+			//persistent mesh data doesn't need to be copied, it outlives the shape
+			btStridingMeshInterfaceData* interfaceData = isPersistentData(trimesh->m_meshInterface.m_meshPartsPtr) ?
+				&trimesh->m_meshInterface : createStridingMeshInterfaceData(&trimesh->m_meshInterface);
 			btTriangleIndexVertexArray* meshInterface = createMeshInterface(*interfaceData);
 			if (!meshInterface->getNumSubParts())
 			{
@@ -426,7 +429,7 @@ btCollisionShape* btWorldImporter::convertCollisionShape(  btCollisionShapeData*
 				} else
 				{
 					bvh = createOptimizedBvh();
-					bvh->deSerializeFloat(*trimesh->m_quantizedFloatBvh);
+					convertBvhFloat(bvh,trimesh->m_quantizedFloatBvh);
 				}
 			}
 			if (trimesh->m_quantizedDoubleBvh)
@@ -438,7 +441,7 @@ btCollisionShape* btWorldImporter::convertCollisionShape(  btCollisionShapeData*
 				} else
 				{
 					bvh = createOptimizedBvh();
-					bvh->deSerializeDouble(*trimesh->m_quantizedDoubleBvh);
+					convertBvhDouble(bvh,trimesh->m_quantizedDoubleBvh);
 				}
 			}
 #endif
@@ -1426,7 +1429,13 @@ btTriangleIndexVertexArray* btWorldImporter::createMeshInterface(btStridingMeshI
 		meshPart.m_numVertices = meshData.m_meshPartsPtr[i].m_numVertices;
 		
 
-		if (meshData.m_meshPartsPtr[i].m_indices32)
+		if (meshData.m_meshPartsPtr[i].m_indices32 && isPersistentData(meshData.m_meshPartsPtr[i].m_indices32))
+		{
+			//btIntIndexData has the same layout as int, reference it
+			meshPart.m_indexType = PHY_INTEGER;
+			meshPart.m_triangleIndexStride = 3*sizeof(btIntIndexData);
+			meshPart.m_triangleIndexBase = (const unsigned char*)meshData.m_meshPartsPtr[i].m_indices32;
+		} else if (meshData.m_meshPartsPtr[i].m_indices32)
 		{
 			meshPart.m_indexType = PHY_INTEGER;
 			meshPart.m_triangleIndexStride = 3*sizeof(int);
@@ -1439,7 +1448,12 @@ btTriangleIndexVertexArray* btWorldImporter::createMeshInterface(btStridingMeshI
 			meshPart.m_triangleIndexBase = (const unsigned char*)indexArray;
 		} else
 		{
-			if (meshData.m_meshPartsPtr[i].m_3indices16)
+			if (meshData.m_meshPartsPtr[i].m_3indices16 && isPersistentData(meshData.m_meshPartsPtr[i].m_3indices16))
+			{
+				meshPart.m_indexType = PHY_SHORT;
+				meshPart.m_triangleIndexStride = sizeof(btShortIntIndexTripletData);
+				meshPart.m_triangleIndexBase = (const unsigned char*)meshData.m_meshPartsPtr[i].m_3indices16;
+			} else if (meshData.m_meshPartsPtr[i].m_3indices16)
 			{
 				meshPart.m_indexType = PHY_SHORT;
 				meshPart.m_triangleIndexStride = sizeof(short int)*3;//sizeof(btShortIntIndexTripletData);
@@ -1470,7 +1484,14 @@ btTriangleIndexVertexArray* btWorldImporter::createMeshInterface(btStridingMeshI
 				meshPart.m_triangleIndexBase = (const unsigned char*)indexArray;
 			}
 
-			if (meshData.m_meshPartsPtr[i].m_3indices8)
+			///m_3indices8 was not initialized in some Bullet versions, only use it if none of the other indices are set
+			bool use3indices8 = !meshData.m_meshPartsPtr[i].m_3indices16 && !meshData.m_meshPartsPtr[i].m_indices16;
+			if (use3indices8 && meshData.m_meshPartsPtr[i].m_3indices8 && isPersistentData(meshData.m_meshPartsPtr[i].m_3indices8))
+			{
+				meshPart.m_indexType = PHY_UCHAR;
+				meshPart.m_triangleIndexStride = sizeof(btCharIndexTripletData);
+				meshPart.m_triangleIndexBase = (const unsigned char*)meshData.m_meshPartsPtr[i].m_3indices8;
+			} else if (use3indices8 && meshData.m_meshPartsPtr[i].m_3indices8)
 			{
 				meshPart.m_indexType = PHY_UCHAR;
 				meshPart.m_triangleIndexStride = sizeof(unsigned char)*3;
@@ -1489,7 +1510,12 @@ btTriangleIndexVertexArray* btWorldImporter::createMeshInterface(btStridingMeshI
 			}
 		}
 
-		if (meshData.m_meshPartsPtr[i].m_vertices3f)
+		if (meshData.m_meshPartsPtr[i].m_vertices3f && isPersistentData(meshData.m_meshPartsPtr[i].m_vertices3f))
+		{
+			meshPart.m_vertexType = PHY_FLOAT;
+			meshPart.m_vertexStride = sizeof(btVector3FloatData);
+			meshPart.m_vertexBase = (const unsigned char*)meshData.m_meshPartsPtr[i].m_vertices3f;
+		} else if (meshData.m_meshPartsPtr[i].m_vertices3f)
 		{
 			meshPart.m_vertexType = PHY_FLOAT;
 			meshPart.m_vertexStride = sizeof(btVector3FloatData);
@@ -1504,6 +1530,11 @@ btTriangleIndexVertexArray* btWorldImporter::createMeshInterface(btStridingMeshI
 				vertices[j].m_floats[3] = meshData.m_meshPartsPtr[i].m_vertices3f[j].m_floats[3];
 			}
 			meshPart.m_vertexBase = (const unsigned char*)vertices;
+		} else if (isPersistentData(meshData.m_meshPartsPtr[i].m_vertices3d))
+		{
+			meshPart.m_vertexType = PHY_DOUBLE;
+			meshPart.m_vertexStride = sizeof(btVector3DoubleData);
+			meshPart.m_vertexBase = (const unsigned char*)meshData.m_meshPartsPtr[i].m_vertices3d;
 		} else
 		{
 			meshPart.m_vertexType = PHY_DOUBLE;
@@ -1532,6 +1563,32 @@ btTriangleIndexVertexArray* btWorldImporter::createMeshInterface(btStridingMeshI
 	return meshInterface;
 }
 
+void btWorldImporter::convertBvhFloat(btOptimizedBvh* bvh, btQuantizedBvhFloatData* bvhData)
+{
+	//the quantized nodes can only be referenced if they are aligned like btQuantizedBvhNode,
+	//which is not the case in files written before the serializer aligned its chunks
+	const void* nodes = bvhData->m_quantizedContiguousNodesPtr;
+	if (nodes && isPersistentData(nodes) && ((size_t)nodes & 15)==0)
+	{
+		bvh->deSerializeFloatInPlace(*bvhData);
+	} else
+	{
+		bvh->deSerializeFloat(*bvhData);
+	}
+}
+
+void btWorldImporter::convertBvhDouble(btOptimizedBvh* bvh, btQuantizedBvhDoubleData* bvhData)
+{
+	const void* nodes = bvhData->m_quantizedContiguousNodesPtr;
+	if (nodes && isPersistentData(nodes) && ((size_t)nodes & 15)==0)
+	{
+		bvh->deSerializeDoubleInPlace(*bvhData);
+	} else
+	{
+		bvh->deSerializeDouble(*bvhData);
+	}
+}
+
 
 btStridingMeshInterfaceData* btWorldImporter::createStridingMeshInterfaceData(btStridingMeshInterfaceData* interfaceData)
 {
@@ -52,6 +52,8 @@ struct btTypedConstraintDoubleData;
 
 struct btRigidBodyDoubleData;
 struct btRigidBodyFloatData;
+struct btQuantizedBvhFloatData;
+struct btQuantizedBvhDoubleData;
 
 #ifdef BT_USE_DOUBLE_PRECISION
 #define btRigidBodyData btRigidBodyDoubleData
@@ -111,6 +113,17 @@ protected:
 	void	convertRigidBodyFloat(btRigidBodyFloatData* colObjData);
 	void	convertRigidBodyDouble( btRigidBodyDoubleData* colObjData);
 
+	void	convertBvhFloat(btOptimizedBvh* bvh, btQuantizedBvhFloatData* bvhData);
+	void	convertBvhDouble(btOptimizedBvh* bvh, btQuantizedBvhDoubleData* bvhData);
+
+	///returns true if the serialized data stays valid as long as the imported objects,
+	///so triangle arrays and bvh nodes can reference it instead of copying it
+	virtual bool	isPersistentData(const void* ptr) const
+	{
+		(void)ptr;
+		return false;
+	}
+
 public:
 	
 	btWorldImporter(btDynamicsWorld* world);
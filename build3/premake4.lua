@@ -227,6 +227,14 @@
 			include "../test/gtest-1.7.0"
 --			include "../test/hello_gtest"
 			include "../test/collision"
+			include "../test/CollisionWorld"
+			include "../test/BulletDynamics"
+			include "../test/BulletSoftBody"
+			include "../test/Determinism"
+			include "../test/ImportMeshUtility"
+			if not _OPTIONS["no-extras"] then
+				include "../test/Serialize"
+			end
 			if not _OPTIONS["no-bullet3"] then
 				if not _OPTIONS["no-extras"] then
 					include "../test/InverseDynamics"
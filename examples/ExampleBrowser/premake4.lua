@@ -66,6 +66,10 @@
 		"../SharedMemory/PhysicsDirect.h",
 		"../SharedMemory/PhysicsDirectC_API.cpp",
 		"../SharedMemory/PhysicsDirectC_API.h",
+		"../SharedMemory/PhysicsMultiEnvironment.cpp",
+		"../SharedMemory/PhysicsMultiEnvironment.h",
+		"../SharedMemory/PhysicsMultiEnvironmentC_API.cpp",
+		"../SharedMemory/PhysicsMultiEnvironmentC_API.h",
 		"../SharedMemory/PhysicsLoopBack.cpp",
 		"../SharedMemory/PhysicsLoopBack.h",
 		"../SharedMemory/PhysicsLoopBackC_API.cpp",
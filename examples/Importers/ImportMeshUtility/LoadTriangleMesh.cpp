@@ -0,0 +1,494 @@
+#include "LoadTriangleMesh.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(WIN32) || defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+void LoadedTriangleMesh::updateIndexedMesh()
+{
+	if (m_indexedMeshes.size()==0)
+	{
+		btIndexedMesh mesh;
+		m_indexedMeshes.push_back(mesh);
+	}
+	btIndexedMesh& mesh = m_indexedMeshes[0];
+	mesh.m_numTriangles = getNumTriangles();
+	mesh.m_triangleIndexBase = m_indices.size() ? (const unsigned char*)&m_indices[0] : 0;
+	mesh.m_triangleIndexStride = 3*sizeof(int);
+	mesh.m_indexType = PHY_INTEGER;
+	mesh.m_numVertices = getNumVertices();
+	mesh.m_vertexBase = m_vertices.size() ? (const unsigned char*)&m_vertices[0] : 0;
+	mesh.m_vertexStride = 3*sizeof(btScalar);
+	m_hasAabb = 0;
+}
+
+///read-only view of a whole file, mapped in memory
+struct MappedMeshFile
+{
+	const char* m_data;
+	size_t m_size;
+
+	MappedMeshFile(const char* fileName)
+		:m_data(0),
+		m_size(0)
+	{
+#if defined(WIN32) || defined(_WIN32)
+		HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+		if (file == INVALID_HANDLE_VALUE)
+			return;
+		LARGE_INTEGER size;
+		if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+		{
+			HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+			if (mapping)
+			{
+				m_data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+				CloseHandle(mapping);
+				if (m_data)
+					m_size = size_t(size.QuadPart);
+			}
+		}
+		CloseHandle(file);
+#else
+		int fd = open(fileName, O_RDONLY);
+		if (fd < 0)
+			return;
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0)
+		{
+			void* ptr = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (ptr != MAP_FAILED)
+			{
+				//the parsers read the file once, front to back
+				madvise(ptr, st.st_size, MADV_SEQUENTIAL);
+				m_data = (const char*)ptr;
+				m_size = size_t(st.st_size);
+			}
+		}
+		close(fd);
+#endif
+	}
+
+	~MappedMeshFile()
+	{
+		if (m_data)
+		{
+#if defined(WIN32) || defined(_WIN32)
+			UnmapViewOfFile(m_data);
+#else
+			munmap((void*)m_data, m_size);
+#endif
+		}
+	}
+};
+
+///stores each unique vertex once, using an open addressing hash table of vertex indices
+struct TriangleMeshVertexWelder
+{
+	btAlignedObjectArray<btScalar>& m_vertices;
+	btAlignedObjectArray<int> m_table;
+	int m_mask;
+
+	TriangleMeshVertexWelder(btAlignedObjectArray<btScalar>& vertices, int expectedNumVertices)
+		:m_vertices(vertices)
+	{
+		m_vertices.reserve(3*expectedNumVertices);
+		resizeTable(2*expectedNumVertices);
+	}
+
+	static unsigned int hashScalar(btScalar value)
+	{
+		//-0 and +0 have to end up in the same bucket
+		if (value == btScalar(0))
+			value = btScalar(0);
+		unsigned int words[sizeof(btScalar)/sizeof(unsigned int)];
+		memcpy(words, &value, sizeof(btScalar));
+		unsigned int hash = 0;
+		for (int i=0;i<int(sizeof(btScalar)/sizeof(unsigned int));i++)
+		{
+			hash ^= words[i];
+		}
+		return hash;
+	}
+
+	static unsigned int hashVertex(const btScalar* v)
+	{
+		unsigned int hash = hashScalar(v[0])*73856093u;
+		hash ^= hashScalar(v[1])*19349663u;
+		hash ^= hashScalar(v[2])*83492791u;
+		return hash ^ (hash>>16);
+	}
+
+	void resizeTable(int minSize)
+	{
+		int size = 1024;
+		while (size < minSize)
+			size *= 2;
+		m_table.resize(0);
+		m_table.resize(size, -1);
+		m_mask = size-1;
+		int numVertices = m_vertices.size()/3;
+		for (int v=0;v<numVertices;v++)
+		{
+			unsigned int slot = hashVertex(&m_vertices[v*3]) & m_mask;
+			while (m_table[slot] >= 0)
+				slot = (slot+1) & m_mask;
+			m_table[slot] = v;
+		}
+	}
+
+	int addVertex(const btScalar* v)
+	{
+		unsigned int slot = hashVertex(v) & m_mask;
+		for (;;)
+		{
+			int index = m_table[slot];
+			if (index < 0)
+				break;
+			const btScalar* w = &m_vertices[index*3];
+			if (w[0]==v[0] && w[1]==v[1] && w[2]==v[2])
+				return index;
+			slot = (slot+1) & m_mask;
+		}
+		int index = m_vertices.size()/3;
+		m_vertices.push_back(v[0]);
+		m_vertices.push_back(v[1]);
+		m_vertices.push_back(v[2]);
+		m_table[slot] = index;
+		//keep the table at most half full
+		if (2*(index+1) > m_table.size())
+		{
+			resizeTable(2*m_table.size());
+		}
+		return index;
+	}
+};
+
+static inline bool isMeshSpace(char c)
+{
+	return c==' ' || c=='\t' || c=='\r';
+}
+
+static inline bool isMeshDigit(char c)
+{
+	return c>='0' && c<='9';
+}
+
+static inline void skipMeshSpaces(const char*& p, const char* end)
+{
+	while (p<end && isMeshSpace(*p))
+		p++;
+}
+
+static inline void skipMeshLine(const char*& p, const char* end)
+{
+	while (p<end && *p!='\n')
+		p++;
+	if (p<end)
+		p++;
+}
+
+static bool parseMeshInt(const char*& p, const char* end, int& value)
+{
+	bool negative = false;
+	if (p<end && (*p=='-' || *p=='+'))
+	{
+		negative = (*p=='-');
+		p++;
+	}
+	if (p>=end || !isMeshDigit(*p))
+		return false;
+	int v = 0;
+	while (p<end && isMeshDigit(*p))
+	{
+		v = v*10 + (*p-'0');
+		p++;
+	}
+	value = negative ? -v : v;
+	return true;
+}
+
+///parses a decimal number with optional fraction and exponent, it is much faster than strtod/atof
+///and doesn't depend on the locale. The result is correctly rounded for up to 15 significant digits.
+static bool parseMeshScalar(const char*& p, const char* end, btScalar& value)
+{
+	static const double powersOf10[] =
+	{
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+	skipMeshSpaces(p,end);
+	bool negative = false;
+	if (p<end && (*p=='-' || *p=='+'))
+	{
+		negative = (*p=='-');
+		p++;
+	}
+	double mantissa = 0;
+	int exponent = 0;
+	int numDigits = 0;
+	while (p<end && isMeshDigit(*p))
+	{
+		mantissa = mantissa*10. + (*p-'0');
+		numDigits++;
+		p++;
+	}
+	if (p<end && *p=='.')
+	{
+		p++;
+		while (p<end && isMeshDigit(*p))
+		{
+			mantissa = mantissa*10. + (*p-'0');
+			exponent--;
+			numDigits++;
+			p++;
+		}
+	}
+	if (numDigits==0)
+		return false;
+	if (p<end && (*p=='e' || *p=='E'))
+	{
+		p++;
+		int e = 0;
+		if (!parseMeshInt(p,end,e))
+			return false;
+		exponent += e;
+	}
+	double result = mantissa;
+	if (exponent<0)
+	{
+		result = (exponent>=-22) ? result/powersOf10[-exponent] : result*pow(10.,exponent);
+	} else if (exponent>0)
+	{
+		result = (exponent<=22) ? result*powersOf10[exponent] : result*pow(10.,exponent);
+	}
+	value = btScalar(negative ? -result : result);
+	return true;
+}
+
+static inline bool matchMeshKeyword(const char* p, const char* end, const char* keyword, int length)
+{
+	return (end-p >= length) && (memcmp(p,keyword,length)==0) && ((end-p == length) || isMeshSpace(p[length]) || (p[length]=='\n'));
+}
+
+///drops the triangles that became degenerate by welding, and sets up the btIndexedMesh
+static LoadedTriangleMesh* finishTriangleMesh(LoadedTriangleMesh* mesh)
+{
+	int numTriangles = 0;
+	for (int t=0;t<mesh->getNumTriangles();t++)
+	{
+		int i0 = mesh->m_indices[t*3];
+		int i1 = mesh->m_indices[t*3+1];
+		int i2 = mesh->m_indices[t*3+2];
+		if (i0!=i1 && i1!=i2 && i2!=i0)
+		{
+			mesh->m_indices[numTriangles*3] = i0;
+			mesh->m_indices[numTriangles*3+1] = i1;
+			mesh->m_indices[numTriangles*3+2] = i2;
+			numTriangles++;
+		}
+	}
+	mesh->m_indices.resize(numTriangles*3);
+	if (numTriangles==0)
+	{
+		delete mesh;
+		return 0;
+	}
+	mesh->updateIndexedMesh();
+	return mesh;
+}
+
+LoadedTriangleMesh* LoadTriangleMeshFromObj(const char* fileName, const btVector3& scale)
+{
+	MappedMeshFile file(fileName);
+	if (!file.m_data)
+	{
+		printf("Cannot open OBJ file %s\n", fileName);
+		return 0;
+	}
+	const char* p = file.m_data;
+	const char* end = file.m_data + file.m_size;
+
+	//first pass over the file: positions and the position indices of the (triangulated) faces
+	btAlignedObjectArray<btScalar> positions;
+	btAlignedObjectArray<int> positionIndices;
+	btAlignedObjectArray<int> polygon;
+	int numPositions = 0;
+	while (p<end)
+	{
+		skipMeshSpaces(p,end);
+		if (matchMeshKeyword(p,end,"v",1))
+		{
+			p += 1;
+			btScalar xyz[3];
+			if (parseMeshScalar(p,end,xyz[0]) && parseMeshScalar(p,end,xyz[1]) && parseMeshScalar(p,end,xyz[2]))
+			{
+				positions.push_back(xyz[0]*scale[0]);
+				positions.push_back(xyz[1]*scale[1]);
+				positions.push_back(xyz[2]*scale[2]);
+			} else
+			{
+				//keep the numbering of the vertices intact
+				positions.push_back(0);
+				positions.push_back(0);
+				positions.push_back(0);
+				printf("Invalid vertex in OBJ file %s\n", fileName);
+			}
+			numPositions++;
+		} else if (matchMeshKeyword(p,end,"f",1))
+		{
+			p += 1;
+			polygon.resize(0);
+			for (;;)
+			{
+				skipMeshSpaces(p,end);
+				int index = 0;
+				if (!parseMeshInt(p,end,index))
+					break;
+				//negative indices are relative to the last vertex so far, positive indices start at 1
+				polygon.push_back(index<0 ? numPositions+index : index-1);
+				//skip the texture coordinate and normal indices
+				while (p<end && !isMeshSpace(*p) && *p!='\n')
+					p++;
+			}
+			for (int k=1;k+1<polygon.size();k++)
+			{
+				positionIndices.push_back(polygon[0]);
+				positionIndices.push_back(polygon[k]);
+				positionIndices.push_back(polygon[k+1]);
+			}
+		}
+		skipMeshLine(p,end);
+	}
+
+	//second pass: weld the vertices that are used by faces
+	LoadedTriangleMesh* mesh = new LoadedTriangleMesh;
+	TriangleMeshVertexWelder welder(mesh->m_vertices, numPositions);
+	btAlignedObjectArray<int> weldedIndex;
+	weldedIndex.resize(numPositions, -1);
+	mesh->m_indices.resize(positionIndices.size());
+	for (int i=0;i<positionIndices.size();i++)
+	{
+		int positionIndex = positionIndices[i];
+		if (positionIndex<0 || positionIndex>=numPositions)
+		{
+			printf("Invalid face vertex index in OBJ file %s\n", fileName);
+			delete mesh;
+			return 0;
+		}
+		if (weldedIndex[positionIndex]<0)
+		{
+			weldedIndex[positionIndex] = welder.addVertex(&positions[positionIndex*3]);
+		}
+		mesh->m_indices[i] = weldedIndex[positionIndex];
+	}
+	return finishTriangleMesh(mesh);
+}
+
+LoadedTriangleMesh* LoadTriangleMeshFromSTL(const char* fileName, const btVector3& scale)
+{
+	MappedMeshFile file(fileName);
+	if (!file.m_data)
+	{
+		printf("Cannot open STL file %s\n", fileName);
+		return 0;
+	}
+
+	LoadedTriangleMesh* mesh = new LoadedTriangleMesh;
+
+	//a binary file has an 80 byte header, the number of triangles and 50 bytes per triangle.
+	//ASCII files start with 'solid', but so do some binary files, so the size is checked first
+	unsigned int numBinaryTriangles = 0;
+	if (file.m_size >= 84)
+	{
+		memcpy(&numBinaryTriangles, file.m_data+80, sizeof(unsigned int));
+	}
+	if (file.m_size >= 84 && file.m_size == 84 + size_t(numBinaryTriangles)*50)
+	{
+		int numTriangles = int(numBinaryTriangles);
+		TriangleMeshVertexWelder welder(mesh->m_vertices, numTriangles/2+3);
+		mesh->m_indices.resize(numTriangles*3);
+		for (int t=0;t<numTriangles;t++)
+		{
+			//the normal (3 floats) is skipped, it is recomputed from the vertices when needed
+			float xyz[9];
+			memcpy(xyz, file.m_data + 84 + size_t(t)*50 + 12, sizeof(xyz));
+			for (int v=0;v<3;v++)
+			{
+				btScalar vertex[3] = {xyz[v*3]*scale[0], xyz[v*3+1]*scale[1], xyz[v*3+2]*scale[2]};
+				mesh->m_indices[t*3+v] = welder.addVertex(vertex);
+			}
+		}
+	} else
+	{
+		const char* p = file.m_data;
+		const char* end = file.m_data + file.m_size;
+		skipMeshSpaces(p,end);
+		if (!matchMeshKeyword(p,end,"solid",5))
+		{
+			printf("Invalid STL file %s\n", fileName);
+			delete mesh;
+			return 0;
+		}
+		//an ASCII triangle takes at least about 100 bytes
+		TriangleMeshVertexWelder welder(mesh->m_vertices, int(file.m_size/200)+3);
+		int numFacetVertices = 0;
+		//position in m_indices of the first vertex of the current facet
+		int facetFirstIndex = 0;
+		while (p<end)
+		{
+			skipMeshSpaces(p,end);
+			if (matchMeshKeyword(p,end,"vertex",6))
+			{
+				p += 6;
+				btScalar vertex[3];
+				if (!parseMeshScalar(p,end,vertex[0]) || !parseMeshScalar(p,end,vertex[1]) || !parseMeshScalar(p,end,vertex[2]))
+				{
+					printf("Invalid vertex in STL file %s\n", fileName);
+					delete mesh;
+					return 0;
+				}
+				vertex[0] *= scale[0];
+				vertex[1] *= scale[1];
+				vertex[2] *= scale[2];
+				//facets with more than 3 vertices are triangulated as a fan around their first vertex
+				if (numFacetVertices==0)
+				{
+					facetFirstIndex = mesh->m_indices.size();
+				} else if (numFacetVertices>=3)
+				{
+					int first = mesh->m_indices[facetFirstIndex];
+					int last = mesh->m_indices[mesh->m_indices.size()-1];
+					mesh->m_indices.push_back(first);
+					mesh->m_indices.push_back(last);
+				}
+				mesh->m_indices.push_back(welder.addVertex(vertex));
+				numFacetVertices++;
+			} else if (matchMeshKeyword(p,end,"endloop",7) || matchMeshKeyword(p,end,"endfacet",8))
+			{
+				if (numFacetVertices && numFacetVertices<3)
+				{
+					mesh->m_indices.resize(facetFirstIndex);
+				}
+				numFacetVertices = 0;
+			}
+			skipMeshLine(p,end);
+		}
+		if (numFacetVertices && numFacetVertices<3)
+		{
+			mesh->m_indices.resize(facetFirstIndex);
+		}
+	}
+	return finishTriangleMesh(mesh);
+}
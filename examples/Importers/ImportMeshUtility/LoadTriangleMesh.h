@@ -0,0 +1,43 @@
+#ifndef LOAD_TRIANGLE_MESH_H
+#define LOAD_TRIANGLE_MESH_H
+
+#include "BulletCollision/CollisionShapes/btTriangleIndexVertexArray.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btVector3.h"
+
+///LoadedTriangleMesh owns the vertex and index arrays of a mesh loaded by LoadTriangleMeshFromObj/STL,
+///and exposes them as a single btIndexedMesh, so it can be used directly by a btBvhTriangleMeshShape
+///or to create a btConvexHullShape (3 btScalar per vertex).
+ATTRIBUTE_ALIGNED16(class) LoadedTriangleMesh : public btTriangleIndexVertexArray
+{
+public:
+
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	btAlignedObjectArray<btScalar> m_vertices;
+	btAlignedObjectArray<int> m_indices;
+
+	int getNumVertices() const
+	{
+		return m_vertices.size()/3;
+	}
+
+	int getNumTriangles() const
+	{
+		return m_indices.size()/3;
+	}
+
+	///call after changing m_vertices or m_indices, to update the btIndexedMesh that points to them
+	void updateIndexedMesh();
+};
+
+///The mesh loaders below map the file in memory and parse it in a single pass, without intermediate graphics
+///structures. Vertices are scaled and welded: vertices with identical (scaled) coordinates are stored once.
+///OBJ files: only 'v' and 'f' lines are used, polygons are triangulated as a fan. Vertices that are not used by a face are dropped.
+///STL files: both binary and ASCII files are supported.
+///They return 0 if the file can't be read or has no triangles.
+LoadedTriangleMesh* LoadTriangleMeshFromObj(const char* fileName, const btVector3& scale=btVector3(1,1,1));
+
+LoadedTriangleMesh* LoadTriangleMeshFromSTL(const char* fileName, const btVector3& scale=btVector3(1,1,1));
+
+#endif //LOAD_TRIANGLE_MESH_H
@@ -0,0 +1,122 @@
+#include "BulletUrdfImportCache.h"
+
+#include "UrdfParser.h"
+#include "BulletCollision/CollisionShapes/btCollisionShape.h"
+#include "LinearMath/btHashMap.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include <stdio.h>
+#include <string>
+
+struct BulletURDFImportCacheInternalData
+{
+	//btHashString doesn't copy the string, so the keys are kept alive in m_keys
+	btAlignedObjectArray<std::string*> m_keys;
+
+	btHashMap<btHashString, UrdfParser*> m_parsedUrdfs;
+	btHashMap<btHashString, btCollisionShape*> m_meshCollisionShapes;
+
+	const char* allocKey(const std::string& key)
+	{
+		std::string* str = new std::string(key);
+		m_keys.push_back(str);
+		return str->c_str();
+	}
+};
+
+static std::string urdfKey(const char* fileName, bool forceFixedBase)
+{
+	std::string key = fileName;
+	key += forceFixedBase ? "|fixed" : "|free";
+	return key;
+}
+
+static std::string meshKey(const char* fullPath, const btVector3& meshScale)
+{
+	char scale[128];
+	sprintf(scale,"|%g,%g,%g",meshScale[0],meshScale[1],meshScale[2]);
+	std::string key = fullPath;
+	key += scale;
+	return key;
+}
+
+BulletURDFImportCache::BulletURDFImportCache()
+{
+	m_data = new BulletURDFImportCacheInternalData;
+}
+
+BulletURDFImportCache::~BulletURDFImportCache()
+{
+	clear();
+	delete m_data;
+}
+
+const UrdfParser* BulletURDFImportCache::findParsedUrdf(const char* fileName, bool forceFixedBase) const
+{
+	std::string key = urdfKey(fileName,forceFixedBase);
+	UrdfParser* const* parserPtr = m_data->m_parsedUrdfs.find(key.c_str());
+	return parserPtr ? *parserPtr : 0;
+}
+
+void BulletURDFImportCache::insertParsedUrdf(const char* fileName, bool forceFixedBase, UrdfParser* parser)
+{
+	std::string key = urdfKey(fileName,forceFixedBase);
+	UrdfParser* const* parserPtr = m_data->m_parsedUrdfs.find(key.c_str());
+	btAssert(parserPtr==0);
+	if (parserPtr)
+	{
+		delete parser;
+		return;
+	}
+	m_data->m_parsedUrdfs.insert(m_data->allocKey(key),parser);
+}
+
+btCollisionShape* BulletURDFImportCache::findMeshCollisionShape(const char* fullPath, const btVector3& meshScale) const
+{
+	std::string key = meshKey(fullPath,meshScale);
+	btCollisionShape* const* shapePtr = m_data->m_meshCollisionShapes.find(key.c_str());
+	return shapePtr ? *shapePtr : 0;
+}
+
+void BulletURDFImportCache::insertMeshCollisionShape(const char* fullPath, const btVector3& meshScale, btCollisionShape* shape)
+{
+	std::string key = meshKey(fullPath,meshScale);
+	btCollisionShape* const* shapePtr = m_data->m_meshCollisionShapes.find(key.c_str());
+	btAssert(shapePtr==0);
+	if (shapePtr)
+	{
+		delete shape;
+		return;
+	}
+	m_data->m_meshCollisionShapes.insert(m_data->allocKey(key),shape);
+}
+
+int BulletURDFImportCache::getNumParsedUrdfs() const
+{
+	return m_data->m_parsedUrdfs.size();
+}
+
+int BulletURDFImportCache::getNumMeshCollisionShapes() const
+{
+	return m_data->m_meshCollisionShapes.size();
+}
+
+void BulletURDFImportCache::clear()
+{
+	for (int i=0;i<m_data->m_parsedUrdfs.size();i++)
+	{
+		delete *m_data->m_parsedUrdfs.getAtIndex(i);
+	}
+	m_data->m_parsedUrdfs.clear();
+
+	for (int i=0;i<m_data->m_meshCollisionShapes.size();i++)
+	{
+		delete *m_data->m_meshCollisionShapes.getAtIndex(i);
+	}
+	m_data->m_meshCollisionShapes.clear();
+
+	for (int i=0;i<m_data->m_keys.size();i++)
+	{
+		delete m_data->m_keys[i];
+	}
+	m_data->m_keys.clear();
+}
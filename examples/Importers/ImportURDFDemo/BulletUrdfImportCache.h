@@ -0,0 +1,41 @@
+#ifndef BULLET_URDF_IMPORT_CACHE_H
+#define BULLET_URDF_IMPORT_CACHE_H
+
+#include "LinearMath/btVector3.h"
+
+///BulletURDFImportCache keeps the parsed URDF files and the collision shapes created from mesh files,
+///so loading the same robot many times only parses the XML and converts the meshes once.
+///Parsed files are keyed by file name and forceFixedBase, collision meshes by full path and mesh scale.
+///The cache owns the parsers and the collision shapes, it has to outlive all bodies that use them.
+///It is not thread safe, BulletURDFImporter only loads the meshes in parallel before inserting them.
+class BulletURDFImportCache
+{
+	struct BulletURDFImportCacheInternalData* m_data;
+
+public:
+
+	BulletURDFImportCache();
+
+	virtual ~BulletURDFImportCache();
+
+	///returns 0 if the file was not parsed before
+	const class UrdfParser* findParsedUrdf(const char* fileName, bool forceFixedBase) const;
+
+	///the cache takes ownership of the parser
+	void insertParsedUrdf(const char* fileName, bool forceFixedBase, class UrdfParser* parser);
+
+	///returns 0 if the mesh was not converted before
+	class btCollisionShape* findMeshCollisionShape(const char* fullPath, const btVector3& meshScale) const;
+
+	///the cache takes ownership of the shape
+	void insertMeshCollisionShape(const char* fullPath, const btVector3& meshScale, class btCollisionShape* shape);
+
+	int getNumParsedUrdfs() const;
+
+	int getNumMeshCollisionShapes() const;
+
+	///deletes all parsers and collision shapes
+	void clear();
+};
+
+#endif //BULLET_URDF_IMPORT_CACHE_H
@@ -25,6 +25,9 @@ subject to the following restrictions:
 #include "Bullet3Common/b3FileUtils.h"
 #include <string>
 #include "../../Utils/b3ResourcePath.h"
+#include "LinearMath/btThreads.h"
+#include "BulletUrdfImportCache.h"
+#include "../ImportMeshUtility/LoadTriangleMesh.h"
 
 
 
@@ -35,9 +38,17 @@ subject to the following restrictions:
 struct BulletURDFInternalData
 {
 	UrdfParser m_urdfParser;
+	//with an import cache, the parsed model is owned by the cache and shared with other importers
+	const UrdfParser* m_cachedUrdfParser;
+	BulletURDFImportCache* m_importCache;
 	struct GUIHelperInterface* m_guiHelper;
 	char m_pathPrefix[1024];
 	btHashMap<btHashInt,btVector4> m_linkColors;
+
+	const UrdfModel& getModel() const
+	{
+		return m_cachedUrdfParser ? m_cachedUrdfParser->getModel() : m_urdfParser.getModel();
+	}
 };
 
 void BulletURDFImporter::printTree()
@@ -55,10 +66,12 @@ enum MyFileType
 
 
     
-BulletURDFImporter::BulletURDFImporter(struct GUIHelperInterface* helper)
+BulletURDFImporter::BulletURDFImporter(struct GUIHelperInterface* helper, BulletURDFImportCache* importCache)
 {
 	m_data = new BulletURDFInternalData;
 	
+	m_data->m_cachedUrdfParser = 0;
+	m_data->m_importCache = importCache;
 	m_data->m_guiHelper = helper;
 	m_data->m_pathPrefix[0]=0;
 
@@ -109,6 +122,7 @@ bool BulletURDFImporter::loadURDF(const char* fileName, bool forceFixedBase)
 	
 	std::string xml_string;
 	m_data->m_pathPrefix[0] = 0;
+	m_data->m_cachedUrdfParser = 0;
     
     if (!fileFound){
         std::cerr << "URDF file not found" << std::endl;
@@ -119,6 +133,15 @@ bool BulletURDFImporter::loadURDF(const char* fileName, bool forceFixedBase)
 		int maxPathLen = 1024;
 		fu.extractPath(relativeFileName,m_data->m_pathPrefix,maxPathLen);
 
+		if (m_data->m_importCache)
+		{
+			m_data->m_cachedUrdfParser = m_data->m_importCache->findParsedUrdf(relativeFileName,forceFixedBase);
+			if (m_data->m_cachedUrdfParser)
+			{
+				return true;
+			}
+		}
+
 
         std::fstream xml_file(relativeFileName, std::fstream::in);
         while ( xml_file.good() )
@@ -131,6 +154,19 @@ bool BulletURDFImporter::loadURDF(const char* fileName, bool forceFixedBase)
     }
 
 	BulletErrorLogger loggie;
+	if (m_data->m_importCache)
+	{
+		UrdfParser* parser = new UrdfParser;
+		if (!parser->loadUrdf(xml_string.c_str(), &loggie, forceFixedBase))
+		{
+			delete parser;
+			return false;
+		}
+		m_data->m_importCache->insertParsedUrdf(relativeFileName,forceFixedBase,parser);
+		m_data->m_cachedUrdfParser = parser;
+		loadCollisionMeshes();
+		return true;
+	}
 	bool result = m_data->m_urdfParser.loadUrdf(xml_string.c_str(), &loggie, forceFixedBase);
 
 	return result;
@@ -150,9 +186,9 @@ BulletURDFImporter::~BulletURDFImporter()
     
 int BulletURDFImporter::getRootLinkIndex() const
 {
-	if (m_data->m_urdfParser.getModel().m_rootLinks.size()==1)
+	if (m_data->getModel().m_rootLinks.size()==1)
 	{
-		return m_data->m_urdfParser.getModel().m_rootLinks[0]->m_linkIndex;
+		return m_data->getModel().m_rootLinks[0]->m_linkIndex;
 	}
     return -1;
 };
@@ -160,7 +196,7 @@ int BulletURDFImporter::getRootLinkIndex() const
 void BulletURDFImporter::getLinkChildIndices(int linkIndex, btAlignedObjectArray<int>& childLinkIndices) const
 {
 	childLinkIndices.resize(0);
-	UrdfLink* const* linkPtr = m_data->m_urdfParser.getModel().m_links.getAtIndex(linkIndex);
+	UrdfLink* const* linkPtr = m_data->getModel().m_links.getAtIndex(linkIndex);
 	if (linkPtr)
 	{
 		const UrdfLink* link = *linkPtr;
@@ -187,7 +223,7 @@ bool BulletURDFImporter::getLinkColor(int linkIndex, btVector4& colorRGBA) const
 
 std::string BulletURDFImporter::getLinkName(int linkIndex) const
 {
-	UrdfLink* const* linkPtr = m_data->m_urdfParser.getModel().m_links.getAtIndex(linkIndex);
+	UrdfLink* const* linkPtr = m_data->getModel().m_links.getAtIndex(linkIndex);
 	btAssert(linkPtr);
 	if (linkPtr)
 	{
@@ -199,7 +235,7 @@ std::string BulletURDFImporter::getLinkName(int linkIndex) const
     
 std::string BulletURDFImporter::getJointName(int linkIndex) const
 {
-	UrdfLink* const* linkPtr = m_data->m_urdfParser.getModel().m_links.getAtIndex(linkIndex);
+	UrdfLink* const* linkPtr = m_data->getModel().m_links.getAtIndex(linkIndex);
 	btAssert(linkPtr);
 	if (linkPtr)
 	{
@@ -218,7 +254,7 @@ void  BulletURDFImporter::getMassAndInertia(int linkIndex, btScalar& mass,btVect
 	//todo(erwincoumans)
 	//the link->m_inertia is NOT necessarily aligned with the inertial frame
 	//so an additional transform might need to be computed
-	UrdfLink* const* linkPtr = m_data->m_urdfParser.getModel().m_links.getAtIndex(linkIndex);
+	UrdfLink* const* linkPtr = m_data->getModel().m_links.getAtIndex(linkIndex);
 	btAssert(linkPtr);
 	if (linkPtr)
 	{
@@ -241,7 +277,7 @@ bool BulletURDFImporter::getJointInfo(int urdfLinkIndex, btTransform& parent2joi
     jointLowerLimit = 0.f;
     jointUpperLimit = 0.f;
 	
-	UrdfLink* const* linkPtr = m_data->m_urdfParser.getModel().m_links.getAtIndex(urdfLinkIndex);
+	UrdfLink* const* linkPtr = m_data->getModel().m_links.getAtIndex(urdfLinkIndex);
 	btAssert(linkPtr);
 	if (linkPtr)
 	{
@@ -556,6 +592,12 @@ void convertURDFToVisualShape(const UrdfVisual* visual, const char* urdfPathPref
 	{
 
 		int baseIndex = verticesOut.size();
+		//use the same scaling as the mesh collision shape
+		btVector3 meshScale(1,1,1);
+		if (visual->m_geometry.m_type == URDF_GEOM_MESH)
+		{
+			meshScale = visual->m_geometry.m_meshScale;
+		}
 
 
 
@@ -567,7 +609,7 @@ void convertURDFToVisualShape(const UrdfVisual* visual, const char* urdfPathPref
 		for (int i = 0; i < glmesh->m_vertices->size(); i++)
 		{
 			GLInstanceVertex& v = glmesh->m_vertices->at(i);
-			btVector3 vert(v.xyzw[0],v.xyzw[1],v.xyzw[2]);
+			btVector3 vert = meshScale*btVector3(v.xyzw[0],v.xyzw[1],v.xyzw[2]);
 			btVector3 vt = visualTransform*vert;
 			v.xyzw[0] = vt[0];
 			v.xyzw[1] = vt[1];
@@ -585,7 +627,260 @@ void convertURDFToVisualShape(const UrdfVisual* visual, const char* urdfPathPref
 
 
 
-btCollisionShape* convertURDFToCollisionShape(const UrdfCollision* collision, const char* urdfPathPrefix)
+///returns the full path, the path prefix (for material files) and the file type of a URDF mesh file
+static int findMeshFile(const char* filename, const char* urdfPathPrefix, char* fullPath, char* meshPathPrefix)
+{
+	int fileType = 0;
+	printf("mesh->filename=%s\n",filename);
+	sprintf(fullPath,"%s%s",urdfPathPrefix,filename);
+	b3FileUtils::toLower(fullPath);
+	char tmpPathPrefix[1024];
+	int maxPathLen = 1024;
+	b3FileUtils::extractPath(filename,tmpPathPrefix,maxPathLen);
+	sprintf(meshPathPrefix,"%s%s",urdfPathPrefix,tmpPathPrefix);
+
+	if (strstr(fullPath,".dae"))
+	{
+		fileType = FILE_COLLADA;
+	}
+	if (strstr(fullPath,".stl"))
+	{
+		fileType = FILE_STL;
+	}
+	if (strstr(fullPath,".obj"))
+	{
+		fileType = FILE_OBJ;
+	}
+	sprintf(fullPath,"%s%s",urdfPathPrefix,filename);
+	return fileType;
+}
+
+///loads a mesh file and creates a convex hull of its (scaled) vertices, it doesn't touch any shared state,
+///so different meshes can be loaded in parallel
+static btCollisionShape* createConvexHullFromMeshFile(const char* fullPath, const char* collisionPathPrefix, int fileType, const btVector3& meshScale)
+{
+	btCollisionShape* shape = 0;
+	FILE* f = fopen(fullPath,"rb");
+	if (f)
+	{
+		fclose(f);
+
+		if ((fileType==FILE_OBJ) || (fileType==FILE_STL))
+		{
+			//only the positions are needed, the hull is created directly from the scaled and welded vertices
+			LoadedTriangleMesh* mesh = (fileType==FILE_OBJ) ? LoadTriangleMeshFromObj(fullPath,meshScale) : LoadTriangleMeshFromSTL(fullPath,meshScale);
+			if (mesh)
+			{
+				btConvexHullShape* convexHull = new btConvexHullShape(&mesh->m_vertices[0], mesh->getNumVertices(), 3*sizeof(btScalar));
+				convexHull->setMargin(0.001);
+				shape = convexHull;
+				delete mesh;
+			} else
+			{
+				printf("issue extracting mesh from file %s\n", fullPath);
+			}
+			return shape;
+		}
+
+		GLInstanceGraphicsShape* glmesh = 0;
+		switch (fileType)
+		{
+		case FILE_COLLADA:
+			{
+				
+				btAlignedObjectArray<GLInstanceGraphicsShape> visualShapes;
+				btAlignedObjectArray<ColladaGraphicsInstance> visualShapeInstances;
+				btTransform upAxisTrans;upAxisTrans.setIdentity();
+				float unitMeterScaling=1;
+				int upAxis = 2;
+				LoadMeshFromCollada(fullPath,
+									visualShapes, 
+									visualShapeInstances,
+									upAxisTrans,
+									unitMeterScaling,
+									upAxis );
+				
+				glmesh = new GLInstanceGraphicsShape;
+		//		int index = 0;
+				glmesh->m_indices = new b3AlignedObjectArray<int>();
+				glmesh->m_vertices = new b3AlignedObjectArray<GLInstanceVertex>();
+
+				for (int i=0;i<visualShapeInstances.size();i++)
+				{
+					ColladaGraphicsInstance* instance = &visualShapeInstances[i];
+					GLInstanceGraphicsShape* gfxShape = &visualShapes[instance->m_shapeIndex];
+
+					b3AlignedObjectArray<GLInstanceVertex> verts;
+					verts.resize(gfxShape->m_vertices->size());
+
+					int baseIndex = glmesh->m_vertices->size();
+
+					for (int i=0;i<gfxShape->m_vertices->size();i++)
+					{
+						verts[i].normal[0] = 	gfxShape->m_vertices->at(i).normal[0];
+						verts[i].normal[1] = 	gfxShape->m_vertices->at(i).normal[1];
+						verts[i].normal[2] = 	gfxShape->m_vertices->at(i).normal[2];
+						verts[i].uv[0] = gfxShape->m_vertices->at(i).uv[0];
+						verts[i].uv[1] = gfxShape->m_vertices->at(i).uv[1];
+						verts[i].xyzw[0] = gfxShape->m_vertices->at(i).xyzw[0];
+						verts[i].xyzw[1] = gfxShape->m_vertices->at(i).xyzw[1];
+						verts[i].xyzw[2] = gfxShape->m_vertices->at(i).xyzw[2];
+						verts[i].xyzw[3] = gfxShape->m_vertices->at(i).xyzw[3];
+
+					}
+
+					int curNumIndices = glmesh->m_indices->size();
+					int additionalIndices = gfxShape->m_indices->size();
+					glmesh->m_indices->resize(curNumIndices+additionalIndices);
+					for (int k=0;k<additionalIndices;k++)
+					{
+						glmesh->m_indices->at(curNumIndices+k)=gfxShape->m_indices->at(k)+baseIndex;
+					}
+
+					//compensate upAxisTrans and unitMeterScaling here
+					btMatrix4x4 upAxisMat;
+                                    upAxisMat.setIdentity();
+					//upAxisMat.setPureRotation(upAxisTrans.getRotation());
+					btMatrix4x4 unitMeterScalingMat;
+					unitMeterScalingMat.setPureScaling(btVector3(unitMeterScaling,unitMeterScaling,unitMeterScaling));
+					btMatrix4x4 worldMat = unitMeterScalingMat*instance->m_worldTransform*upAxisMat;
+					//btMatrix4x4 worldMat = instance->m_worldTransform;
+					int curNumVertices = glmesh->m_vertices->size();
+					int additionalVertices = verts.size();
+					glmesh->m_vertices->reserve(curNumVertices+additionalVertices);
+					
+					for(int v=0;v<verts.size();v++)
+					{
+						btVector3 pos(verts[v].xyzw[0],verts[v].xyzw[1],verts[v].xyzw[2]);
+						pos = worldMat*pos;
+						verts[v].xyzw[0] = float(pos[0]);
+						verts[v].xyzw[1] = float(pos[1]);
+						verts[v].xyzw[2] = float(pos[2]);
+						glmesh->m_vertices->push_back(verts[v]);
+					}
+				}
+				glmesh->m_numIndices = glmesh->m_indices->size();
+				glmesh->m_numvertices = glmesh->m_vertices->size();
+				//glmesh = LoadMeshFromCollada(fullPath);
+
+				break;
+			}
+		default:
+			{
+				printf("Unsupported file type in Collision: %s\n",fullPath);
+				btAssert(0);
+			}
+		}
+
+
+		if (glmesh && (glmesh->m_numvertices>0))
+		{
+			printf("extracted %d verticed from STL file %s\n", glmesh->m_numvertices,fullPath);
+			btAlignedObjectArray<btVector3> convertedVerts;
+			convertedVerts.reserve(glmesh->m_numvertices);
+			for (int i=0;i<glmesh->m_numvertices;i++)
+			{
+				convertedVerts.push_back(meshScale*btVector3(glmesh->m_vertices->at(i).xyzw[0],glmesh->m_vertices->at(i).xyzw[1],glmesh->m_vertices->at(i).xyzw[2]));
+			}
+			btConvexHullShape* cylZShape = new btConvexHullShape(&convertedVerts[0].getX(), convertedVerts.size(), sizeof(btVector3));
+			cylZShape->setMargin(0.001);
+			shape = cylZShape;
+		} else
+		{
+			printf("issue extracting mesh from STL file %s\n", fullPath);
+		}
+		if (glmesh)
+		{
+			delete glmesh->m_indices;
+			delete glmesh->m_vertices;
+			delete glmesh;
+		}
+	} else
+	{
+		printf("mesh geometry not found %s\n",fullPath);
+	}
+	return shape;
+}
+
+
+struct UrdfCollisionMeshLoad
+{
+	std::string m_fullPath;
+	std::string m_pathPrefix;
+	int m_fileType;
+	btVector3 m_meshScale;
+	btCollisionShape* m_shape;
+};
+
+struct UrdfCollisionMeshLoader : public btIParallelForBody
+{
+	btAlignedObjectArray<UrdfCollisionMeshLoad>* m_meshes;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i=iBegin;i<iEnd;i++)
+		{
+			UrdfCollisionMeshLoad& mesh = m_meshes->at(i);
+			mesh.m_shape = createConvexHullFromMeshFile(mesh.m_fullPath.c_str(),mesh.m_pathPrefix.c_str(),mesh.m_fileType,mesh.m_meshScale);
+		}
+	}
+};
+
+void BulletURDFImporter::loadCollisionMeshes()
+{
+	btAssert(m_data->m_importCache);
+	const UrdfModel& model = m_data->getModel();
+
+	//collect the meshes that are not in the cache yet, each unique mesh once
+	btAlignedObjectArray<UrdfCollisionMeshLoad> meshes;
+	for (int l=0;l<model.m_links.size();l++)
+	{
+		const UrdfLink* link = *model.m_links.getAtIndex(l);
+		for (int c=0;c<link->m_collisionArray.size();c++)
+		{
+			const UrdfGeometry& geom = link->m_collisionArray[c].m_geometry;
+			if ((geom.m_type != URDF_GEOM_MESH) || (geom.m_meshFileName.length()==0))
+				continue;
+
+			char fullPath[1024];
+			char collisionPathPrefix[1024];
+			int fileType = findMeshFile(geom.m_meshFileName.c_str(),m_data->m_pathPrefix,fullPath,collisionPathPrefix);
+			if (m_data->m_importCache->findMeshCollisionShape(fullPath,geom.m_meshScale))
+				continue;
+
+			bool found = false;
+			for (int i=0;i<meshes.size() && !found;i++)
+			{
+				found = (meshes[i].m_fullPath==fullPath) && (meshes[i].m_meshScale==geom.m_meshScale);
+			}
+			if (!found)
+			{
+				UrdfCollisionMeshLoad mesh;
+				mesh.m_fullPath = fullPath;
+				mesh.m_pathPrefix = collisionPathPrefix;
+				mesh.m_fileType = fileType;
+				mesh.m_meshScale = geom.m_meshScale;
+				mesh.m_shape = 0;
+				meshes.push_back(mesh);
+			}
+		}
+	}
+
+	//the mesh files are loaded and converted on the threads of the task scheduler, see btSetTaskScheduler
+	UrdfCollisionMeshLoader loader;
+	loader.m_meshes = &meshes;
+	btParallelFor(0,meshes.size(),1,loader);
+
+	for (int i=0;i<meshes.size();i++)
+	{
+		if (meshes[i].m_shape)
+		{
+			m_data->m_importCache->insertMeshCollisionShape(meshes[i].m_fullPath.c_str(),meshes[i].m_meshScale,meshes[i].m_shape);
+		}
+	}
+}
+
+btCollisionShape* convertURDFToCollisionShape(const UrdfCollision* collision, const char* urdfPathPrefix, BulletURDFImportCache* importCache)
 {
 	btCollisionShape* shape = 0;
 
@@ -649,179 +944,28 @@ btCollisionShape* convertURDFToCollisionShape(const UrdfCollision* collision, co
 			{
 				printf("collision->name=%s\n",collision->m_name.c_str());
 			}
-			if (1)
+			if (collision->m_geometry.m_meshFileName.length())
 			{
-				if (collision->m_geometry.m_meshFileName.length())
+				char fullPath[1024];
+				char collisionPathPrefix[1024];
+				int fileType = findMeshFile(collision->m_geometry.m_meshFileName.c_str(),urdfPathPrefix,fullPath,collisionPathPrefix);
+				const btVector3& meshScale = collision->m_geometry.m_meshScale;
+				if (importCache)
 				{
-					const char* filename = collision->m_geometry.m_meshFileName.c_str();
-					printf("mesh->filename=%s\n",filename);
-					char fullPath[1024];
-					int fileType = 0;
-					sprintf(fullPath,"%s%s",urdfPathPrefix,filename);
-					b3FileUtils::toLower(fullPath);
-                    char tmpPathPrefix[1024];
-                    int maxPathLen = 1024;
-                    b3FileUtils::extractPath(filename,tmpPathPrefix,maxPathLen);
-                    
-                    char collisionPathPrefix[1024];
-                    sprintf(collisionPathPrefix,"%s%s",urdfPathPrefix,tmpPathPrefix);
-                    
-                    
-                    
-					if (strstr(fullPath,".dae"))
-					{
-						fileType = FILE_COLLADA;
-					}
-					if (strstr(fullPath,".stl"))
-					{
-						fileType = FILE_STL;
-					}
-                    if (strstr(fullPath,".obj"))
-                   {
-                       fileType = FILE_OBJ;
-                   }
-
-					sprintf(fullPath,"%s%s",urdfPathPrefix,filename);
-					FILE* f = fopen(fullPath,"rb");
-					if (f)
+					shape = importCache->findMeshCollisionShape(fullPath,meshScale);
+					if (!shape)
 					{
-						fclose(f);
-						GLInstanceGraphicsShape* glmesh = 0;
-						
-						
-						switch (fileType)
+						shape = createConvexHullFromMeshFile(fullPath,collisionPathPrefix,fileType,meshScale);
+						if (shape)
 						{
-                            case FILE_OBJ:
-                            {
-                                glmesh = LoadMeshFromObj(fullPath,collisionPathPrefix);
-                                break;
-                            }
-						case FILE_STL:
-							{
-								glmesh = LoadMeshFromSTL(fullPath);
-							break;
-							}
-						case FILE_COLLADA:
-							{
-								
-								btAlignedObjectArray<GLInstanceGraphicsShape> visualShapes;
-								btAlignedObjectArray<ColladaGraphicsInstance> visualShapeInstances;
-								btTransform upAxisTrans;upAxisTrans.setIdentity();
-								float unitMeterScaling=1;
-								int upAxis = 2;
-								LoadMeshFromCollada(fullPath,
-													visualShapes, 
-													visualShapeInstances,
-													upAxisTrans,
-													unitMeterScaling,
-													upAxis );
-								
-								glmesh = new GLInstanceGraphicsShape;
-						//		int index = 0;
-								glmesh->m_indices = new b3AlignedObjectArray<int>();
-								glmesh->m_vertices = new b3AlignedObjectArray<GLInstanceVertex>();
-
-								for (int i=0;i<visualShapeInstances.size();i++)
-								{
-									ColladaGraphicsInstance* instance = &visualShapeInstances[i];
-									GLInstanceGraphicsShape* gfxShape = &visualShapes[instance->m_shapeIndex];
-		
-									b3AlignedObjectArray<GLInstanceVertex> verts;
-									verts.resize(gfxShape->m_vertices->size());
-
-									int baseIndex = glmesh->m_vertices->size();
-
-									for (int i=0;i<gfxShape->m_vertices->size();i++)
-									{
-										verts[i].normal[0] = 	gfxShape->m_vertices->at(i).normal[0];
-										verts[i].normal[1] = 	gfxShape->m_vertices->at(i).normal[1];
-										verts[i].normal[2] = 	gfxShape->m_vertices->at(i).normal[2];
-										verts[i].uv[0] = gfxShape->m_vertices->at(i).uv[0];
-										verts[i].uv[1] = gfxShape->m_vertices->at(i).uv[1];
-										verts[i].xyzw[0] = gfxShape->m_vertices->at(i).xyzw[0];
-										verts[i].xyzw[1] = gfxShape->m_vertices->at(i).xyzw[1];
-										verts[i].xyzw[2] = gfxShape->m_vertices->at(i).xyzw[2];
-										verts[i].xyzw[3] = gfxShape->m_vertices->at(i).xyzw[3];
-
-									}
-
-									int curNumIndices = glmesh->m_indices->size();
-									int additionalIndices = gfxShape->m_indices->size();
-									glmesh->m_indices->resize(curNumIndices+additionalIndices);
-									for (int k=0;k<additionalIndices;k++)
-									{
-										glmesh->m_indices->at(curNumIndices+k)=gfxShape->m_indices->at(k)+baseIndex;
-									}
-			
-									//compensate upAxisTrans and unitMeterScaling here
-									btMatrix4x4 upAxisMat;
-                                    upAxisMat.setIdentity();
-									//upAxisMat.setPureRotation(upAxisTrans.getRotation());
-									btMatrix4x4 unitMeterScalingMat;
-									unitMeterScalingMat.setPureScaling(btVector3(unitMeterScaling,unitMeterScaling,unitMeterScaling));
-									btMatrix4x4 worldMat = unitMeterScalingMat*instance->m_worldTransform*upAxisMat;
-									//btMatrix4x4 worldMat = instance->m_worldTransform;
-									int curNumVertices = glmesh->m_vertices->size();
-									int additionalVertices = verts.size();
-									glmesh->m_vertices->reserve(curNumVertices+additionalVertices);
-									
-									for(int v=0;v<verts.size();v++)
-									{
-										btVector3 pos(verts[v].xyzw[0],verts[v].xyzw[1],verts[v].xyzw[2]);
-										pos = worldMat*pos;
-										verts[v].xyzw[0] = float(pos[0]);
-										verts[v].xyzw[1] = float(pos[1]);
-										verts[v].xyzw[2] = float(pos[2]);
-										glmesh->m_vertices->push_back(verts[v]);
-									}
-								}
-								glmesh->m_numIndices = glmesh->m_indices->size();
-								glmesh->m_numvertices = glmesh->m_vertices->size();
-								//glmesh = LoadMeshFromCollada(fullPath);
-
-								break;
-							}
-						default:
-							{
-                                printf("Unsupported file type in Collision: %s\n",fullPath);
-                                btAssert(0);
-							}
-						}
-					
-
-						if (glmesh && (glmesh->m_numvertices>0))
-						{
-							printf("extracted %d verticed from STL file %s\n", glmesh->m_numvertices,fullPath);
-							//int shapeId = m_glApp->m_instancingRenderer->registerShape(&gvertices[0].pos[0],gvertices.size(),&indices[0],indices.size());
-							//convex->setUserIndex(shapeId);
-							btAlignedObjectArray<btVector3> convertedVerts;
-							convertedVerts.reserve(glmesh->m_numvertices);
-							for (int i=0;i<glmesh->m_numvertices;i++)
-							{
-								convertedVerts.push_back(btVector3(glmesh->m_vertices->at(i).xyzw[0],glmesh->m_vertices->at(i).xyzw[1],glmesh->m_vertices->at(i).xyzw[2]));
-							}
-							//btConvexHullShape* cylZShape = new btConvexHullShape(&glmesh->m_vertices->at(0).xyzw[0], glmesh->m_numvertices, sizeof(GLInstanceVertex));
-							btConvexHullShape* cylZShape = new btConvexHullShape(&convertedVerts[0].getX(), convertedVerts.size(), sizeof(btVector3));
-							//cylZShape->initializePolyhedralFeatures();
-							//btVector3 halfExtents(cyl->radius,cyl->radius,cyl->length/2.);
-							//btCylinderShapeZ* cylZShape = new btCylinderShapeZ(halfExtents);
-							cylZShape->setMargin(0.001);
-							shape = cylZShape;
-						} else
-						{
-							printf("issue extracting mesh from STL file %s\n", fullPath);
+							importCache->insertMeshCollisionShape(fullPath,meshScale,shape);
 						}
-
-					} else
-					{
-						printf("mesh geometry not found %s\n",fullPath);
 					}
-							
-							
+				} else
+				{
+					shape = createConvexHullFromMeshFile(fullPath,collisionPathPrefix,fileType,meshScale);
 				}
 			}
-
-					
             break;
         }
         default:
@@ -855,7 +999,7 @@ int BulletURDFImporter::convertLinkVisualShapes(int linkIndex, const char* pathP
             
     }
 #else
-	const UrdfModel& model = m_data->m_urdfParser.getModel();
+	const UrdfModel& model = m_data->getModel();
 	UrdfLink* const* linkPtr = model.m_links.getAtIndex(linkIndex);
 	if (linkPtr)
 	{
@@ -898,7 +1042,7 @@ int BulletURDFImporter::convertLinkVisualShapes(int linkIndex, const char* pathP
     for (int v=0;v<(int)m_data->m_links[linkIndex]->collision_array.size();v++)
     {
         const Collision* col = m_data->m_links[linkIndex]->collision_array[v].get();
-        btCollisionShape* childShape = convertURDFToCollisionShape(col ,pathPrefix);
+        btCollisionShape* childShape = convertURDFToCollisionShape(col ,pathPrefix,m_data->m_importCache);
             
         if (childShape)
         {
@@ -913,7 +1057,7 @@ int BulletURDFImporter::convertLinkVisualShapes(int linkIndex, const char* pathP
     }
 #else
 	
-	UrdfLink* const* linkPtr = m_data->m_urdfParser.getModel().m_links.getAtIndex(linkIndex);
+	UrdfLink* const* linkPtr = m_data->getModel().m_links.getAtIndex(linkIndex);
 	btAssert(linkPtr);
 	if (linkPtr)
 	{
@@ -924,7 +1068,7 @@ int BulletURDFImporter::convertLinkVisualShapes(int linkIndex, const char* pathP
 		for (int v=0;v<link->m_collisionArray.size();v++)
 		{
 			const UrdfCollision& col = link->m_collisionArray[v];
-			btCollisionShape* childShape = convertURDFToCollisionShape(&col ,pathPrefix);
+			btCollisionShape* childShape = convertURDFToCollisionShape(&col ,pathPrefix,m_data->m_importCache);
 			
 			if (childShape)
 			{
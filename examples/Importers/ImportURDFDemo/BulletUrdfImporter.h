@@ -9,10 +9,12 @@ class BulletURDFImporter : public URDFImporterInterface
     
 	struct BulletURDFInternalData* m_data;
     
+	void loadCollisionMeshes();
 
 public:
 
-	BulletURDFImporter(struct GUIHelperInterface* guiHelper);
+	///with an importCache, parsed URDF files and mesh collision shapes are shared between importers, see BulletURDFImportCache
+	BulletURDFImporter(struct GUIHelperInterface* guiHelper, class BulletURDFImportCache* importCache=0);
 
 	virtual ~BulletURDFImporter();
 
@@ -24,6 +24,18 @@ public:
 
     virtual bool submitClientCommand(const struct SharedMemoryCommand& command) = 0;
 
+    // submit several commands at once, the server processes them in order and returns a status for each
+    virtual bool submitClientCommands(const struct SharedMemoryCommand* const* commands, int numCommands) = 0;
+
+    // block until the status of the oldest outstanding command arrives, return nullptr on time out
+    virtual const struct SharedMemoryStatus* waitForServerStatus(int timeOutInMicroSeconds) = 0;
+
+    virtual int getNumOutstandingCommands() const = 0;
+
+    // the actual state of all bodies, written by the server after each command that changes it, see SharedMemoryStateRegion.h.
+    // Returns nullptr if there is no state yet. The pointer stays valid until the next call.
+    virtual const struct SharedMemoryStateRegion* getStateRegion() = 0;
+
     virtual int getNumJoints(int bodyIndex) const = 0;
 
     virtual void getJointInfo(int bodyIndex, int jointIndex, struct b3JointInfo& info) const = 0;
@@ -3,6 +3,7 @@
 #include "Bullet3Common/b3Scalar.h"
 #include <string.h>
 #include "SharedMemoryCommands.h"
+#include "SharedMemoryStateRegion.h"
 
 
 
@@ -527,6 +528,73 @@ int b3GetStatusActualState(b3SharedMemoryStatusHandle statusHandle,
     return true;
 }
 
+b3StateRegionHandle b3GetStateRegion(b3PhysicsClientHandle physClient)
+{
+    PhysicsClient* cl = (PhysicsClient* ) physClient;
+    return (b3StateRegionHandle) cl->getStateRegion();
+}
+
+int b3GetStateSequence(b3StateRegionHandle stateRegion)
+{
+    const SharedMemoryStateRegion* region = (const SharedMemoryStateRegion*) stateRegion;
+    if (!region)
+    {
+        return 0;
+    }
+    return b3SharedMemoryLoad(&region->m_sequence);
+}
+
+int b3GetStateNumBodies(b3StateRegionHandle stateRegion, int sequence)
+{
+    SharedMemoryStateRegion* region = (SharedMemoryStateRegion*) stateRegion;
+    if (!region || !sequence)
+    {
+        return 0;
+    }
+    const SharedMemoryStateHeader* header = (const SharedMemoryStateHeader*) GetSharedMemoryStateBuffer(region,sequence);
+    return header->m_numBodies;
+}
+
+int b3GetStateBody(b3StateRegionHandle stateRegion, int sequence, int bodyIndex, struct b3BodyState* bodyState)
+{
+    SharedMemoryStateRegion* region = (SharedMemoryStateRegion*) stateRegion;
+    if (!region || !sequence)
+    {
+        return 0;
+    }
+    const char* buffer = GetSharedMemoryStateBuffer(region,sequence);
+    const SharedMemoryStateHeader* header = (const SharedMemoryStateHeader*) buffer;
+    if (bodyIndex < 0 || bodyIndex >= header->m_numBodies)
+    {
+        return 0;
+    }
+    const SharedMemoryBodyState& body = ((const SharedMemoryBodyState*)(header+1))[bodyIndex];
+    //the server may be overwriting this buffer, don't point beyond its end in that case (b3IsStateValid will return 0)
+    int capacity = region->m_bufferCapacity;
+    if ((body.m_rootLocalInertialFrameOffset + 7*(int)sizeof(double) > capacity) ||
+        (body.m_actualStateQOffset + body.m_numDegreeOfFreedomQ*(int)sizeof(double) > capacity) ||
+        (body.m_actualStateQdotOffset + body.m_numDegreeOfFreedomU*(int)sizeof(double) > capacity) ||
+        (body.m_jointReactionForcesOffset + 6*body.m_numLinks*(int)sizeof(double) > capacity))
+    {
+        return 0;
+    }
+    bodyState->m_bodyUniqueId = body.m_bodyUniqueId;
+    bodyState->m_numDegreeOfFreedomQ = body.m_numDegreeOfFreedomQ;
+    bodyState->m_numDegreeOfFreedomU = body.m_numDegreeOfFreedomU;
+    bodyState->m_numLinks = body.m_numLinks;
+    bodyState->m_rootLocalInertialFrame = (const double*)(buffer + body.m_rootLocalInertialFrameOffset);
+    bodyState->m_actualStateQ = (const double*)(buffer + body.m_actualStateQOffset);
+    bodyState->m_actualStateQdot = (const double*)(buffer + body.m_actualStateQdotOffset);
+    bodyState->m_jointReactionForces = (const double*)(buffer + body.m_jointReactionForcesOffset);
+    return 1;
+}
+
+int b3IsStateValid(b3StateRegionHandle stateRegion, int sequence)
+{
+    const SharedMemoryStateRegion* region = (const SharedMemoryStateRegion*) stateRegion;
+    return region && sequence && IsSharedMemoryStateValid(region,sequence);
+}
+
 int	b3CanSubmitCommand(b3PhysicsClientHandle physClient)
 {
 	PhysicsClient* cl = (PhysicsClient* ) physClient;
@@ -544,16 +612,38 @@ int	b3SubmitClientCommand(b3PhysicsClientHandle physClient, const b3SharedMemory
     return (int)cl->submitClientCommand(*command);
 }
 
+int	b3SubmitClientCommands(b3PhysicsClientHandle physClient, const b3SharedMemoryCommandHandle* commandHandles, int numCommands)
+{
+    PhysicsClient* cl = (PhysicsClient* ) physClient;
+    return (int)cl->submitClientCommands((const struct SharedMemoryCommand* const*) commandHandles, numCommands);
+}
+
+b3SharedMemoryStatusHandle b3WaitForServerStatus(b3PhysicsClientHandle physClient, int timeOutInMicroSeconds)
+{
+    PhysicsClient* cl = (PhysicsClient* ) physClient;
+    return (b3SharedMemoryStatusHandle) cl->waitForServerStatus(timeOutInMicroSeconds);
+}
+
 b3SharedMemoryStatusHandle b3SubmitClientCommandAndWaitStatus(b3PhysicsClientHandle physClient, const b3SharedMemoryCommandHandle commandHandle)
 {
-    int timeout = 1024*1024*1024;
+    PhysicsClient* cl = (PhysicsClient* ) physClient;
+    int timeOutInMicroSeconds = 10*1000*1000;
     b3SharedMemoryStatusHandle statusHandle=0;
     
-    b3SubmitClientCommand(physClient,commandHandle);
+    if (!b3SubmitClientCommand(physClient,commandHandle))
+    {
+        return 0;
+    }
     
-    while ((statusHandle==0) && (timeout-- > 0))
+    //statuses arrive in submission order, so the last one belongs to this command.
+    //Keep waiting as long as it takes: an unconsumed status would block its ring buffer slot
+    while (cl->isConnected() && cl->getNumOutstandingCommands() > 0)
     {
-        statusHandle =b3ProcessServerStatus(physClient);
+        const SharedMemoryStatus* status = cl->waitForServerStatus(timeOutInMicroSeconds);
+        if (status)
+        {
+            statusHandle = (b3SharedMemoryStatusHandle) status;
+        }
     }
     return (b3SharedMemoryStatusHandle) statusHandle;
     
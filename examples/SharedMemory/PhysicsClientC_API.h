@@ -9,6 +9,7 @@
 B3_DECLARE_HANDLE(b3PhysicsClientHandle);
 B3_DECLARE_HANDLE(b3SharedMemoryCommandHandle);
 B3_DECLARE_HANDLE(b3SharedMemoryStatusHandle);
+B3_DECLARE_HANDLE(b3StateRegionHandle);
 
 
 #ifdef __cplusplus
@@ -29,9 +30,17 @@ b3SharedMemoryStatusHandle b3SubmitClientCommandAndWaitStatus(b3PhysicsClientHan
 ///non-blocking submit command
 int	b3SubmitClientCommand(b3PhysicsClientHandle physClient, b3SharedMemoryCommandHandle commandHandle);
 
+///non-blocking submit of several commands in one go, for example desired state, step simulation and request actual state.
+///The server processes them in order and returns one status per command (see b3WaitForServerStatus)
+int	b3SubmitClientCommands(b3PhysicsClientHandle physClient, const b3SharedMemoryCommandHandle* commandHandles, int numCommands);
+
 ///non-blocking check status
 b3SharedMemoryStatusHandle	b3ProcessServerStatus(b3PhysicsClientHandle physClient);
 
+///blocking wait for the status of the oldest outstanding command, returns 0 on time out.
+///The status handle is valid until the next status is processed
+b3SharedMemoryStatusHandle	b3WaitForServerStatus(b3PhysicsClientHandle physClient, int timeOutInMicroSeconds);
+
 int b3GetStatusType(b3SharedMemoryStatusHandle statusHandle);
 
 int b3GetStatusBodyIndex(b3SharedMemoryStatusHandle statusHandle);
@@ -45,6 +54,23 @@ int b3GetStatusActualState(b3SharedMemoryStatusHandle statusHandle,
                            const double* actualStateQdot[],
                            const double* jointReactionForces[]);
 
+///zero-copy access to the actual state of all bodies, without a request command and without a limit on the degrees of freedom.
+///The server writes the state after each command that changes it, for example each step simulation.
+///Returns 0 if there is no state. The handle is valid until the next call to b3GetStateRegion
+b3StateRegionHandle b3GetStateRegion(b3PhysicsClientHandle physClient);
+
+///sequence number of the latest state, 0 if there is none
+int b3GetStateSequence(b3StateRegionHandle stateRegion);
+
+int b3GetStateNumBodies(b3StateRegionHandle stateRegion, int sequence);
+
+///fills bodyState with pointers into the state region, returns 0 if bodyIndex is out of range
+int b3GetStateBody(b3StateRegionHandle stateRegion, int sequence, int bodyIndex, struct b3BodyState* bodyState);
+
+///returns 1 if the state with this sequence number wasn't overwritten by the server yet.
+///Call it after reading (or copying) the state, and read the latest state again if it returns 0
+int b3IsStateValid(b3StateRegionHandle stateRegion, int sequence);
+
 int	b3GetNumJoints(b3PhysicsClientHandle physClient, int bodyIndex);
 
 void	b3GetJointInfo(b3PhysicsClientHandle physClient, int bodyIndex, int linkIndex, struct b3JointInfo* info);
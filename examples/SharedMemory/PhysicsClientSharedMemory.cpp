@@ -10,6 +10,8 @@
 #include "../../Extras/Serialize/BulletFileLoader/btBulletFile.h"
 #include "../../Extras/Serialize/BulletFileLoader/autogenerated/bullet.h"
 #include "SharedMemoryBlock.h"
+#include "SharedMemorySync.h"
+#include "SharedMemoryStateRegion.h"
 #include "BodyJointInfoUtility.h"
 
 
@@ -33,10 +35,25 @@ struct PhysicsClientSharedMemoryInternalData {
 
     SharedMemoryStatus m_lastServerStatus;
 
+    //commands are prepared in a local slot and copied into the ring buffer on submission,
+    //so several commands can be prepared before submitting them as a batch
+    SharedMemoryCommand m_preparedCommands[SHARED_MEMORY_MAX_COMMANDS];
+    int m_numPreparedCommands;
+
+    //tickets of the submitted commands whose status is not consumed yet, oldest first
+    btAlignedObjectArray<int> m_outstandingTickets;
+    int m_firstOutstandingTicket;
+
+    //the state region the client is attached to, see getStateRegion
+    SharedMemoryInterface* m_stateRegionMemory;
+    SharedMemoryStateRegion* m_stateRegion;
+    int m_stateRegionKey;
+    int m_stateRegionSize;
+    int m_stateRegionGeneration;
+
     int m_counter;
     bool m_serverLoadUrdfOK;
     bool m_isConnected;
-    bool m_waitingForServer;
     bool m_hasLastServerStatus;
     int m_sharedMemoryKey;
     bool m_verboseOutput;
@@ -44,19 +61,63 @@ struct PhysicsClientSharedMemoryInternalData {
     PhysicsClientSharedMemoryInternalData()
         : m_sharedMemory(0),
           m_testBlock1(0),
+          m_numPreparedCommands(0),
+          m_firstOutstandingTicket(0),
+          m_stateRegionMemory(0),
+          m_stateRegion(0),
+          m_stateRegionKey(0),
+          m_stateRegionSize(0),
+          m_stateRegionGeneration(0),
           m_counter(0),
           m_serverLoadUrdfOK(false),
           m_isConnected(false),
-          m_waitingForServer(false),
           m_hasLastServerStatus(false),
           m_sharedMemoryKey(SHARED_MEMORY_KEY),
           m_verboseOutput(false) {}
 
-    void processServerStatus();
+    int getNumOutstandingCommands() const
+    {
+        return m_outstandingTickets.size()-m_firstOutstandingTicket;
+    }
+
+    void releaseStatus(int ticket);
 
-    bool canSubmitCommand() const;
+    void releaseStateRegion()
+    {
+        if (m_stateRegion)
+        {
+            m_stateRegionMemory->releaseSharedMemory(m_stateRegionKey, m_stateRegionSize);
+            m_stateRegion = 0;
+        }
+        m_stateRegionGeneration = 0;
+    }
 };
 
+void PhysicsClientSharedMemoryInternalData::releaseStatus(int ticket)
+{
+    SharedMemoryBlock* block = m_testBlock1;
+    int slot = (unsigned int)ticket%SHARED_MEMORY_MAX_COMMANDS;
+    b3SharedMemoryStore(&block->m_statusConsumedSequence[slot],ticket+1);
+    b3SharedMemoryAtomicAdd(&block->m_numProcessedServerCommands,1);
+
+    //the server waits for the status with streamed data to be consumed before it continues
+    if (b3SharedMemoryLoad(&block->m_streamStatusSequence)==ticket+1)
+    {
+        b3SharedMemoryAtomicAdd(&block->m_commandSignal,1);
+        if (b3SharedMemoryLoad(&block->m_numServerWaiters))
+        {
+            b3SharedMemoryWake(&block->m_commandSignal);
+        }
+    }
+
+    m_firstOutstandingTicket++;
+    if (m_firstOutstandingTicket==m_outstandingTickets.size())
+    {
+        m_outstandingTickets.resize(0);
+        m_firstOutstandingTicket = 0;
+    }
+}
+
 
 
 
@@ -92,8 +153,10 @@ PhysicsClientSharedMemory::PhysicsClientSharedMemory()
 
 #ifdef _WIN32
     m_data->m_sharedMemory = new Win32SharedMemoryClient();
+    m_data->m_stateRegionMemory = new Win32SharedMemoryClient();
 #else
     m_data->m_sharedMemory = new PosixSharedMemory();
+    m_data->m_stateRegionMemory = new PosixSharedMemory();
 #endif
 }
 
@@ -102,6 +165,7 @@ PhysicsClientSharedMemory::~PhysicsClientSharedMemory() {
         disconnectSharedMemory();
     }
     delete m_data->m_sharedMemory;
+    delete m_data->m_stateRegionMemory;
     delete m_data;
 }
 
@@ -109,6 +173,7 @@ void PhysicsClientSharedMemory::setSharedMemoryKey(int key) { m_data->m_sharedMe
 
 void PhysicsClientSharedMemory::disconnectSharedMemory() {
     if (m_data->m_isConnected) {
+        m_data->releaseStateRegion();
         m_data->m_sharedMemory->releaseSharedMemory(m_data->m_sharedMemoryKey, SHARED_MEMORY_SIZE);
         m_data->m_isConnected = false;
     }
@@ -134,6 +199,8 @@ bool PhysicsClientSharedMemory::connect() {
                 b3Printf("Connected to existing shared memory, status OK.\n");
             }
             m_data->m_isConnected = true;
+            m_data->m_outstandingTickets.resize(0);
+            m_data->m_firstOutstandingTicket = 0;
         }
     } else {
         b3Error("Cannot connect to shared memory");
@@ -149,22 +216,26 @@ const SharedMemoryStatus* PhysicsClientSharedMemory::processServerStatus() {
         return 0;
     }
 
-    if (!m_data->m_waitingForServer) {
+    if (!m_data->getNumOutstandingCommands()) {
         return 0;
     }
 
-    if (m_data->m_testBlock1->m_numServerCommands >
-        m_data->m_testBlock1->m_numProcessedServerCommands) {
-        btAssert(m_data->m_testBlock1->m_numServerCommands ==
-                 m_data->m_testBlock1->m_numProcessedServerCommands + 1);
-
-        const SharedMemoryStatus& serverCmd = m_data->m_testBlock1->m_serverCommands[0];
-        m_data->m_lastServerStatus = serverCmd;
+    //statuses arrive in ticket order, so only the oldest outstanding command can be completed
+    int ticket = m_data->m_outstandingTickets[m_data->m_firstOutstandingTicket];
+    if (b3SharedMemoryTicketDiff(b3SharedMemoryLoad(&m_data->m_testBlock1->m_numServerCommands), ticket) > 0) {
+        int slot = (unsigned int)ticket % SHARED_MEMORY_MAX_COMMANDS;
+        m_data->m_lastServerStatus = m_data->m_testBlock1->m_serverCommands[slot];
+        const SharedMemoryStatus& serverCmd = m_data->m_lastServerStatus;
 
         EnumSharedMemoryServerStatus s = (EnumSharedMemoryServerStatus)serverCmd.m_type;
         // consume the command
 
         switch (serverCmd.m_type) {
+            case CMD_WAITING_FOR_CLIENT_COMMAND: {
+                //the server processed the command without reporting a status
+                m_data->releaseStatus(ticket);
+                return 0;
+            }
             case CMD_CLIENT_COMMAND_COMPLETED: {
                 if (m_data->m_verboseOutput) {
                     b3Printf("Server completed command");
@@ -251,11 +322,15 @@ const SharedMemoryStatus* PhysicsClientSharedMemory::processServerStatus() {
                 break;
             }
 
+            case CMD_ACTUAL_STATE_UPDATE_FAILED: {
+                b3Warning("Request actual state failed");
+                break;
+            }
             case CMD_ACTUAL_STATE_UPDATE_COMPLETED: {
                 if (m_data->m_verboseOutput) {
                     b3Printf("Received actual state\n");
                 }
-                SharedMemoryStatus& command = m_data->m_testBlock1->m_serverCommands[0];
+                const SharedMemoryStatus& command = serverCmd;
 
                 int numQ = command.m_sendActualStateArgs.m_numDegreeOfFreedomQ;
                 int numU = command.m_sendActualStateArgs.m_numDegreeOfFreedomU;
@@ -397,22 +472,11 @@ const SharedMemoryStatus* PhysicsClientSharedMemory::processServerStatus() {
             }
         };
 
-        m_data->m_testBlock1->m_numProcessedServerCommands++;
-        // we don't have more than 1 command outstanding (in total, either server or client)
-        btAssert(m_data->m_testBlock1->m_numProcessedServerCommands ==
-                 m_data->m_testBlock1->m_numServerCommands);
-
-        if (m_data->m_testBlock1->m_numServerCommands ==
-            m_data->m_testBlock1->m_numProcessedServerCommands) {
-            m_data->m_waitingForServer = false;
-        } else {
-            m_data->m_waitingForServer = true;
-        }
-
         if ((serverCmd.m_type == CMD_DEBUG_LINES_COMPLETED) &&
             (serverCmd.m_sendDebugLinesArgs.m_numRemainingDebugLines > 0)) {
-            SharedMemoryCommand& command = m_data->m_testBlock1->m_clientCommands[0];
-
+            //the slot still holds the debug lines request, it can be reused once the status is released
+            SharedMemoryCommand command = m_data->m_testBlock1->m_clientCommands[slot];
+            m_data->releaseStatus(ticket);
             // continue requesting debug lines for drawing
             command.m_type = CMD_REQUEST_DEBUG_LINES;
             command.m_requestDebugLinesArguments.m_startingLineIndex =
@@ -422,6 +486,7 @@ const SharedMemoryStatus* PhysicsClientSharedMemory::processServerStatus() {
             return 0;
         }
 
+        m_data->releaseStatus(ticket);
         return &m_data->m_lastServerStatus;
 
     } else {
@@ -434,33 +499,160 @@ const SharedMemoryStatus* PhysicsClientSharedMemory::processServerStatus() {
     return 0;
 }
 
+const SharedMemoryStatus* PhysicsClientSharedMemory::waitForServerStatus(int timeOutInMicroSeconds) {
+    while (m_data->m_testBlock1 && m_data->getNumOutstandingCommands()) {
+        SharedMemoryBlock* block = m_data->m_testBlock1;
+        //register as waiter before checking, so a status published after the check will wake us up
+        b3SharedMemoryAtomicAdd(&block->m_numClientWaiters, 1);
+        int numStatuses = b3SharedMemoryLoad(&block->m_numServerCommands);
+        int ticket = m_data->m_outstandingTickets[m_data->m_firstOutstandingTicket];
+        bool hasStatus = b3SharedMemoryTicketDiff(numStatuses, ticket) > 0;
+        if (!hasStatus) {
+            hasStatus = b3SharedMemoryWait(&block->m_numServerCommands, numStatuses, timeOutInMicroSeconds);
+        }
+        b3SharedMemoryAtomicAdd(&block->m_numClientWaiters, -1);
+        if (!hasStatus) {
+            return 0;
+        }
+        const SharedMemoryStatus* status = processServerStatus();
+        if (status) {
+            return status;
+        }
+    }
+    return 0;
+}
+
+const SharedMemoryStateRegion* PhysicsClientSharedMemory::getStateRegion() {
+    if (!m_data->m_isConnected) {
+        return 0;
+    }
+    SharedMemoryBlock* block = m_data->m_testBlock1;
+    int generation = b3SharedMemoryLoad(&block->m_stateRegionGeneration);
+    if (generation != m_data->m_stateRegionGeneration) {
+        //the server created a new region, because the state didn't fit anymore
+        m_data->releaseStateRegion();
+        if (generation == 0) {
+            return 0;
+        }
+        int key = block->m_stateRegionKey;
+        int size = block->m_stateRegionSize;
+        if (b3SharedMemoryLoad(&block->m_stateRegionGeneration) != generation) {
+            //the region is being replaced right now, try again later
+            return 0;
+        }
+        SharedMemoryStateRegion* region =
+            (SharedMemoryStateRegion*)m_data->m_stateRegionMemory->allocateSharedMemory(key, size, false);
+        if (!region) {
+            return 0;
+        }
+        m_data->m_stateRegion = region;
+        m_data->m_stateRegionKey = key;
+        m_data->m_stateRegionSize = size;
+        if (region->m_magicId != SHARED_MEMORY_STATE_REGION_MAGIC_NUMBER ||
+            region->m_generation != generation) {
+            m_data->releaseStateRegion();
+            return 0;
+        }
+        m_data->m_stateRegionGeneration = generation;
+    }
+    return m_data->m_stateRegion;
+}
+
 bool PhysicsClientSharedMemory::canSubmitCommand() const {
-    return (m_data->m_isConnected && !m_data->m_waitingForServer);
+    return (m_data->m_isConnected &&
+            m_data->getNumOutstandingCommands() < SHARED_MEMORY_MAX_COMMANDS);
+}
+
+int PhysicsClientSharedMemory::getNumOutstandingCommands() const {
+    return m_data->getNumOutstandingCommands();
 }
 
 struct SharedMemoryCommand* PhysicsClientSharedMemory::getAvailableSharedMemoryCommand() {
-    return &m_data->m_testBlock1->m_clientCommands[0];
+    SharedMemoryCommand* command =
+        &m_data->m_preparedCommands[m_data->m_numPreparedCommands % SHARED_MEMORY_MAX_COMMANDS];
+    m_data->m_numPreparedCommands++;
+    return command;
 }
 
 bool PhysicsClientSharedMemory::submitClientCommand(const SharedMemoryCommand& command) {
-    /// at the moment we allow a maximum of 1 outstanding command, so we check for this
-    // once the server processed the command and returns a status, we clear the flag
-    // "m_data->m_waitingForServer" and allow submitting the next command
-    btAssert(!m_data->m_waitingForServer);
-
-    if (!m_data->m_waitingForServer) {
-        if (&m_data->m_testBlock1->m_clientCommands[0] != &command) {
-            m_data->m_testBlock1->m_clientCommands[0] = command;
+    const SharedMemoryCommand* commands = &command;
+    return submitClientCommands(&commands, 1);
+}
+
+bool PhysicsClientSharedMemory::submitClientCommands(const SharedMemoryCommand* const* commands,
+                                                     int numCommands) {
+    if (!m_data->m_isConnected || numCommands <= 0) {
+        return false;
+    }
+    if (m_data->getNumOutstandingCommands() + numCommands > SHARED_MEMORY_MAX_COMMANDS) {
+        b3Warning("submitClientCommands: %d commands exceed the %d free slots\n", numCommands,
+                  SHARED_MEMORY_MAX_COMMANDS - m_data->getNumOutstandingCommands());
+        return false;
+    }
+
+    SharedMemoryBlock* block = m_data->m_testBlock1;
+    //reserve consecutive tickets for the whole batch, but only once all their slots are free: a client
+    //that holds a ticket must never wait for another one, otherwise two clients can block each other
+    const int timeOutInMicroSeconds = 10 * 1000 * 1000;
+    int waitedMicroSeconds = 0;
+    int firstTicket = 0;
+    for (;;) {
+        firstTicket = b3SharedMemoryLoad(&block->m_numClientCommands);
+        int blockedSlot = -1;
+        for (int i = 0; i < numCommands && blockedSlot < 0; i++) {
+            int ticket = firstTicket + i;
+            int slot = (unsigned int)ticket % SHARED_MEMORY_MAX_COMMANDS;
+            //the slot is free once the status of the previous ticket in this slot is consumed
+            if (b3SharedMemoryLoad(&block->m_statusConsumedSequence[slot]) !=
+                ticket - SHARED_MEMORY_MAX_COMMANDS + 1) {
+                blockedSlot = slot;
+                for (int j = m_data->m_firstOutstandingTicket; j < m_data->m_outstandingTickets.size(); j++) {
+                    if (m_data->m_outstandingTickets[j] == ticket - SHARED_MEMORY_MAX_COMMANDS) {
+                        b3Warning("submitClientCommands: slot %d is blocked by an unconsumed status of this client\n",
+                                  slot);
+                        return false;
+                    }
+                }
+            }
+        }
+        if (blockedSlot < 0) {
+            if (b3SharedMemoryCompareAndSwap(&block->m_numClientCommands, firstTicket,
+                                             firstTicket + numCommands) == firstTicket) {
+                break;
+            }
+            //another client reserved tickets first, check the next slots
+            continue;
+        }
+        //another client still has to consume the status in that slot
+        if (waitedMicroSeconds >= timeOutInMicroSeconds) {
+            b3Warning("submitClientCommands: timeout waiting for slot %d\n", blockedSlot);
+            return false;
         }
-        m_data->m_testBlock1->m_numClientCommands++;
-        m_data->m_waitingForServer = true;
-        return true;
+        int consumed = b3SharedMemoryLoad(&block->m_statusConsumedSequence[blockedSlot]);
+        b3SharedMemoryWait(&block->m_statusConsumedSequence[blockedSlot], consumed, 100);
+        waitedMicroSeconds += 100;
+    }
+
+    for (int i = 0; i < numCommands; i++) {
+        int ticket = firstTicket + i;
+        int slot = (unsigned int)ticket % SHARED_MEMORY_MAX_COMMANDS;
+        block->m_clientCommands[slot] = *commands[i];
+        b3SharedMemoryStore(&block->m_commandSequence[slot], ticket + 1);
+        m_data->m_outstandingTickets.push_back(ticket);
+    }
+
+    //a single wake up for the whole batch
+    b3SharedMemoryAtomicAdd(&block->m_commandSignal, 1);
+    if (b3SharedMemoryLoad(&block->m_numServerWaiters)) {
+        b3SharedMemoryWake(&block->m_commandSignal);
     }
-    return false;
+    return true;
 }
 
 void PhysicsClientSharedMemory::uploadBulletFileToSharedMemory(const char* data, int len) {
     btAssert(len < SHARED_MEMORY_MAX_STREAM_CHUNK_SIZE);
+    //the server may still read the previous upload
+    btAssert(m_data->getNumOutstandingCommands() == 0);
     if (len >= SHARED_MEMORY_MAX_STREAM_CHUNK_SIZE) {
         b3Warning("uploadBulletFileToSharedMemory %d exceeds max size %d\n", len,
                   SHARED_MEMORY_MAX_STREAM_CHUNK_SIZE);
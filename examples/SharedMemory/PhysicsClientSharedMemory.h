@@ -30,6 +30,14 @@ public:
 
     virtual bool submitClientCommand(const struct SharedMemoryCommand& command);
 
+    virtual bool submitClientCommands(const struct SharedMemoryCommand* const* commands, int numCommands);
+
+    virtual const struct SharedMemoryStatus* waitForServerStatus(int timeOutInMicroSeconds);
+
+    virtual int getNumOutstandingCommands() const;
+
+    virtual const struct SharedMemoryStateRegion* getStateRegion();
+
     virtual int getNumJoints(int bodyIndex) const;
 
     virtual void getJointInfo(int bodyIndex, int jointIndex, struct b3JointInfo& info) const;
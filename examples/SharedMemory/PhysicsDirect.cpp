@@ -3,6 +3,8 @@
 #include "PhysicsClientSharedMemory.h"
 #include "../CommonInterfaces/CommonGUIHelperInterface.h"
 #include "SharedMemoryCommands.h"
+#include "SharedMemoryBlock.h"
+#include "SharedMemoryStateRegion.h"
 #include "PhysicsServerCommandProcessor.h"
 #include "LinearMath/btHashMap.h"
 #include "LinearMath/btAlignedObjectArray.h"
@@ -20,9 +22,15 @@ struct PhysicsDirectInternalData
 {
 	DummyGUIHelper m_noGfx;
 
-	SharedMemoryCommand m_command;
+	SharedMemoryCommand m_preparedCommands[SHARED_MEMORY_MAX_COMMANDS];
+	int m_numPreparedCommands;
 	SharedMemoryStatus m_serverStatus;
 	bool m_hasStatus;
+
+	//statuses of a batch of commands, returned in order by processServerStatus
+	btAlignedObjectArray<SharedMemoryStatus> m_queuedStatuses;
+	int m_firstQueuedStatus;
+	SharedMemoryStatus m_lastQueuedStatus;
 	bool m_verboseOutput;
 	
 	btAlignedObjectArray<TmpFloat3> m_debugLinesFrom;
@@ -33,10 +41,15 @@ struct PhysicsDirectInternalData
 	
 	char    m_bulletStreamDataServerToClient[SHARED_MEMORY_MAX_STREAM_CHUNK_SIZE];
 
+	//same layout as the shared memory state region, but written on demand by getStateRegion
+	btAlignedObjectArray<char> m_stateRegion;
+
 	PhysicsServerCommandProcessor* m_commandProcessor;
 
 	PhysicsDirectInternalData()
-		:m_hasStatus(false),
+		:m_numPreparedCommands(0),
+		m_hasStatus(false),
+		m_firstQueuedStatus(0),
 		m_verboseOutput(false)
 	{
 	}
@@ -57,6 +70,16 @@ PhysicsDirect::~PhysicsDirect()
 }
 
 
+PhysicsServerCommandProcessor* PhysicsDirect::getCommandProcessor()
+{
+	return m_data->m_commandProcessor;
+}
+
+void PhysicsDirect::setCommandProcessor(PhysicsServerCommandProcessor* commandProcessor)
+{
+	m_data->m_commandProcessor = commandProcessor;
+}
+
 // return true if connection succesfull, can also check 'isConnected'
 bool PhysicsDirect::connect()
 {
@@ -79,6 +102,16 @@ bool PhysicsDirect::isConnected() const
 const  SharedMemoryStatus* PhysicsDirect::processServerStatus()
 {
 	SharedMemoryStatus* stat = 0;
+	if (m_data->m_firstQueuedStatus < m_data->m_queuedStatuses.size())
+	{
+		m_data->m_lastQueuedStatus = m_data->m_queuedStatuses[m_data->m_firstQueuedStatus++];
+		if (m_data->m_firstQueuedStatus == m_data->m_queuedStatuses.size())
+		{
+			m_data->m_queuedStatuses.resize(0);
+			m_data->m_firstQueuedStatus = 0;
+		}
+		return &m_data->m_lastQueuedStatus;
+	}
 	if (m_data->m_hasStatus)
 	{
 		stat = &m_data->m_serverStatus;
@@ -89,7 +122,36 @@ const  SharedMemoryStatus* PhysicsDirect::processServerStatus()
 
 SharedMemoryCommand* PhysicsDirect::getAvailableSharedMemoryCommand()
 {
-	return &m_data->m_command;
+	//several commands can be prepared before they are submitted as a batch
+	return &m_data->m_preparedCommands[m_data->m_numPreparedCommands++ % SHARED_MEMORY_MAX_COMMANDS];
+}
+
+const SharedMemoryStateRegion* PhysicsDirect::getStateRegion()
+{
+	//the command processor runs in this process, so the state only needs to be written when it is read
+	SharedMemoryStateRegion* region = m_data->m_stateRegion.size() ? (SharedMemoryStateRegion*)&m_data->m_stateRegion[0] : 0;
+	if (region && !m_data->m_commandProcessor->isStateBufferDirty())
+	{
+		return region;
+	}
+	int sizeInBytes = m_data->m_commandProcessor->writeStateBuffer(0,0);
+	if (!region || sizeInBytes > region->m_bufferCapacity)
+	{
+		int bufferCapacity = SHARED_MEMORY_STATE_REGION_MIN_BUFFER_SIZE;
+		while (bufferCapacity < sizeInBytes)
+		{
+			bufferCapacity *= 2;
+		}
+		int generation = region ? region->m_generation+1 : 1;
+		m_data->m_stateRegion.resize(GetSharedMemoryStateRegionSize(bufferCapacity));
+		region = (SharedMemoryStateRegion*)&m_data->m_stateRegion[0];
+		InitSharedMemoryStateRegion(region,generation,bufferCapacity);
+	}
+	int sequence = region->m_sequence+1;
+	region->m_writeSequence = sequence;
+	m_data->m_commandProcessor->writeStateBuffer(GetSharedMemoryStateBuffer(region,sequence),region->m_bufferCapacity);
+	region->m_sequence = sequence;
+	return region;
 }
 
 bool PhysicsDirect::canSubmitCommand() const
@@ -265,6 +327,35 @@ bool PhysicsDirect::submitClientCommand(const struct SharedMemoryCommand& comman
 	return hasStatus;
 }
 
+bool PhysicsDirect::submitClientCommands(const struct SharedMemoryCommand* const* commands, int numCommands)
+{
+	//the commands are processed right away, keep their statuses so processServerStatus returns all of them
+	if (m_data->m_hasStatus)
+	{
+		m_data->m_queuedStatuses.push_back(m_data->m_serverStatus);
+		m_data->m_hasStatus = false;
+	}
+	for (int i=0;i<numCommands;i++)
+	{
+		if (submitClientCommand(*commands[i]))
+		{
+			m_data->m_queuedStatuses.push_back(m_data->m_serverStatus);
+			m_data->m_hasStatus = false;
+		}
+	}
+	return true;
+}
+
+const SharedMemoryStatus* PhysicsDirect::waitForServerStatus(int timeOutInMicroSeconds)
+{
+	return processServerStatus();
+}
+
+int PhysicsDirect::getNumOutstandingCommands() const
+{
+	return m_data->m_queuedStatuses.size()-m_data->m_firstQueuedStatus + (m_data->m_hasStatus ? 1 : 0);
+}
+
 int PhysicsDirect::getNumJoints(int bodyIndex) const
 {
 	BodyJointInfoCache2** bodyJointsPtr = m_data->m_bodyJointMap[bodyIndex];
@@ -19,6 +19,10 @@ protected:
 
 	bool processDebugLines(const struct SharedMemoryCommand& orgCommand);
 
+	//PhysicsMultiEnvironment swaps the command processor to address a single environment
+	class PhysicsServerCommandProcessor* getCommandProcessor();
+	void setCommandProcessor(class PhysicsServerCommandProcessor* commandProcessor);
+
 public:
 
     PhysicsDirect();
@@ -42,6 +46,14 @@ public:
 
     virtual bool submitClientCommand(const struct SharedMemoryCommand& command);
 
+    virtual bool submitClientCommands(const struct SharedMemoryCommand* const* commands, int numCommands);
+
+    virtual const struct SharedMemoryStatus* waitForServerStatus(int timeOutInMicroSeconds);
+
+    virtual int getNumOutstandingCommands() const;
+
+    virtual const struct SharedMemoryStateRegion* getStateRegion();
+
     virtual int getNumJoints(int bodyIndex) const;
 
     virtual void getJointInfo(int bodyIndex, int jointIndex, struct b3JointInfo& info) const;
@@ -74,6 +74,36 @@ bool PhysicsLoopBack::submitClientCommand(const struct SharedMemoryCommand& comm
 	return  m_data->m_physicsClient->submitClientCommand(command);
 }
 
+bool PhysicsLoopBack::submitClientCommands(const struct SharedMemoryCommand* const* commands, int numCommands)
+{
+	return m_data->m_physicsClient->submitClientCommands(commands,numCommands);
+}
+
+const SharedMemoryStatus* PhysicsLoopBack::waitForServerStatus(int timeOutInMicroSeconds)
+{
+	//the server runs in this thread, so there is nothing to wait for
+	while (m_data->m_physicsClient->isConnected() && m_data->m_physicsClient->getNumOutstandingCommands())
+	{
+		m_data->m_physicsServer->processClientCommands();
+		const SharedMemoryStatus* status = m_data->m_physicsClient->processServerStatus();
+		if (status)
+		{
+			return status;
+		}
+	}
+	return 0;
+}
+
+int PhysicsLoopBack::getNumOutstandingCommands() const
+{
+	return m_data->m_physicsClient->getNumOutstandingCommands();
+}
+
+const SharedMemoryStateRegion* PhysicsLoopBack::getStateRegion()
+{
+	return m_data->m_physicsClient->getStateRegion();
+}
+
 int PhysicsLoopBack::getNumJoints(int bodyIndex) const
 {
 	return m_data->m_physicsClient->getNumJoints(bodyIndex);
@@ -0,0 +1,228 @@
+#include "PhysicsMultiEnvironment.h"
+
+#include "PhysicsServerCommandProcessor.h"
+#include "SharedMemoryCommands.h"
+#include "SharedMemoryBlock.h"
+#include "../CommonInterfaces/CommonGUIHelperInterface.h"
+#include "../Importers/ImportURDFDemo/BulletUrdfImportCache.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btThreads.h"
+#include "Bullet3Common/b3Logging.h"
+
+struct PhysicsMultiEnvironmentInternalData
+{
+	DummyGUIHelper m_noGfx;
+
+	//all environments share the parsed URDF files and mesh collision shapes
+	BulletURDFImportCache m_importCache;
+
+	//m_environments[0] is owned by PhysicsDirect
+	btAlignedObjectArray<PhysicsServerCommandProcessor*> m_environments;
+	int m_selectedEnvironment;
+
+	//the other environments also stream the body info after loading a URDF file, it is ignored
+	btAlignedObjectArray<char> m_bulletStreamDataServerToClient;
+
+	btAlignedObjectArray<int> m_stepSucceeded;
+
+	PhysicsMultiEnvironmentInternalData()
+		:m_selectedEnvironment(-1)
+	{
+	}
+};
+
+///steps a range of environments, it runs on the threads of the task scheduler
+struct PhysicsStepEnvironmentsLoop : public btIParallelForBody
+{
+	PhysicsServerCommandProcessor* const* m_environments;
+	const SharedMemoryCommand* m_controlCommand;
+	const SharedMemoryCommand* m_stepCommand;
+	const double* m_actions;
+	int m_numActions;
+	int m_observedBodyUniqueId;
+	double* m_observations;
+	int m_numObservations;
+	int* m_succeeded;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		SharedMemoryStatus status;
+		for (int i=iBegin;i<iEnd;i++)
+		{
+			PhysicsServerCommandProcessor* environment = m_environments[i];
+			bool succeeded = true;
+			if (m_controlCommand)
+			{
+				SharedMemoryCommand command = *m_controlCommand;
+				SendDesiredStateArgs& args = command.m_sendDesiredStateCommandArgument;
+				const double* actions = &m_actions[i*m_numActions];
+				for (int j=0;j<m_numActions;j++)
+				{
+					//skip the degrees of freedom of the base, 6 velocity and 7 position variables
+					switch (args.m_controlMode)
+					{
+					case CONTROL_MODE_TORQUE:
+						args.m_desiredStateForceTorque[6+j] = actions[j];
+						break;
+					case CONTROL_MODE_VELOCITY:
+						args.m_desiredStateQdot[6+j] = actions[j];
+						break;
+					default:
+						args.m_desiredStateQ[7+j] = actions[j];
+					}
+				}
+				environment->processCommand(command,status,0,0);
+			}
+			environment->processCommand(*m_stepCommand,status,0,0);
+
+			if (m_observations)
+			{
+				double* observation = &m_observations[i*m_numObservations];
+				int numValues = environment->writeBodyObservation(m_observedBodyUniqueId,observation,m_numObservations);
+				if (numValues < 0)
+				{
+					succeeded = false;
+					numValues = 0;
+				}
+				for (int j=numValues;j<m_numObservations;j++)
+				{
+					observation[j] = 0;
+				}
+			}
+			m_succeeded[i] = succeeded;
+		}
+	}
+};
+
+PhysicsMultiEnvironment::PhysicsMultiEnvironment(int numEnvironments)
+{
+	btAssert(numEnvironments>0);
+	m_multiEnvData = new PhysicsMultiEnvironmentInternalData;
+	m_multiEnvData->m_environments.push_back(getCommandProcessor());
+	for (int i=1;i<numEnvironments;i++)
+	{
+		m_multiEnvData->m_environments.push_back(new PhysicsServerCommandProcessor);
+	}
+	for (int i=0;i<numEnvironments;i++)
+	{
+		m_multiEnvData->m_environments[i]->setImportCache(&m_multiEnvData->m_importCache);
+	}
+	m_multiEnvData->m_bulletStreamDataServerToClient.resize(SHARED_MEMORY_MAX_STREAM_CHUNK_SIZE);
+}
+
+PhysicsMultiEnvironment::~PhysicsMultiEnvironment()
+{
+	//all environments are deleted before the shared import cache, including environment 0 owned by PhysicsDirect
+	for (int i=0;i<m_multiEnvData->m_environments.size();i++)
+	{
+		delete m_multiEnvData->m_environments[i];
+	}
+	setCommandProcessor(0);
+	delete m_multiEnvData;
+}
+
+bool PhysicsMultiEnvironment::connect()
+{
+	for (int i=1;i<m_multiEnvData->m_environments.size();i++)
+	{
+		m_multiEnvData->m_environments[i]->setGuiHelper(&m_multiEnvData->m_noGfx);
+	}
+	return PhysicsDirect::connect();
+}
+
+void PhysicsMultiEnvironment::disconnectSharedMemory()
+{
+	for (int i=1;i<m_multiEnvData->m_environments.size();i++)
+	{
+		m_multiEnvData->m_environments[i]->setGuiHelper(0);
+	}
+	PhysicsDirect::disconnectSharedMemory();
+}
+
+bool PhysicsMultiEnvironment::submitClientCommand(const struct SharedMemoryCommand& command)
+{
+	int selected = m_multiEnvData->m_selectedEnvironment;
+	if (selected>=0)
+	{
+		setCommandProcessor(m_multiEnvData->m_environments[selected]);
+		bool hasStatus = PhysicsDirect::submitClientCommand(command);
+		setCommandProcessor(m_multiEnvData->m_environments[0]);
+		return hasStatus;
+	}
+
+	//requests are answered by environment 0 only
+	if ((command.m_type != CMD_REQUEST_ACTUAL_STATE) && (command.m_type != CMD_REQUEST_DEBUG_LINES))
+	{
+		SharedMemoryStatus status;
+		for (int i=1;i<m_multiEnvData->m_environments.size();i++)
+		{
+			m_multiEnvData->m_environments[i]->processCommand(command,status,
+				&m_multiEnvData->m_bulletStreamDataServerToClient[0],SHARED_MEMORY_MAX_STREAM_CHUNK_SIZE);
+		}
+	}
+	return PhysicsDirect::submitClientCommand(command);
+}
+
+int PhysicsMultiEnvironment::getNumEnvironments() const
+{
+	return m_multiEnvData->m_environments.size();
+}
+
+void PhysicsMultiEnvironment::selectEnvironment(int environmentIndex)
+{
+	btAssert(environmentIndex < m_multiEnvData->m_environments.size());
+	if (environmentIndex >= m_multiEnvData->m_environments.size())
+	{
+		environmentIndex = -1;
+	}
+	m_multiEnvData->m_selectedEnvironment = environmentIndex;
+}
+
+bool PhysicsMultiEnvironment::stepEnvironments(const struct SharedMemoryCommand* controlCommand, const double* actions, int numActionsPerEnvironment,
+	int observedBodyUniqueId, double* observations, int numObservationsPerEnvironment)
+{
+	if (controlCommand)
+	{
+		if ((controlCommand->m_type != CMD_SEND_DESIRED_STATE) || (numActionsPerEnvironment>MAX_DEGREE_OF_FREEDOM-7) || (numActionsPerEnvironment && !actions))
+		{
+			b3Warning("stepEnvironments: expected a desired state command with at most %d actions\n", MAX_DEGREE_OF_FREEDOM-7);
+			return false;
+		}
+		int controlMode = controlCommand->m_sendDesiredStateCommandArgument.m_controlMode;
+		if ((controlMode != CONTROL_MODE_TORQUE) && (controlMode != CONTROL_MODE_VELOCITY) && (controlMode != CONTROL_MODE_POSITION_VELOCITY_PD))
+		{
+			b3Warning("stepEnvironments: control mode %d not supported\n", controlMode);
+			return false;
+		}
+	}
+
+	SharedMemoryCommand stepCommand;
+	stepCommand.m_type = CMD_STEP_FORWARD_SIMULATION;
+	stepCommand.m_sequenceNumber = 0;
+	stepCommand.m_timeStamp = 0;
+	stepCommand.m_updateFlags = 0;
+
+	int numEnvironments = m_multiEnvData->m_environments.size();
+	m_multiEnvData->m_stepSucceeded.resize(numEnvironments);
+
+	PhysicsStepEnvironmentsLoop loop;
+	loop.m_environments = &m_multiEnvData->m_environments[0];
+	loop.m_controlCommand = controlCommand;
+	loop.m_stepCommand = &stepCommand;
+	loop.m_actions = actions;
+	loop.m_numActions = numActionsPerEnvironment;
+	loop.m_observedBodyUniqueId = observedBodyUniqueId;
+	loop.m_observations = observations;
+	loop.m_numObservations = numObservationsPerEnvironment;
+	loop.m_succeeded = &m_multiEnvData->m_stepSucceeded[0];
+	btParallelFor(0,numEnvironments,1,loop);
+
+	for (int i=0;i<numEnvironments;i++)
+	{
+		if (!m_multiEnvData->m_stepSucceeded[i])
+		{
+			return false;
+		}
+	}
+	return true;
+}
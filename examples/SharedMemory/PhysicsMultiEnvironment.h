@@ -0,0 +1,45 @@
+#ifndef PHYSICS_MULTI_ENVIRONMENT_H
+#define PHYSICS_MULTI_ENVIRONMENT_H
+
+#include "PhysicsDirect.h"
+
+///PhysicsMultiEnvironment hosts several isolated copies of the same world in this process, for example to train a policy
+///with reinforcement learning. Each environment has its own PhysicsServerCommandProcessor and dynamics world, they share
+///the parsed URDF files and mesh collision shapes through one BulletURDFImportCache.
+///Commands submitted through the PhysicsClient interface (load URDF, physics parameters, step, reset etc) are applied to all
+///environments, unless selectEnvironment picked a single one. The status of environment 0 (or of the selected one) is returned.
+///Requests (actual state, debug lines) are only answered by environment 0 or the selected environment.
+///stepEnvironments applies a batch of actions, steps all environments with btParallelFor and writes a batch of observations.
+///Install a btITaskScheduler (see btSetTaskScheduler) to step the environments on a thread pool.
+class PhysicsMultiEnvironment : public PhysicsDirect
+{
+	struct PhysicsMultiEnvironmentInternalData* m_multiEnvData;
+
+public:
+
+	PhysicsMultiEnvironment(int numEnvironments);
+
+	virtual ~PhysicsMultiEnvironment();
+
+	virtual bool connect();
+
+	virtual void disconnectSharedMemory();
+
+	virtual bool submitClientCommand(const struct SharedMemoryCommand& command);
+
+	int getNumEnvironments() const;
+
+	///the next commands only go to environmentIndex, -1 (the default) applies them to all environments
+	void selectEnvironment(int environmentIndex);
+
+	///Steps all environments once, in parallel. If controlCommand is not null, it is a CMD_SEND_DESIRED_STATE command
+	///that is applied to each environment before the step, with the desired values of the joint degrees of freedom replaced
+	///by the actions of that environment: torques (CONTROL_MODE_TORQUE), velocities (CONTROL_MODE_VELOCITY) or positions
+	///(CONTROL_MODE_POSITION_VELOCITY_PD). actions holds numActionsPerEnvironment values for each environment.
+	///If observations is not null, it receives numObservationsPerEnvironment values for each environment: the actual Q
+	///followed by Qdot of observedBodyUniqueId, padded with zeros. Returns false if a body doesn't exist or doesn't fit.
+	bool stepEnvironments(const struct SharedMemoryCommand* controlCommand, const double* actions, int numActionsPerEnvironment,
+		int observedBodyUniqueId, double* observations, int numObservationsPerEnvironment);
+};
+
+#endif //PHYSICS_MULTI_ENVIRONMENT_H
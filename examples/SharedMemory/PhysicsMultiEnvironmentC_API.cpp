@@ -0,0 +1,35 @@
+#include "PhysicsMultiEnvironmentC_API.h"
+
+#include "PhysicsMultiEnvironment.h"
+#include "SharedMemoryCommands.h"
+
+b3PhysicsClientHandle b3ConnectPhysicsMultiEnvironment(int numEnvironments)
+{
+	if (numEnvironments<1)
+	{
+		return 0;
+	}
+	PhysicsMultiEnvironment* multiEnv = new PhysicsMultiEnvironment(numEnvironments);
+	multiEnv->connect();
+	return (b3PhysicsClientHandle)(PhysicsClient*)multiEnv;
+}
+
+int b3GetNumEnvironments(b3PhysicsClientHandle physClient)
+{
+	PhysicsMultiEnvironment* multiEnv = static_cast<PhysicsMultiEnvironment*>((PhysicsClient*)physClient);
+	return multiEnv->getNumEnvironments();
+}
+
+void b3SelectEnvironment(b3PhysicsClientHandle physClient, int environmentIndex)
+{
+	PhysicsMultiEnvironment* multiEnv = static_cast<PhysicsMultiEnvironment*>((PhysicsClient*)physClient);
+	multiEnv->selectEnvironment(environmentIndex);
+}
+
+int b3StepEnvironments(b3PhysicsClientHandle physClient, b3SharedMemoryCommandHandle controlCommand, const double* actions, int numActions,
+	int observedBodyUniqueId, double* observations, int numObservations)
+{
+	PhysicsMultiEnvironment* multiEnv = static_cast<PhysicsMultiEnvironment*>((PhysicsClient*)physClient);
+	const SharedMemoryCommand* command = (const SharedMemoryCommand*)controlCommand;
+	return multiEnv->stepEnvironments(command,actions,numActions,observedBodyUniqueId,observations,numObservations) ? 1 : 0;
+}
@@ -0,0 +1,31 @@
+#ifndef PHYSICS_MULTI_ENVIRONMENT_C_API_H
+#define PHYSICS_MULTI_ENVIRONMENT_C_API_H
+
+#include "PhysicsClientC_API.h"
+
+#ifdef __cplusplus
+extern "C" { 
+#endif
+
+///Directly execute commands on numEnvironments isolated copies of the world, in this process.
+///The regular client API applies commands to all environments, see PhysicsMultiEnvironment.
+b3PhysicsClientHandle b3ConnectPhysicsMultiEnvironment(int numEnvironments);
+
+///the functions below only accept a handle created with b3ConnectPhysicsMultiEnvironment
+int b3GetNumEnvironments(b3PhysicsClientHandle physClient);
+
+///the next commands only go to environmentIndex, -1 applies them to all environments again
+void b3SelectEnvironment(b3PhysicsClientHandle physClient, int environmentIndex);
+
+///Steps all environments once in parallel (install a btITaskScheduler for a thread pool). controlCommand is optional,
+///created with b3JointControlCommandInit, the actions (numActions per environment) replace its desired values.
+///observations receives numObservations values per environment: Q followed by Qdot of observedBodyUniqueId.
+///Returns 1 on success, 0 on failure.
+int b3StepEnvironments(b3PhysicsClientHandle physClient, b3SharedMemoryCommandHandle controlCommand, const double* actions, int numActions,
+	int observedBodyUniqueId, double* observations, int numObservations);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //PHYSICS_MULTI_ENVIRONMENT_C_API_H
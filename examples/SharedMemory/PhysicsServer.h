@@ -21,6 +21,9 @@ public:
 
 	virtual void processClientCommands()=0;
 
+	///block until a client submitted a command, or until the time out. Returns true if there are commands to process
+	virtual bool waitForClientCommands(int timeOutInMicroSeconds)=0;
+
 //	virtual bool	supportsJointMotor(class btMultiBody* body, int linkIndex)=0;
 
 	//@todo(erwincoumans) Should we have shared memory commands for picking objects?
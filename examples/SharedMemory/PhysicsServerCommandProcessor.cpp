@@ -2,6 +2,7 @@
 
 
 #include "../Importers/ImportURDFDemo/BulletUrdfImporter.h"
+#include "../Importers/ImportURDFDemo/BulletUrdfImportCache.h"
 #include "../Importers/ImportURDFDemo/MyMultiBodyCreator.h"
 #include "../Importers/ImportURDFDemo/URDF2Bullet.h"
 #include "BulletDynamics/Featherstone/btMultiBodyDynamicsWorld.h"
@@ -21,6 +22,7 @@
 #include "Bullet3Common/b3Logging.h"
 #include "../CommonInterfaces/CommonGUIHelperInterface.h"
 #include "SharedMemoryCommands.h"
+#include "SharedMemoryStateRegion.h"
 
 struct UrdfLinkNameMapUtil
 {
@@ -384,6 +386,10 @@ struct PhysicsServerCommandProcessorInternalData
 	btHashMap<btHashInt, btMultiBodyJointMotor*>	m_multiBodyJointMotorMap;
 	btAlignedObjectArray<std::string*> m_strings;
 
+	//parsed URDF files and mesh collision shapes, kept across resetSimulation so reloading a robot is fast
+	BulletURDFImportCache m_urdfImportCache;
+	BulletURDFImportCache* m_importCache;
+
 	btAlignedObjectArray<btCollisionShape*>	m_collisionShapes;
 	btBroadphaseInterface*	m_broadphase;
 	btCollisionDispatcher*	m_dispatcher;
@@ -410,11 +416,15 @@ struct PhysicsServerCommandProcessorInternalData
 	btScalar m_oldPickingDist;
 	bool m_prevCanSleep;
 
+	//the actual state changed since the last writeStateBuffer
+	bool m_stateBufferDirty;
+
 	PhysicsServerCommandProcessorInternalData()
 		:
 		m_commandLogger(0),
 		m_logPlayback(0),
 		m_physicsDeltaTime(1./240.),
+		m_importCache(&m_urdfImportCache),
 		m_dynamicsWorld(0),
 		m_remoteDebugDrawer(0),
 		m_guiHelper(0),
@@ -422,7 +432,8 @@ struct PhysicsServerCommandProcessorInternalData
 		m_verboseOutput(false),
 		m_pickedBody(0),
 		m_pickedConstraint(0),
-		m_pickingMultiBodyPoint2Point(0)
+		m_pickingMultiBodyPoint2Point(0),
+		m_stateBufferDirty(true)
 	{
         
 		initHandles();
@@ -474,6 +485,11 @@ struct PhysicsServerCommandProcessorInternalData
 
 };
 
+void PhysicsServerCommandProcessor::setImportCache(BulletURDFImportCache* importCache)
+{
+	m_data->m_importCache = importCache ? importCache : &m_data->m_urdfImportCache;
+}
+
 void PhysicsServerCommandProcessor::setGuiHelper(struct GUIHelperInterface* guiHelper)
 {
 	
@@ -659,7 +675,7 @@ bool PhysicsServerCommandProcessor::loadUrdf(const char* fileName, const btVecto
 		return false;
 	}
 
-    BulletURDFImporter u2b(m_data->m_guiHelper);
+    BulletURDFImporter u2b(m_data->m_guiHelper,m_data->m_importCache);
 
    
     bool loadOk =  u2b.loadURDF(fileName, useFixedBase);
@@ -763,6 +779,202 @@ bool PhysicsServerCommandProcessor::loadUrdf(const char* fileName, const btVecto
 
 
 
+//the number of position variables Q, velocity variables U and links of a body, including the base
+static void getBodyStateSize(const InteralBodyData* body, int& numDegreeOfFreedomQ, int& numDegreeOfFreedomU, int& numLinks)
+{
+	//always add the base, even for static (non-moving objects)
+	//so that we can easily move the 'fixed' base when needed
+	numDegreeOfFreedomQ = 7;//pos + quaternion
+	numDegreeOfFreedomU = 6;//3 linear and 3 angular DOF
+	numLinks = 0;
+	if (body->m_multiBody)
+	{
+		const btMultiBody* mb = body->m_multiBody;
+		numLinks = mb->getNumLinks();
+		for (int l=0;l<numLinks;l++)
+		{
+			numDegreeOfFreedomQ += mb->getLink(l).m_posVarCount;
+			numDegreeOfFreedomU += mb->getLink(l).m_dofCount;
+		}
+	}
+}
+
+//write the actual state of a body, the arrays need to have the sizes reported by getBodyStateSize.
+//rootLocalInertialFrame and jointReactionForces are optional
+static void writeBodyState(const InteralBodyData* body, double* rootLocalInertialFrame, double* actualStateQ, double* actualStateQdot, double* jointReactionForces)
+{
+	if (rootLocalInertialFrame)
+	{
+		rootLocalInertialFrame[0] = body->m_rootLocalInertialFrame.getOrigin()[0];
+		rootLocalInertialFrame[1] = body->m_rootLocalInertialFrame.getOrigin()[1];
+		rootLocalInertialFrame[2] = body->m_rootLocalInertialFrame.getOrigin()[2];
+		rootLocalInertialFrame[3] = body->m_rootLocalInertialFrame.getRotation()[0];
+		rootLocalInertialFrame[4] = body->m_rootLocalInertialFrame.getRotation()[1];
+		rootLocalInertialFrame[5] = body->m_rootLocalInertialFrame.getRotation()[2];
+		rootLocalInertialFrame[6] = body->m_rootLocalInertialFrame.getRotation()[3];
+	}
+
+	btTransform tr;
+	btVector3 linearVelocity, angularVelocity;
+	if (body->m_multiBody)
+	{
+		const btMultiBody* mb = body->m_multiBody;
+		tr.setOrigin(mb->getBasePos());
+		tr.setRotation(mb->getWorldToBaseRot().inverse());
+		linearVelocity = mb->getBaseVel();
+		angularVelocity = mb->getBaseOmega();
+	} else
+	{
+		const btRigidBody* rb = body->m_rigidBody;
+		tr = rb->getWorldTransform();
+		linearVelocity = rb->getLinearVelocity();
+		angularVelocity = rb->getAngularVelocity();
+	}
+
+	//base position in world space, carthesian
+	actualStateQ[0] = tr.getOrigin()[0];
+	actualStateQ[1] = tr.getOrigin()[1];
+	actualStateQ[2] = tr.getOrigin()[2];
+
+	//base orientation, quaternion x,y,z,w, in world space, carthesian
+	actualStateQ[3] = tr.getRotation()[0]; 
+	actualStateQ[4] = tr.getRotation()[1];
+	actualStateQ[5] = tr.getRotation()[2];
+	actualStateQ[6] = tr.getRotation()[3];
+
+	//base linear velocity (in world space, carthesian)
+	actualStateQdot[0] = linearVelocity[0];
+	actualStateQdot[1] = linearVelocity[1];
+	actualStateQdot[2] = linearVelocity[2];
+
+	//base angular velocity (in world space, carthesian)
+	actualStateQdot[3] = angularVelocity[0];
+	actualStateQdot[4] = angularVelocity[1];
+	actualStateQdot[5] = angularVelocity[2];
+
+	if (body->m_multiBody)
+	{
+		const btMultiBody* mb = body->m_multiBody;
+		int totalDegreeOfFreedomQ = 7;
+		int totalDegreeOfFreedomU = 6;
+		for (int l=0;l<mb->getNumLinks();l++)
+		{
+			for (int d=0;d<mb->getLink(l).m_posVarCount;d++)
+			{
+				actualStateQ[totalDegreeOfFreedomQ++] = mb->getJointPosMultiDof(l)[d];
+			}
+			for (int d=0;d<mb->getLink(l).m_dofCount;d++)
+			{
+				actualStateQdot[totalDegreeOfFreedomU++] = mb->getJointVelMultiDof(l)[d];
+			}
+
+			if (!jointReactionForces)
+			{
+				continue;
+			}
+			if (0 == mb->getLink(l).m_jointFeedback)
+			{
+				for (int d=0;d<6;d++)
+				{
+					jointReactionForces[l*6+d]=0;
+				}
+			} else
+			{
+				btVector3 sensedForce = mb->getLink(l).m_jointFeedback->m_reactionForces.getLinear();
+				btVector3 sensedTorque = mb->getLink(l).m_jointFeedback->m_reactionForces.getAngular();
+
+				jointReactionForces[l*6+0] = sensedForce[0];
+				jointReactionForces[l*6+1] = sensedForce[1];
+				jointReactionForces[l*6+2] = sensedForce[2];
+
+				jointReactionForces[l*6+3] = sensedTorque[0];
+				jointReactionForces[l*6+4] = sensedTorque[1];
+				jointReactionForces[l*6+5] = sensedTorque[2];
+			}
+		}
+	}
+}
+
+int PhysicsServerCommandProcessor::writeBodyObservation(int bodyUniqueId, double* observation, int maxNumValues) const
+{
+	if ((bodyUniqueId<0) || (bodyUniqueId>=m_data->m_bodyHandles.size()))
+	{
+		return -1;
+	}
+	const InteralBodyData* body = m_data->getHandle(bodyUniqueId);
+	if (!body->m_multiBody && !body->m_rigidBody)
+	{
+		return -1;
+	}
+	int numDegreeOfFreedomQ, numDegreeOfFreedomU, numLinks;
+	getBodyStateSize(body, numDegreeOfFreedomQ, numDegreeOfFreedomU, numLinks);
+	if (numDegreeOfFreedomQ+numDegreeOfFreedomU > maxNumValues)
+	{
+		return -1;
+	}
+	writeBodyState(body, 0, observation, observation+numDegreeOfFreedomQ, 0);
+	return numDegreeOfFreedomQ+numDegreeOfFreedomU;
+}
+
+bool PhysicsServerCommandProcessor::isStateBufferDirty() const
+{
+	return m_data->m_stateBufferDirty;
+}
+
+int PhysicsServerCommandProcessor::writeStateBuffer(char* buffer, int bufferSizeInBytes)
+{
+	int numBodies = 0;
+	int numDoubles = 0;
+	for (int i=0;i<m_data->m_bodyHandles.size();i++)
+	{
+		const InteralBodyData* body = m_data->getHandle(i);
+		if (body->m_multiBody || body->m_rigidBody)
+		{
+			int numDegreeOfFreedomQ, numDegreeOfFreedomU, numLinks;
+			getBodyStateSize(body, numDegreeOfFreedomQ, numDegreeOfFreedomU, numLinks);
+			numBodies++;
+			numDoubles += 7 + numDegreeOfFreedomQ + numDegreeOfFreedomU + 6*numLinks;
+		}
+	}
+
+	//the state data is 8 byte aligned
+	int dataOffset = sizeof(SharedMemoryStateHeader) + numBodies*sizeof(SharedMemoryBodyState);
+	dataOffset = (dataOffset+7)&~7;
+	int sizeInBytes = dataOffset + numDoubles*sizeof(double);
+	if (sizeInBytes > bufferSizeInBytes)
+	{
+		return sizeInBytes;
+	}
+
+	SharedMemoryStateHeader* header = (SharedMemoryStateHeader*)buffer;
+	header->m_numBodies = numBodies;
+	header->m_sizeInBytes = sizeInBytes;
+	SharedMemoryBodyState* bodyStates = (SharedMemoryBodyState*)(header+1);
+	int bodyIndex = 0;
+	for (int i=0;i<m_data->m_bodyHandles.size();i++)
+	{
+		const InteralBodyData* body = m_data->getHandle(i);
+		if (body->m_multiBody || body->m_rigidBody)
+		{
+			SharedMemoryBodyState& bodyState = bodyStates[bodyIndex++];
+			bodyState.m_bodyUniqueId = i;
+			getBodyStateSize(body, bodyState.m_numDegreeOfFreedomQ, bodyState.m_numDegreeOfFreedomU, bodyState.m_numLinks);
+			bodyState.m_rootLocalInertialFrameOffset = dataOffset;
+			bodyState.m_actualStateQOffset = bodyState.m_rootLocalInertialFrameOffset + 7*sizeof(double);
+			bodyState.m_actualStateQdotOffset = bodyState.m_actualStateQOffset + bodyState.m_numDegreeOfFreedomQ*sizeof(double);
+			bodyState.m_jointReactionForcesOffset = bodyState.m_actualStateQdotOffset + bodyState.m_numDegreeOfFreedomU*sizeof(double);
+			dataOffset = bodyState.m_jointReactionForcesOffset + 6*bodyState.m_numLinks*sizeof(double);
+
+			writeBodyState(body, (double*)(buffer+bodyState.m_rootLocalInertialFrameOffset),
+				(double*)(buffer+bodyState.m_actualStateQOffset), (double*)(buffer+bodyState.m_actualStateQdotOffset),
+				(double*)(buffer+bodyState.m_jointReactionForcesOffset));
+		}
+	}
+	btAssert(dataOffset==sizeInBytes);
+	m_data->m_stateBufferDirty = false;
+	return sizeInBytes;
+}
+
 bool PhysicsServerCommandProcessor::processCommand(const struct SharedMemoryCommand& clientCmd, struct SharedMemoryStatus& serverStatusOut, char* bufferServerToClient, int bufferSizeInBytes )
 {
 
@@ -811,6 +1023,7 @@ bool PhysicsServerCommandProcessor::processCommand(const struct SharedMemoryComm
 #if 0
 				case CMD_SEND_BULLET_DATA_STREAM:
                 {
+					m_data->m_stateBufferDirty = true;
 					if (m_data->m_verboseOutput)
 					{
 						b3Printf("Processed CMD_SEND_BULLET_DATA_STREAM length %d",clientCmd.m_dataStreamArguments.m_streamChunkLength);
@@ -905,6 +1118,7 @@ bool PhysicsServerCommandProcessor::processCommand(const struct SharedMemoryComm
 
                 case CMD_LOAD_URDF:
                 {
+                    m_data->m_stateBufferDirty = true;
 					
                     const UrdfArgs& urdfArgs = clientCmd.m_urdfArguments;
 					if (m_data->m_verboseOutput)
@@ -1186,157 +1400,38 @@ bool PhysicsServerCommandProcessor::processCommand(const struct SharedMemoryComm
 						}
 						int bodyUniqueId = clientCmd.m_requestActualStateInformationCommandArgument.m_bodyUniqueId;
 						InteralBodyData* body = m_data->getHandle(bodyUniqueId);
+						SharedMemoryStatus& serverCmd = serverStatusOut;
 						
-						if (body && body->m_multiBody)
+						if (body && (body->m_multiBody || body->m_rigidBody))
 						{
-							btMultiBody* mb = body->m_multiBody;
-							SharedMemoryStatus& serverCmd = serverStatusOut;
-							serverStatusOut.m_type = CMD_ACTUAL_STATE_UPDATE_COMPLETED;
-
-							serverCmd.m_sendActualStateArgs.m_bodyUniqueId = bodyUniqueId;
-							int totalDegreeOfFreedomQ = 0;
-							int totalDegreeOfFreedomU = 0; 
-							
-							
-							//always add the base, even for static (non-moving objects)
-							//so that we can easily move the 'fixed' base when needed
-							//do we don't use this conditional "if (!mb->hasFixedBase())"
+							int numDegreeOfFreedomQ, numDegreeOfFreedomU, numLinks;
+							getBodyStateSize(body, numDegreeOfFreedomQ, numDegreeOfFreedomU, numLinks);
+							if ((numDegreeOfFreedomQ<=MAX_DEGREE_OF_FREEDOM) && (numDegreeOfFreedomU<=MAX_DEGREE_OF_FREEDOM) && (numLinks<=MAX_DEGREE_OF_FREEDOM))
 							{
-								btTransform tr;
-								tr.setOrigin(mb->getBasePos());
-								tr.setRotation(mb->getWorldToBaseRot().inverse());
-								
-                                serverCmd.m_sendActualStateArgs.m_rootLocalInertialFrame[0] =
-                                    body->m_rootLocalInertialFrame.getOrigin()[0];
-                                serverCmd.m_sendActualStateArgs.m_rootLocalInertialFrame[1] =
-                                    body->m_rootLocalInertialFrame.getOrigin()[1];
-                                serverCmd.m_sendActualStateArgs.m_rootLocalInertialFrame[2] =
-                                    body->m_rootLocalInertialFrame.getOrigin()[2];
-
-                                serverCmd.m_sendActualStateArgs.m_rootLocalInertialFrame[3] =
-                                    body->m_rootLocalInertialFrame.getRotation()[0];
-                                serverCmd.m_sendActualStateArgs.m_rootLocalInertialFrame[4] =
-                                    body->m_rootLocalInertialFrame.getRotation()[1];
-                                serverCmd.m_sendActualStateArgs.m_rootLocalInertialFrame[5] =
-                                    body->m_rootLocalInertialFrame.getRotation()[2];
-                                serverCmd.m_sendActualStateArgs.m_rootLocalInertialFrame[6] =
-                                    body->m_rootLocalInertialFrame.getRotation()[3];
-
-
-                                
-								//base position in world space, carthesian
-								serverCmd.m_sendActualStateArgs.m_actualStateQ[0] = tr.getOrigin()[0];
-								serverCmd.m_sendActualStateArgs.m_actualStateQ[1] = tr.getOrigin()[1];
-								serverCmd.m_sendActualStateArgs.m_actualStateQ[2] = tr.getOrigin()[2];
-
-								//base orientation, quaternion x,y,z,w, in world space, carthesian
-								serverCmd.m_sendActualStateArgs.m_actualStateQ[3] = tr.getRotation()[0]; 
-								serverCmd.m_sendActualStateArgs.m_actualStateQ[4] = tr.getRotation()[1];
-								serverCmd.m_sendActualStateArgs.m_actualStateQ[5] = tr.getRotation()[2];
-								serverCmd.m_sendActualStateArgs.m_actualStateQ[6] = tr.getRotation()[3];
-								totalDegreeOfFreedomQ +=7;//pos + quaternion
-
-								//base linear velocity (in world space, carthesian)
-								serverCmd.m_sendActualStateArgs.m_actualStateQdot[0] = mb->getBaseVel()[0];
-								serverCmd.m_sendActualStateArgs.m_actualStateQdot[1] = mb->getBaseVel()[1];
-								serverCmd.m_sendActualStateArgs.m_actualStateQdot[2] = mb->getBaseVel()[2];
-	
-								//base angular velocity (in world space, carthesian)
-								serverCmd.m_sendActualStateArgs.m_actualStateQdot[3] = mb->getBaseOmega()[0];
-								serverCmd.m_sendActualStateArgs.m_actualStateQdot[4] = mb->getBaseOmega()[1];
-								serverCmd.m_sendActualStateArgs.m_actualStateQdot[5] = mb->getBaseOmega()[2];
-								totalDegreeOfFreedomU += 6;//3 linear and 3 angular DOF
-							}
-							for (int l=0;l<mb->getNumLinks();l++)
-							{
-								for (int d=0;d<mb->getLink(l).m_posVarCount;d++)
-								{
-									serverCmd.m_sendActualStateArgs.m_actualStateQ[totalDegreeOfFreedomQ++] = mb->getJointPosMultiDof(l)[d];
-								}
-								for (int d=0;d<mb->getLink(l).m_dofCount;d++)
-								{
-									serverCmd.m_sendActualStateArgs.m_actualStateQdot[totalDegreeOfFreedomU++] = mb->getJointVelMultiDof(l)[d];
-								}
-                                
-                                if (0 == mb->getLink(l).m_jointFeedback)
-                                {
-                                    for (int d=0;d<6;d++)
-                                    {
-                                        serverCmd.m_sendActualStateArgs.m_jointReactionForces[l*6+d]=0;
-                                    }
-                                } else
-                                {
-                                    btVector3 sensedForce = mb->getLink(l).m_jointFeedback->m_reactionForces.getLinear();
-                                    btVector3 sensedTorque = mb->getLink(l).m_jointFeedback->m_reactionForces.getAngular();
-                                    
-                                    serverCmd.m_sendActualStateArgs.m_jointReactionForces[l*6+0] = sensedForce[0];
-                                    serverCmd.m_sendActualStateArgs.m_jointReactionForces[l*6+1] = sensedForce[1];
-                                    serverCmd.m_sendActualStateArgs.m_jointReactionForces[l*6+2] = sensedForce[2];
-                                    
-                                    serverCmd.m_sendActualStateArgs.m_jointReactionForces[l*6+3] = sensedTorque[0];
-                                    serverCmd.m_sendActualStateArgs.m_jointReactionForces[l*6+4] = sensedTorque[1];
-                                    serverCmd.m_sendActualStateArgs.m_jointReactionForces[l*6+5] = sensedTorque[2];
-                                }
-							}
-
-							serverCmd.m_sendActualStateArgs.m_numDegreeOfFreedomQ = totalDegreeOfFreedomQ;
-							serverCmd.m_sendActualStateArgs.m_numDegreeOfFreedomU = totalDegreeOfFreedomU;
-							
-							hasStatus = true;
-							
-						} else
-						{
-							if (body && body->m_rigidBody)
-							{
-								btRigidBody* rb = body->m_rigidBody;
-								SharedMemoryStatus& serverCmd = serverStatusOut;
 								serverCmd.m_type = CMD_ACTUAL_STATE_UPDATE_COMPLETED;
-
 								serverCmd.m_sendActualStateArgs.m_bodyUniqueId = bodyUniqueId;
-								int totalDegreeOfFreedomQ = 0;
-								int totalDegreeOfFreedomU = 0;
-
-								btTransform tr = rb->getWorldTransform();
-								//base position in world space, carthesian
-								serverCmd.m_sendActualStateArgs.m_actualStateQ[0] = tr.getOrigin()[0];
-								serverCmd.m_sendActualStateArgs.m_actualStateQ[1] = tr.getOrigin()[1];
-								serverCmd.m_sendActualStateArgs.m_actualStateQ[2] = tr.getOrigin()[2];
-
-								//base orientation, quaternion x,y,z,w, in world space, carthesian
-								serverCmd.m_sendActualStateArgs.m_actualStateQ[3] = tr.getRotation()[0]; 
-								serverCmd.m_sendActualStateArgs.m_actualStateQ[4] = tr.getRotation()[1];
-								serverCmd.m_sendActualStateArgs.m_actualStateQ[5] = tr.getRotation()[2];
-								serverCmd.m_sendActualStateArgs.m_actualStateQ[6] = tr.getRotation()[3];
-								totalDegreeOfFreedomQ +=7;//pos + quaternion
-
-								//base linear velocity (in world space, carthesian)
-								serverCmd.m_sendActualStateArgs.m_actualStateQdot[0] = rb->getLinearVelocity()[0];
-								serverCmd.m_sendActualStateArgs.m_actualStateQdot[1] = rb->getLinearVelocity()[1];
-								serverCmd.m_sendActualStateArgs.m_actualStateQdot[2] = rb->getLinearVelocity()[2];
-	
-								//base angular velocity (in world space, carthesian)
-								serverCmd.m_sendActualStateArgs.m_actualStateQdot[3] = rb->getAngularVelocity()[0];
-								serverCmd.m_sendActualStateArgs.m_actualStateQdot[4] = rb->getAngularVelocity()[1];
-								serverCmd.m_sendActualStateArgs.m_actualStateQdot[5] = rb->getAngularVelocity()[2];
-								totalDegreeOfFreedomU += 6;//3 linear and 3 angular DOF
-
-								serverCmd.m_sendActualStateArgs.m_numDegreeOfFreedomQ = totalDegreeOfFreedomQ;
-								serverCmd.m_sendActualStateArgs.m_numDegreeOfFreedomU = totalDegreeOfFreedomU;
-
-								hasStatus = true;
+								writeBodyState(body, serverCmd.m_sendActualStateArgs.m_rootLocalInertialFrame,
+									serverCmd.m_sendActualStateArgs.m_actualStateQ, serverCmd.m_sendActualStateArgs.m_actualStateQdot,
+									serverCmd.m_sendActualStateArgs.m_jointReactionForces);
+								serverCmd.m_sendActualStateArgs.m_numDegreeOfFreedomQ = numDegreeOfFreedomQ;
+								serverCmd.m_sendActualStateArgs.m_numDegreeOfFreedomU = numDegreeOfFreedomU;
 							} else
 							{
-								b3Warning("Request state but no multibody or rigid body available");
-								SharedMemoryStatus& serverCmd = serverStatusOut;
+								b3Warning("Request state: body has more than %d degrees of freedom, use the state region instead", MAX_DEGREE_OF_FREEDOM);
 								serverCmd.m_type = CMD_ACTUAL_STATE_UPDATE_FAILED;
-								hasStatus = true;
 							}
+						} else
+						{
+							b3Warning("Request state but no multibody or rigid body available");
+							serverCmd.m_type = CMD_ACTUAL_STATE_UPDATE_FAILED;
 						}
+						hasStatus = true;
 
 						break;
 					}
                 case CMD_STEP_FORWARD_SIMULATION:
                 {
+					m_data->m_stateBufferDirty = true;
                    
 					if (m_data->m_verboseOutput)
 					{
@@ -1377,6 +1472,7 @@ bool PhysicsServerCommandProcessor::processCommand(const struct SharedMemoryComm
 				};
 				case CMD_INIT_POSE:
 				{
+					m_data->m_stateBufferDirty = true;
 					if (m_data->m_verboseOutput)
 					{
 						b3Printf("Server Init Pose not implemented yet");
@@ -1431,6 +1527,7 @@ bool PhysicsServerCommandProcessor::processCommand(const struct SharedMemoryComm
 
                 case CMD_RESET_SIMULATION:
                 {
+					m_data->m_stateBufferDirty = true;
 					//clean up all data
 					if (m_data && m_data->m_guiHelper && m_data->m_guiHelper->getRenderInterface())
                     {
@@ -1450,6 +1547,7 @@ bool PhysicsServerCommandProcessor::processCommand(const struct SharedMemoryComm
 				case CMD_CREATE_RIGID_BODY:
 				case CMD_CREATE_BOX_COLLISION_SHAPE:
 					{
+                        m_data->m_stateBufferDirty = true;
                         btVector3 halfExtents(1,1,1);
                         if (clientCmd.m_updateFlags & BOX_SHAPE_HAS_HALF_EXTENTS)
                         {
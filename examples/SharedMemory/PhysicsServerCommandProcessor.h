@@ -35,9 +35,21 @@ public:
 
 	virtual bool processCommand(const struct SharedMemoryCommand& clientCmd, struct SharedMemoryStatus& serverStatusOut, char* bufferServerToClient, int bufferSizeInBytes );
 
+	///returns true if the actual state of the bodies changed since the last writeStateBuffer, for example after a step
+	bool isStateBufferDirty() const;
+	///write the actual state of all bodies, using the layout of SharedMemoryStateRegion.h. Returns the number of bytes
+	///needed, the buffer is only written if it is large enough.
+	int writeStateBuffer(char* buffer, int bufferSizeInBytes);
+	///write the actual Q followed by Qdot of a body, as used for the observations of PhysicsMultiEnvironment.
+	///Returns the number of values written, or -1 if the body doesn't exist or has more than maxNumValues values
+	int writeBodyObservation(int bodyUniqueId, double* observation, int maxNumValues) const;
+
 	virtual void renderScene();
 	virtual void   physicsDebugDraw(int debugDrawFlags);
 	virtual void setGuiHelper(struct GUIHelperInterface* guiHelper);
+	///share the parsed URDF files and mesh collision shapes with other command processors. The cache is not owned and
+	///has to outlive this command processor, 0 restores the cache owned by this command processor
+	void setImportCache(class BulletURDFImportCache* importCache);
 	
 	//@todo(erwincoumans) Should we have shared memory commands for picking objects?
 	///The pickBody method will try to pick the first body along a ray, return true if succeeds, false otherwise
@@ -199,6 +199,12 @@ void	PhysicsServerExample::stepSimulation(float deltaTime)
 		while (rtc.getTimeMilliseconds()<endTime)
 		{
 			m_physicsServer.processClientCommands();
+			//sleep until a client submits commands, instead of polling the shared memory
+			int remainingMicroSeconds = int((endTime-rtc.getTimeMilliseconds())*btScalar(1000));
+			if (remainingMicroSeconds>0)
+			{
+				m_physicsServer.waitForClientCommands(remainingMicroSeconds);
+			}
 		}
 	}
 }
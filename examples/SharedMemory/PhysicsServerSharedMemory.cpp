@@ -11,6 +11,8 @@
 #include "Bullet3Common/b3Logging.h"
 #include "../CommonInterfaces/CommonGUIHelperInterface.h"
 #include "SharedMemoryBlock.h"
+#include "SharedMemorySync.h"
+#include "SharedMemoryStateRegion.h"
 
 #include "PhysicsServerCommandProcessor.h"
 
@@ -28,6 +30,13 @@ struct PhysicsServerSharedMemoryInternalData
 	bool m_isConnected;
 	bool m_verboseOutput;
 	PhysicsServerCommandProcessor* m_commandProcessor;
+
+	//the state region uses its own shared memory segment, because it grows with the number of bodies
+	SharedMemoryInterface* m_stateRegionMemory;
+	SharedMemoryStateRegion* m_stateRegion;
+	int m_stateRegionKey;
+	int m_stateRegionSize;
+	int m_stateRegionGeneration;
 	
 	PhysicsServerSharedMemoryInternalData()
 		:m_sharedMemory(0),
@@ -35,15 +44,79 @@ struct PhysicsServerSharedMemoryInternalData
 		m_sharedMemoryKey(SHARED_MEMORY_KEY),
 		m_isConnected(false),
 		m_verboseOutput(false),
-		m_commandProcessor(0)
+		m_commandProcessor(0),
+		m_stateRegionMemory(0),
+		m_stateRegion(0),
+		m_stateRegionKey(0),
+		m_stateRegionSize(0),
+		m_stateRegionGeneration(0)
 		
 	{
     
 	}
 
-	SharedMemoryStatus& createServerStatus(int statusType, int sequenceNumber, int timeStamp)
+	void releaseStateRegion()
+	{
+		if (m_stateRegion)
+		{
+			m_stateRegionMemory->releaseSharedMemory(m_stateRegionKey,m_stateRegionSize);
+			m_stateRegion = 0;
+		}
+	}
+
+	//create a state region with buffers of at least minBufferCapacity bytes, replacing the previous region.
+	//Each generation uses a new key, clients that are still attached to the previous region keep a valid mapping.
+	bool createStateRegion(int minBufferCapacity)
 	{
-		SharedMemoryStatus& serverCmd =m_testBlock1->m_serverCommands[0];
+		releaseStateRegion();
+		int bufferCapacity = SHARED_MEMORY_STATE_REGION_MIN_BUFFER_SIZE;
+		while (bufferCapacity < minBufferCapacity)
+		{
+			bufferCapacity *= 2;
+		}
+		int generation = m_stateRegionGeneration+1;
+		m_stateRegionKey = m_sharedMemoryKey + SHARED_MEMORY_STATE_REGION_KEY_OFFSET + generation;
+		m_stateRegionSize = GetSharedMemoryStateRegionSize(bufferCapacity);
+		m_stateRegion = (SharedMemoryStateRegion*)m_stateRegionMemory->allocateSharedMemory(m_stateRegionKey,m_stateRegionSize,true);
+		if (!m_stateRegion)
+		{
+			b3Error("Cannot create the shared memory state region of %d bytes", m_stateRegionSize);
+			return false;
+		}
+		m_stateRegionGeneration = generation;
+		InitSharedMemoryStateRegion(m_stateRegion,generation,bufferCapacity);
+
+		//clients check the generation before and after reading the key and size
+		m_testBlock1->m_stateRegionKey = m_stateRegionKey;
+		m_testBlock1->m_stateRegionSize = m_stateRegionSize;
+		b3SharedMemoryStore(&m_testBlock1->m_stateRegionGeneration,generation);
+		return true;
+	}
+
+	//write the actual state into the next buffer of the state region, if it changed
+	void publishState()
+	{
+		if (!m_commandProcessor->isStateBufferDirty())
+		{
+			return;
+		}
+		int sizeInBytes = m_commandProcessor->writeStateBuffer(0,0);
+		if (!m_stateRegion || sizeInBytes > m_stateRegion->m_bufferCapacity)
+		{
+			if (!createStateRegion(sizeInBytes))
+			{
+				return;
+			}
+		}
+		int sequence = m_stateRegion->m_sequence+1;
+		b3SharedMemoryStore(&m_stateRegion->m_writeSequence,sequence);
+		m_commandProcessor->writeStateBuffer(GetSharedMemoryStateBuffer(m_stateRegion,sequence),m_stateRegion->m_bufferCapacity);
+		b3SharedMemoryStore(&m_stateRegion->m_sequence,sequence);
+	}
+
+	SharedMemoryStatus& createServerStatus(int slot, int statusType, int sequenceNumber, int timeStamp)
+	{
+		SharedMemoryStatus& serverCmd =m_testBlock1->m_serverCommands[slot];
 		serverCmd .m_type = statusType;
 		serverCmd.m_sequenceNumber = sequenceNumber;
 		serverCmd.m_timeStamp = timeStamp;
@@ -51,7 +124,33 @@ struct PhysicsServerSharedMemoryInternalData
 	}
 	void submitServerStatus(SharedMemoryStatus& status)
 	{
-		m_testBlock1->m_numServerCommands++;
+		//the status has to be visible before the counter
+		b3SharedMemoryBarrier();
+		b3SharedMemoryAtomicAdd(&m_testBlock1->m_numServerCommands,1);
+	}
+
+	//a client can only read the streamed data of a status if the next commands don't overwrite it
+	static bool statusUsesStreamData(const SharedMemoryStatus& status)
+	{
+		return (status.m_type==CMD_DEBUG_LINES_COMPLETED) ||
+			((status.m_type==CMD_URDF_LOADING_COMPLETED) && (status.m_dataStreamArguments.m_streamChunkLength>0));
+	}
+
+	bool isStreamDataInUse() const
+	{
+		int streamSequence = b3SharedMemoryLoad(&m_testBlock1->m_streamStatusSequence);
+		if (streamSequence==0)
+			return false;
+		int slot = (unsigned int)(streamSequence-1)%SHARED_MEMORY_MAX_COMMANDS;
+		//once the slot is reused, the consumed sequence moves beyond the stream status
+		return b3SharedMemoryTicketDiff(b3SharedMemoryLoad(&m_testBlock1->m_statusConsumedSequence[slot]),streamSequence)<0;
+	}
+
+	bool hasClientCommand() const
+	{
+		int ticket = m_testBlock1->m_numProcessedClientCommands;
+		int slot = (unsigned int)ticket%SHARED_MEMORY_MAX_COMMANDS;
+		return b3SharedMemoryLoad(&m_testBlock1->m_commandSequence[slot])==ticket+1;
 	}
 
 };
@@ -63,8 +162,10 @@ PhysicsServerSharedMemory::PhysicsServerSharedMemory()
 
 #ifdef _WIN32
 	m_data->m_sharedMemory = new Win32SharedMemoryServer();
+	m_data->m_stateRegionMemory = new Win32SharedMemoryServer();
 #else
 	m_data->m_sharedMemory = new PosixSharedMemory();
+	m_data->m_stateRegionMemory = new PosixSharedMemory();
 #endif
 	
 	m_data->m_commandProcessor = new PhysicsServerCommandProcessor;
@@ -75,6 +176,8 @@ PhysicsServerSharedMemory::PhysicsServerSharedMemory()
 
 PhysicsServerSharedMemory::~PhysicsServerSharedMemory()
 {
+	m_data->releaseStateRegion();
+	delete m_data->m_stateRegionMemory;
 	m_data->m_commandProcessor->deleteDynamicsWorld();
 	delete m_data->m_commandProcessor;
 	delete m_data;
@@ -168,6 +271,7 @@ void PhysicsServerSharedMemory::disconnectSharedMemory(bool deInitializeSharedMe
 			}
 		}
 		btAssert(m_data->m_sharedMemory);
+		m_data->releaseStateRegion();
 		m_data->m_sharedMemory->releaseSharedMemory(m_data->m_sharedMemoryKey, SHARED_MEMORY_SIZE);
 	}
 	if (m_data->m_sharedMemory)
@@ -200,6 +304,7 @@ void PhysicsServerSharedMemory::releaseSharedMemory()
 			b3Printf("magic id = %d\n",m_data->m_testBlock1->m_magicId);
 		}
         btAssert(m_data->m_sharedMemory);
+		m_data->releaseStateRegion();
 		m_data->m_sharedMemory->releaseSharedMemory(	m_data->m_sharedMemoryKey
 , SHARED_MEMORY_SIZE);
     }
@@ -241,30 +346,60 @@ void PhysicsServerSharedMemory::processClientCommands()
 			}
 		}
 #endif
-        ///we ignore overflow of integer for now
-        if (m_data->m_testBlock1->m_numClientCommands> m_data->m_testBlock1->m_numProcessedClientCommands)
-        {
-           
-
-            //until we implement a proper ring buffer, we assume always maximum of 1 outstanding commands
-            btAssert(m_data->m_testBlock1->m_numClientCommands==m_data->m_testBlock1->m_numProcessedClientCommands+1);
-            
-			const SharedMemoryCommand& clientCmd =m_data->m_testBlock1->m_clientCommands[0];
+		//process all published commands in ticket order, and wake up the clients once for the whole batch
+		int numProcessed = 0;
+		while (m_data->hasClientCommand() && !m_data->isStreamDataInUse())
+		{
+			int ticket = m_data->m_testBlock1->m_numProcessedClientCommands;
+			int slot = (unsigned int)ticket%SHARED_MEMORY_MAX_COMMANDS;
+			const SharedMemoryCommand& clientCmd =m_data->m_testBlock1->m_clientCommands[slot];
 
 			m_data->m_testBlock1->m_numProcessedClientCommands++;
 			//todo, timeStamp 
 			int timeStamp = 0;
-			SharedMemoryStatus& serverStatusOut = m_data->createServerStatus(CMD_BULLET_DATA_STREAM_RECEIVED_COMPLETED,clientCmd.m_sequenceNumber,timeStamp);
+			SharedMemoryStatus& serverStatusOut = m_data->createServerStatus(slot,CMD_BULLET_DATA_STREAM_RECEIVED_COMPLETED,clientCmd.m_sequenceNumber,timeStamp);
 			bool hasStatus = m_data->m_commandProcessor->processCommand(clientCmd, serverStatusOut,&m_data->m_testBlock1->m_bulletStreamDataServerToClientRefactor[0],SHARED_MEMORY_MAX_STREAM_CHUNK_SIZE);
-			if (hasStatus)
+			if (!hasStatus)
+			{
+				//the slot still needs a status, so the client can release it
+				serverStatusOut.m_type = CMD_WAITING_FOR_CLIENT_COMMAND;
+			}
+			//the state has to be visible before the status, for example the new state after a step
+			m_data->publishState();
+			if (m_data->statusUsesStreamData(serverStatusOut))
 			{
-				m_data->submitServerStatus(serverStatusOut);
+				m_data->m_testBlock1->m_streamStatusSequence = ticket+1;
 			}
-			       
-        }
+			m_data->submitServerStatus(serverStatusOut);
+			numProcessed++;
+		}
+		if (numProcessed && b3SharedMemoryLoad(&m_data->m_testBlock1->m_numClientWaiters))
+		{
+			b3SharedMemoryWake(&m_data->m_testBlock1->m_numServerCommands);
+		}
     }
 }
 
+bool PhysicsServerSharedMemory::waitForClientCommands(int timeOutInMicroSeconds)
+{
+	if (!m_data->m_isConnected || !m_data->m_testBlock1)
+	{
+		return false;
+	}
+	SharedMemoryBlock* block = m_data->m_testBlock1;
+	//register as waiter before checking, so a client that publishes a command after the check will wake us up
+	b3SharedMemoryAtomicAdd(&block->m_numServerWaiters,1);
+	int signal = b3SharedMemoryLoad(&block->m_commandSignal);
+	bool hasCommand = m_data->hasClientCommand() && !m_data->isStreamDataInUse();
+	if (!hasCommand)
+	{
+		b3SharedMemoryWait(&block->m_commandSignal,signal,timeOutInMicroSeconds);
+		hasCommand = m_data->hasClientCommand();
+	}
+	b3SharedMemoryAtomicAdd(&block->m_numServerWaiters,-1);
+	return hasCommand;
+}
+
 void PhysicsServerSharedMemory::renderScene()
 {
 	m_data->m_commandProcessor->renderScene();
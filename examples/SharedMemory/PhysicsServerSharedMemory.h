@@ -26,6 +26,8 @@ public:
 
 	virtual void processClientCommands();
 
+	virtual bool waitForClientCommands(int timeOutInMicroSeconds);
+
 	//bool	supportsJointMotor(class btMultiBody* body, int linkIndex);
 
 	//@todo(erwincoumans) Should we have shared memory commands for picking objects?
@@ -1,24 +1,56 @@
 #ifndef SHARED_MEMORY_BLOCK_H
 #define SHARED_MEMORY_BLOCK_H
 
-#define SHARED_MEMORY_MAGIC_NUMBER 64738
-#define SHARED_MEMORY_MAX_COMMANDS 4
+#define SHARED_MEMORY_MAGIC_NUMBER 64740
+#define SHARED_MEMORY_MAX_COMMANDS 32
 #define SHARED_MEMORY_MAX_STREAM_CHUNK_SIZE (256*1024)
 
 #include "SharedMemoryCommands.h"
 
+///The client commands and server statuses form a ring buffer. Each submitted command gets a ticket, and the command
+///with ticket t and its status both use slot t%SHARED_MEMORY_MAX_COMMANDS. Several clients can submit commands
+///without locks: they reserve tickets with a compare and swap on m_numClientCommands, copy the commands into
+///their slots and publish them in m_commandSequence. The server processes the commands in ticket order, and the
+///status of ticket t is available once m_numServerCommands is larger than t.
+///A slot is reused when the client consumed the status of the previous ticket in that slot (m_statusConsumedSequence).
+///Tickets are only reserved once all their slots are free, so a client never holds a ticket while it waits for another client.
+///The counters are also used as futex words, so the server and clients can sleep instead of polling (see SharedMemorySync.h).
 struct SharedMemoryBlock
 {
 	int m_magicId;
 	struct SharedMemoryCommand m_clientCommands[SHARED_MEMORY_MAX_COMMANDS];
 	struct SharedMemoryStatus m_serverCommands[SHARED_MEMORY_MAX_COMMANDS];
 
+	//number of reserved tickets
 	int m_numClientCommands;
+	//number of commands taken by the server
 	int m_numProcessedClientCommands;
 
+	//number of statuses written by the server, clients wait on this counter
 	int m_numServerCommands;
+	//number of statuses consumed by the clients
 	int m_numProcessedServerCommands;
 
+	//ticket+1 of the command in each slot, written after the command is copied into the slot
+	int m_commandSequence[SHARED_MEMORY_MAX_COMMANDS];
+	//ticket+1 of the last consumed status in each slot
+	int m_statusConsumedSequence[SHARED_MEMORY_MAX_COMMANDS];
+
+	//incremented when commands are published, the server waits on this counter
+	int m_commandSignal;
+	int m_numServerWaiters;
+	int m_numClientWaiters;
+
+	//ticket+1 of the last status that returned data in m_bulletStreamDataServerToClientRefactor, 0 if none.
+	//The server doesn't process the next command before this status is consumed, so the data isn't overwritten.
+	int m_streamStatusSequence;
+
+	//shared memory key and size of the state region (see SharedMemoryStateRegion.h), the generation is incremented
+	//each time the server creates a new (larger) region. Generation 0 means there is no state region.
+	int m_stateRegionKey;
+	int m_stateRegionSize;
+	int m_stateRegionGeneration;
+
 	//m_bulletStreamDataClientToServer is a way for the client to create collision shapes, rigid bodies and constraints
 	//the Bullet data structures are more general purpose than the capabilities of a URDF file.
 	char    m_bulletStreamDataClientToServer[SHARED_MEMORY_MAX_STREAM_CHUNK_SIZE];
@@ -43,6 +75,19 @@ void     InitSharedMemoryBlock(struct SharedMemoryBlock* sharedMemoryBlock)
     sharedMemoryBlock->m_numServerCommands = 0;
     sharedMemoryBlock->m_numProcessedClientCommands=0;
     sharedMemoryBlock->m_numProcessedServerCommands=0;
+    //mark each slot as if the ticket before the first one using it is consumed
+    for (int i=0;i<SHARED_MEMORY_MAX_COMMANDS;i++)
+    {
+        sharedMemoryBlock->m_commandSequence[i] = i-SHARED_MEMORY_MAX_COMMANDS+1;
+        sharedMemoryBlock->m_statusConsumedSequence[i] = i-SHARED_MEMORY_MAX_COMMANDS+1;
+    }
+    sharedMemoryBlock->m_commandSignal = 0;
+    sharedMemoryBlock->m_numServerWaiters = 0;
+    sharedMemoryBlock->m_numClientWaiters = 0;
+    sharedMemoryBlock->m_streamStatusSequence = 0;
+    sharedMemoryBlock->m_stateRegionKey = 0;
+    sharedMemoryBlock->m_stateRegionSize = 0;
+    sharedMemoryBlock->m_stateRegionGeneration = 0;
     sharedMemoryBlock->m_magicId = SHARED_MEMORY_MAGIC_NUMBER;
 }
 
@@ -52,4 +97,3 @@ void     InitSharedMemoryBlock(struct SharedMemoryBlock* sharedMemoryBlock)
 
 
 #endif //SHARED_MEMORY_BLOCK_H
-
@@ -94,6 +94,19 @@ struct b3JointSensorState
   double m_jointForceTorque[6];  /* note to roboticists: this is NOT the motor torque/force, but the spatial reaction force vector at joint */
 };
 
+///view of the actual state of a body in the state region, see b3GetStateBody
+struct b3BodyState
+{
+	int m_bodyUniqueId;
+	int m_numDegreeOfFreedomQ;
+	int m_numDegreeOfFreedomU;
+	int m_numLinks;
+	const double* m_rootLocalInertialFrame;
+	const double* m_actualStateQ;
+	const double* m_actualStateQdot;
+	const double* m_jointReactionForces;
+};
+
 struct b3DebugLines
 {
     int m_numDebugLines;
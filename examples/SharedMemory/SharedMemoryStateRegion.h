@@ -0,0 +1,90 @@
+#ifndef SHARED_MEMORY_STATE_REGION_H
+#define SHARED_MEMORY_STATE_REGION_H
+
+#define SHARED_MEMORY_STATE_REGION_MAGIC_NUMBER 84621
+//the state region uses its own shared memory segment, with key = shared memory key + SHARED_MEMORY_STATE_REGION_KEY_OFFSET
+#define SHARED_MEMORY_STATE_REGION_KEY_OFFSET 65536
+#define SHARED_MEMORY_STATE_REGION_MIN_BUFFER_SIZE (64*1024)
+
+#include "SharedMemorySync.h"
+
+///The state region holds the actual state (Q, Qdot, joint reaction forces) of all bodies, so a client can read
+///the state of any number of bodies and degrees of freedom without a CMD_REQUEST_ACTUAL_STATE round trip.
+///The server writes the state after each command that changes it (for example each step). The region is double buffered:
+///state with sequence number s is in buffer s&1. The server sets m_writeSequence before it writes a buffer and m_sequence
+///once the buffer is complete, so a reader that started with sequence s can detect that the buffer was overwritten
+///by checking m_writeSequence-s<=1 after reading (see IsSharedMemoryStateValid).
+///When the state doesn't fit anymore, the server creates a larger segment and increments m_stateRegionGeneration
+///in the SharedMemoryBlock, and the clients attach to the new segment.
+struct SharedMemoryStateRegion
+{
+	int m_magicId;
+	int m_generation;
+	//size in bytes of each of the two buffers that follow this header
+	int m_bufferCapacity;
+	int m_writeSequence;
+	int m_sequence;
+	int m_unused[3];
+};
+
+///each buffer starts with a SharedMemoryStateHeader, followed by m_numBodies SharedMemoryBodyState entries and the state data
+struct SharedMemoryStateHeader
+{
+	int m_numBodies;
+	int m_sizeInBytes;
+};
+
+///all offsets are in bytes, relative to the start of the buffer, and point to arrays of doubles
+struct SharedMemoryBodyState
+{
+	int m_bodyUniqueId;
+	int m_numDegreeOfFreedomQ;
+	int m_numDegreeOfFreedomU;
+	int m_numLinks;
+	//7 doubles: position and orientation (quaternion x,y,z,w)
+	int m_rootLocalInertialFrameOffset;
+	//m_numDegreeOfFreedomQ doubles, using the same layout as SendActualStateArgs
+	int m_actualStateQOffset;
+	//m_numDegreeOfFreedomU doubles
+	int m_actualStateQdotOffset;
+	//6 doubles per link: force[x,y,z] and torque[x,y,z]
+	int m_jointReactionForcesOffset;
+};
+
+//http://stackoverflow.com/questions/24736304/unable-to-use-inline-in-declaration-get-error-c2054
+#ifdef _WIN32
+#define B3_STATE_REGION_INLINE __inline
+#else
+#define B3_STATE_REGION_INLINE inline
+#endif
+
+B3_STATE_REGION_INLINE int GetSharedMemoryStateRegionSize(int bufferCapacity)
+{
+	return sizeof(struct SharedMemoryStateRegion)+2*bufferCapacity;
+}
+
+B3_STATE_REGION_INLINE void InitSharedMemoryStateRegion(struct SharedMemoryStateRegion* region, int generation, int bufferCapacity)
+{
+	region->m_generation = generation;
+	region->m_bufferCapacity = bufferCapacity;
+	region->m_writeSequence = 0;
+	region->m_sequence = 0;
+	region->m_magicId = SHARED_MEMORY_STATE_REGION_MAGIC_NUMBER;
+}
+
+///the buffer that holds (or will hold) the state with the given sequence number
+B3_STATE_REGION_INLINE char* GetSharedMemoryStateBuffer(struct SharedMemoryStateRegion* region, int sequence)
+{
+	return (char*)(region+1) + (sequence&1)*region->m_bufferCapacity;
+}
+
+///call after reading the state with this sequence number, returns false if the server overwrote it meanwhile
+B3_STATE_REGION_INLINE bool IsSharedMemoryStateValid(const struct SharedMemoryStateRegion* region, int sequence)
+{
+	//the reads of the state have to complete before m_writeSequence is read
+	b3SharedMemoryBarrier();
+	int writeSequence = b3SharedMemoryLoad(&region->m_writeSequence);
+	return (unsigned int)b3SharedMemoryTicketDiff(writeSequence,sequence) <= 1;
+}
+
+#endif //SHARED_MEMORY_STATE_REGION_H
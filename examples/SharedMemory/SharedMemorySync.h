@@ -0,0 +1,135 @@
+#ifndef SHARED_MEMORY_SYNC_H
+#define SHARED_MEMORY_SYNC_H
+
+///Atomic counters and wait/wake primitives for the command ring buffer in SharedMemoryBlock.
+///All functions operate on 32 bit integers inside the shared memory block, so they work between processes.
+///On Linux, b3SharedMemoryWait/b3SharedMemoryWake use a (non-private) futex, so a waiting client or server
+///doesn't use any cpu. Other platforms fall back to polling with a short sleep.
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <sched.h>
+#ifdef __linux__
+#include <errno.h>
+#include <time.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+#endif
+
+//http://stackoverflow.com/questions/24736304/unable-to-use-inline-in-declaration-get-error-c2054
+#ifdef _WIN32
+#define B3_SHARED_MEMORY_INLINE __inline
+#else
+#define B3_SHARED_MEMORY_INLINE inline
+#endif
+
+///atomically adds value to *counter and returns the previous value, with a full memory barrier
+B3_SHARED_MEMORY_INLINE int b3SharedMemoryAtomicAdd(volatile int* counter, int value)
+{
+#ifdef _WIN32
+	return (int)InterlockedExchangeAdd((volatile LONG*)counter, (LONG)value);
+#else
+	return __sync_fetch_and_add(counter, value);
+#endif
+}
+
+///atomically replaces *counter by desired if it is equal to expected, returns the previous value, with a full memory barrier
+B3_SHARED_MEMORY_INLINE int b3SharedMemoryCompareAndSwap(volatile int* counter, int expected, int desired)
+{
+#ifdef _WIN32
+	return (int)InterlockedCompareExchange((volatile LONG*)counter, (LONG)desired, (LONG)expected);
+#else
+	return __sync_val_compare_and_swap(counter, expected, desired);
+#endif
+}
+
+B3_SHARED_MEMORY_INLINE void b3SharedMemoryBarrier()
+{
+#ifdef _WIN32
+	MemoryBarrier();
+#else
+	__sync_synchronize();
+#endif
+}
+
+///read a counter written by another process, later reads are not moved before it
+B3_SHARED_MEMORY_INLINE int b3SharedMemoryLoad(const volatile int* counter)
+{
+	int value = *counter;
+	b3SharedMemoryBarrier();
+	return value;
+}
+
+///publish a counter, earlier writes (for example the command or status in a slot) become visible first
+B3_SHARED_MEMORY_INLINE void b3SharedMemoryStore(volatile int* counter, int value)
+{
+	b3SharedMemoryBarrier();
+	*counter = value;
+	b3SharedMemoryBarrier();
+}
+
+///difference of two ticket counters, that stays correct when the counters overflow
+B3_SHARED_MEMORY_INLINE int b3SharedMemoryTicketDiff(int a, int b)
+{
+	return (int)((unsigned int)a - (unsigned int)b);
+}
+
+B3_SHARED_MEMORY_INLINE void b3SharedMemoryYield()
+{
+#ifdef _WIN32
+	SwitchToThread();
+#else
+	sched_yield();
+#endif
+}
+
+///block while *address is equal to expectedValue, at most timeOutInMicroSeconds.
+///Returns false on time out. It can return true spuriously, so callers have to check their condition again.
+B3_SHARED_MEMORY_INLINE bool b3SharedMemoryWait(volatile int* address, int expectedValue, int timeOutInMicroSeconds)
+{
+#if defined(__linux__)
+	struct timespec timeOut;
+	timeOut.tv_sec = timeOutInMicroSeconds / 1000000;
+	timeOut.tv_nsec = (timeOutInMicroSeconds % 1000000) * 1000;
+	if (syscall(SYS_futex, (int*)address, FUTEX_WAIT, expectedValue, &timeOut, 0, 0) != 0)
+	{
+		return errno != ETIMEDOUT;
+	}
+	return true;
+#else
+#ifdef _WIN32
+	const int pollInterval = 1000;
+#else
+	const int pollInterval = 50;
+#endif
+	for (int waited = 0; waited < timeOutInMicroSeconds; waited += pollInterval)
+	{
+		if (*address != expectedValue)
+		{
+			return true;
+		}
+#ifdef _WIN32
+		Sleep(pollInterval/1000);
+#else
+		usleep(pollInterval);
+#endif
+	}
+	return *address != expectedValue;
+#endif
+}
+
+///wake up all processes and threads blocked in b3SharedMemoryWait on address
+B3_SHARED_MEMORY_INLINE void b3SharedMemoryWake(volatile int* address)
+{
+#if defined(__linux__)
+	syscall(SYS_futex, (int*)address, FUTEX_WAKE, 0x7fffffff, 0, 0, 0);
+#else
+	(void)address;
+#endif
+}
+
+#endif //SHARED_MEMORY_SYNC_H
@@ -33,6 +33,10 @@ files {
 	"PhysicsDirect.h",
 	"PhysicsDirectC_API.cpp",
 	"PhysicsDirectC_API.h",
+	"PhysicsMultiEnvironment.cpp",
+	"PhysicsMultiEnvironment.h",
+	"PhysicsMultiEnvironmentC_API.cpp",
+	"PhysicsMultiEnvironmentC_API.h",
 	"PhysicsLoopBack.cpp",
 	"PhysicsLoopBack.h",
 	"PhysicsLoopBackC_API.cpp",
@@ -45,6 +49,8 @@ files {
 	"../Importers/ImportURDFDemo/MyMultiBodyCreator.h",
 	"../Importers/ImportURDFDemo/BulletUrdfImporter.cpp",
 	"../Importers/ImportURDFDemo/BulletUrdfImporter.h",
+	"../Importers/ImportURDFDemo/BulletUrdfImportCache.cpp",
+	"../Importers/ImportURDFDemo/BulletUrdfImportCache.h",
 	"../Importers/ImportURDFDemo/UrdfParser.cpp",
 	"../Importers/ImportURDFDemo/BulletUrdfImporter.cpp",
 	"../Importers/ImportURDFDemo/BulletUrdfImporter.h",
@@ -63,6 +69,8 @@ files {
 	"../Importers/ImportObjDemo/LoadMeshFromObj.cpp",
 	"../Importers/ImportSTLDemo/ImportSTLSetup.h",
 	"../Importers/ImportSTLDemo/LoadMeshFromSTL.h",
+	"../Importers/ImportMeshUtility/LoadTriangleMesh.cpp",
+	"../Importers/ImportMeshUtility/LoadTriangleMesh.h",
 	"../Importers/ImportColladaDemo/LoadMeshFromCollada.cpp",
 	"../Importers/ImportColladaDemo/ColladaGraphicsInstance.h",
 	"../ThirdPartyLibs/Wavefront/tiny_obj_loader.cpp",	
@@ -43,6 +43,13 @@ struct	btBroadphaseRayCallback : public btBroadphaseAabbCallback
 	virtual ~btBroadphaseRayCallback() {}
 };
 
+///btBroadphaseAabbBatchCallback receives the overlaps of btBroadphaseInterface::aabbTestBatch, tagged with the index of the query aabb
+struct	btBroadphaseAabbBatchCallback
+{
+	virtual ~btBroadphaseAabbBatchCallback() {}
+	virtual bool	process(int aabbIndex, const btBroadphaseProxy* proxy) = 0;
+};
+
 #include "LinearMath/btVector3.h"
 
 ///The btBroadphaseInterface class provides an interface to detect aabb-overlapping object pairs.
@@ -62,6 +69,32 @@ public:
 
 	virtual void	aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback) = 0;
 
+	///aabbTestBatch reports the proxies overlapping each of the numAabbs query boxes.
+	///The default implementation calls aabbTest for every box, broadphases with a tree can test all boxes in a single pass.
+	virtual void	aabbTestBatch(const btVector3* aabbMins, const btVector3* aabbMaxs, int numAabbs, btBroadphaseAabbBatchCallback& callback)
+	{
+		struct	SingleAabbCallback : public btBroadphaseAabbCallback
+		{
+			btBroadphaseAabbBatchCallback&	m_batchCallback;
+			int	m_aabbIndex;
+			SingleAabbCallback(btBroadphaseAabbBatchCallback& batchCallback)
+				:m_batchCallback(batchCallback),
+				m_aabbIndex(0)
+			{
+			}
+			virtual bool	process(const btBroadphaseProxy* proxy)
+			{
+				return m_batchCallback.process(m_aabbIndex,proxy);
+			}
+		} singleCallback(callback);
+
+		for (int i=0;i<numAabbs;i++)
+		{
+			singleCallback.m_aabbIndex = i;
+			aabbTest(aabbMins[i],aabbMaxs[i],singleCallback);
+		}
+	}
+
 	///calculateOverlappingPairs is optional: incremental algorithms (sweep and prune) might do it during the set aabb
 	virtual void	calculateOverlappingPairs(btDispatcher* dispatcher)=0;
 
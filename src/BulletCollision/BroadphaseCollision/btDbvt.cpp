@@ -56,6 +56,19 @@ static DBVT_INLINE btScalar		size(const btDbvtVolume& a)
 		edges.x()+edges.y()+edges.z());
 }
 
+//
+static btScalar					refitvolumes(btDbvtNode* node)
+{
+	if(node->isinternal())
+	{
+		const btScalar	cost=	refitvolumes(node->childs[0])+
+								refitvolumes(node->childs[1]);
+		Merge(node->childs[0]->volume,node->childs[1]->volume,node->volume);
+		return(cost+size(node->volume));
+	}
+	return(0);
+}
+
 //
 static void						getmaxdepth(const btDbvtNode* node,int depth,int& maxdepth)
 {
@@ -321,7 +334,7 @@ static btDbvtNode*			topdown(btDbvt* pdbvt,
 				const btVector3	x=leaves[i]->volume.Center()-org;
 				for(int j=0;j<3;++j)
 				{
-					++splitcount[j][btDot(x,axis[j])>0?1:0];
+					++splitcount[j][btDot(x,axis[j])<0?0:1];
 				}
 			}
 			for( i=0;i<3;++i)
@@ -553,6 +566,22 @@ bool			btDbvt::update(btDbvtNode* leaf,btDbvtVolume& volume,btScalar margin)
 	return(true);
 }
 
+//
+bool			btDbvt::refitLeaf(btDbvtNode* leaf,btDbvtVolume& volume,const btVector3& velocity,btScalar margin)
+{
+	if(leaf->volume.Contain(volume)) return(false);
+	volume.Expand(btVector3(margin,margin,margin));
+	volume.SignedExpand(velocity);
+	leaf->volume=volume;
+	return(true);
+}
+
+//
+btScalar		btDbvt::refit()
+{
+	return(m_root?refitvolumes(m_root):0);
+}
+
 //
 void			btDbvt::remove(btDbvtNode* leaf)
 {
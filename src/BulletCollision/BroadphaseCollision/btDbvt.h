@@ -280,6 +280,10 @@ struct	btDbvt
 	bool			update(btDbvtNode* leaf,btDbvtVolume& volume,const btVector3& velocity,btScalar margin);
 	bool			update(btDbvtNode* leaf,btDbvtVolume& volume,const btVector3& velocity);
 	bool			update(btDbvtNode* leaf,btDbvtVolume& volume,btScalar margin);	
+	///refitLeaf grows the leaf like update(leaf,volume,velocity,margin) but leaves the tree structure alone, call refit afterwards
+	bool			refitLeaf(btDbvtNode* leaf,btDbvtVolume& volume,const btVector3& velocity,btScalar margin);
+	///refit recomputes the internal volumes bottom-up and returns their summed cost, to decide when to optimize the tree
+	btScalar		refit();
 	void			remove(btDbvtNode* leaf);
 	void			write(IWriter* iwriter) const;
 	void			clone(btDbvt& dest,IClone* iclone=0) const;
@@ -277,6 +277,101 @@ void	btDbvtBroadphase::aabbTest(const btVector3& aabbMin,const btVector3& aabbMa
 }
 
 
+///btMortonSpread spreads the low 10 bits of x over every third bit
+static unsigned int	btMortonSpread(unsigned int x)
+{
+	x&=0x3ff;
+	x=(x|(x<<16))&0x030000FF;
+	x=(x|(x<<8))&0x0300F00F;
+	x=(x|(x<<4))&0x030C30C3;
+	x=(x|(x<<2))&0x09249249;
+	return x;
+}
+
+struct	btAabbBatchOrder
+{
+	unsigned int	m_key;
+	int	m_index;
+};
+
+class	btAabbBatchOrderSortPredicate
+{
+public:
+	bool operator() ( const btAabbBatchOrder& a, const btAabbBatchOrder& b ) const
+	{
+		return a.m_key < b.m_key;
+	}
+};
+
+void	btDbvtBroadphase::aabbTestBatch(const btVector3* aabbMins,const btVector3* aabbMaxs,int numAabbs,btBroadphaseAabbBatchCallback& aabbCallback)
+{
+	///for a handful of boxes, sorting them costs more than it saves
+	if (numAabbs<8)
+	{
+		btBroadphaseInterface::aabbTestBatch(aabbMins,aabbMaxs,numAabbs,aabbCallback);
+		return;
+	}
+
+	//visit the boxes along a Morton curve, so consecutive queries walk the same tree nodes.
+	//A temporary tree of the boxes collided with collideTT is not faster: building it costs more than the queries
+	btVector3 boundsMin=aabbMins[0];
+	btVector3 boundsMax=aabbMaxs[0];
+	for (int i=1;i<numAabbs;i++)
+	{
+		boundsMin.setMin(aabbMins[i]);
+		boundsMax.setMax(aabbMaxs[i]);
+	}
+	const btVector3 extent=boundsMax-boundsMin;
+	btVector3 scale;
+	for (int j=0;j<3;j++)
+	{
+		scale[j] = extent[j]>SIMD_EPSILON ? btScalar(1023.)/extent[j] : btScalar(0.);
+	}
+
+	btAlignedObjectArray<btAabbBatchOrder>	order;
+	order.resize(numAabbs);
+	for (int i=0;i<numAabbs;i++)
+	{
+		const btVector3 c=((aabbMins[i]+aabbMaxs[i])*btScalar(0.5)-boundsMin)*scale;
+		order[i].m_key=btMortonSpread((unsigned int)c.x())|(btMortonSpread((unsigned int)c.y())<<1)|(btMortonSpread((unsigned int)c.z())<<2);
+		order[i].m_index=i;
+	}
+	order.quickSort(btAabbBatchOrderSortPredicate());
+
+	btAlignedObjectArray<const btDbvtNode*>	stack;
+	stack.resize(btDbvt::SIMPLE_STACKSIZE);
+	for (int k=0;k<numAabbs;k++)
+	{
+		const int i=order[k].m_index;
+		const ATTRIBUTE_ALIGNED16(btDbvtVolume)	bounds=btDbvtVolume::FromMM(aabbMins[i],aabbMaxs[i]);
+		for (int set=0;set<2;set++)
+		{
+			if (!m_sets[set].m_root)
+				continue;
+			int depth=0;
+			stack[depth++]=m_sets[set].m_root;
+			while (depth)
+			{
+				const btDbvtNode* node=stack[--depth];
+				if (Intersect(node->volume,bounds))
+				{
+					if (node->isinternal())
+					{
+						if (depth+2>stack.size())
+							stack.resize(stack.size()*2);
+						stack[depth++]=node->childs[0];
+						stack[depth++]=node->childs[1];
+					} else
+					{
+						aabbCallback.process(i,(btDbvtProxy*)node->data);
+					}
+				}
+			}
+		}
+	}
+}
+
+
 
 //
 void							btDbvtBroadphase::setAabb(		btBroadphaseProxy* absproxy,
@@ -592,6 +687,31 @@ void							btDbvtBroadphase::collide(btDispatcher* dispatcher)
 	m_updates_call/=2;
 }
 
+//
+void							btDbvtBroadphase::rebuildTrees(btDbvtProxy** proxies,const btDbvtVolume* volumes,int numProxies)
+{
+	btAssert(m_sets[0].m_leaves+m_sets[1].m_leaves==numProxies);
+	for(int i=0;i<2;++i)
+	{
+		const int		lkhd=m_sets[i].m_lkhd;
+		const unsigned	opath=m_sets[i].m_opath;
+		m_sets[i].clear();
+		m_sets[i].m_leaves=0;
+		m_sets[i].m_lkhd=lkhd;
+		m_sets[i].m_opath=opath;
+	}
+	for(int i=0;i<=STAGECOUNT;++i)
+	{
+		m_stageRoots[i]=0;
+	}
+	for(int i=0;i<numProxies;++i)
+	{
+		btDbvtProxy*	proxy=proxies[i];
+		proxy->leaf=m_sets[proxy->stage==STAGECOUNT?1:0].insert(volumes[i],proxy);
+		listappend(proxy,m_stageRoots[proxy->stage]);
+	}
+}
+
 //
 void							btDbvtBroadphase::optimize()
 {
@@ -109,6 +109,7 @@ struct	btDbvtBroadphase : btBroadphaseInterface
 	virtual void					setAabb(btBroadphaseProxy* proxy,const btVector3& aabbMin,const btVector3& aabbMax,btDispatcher* dispatcher);
 	virtual void					rayTest(const btVector3& rayFrom,const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin=btVector3(0,0,0), const btVector3& aabbMax = btVector3(0,0,0));
 	virtual void					aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback);
+	virtual void					aabbTestBatch(const btVector3* aabbMins, const btVector3* aabbMaxs, int numAabbs, btBroadphaseAabbBatchCallback& callback);
 
 	virtual void					getAabb(btBroadphaseProxy* proxy,btVector3& aabbMin, btVector3& aabbMax ) const;
 	virtual	void					calculateOverlappingPairs(btDispatcher* dispatcher);
@@ -122,6 +123,12 @@ struct	btDbvtBroadphase : btBroadphaseInterface
 	virtual void resetPool(btDispatcher* dispatcher);
 
 	void	performDeferredRemoval(btDispatcher* dispatcher);
+
+	///rebuild both trees and the stage lists by inserting all proxies in the given order, with the given leaf volumes.
+	///Afterwards the trees only depend on this order and not on the history of updates, so the broadphase can be saved
+	///and restored deterministically (see btWorldCheckpoint). The stage of each proxy selects its set and stage list,
+	///the incremental optimization path of the sets is kept.
+	void	rebuildTrees(btDbvtProxy** proxies,const btDbvtVolume* volumes,int numProxies);
 	
 	void	setVelocityPrediction(btScalar prediction)
 	{
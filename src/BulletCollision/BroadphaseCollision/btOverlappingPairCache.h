@@ -84,6 +84,12 @@ public:
 
 	virtual	void	setInternalGhostPairCallback(btOverlappingPairCallback* ghostPairCallback)=0;
 
+	///returns the callback set by setInternalGhostPairCallback, or 0 if the cache doesn't report pairs to ghost objects
+	virtual	btOverlappingPairCallback*	getInternalGhostPairCallback() const
+	{
+		return 0;
+	}
+
 	virtual void	sortOverlappingPairs(btDispatcher* dispatcher) = 0;
 
 
@@ -267,6 +273,11 @@ private:
 		m_ghostPairCallback = ghostPairCallback;
 	}
 
+	virtual	btOverlappingPairCallback*	getInternalGhostPairCallback() const
+	{
+		return m_ghostPairCallback;
+	}
+
 	virtual void	sortOverlappingPairs(btDispatcher* dispatcher);
 	
 
@@ -375,6 +386,11 @@ class	btSortedOverlappingPairCache : public btOverlappingPairCache
 			m_ghostPairCallback = ghostPairCallback;
 		}
 
+		virtual	btOverlappingPairCallback*	getInternalGhostPairCallback() const
+		{
+			return m_ghostPairCallback;
+		}
+
 		virtual void	sortOverlappingPairs(btDispatcher* dispatcher);
 		
 
@@ -1305,6 +1305,33 @@ void btQuantizedBvh::deSerializeDouble(struct btQuantizedBvhDoubleData& quantize
 
 }
 
+void btQuantizedBvh::deSerializeFloatInPlace(struct btQuantizedBvhFloatData& quantizedBvhFloatData)
+{
+	btAssert(sizeof(btQuantizedBvhNodeData)==sizeof(btQuantizedBvhNode));
+	btAssert(((size_t)quantizedBvhFloatData.m_quantizedContiguousNodesPtr & 15)==0);
+
+	int numElem = quantizedBvhFloatData.m_numQuantizedContiguousNodes;
+	quantizedBvhFloatData.m_numQuantizedContiguousNodes = 0;
+	deSerializeFloat(quantizedBvhFloatData);
+	quantizedBvhFloatData.m_numQuantizedContiguousNodes = numElem;
+
+	m_quantizedContiguousNodes.initializeFromBuffer(quantizedBvhFloatData.m_quantizedContiguousNodesPtr,numElem,numElem);
+}
+
+void btQuantizedBvh::deSerializeDoubleInPlace(struct btQuantizedBvhDoubleData& quantizedBvhDoubleData)
+{
+	btAssert(sizeof(btQuantizedBvhNodeData)==sizeof(btQuantizedBvhNode));
+	btAssert(((size_t)quantizedBvhDoubleData.m_quantizedContiguousNodesPtr & 15)==0);
+
+	int numElem = quantizedBvhDoubleData.m_numQuantizedContiguousNodes;
+	quantizedBvhDoubleData.m_numQuantizedContiguousNodes = 0;
+	deSerializeDouble(quantizedBvhDoubleData);
+	quantizedBvhDoubleData.m_numQuantizedContiguousNodes = numElem;
+
+	m_quantizedContiguousNodes.initializeFromBuffer(quantizedBvhDoubleData.m_quantizedContiguousNodesPtr,numElem,numElem);
+}
+
+
 
 
 ///fills the dataBuffer and returns the struct name (and 0 on failure)
@@ -482,6 +482,12 @@ public:
 
 	virtual	void deSerializeDouble(struct btQuantizedBvhDoubleData& quantizedBvhDoubleData);
 
+	///deSerializeFloatInPlace is like deSerializeFloat, but the quantized nodes reference the serialized data instead of copying it.
+	///The node data must be 16 byte aligned and stay valid as long as the bvh is used
+	void deSerializeFloatInPlace(struct btQuantizedBvhFloatData& quantizedBvhFloatData);
+
+	void deSerializeDoubleInPlace(struct btQuantizedBvhDoubleData& quantizedBvhDoubleData);
+
 
 ////////////////////////////////////////////////////////////////////
 
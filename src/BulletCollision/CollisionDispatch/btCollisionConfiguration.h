@@ -40,6 +40,15 @@ public:
 
 	virtual btCollisionAlgorithmCreateFunc* getCollisionAlgorithmCreateFunc(int proxyType0,int proxyType1) =0;
 
+	///returns the create function of btConvexConvexAlgorithm (and its multipoint settings) if the configuration uses it, 0 otherwise.
+	///btCollisionQueryDispatcher replaces it by one with a private simplex solver, so convex queries can run on several threads.
+	virtual btCollisionAlgorithmCreateFunc* getConvexConvexCreateFunc(int& numPerturbationIterations, int& minimumPointsPerturbationThreshold)
+	{
+		(void)numPerturbationIterations;
+		(void)minimumPointsPerturbationThreshold;
+		return 0;
+	}
+
 };
 
 #endif //BT_COLLISION_CONFIGURATION
@@ -0,0 +1,153 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2015 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btCollisionQueryDispatcher.h"
+
+#include "BulletCollision/BroadphaseCollision/btCollisionAlgorithm.h"
+#include "BulletCollision/CollisionShapes/btCollisionShape.h"
+#include "BulletCollision/CollisionDispatch/btCollisionObject.h"
+#include "BulletCollision/CollisionDispatch/btCollisionConfiguration.h"
+#include "BulletCollision/CollisionDispatch/btCollisionObjectWrapper.h"
+#include "BulletCollision/CollisionDispatch/btManifoldResult.h"
+
+
+btCollisionQueryDispatcher::btCollisionQueryDispatcher(btCollisionConfiguration* collisionConfiguration, int algorithmPoolSize, int manifoldPoolSize)
+:m_collisionConfiguration(collisionConfiguration),
+m_algorithmPool(collisionConfiguration->getCollisionAlgorithmPool()->getElementSize(),algorithmPoolSize),
+m_manifoldPool(sizeof(btPersistentManifold),manifoldPoolSize),
+m_convexConvexCreateFunc(&m_simplexSolver,&m_pdSolver),
+m_sharedConvexConvexCreateFunc(0)
+{
+	updateConvexConvexCreateFunc();
+}
+
+btCollisionQueryDispatcher::~btCollisionQueryDispatcher()
+{
+	while (m_manifolds.size())
+	{
+		releaseManifold(m_manifolds[m_manifolds.size()-1]);
+	}
+}
+
+void btCollisionQueryDispatcher::updateConvexConvexCreateFunc()
+{
+	//the configuration shares a single simplex solver between all convex-convex algorithms,
+	//remember its create function so findAlgorithm can substitute the private one
+	m_sharedConvexConvexCreateFunc = m_collisionConfiguration->getConvexConvexCreateFunc(m_convexConvexCreateFunc.m_numPerturbationIterations,
+		m_convexConvexCreateFunc.m_minimumPointsPerturbationThreshold);
+}
+
+btCollisionAlgorithm* btCollisionQueryDispatcher::findAlgorithm(const btCollisionObjectWrapper* body0Wrap,const btCollisionObjectWrapper* body1Wrap,btPersistentManifold* sharedManifold)
+{
+	btCollisionAlgorithmConstructionInfo ci;
+	ci.m_dispatcher1 = this;
+	ci.m_manifold = sharedManifold;
+
+	btCollisionAlgorithmCreateFunc* createFunc = m_collisionConfiguration->getCollisionAlgorithmCreateFunc(body0Wrap->getCollisionShape()->getShapeType(),body1Wrap->getCollisionShape()->getShapeType());
+	if (createFunc && (createFunc == m_sharedConvexConvexCreateFunc))
+	{
+		createFunc = &m_convexConvexCreateFunc;
+	}
+	return createFunc->CreateCollisionAlgorithm(ci,body0Wrap,body1Wrap);
+}
+
+btPersistentManifold* btCollisionQueryDispatcher::getNewManifold(const btCollisionObject* body0,const btCollisionObject* body1)
+{
+	btScalar contactBreakingThreshold = btMin(body0->getCollisionShape()->getContactBreakingThreshold(gContactBreakingThreshold),
+		body1->getCollisionShape()->getContactBreakingThreshold(gContactBreakingThreshold));
+	btScalar contactProcessingThreshold = btMin(body0->getContactProcessingThreshold(),body1->getContactProcessingThreshold());
+
+	void* mem = m_manifoldPool.getFreeCount() ? m_manifoldPool.allocate(sizeof(btPersistentManifold)) : btAlignedAlloc(sizeof(btPersistentManifold),16);
+	btPersistentManifold* manifold = new(mem) btPersistentManifold(body0,body1,0,contactBreakingThreshold,contactProcessingThreshold);
+	manifold->m_index1a = m_manifolds.size();
+	m_manifolds.push_back(manifold);
+	return manifold;
+}
+
+void btCollisionQueryDispatcher::releaseManifold(btPersistentManifold* manifold)
+{
+	clearManifold(manifold);
+
+	int findIndex = manifold->m_index1a;
+	btAssert(findIndex < m_manifolds.size());
+	m_manifolds.swap(findIndex,m_manifolds.size()-1);
+	m_manifolds[findIndex]->m_index1a = findIndex;
+	m_manifolds.pop_back();
+
+	manifold->~btPersistentManifold();
+	if (m_manifoldPool.validPtr(manifold))
+	{
+		m_manifoldPool.freeMemory(manifold);
+	} else
+	{
+		btAlignedFree(manifold);
+	}
+}
+
+void btCollisionQueryDispatcher::clearManifold(btPersistentManifold* manifold)
+{
+	manifold->clearManifold();
+}
+
+bool btCollisionQueryDispatcher::needsCollision(const btCollisionObject* body0,const btCollisionObject* body1)
+{
+	btAssert(body0);
+	btAssert(body1);
+	return body0->checkCollideWith(body1) || body1->checkCollideWith(body0);
+}
+
+bool btCollisionQueryDispatcher::needsResponse(const btCollisionObject* body0,const btCollisionObject* body1)
+{
+	return body0->hasContactResponse() && body1->hasContactResponse();
+}
+
+void btCollisionQueryDispatcher::dispatchAllCollisionPairs(btOverlappingPairCache* pairCache,const btDispatcherInfo& dispatchInfo,btDispatcher* dispatcher)
+{
+	(void)pairCache;
+	(void)dispatchInfo;
+	(void)dispatcher;
+	btAssert(0);
+}
+
+void* btCollisionQueryDispatcher::allocateCollisionAlgorithm(int size)
+{
+	if (m_algorithmPool.getFreeCount() && size <= m_algorithmPool.getElementSize())
+	{
+		return m_algorithmPool.allocate(size);
+	}
+	return btAlignedAlloc(static_cast<size_t>(size), 16);
+}
+
+void btCollisionQueryDispatcher::freeCollisionAlgorithm(void* ptr)
+{
+	if (m_algorithmPool.validPtr(ptr))
+	{
+		m_algorithmPool.freeMemory(ptr);
+	} else
+	{
+		btAlignedFree(ptr);
+	}
+}
+
+void btCollisionQueryDispatcher::processCollision(const btCollisionObjectWrapper* body0Wrap,const btCollisionObjectWrapper* body1Wrap,const btDispatcherInfo& dispatchInfo,btManifoldResult* resultOut)
+{
+	btCollisionAlgorithm* algorithm = findAlgorithm(body0Wrap,body1Wrap);
+	if (algorithm)
+	{
+		algorithm->processCollision(body0Wrap,body1Wrap,dispatchInfo,resultOut);
+		algorithm->~btCollisionAlgorithm();
+		freeCollisionAlgorithm(algorithm);
+	}
+}
@@ -0,0 +1,112 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2015 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_COLLISION_QUERY_DISPATCHER_H
+#define BT_COLLISION_QUERY_DISPATCHER_H
+
+#include "BulletCollision/BroadphaseCollision/btDispatcher.h"
+#include "BulletCollision/NarrowPhaseCollision/btVoronoiSimplexSolver.h"
+#include "BulletCollision/NarrowPhaseCollision/btGjkEpaPenetrationDepthSolver.h"
+#include "BulletCollision/CollisionDispatch/btConvexConvexAlgorithm.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btPoolAllocator.h"
+
+class btCollisionConfiguration;
+class btManifoldResult;
+
+///btCollisionQueryDispatcher is a lightweight dispatcher for one-shot collision queries, such as btCollisionWorld::contactTestBatch.
+///It creates the algorithms of the collision configuration, but allocates them (and their manifolds) from its own pools,
+///so repeated queries recycle the same memory and never touch the world dispatcher.
+///The convex-convex algorithm uses a private simplex solver (see btCollisionConfiguration::getConvexConvexCreateFunc),
+///so each thread can run queries through its own btCollisionQueryDispatcher. btCollisionWorld keeps a pool of them, see acquireQueryDispatcher.
+ATTRIBUTE_ALIGNED16(class) btCollisionQueryDispatcher : public btDispatcher
+{
+	btCollisionConfiguration*	m_collisionConfiguration;
+
+	btPoolAllocator	m_algorithmPool;
+	btPoolAllocator	m_manifoldPool;
+	btAlignedObjectArray<btPersistentManifold*>	m_manifolds;
+
+	btVoronoiSimplexSolver	m_simplexSolver;
+	btGjkEpaPenetrationDepthSolver	m_pdSolver;
+	btConvexConvexAlgorithm::CreateFunc	m_convexConvexCreateFunc;
+	btCollisionAlgorithmCreateFunc*	m_sharedConvexConvexCreateFunc;
+
+public:
+
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	btCollisionQueryDispatcher(btCollisionConfiguration* collisionConfiguration, int algorithmPoolSize=16, int manifoldPoolSize=16);
+
+	virtual ~btCollisionQueryDispatcher();
+
+	///copies the current multipoint settings of the convex-convex algorithm from the collision configuration
+	void	updateConvexConvexCreateFunc();
+
+	///returns false if convex-convex pairs use the shared solvers of the collision configuration, queries can then only run on one thread
+	bool	hasPrivateConvexConvexCreateFunc() const
+	{
+		return m_sharedConvexConvexCreateFunc!=0;
+	}
+
+	virtual btCollisionAlgorithm* findAlgorithm(const btCollisionObjectWrapper* body0Wrap,const btCollisionObjectWrapper* body1Wrap,btPersistentManifold* sharedManifold=0);
+
+	virtual btPersistentManifold*	getNewManifold(const btCollisionObject* b0,const btCollisionObject* b1);
+
+	virtual void releaseManifold(btPersistentManifold* manifold);
+
+	virtual void clearManifold(btPersistentManifold* manifold);
+
+	virtual bool	needsCollision(const btCollisionObject* body0,const btCollisionObject* body1);
+
+	virtual bool	needsResponse(const btCollisionObject* body0,const btCollisionObject* body1);
+
+	///queries are processed one pair at a time, dispatchAllCollisionPairs is not supported
+	virtual void	dispatchAllCollisionPairs(btOverlappingPairCache* pairCache,const btDispatcherInfo& dispatchInfo,btDispatcher* dispatcher);
+
+	virtual int getNumManifolds() const
+	{
+		return m_manifolds.size();
+	}
+
+	virtual btPersistentManifold* getManifoldByIndexInternal(int index)
+	{
+		return m_manifolds[index];
+	}
+
+	virtual	btPersistentManifold**	getInternalManifoldPointer()
+	{
+		return m_manifolds.size() ? &m_manifolds[0] : 0;
+	}
+
+	virtual	btPoolAllocator*	getInternalManifoldPool()
+	{
+		return &m_manifoldPool;
+	}
+
+	virtual	const btPoolAllocator*	getInternalManifoldPool() const
+	{
+		return &m_manifoldPool;
+	}
+
+	virtual	void* allocateCollisionAlgorithm(int size);
+
+	virtual	void freeCollisionAlgorithm(void* ptr);
+
+	///processCollision runs the narrowphase between two objects, and releases the algorithm afterwards
+	void	processCollision(const btCollisionObjectWrapper* body0Wrap,const btCollisionObjectWrapper* body1Wrap,const btDispatcherInfo& dispatchInfo,btManifoldResult* resultOut);
+};
+
+#endif //BT_COLLISION_QUERY_DISPATCHER_H
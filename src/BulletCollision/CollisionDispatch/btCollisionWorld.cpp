@@ -34,6 +34,8 @@ subject to the following restrictions:
 #include "LinearMath/btSerializer.h"
 #include "BulletCollision/CollisionShapes/btConvexPolyhedron.h"
 #include "BulletCollision/CollisionDispatch/btCollisionObjectWrapper.h"
+#include "BulletCollision/CollisionDispatch/btCollisionQueryDispatcher.h"
+#include "LinearMath/btThreads.h"
 
 //#define DISABLE_DBVT_COMPOUNDSHAPE_RAYCAST_ACCELERATION
 
@@ -69,6 +71,7 @@ subject to the following restrictions:
 btCollisionWorld::btCollisionWorld(btDispatcher* dispatcher,btBroadphaseInterface* pairCache, btCollisionConfiguration* collisionConfiguration)
 :m_dispatcher1(dispatcher),
 m_broadphasePairCache(pairCache),
+m_collisionConfiguration(collisionConfiguration),
 m_debugDrawer(0),
 m_forceUpdateAllAabbs(true)
 {
@@ -96,7 +99,42 @@ btCollisionWorld::~btCollisionWorld()
 		}
 	}
 
+	for (i=0;i<m_queryDispatcherPool.size();i++)
+	{
+		delete m_queryDispatcherPool[i];
+	}
+}
+
+btCollisionQueryDispatcher*	btCollisionWorld::acquireQueryDispatcher()
+{
+	if (!m_collisionConfiguration)
+		return 0;
+	btCollisionQueryDispatcher* dispatcher = 0;
+	{
+		btMutexLockGuard lock(m_queryDispatcherPoolMutex);
+		if (m_queryDispatcherPool.size())
+		{
+			dispatcher = m_queryDispatcherPool[m_queryDispatcherPool.size()-1];
+			m_queryDispatcherPool.pop_back();
+		}
+	}
+	if (dispatcher)
+	{
+		dispatcher->updateConvexConvexCreateFunc();
+	} else
+	{
+		dispatcher = new btCollisionQueryDispatcher(m_collisionConfiguration);
+	}
+	return dispatcher;
+}
 
+void	btCollisionWorld::releaseQueryDispatcher(btCollisionQueryDispatcher* dispatcher)
+{
+	if (dispatcher)
+	{
+		btMutexLockGuard lock(m_queryDispatcherPoolMutex);
+		m_queryDispatcherPool.push_back(dispatcher);
+	}
 }
 
 
@@ -1198,6 +1236,363 @@ void	btCollisionWorld::contactPairTest(btCollisionObject* colObjA, btCollisionOb
 
 
 
+
+///btBatchOverlapCandidate is a broadphase overlap between a query of a batch and a world object
+struct btBatchOverlapCandidate
+{
+	int	m_queryIndex;
+	btCollisionObject*	m_collisionObject;
+};
+
+class btBatchOverlapCandidateSortPredicate
+{
+public:
+	bool operator() ( const btBatchOverlapCandidate& a, const btBatchOverlapCandidate& b ) const
+	{
+		if (a.m_queryIndex != b.m_queryIndex)
+			return a.m_queryIndex < b.m_queryIndex;
+		//keep the narrowphase order of each query deterministic
+		return a.m_collisionObject->getBroadphaseHandle()->getUid() < b.m_collisionObject->getBroadphaseHandle()->getUid();
+	}
+};
+
+///btBatchBroadphaseCallback applies the filtering of OverlapQuery or RayQuery to the broadphase overlaps
+template <class QUERY>
+struct btBatchBroadphaseCallback : public btBroadphaseAabbBatchCallback
+{
+	const QUERY*	m_queries;
+	btAlignedObjectArray<btBatchOverlapCandidate>&	m_candidates;
+
+	btBatchBroadphaseCallback(const QUERY* queries, btAlignedObjectArray<btBatchOverlapCandidate>& candidates)
+		:m_queries(queries),
+		m_candidates(candidates)
+	{
+	}
+
+	virtual bool	process(int queryIndex, const btBroadphaseProxy* proxy)
+	{
+		const QUERY& query = m_queries[queryIndex];
+		btCollisionObject*	collisionObject = (btCollisionObject*)proxy->m_clientObject;
+		if (collisionObject == query.m_ignoreObject)
+			return true;
+
+		bool collides = (proxy->m_collisionFilterGroup & query.m_collisionFilterMask) != 0;
+		collides = collides && (query.m_collisionFilterGroup & proxy->m_collisionFilterMask);
+		if (collides)
+		{
+			btBatchOverlapCandidate& candidate = m_candidates.expandNonInitializing();
+			candidate.m_queryIndex = queryIndex;
+			candidate.m_collisionObject = collisionObject;
+		}
+		return true;
+	}
+};
+
+///btOverlapManifoldResult only records whether the narrowphase found a touching or penetrating point
+struct btOverlapManifoldResult : public btManifoldResult
+{
+	bool	m_hasOverlap;
+
+	btOverlapManifoldResult(const btCollisionObjectWrapper* obj0Wrap,const btCollisionObjectWrapper* obj1Wrap)
+		:btManifoldResult(obj0Wrap,obj1Wrap),
+		m_hasOverlap(false)
+	{
+	}
+
+	virtual void addContactPoint(const btVector3& normalOnBInWorld,const btVector3& pointInWorld,btScalar depth)
+	{
+		(void)normalOnBInWorld;
+		(void)pointInWorld;
+		if (depth <= btScalar(0.))
+			m_hasOverlap = true;
+	}
+};
+
+///btBatchContactResultAdapter forwards the contacts of one query of a batch, so btBridgedManifoldResult can be reused
+struct btBatchContactResultAdapter : public btCollisionWorld::ContactResultCallback
+{
+	btCollisionWorld::BatchContactResultCallback&	m_batchCallback;
+	int	m_queryIndex;
+	int	m_numContacts;
+
+	btBatchContactResultAdapter(btCollisionWorld::BatchContactResultCallback& batchCallback, int queryIndex)
+		:m_batchCallback(batchCallback),
+		m_queryIndex(queryIndex),
+		m_numContacts(0)
+	{
+	}
+
+	virtual	btScalar	addSingleResult(btManifoldPoint& cp,	const btCollisionObjectWrapper* colObj0Wrap,int partId0,int index0,const btCollisionObjectWrapper* colObj1Wrap,int partId1,int index1)
+	{
+		m_numContacts++;
+		return m_batchCallback.addSingleResult(m_queryIndex,cp,colObj0Wrap,partId0,index0,colObj1Wrap,partId1,index1);
+	}
+};
+
+static void btProcessQueryPair(btDispatcher* dispatcher, const btCollisionObjectWrapper* ob0, const btCollisionObjectWrapper* ob1, const btDispatcherInfo& dispatchInfo, btManifoldResult* result)
+{
+	btCollisionAlgorithm* algorithm = dispatcher->findAlgorithm(ob0,ob1);
+	if (algorithm)
+	{
+		algorithm->processCollision(ob0,ob1,dispatchInfo,result);
+		algorithm->~btCollisionAlgorithm();
+		dispatcher->freeCollisionAlgorithm(algorithm);
+	}
+}
+
+///btBatchNarrowphaseLoop runs the narrowphase for a range of queries, each range uses a pooled btCollisionQueryDispatcher
+struct btBatchNarrowphaseLoop : public btIParallelForBody
+{
+	btCollisionWorld*	m_world;
+	const btCollisionWorld::OverlapQuery*	m_queries;
+	const btBatchOverlapCandidate*	m_candidates;
+	const int*	m_queryCandidateStart;
+	char*	m_candidateOverlaps;
+	btCollisionWorld::BatchContactResultCallback*	m_contactCallback;
+	bool	m_firstHitOnly;
+
+	virtual void forLoop(int iBegin, int iEnd) const
+	{
+		btCollisionQueryDispatcher* queryDispatcher = m_world->acquireQueryDispatcher();
+		btDispatcher* dispatcher = queryDispatcher ? queryDispatcher : m_world->getDispatcher();
+		const btDispatcherInfo& dispatchInfo = m_world->getDispatchInfo();
+
+		btCollisionObject	queryObject;
+		for (int q=iBegin;q<iEnd;q++)
+		{
+			const btCollisionWorld::OverlapQuery& query = m_queries[q];
+			queryObject.setCollisionShape(const_cast<btCollisionShape*>(query.m_shape));
+			queryObject.setWorldTransform(query.m_worldTransform);
+			btCollisionObjectWrapper ob0(0,query.m_shape,&queryObject,query.m_worldTransform,-1,-1);
+
+			for (int c=m_queryCandidateStart[q];c<m_queryCandidateStart[q+1];c++)
+			{
+				btCollisionObject* collisionObject = m_candidates[c].m_collisionObject;
+				btCollisionObjectWrapper ob1(0,collisionObject->getCollisionShape(),collisionObject,collisionObject->getWorldTransform(),-1,-1);
+
+				bool hasOverlap;
+				if (m_contactCallback)
+				{
+					btBatchContactResultAdapter adapter(*m_contactCallback,q);
+					btBridgedManifoldResult contactPointResult(&ob0,&ob1,adapter);
+					btProcessQueryPair(dispatcher,&ob0,&ob1,dispatchInfo,&contactPointResult);
+					hasOverlap = adapter.m_numContacts>0;
+				} else
+				{
+					btOverlapManifoldResult overlapResult(&ob0,&ob1);
+					btProcessQueryPair(dispatcher,&ob0,&ob1,dispatchInfo,&overlapResult);
+					hasOverlap = overlapResult.m_hasOverlap;
+				}
+				m_candidateOverlaps[c] = hasOverlap;
+				if (hasOverlap && m_firstHitOnly)
+					break;
+			}
+		}
+		m_world->releaseQueryDispatcher(queryDispatcher);
+	}
+};
+
+static void btBatchBroadphase(btBroadphaseInterface* broadphase, const btAlignedObjectArray<btVector3>& aabbMins, const btAlignedObjectArray<btVector3>& aabbMaxs, btBroadphaseAabbBatchCallback& broadphaseCallback, btAlignedObjectArray<btBatchOverlapCandidate>& candidates, btAlignedObjectArray<int>& queryCandidateStart)
+{
+	int numQueries = aabbMins.size();
+	broadphase->aabbTestBatch(&aabbMins[0],&aabbMaxs[0],numQueries,broadphaseCallback);
+	candidates.quickSort(btBatchOverlapCandidateSortPredicate());
+
+	queryCandidateStart.resize(numQueries+1);
+	int c = 0;
+	for (int q=0;q<numQueries;q++)
+	{
+		queryCandidateStart[q] = c;
+		while (c<candidates.size() && candidates[c].m_queryIndex==q)
+			c++;
+	}
+	queryCandidateStart[numQueries] = c;
+}
+
+static void btBatchBroadphase(btBroadphaseInterface* broadphase, const btCollisionWorld::OverlapQuery* queries, int numQueries, btAlignedObjectArray<btBatchOverlapCandidate>& candidates, btAlignedObjectArray<int>& queryCandidateStart)
+{
+	btAlignedObjectArray<btVector3> aabbMins;
+	btAlignedObjectArray<btVector3> aabbMaxs;
+	aabbMins.resize(numQueries);
+	aabbMaxs.resize(numQueries);
+	for (int i=0;i<numQueries;i++)
+	{
+		queries[i].m_shape->getAabb(queries[i].m_worldTransform,aabbMins[i],aabbMaxs[i]);
+	}
+
+	btBatchBroadphaseCallback<btCollisionWorld::OverlapQuery> broadphaseCallback(queries,candidates);
+	btBatchBroadphase(broadphase,aabbMins,aabbMaxs,broadphaseCallback,candidates,queryCandidateStart);
+}
+
+static void btBatchNarrowphase(btCollisionWorld* world, const btCollisionWorld::OverlapQuery* queries, int numQueries, const btAlignedObjectArray<btBatchOverlapCandidate>& candidates, const btAlignedObjectArray<int>& queryCandidateStart, btAlignedObjectArray<char>& candidateOverlaps, btCollisionWorld::BatchContactResultCallback* contactCallback, int batchQueryFlags)
+{
+	candidateOverlaps.resize(candidates.size());
+	if (!candidates.size())
+		return;
+	memset(&candidateOverlaps[0],0,candidates.size());
+
+	btBatchNarrowphaseLoop narrowphaseLoop;
+	narrowphaseLoop.m_world = world;
+	narrowphaseLoop.m_queries = queries;
+	narrowphaseLoop.m_candidates = &candidates[0];
+	narrowphaseLoop.m_queryCandidateStart = &queryCandidateStart[0];
+	narrowphaseLoop.m_candidateOverlaps = &candidateOverlaps[0];
+	narrowphaseLoop.m_contactCallback = contactCallback;
+	narrowphaseLoop.m_firstHitOnly = (batchQueryFlags & btCollisionWorld::BQF_FIRST_HIT_ONLY)!=0;
+
+	//without a collision configuration the queries go through the (single threaded) world dispatcher, and without
+	//a btConvexConvexAlgorithm the query dispatchers would share the solvers of the configuration
+	bool multithreaded = false;
+	if ((batchQueryFlags & btCollisionWorld::BQF_MULTITHREADED) && world->getCollisionConfiguration())
+	{
+		int numPerturbationIterations, minimumPointsPerturbationThreshold;
+		multithreaded = world->getCollisionConfiguration()->getConvexConvexCreateFunc(numPerturbationIterations,minimumPointsPerturbationThreshold)!=0;
+	}
+	if (multithreaded)
+	{
+		const int grainSize = 32;
+		btParallelFor(0,numQueries,grainSize,narrowphaseLoop);
+	} else
+	{
+		narrowphaseLoop.forLoop(0,numQueries);
+	}
+}
+
+void	btCollisionWorld::overlapTestBatch(const OverlapQuery* queries, int numQueries, btAlignedObjectArray<OverlapResult>& results, int batchQueryFlags)
+{
+	BT_PROFILE("overlapTestBatch");
+	if (numQueries<=0)
+		return;
+
+	btAlignedObjectArray<btBatchOverlapCandidate> candidates;
+	btAlignedObjectArray<int> queryCandidateStart;
+	btBatchBroadphase(m_broadphasePairCache,queries,numQueries,candidates,queryCandidateStart);
+
+	btAlignedObjectArray<char> candidateOverlaps;
+	if (batchQueryFlags & BQF_AABB_ONLY)
+	{
+		candidateOverlaps.resize(candidates.size());
+		for (int c=0;c<candidates.size();c++)
+			candidateOverlaps[c] = 1;
+	} else
+	{
+		btBatchNarrowphase(this,queries,numQueries,candidates,queryCandidateStart,candidateOverlaps,0,batchQueryFlags);
+	}
+
+	for (int q=0;q<numQueries;q++)
+	{
+		for (int c=queryCandidateStart[q];c<queryCandidateStart[q+1];c++)
+		{
+			if (candidateOverlaps[c])
+			{
+				OverlapResult& result = results.expandNonInitializing();
+				result.m_queryIndex = q;
+				result.m_collisionObject = candidates[c].m_collisionObject;
+				if (batchQueryFlags & BQF_FIRST_HIT_ONLY)
+					break;
+			}
+		}
+	}
+}
+
+void	btCollisionWorld::contactTestBatch(const OverlapQuery* queries, int numQueries, BatchContactResultCallback& resultCallback, int batchQueryFlags)
+{
+	BT_PROFILE("contactTestBatch");
+	if (numQueries<=0)
+		return;
+
+	btAlignedObjectArray<btBatchOverlapCandidate> candidates;
+	btAlignedObjectArray<int> queryCandidateStart;
+	btBatchBroadphase(m_broadphasePairCache,queries,numQueries,candidates,queryCandidateStart);
+
+	//contact points always need the narrowphase, BQF_AABB_ONLY is ignored here
+	btAlignedObjectArray<char> candidateOverlaps;
+	btBatchNarrowphase(this,queries,numQueries,candidates,queryCandidateStart,candidateOverlaps,&resultCallback,batchQueryFlags);
+}
+
+///btBatchRayLoop finds the closest hit of a range of rays among their broadphase candidates
+struct btBatchRayLoop : public btIParallelForBody
+{
+	const btCollisionWorld::RayQuery*	m_queries;
+	const btBatchOverlapCandidate*	m_candidates;
+	const int*	m_queryCandidateStart;
+	btCollisionWorld::ClosestRayQueryResult*	m_results;
+
+	virtual void forLoop(int iBegin, int iEnd) const
+	{
+		btTransform	rayFromTrans,rayToTrans;
+		rayFromTrans.setIdentity();
+		rayToTrans.setIdentity();
+		for (int q=iBegin;q<iEnd;q++)
+		{
+			const btCollisionWorld::RayQuery& query = m_queries[q];
+			btCollisionWorld::ClosestRayResultCallback rayCallback(query.m_rayFromWorld,query.m_rayToWorld);
+			rayFromTrans.setOrigin(query.m_rayFromWorld);
+			rayToTrans.setOrigin(query.m_rayToWorld);
+
+			//like rayTest, there is no per-object aabb culling: ray casts against convex shapes can report hits slightly outside the aabb
+			for (int c=m_queryCandidateStart[q];c<m_queryCandidateStart[q+1] && rayCallback.m_closestHitFraction>btScalar(0.);c++)
+			{
+				btCollisionObject* collisionObject = m_candidates[c].m_collisionObject;
+				btCollisionWorld::rayTestSingle(rayFromTrans,rayToTrans,
+					collisionObject,
+					collisionObject->getCollisionShape(),
+					collisionObject->getWorldTransform(),
+					rayCallback);
+			}
+
+			btCollisionWorld::ClosestRayQueryResult& result = m_results[q];
+			result.m_collisionObject = rayCallback.m_collisionObject;
+			result.m_closestHitFraction = rayCallback.m_closestHitFraction;
+			if (rayCallback.hasHit())
+			{
+				result.m_hitPointWorld = rayCallback.m_hitPointWorld;
+				result.m_hitNormalWorld = rayCallback.m_hitNormalWorld;
+			}
+		}
+	}
+};
+
+void	btCollisionWorld::rayTestBatch(const RayQuery* queries, int numQueries, ClosestRayQueryResult* results, int batchQueryFlags)
+{
+	BT_PROFILE("rayTestBatch");
+	if (numQueries<=0)
+		return;
+
+	btAlignedObjectArray<btVector3> aabbMins;
+	btAlignedObjectArray<btVector3> aabbMaxs;
+	aabbMins.resize(numQueries);
+	aabbMaxs.resize(numQueries);
+	for (int i=0;i<numQueries;i++)
+	{
+		aabbMins[i] = queries[i].m_rayFromWorld;
+		aabbMaxs[i] = queries[i].m_rayFromWorld;
+		aabbMins[i].setMin(queries[i].m_rayToWorld);
+		aabbMaxs[i].setMax(queries[i].m_rayToWorld);
+	}
+
+	btAlignedObjectArray<btBatchOverlapCandidate> candidates;
+	btAlignedObjectArray<int> queryCandidateStart;
+	btBatchBroadphaseCallback<RayQuery> broadphaseCallback(queries,candidates);
+	btBatchBroadphase(m_broadphasePairCache,aabbMins,aabbMaxs,broadphaseCallback,candidates,queryCandidateStart);
+
+	btBatchRayLoop rayLoop;
+	rayLoop.m_queries = queries;
+	rayLoop.m_candidates = candidates.size() ? &candidates[0] : 0;
+	rayLoop.m_queryCandidateStart = &queryCandidateStart[0];
+	rayLoop.m_results = results;
+
+	//ray tests don't need a dispatcher, so they can always run in parallel
+	if (batchQueryFlags & BQF_MULTITHREADED)
+	{
+		const int grainSize = 64;
+		btParallelFor(0,numQueries,grainSize,rayLoop);
+	} else
+	{
+		rayLoop.forLoop(0,numQueries);
+	}
+}
+
 class DebugDrawcallback : public btTriangleCallback, public btInternalTriangleIndexCallback
 {
 	btIDebugDraw*	m_debugDrawer;
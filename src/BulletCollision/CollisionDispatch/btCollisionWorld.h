@@ -76,6 +76,7 @@ class btCollisionShape;
 class btConvexShape;
 class btBroadphaseInterface;
 class btSerializer;
+class btCollisionQueryDispatcher;
 
 #include "LinearMath/btVector3.h"
 #include "LinearMath/btTransform.h"
@@ -83,6 +84,7 @@ class btSerializer;
 #include "btCollisionDispatcher.h"
 #include "BulletCollision/BroadphaseCollision/btOverlappingPairCache.h"
 #include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btThreads.h"
 
 ///CollisionWorld is interface and container for the collision detection
 class btCollisionWorld
@@ -99,12 +101,18 @@ protected:
 
 	btBroadphaseInterface*	m_broadphasePairCache;
 
+	btCollisionConfiguration*	m_collisionConfiguration;
+
 	btIDebugDraw*	m_debugDrawer;
 
 	///m_forceUpdateAllAabbs can be set to false as an optimization to only update active object AABBs
 	///it is true by default, because it is error-prone (setting the position of static objects wouldn't update their AABB)
 	bool m_forceUpdateAllAabbs;
 
+	///dispatchers of the batched queries, reused across calls (see acquireQueryDispatcher)
+	btAlignedObjectArray<btCollisionQueryDispatcher*>	m_queryDispatcherPool;
+	btSpinMutex	m_queryDispatcherPoolMutex;
+
 	void	serializeCollisionObjects(btSerializer* serializer);
 
 public:
@@ -145,6 +153,17 @@ public:
 		return m_dispatcher1;
 	}
 
+	btCollisionConfiguration*	getCollisionConfiguration()
+	{
+		return m_collisionConfiguration;
+	}
+
+	///acquireQueryDispatcher returns a btCollisionQueryDispatcher for one-shot queries on the calling thread, or 0 without a collision configuration.
+	///The dispatchers are pooled and reused by later calls, give it back with releaseQueryDispatcher. Both are thread safe.
+	btCollisionQueryDispatcher*	acquireQueryDispatcher();
+
+	void	releaseQueryDispatcher(btCollisionQueryDispatcher* dispatcher);
+
 	void	updateSingleAabb(btCollisionObject* colObj);
 
 	virtual void	updateAabbs();
@@ -433,6 +452,101 @@ public:
 		virtual	btScalar	addSingleResult(btManifoldPoint& cp,	const btCollisionObjectWrapper* colObj0Wrap,int partId0,int index0,const btCollisionObjectWrapper* colObj1Wrap,int partId1,int index1) = 0;
 	};
 
+	///OverlapQuery is one shape of a batched query, see overlapTestBatch and contactTestBatch.
+	///The shape doesn't need to be part of the world, m_ignoreObject can exclude the object that owns it.
+	struct	OverlapQuery
+	{
+		const btCollisionShape*	m_shape;
+		btTransform	m_worldTransform;
+		short int	m_collisionFilterGroup;
+		short int	m_collisionFilterMask;
+		const btCollisionObject*	m_ignoreObject;
+
+		OverlapQuery()
+			:m_shape(0),
+			m_worldTransform(btTransform::getIdentity()),
+			m_collisionFilterGroup(btBroadphaseProxy::DefaultFilter),
+			m_collisionFilterMask(btBroadphaseProxy::AllFilter),
+			m_ignoreObject(0)
+		{
+		}
+
+		OverlapQuery(const btCollisionShape* shape, const btTransform& worldTransform)
+			:m_shape(shape),
+			m_worldTransform(worldTransform),
+			m_collisionFilterGroup(btBroadphaseProxy::DefaultFilter),
+			m_collisionFilterMask(btBroadphaseProxy::AllFilter),
+			m_ignoreObject(0)
+		{
+		}
+	};
+
+	///OverlapResult reports one object overlapping the query with index m_queryIndex
+	struct	OverlapResult
+	{
+		int	m_queryIndex;
+		const btCollisionObject*	m_collisionObject;
+	};
+
+	///BatchContactResultCallback is used to report the contact points of contactTestBatch.
+	///With BQF_MULTITHREADED, addSingleResult can be called concurrently for different queries.
+	struct	BatchContactResultCallback
+	{
+		virtual ~BatchContactResultCallback()
+		{
+		}
+
+		virtual	btScalar	addSingleResult(int queryIndex, btManifoldPoint& cp,	const btCollisionObjectWrapper* colObj0Wrap,int partId0,int index0,const btCollisionObjectWrapper* colObj1Wrap,int partId1,int index1) = 0;
+	};
+
+	enum	BatchQueryFlags
+	{
+		BQF_NONE = 0,
+		///stop testing a query after the first overlapping object
+		BQF_FIRST_HIT_ONLY = 1,
+		///only report broadphase (AABB) overlaps, skip the narrowphase
+		BQF_AABB_ONLY = 2,
+		///run the narrowphase through btParallelFor
+		BQF_MULTITHREADED = 4
+	};
+
+	///RayQuery is one ray of rayTestBatch
+	struct	RayQuery
+	{
+		btVector3	m_rayFromWorld;
+		btVector3	m_rayToWorld;
+		short int	m_collisionFilterGroup;
+		short int	m_collisionFilterMask;
+		const btCollisionObject*	m_ignoreObject;
+
+		RayQuery()
+			:m_rayFromWorld(0,0,0),
+			m_rayToWorld(0,0,0),
+			m_collisionFilterGroup(btBroadphaseProxy::DefaultFilter),
+			m_collisionFilterMask(btBroadphaseProxy::AllFilter),
+			m_ignoreObject(0)
+		{
+		}
+
+		RayQuery(const btVector3& rayFromWorld, const btVector3& rayToWorld)
+			:m_rayFromWorld(rayFromWorld),
+			m_rayToWorld(rayToWorld),
+			m_collisionFilterGroup(btBroadphaseProxy::DefaultFilter),
+			m_collisionFilterMask(btBroadphaseProxy::AllFilter),
+			m_ignoreObject(0)
+		{
+		}
+	};
+
+	///ClosestRayQueryResult is the closest hit of a ray of rayTestBatch, m_collisionObject is 0 if the ray missed
+	struct	ClosestRayQueryResult
+	{
+		const btCollisionObject*	m_collisionObject;
+		btVector3	m_hitPointWorld;
+		btVector3	m_hitNormalWorld;
+		btScalar	m_closestHitFraction;
+	};
+
 
 
 	int	getNumCollisionObjects() const
@@ -456,6 +570,17 @@ public:
 	///it reports one or more contact points (including the one with deepest penetration)
 	void	contactPairTest(btCollisionObject* colObjA, btCollisionObject* colObjB, ContactResultCallback& resultCallback);
 
+	///overlapTestBatch tests numQueries shapes against the world with a single broadphase pass, and appends the overlapping objects to results.
+	///Objects are reported when the narrowphase finds a touching or penetrating contact, results are sorted by query index.
+	void	overlapTestBatch(const OverlapQuery* queries, int numQueries, btAlignedObjectArray<OverlapResult>& results, int batchQueryFlags=BQF_NONE);
+
+	///contactTestBatch is the batched version of contactTest, it reports the contact points of every query through resultCallback.
+	void	contactTestBatch(const OverlapQuery* queries, int numQueries, BatchContactResultCallback& resultCallback, int batchQueryFlags=BQF_NONE);
+
+	///rayTestBatch finds the closest hit of numQueries rays with a single broadphase pass, results must hold numQueries entries.
+	///Only BQF_MULTITHREADED applies to rays.
+	void	rayTestBatch(const RayQuery* queries, int numQueries, ClosestRayQueryResult* results, int batchQueryFlags=BQF_NONE);
+
 
 	/// rayTestSingle performs a raycast call and calls the resultCallback. It is used internally by rayTest.
 	/// In a future implementation, we consider moving the ray test as a virtual method in btCollisionShape.
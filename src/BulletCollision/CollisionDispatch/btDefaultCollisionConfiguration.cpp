@@ -288,6 +288,14 @@ btCollisionAlgorithmCreateFunc* btDefaultCollisionConfiguration::getCollisionAlg
 	return m_emptyCreateFunc;
 }
 
+btCollisionAlgorithmCreateFunc* btDefaultCollisionConfiguration::getConvexConvexCreateFunc(int& numPerturbationIterations, int& minimumPointsPerturbationThreshold)
+{
+	btConvexConvexAlgorithm::CreateFunc* convexConvex = (btConvexConvexAlgorithm::CreateFunc*) m_convexConvexCreateFunc;
+	numPerturbationIterations = convexConvex->m_numPerturbationIterations;
+	minimumPointsPerturbationThreshold = convexConvex->m_minimumPointsPerturbationThreshold;
+	return m_convexConvexCreateFunc;
+}
+
 void btDefaultCollisionConfiguration::setConvexConvexMultipointIterations(int numPerturbationIterations, int minimumPointsPerturbationThreshold)
 {
 	btConvexConvexAlgorithm::CreateFunc* convexConvex = (btConvexConvexAlgorithm::CreateFunc*) m_convexConvexCreateFunc;
@@ -99,6 +99,98 @@ void btPairCachingGhostObject::removeOverlappingObjectInternal(btBroadphaseProxy
 }
 
 
+btTriggerObject::btTriggerObject()
+:m_numCancelledEvents(0)
+{
+}
+
+btTriggerObject::~btTriggerObject()
+{
+}
+
+void btTriggerObject::addOverlappingObjectInternal(btBroadphaseProxy* otherProxy,btBroadphaseProxy* thisProxy)
+{
+	btCollisionObject* otherObject = (btCollisionObject*)otherProxy->m_clientObject;
+	btAssert(otherObject);
+	if (m_overlapMap.find(otherObject))
+		return;
+
+	OverlapEntry entry;
+	entry.m_overlapIndex = m_overlappingObjects.size();
+	entry.m_beginEventIndex = m_events.size();
+	m_overlapMap.insert(otherObject,entry);
+	m_overlappingObjects.push_back(otherObject);
+
+	Event& ev = m_events.expandNonInitializing();
+	ev.m_object = otherObject;
+	ev.m_type = BEGIN_OVERLAP;
+}
+
+void btTriggerObject::removeOverlappingObjectInternal(btBroadphaseProxy* otherProxy,btDispatcher* dispatcher,btBroadphaseProxy* thisProxy)
+{
+	btCollisionObject* otherObject = (btCollisionObject*)otherProxy->m_clientObject;
+	btAssert(otherObject);
+	const OverlapEntry* entryPtr = m_overlapMap.find(otherObject);
+	if (!entryPtr)
+		return;
+	OverlapEntry entry = *entryPtr;
+	m_overlapMap.remove(otherObject);
+
+	//swap the last overlapping object into the free slot
+	int lastIndex = m_overlappingObjects.size()-1;
+	if (entry.m_overlapIndex != lastIndex)
+	{
+		btCollisionObject* movedObject = m_overlappingObjects[lastIndex];
+		m_overlappingObjects[entry.m_overlapIndex] = movedObject;
+		m_overlapMap.find(movedObject)->m_overlapIndex = entry.m_overlapIndex;
+	}
+	m_overlappingObjects.pop_back();
+
+	if (entry.m_beginEventIndex>=0)
+	{
+		//the overlap began after the last clearEvents, cancel its BEGIN_OVERLAP instead of reporting an END_OVERLAP.
+		//it stays in the buffer until the events are read, so the order of the other events is kept in O(1)
+		m_events[entry.m_beginEventIndex].m_object = 0;
+		m_numCancelledEvents++;
+	} else
+	{
+		Event& ev = m_events.expandNonInitializing();
+		ev.m_object = otherObject;
+		ev.m_type = END_OVERLAP;
+	}
+}
+
+void btTriggerObject::compactEvents() const
+{
+	int numEvents = 0;
+	for (int i=0;i<m_events.size();i++)
+	{
+		if (!m_events[i].m_object)
+			continue;
+		if (m_events[i].m_type == BEGIN_OVERLAP)
+		{
+			m_overlapMap.find(m_events[i].m_object)->m_beginEventIndex = numEvents;
+		}
+		m_events[numEvents++] = m_events[i];
+	}
+	m_events.resize(numEvents);
+	m_numCancelledEvents = 0;
+}
+
+void btTriggerObject::clearEvents()
+{
+	for (int i=0;i<m_events.size();i++)
+	{
+		if (m_events[i].m_object && m_events[i].m_type == BEGIN_OVERLAP)
+		{
+			m_overlapMap.find(m_events[i].m_object)->m_beginEventIndex = -1;
+		}
+	}
+	m_events.resize(0);
+	m_numCancelledEvents = 0;
+}
+
+
 void	btGhostObject::convexSweepTest(const btConvexShape* castShape, const btTransform& convexFromWorld, const btTransform& convexToWorld, btCollisionWorld::ConvexResultCallback& resultCallback, btScalar allowedCcdPenetration) const
 {
 	btTransform	convexFromTrans,convexToTrans;
@@ -20,6 +20,7 @@ subject to the following restrictions:
 #include "btCollisionObject.h"
 #include "BulletCollision/BroadphaseCollision/btOverlappingPairCallback.h"
 #include "LinearMath/btAlignedAllocator.h"
+#include "LinearMath/btHashMap.h"
 #include "BulletCollision/BroadphaseCollision/btOverlappingPairCache.h"
 #include "btCollisionWorld.h"
 
@@ -119,6 +120,75 @@ public:
 };
 
 
+///btTriggerObject is a ghost object for trigger volumes, that reports the begin and end of each (AABB) overlap instead of a pair cache.
+///Events of a simulation step are collected in a compact buffer: read them with getNumEvents/getEvent, and call clearEvents once they are handled.
+///An overlap that begins and ends within the same buffer cancels out: its BEGIN_OVERLAP is marked as cancelled and dropped the next time the events are read.
+///The overlapping objects are indexed by a hash map, so adding and removing is O(1).
+///END_OVERLAP events can refer to an object that was just removed from the world, so only use the pointer as an identifier.
+ATTRIBUTE_ALIGNED16(class) btTriggerObject : public btGhostObject
+{
+public:
+
+	enum	TriggerEventType
+	{
+		BEGIN_OVERLAP=0,
+		END_OVERLAP
+	};
+
+	struct	Event
+	{
+		const btCollisionObject*	m_object;
+		int	m_type;
+	};
+
+protected:
+
+	struct	OverlapEntry
+	{
+		int	m_overlapIndex;//index in m_overlappingObjects
+		int	m_beginEventIndex;//index of the pending BEGIN_OVERLAP event in m_events, or -1
+	};
+
+	//the cancelled events (m_object==0) are removed lazily by the const accessors, which also update the m_beginEventIndex in the map
+	mutable btHashMap<btHashPtr,OverlapEntry>	m_overlapMap;
+	mutable btAlignedObjectArray<Event>	m_events;
+	mutable int	m_numCancelledEvents;
+
+	void	compactEvents() const;
+
+public:
+
+	btTriggerObject();
+
+	virtual ~btTriggerObject();
+
+	///this method is mainly for expert/internal use only.
+	virtual void	addOverlappingObjectInternal(btBroadphaseProxy* otherProxy, btBroadphaseProxy* thisProxy=0);
+	///this method is mainly for expert/internal use only.
+	virtual void	removeOverlappingObjectInternal(btBroadphaseProxy* otherProxy,btDispatcher* dispatcher,btBroadphaseProxy* thisProxy=0);
+
+	int	getNumEvents() const
+	{
+		if (m_numCancelledEvents)
+			compactEvents();
+		return m_events.size();
+	}
+
+	const Event&	getEvent(int index) const
+	{
+		if (m_numCancelledEvents)
+			compactEvents();
+		return m_events[index];
+	}
+
+	void	clearEvents();
+
+	bool	isOverlapping(const btCollisionObject* colObj) const
+	{
+		return m_overlapMap.find(colObj) != 0;
+	}
+};
+
 
 ///The btGhostPairCallback interfaces and forwards adding and removal of overlapping pairs from the btBroadphaseInterface to btGhostObject.
 class btGhostPairCallback : public btOverlappingPairCallback
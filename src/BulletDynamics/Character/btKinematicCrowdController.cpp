@@ -0,0 +1,666 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2015 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btKinematicCrowdController.h"
+
+#include "LinearMath/btIDebugDraw.h"
+#include "LinearMath/btAabbUtil2.h"
+#include "LinearMath/btTransformUtil.h"
+#include "LinearMath/btThreads.h"
+#include "BulletCollision/CollisionShapes/btConvexShape.h"
+#include "BulletCollision/CollisionDispatch/btCollisionWorld.h"
+#include "BulletCollision/CollisionDispatch/btCollisionConfiguration.h"
+#include "BulletCollision/CollisionDispatch/btCollisionObjectWrapper.h"
+#include "BulletCollision/CollisionDispatch/btCollisionQueryDispatcher.h"
+#include "BulletCollision/CollisionDispatch/btManifoldResult.h"
+#include "BulletCollision/NarrowPhaseCollision/btPersistentManifold.h"
+
+
+static const btVector3& btCrowdUpAxisDirection(int upAxis)
+{
+	static btVector3 sUpAxisDirection[3] = { btVector3(1.0f, 0.0f, 0.0f), btVector3(0.0f, 1.0f, 0.0f), btVector3(0.0f, 0.0f, 1.0f) };
+	return sUpAxisDirection[upAxis];
+}
+
+static btVector3 btCrowdNormalizedVector(const btVector3& v)
+{
+	btVector3 n(0, 0, 0);
+	if (v.length() > SIMD_EPSILON)
+	{
+		n = v.normalized();
+	}
+	return n;
+}
+
+///same filtering as the btKinematicCharacterController sweeps: skip the character itself, objects without response, and too steep hits
+class btCrowdClosestNotMeConvexResultCallback : public btCollisionWorld::ClosestConvexResultCallback
+{
+public:
+	btCrowdClosestNotMeConvexResultCallback (const btCollisionObject* me, const btVector3& up, btScalar minSlopeDot)
+	: btCollisionWorld::ClosestConvexResultCallback(btVector3(0.0, 0.0, 0.0), btVector3(0.0, 0.0, 0.0))
+	, m_me(me)
+	, m_up(up)
+	, m_minSlopeDot(minSlopeDot)
+	{
+		m_collisionFilterGroup = me->getBroadphaseHandle()->m_collisionFilterGroup;
+		m_collisionFilterMask = me->getBroadphaseHandle()->m_collisionFilterMask;
+	}
+
+	virtual btScalar addSingleResult(btCollisionWorld::LocalConvexResult& convexResult,bool normalInWorldSpace)
+	{
+		if (convexResult.m_hitCollisionObject == m_me)
+			return btScalar(1.0);
+
+		if (!convexResult.m_hitCollisionObject->hasContactResponse())
+			return btScalar(1.0);
+
+		btVector3 hitNormalWorld;
+		if (normalInWorldSpace)
+		{
+			hitNormalWorld = convexResult.m_hitNormalLocal;
+		} else
+		{
+			hitNormalWorld = convexResult.m_hitCollisionObject->getWorldTransform().getBasis()*convexResult.m_hitNormalLocal;
+		}
+
+		btScalar dotUp = m_up.dot(hitNormalWorld);
+		if (dotUp < m_minSlopeDot)
+		{
+			return btScalar(1.0);
+		}
+
+		return ClosestConvexResultCallback::addSingleResult (convexResult, normalInWorldSpace);
+	}
+protected:
+	const btCollisionObject* m_me;
+	const btVector3 m_up;
+	btScalar m_minSlopeDot;
+};
+
+///btCrowdPenetrationResult pushes the character out along the contact normals, like btKinematicCharacterController::recoverFromPenetration
+struct btCrowdPenetrationResult : public btManifoldResult
+{
+	btVector3	m_recovery;
+	btVector3	m_touchingNormal;
+	btScalar	m_maxPen;
+	bool	m_penetration;
+
+	btCrowdPenetrationResult(const btCollisionObjectWrapper* obj0Wrap,const btCollisionObjectWrapper* obj1Wrap)
+		:btManifoldResult(obj0Wrap,obj1Wrap),
+		m_recovery(0,0,0),
+		m_touchingNormal(0,0,0),
+		m_maxPen(0),
+		m_penetration(false)
+	{
+	}
+
+	virtual void addContactPoint(const btVector3& normalOnBInWorld,const btVector3& pointInWorld,btScalar depth)
+	{
+		(void)pointInWorld;
+		if (depth >= btScalar(0.))
+			return;
+
+		//the normal points towards the first body of the manifold, the character is body 0 unless the algorithm swapped them
+		bool isSwapped = m_manifoldPtr && m_manifoldPtr->getBody0() != m_body0Wrap->getCollisionObject();
+		btVector3 normal = isSwapped ? normalOnBInWorld : -normalOnBInWorld;
+		if (depth < m_maxPen)
+		{
+			m_maxPen = depth;
+			m_touchingNormal = normal;
+		}
+		m_recovery += normal * depth * btScalar(0.2);
+		m_penetration = true;
+	}
+};
+
+
+///btCrowdCharacterStep runs one step of a single character, it only reads shared data so many can run concurrently
+class btCrowdCharacterStep
+{
+	btKinematicCrowdController::Character&	m_ch;
+	btCollisionObject* const*	m_candidates;
+	int	m_numCandidates;
+	const btVector3&	m_up;
+	btScalar	m_addedMargin;
+	bool	m_interpolateUp;
+	btScalar	m_allowedCcdPenetration;
+
+	void	sweep(const btVector3& from, const btVector3& to, btCollisionWorld::ConvexResultCallback& callback) const
+	{
+		btTransform fromTrans = m_ch.m_collisionObject->getWorldTransform();
+		btTransform toTrans = fromTrans;
+		fromTrans.setOrigin(from);
+		toTrans.setOrigin(to);
+
+		btVector3 castShapeAabbMin, castShapeAabbMax;
+		{
+			btTransform R;
+			R.setIdentity();
+			R.setBasis(fromTrans.getBasis());
+			m_ch.m_convexShape->calculateTemporalAabb(R, to - from, btVector3(0,0,0), btScalar(1.0), castShapeAabbMin, castShapeAabbMax);
+		}
+
+		for (int i=0;i<m_numCandidates;i++)
+		{
+			btCollisionObject* collisionObject = m_candidates[i];
+			if (!callback.needsCollision(collisionObject->getBroadphaseHandle()))
+				continue;
+			btVector3 collisionObjectAabbMin,collisionObjectAabbMax;
+			collisionObject->getCollisionShape()->getAabb(collisionObject->getWorldTransform(),collisionObjectAabbMin,collisionObjectAabbMax);
+			AabbExpand(collisionObjectAabbMin, collisionObjectAabbMax, castShapeAabbMin, castShapeAabbMax);
+			btScalar hitLambda = btScalar(1.);
+			btVector3 hitNormal;
+			if (btRayAabb(from,to,collisionObjectAabbMin,collisionObjectAabbMax,hitLambda,hitNormal))
+			{
+				btCollisionWorld::objectQuerySingle(m_ch.m_convexShape, fromTrans, toTrans,
+					collisionObject,
+					collisionObject->getCollisionShape(),
+					collisionObject->getWorldTransform(),
+					callback,
+					m_allowedCcdPenetration);
+			}
+		}
+	}
+
+	bool	recoverFromPenetration(btCollisionQueryDispatcher& dispatcher, const btDispatcherInfo& dispatchInfo)
+	{
+		//a stand-in object, so the algorithms see the character at its current (recovered) position
+		btTransform trans = m_ch.m_collisionObject->getWorldTransform();
+		trans.setOrigin(m_ch.m_currentPosition);
+		btCollisionObject queryObject;
+		queryObject.setCollisionShape(m_ch.m_convexShape);
+		queryObject.setWorldTransform(trans);
+		btCollisionObjectWrapper ob0(0,m_ch.m_convexShape,&queryObject,trans,-1,-1);
+
+		btVector3 recovery(0,0,0);
+		btScalar maxPen = btScalar(0.0);
+		bool penetration = false;
+		for (int i=0;i<m_numCandidates;i++)
+		{
+			const btCollisionObject* collisionObject = m_candidates[i];
+			if (!collisionObject->hasContactResponse())
+				continue;
+			btCollisionObjectWrapper ob1(0,collisionObject->getCollisionShape(),collisionObject,collisionObject->getWorldTransform(),-1,-1);
+			btCrowdPenetrationResult result(&ob0,&ob1);
+			dispatcher.processCollision(&ob0,&ob1,dispatchInfo,&result);
+			if (result.m_penetration)
+			{
+				if (result.m_maxPen < maxPen)
+				{
+					maxPen = result.m_maxPen;
+					m_ch.m_touchingNormal = result.m_touchingNormal;
+				}
+				recovery += result.m_recovery;
+				penetration = true;
+			}
+		}
+		m_ch.m_currentPosition += recovery;
+		return penetration;
+	}
+
+	void	stepUp()
+	{
+		m_ch.m_targetPosition = m_ch.m_currentPosition + m_up * (m_ch.m_stepHeight + (m_ch.m_verticalOffset > 0.f?m_ch.m_verticalOffset:0.f));
+
+		btVector3 start = m_ch.m_currentPosition + m_up * (m_ch.m_convexShape->getMargin() + m_addedMargin);
+
+		btCrowdClosestNotMeConvexResultCallback callback(m_ch.m_collisionObject, -m_up, btScalar(0.7071));
+		sweep(start, m_ch.m_targetPosition, callback);
+
+		if (callback.hasHit())
+		{
+			// Only modify the position if the hit was a slope and not a wall or ceiling.
+			if (callback.m_hitNormalWorld.dot(m_up) > 0.0)
+			{
+				m_ch.m_currentStepOffset = m_ch.m_stepHeight * callback.m_closestHitFraction;
+				if (m_interpolateUp)
+					m_ch.m_currentPosition.setInterpolate3(m_ch.m_currentPosition, m_ch.m_targetPosition, callback.m_closestHitFraction);
+				else
+					m_ch.m_currentPosition = m_ch.m_targetPosition;
+			}
+			m_ch.m_verticalVelocity = 0.0;
+			m_ch.m_verticalOffset = 0.0;
+		} else
+		{
+			m_ch.m_currentStepOffset = m_ch.m_stepHeight;
+			m_ch.m_currentPosition = m_ch.m_targetPosition;
+		}
+	}
+
+	void	updateTargetPositionBasedOnCollision(const btVector3& hitNormal)
+	{
+		btVector3 movementDirection = m_ch.m_targetPosition - m_ch.m_currentPosition;
+		btScalar movementLength = movementDirection.length();
+		if (movementLength>SIMD_EPSILON)
+		{
+			movementDirection.normalize();
+
+			btVector3 reflectDir = movementDirection - (btScalar(2.0) * movementDirection.dot(hitNormal)) * hitNormal;
+			reflectDir.normalize();
+
+			btVector3 perpindicularDir = reflectDir - hitNormal * reflectDir.dot(hitNormal);
+
+			m_ch.m_targetPosition = m_ch.m_currentPosition + perpindicularDir * movementLength;
+		}
+	}
+
+	void	stepForwardAndStrafe()
+	{
+		m_ch.m_targetPosition = m_ch.m_currentPosition + m_ch.m_walkDirection;
+
+		btScalar fraction = 1.0;
+		int maxIter = 10;
+
+		while (fraction > btScalar(0.01) && maxIter-- > 0)
+		{
+			btVector3 sweepDirNegative(m_ch.m_currentPosition - m_ch.m_targetPosition);
+
+			btCrowdClosestNotMeConvexResultCallback callback(m_ch.m_collisionObject, sweepDirNegative, btScalar(0.0));
+			sweep(m_ch.m_currentPosition, m_ch.m_targetPosition, callback);
+
+			fraction -= callback.m_closestHitFraction;
+
+			if (callback.hasHit())
+			{
+				updateTargetPositionBasedOnCollision(callback.m_hitNormalWorld);
+				btVector3 currentDir = m_ch.m_targetPosition - m_ch.m_currentPosition;
+				if (currentDir.length2() > SIMD_EPSILON)
+				{
+					currentDir.normalize();
+					/* See Quake2: "If velocity is against original velocity, stop ead to avoid tiny oscilations in sloping corners." */
+					if (currentDir.dot(m_ch.m_normalizedDirection) <= btScalar(0.0))
+					{
+						break;
+					}
+				} else
+				{
+					break;
+				}
+			} else
+			{
+				m_ch.m_currentPosition = m_ch.m_targetPosition;
+			}
+		}
+	}
+
+	void	stepDown(btScalar dt)
+	{
+		btVector3 orig_position = m_ch.m_targetPosition;
+
+		btScalar downVelocity = (m_ch.m_verticalVelocity<0.f?-m_ch.m_verticalVelocity:0.f) * dt;
+		if (downVelocity > 0.0 && downVelocity > m_ch.m_fallSpeed && (m_ch.m_wasOnGround || !m_ch.m_wasJumping))
+			downVelocity = m_ch.m_fallSpeed;
+
+		btVector3 step_drop = m_up * (m_ch.m_currentStepOffset + downVelocity);
+		m_ch.m_targetPosition -= step_drop;
+
+		btScalar hitFraction = btScalar(1.);
+		bool hit = false;
+		bool runonce = false;
+
+		while (1)
+		{
+			//one sweep over twice the step drop answers both the single and the double drop test:
+			//the single drop hits if the double drop hits within its first half
+			btCrowdClosestNotMeConvexResultCallback callback(m_ch.m_collisionObject, m_up, m_ch.m_maxSlopeCosine);
+			sweep(m_ch.m_currentPosition, m_ch.m_targetPosition - step_drop, callback);
+
+			btScalar singleFraction = callback.m_closestHitFraction * btScalar(2.);
+			hit = callback.hasHit() && singleFraction <= btScalar(1.);
+			hitFraction = hit ? singleFraction : btScalar(1.);
+			bool doubleHit = callback.hasHit();
+
+			btScalar downVelocity2 = (m_ch.m_verticalVelocity<0.f?-m_ch.m_verticalVelocity:0.f) * dt;
+			if (downVelocity2 > 0.0 && downVelocity2 < m_ch.m_stepHeight && doubleHit && !runonce
+				&& (m_ch.m_wasOnGround || !m_ch.m_wasJumping))
+			{
+				//redo the velocity calculation when falling a small amount, for fast stairs motion
+				m_ch.m_targetPosition = orig_position;
+				downVelocity = m_ch.m_stepHeight;
+				step_drop = m_up * (m_ch.m_currentStepOffset + downVelocity);
+				m_ch.m_targetPosition -= step_drop;
+				runonce = true;
+				continue;
+			}
+			break;
+		}
+
+		if (hit || runonce)
+		{
+			// we dropped a fraction of the height -> hit floor
+			m_ch.m_currentPosition.setInterpolate3(m_ch.m_currentPosition, m_ch.m_targetPosition, hitFraction);
+			m_ch.m_verticalVelocity = 0.0;
+			m_ch.m_verticalOffset = 0.0;
+			m_ch.m_wasJumping = false;
+		} else
+		{
+			m_ch.m_currentPosition = m_ch.m_targetPosition;
+		}
+	}
+
+public:
+
+	btCrowdCharacterStep(btKinematicCrowdController::Character& ch, btCollisionObject* const* candidates, const btVector3& up, btScalar addedMargin, bool interpolateUp, btScalar allowedCcdPenetration)
+		:m_ch(ch),
+		m_candidates(candidates + ch.m_firstCandidate),
+		m_numCandidates(ch.m_numCandidates),
+		m_up(up),
+		m_addedMargin(addedMargin),
+		m_interpolateUp(interpolateUp),
+		m_allowedCcdPenetration(allowedCcdPenetration)
+	{
+	}
+
+	void	preStep(btCollisionQueryDispatcher* dispatcher, const btDispatcherInfo& dispatchInfo)
+	{
+		m_ch.m_currentPosition = m_ch.m_collisionObject->getWorldTransform().getOrigin();
+		m_ch.m_touchingContact = false;
+		if (dispatcher)
+		{
+			int numPenetrationLoops = 0;
+			while (recoverFromPenetration(*dispatcher, dispatchInfo))
+			{
+				numPenetrationLoops++;
+				m_ch.m_touchingContact = true;
+				if (numPenetrationLoops > 4)
+				{
+					break;
+				}
+			}
+		}
+		m_ch.m_targetPosition = m_ch.m_currentPosition;
+	}
+
+	void	playerStep(btScalar dt)
+	{
+		m_ch.m_wasOnGround = m_ch.onGround();
+
+		// Update fall velocity.
+		m_ch.m_verticalVelocity -= m_ch.m_gravity * dt;
+		if (m_ch.m_verticalVelocity > 0.0 && m_ch.m_verticalVelocity > m_ch.m_jumpSpeed)
+		{
+			m_ch.m_verticalVelocity = m_ch.m_jumpSpeed;
+		}
+		if (m_ch.m_verticalVelocity < 0.0 && btFabs(m_ch.m_verticalVelocity) > btFabs(m_ch.m_fallSpeed))
+		{
+			m_ch.m_verticalVelocity = -btFabs(m_ch.m_fallSpeed);
+		}
+		m_ch.m_verticalOffset = m_ch.m_verticalVelocity * dt;
+
+		stepUp();
+		stepForwardAndStrafe();
+		stepDown(dt);
+	}
+};
+
+///btCrowdStepLoop steps a range of characters, with one pooled query dispatcher of the world per range for the penetration recovery
+struct btCrowdStepLoop : public btIParallelForBody
+{
+	btAlignedObjectArray<btKinematicCrowdController::Character>&	m_characters;
+	btCollisionObject* const*	m_candidates;
+	btCollisionWorld*	m_collisionWorld;
+	const btDispatcherInfo&	m_dispatchInfo;
+	const btVector3&	m_up;
+	btScalar	m_addedMargin;
+	bool	m_interpolateUp;
+	btScalar	m_dt;
+
+	btCrowdStepLoop(btAlignedObjectArray<btKinematicCrowdController::Character>& characters, btCollisionObject* const* candidates, btCollisionWorld* collisionWorld,
+		const btDispatcherInfo& dispatchInfo, const btVector3& up, btScalar addedMargin, bool interpolateUp, btScalar dt)
+		:m_characters(characters),
+		m_candidates(candidates),
+		m_collisionWorld(collisionWorld),
+		m_dispatchInfo(dispatchInfo),
+		m_up(up),
+		m_addedMargin(addedMargin),
+		m_interpolateUp(interpolateUp),
+		m_dt(dt)
+	{
+	}
+
+	virtual void forLoop(int iBegin, int iEnd) const
+	{
+		btCollisionQueryDispatcher* dispatcher = m_collisionWorld->acquireQueryDispatcher();
+		btDispatcherInfo dispatchInfo = m_dispatchInfo;
+		dispatchInfo.m_dispatchFunc = btDispatcherInfo::DISPATCH_DISCRETE;
+		for (int i=iBegin;i<iEnd;i++)
+		{
+			btCrowdCharacterStep step(m_characters[i], m_candidates, m_up, m_addedMargin, m_interpolateUp, m_dispatchInfo.m_allowedCcdPenetration);
+			step.preStep(dispatcher, dispatchInfo);
+			step.playerStep(m_dt);
+		}
+		m_collisionWorld->releaseQueryDispatcher(dispatcher);
+	}
+};
+
+
+btKinematicCrowdController::btKinematicCrowdController(int upAxis)
+:m_upAxis(btMax(0,btMin(upAxis,2))),
+m_addedMargin(btScalar(0.02)),
+m_interpolateUp(true),
+m_multithreaded(false)
+{
+}
+
+btKinematicCrowdController::~btKinematicCrowdController()
+{
+}
+
+int	btKinematicCrowdController::addCharacter(btCollisionObject* collisionObject, btConvexShape* convexShape, btScalar stepHeight)
+{
+	btAssert(collisionObject && convexShape);
+	Character& ch = m_characters.expandNonInitializing();
+	ch.m_collisionObject = collisionObject;
+	ch.m_convexShape = convexShape;
+	ch.m_walkDirection.setValue(0,0,0);
+	ch.m_normalizedDirection.setValue(0,0,0);
+	ch.m_currentPosition = collisionObject->getWorldTransform().getOrigin();
+	ch.m_targetPosition = ch.m_currentPosition;
+	ch.m_touchingNormal.setValue(0,0,0);
+	ch.m_stepHeight = stepHeight;
+	ch.m_currentStepOffset = 0;
+	ch.m_verticalVelocity = 0;
+	ch.m_verticalOffset = 0;
+	ch.m_fallSpeed = 55.0; // Terminal velocity of a sky diver in m/s.
+	ch.m_jumpSpeed = 10.0;
+	ch.m_maxSlopeCosine = btCos(btRadians(45.0));
+	ch.m_gravity = 9.8 * 3; // 3G acceleration.
+	ch.m_touchingContact = false;
+	ch.m_wasOnGround = false;
+	ch.m_wasJumping = false;
+	ch.m_firstCandidate = 0;
+	ch.m_numCandidates = 0;
+	return m_characters.size()-1;
+}
+
+void	btKinematicCrowdController::removeCharacter(int characterIndex)
+{
+	btAssert(characterIndex >= 0 && characterIndex < m_characters.size());
+	m_characters.swap(characterIndex,m_characters.size()-1);
+	m_characters.pop_back();
+}
+
+void	btKinematicCrowdController::setWalkDirection(int characterIndex, const btVector3& walkDirection)
+{
+	Character& ch = m_characters[characterIndex];
+	ch.m_walkDirection = walkDirection;
+	ch.m_normalizedDirection = btCrowdNormalizedVector(walkDirection);
+}
+
+void	btKinematicCrowdController::warp(int characterIndex, const btVector3& origin)
+{
+	Character& ch = m_characters[characterIndex];
+	btTransform xform;
+	xform.setIdentity();
+	xform.setOrigin(origin);
+	ch.m_collisionObject->setWorldTransform(xform);
+	ch.m_currentPosition = origin;
+	ch.m_targetPosition = origin;
+}
+
+void	btKinematicCrowdController::jump(int characterIndex)
+{
+	Character& ch = m_characters[characterIndex];
+	if (!ch.onGround())
+		return;
+	ch.m_verticalVelocity = ch.m_jumpSpeed;
+	ch.m_wasJumping = true;
+}
+
+void	btKinematicCrowdController::setMaxSlope(int characterIndex, btScalar slopeRadians)
+{
+	m_characters[characterIndex].m_maxSlopeCosine = btCos(slopeRadians);
+}
+
+
+///collects the broadphase overlaps of all characters, tagged with the character index
+struct btCrowdCandidateCallback : public btBroadphaseAabbBatchCallback
+{
+	struct Candidate
+	{
+		int	m_characterIndex;
+		btCollisionObject*	m_object;
+	};
+
+	const btAlignedObjectArray<btKinematicCrowdController::Character>&	m_characters;
+	btAlignedObjectArray<Candidate>	m_found;
+
+	btCrowdCandidateCallback(const btAlignedObjectArray<btKinematicCrowdController::Character>& characters)
+		:m_characters(characters)
+	{
+	}
+
+	virtual bool	process(int aabbIndex, const btBroadphaseProxy* proxy)
+	{
+		btCollisionObject* collisionObject = (btCollisionObject*)proxy->m_clientObject;
+		const btCollisionObject* me = m_characters[aabbIndex].m_collisionObject;
+		if (collisionObject == me || !collisionObject->hasContactResponse())
+			return true;
+		const btBroadphaseProxy* myProxy = me->getBroadphaseHandle();
+		bool collides = (proxy->m_collisionFilterGroup & myProxy->m_collisionFilterMask) != 0;
+		collides = collides && (myProxy->m_collisionFilterGroup & proxy->m_collisionFilterMask);
+		if (collides)
+		{
+			Candidate& c = m_found.expandNonInitializing();
+			c.m_characterIndex = aabbIndex;
+			c.m_object = collisionObject;
+		}
+		return true;
+	}
+};
+
+void	btKinematicCrowdController::gatherCandidates(btCollisionWorld* collisionWorld, btScalar dt)
+{
+	int numCharacters = m_characters.size();
+	btAlignedObjectArray<btVector3> aabbMins;
+	btAlignedObjectArray<btVector3> aabbMaxs;
+	aabbMins.resize(numCharacters);
+	aabbMaxs.resize(numCharacters);
+
+	for (int i=0;i<numCharacters;i++)
+	{
+		const Character& ch = m_characters[i];
+		ch.m_convexShape->getAabb(ch.m_collisionObject->getWorldTransform(),aabbMins[i],aabbMaxs[i]);
+
+		//bound the reach of the whole step: recovery, step up, walk, and a double step down
+		btScalar verticalSpeed = btMin(btFabs(ch.m_verticalVelocity) + ch.m_gravity * dt, btMax(btFabs(ch.m_fallSpeed),ch.m_jumpSpeed));
+		btScalar vertical = btScalar(4.) * ch.m_stepHeight + btScalar(2.) * verticalSpeed * dt;
+		btScalar horizontal = ch.m_walkDirection.length() + m_addedMargin + ch.m_convexShape->getMargin();
+		btVector3 expand(horizontal,horizontal,horizontal);
+		expand[m_upAxis] += vertical;
+		aabbMins[i] -= expand;
+		aabbMaxs[i] += expand;
+	}
+
+	btCrowdCandidateCallback callback(m_characters);
+	if (numCharacters)
+	{
+		collisionWorld->getBroadphase()->aabbTestBatch(&aabbMins[0],&aabbMaxs[0],numCharacters,callback);
+	}
+
+	//bucket the candidates by character
+	for (int i=0;i<numCharacters;i++)
+	{
+		m_characters[i].m_numCandidates = 0;
+	}
+	for (int i=0;i<callback.m_found.size();i++)
+	{
+		m_characters[callback.m_found[i].m_characterIndex].m_numCandidates++;
+	}
+	int offset = 0;
+	for (int i=0;i<numCharacters;i++)
+	{
+		m_characters[i].m_firstCandidate = offset;
+		offset += m_characters[i].m_numCandidates;
+		m_characters[i].m_numCandidates = 0;
+	}
+	m_candidates.resize(offset);
+	for (int i=0;i<callback.m_found.size();i++)
+	{
+		Character& ch = m_characters[callback.m_found[i].m_characterIndex];
+		m_candidates[ch.m_firstCandidate + ch.m_numCandidates++] = callback.m_found[i].m_object;
+	}
+}
+
+void	btKinematicCrowdController::updateAction(btCollisionWorld* collisionWorld, btScalar deltaTime)
+{
+	int numCharacters = m_characters.size();
+	if (!numCharacters)
+		return;
+
+	gatherCandidates(collisionWorld, deltaTime);
+
+	btCollisionObject* const* candidates = m_candidates.size() ? &m_candidates[0] : 0;
+	btCrowdStepLoop loop(m_characters, candidates, collisionWorld, collisionWorld->getDispatchInfo(),
+		btCrowdUpAxisDirection(m_upAxis), m_addedMargin, m_interpolateUp, deltaTime);
+
+	//the query dispatchers need a btConvexConvexAlgorithm to not share the solvers of the collision configuration
+	bool multithreaded = false;
+	if (m_multithreaded && collisionWorld->getCollisionConfiguration())
+	{
+		int numPerturbationIterations, minimumPointsPerturbationThreshold;
+		multithreaded = collisionWorld->getCollisionConfiguration()->getConvexConvexCreateFunc(numPerturbationIterations,minimumPointsPerturbationThreshold)!=0;
+	}
+	if (multithreaded)
+	{
+		btParallelFor(0, numCharacters, 16, loop);
+	} else
+	{
+		loop.forLoop(0, numCharacters);
+	}
+
+	//write back, the characters saw each other at their previous positions during the pass
+	for (int i=0;i<numCharacters;i++)
+	{
+		Character& ch = m_characters[i];
+		btTransform xform = ch.m_collisionObject->getWorldTransform();
+		xform.setOrigin(ch.m_currentPosition);
+		ch.m_collisionObject->setWorldTransform(xform);
+		collisionWorld->updateSingleAabb(ch.m_collisionObject);
+	}
+}
+
+void	btKinematicCrowdController::debugDraw(btIDebugDraw* debugDrawer)
+{
+	for (int i=0;i<m_characters.size();i++)
+	{
+		const Character& ch = m_characters[i];
+		debugDrawer->drawLine(ch.m_currentPosition, ch.m_currentPosition + ch.m_walkDirection, btVector3(1,1,0));
+		if (ch.m_touchingContact)
+		{
+			debugDrawer->drawLine(ch.m_currentPosition, ch.m_currentPosition + ch.m_touchingNormal, btVector3(1,0,0));
+		}
+	}
+}
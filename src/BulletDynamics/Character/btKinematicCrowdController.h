@@ -0,0 +1,149 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2015 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_KINEMATIC_CROWD_CONTROLLER_H
+#define BT_KINEMATIC_CROWD_CONTROLLER_H
+
+#include "LinearMath/btVector3.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "BulletDynamics/Dynamics/btActionInterface.h"
+
+class btCollisionObject;
+class btConvexShape;
+class btCollisionWorld;
+
+///btKinematicCrowdController moves many kinematic characters with the stepUp / stepForwardAndStrafe / stepDown
+///scheme of btKinematicCharacterController, but updates all of them in one pass:
+///one broadphase query gathers the candidate objects around every character for the whole step,
+///then all sweeps and the penetration recovery of a character only test against its candidates,
+///and characters are processed in parallel through btParallelFor.
+///During the pass characters see each other at their previous positions, the new positions are written back at the end.
+///The character objects don't need to be ghost objects, and no per-character pair cache is kept.
+ATTRIBUTE_ALIGNED16(class) btKinematicCrowdController : public btActionInterface
+{
+public:
+
+	ATTRIBUTE_ALIGNED16(struct) Character
+	{
+		BT_DECLARE_ALIGNED_ALLOCATOR();
+
+		btCollisionObject*	m_collisionObject;
+		btConvexShape*	m_convexShape;
+
+		///displacement per simulation step, see btKinematicCharacterController::setWalkDirection
+		btVector3	m_walkDirection;
+		btVector3	m_normalizedDirection;
+
+		btVector3	m_currentPosition;
+		btVector3	m_targetPosition;
+		btVector3	m_touchingNormal;
+
+		btScalar	m_stepHeight;
+		btScalar	m_currentStepOffset;
+		btScalar	m_verticalVelocity;
+		btScalar	m_verticalOffset;
+		btScalar	m_fallSpeed;
+		btScalar	m_jumpSpeed;
+		btScalar	m_maxSlopeCosine;
+		btScalar	m_gravity;
+
+		bool	m_touchingContact;
+		bool	m_wasOnGround;
+		bool	m_wasJumping;
+
+		//range in m_candidates, valid during updateAction
+		int	m_firstCandidate;
+		int	m_numCandidates;
+
+		bool	onGround() const
+		{
+			return m_verticalVelocity == btScalar(0.) && m_verticalOffset == btScalar(0.);
+		}
+	};
+
+protected:
+
+	btAlignedObjectArray<Character>	m_characters;
+	btAlignedObjectArray<btCollisionObject*>	m_candidates;
+
+	int	m_upAxis;
+	btScalar	m_addedMargin;
+	bool	m_interpolateUp;
+	bool	m_multithreaded;
+
+	void	gatherCandidates(btCollisionWorld* collisionWorld, btScalar dt);
+
+public:
+
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	btKinematicCrowdController(int upAxis = 1);
+
+	virtual ~btKinematicCrowdController();
+
+	///addCharacter returns the index of the new character. The collision object must already be part of the world.
+	int	addCharacter(btCollisionObject* collisionObject, btConvexShape* convexShape, btScalar stepHeight);
+
+	///removeCharacter moves the last character into the freed index
+	void	removeCharacter(int characterIndex);
+
+	int	getNumCharacters() const
+	{
+		return m_characters.size();
+	}
+
+	Character&	getCharacter(int characterIndex)
+	{
+		return m_characters[characterIndex];
+	}
+
+	const Character&	getCharacter(int characterIndex) const
+	{
+		return m_characters[characterIndex];
+	}
+
+	void	setWalkDirection(int characterIndex, const btVector3& walkDirection);
+
+	void	warp(int characterIndex, const btVector3& origin);
+
+	void	jump(int characterIndex);
+
+	void	setMaxSlope(int characterIndex, btScalar slopeRadians);
+
+	void	setUpAxis(int axis)
+	{
+		m_upAxis = btMax(0,btMin(axis,2));
+	}
+
+	void	setUpInterpolate(bool value)
+	{
+		m_interpolateUp = value;
+	}
+
+	///with multithreading enabled the characters are distributed over btParallelFor,
+	///the convex shapes of the characters are not modified so they can be shared
+	void	setMultithreaded(bool multithreaded)
+	{
+		m_multithreaded = multithreaded;
+	}
+
+	///btActionInterface interface
+	virtual void	updateAction(btCollisionWorld* collisionWorld, btScalar deltaTime);
+
+	///btActionInterface interface
+	virtual void	debugDraw(btIDebugDraw* debugDrawer);
+};
+
+#endif //BT_KINEMATIC_CROWD_CONTROLLER_H
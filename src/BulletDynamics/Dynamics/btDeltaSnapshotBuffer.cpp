@@ -0,0 +1,592 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2015 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btDeltaSnapshotBuffer.h"
+#include "btDynamicsWorld.h"
+#include "btRigidBody.h"
+#include "BulletCollision/BroadphaseCollision/btDispatcher.h"
+#include "BulletCollision/NarrowPhaseCollision/btPersistentManifold.h"
+#include "LinearMath/btMotionState.h"
+
+#include <string.h>
+
+///the snapshot data is byte packed, all structs are read and written with memcpy
+struct btSnapshotHeader
+{
+	int	m_numCollisionObjects;
+	int	m_numBodies;
+	int	m_numManifolds;
+	int	m_keyframe;
+};
+
+struct btSnapshotBodyData
+{
+	int			m_index;
+	int			m_activationState;
+	btScalar	m_deactivationTime;
+	btScalar	m_origin[3];
+	btScalar	m_basis[9];
+	btScalar	m_linearVelocity[3];
+	btScalar	m_angularVelocity[3];
+};
+
+struct btSnapshotQuantizedBodyData
+{
+	int				m_index;
+	unsigned char	m_activationState;
+	///index of the largest quaternion component, the other three are stored in m_rotation
+	unsigned char	m_largestComponent;
+	short			m_rotation[3];
+	float			m_origin[3];
+	short			m_linearVelocity[3];
+	short			m_angularVelocity[3];
+	float			m_deactivationTime;
+};
+
+struct btSnapshotManifoldData
+{
+	int	m_index0;
+	int	m_index1;
+	int	m_numContacts;
+};
+
+struct btSnapshotContactData
+{
+	btScalar	m_localPointA[3];
+	btScalar	m_appliedImpulse;
+	btScalar	m_appliedImpulseLateral1;
+	btScalar	m_appliedImpulseLateral2;
+};
+
+//the three smallest components of a unit quaternion are within [-1/sqrt(2), 1/sqrt(2)]
+static const btScalar s_rotationScale = btScalar(32767.) * SIMDSQRT12;
+
+static short quantizeShort(btScalar value)
+{
+	if (value > btScalar(32767.))
+		return 32767;
+	if (value < btScalar(-32767.))
+		return -32767;
+	return short(value >= btScalar(0.) ? value + btScalar(0.5) : value - btScalar(0.5));
+}
+
+
+btDeltaSnapshotBuffer::btDeltaSnapshotBuffer(int bufferSize, int flags, int keyframeInterval)
+:m_bufferSize(bufferSize),
+m_writeOffset(0),
+m_firstEntry(0),
+m_nextId(0),
+m_flags(flags),
+m_keyframeInterval(keyframeInterval > 0 ? keyframeInterval : 1),
+m_snapshotsSinceKeyframe(0),
+m_forceKeyframe(true),
+m_velocityQuantum(btScalar(1.)/btScalar(256.))
+{
+	m_buffer = (unsigned char*)btAlignedAlloc(bufferSize,16);
+}
+
+btDeltaSnapshotBuffer::~btDeltaSnapshotBuffer()
+{
+	btAlignedFree(m_buffer);
+}
+
+int btDeltaSnapshotBuffer::getRecordSize() const
+{
+	return (m_flags & BT_SNAPSHOT_QUANTIZED) ? sizeof(btSnapshotQuantizedBodyData) : sizeof(btSnapshotBodyData);
+}
+
+void btDeltaSnapshotBuffer::encodeBody(const btCollisionObject* colObj, int index, unsigned char* record) const
+{
+	const btRigidBody* body = btRigidBody::upcast(colObj);
+	const btTransform& tr = body->getWorldTransform();
+	const btVector3& linVel = body->getLinearVelocity();
+	const btVector3& angVel = body->getAngularVelocity();
+
+	if (m_flags & BT_SNAPSHOT_QUANTIZED)
+	{
+		btSnapshotQuantizedBodyData data;
+		data.m_index = index;
+		data.m_activationState = (unsigned char)body->getActivationState();
+
+		btQuaternion rot = tr.getRotation();
+		int largest = 0;
+		for (int i=1;i<4;i++)
+		{
+			if (btFabs(rot[i]) > btFabs(rot[largest]))
+				largest = i;
+		}
+		//q and -q are the same rotation, make the dropped component positive
+		btScalar sign = rot[largest] < btScalar(0.) ? btScalar(-1.) : btScalar(1.);
+		data.m_largestComponent = (unsigned char)largest;
+		for (int i=0,j=0;i<4;i++)
+		{
+			if (i!=largest)
+				data.m_rotation[j++] = quantizeShort(sign*rot[i]*s_rotationScale);
+		}
+
+		btScalar invQuantum = btScalar(1.)/m_velocityQuantum;
+		for (int i=0;i<3;i++)
+		{
+			data.m_origin[i] = float(tr.getOrigin()[i]);
+			data.m_linearVelocity[i] = quantizeShort(linVel[i]*invQuantum);
+			data.m_angularVelocity[i] = quantizeShort(angVel[i]*invQuantum);
+		}
+		data.m_deactivationTime = float(body->getDeactivationTime());
+		memcpy(record,&data,sizeof(data));
+	} else
+	{
+		btSnapshotBodyData data;
+		data.m_index = index;
+		data.m_activationState = body->getActivationState();
+		data.m_deactivationTime = body->getDeactivationTime();
+		for (int i=0;i<3;i++)
+		{
+			data.m_origin[i] = tr.getOrigin()[i];
+			data.m_basis[i*3+0] = tr.getBasis()[i][0];
+			data.m_basis[i*3+1] = tr.getBasis()[i][1];
+			data.m_basis[i*3+2] = tr.getBasis()[i][2];
+			data.m_linearVelocity[i] = linVel[i];
+			data.m_angularVelocity[i] = angVel[i];
+		}
+		memcpy(record,&data,sizeof(data));
+	}
+}
+
+void btDeltaSnapshotBuffer::decodeBody(btCollisionObject* colObj, const unsigned char* record) const
+{
+	btRigidBody* body = btRigidBody::upcast(colObj);
+	if (!body)
+		return;
+
+	btTransform tr;
+	int activationState;
+	btScalar deactivationTime;
+
+	if (m_flags & BT_SNAPSHOT_QUANTIZED)
+	{
+		btSnapshotQuantizedBodyData data;
+		memcpy(&data,record,sizeof(data));
+
+		btScalar q[4];
+		btScalar sum = btScalar(0.);
+		for (int i=0,j=0;i<4;i++)
+		{
+			if (i!=data.m_largestComponent)
+			{
+				q[i] = btScalar(data.m_rotation[j++]) / s_rotationScale;
+				sum += q[i]*q[i];
+			}
+		}
+		q[data.m_largestComponent] = btSqrt(btMax(btScalar(0.),btScalar(1.)-sum));
+		btQuaternion rot(q[0],q[1],q[2],q[3]);
+		rot.normalize();
+		tr.setRotation(rot);
+		tr.setOrigin(btVector3(data.m_origin[0],data.m_origin[1],data.m_origin[2]));
+
+		body->setLinearVelocity(btVector3(data.m_linearVelocity[0],data.m_linearVelocity[1],data.m_linearVelocity[2])*m_velocityQuantum);
+		body->setAngularVelocity(btVector3(data.m_angularVelocity[0],data.m_angularVelocity[1],data.m_angularVelocity[2])*m_velocityQuantum);
+		activationState = data.m_activationState;
+		deactivationTime = data.m_deactivationTime;
+	} else
+	{
+		btSnapshotBodyData data;
+		memcpy(&data,record,sizeof(data));
+
+		tr.setOrigin(btVector3(data.m_origin[0],data.m_origin[1],data.m_origin[2]));
+		tr.getBasis().setValue(data.m_basis[0],data.m_basis[1],data.m_basis[2],
+			data.m_basis[3],data.m_basis[4],data.m_basis[5],
+			data.m_basis[6],data.m_basis[7],data.m_basis[8]);
+
+		body->setLinearVelocity(btVector3(data.m_linearVelocity[0],data.m_linearVelocity[1],data.m_linearVelocity[2]));
+		body->setAngularVelocity(btVector3(data.m_angularVelocity[0],data.m_angularVelocity[1],data.m_angularVelocity[2]));
+		activationState = data.m_activationState;
+		deactivationTime = data.m_deactivationTime;
+	}
+
+	//also copies the velocities into the interpolation velocities and updates the world inertia
+	body->setCenterOfMassTransform(tr);
+	body->forceActivationState(activationState);
+	body->setDeactivationTime(deactivationTime);
+	if (body->getMotionState())
+		body->getMotionState()->setWorldTransform(tr);
+}
+
+void btDeltaSnapshotBuffer::buildObjectIndices(btDynamicsWorld* world)
+{
+	const btCollisionObjectArray& objects = world->getCollisionObjectArray();
+	m_objectIndices.clear();
+	for (int i=0;i<objects.size();i++)
+	{
+		m_objectIndices.insert(btHashPtr(objects[i]),i);
+	}
+}
+
+int btDeltaSnapshotBuffer::writeContacts(btDynamicsWorld* world, int offset, int* numManifolds)
+{
+	btDispatcher* dispatcher = world->getDispatcher();
+	buildObjectIndices(world);
+
+	int size = 0;
+	for (int i=0;i<dispatcher->getNumManifolds();i++)
+	{
+		const btPersistentManifold* manifold = dispatcher->getManifoldByIndexInternal(i);
+		if (manifold->getNumContacts())
+			size += sizeof(btSnapshotManifoldData) + manifold->getNumContacts()*sizeof(btSnapshotContactData);
+	}
+	m_scratch.resize(offset+size);
+
+	*numManifolds = 0;
+	for (int i=0;i<dispatcher->getNumManifolds();i++)
+	{
+		const btPersistentManifold* manifold = dispatcher->getManifoldByIndexInternal(i);
+		if (!manifold->getNumContacts())
+			continue;
+		const int* index0 = m_objectIndices.find(btHashPtr(manifold->getBody0()));
+		const int* index1 = m_objectIndices.find(btHashPtr(manifold->getBody1()));
+		if (!index0 || !index1)
+			continue;
+
+		btSnapshotManifoldData manifoldData;
+		manifoldData.m_index0 = *index0;
+		manifoldData.m_index1 = *index1;
+		manifoldData.m_numContacts = manifold->getNumContacts();
+		memcpy(&m_scratch[offset],&manifoldData,sizeof(manifoldData));
+		offset += sizeof(manifoldData);
+
+		for (int j=0;j<manifold->getNumContacts();j++)
+		{
+			const btManifoldPoint& pt = manifold->getContactPoint(j);
+			btSnapshotContactData contact;
+			for (int k=0;k<3;k++)
+			{
+				contact.m_localPointA[k] = pt.m_localPointA[k];
+			}
+			contact.m_appliedImpulse = pt.m_appliedImpulse;
+			contact.m_appliedImpulseLateral1 = pt.m_appliedImpulseLateral1;
+			contact.m_appliedImpulseLateral2 = pt.m_appliedImpulseLateral2;
+			memcpy(&m_scratch[offset],&contact,sizeof(contact));
+			offset += sizeof(contact);
+		}
+		(*numManifolds)++;
+	}
+	return offset;
+}
+
+void btDeltaSnapshotBuffer::restoreContacts(btDynamicsWorld* world, const unsigned char* data, int numManifolds)
+{
+	buildObjectIndices(world);
+
+	m_storedManifolds.clear();
+	const unsigned char* cur = data;
+	for (int i=0;i<numManifolds;i++)
+	{
+		btSnapshotManifoldData manifoldData;
+		memcpy(&manifoldData,cur,sizeof(manifoldData));
+		m_storedManifolds.insert(btSnapshotPairKey(manifoldData.m_index0,manifoldData.m_index1),int(cur-data));
+		cur += sizeof(manifoldData) + manifoldData.m_numContacts*sizeof(btSnapshotContactData);
+	}
+
+	//the contact points that still exist are matched with the stored points, like btPersistentManifold::getCacheEntry
+	btDispatcher* dispatcher = world->getDispatcher();
+	for (int i=0;i<dispatcher->getNumManifolds();i++)
+	{
+		btPersistentManifold* manifold = dispatcher->getManifoldByIndexInternal(i);
+		if (!manifold->getNumContacts())
+			continue;
+		const int* index0 = m_objectIndices.find(btHashPtr(manifold->getBody0()));
+		const int* index1 = m_objectIndices.find(btHashPtr(manifold->getBody1()));
+		const int* stored = 0;
+		bool swapped = false;
+		if (index0 && index1)
+		{
+			stored = m_storedManifolds.find(btSnapshotPairKey(*index0,*index1));
+			if (!stored)
+			{
+				stored = m_storedManifolds.find(btSnapshotPairKey(*index1,*index0));
+				swapped = true;
+			}
+		}
+
+		btSnapshotManifoldData manifoldData;
+		manifoldData.m_numContacts = 0;
+		if (stored)
+			memcpy(&manifoldData,data+*stored,sizeof(manifoldData));
+		const unsigned char* contacts = stored ? data + *stored + sizeof(manifoldData) : 0;
+
+		btScalar threshold = manifold->getContactBreakingThreshold();
+		for (int j=0;j<manifold->getNumContacts();j++)
+		{
+			btManifoldPoint& pt = manifold->getContactPoint(j);
+			//the stored point A is on the body that is B in a swapped manifold
+			const btVector3& localPoint = swapped ? pt.m_localPointB : pt.m_localPointA;
+			btScalar shortestDist = threshold*threshold;
+			int nearest = -1;
+			btSnapshotContactData nearestContact;
+			for (int k=0;k<manifoldData.m_numContacts;k++)
+			{
+				btSnapshotContactData contact;
+				memcpy(&contact,contacts+k*sizeof(contact),sizeof(contact));
+				btVector3 diff = btVector3(contact.m_localPointA[0],contact.m_localPointA[1],contact.m_localPointA[2]) - localPoint;
+				btScalar distToPoint = diff.length2();
+				if (distToPoint < shortestDist)
+				{
+					shortestDist = distToPoint;
+					nearest = k;
+					nearestContact = contact;
+				}
+			}
+			if (nearest >= 0)
+			{
+				pt.m_appliedImpulse = nearestContact.m_appliedImpulse;
+				//the friction directions are not stable when the bodies are swapped
+				pt.m_appliedImpulseLateral1 = swapped ? btScalar(0.) : nearestContact.m_appliedImpulseLateral1;
+				pt.m_appliedImpulseLateral2 = swapped ? btScalar(0.) : nearestContact.m_appliedImpulseLateral2;
+			} else
+			{
+				pt.m_appliedImpulse = btScalar(0.);
+				pt.m_appliedImpulseLateral1 = btScalar(0.);
+				pt.m_appliedImpulseLateral2 = btScalar(0.);
+			}
+		}
+	}
+}
+
+const btDeltaSnapshotBuffer::btSnapshotEntry* btDeltaSnapshotBuffer::findEntry(int snapshotId) const
+{
+	//the ids in the buffer are consecutive
+	int numSnapshots = getNumSnapshots();
+	if (!numSnapshots)
+		return 0;
+	int index = snapshotId - m_entries[m_firstEntry].m_id;
+	if (index < 0 || index >= numSnapshots)
+		return 0;
+	return &m_entries[m_firstEntry+index];
+}
+
+void btDeltaSnapshotBuffer::popFrontEntry()
+{
+	m_firstEntry++;
+	if (m_firstEntry == m_entries.size())
+	{
+		m_entries.resize(0);
+		m_firstEntry = 0;
+	} else if (m_firstEntry >= 64 && m_firstEntry*2 >= m_entries.size())
+	{
+		int numSnapshots = getNumSnapshots();
+		for (int i=0;i<numSnapshots;i++)
+		{
+			m_entries[i] = m_entries[m_firstEntry+i];
+		}
+		m_entries.resize(numSnapshots);
+		m_firstEntry = 0;
+	}
+}
+
+int btDeltaSnapshotBuffer::captureSnapshot(btDynamicsWorld* world)
+{
+	const btCollisionObjectArray& objects = world->getCollisionObjectArray();
+	int numObjects = objects.size();
+	int recordSize = getRecordSize();
+
+	bool keyframe = m_forceKeyframe || m_snapshotsSinceKeyframe >= m_keyframeInterval || m_lastRecordValid.size() != numObjects;
+	if (keyframe)
+	{
+		m_lastRecords.resize(numObjects*recordSize);
+		m_lastRecordValid.resize(numObjects);
+		for (int i=0;i<numObjects;i++)
+		{
+			m_lastRecordValid[i] = 0;
+		}
+	}
+
+	int offset = sizeof(btSnapshotHeader);
+	m_scratch.resize(offset + numObjects*recordSize);
+
+	btSnapshotHeader header;
+	header.m_numCollisionObjects = numObjects;
+	header.m_numBodies = 0;
+	header.m_numManifolds = 0;
+	header.m_keyframe = keyframe;
+
+	for (int i=0;i<numObjects;i++)
+	{
+		const btCollisionObject* colObj = objects[i];
+		if (colObj->isStaticObject() || !btRigidBody::upcast(colObj))
+			continue;
+
+		unsigned char* record = &m_scratch[offset];
+		encodeBody(colObj,i,record);
+
+		unsigned char* lastRecord = &m_lastRecords[i*recordSize];
+		if (!keyframe && m_lastRecordValid[i] && memcmp(record,lastRecord,recordSize)==0)
+			continue;
+
+		memcpy(lastRecord,record,recordSize);
+		m_lastRecordValid[i] = 1;
+		offset += recordSize;
+		header.m_numBodies++;
+	}
+
+	if (m_flags & BT_SNAPSHOT_CONTACT_IMPULSES)
+	{
+		offset = writeContacts(world,offset,&header.m_numManifolds);
+	}
+	memcpy(&m_scratch[0],&header,sizeof(header));
+
+	int size = offset;
+	if (size > m_bufferSize)
+	{
+		m_forceKeyframe = true;
+		return -1;
+	}
+
+	if (m_writeOffset + size > m_bufferSize)
+	{
+		m_writeOffset = 0;
+	}
+
+	//overwrite every snapshot in the write range. After a wrap these are not the oldest ones,
+	//the snapshots of the previous lap at the end of the buffer are older, so they are dropped too
+	int numOverwritten = 0;
+	for (int i=m_firstEntry;i<m_entries.size();i++)
+	{
+		const btSnapshotEntry& entry = m_entries[i];
+		if (entry.m_offset < m_writeOffset + size && entry.m_offset + entry.m_size > m_writeOffset)
+			numOverwritten = i - m_firstEntry + 1;
+	}
+	for (int i=0;i<numOverwritten;i++)
+	{
+		popFrontEntry();
+	}
+	//the oldest snapshot has to be a keyframe, drop the deltas that depend on an overwritten keyframe
+	while (getNumSnapshots() && !m_entries[m_firstEntry].m_keyframe)
+	{
+		popFrontEntry();
+	}
+
+	if (!keyframe && !getNumSnapshots())
+	{
+		//the keyframe of this delta was overwritten
+		m_forceKeyframe = true;
+		return captureSnapshot(world);
+	}
+
+	memcpy(m_buffer + m_writeOffset,&m_scratch[0],size);
+
+	btSnapshotEntry entry;
+	entry.m_id = m_nextId++;
+	entry.m_offset = m_writeOffset;
+	entry.m_size = size;
+	entry.m_keyframe = keyframe;
+	m_entries.push_back(entry);
+
+	m_writeOffset += size;
+	m_forceKeyframe = false;
+	m_snapshotsSinceKeyframe = keyframe ? 1 : m_snapshotsSinceKeyframe+1;
+	return entry.m_id;
+}
+
+bool btDeltaSnapshotBuffer::restoreSnapshot(btDynamicsWorld* world, int snapshotId)
+{
+	const btSnapshotEntry* entry = findEntry(snapshotId);
+	if (!entry)
+		return false;
+
+	btCollisionObjectArray& objects = world->getCollisionObjectArray();
+	btSnapshotHeader header;
+	memcpy(&header,m_buffer + entry->m_offset,sizeof(header));
+	if (header.m_numCollisionObjects != objects.size())
+		return false;
+
+	//apply the keyframe and all deltas up to the snapshot, the oldest snapshot is always a keyframe
+	int last = int(entry - &m_entries[0]);
+	int first = last;
+	while (!m_entries[first].m_keyframe)
+		first--;
+
+	int recordSize = getRecordSize();
+	for (int i=first;i<=last;i++)
+	{
+		const unsigned char* data = m_buffer + m_entries[i].m_offset;
+		memcpy(&header,data,sizeof(header));
+		data += sizeof(header);
+		for (int j=0;j<header.m_numBodies;j++)
+		{
+			int index;
+			memcpy(&index,data,sizeof(int));
+			if (index >= 0 && index < objects.size())
+				decodeBody(objects[index],data);
+			data += recordSize;
+		}
+		if (i==last && header.m_numManifolds)
+			restoreContacts(world,data,header.m_numManifolds);
+	}
+
+	for (int i=0;i<objects.size();i++)
+	{
+		if (!objects[i]->isStaticObject() && btRigidBody::upcast(objects[i]))
+			world->updateSingleAabb(objects[i]);
+	}
+
+	m_forceKeyframe = true;
+	return true;
+}
+
+void btDeltaSnapshotBuffer::discardSnapshotsAfter(int snapshotId)
+{
+	if (snapshotId >= m_nextId-1)
+		return;
+
+	while (getNumSnapshots() && m_entries[m_entries.size()-1].m_id > snapshotId)
+	{
+		m_entries.pop_back();
+	}
+	if (getNumSnapshots())
+	{
+		const btSnapshotEntry& newest = m_entries[m_entries.size()-1];
+		m_writeOffset = newest.m_offset + newest.m_size;
+	} else
+	{
+		m_entries.resize(0);
+		m_firstEntry = 0;
+		m_writeOffset = 0;
+	}
+	m_nextId = snapshotId+1;
+	m_forceKeyframe = true;
+}
+
+void btDeltaSnapshotBuffer::clear()
+{
+	m_entries.resize(0);
+	m_firstEntry = 0;
+	m_writeOffset = 0;
+	m_forceKeyframe = true;
+}
+
+int btDeltaSnapshotBuffer::getOldestSnapshotId() const
+{
+	return getNumSnapshots() ? m_entries[m_firstEntry].m_id : -1;
+}
+
+int btDeltaSnapshotBuffer::getNewestSnapshotId() const
+{
+	return getNumSnapshots() ? m_entries[m_entries.size()-1].m_id : -1;
+}
+
+int btDeltaSnapshotBuffer::getSnapshotSize(int snapshotId) const
+{
+	const btSnapshotEntry* entry = findEntry(snapshotId);
+	return entry ? entry->m_size : 0;
+}
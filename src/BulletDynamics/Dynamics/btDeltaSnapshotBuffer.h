@@ -0,0 +1,164 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2015 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_DELTA_SNAPSHOT_BUFFER_H
+#define BT_DELTA_SNAPSHOT_BUFFER_H
+
+#include "LinearMath/btScalar.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btHashMap.h"
+
+class btDynamicsWorld;
+class btCollisionObject;
+
+enum btDeltaSnapshotFlags
+{
+	///store positions, rotations and velocities with reduced precision (40 instead of 84 bytes per body in single precision)
+	BT_SNAPSHOT_QUANTIZED = 1,
+	///store the applied impulses of the contact points, so the solver is warm started after a restore
+	BT_SNAPSHOT_CONTACT_IMPULSES = 2
+};
+
+///btDeltaSnapshotBuffer captures the dynamic state of a world (transforms, velocities and activation state of
+///the non-static rigid bodies, and optionally the contact impulses) into a preallocated ring buffer.
+///Static objects, shapes and bvhs are never stored. A keyframe stores all non-static bodies, the snapshots in
+///between only store the bodies that changed since the previous snapshot, so sleeping bodies cost nothing.
+///Snapshots refer to objects by their index in the collision object array, so the world has to contain the
+///same objects in the same order when a snapshot is restored.
+///The oldest snapshots are overwritten when the buffer is full, no memory is allocated once the buffer is warmed up.
+class btDeltaSnapshotBuffer
+{
+	struct btSnapshotEntry
+	{
+		int		m_id;
+		int		m_offset;
+		int		m_size;
+		bool	m_keyframe;
+	};
+
+	struct btSnapshotPairKey
+	{
+		int	m_index0;
+		int	m_index1;
+
+		btSnapshotPairKey(int index0, int index1)
+			:m_index0(index0),
+			m_index1(index1)
+		{
+		}
+
+		bool equals(const btSnapshotPairKey& other) const
+		{
+			return m_index0 == other.m_index0 && m_index1 == other.m_index1;
+		}
+
+		SIMD_FORCE_INLINE unsigned int getHash() const
+		{
+			int key = m_index0 ^ (m_index1 * 7919);
+			// Thomas Wang's hash
+			key += ~(key << 15);	key ^=  (key >> 10);	key +=  (key << 3);	key ^=  (key >> 6);	key += ~(key << 11);	key ^=  (key >> 16);
+			return key;
+		}
+	};
+
+	unsigned char*	m_buffer;
+	int				m_bufferSize;
+	int				m_writeOffset;
+
+	btAlignedObjectArray<btSnapshotEntry>	m_entries;
+	int				m_firstEntry;
+	int				m_nextId;
+
+	int				m_flags;
+	int				m_keyframeInterval;
+	int				m_snapshotsSinceKeyframe;
+	bool			m_forceKeyframe;
+	btScalar		m_velocityQuantum;
+
+	///last stored record of each collision object, used to detect the bodies that changed
+	btAlignedObjectArray<unsigned char>	m_lastRecords;
+	btAlignedObjectArray<unsigned char>	m_lastRecordValid;
+
+	btAlignedObjectArray<unsigned char>	m_scratch;
+	btHashMap<btHashPtr,int>	m_objectIndices;
+	btHashMap<btSnapshotPairKey,int>	m_storedManifolds;
+
+	int		getRecordSize() const;
+	void	encodeBody(const btCollisionObject* colObj, int index, unsigned char* record) const;
+	void	decodeBody(btCollisionObject* colObj, const unsigned char* record) const;
+
+	void	buildObjectIndices(btDynamicsWorld* world);
+	int		writeContacts(btDynamicsWorld* world, int offset, int* numManifolds);
+	void	restoreContacts(btDynamicsWorld* world, const unsigned char* data, int numManifolds);
+
+	const btSnapshotEntry*	findEntry(int snapshotId) const;
+	void	popFrontEntry();
+
+public:
+
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	btDeltaSnapshotBuffer(int bufferSize, int flags = BT_SNAPSHOT_CONTACT_IMPULSES, int keyframeInterval = 16);
+
+	virtual ~btDeltaSnapshotBuffer();
+
+	///captureSnapshot returns the id of the new snapshot, or -1 if it doesn't fit in the buffer
+	int		captureSnapshot(btDynamicsWorld* world);
+
+	///restoreSnapshot returns false if the snapshot was overwritten, or if the number of collision objects changed.
+	///The next captured snapshot is a keyframe.
+	bool	restoreSnapshot(btDynamicsWorld* world, int snapshotId);
+
+	///discard all snapshots newer than snapshotId, for example after a rollback. The next snapshot gets id snapshotId+1
+	void	discardSnapshotsAfter(int snapshotId);
+
+	void	clear();
+
+	bool	hasSnapshot(int snapshotId) const
+	{
+		return findEntry(snapshotId) != 0;
+	}
+
+	///returns -1 if the buffer is empty
+	int		getOldestSnapshotId() const;
+	int		getNewestSnapshotId() const;
+
+	///size of the snapshot in bytes, 0 if the snapshot is not in the buffer
+	int		getSnapshotSize(int snapshotId) const;
+
+	int		getNumSnapshots() const
+	{
+		return m_entries.size() - m_firstEntry;
+	}
+
+	int		getFlags() const
+	{
+		return m_flags;
+	}
+
+	///velocities are quantized in steps of velocityQuantum (1/256 by default, so the range is about 128 m/s)
+	void	setVelocityQuantum(btScalar velocityQuantum)
+	{
+		m_velocityQuantum = velocityQuantum;
+		m_forceKeyframe = true;
+	}
+
+	btScalar	getVelocityQuantum() const
+	{
+		return m_velocityQuantum;
+	}
+};
+
+#endif //BT_DELTA_SNAPSHOT_BUFFER_H
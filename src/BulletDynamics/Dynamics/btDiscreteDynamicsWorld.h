@@ -109,6 +109,17 @@ public:
 
 	virtual void	synchronizeMotionStates();
 
+	///the time accumulated by stepSimulation that is not simulated yet, when using fixed substeps
+	btScalar	getLocalTime() const
+	{
+		return m_localTime;
+	}
+
+	void	setLocalTime(btScalar localTime)
+	{
+		m_localTime = localTime;
+	}
+
 	///this can be useful to synchronize a single rigid body -> graphics object
 	void	synchronizeSingleMotionState(btRigidBody* body);
 
@@ -0,0 +1,447 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2015 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btWorldCheckpoint.h"
+#include "btDiscreteDynamicsWorld.h"
+#include "btRigidBody.h"
+#include "LinearMath/btMotionState.h"
+#include "BulletCollision/CollisionDispatch/btCollisionObjectWrapper.h"
+#include "BulletCollision/CollisionDispatch/btManifoldResult.h"
+#include "BulletCollision/CollisionDispatch/btGhostObject.h"
+#include "BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolver.h"
+#include "BulletDynamics/ConstraintSolver/btTypedConstraint.h"
+
+btWorldCheckpoint::btWorldCheckpoint()
+:m_valid(false),
+m_numObjects(0),
+m_numConstraints(0),
+m_stageCurrent(0),
+m_fixedleft(0),
+m_newpairs(0),
+m_updatesCall(0),
+m_updatesDone(0),
+m_updatesRatio(0),
+m_pid(0),
+m_cid(0),
+m_gid(0),
+m_needcleanup(false),
+m_hasSolverSeed(false),
+m_solverSeed(0),
+m_localTime(0)
+{
+	m_optimizationPath[0] = 0;
+	m_optimizationPath[1] = 0;
+}
+
+btWorldCheckpoint::~btWorldCheckpoint()
+{
+}
+
+void	btWorldCheckpoint::rebuildBroadphase(btDiscreteDynamicsWorld* world, btDbvtBroadphase* broadphase, bool useStoredVolumes)
+{
+	const btCollisionObjectArray& objects = world->getCollisionObjectArray();
+	m_tmpProxies.resize(0);
+	m_tmpVolumes.resize(0);
+	for (int i=0;i<objects.size();i++)
+	{
+		btDbvtProxy* proxy = (btDbvtProxy*)objects[i]->getBroadphaseHandle();
+		if (!proxy)
+			continue;
+		m_tmpProxies.push_back(proxy);
+		m_tmpVolumes.push_back(useStoredVolumes ? m_proxies[i].m_volume : proxy->leaf->volume);
+	}
+	broadphase->rebuildTrees(m_tmpProxies.size() ? &m_tmpProxies[0] : 0, m_tmpVolumes.size() ? &m_tmpVolumes[0] : 0, m_tmpProxies.size());
+}
+
+void	btWorldCheckpoint::capture(btDiscreteDynamicsWorld* world, btDbvtBroadphase* broadphase)
+{
+	btAssert(world->getBroadphase() == broadphase);
+
+	const btCollisionObjectArray& objects = world->getCollisionObjectArray();
+	m_numObjects = objects.size();
+	m_numConstraints = world->getNumConstraints();
+
+	//the trees depend on the order of insertions and updates, so bring them into a canonical form that restore can reproduce
+	rebuildBroadphase(world, broadphase, false);
+
+	m_objects.resize(m_numObjects);
+	m_proxies.resize(m_numObjects);
+	m_objectIndices.clear();
+	for (int i=0;i<m_numObjects;i++)
+	{
+		const btCollisionObject* colObj = objects[i];
+		m_objectIndices.insert(btHashPtr(colObj), i);
+
+		btCheckpointObject& obj = m_objects[i];
+		obj.m_worldTransform = colObj->getWorldTransform();
+		obj.m_interpolationWorldTransform = colObj->getInterpolationWorldTransform();
+		obj.m_interpolationLinearVelocity = colObj->getInterpolationLinearVelocity();
+		obj.m_interpolationAngularVelocity = colObj->getInterpolationAngularVelocity();
+		obj.m_linearVelocity.setZero();
+		obj.m_angularVelocity.setZero();
+		const btRigidBody* body = btRigidBody::upcast(colObj);
+		if (body)
+		{
+			obj.m_linearVelocity = body->getLinearVelocity();
+			obj.m_angularVelocity = body->getAngularVelocity();
+		}
+		obj.m_deactivationTime = colObj->getDeactivationTime();
+		obj.m_hitFraction = colObj->getHitFraction();
+		obj.m_activationState = colObj->getActivationState();
+
+		btCheckpointProxy& storedProxy = m_proxies[i];
+		const btDbvtProxy* proxy = (const btDbvtProxy*)colObj->getBroadphaseHandle();
+		if (proxy)
+		{
+			storedProxy.m_volume = proxy->leaf->volume;
+			storedProxy.m_aabbMin = proxy->m_aabbMin;
+			storedProxy.m_aabbMax = proxy->m_aabbMax;
+			storedProxy.m_stage = proxy->stage;
+		} else
+		{
+			storedProxy.m_stage = -1;
+		}
+	}
+
+	m_optimizationPath[0] = broadphase->m_sets[0].m_opath;
+	m_optimizationPath[1] = broadphase->m_sets[1].m_opath;
+	m_stageCurrent = broadphase->m_stageCurrent;
+	m_fixedleft = broadphase->m_fixedleft;
+	m_newpairs = broadphase->m_newpairs;
+	m_updatesCall = broadphase->m_updates_call;
+	m_updatesDone = broadphase->m_updates_done;
+	m_updatesRatio = broadphase->m_updates_ratio;
+	m_pid = broadphase->m_pid;
+	m_cid = broadphase->m_cid;
+	m_gid = broadphase->m_gid;
+	m_needcleanup = broadphase->m_needcleanup;
+
+	//pairs in cache order, with the contact points of their manifolds
+	m_pairs.resize(0);
+	m_manifolds.resize(0);
+	m_points.resize(0);
+	m_manifoldIndices.clear();
+	btBroadphasePairArray& pairs = broadphase->getOverlappingPairCache()->getOverlappingPairArray();
+	for (int i=0;i<pairs.size();i++)
+	{
+		const btBroadphasePair& pair = pairs[i];
+		const int* index0 = m_objectIndices.find(btHashPtr(pair.m_pProxy0->m_clientObject));
+		const int* index1 = m_objectIndices.find(btHashPtr(pair.m_pProxy1->m_clientObject));
+
+		btCheckpointPair storedPair;
+		storedPair.m_index0 = index0 ? *index0 : -1;
+		storedPair.m_index1 = index1 ? *index1 : -1;
+		storedPair.m_hasAlgorithm = pair.m_algorithm != 0;
+		storedPair.m_firstManifold = m_manifolds.size();
+		storedPair.m_numManifolds = 0;
+		if (pair.m_algorithm)
+		{
+			m_manifoldArray.resize(0);
+			pair.m_algorithm->getAllContactManifolds(m_manifoldArray);
+			for (int j=0;j<m_manifoldArray.size();j++)
+			{
+				const btPersistentManifold* manifold = m_manifoldArray[j];
+				m_manifoldIndices.insert(btHashPtr(manifold), m_manifolds.size());
+
+				btCheckpointManifold storedManifold;
+				storedManifold.m_firstPoint = m_points.size();
+				storedManifold.m_numPoints = manifold->getNumContacts();
+				m_manifolds.push_back(storedManifold);
+				for (int p=0;p<manifold->getNumContacts();p++)
+				{
+					m_points.push_back(manifold->getContactPoint(p));
+					m_points[m_points.size()-1].m_userPersistentData = 0;
+				}
+			}
+			storedPair.m_numManifolds = m_manifoldArray.size();
+		}
+		m_pairs.push_back(storedPair);
+	}
+
+	//the solver visits the manifolds in dispatcher order
+	btDispatcher* dispatcher = world->getDispatcher();
+	m_manifoldOrder.resize(dispatcher->getNumManifolds());
+	for (int i=0;i<dispatcher->getNumManifolds();i++)
+	{
+		const int* index = m_manifoldIndices.find(btHashPtr(dispatcher->getManifoldByIndexInternal(i)));
+		m_manifoldOrder[i] = index ? *index : -1;
+	}
+
+	m_constraintEnabled.resize(m_numConstraints);
+	for (int i=0;i<m_numConstraints;i++)
+	{
+		m_constraintEnabled[i] = world->getConstraint(i)->isEnabled() ? 1 : 0;
+	}
+
+	btConstraintSolver* solver = world->getConstraintSolver();
+	m_hasSolverSeed = solver && (solver->getSolverType() == BT_SEQUENTIAL_IMPULSE_SOLVER || solver->getSolverType() == BT_NNCG_SOLVER);
+	m_solverSeed = m_hasSolverSeed ? static_cast<btSequentialImpulseConstraintSolver*>(solver)->getRandSeed() : 0;
+
+	m_localTime = world->getLocalTime();
+	m_valid = true;
+}
+
+void	btWorldCheckpoint::restorePairs(btDiscreteDynamicsWorld* world, btDbvtBroadphase* broadphase)
+{
+	const btCollisionObjectArray& objects = world->getCollisionObjectArray();
+	btOverlappingPairCache* pairCache = broadphase->getOverlappingPairCache();
+	btDispatcher* dispatcher = world->getDispatcher();
+
+	//the pairs are only rebuilt, so they are not reported to ghost objects, see restoreGhostOverlaps
+	btOverlappingPairCallback* ghostPairCallback = pairCache->getInternalGhostPairCallback();
+	pairCache->setInternalGhostPairCallback(0);
+
+	//remove all pairs but keep their algorithms, then add the stored pairs in the stored order
+	btBroadphasePairArray& pairs = pairCache->getOverlappingPairArray();
+	m_tmpPairs.resize(0);
+	for (int i=0;i<pairs.size();i++)
+	{
+		m_tmpPairs.push_back(pairs[i]);
+	}
+	for (int i=pairs.size()-1;i>=0;i--)
+	{
+		pairCache->removeOverlappingPair(pairs[i].m_pProxy0, pairs[i].m_pProxy1, 0);
+	}
+	for (int i=0;i<m_pairs.size();i++)
+	{
+		const btCheckpointPair& storedPair = m_pairs[i];
+		if (storedPair.m_index0 < 0 || storedPair.m_index1 < 0)
+			continue;
+		pairCache->addOverlappingPair(objects[storedPair.m_index0]->getBroadphaseHandle(), objects[storedPair.m_index1]->getBroadphaseHandle());
+	}
+	for (int i=0;i<m_tmpPairs.size();i++)
+	{
+		btBroadphasePair& oldPair = m_tmpPairs[i];
+		btBroadphasePair* pair = pairCache->findPair(oldPair.m_pProxy0, oldPair.m_pProxy1);
+		if (pair)
+		{
+			pair->m_algorithm = oldPair.m_algorithm;
+			pair->m_internalInfo1 = oldPair.m_internalInfo1;
+		} else
+		{
+			pairCache->cleanOverlappingPair(oldPair, dispatcher);
+		}
+	}
+	pairCache->setInternalGhostPairCallback(ghostPairCallback);
+	if (ghostPairCallback)
+	{
+		restoreGhostOverlaps(world, pairCache);
+	}
+
+	//recreate the algorithms (and their manifolds) of pairs that collided, and overwrite the contact points
+	m_restoredManifolds.resize(m_manifolds.size());
+	for (int i=0;i<m_restoredManifolds.size();i++)
+	{
+		m_restoredManifolds[i] = 0;
+	}
+	for (int i=0;i<pairs.size();i++)
+	{
+		btBroadphasePair& pair = pairs[i];
+		btCollisionObject* colObj0 = (btCollisionObject*)pair.m_pProxy0->m_clientObject;
+		btCollisionObject* colObj1 = (btCollisionObject*)pair.m_pProxy1->m_clientObject;
+		const int* index0 = m_objectIndices.find(btHashPtr(colObj0));
+		const int* index1 = m_objectIndices.find(btHashPtr(colObj1));
+		int storedIndex = -1;
+		if (i < m_pairs.size() && index0 && index1 && m_pairs[i].m_index0 == *index0 && m_pairs[i].m_index1 == *index1)
+		{
+			storedIndex = i;
+		}
+		if (storedIndex < 0 || !m_pairs[storedIndex].m_hasAlgorithm)
+		{
+			pairCache->cleanOverlappingPair(pair, dispatcher);
+			continue;
+		}
+		const btCheckpointPair& storedPair = m_pairs[storedIndex];
+		if (!pair.m_algorithm && dispatcher->needsCollision(colObj0,colObj1))
+		{
+			btCollisionObjectWrapper obj0Wrap(0,colObj0->getCollisionShape(),colObj0,colObj0->getWorldTransform(),-1,-1);
+			btCollisionObjectWrapper obj1Wrap(0,colObj1->getCollisionShape(),colObj1,colObj1->getWorldTransform(),-1,-1);
+			pair.m_algorithm = dispatcher->findAlgorithm(&obj0Wrap,&obj1Wrap);
+			if (pair.m_algorithm && storedPair.m_numManifolds)
+			{
+				btManifoldResult contactPointResult(&obj0Wrap,&obj1Wrap);
+				pair.m_algorithm->processCollision(&obj0Wrap,&obj1Wrap,world->getDispatchInfo(),&contactPointResult);
+			}
+		}
+		if (!pair.m_algorithm)
+			continue;
+
+		m_manifoldArray.resize(0);
+		pair.m_algorithm->getAllContactManifolds(m_manifoldArray);
+		for (int j=0;j<m_manifoldArray.size();j++)
+		{
+			btPersistentManifold* manifold = m_manifoldArray[j];
+			manifold->clearManifold();
+			if (j >= storedPair.m_numManifolds)
+				continue;
+			const int manifoldIndex = storedPair.m_firstManifold+j;
+			const btCheckpointManifold& storedManifold = m_manifolds[manifoldIndex];
+			for (int p=0;p<storedManifold.m_numPoints;p++)
+			{
+				manifold->getContactPoint(p) = m_points[storedManifold.m_firstPoint+p];
+			}
+			manifold->setNumContacts(storedManifold.m_numPoints);
+			m_restoredManifolds[manifoldIndex] = manifold;
+		}
+	}
+}
+
+void	btWorldCheckpoint::restoreGhostOverlaps(btDiscreteDynamicsWorld* world, btOverlappingPairCache* pairCache)
+{
+	//only overlaps that differ between the world and the checkpoint are removed or added,
+	//so ghost objects keep the order of their other overlaps and triggers only report actual changes
+	const btCollisionObjectArray& objects = world->getCollisionObjectArray();
+	for (int i=0;i<objects.size();i++)
+	{
+		btGhostObject* ghost = btGhostObject::upcast(objects[i]);
+		if (!ghost || !ghost->getBroadphaseHandle())
+			continue;
+		btBroadphaseProxy* ghostProxy = ghost->getBroadphaseHandle();
+		for (int j=ghost->getNumOverlappingObjects()-1;j>=0;j--)
+		{
+			btBroadphaseProxy* otherProxy = ghost->getOverlappingObject(j)->getBroadphaseHandle();
+			if (otherProxy && !pairCache->findPair(ghostProxy, otherProxy))
+			{
+				ghost->removeOverlappingObjectInternal(otherProxy, world->getDispatcher(), ghostProxy);
+			}
+		}
+	}
+	btBroadphasePairArray& pairs = pairCache->getOverlappingPairArray();
+	for (int i=0;i<pairs.size();i++)
+	{
+		btBroadphaseProxy* proxy0 = pairs[i].m_pProxy0;
+		btBroadphaseProxy* proxy1 = pairs[i].m_pProxy1;
+		btGhostObject* ghost0 = btGhostObject::upcast((btCollisionObject*)proxy0->m_clientObject);
+		btGhostObject* ghost1 = btGhostObject::upcast((btCollisionObject*)proxy1->m_clientObject);
+		if (ghost0)
+			ghost0->addOverlappingObjectInternal(proxy1, proxy0);
+		if (ghost1)
+			ghost1->addOverlappingObjectInternal(proxy0, proxy1);
+	}
+}
+
+void	btWorldCheckpoint::restoreManifoldOrder(btDiscreteDynamicsWorld* world)
+{
+	btDispatcher* dispatcher = world->getDispatcher();
+	const int numManifolds = dispatcher->getNumManifolds();
+	if (!numManifolds)
+		return;
+	btPersistentManifold** manifolds = dispatcher->getInternalManifoldPointer();
+
+	//m_index1a is the position in the dispatcher, use -1 to mark the manifolds that are not placed yet
+	for (int i=0;i<numManifolds;i++)
+	{
+		manifolds[i]->m_index1a = -1;
+	}
+	m_tmpManifolds.resize(0);
+	for (int i=0;i<m_manifoldOrder.size();i++)
+	{
+		const int index = m_manifoldOrder[i];
+		btPersistentManifold* manifold = index >= 0 ? m_restoredManifolds[index] : 0;
+		if (manifold && manifold->m_index1a < 0)
+		{
+			manifold->m_index1a = m_tmpManifolds.size();
+			m_tmpManifolds.push_back(manifold);
+		}
+	}
+	for (int i=0;i<numManifolds;i++)
+	{
+		if (manifolds[i]->m_index1a < 0)
+		{
+			manifolds[i]->m_index1a = m_tmpManifolds.size();
+			m_tmpManifolds.push_back(manifolds[i]);
+		}
+	}
+	btAssert(m_tmpManifolds.size() == numManifolds);
+	for (int i=0;i<numManifolds;i++)
+	{
+		manifolds[i] = m_tmpManifolds[i];
+	}
+}
+
+bool	btWorldCheckpoint::restore(btDiscreteDynamicsWorld* world, btDbvtBroadphase* broadphase)
+{
+	btAssert(world->getBroadphase() == broadphase);
+
+	const btCollisionObjectArray& objects = world->getCollisionObjectArray();
+	if (!m_valid || objects.size() != m_numObjects || world->getNumConstraints() != m_numConstraints)
+		return false;
+
+	m_objectIndices.clear();
+	for (int i=0;i<m_numObjects;i++)
+	{
+		btCollisionObject* colObj = objects[i];
+		m_objectIndices.insert(btHashPtr(colObj), i);
+
+		const btCheckpointObject& obj = m_objects[i];
+		colObj->setWorldTransform(obj.m_worldTransform);
+		colObj->setInterpolationWorldTransform(obj.m_interpolationWorldTransform);
+		colObj->setInterpolationLinearVelocity(obj.m_interpolationLinearVelocity);
+		colObj->setInterpolationAngularVelocity(obj.m_interpolationAngularVelocity);
+		colObj->forceActivationState(obj.m_activationState);
+		colObj->setDeactivationTime(obj.m_deactivationTime);
+		colObj->setHitFraction(obj.m_hitFraction);
+		btRigidBody* body = btRigidBody::upcast(colObj);
+		if (body)
+		{
+			body->setLinearVelocity(obj.m_linearVelocity);
+			body->setAngularVelocity(obj.m_angularVelocity);
+			body->updateInertiaTensor();
+			if (body->getMotionState() && !body->isStaticOrKinematicObject())
+			{
+				body->getMotionState()->setWorldTransform(obj.m_interpolationWorldTransform);
+			}
+		}
+
+		btDbvtProxy* proxy = (btDbvtProxy*)colObj->getBroadphaseHandle();
+		if (proxy && m_proxies[i].m_stage >= 0)
+		{
+			proxy->m_aabbMin = m_proxies[i].m_aabbMin;
+			proxy->m_aabbMax = m_proxies[i].m_aabbMax;
+			proxy->stage = m_proxies[i].m_stage;
+		}
+	}
+
+	rebuildBroadphase(world, broadphase, true);
+	broadphase->m_sets[0].m_opath = m_optimizationPath[0];
+	broadphase->m_sets[1].m_opath = m_optimizationPath[1];
+	broadphase->m_stageCurrent = m_stageCurrent;
+	broadphase->m_fixedleft = m_fixedleft;
+	broadphase->m_newpairs = m_newpairs;
+	broadphase->m_updates_call = m_updatesCall;
+	broadphase->m_updates_done = m_updatesDone;
+	broadphase->m_updates_ratio = m_updatesRatio;
+	broadphase->m_pid = m_pid;
+	broadphase->m_cid = m_cid;
+	broadphase->m_gid = m_gid;
+	broadphase->m_needcleanup = m_needcleanup;
+
+	restorePairs(world, broadphase);
+	restoreManifoldOrder(world);
+
+	for (int i=0;i<m_numConstraints;i++)
+	{
+		world->getConstraint(i)->setEnabled(m_constraintEnabled[i] != 0);
+	}
+
+	btConstraintSolver* solver = world->getConstraintSolver();
+	if (m_hasSolverSeed && solver && (solver->getSolverType() == BT_SEQUENTIAL_IMPULSE_SOLVER || solver->getSolverType() == BT_NNCG_SOLVER))
+	{
+		static_cast<btSequentialImpulseConstraintSolver*>(solver)->setRandSeed(m_solverSeed);
+	}
+
+	world->setLocalTime(m_localTime);
+	return true;
+}
@@ -0,0 +1,152 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2015 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_WORLD_CHECKPOINT_H
+#define BT_WORLD_CHECKPOINT_H
+
+#include "LinearMath/btTransform.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btHashMap.h"
+#include "BulletCollision/BroadphaseCollision/btDbvtBroadphase.h"
+#include "BulletCollision/NarrowPhaseCollision/btPersistentManifold.h"
+#include "BulletCollision/BroadphaseCollision/btCollisionAlgorithm.h"
+
+class btDiscreteDynamicsWorld;
+
+///btWorldCheckpoint saves and restores the complete simulation state of a btDiscreteDynamicsWorld with a btDbvtBroadphase,
+///so the restored world steps bit-exactly like the original, for example to re-simulate frames for rollback networking.
+///Besides the collision objects it stores the overlapping pairs in order, the contact points of their manifolds (applied
+///impulses, lifetimes), the order of the manifolds in the dispatcher, the broadphase proxies and counters, which constraints
+///are enabled, the seed of the sequential impulse solver and the time accumulated by stepSimulation.
+///capture rebuilds the broadphase trees in a canonical order, and restore rebuilds them the same way, so the trees don't need
+///to be copied. Capture and restore between two calls to stepSimulation, and keep the same objects and constraints in the same order.
+///Ghost objects keep their overlapping objects that are still overlapping after a restore, so triggers only report the overlaps that changed.
+///Not included: actions (vehicles, characters), soft bodies, btMultiBody, forces applied before the capture and speculative (ccd) contacts.
+class btWorldCheckpoint
+{
+	struct btCheckpointObject
+	{
+		btCheckpointObject()
+			:m_worldTransform(btTransform::getIdentity()),
+			m_interpolationWorldTransform(btTransform::getIdentity()),
+			m_interpolationLinearVelocity(0,0,0),
+			m_interpolationAngularVelocity(0,0,0),
+			m_linearVelocity(0,0,0),
+			m_angularVelocity(0,0,0),
+			m_deactivationTime(0),
+			m_hitFraction(1),
+			m_activationState(0)
+		{
+		}
+
+		btTransform	m_worldTransform;
+		btTransform	m_interpolationWorldTransform;
+		btVector3	m_interpolationLinearVelocity;
+		btVector3	m_interpolationAngularVelocity;
+		btVector3	m_linearVelocity;
+		btVector3	m_angularVelocity;
+		btScalar	m_deactivationTime;
+		btScalar	m_hitFraction;
+		int			m_activationState;
+	};
+
+	struct btCheckpointProxy
+	{
+		btDbvtVolume	m_volume;
+		btVector3		m_aabbMin;
+		btVector3		m_aabbMax;
+		int				m_stage;
+	};
+
+	struct btCheckpointPair
+	{
+		int		m_index0;
+		int		m_index1;
+		bool	m_hasAlgorithm;
+		int		m_firstManifold;
+		int		m_numManifolds;
+	};
+
+	struct btCheckpointManifold
+	{
+		int		m_firstPoint;
+		int		m_numPoints;
+	};
+
+	bool	m_valid;
+	int		m_numObjects;
+	int		m_numConstraints;
+
+	btAlignedObjectArray<btCheckpointObject>	m_objects;
+	btAlignedObjectArray<btCheckpointProxy>		m_proxies;
+	btAlignedObjectArray<btCheckpointPair>		m_pairs;
+	btAlignedObjectArray<btCheckpointManifold>	m_manifolds;
+	btAlignedObjectArray<btManifoldPoint>		m_points;
+	///stored manifold index of each manifold in the dispatcher, -1 if it doesn't belong to a pair
+	btAlignedObjectArray<int>					m_manifoldOrder;
+	btAlignedObjectArray<unsigned char>			m_constraintEnabled;
+
+	unsigned	m_optimizationPath[2];
+	int			m_stageCurrent;
+	int			m_fixedleft;
+	int			m_newpairs;
+	unsigned	m_updatesCall;
+	unsigned	m_updatesDone;
+	btScalar	m_updatesRatio;
+	int			m_pid;
+	int			m_cid;
+	int			m_gid;
+	bool		m_needcleanup;
+
+	bool			m_hasSolverSeed;
+	unsigned long	m_solverSeed;
+	btScalar		m_localTime;
+
+	//temporary data, kept to avoid allocations
+	btHashMap<btHashPtr,int>				m_objectIndices;
+	btHashMap<btHashPtr,int>				m_manifoldIndices;
+	btAlignedObjectArray<btDbvtProxy*>		m_tmpProxies;
+	btAlignedObjectArray<btDbvtVolume>		m_tmpVolumes;
+	btAlignedObjectArray<btBroadphasePair>	m_tmpPairs;
+	btAlignedObjectArray<btPersistentManifold*>	m_restoredManifolds;
+	btAlignedObjectArray<btPersistentManifold*>	m_tmpManifolds;
+	btManifoldArray							m_manifoldArray;
+
+	void	rebuildBroadphase(btDiscreteDynamicsWorld* world, btDbvtBroadphase* broadphase, bool useStoredVolumes);
+	void	restorePairs(btDiscreteDynamicsWorld* world, btDbvtBroadphase* broadphase);
+	void	restoreGhostOverlaps(btDiscreteDynamicsWorld* world, btOverlappingPairCache* pairCache);
+	void	restoreManifoldOrder(btDiscreteDynamicsWorld* world);
+
+public:
+
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	btWorldCheckpoint();
+
+	virtual ~btWorldCheckpoint();
+
+	///broadphase has to be the broadphase of the world
+	void	capture(btDiscreteDynamicsWorld* world, btDbvtBroadphase* broadphase);
+
+	///restore returns false if nothing was captured, or if the number of collision objects or constraints changed
+	bool	restore(btDiscreteDynamicsWorld* world, btDbvtBroadphase* broadphase);
+
+	bool	isValid() const
+	{
+		return m_valid;
+	}
+};
+
+#endif //BT_WORLD_CHECKPOINT_H
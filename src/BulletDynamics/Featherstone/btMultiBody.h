@@ -369,9 +369,12 @@ void addJointTorque(int i, btScalar Q);
   
 	void applyDeltaVeeMultiDof2(const btScalar * delta_vee, btScalar multiplier)
 	{
-		for (int dof = 0; dof < 6 + getNumDofs(); ++dof)
+		//hoist the dof count and the array pointer, so the stores don't force them to be reloaded and the loop can be vectorized
+		const int ndof = 6 + getNumDofs();
+		btScalar* deltaV = &m_deltaV[0];
+		for (int dof = 0; dof < ndof; ++dof)
                 {
-                        m_deltaV[dof] += delta_vee[dof] * multiplier;
+                        deltaV[dof] += delta_vee[dof] * multiplier;
                 }
 	}
 	void processDeltaVeeMultiDof2()
@@ -23,61 +23,295 @@ subject to the following restrictions:
 #include "BulletDynamics/ConstraintSolver/btContactSolverInfo.h"
 
 #include "LinearMath/btQuickprof.h"
+#include "LinearMath/btThreads.h"
+
+///dot product and axpy over the multibody dofs, with 4 independent accumulators so the compiler can vectorize them
+static SIMD_FORCE_INLINE btScalar btMultiBodyDot(const btScalar* a, const btScalar* b, int n)
+{
+	btScalar s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	int i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		s0 += a[i] * b[i];
+		s1 += a[i+1] * b[i+1];
+		s2 += a[i+2] * b[i+2];
+		s3 += a[i+3] * b[i+3];
+	}
+	for (; i < n; ++i)
+		s0 += a[i] * b[i];
+	return (s0 + s1) + (s2 + s3);
+}
+
+static SIMD_FORCE_INLINE void btMultiBodyAxpy(btScalar* y, const btScalar* x, btScalar s, int n)
+{
+	int i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		y[i] += x[i] * s;
+		y[i+1] += x[i+1] * s;
+		y[i+2] += x[i+2] * s;
+		y[i+3] += x[i+3] * s;
+	}
+	for (; i < n; ++i)
+		y[i] += x[i] * s;
+}
+
+struct btMultiBodyConstraintGroupLoop : public btIParallelForBody
+{
+	btMultiBodyConstraintSolver*	m_solver;
+	int								m_iteration;
+	const btContactSolverInfo*		m_infoGlobal;
+
+	btMultiBodyConstraintGroupLoop(btMultiBodyConstraintSolver* solver, int iteration, const btContactSolverInfo& infoGlobal)
+		:m_solver(solver),m_iteration(iteration),m_infoGlobal(&infoGlobal)
+	{
+	}
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i = iBegin; i < iEnd; i++)
+		{
+			m_solver->solveGroupRows(i, m_iteration, *m_infoGlobal);
+		}
+	}
+};
+
+btMultiBodyConstraintSolver::btMultiBodyConstraintSolver()
+:m_tmpMultiBodyConstraints(0),
+m_tmpNumMultiBodyConstraints(0),
+m_multithreaded(false)
+{
+}
+
+void btMultiBodyConstraintSolver::solveNonContactRow(int row)
+{
+	btMultiBodySolverConstraint& constraint = m_multiBodyNonContactConstraints[row];
+
+	resolveSingleConstraintRowGeneric(constraint);
+	if(constraint.m_multiBodyA) 
+		constraint.m_multiBodyA->setPosUpdated(false);
+	if(constraint.m_multiBodyB) 
+		constraint.m_multiBodyB->setPosUpdated(false);
+}
+
+void btMultiBodyConstraintSolver::solveNormalContactRow(int row, int iteration, const btContactSolverInfo& infoGlobal)
+{
+	btMultiBodySolverConstraint& constraint = m_multiBodyNormalContactConstraints[row];
+	if (iteration < infoGlobal.m_numIterations)
+		resolveSingleConstraintRowGeneric(constraint);
+
+	if(constraint.m_multiBodyA) 
+		constraint.m_multiBodyA->setPosUpdated(false);
+	if(constraint.m_multiBodyB) 
+		constraint.m_multiBodyB->setPosUpdated(false);
+}
+
+void btMultiBodyConstraintSolver::solveFrictionContactRow(int row, int iteration, const btContactSolverInfo& infoGlobal)
+{
+	if (iteration < infoGlobal.m_numIterations)
+	{
+		btMultiBodySolverConstraint& frictionConstraint = m_multiBodyFrictionContactConstraints[row];
+		btScalar totalImpulse = m_multiBodyNormalContactConstraints[frictionConstraint.m_frictionIndex].m_appliedImpulse;
+		//adjust friction limits here
+		if (totalImpulse>btScalar(0))
+		{
+			frictionConstraint.m_lowerLimit = -(frictionConstraint.m_friction*totalImpulse);
+			frictionConstraint.m_upperLimit = frictionConstraint.m_friction*totalImpulse;
+			resolveSingleConstraintRowGeneric(frictionConstraint);
+
+			if(frictionConstraint.m_multiBodyA) 
+				frictionConstraint.m_multiBodyA->setPosUpdated(false);
+			if(frictionConstraint.m_multiBodyB) 
+				frictionConstraint.m_multiBodyB->setPosUpdated(false);
+		}
+	}
+}
+
+void btMultiBodyConstraintSolver::solveGroupRows(int groupIndex, int iteration, const btContactSolverInfo& infoGlobal)
+{
+	const btMultiBodyConstraintGroup& group = m_groups[groupIndex];
+	const int* rows = &m_groupRows[group.m_firstRow];
+	int j;
+	for (j=0;j<group.m_numNonContactRows;j++)
+	{
+		solveNonContactRow(rows[j]);
+	}
+	rows += group.m_numNonContactRows;
+	for (j=0;j<group.m_numNormalRows;j++)
+	{
+		solveNormalContactRow(rows[j],iteration,infoGlobal);
+	}
+	rows += group.m_numNormalRows;
+	for (j=0;j<group.m_numFrictionRows;j++)
+	{
+		solveFrictionContactRow(rows[j],iteration,infoGlobal);
+	}
+}
 
 btScalar btMultiBodyConstraintSolver::solveSingleIteration(int iteration, btCollisionObject** bodies ,int numBodies,btPersistentManifold** manifoldPtr, int numManifolds,btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal,btIDebugDraw* debugDrawer)
 {
 	btScalar val = btSequentialImpulseConstraintSolver::solveSingleIteration(iteration, bodies ,numBodies,manifoldPtr, numManifolds,constraints,numConstraints,infoGlobal,debugDrawer);
+
+	if (m_groups.size() > 1)
+	{
+		//groups don't share any velocity, so they can be solved concurrently
+		btMultiBodyConstraintGroupLoop loop(this,iteration,infoGlobal);
+		btParallelFor(0,m_groups.size(),1,loop);
+		return val;
+	}
 	
 	//solve featherstone non-contact constraints
 
 	//printf("m_multiBodyNonContactConstraints = %d\n",m_multiBodyNonContactConstraints.size());
 	for (int j=0;j<m_multiBodyNonContactConstraints.size();j++)
 	{
-		btMultiBodySolverConstraint& constraint = m_multiBodyNonContactConstraints[j];
-		
-		resolveSingleConstraintRowGeneric(constraint);
-		if(constraint.m_multiBodyA) 
-			constraint.m_multiBodyA->setPosUpdated(false);
-		if(constraint.m_multiBodyB) 
-			constraint.m_multiBodyB->setPosUpdated(false);
+		solveNonContactRow(j);
 	}
 
 	//solve featherstone normal contact
 	for (int j=0;j<m_multiBodyNormalContactConstraints.size();j++)
 	{
-		btMultiBodySolverConstraint& constraint = m_multiBodyNormalContactConstraints[j];
-		if (iteration < infoGlobal.m_numIterations)
-			resolveSingleConstraintRowGeneric(constraint);
-
-		if(constraint.m_multiBodyA) 
-			constraint.m_multiBodyA->setPosUpdated(false);
-		if(constraint.m_multiBodyB) 
-			constraint.m_multiBodyB->setPosUpdated(false);
+		solveNormalContactRow(j,iteration,infoGlobal);
 	}
 	
 	//solve featherstone frictional contact
 
 	for (int j=0;j<this->m_multiBodyFrictionContactConstraints.size();j++)
 	{
-		if (iteration < infoGlobal.m_numIterations)
+		solveFrictionContactRow(j,iteration,infoGlobal);
+	}
+	return val;
+}
+
+///btMultiBodyGroupNode returns the union-find node of one side of a row: the solver body for rigid bodies, or the multibody
+///(after all solver bodies, at the offset of its delta velocities). Rows only write to solver bodies with an original body.
+static SIMD_FORCE_INLINE int btMultiBodyGroupNode(const btMultiBody* multiBody, int deltaVelIndex, int solverBodyId, const btAlignedObjectArray<btSolverBody>& solverBodyPool)
+{
+	if (multiBody)
+	{
+		return solverBodyPool.size() + deltaVelIndex;
+	}
+	if (solverBodyId >= 0 && solverBodyPool[solverBodyId].m_originalBody)
+	{
+		return solverBodyId;
+	}
+	return -1;
+}
+
+static SIMD_FORCE_INLINE int btMultiBodyGroupFind(btAlignedObjectArray<int>& parents, int node)
+{
+	while (parents[node] != node)
+	{
+		parents[node] = parents[parents[node]];
+		node = parents[node];
+	}
+	return node;
+}
+
+void btMultiBodyConstraintSolver::setupIndependentGroups()
+{
+	BT_PROFILE("setupIndependentGroups");
+	btMultiBodyConstraintArray* rowArrays[3] = {&m_multiBodyNonContactConstraints,&m_multiBodyNormalContactConstraints,&m_multiBodyFrictionContactConstraints};
+
+	//the last node collects the rows that don't touch any dynamic body
+	const int numNodes = m_tmpSolverBodyPool.size() + m_data.m_deltaVelocities.size() + 1;
+	m_groupNodes.resize(numNodes);
+	m_nodeGroups.resize(numNodes);
+	for (int i=0;i<numNodes;i++)
+	{
+		m_groupNodes[i] = i;
+		m_nodeGroups[i] = -1;
+	}
+
+	int numRows = 0;
+	for (int k=0;k<3;k++)
+	{
+		const btMultiBodyConstraintArray& rows = *rowArrays[k];
+		for (int j=0;j<rows.size();j++)
 		{
-			btMultiBodySolverConstraint& frictionConstraint = m_multiBodyFrictionContactConstraints[j];
-			btScalar totalImpulse = m_multiBodyNormalContactConstraints[frictionConstraint.m_frictionIndex].m_appliedImpulse;
-			//adjust friction limits here
-			if (totalImpulse>btScalar(0))
+			const btMultiBodySolverConstraint& c = rows[j];
+			int nodeA = btMultiBodyGroupNode(c.m_multiBodyA,c.m_deltaVelAindex,c.m_solverBodyIdA,m_tmpSolverBodyPool);
+			int nodeB = btMultiBodyGroupNode(c.m_multiBodyB,c.m_deltaVelBindex,c.m_solverBodyIdB,m_tmpSolverBodyPool);
+			if (nodeA >= 0 && nodeB >= 0)
 			{
-				frictionConstraint.m_lowerLimit = -(frictionConstraint.m_friction*totalImpulse);
-				frictionConstraint.m_upperLimit = frictionConstraint.m_friction*totalImpulse;
-				resolveSingleConstraintRowGeneric(frictionConstraint);
-
-				if(frictionConstraint.m_multiBodyA) 
-					frictionConstraint.m_multiBodyA->setPosUpdated(false);
-				if(frictionConstraint.m_multiBodyB) 
-					frictionConstraint.m_multiBodyB->setPosUpdated(false);
+				int rootA = btMultiBodyGroupFind(m_groupNodes,nodeA);
+				int rootB = btMultiBodyGroupFind(m_groupNodes,nodeB);
+				if (rootA != rootB)
+				{
+					m_groupNodes[rootB] = rootA;
+				}
 			}
 		}
+		numRows += rows.size();
+	}
+
+	//assign the groups in order of their first row, and count the rows of each kind
+	m_groups.resize(0);
+	m_rowGroups.resize(numRows);
+	int row = 0;
+	for (int k=0;k<3;k++)
+	{
+		const btMultiBodyConstraintArray& rows = *rowArrays[k];
+		for (int j=0;j<rows.size();j++,row++)
+		{
+			const btMultiBodySolverConstraint& c = rows[j];
+			int node = btMultiBodyGroupNode(c.m_multiBodyA,c.m_deltaVelAindex,c.m_solverBodyIdA,m_tmpSolverBodyPool);
+			if (node < 0)
+			{
+				node = btMultiBodyGroupNode(c.m_multiBodyB,c.m_deltaVelBindex,c.m_solverBodyIdB,m_tmpSolverBodyPool);
+			}
+			int root = btMultiBodyGroupFind(m_groupNodes,node >= 0 ? node : numNodes-1);
+			int groupIndex = m_nodeGroups[root];
+			if (groupIndex < 0)
+			{
+				groupIndex = m_groups.size();
+				m_nodeGroups[root] = groupIndex;
+				btMultiBodyConstraintGroup& group = m_groups.expand();
+				group.m_firstRow = 0;
+				group.m_numNonContactRows = 0;
+				group.m_numNormalRows = 0;
+				group.m_numFrictionRows = 0;
+			}
+			m_rowGroups[row] = groupIndex;
+			btMultiBodyConstraintGroup& group = m_groups[groupIndex];
+			if (k==0)
+				group.m_numNonContactRows++;
+			else if (k==1)
+				group.m_numNormalRows++;
+			else
+				group.m_numFrictionRows++;
+		}
+	}
+
+	int firstRow = 0;
+	for (int g=0;g<m_groups.size();g++)
+	{
+		btMultiBodyConstraintGroup& group = m_groups[g];
+		int numGroupRows = group.m_numNonContactRows + group.m_numNormalRows + group.m_numFrictionRows;
+		group.m_firstRow = firstRow;
+		group.m_numNonContactRows = 0;
+		group.m_numNormalRows = 0;
+		group.m_numFrictionRows = 0;
+		firstRow += numGroupRows;
+	}
+
+	//scatter the rows kind by kind, so each kind stays in its serial order,
+	//and the counts of the previous kinds are complete when a kind is placed
+	m_groupRows.resize(numRows);
+	row = 0;
+	for (int k=0;k<3;k++)
+	{
+		const btMultiBodyConstraintArray& rows = *rowArrays[k];
+		for (int j=0;j<rows.size();j++,row++)
+		{
+			btMultiBodyConstraintGroup& group = m_groups[m_rowGroups[row]];
+			if (k==0)
+				m_groupRows[group.m_firstRow + group.m_numNonContactRows++] = j;
+			else if (k==1)
+				m_groupRows[group.m_firstRow + group.m_numNonContactRows + group.m_numNormalRows++] = j;
+			else
+				m_groupRows[group.m_firstRow + group.m_numNonContactRows + group.m_numNormalRows + group.m_numFrictionRows++] = j;
+		}
 	}
-	return val;
 }
 
 btScalar btMultiBodyConstraintSolver::solveGroupCacheFriendlySetup(btCollisionObject** bodies,int numBodies,btPersistentManifold** manifoldPtr, int numManifolds,btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal,btIDebugDraw* debugDrawer)
@@ -100,13 +334,18 @@ btScalar btMultiBodyConstraintSolver::solveGroupCacheFriendlySetup(btCollisionOb
 
 	btScalar val = btSequentialImpulseConstraintSolver::solveGroupCacheFriendlySetup( bodies,numBodies,manifoldPtr, numManifolds, constraints,numConstraints,infoGlobal,debugDrawer);
 
+	m_groups.resize(0);
+	if (m_multithreaded)
+	{
+		setupIndependentGroups();
+	}
+
 	return val;
 }
 
 void	btMultiBodyConstraintSolver::applyDeltaVee(btScalar* delta_vee, btScalar impulse, int velocityIndex, int ndof)
 {
-    for (int i = 0; i < ndof; ++i) 
-		m_data.m_deltaVelocities[velocityIndex+i] += delta_vee[i] * impulse;
+	btMultiBodyAxpy(&m_data.m_deltaVelocities[velocityIndex],delta_vee,impulse,ndof);
 }
 
 void btMultiBodyConstraintSolver::resolveSingleConstraintRowGeneric(const btMultiBodySolverConstraint& c)
@@ -123,8 +362,7 @@ void btMultiBodyConstraintSolver::resolveSingleConstraintRowGeneric(const btMult
 	if (c.m_multiBodyA)
 	{
 		ndofA  = c.m_multiBodyA->getNumDofs() + 6;
-		for (int i = 0; i < ndofA; ++i) 
-			deltaVelADotn += m_data.m_jacobians[c.m_jacAindex+i] * m_data.m_deltaVelocities[c.m_deltaVelAindex+i];
+		deltaVelADotn = btMultiBodyDot(&m_data.m_jacobians[c.m_jacAindex],&m_data.m_deltaVelocities[c.m_deltaVelAindex],ndofA);
 	} else if(c.m_solverBodyIdA >= 0)
 	{
 		bodyA = &m_tmpSolverBodyPool[c.m_solverBodyIdA];
@@ -134,8 +372,7 @@ void btMultiBodyConstraintSolver::resolveSingleConstraintRowGeneric(const btMult
 	if (c.m_multiBodyB)
 	{
 		ndofB  = c.m_multiBodyB->getNumDofs() + 6;
-		for (int i = 0; i < ndofB; ++i) 
-			deltaVelBDotn += m_data.m_jacobians[c.m_jacBindex+i] * m_data.m_deltaVelocities[c.m_deltaVelBindex+i];
+		deltaVelBDotn = btMultiBodyDot(&m_data.m_jacobians[c.m_jacBindex],&m_data.m_deltaVelocities[c.m_deltaVelBindex],ndofB);
 	} else if(c.m_solverBodyIdB >= 0)
 	{
 		bodyB = &m_tmpSolverBodyPool[c.m_solverBodyIdB];
@@ -25,6 +25,15 @@ class btMultiBody;
 
 #include "btMultiBodyConstraint.h"
 
+///rows of btMultiBodyConstraintSolver that only share multibodies and dynamic rigid bodies with each other,
+///m_firstRow indexes btMultiBodyConstraintSolver::m_groupRows, first the non-contact, then the normal and then the friction rows
+struct btMultiBodyConstraintGroup
+{
+	int	m_firstRow;
+	int	m_numNonContactRows;
+	int	m_numNormalRows;
+	int	m_numFrictionRows;
+};
 
 
 ATTRIBUTE_ALIGNED16(class) btMultiBodyConstraintSolver : public btSequentialImpulseConstraintSolver
@@ -43,7 +52,24 @@ protected:
 	btMultiBodyConstraint**					m_tmpMultiBodyConstraints;
 	int										m_tmpNumMultiBodyConstraints;
 
+	bool									m_multithreaded;
+	btAlignedObjectArray<btMultiBodyConstraintGroup>	m_groups;
+	btAlignedObjectArray<int>				m_groupRows;
+	btAlignedObjectArray<int>				m_groupNodes;
+	btAlignedObjectArray<int>				m_nodeGroups;
+	btAlignedObjectArray<int>				m_rowGroups;
+
+	friend struct btMultiBodyConstraintGroupLoop;
+
 	void resolveSingleConstraintRowGeneric(const btMultiBodySolverConstraint& c);
+
+	void solveNonContactRow(int row);
+	void solveNormalContactRow(int row, int iteration, const btContactSolverInfo& infoGlobal);
+	void solveFrictionContactRow(int row, int iteration, const btContactSolverInfo& infoGlobal);
+
+	///setupIndependentGroups partitions the multibody rows into btMultiBodyConstraintGroup, keeping the order of the rows within each group
+	void setupIndependentGroups();
+	void solveGroupRows(int groupIndex, int iteration, const btContactSolverInfo& infoGlobal);
 	
 
 	void convertContacts(btPersistentManifold** manifoldPtr,int numManifolds, const btContactSolverInfo& infoGlobal);
@@ -72,6 +98,26 @@ public:
 
 	BT_DECLARE_ALIGNED_ALLOCATOR();
 
+	btMultiBodyConstraintSolver();
+
+	///with multithreading enabled the rows of independent multibodies are solved in parallel through btParallelFor.
+	///Rows are still solved in the serial order within each group, so the results don't depend on the number of threads.
+	///btMultiBodyDynamicsWorld batches islands up to btContactSolverInfo::m_minimumSolverBatchSize, raise it so more articulations are solved together.
+	void	setMultithreaded(bool multithreaded)
+	{
+		m_multithreaded = multithreaded;
+	}
+
+	bool	isMultithreaded() const
+	{
+		return m_multithreaded;
+	}
+
+	int	getNumIndependentGroups() const
+	{
+		return m_groups.size();
+	}
+
 	///this method should not be called, it was just used during porting/integration of Featherstone btMultiBody, providing backwards compatibility but no support for btMultiBodyConstraint (only contact constraints)
 	virtual btScalar solveGroup(btCollisionObject** bodies,int numBodies,btPersistentManifold** manifold,int numManifolds,btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& info, btIDebugDraw* debugDrawer,btDispatcher* dispatcher);
 	virtual btScalar solveGroupCacheFriendlyFinish(btCollisionObject** bodies,int numBodies,const btContactSolverInfo& infoGlobal);
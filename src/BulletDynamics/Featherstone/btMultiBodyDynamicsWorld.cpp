@@ -22,6 +22,7 @@ subject to the following restrictions:
 #include "btMultiBodyConstraint.h"
 #include "LinearMath/btIDebugDraw.h"
 #include "LinearMath/btSerializer.h"
+#include "LinearMath/btThreads.h"
 
 
 void	btMultiBodyDynamicsWorld::addMultiBody(btMultiBody* body, short group, short mask)
@@ -381,7 +382,8 @@ struct MultiBodyInplaceSolverIslandCallback : public btSimulationIslandManager::
 
 btMultiBodyDynamicsWorld::btMultiBodyDynamicsWorld(btDispatcher* dispatcher,btBroadphaseInterface* pairCache,btMultiBodyConstraintSolver* constraintSolver,btCollisionConfiguration* collisionConfiguration)
 	:btDiscreteDynamicsWorld(dispatcher,pairCache,constraintSolver,collisionConfiguration),
-	m_multiBodyConstraintSolver(constraintSolver)
+	m_multiBodyConstraintSolver(constraintSolver),
+	m_multithreaded(false)
 {
 	//split impulse is not yet supported for Featherstone hierarchies
 	getSolverInfo().m_splitImpulse = false;
@@ -394,24 +396,299 @@ btMultiBodyDynamicsWorld::~btMultiBodyDynamicsWorld ()
 	delete m_solverMultiBodyIslandCallback;
 }
 
-void	btMultiBodyDynamicsWorld::forwardKinematics()
+///btMultiBodyStepPhase selects the per-multibody work of btMultiBodyDynamicsWorld::stepMultiBodyRange
+enum btMultiBodyStepPhase
 {
-	btAlignedObjectArray<btQuaternion> world_to_local;
-	btAlignedObjectArray<btVector3> local_origin;
+	BT_MULTIBODY_FORWARD_KINEMATICS,
+	BT_MULTIBODY_STEP_VELOCITIES,		//unconstrained velocities (articulated body algorithm), or the RK4 step
+	BT_MULTIBODY_CONSTRAINT_VELOCITIES,	//constraint forces, and the delta velocities of the solver
+	BT_MULTIBODY_STEP_POSITIONS
+};
+
+#define BT_MULTIBODY_STEP_GRAIN 4
+
+struct btMultiBodyStepLoop : public btIParallelForBody
+{
+	btMultiBodyDynamicsWorld* m_world;
+	int m_phase;
+	btScalar m_timeStep;
 
-	for (int b=0;b<m_multiBodies.size();b++)
+	btMultiBodyStepLoop(btMultiBodyDynamicsWorld* world, int phase, btScalar timeStep)
+		:m_world(world), m_phase(phase), m_timeStep(timeStep)
 	{
-		btMultiBody* bod = m_multiBodies[b];
-		bod->forwardKinematics(world_to_local,local_origin);
 	}
+	void forLoop(int iBegin, int iEnd) const
+	{
+		m_world->stepMultiBodyRange(m_phase, iBegin, iEnd, m_timeStep);
+	}
+};
+
+static bool btIsMultiBodySleeping(const btMultiBody* bod)
+{
+	if (bod->getBaseCollider() && bod->getBaseCollider()->getActivationState() == ISLAND_SLEEPING)
+	{
+		return true;
+	} 
+	for (int b=0;b<bod->getNumLinks();b++)
+	{
+		if (bod->getLink(b).m_collider && bod->getLink(b).m_collider->getActivationState()==ISLAND_SLEEPING)
+			return true;
+	}
+	return false;
 }
-void	btMultiBodyDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
+
+void	btMultiBodyDynamicsWorld::stepMultiBodies(int phase, btScalar timeStep)
 {
-	forwardKinematics();
+	btMultiBodyStepLoop loop(this,phase,timeStep);
+	if (m_multithreaded)
+	{
+		btParallelFor(0,m_multiBodies.size(),BT_MULTIBODY_STEP_GRAIN,loop);
+	} else
+	{
+		loop.forLoop(0,m_multiBodies.size());
+	}
+}
 
+void	btMultiBodyDynamicsWorld::stepMultiBodyRange(int phase, int iBegin, int iEnd, btScalar timeStep)
+{
+	//scratch memory is local to each range, so ranges can run concurrently
 	btAlignedObjectArray<btScalar> scratch_r;
 	btAlignedObjectArray<btVector3> scratch_v;
 	btAlignedObjectArray<btMatrix3x3> scratch_m;
+	btAlignedObjectArray<btQuaternion> world_to_local;
+	btAlignedObjectArray<btVector3> local_origin;
+
+	for (int i=iBegin;i<iEnd;i++)
+	{
+		btMultiBody* bod = m_multiBodies[i];
+
+		if (phase == BT_MULTIBODY_FORWARD_KINEMATICS)
+		{
+			bod->forwardKinematics(world_to_local,local_origin);
+			continue;
+		}
+
+		if (btIsMultiBodySleeping(bod))
+		{
+			if (phase == BT_MULTIBODY_CONSTRAINT_VELOCITIES)
+			{
+				bod->processDeltaVeeMultiDof2();
+			} else if (phase == BT_MULTIBODY_STEP_POSITIONS)
+			{
+				bod->clearVelocities();
+			}
+			continue;
+		}
+
+		if (phase == BT_MULTIBODY_STEP_VELOCITIES)
+		{
+			//useless? they get resized in stepVelocities once again (AND DIFFERENTLY)
+			scratch_r.resize(bod->getNumLinks()+1);			//multidof? ("Y"s use it and it is used to store qdd)
+			scratch_v.resize(bod->getNumLinks()+1);
+			scratch_m.resize(bod->getNumLinks()+1);
+			bool doNotUpdatePos = false;
+
+			{
+				if(!bod->isUsingRK4Integration())
+				{
+					bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(timeStep, scratch_r, scratch_v, scratch_m);
+				}
+				else
+				{						
+					//
+					int numDofs = bod->getNumDofs() + 6;
+					int numPosVars = bod->getNumPosVars() + 7;
+					btAlignedObjectArray<btScalar> scratch_r2; scratch_r2.resize(2*numPosVars + 8*numDofs);
+					//convenience
+					btScalar *pMem = &scratch_r2[0];
+					btScalar *scratch_q0 = pMem; pMem += numPosVars;
+					btScalar *scratch_qx = pMem; pMem += numPosVars;
+					btScalar *scratch_qd0 = pMem; pMem += numDofs;
+					btScalar *scratch_qd1 = pMem; pMem += numDofs;
+					btScalar *scratch_qd2 = pMem; pMem += numDofs;
+					btScalar *scratch_qd3 = pMem; pMem += numDofs;
+					btScalar *scratch_qdd0 = pMem; pMem += numDofs;
+					btScalar *scratch_qdd1 = pMem; pMem += numDofs;
+					btScalar *scratch_qdd2 = pMem; pMem += numDofs;
+					btScalar *scratch_qdd3 = pMem; pMem += numDofs;
+					btAssert((pMem - (2*numPosVars + 8*numDofs)) == &scratch_r2[0]);
+
+					/////						
+					//copy q0 to scratch_q0 and qd0 to scratch_qd0
+					scratch_q0[0] = bod->getWorldToBaseRot().x();
+					scratch_q0[1] = bod->getWorldToBaseRot().y();
+					scratch_q0[2] = bod->getWorldToBaseRot().z();
+					scratch_q0[3] = bod->getWorldToBaseRot().w();
+					scratch_q0[4] = bod->getBasePos().x();
+					scratch_q0[5] = bod->getBasePos().y();
+					scratch_q0[6] = bod->getBasePos().z();
+					//
+					for(int link = 0; link < bod->getNumLinks(); ++link)
+					{
+						for(int dof = 0; dof < bod->getLink(link).m_posVarCount; ++dof)
+							scratch_q0[7 + bod->getLink(link).m_cfgOffset + dof] = bod->getLink(link).m_jointPos[dof];							
+					}
+					//
+					for(int dof = 0; dof < numDofs; ++dof)								
+						scratch_qd0[dof] = bod->getVelocityVector()[dof];
+					////
+					struct
+					{
+					    btMultiBody *bod;
+                            btScalar *scratch_qx, *scratch_q0;
+
+					    void operator()()
+					    {
+					        for(int dof = 0; dof < bod->getNumPosVars() + 7; ++dof)
+                                    scratch_qx[dof] = scratch_q0[dof];
+					    }
+					} pResetQx = {bod, scratch_qx, scratch_q0};
+					//
+					struct
+					{
+					    void operator()(btScalar dt, const btScalar *pDer, const btScalar *pCurVal, btScalar *pVal, int size)
+					    {
+					        for(int i = 0; i < size; ++i)
+                                    pVal[i] = pCurVal[i] + dt * pDer[i];
+					    }
+
+					} pEulerIntegrate;
+					//
+					struct
+                        {
+                            void operator()(btMultiBody *pBody, const btScalar *pData)
+                            {
+                                btScalar *pVel = const_cast<btScalar*>(pBody->getVelocityVector());
+
+                                for(int i = 0; i < pBody->getNumDofs() + 6; ++i)
+                                    pVel[i] = pData[i];
+
+                            }
+                        } pCopyToVelocityVector;
+					//
+                        struct
+					{
+					    void operator()(const btScalar *pSrc, btScalar *pDst, int start, int size)
+					    {
+					        for(int i = 0; i < size; ++i)
+                                    pDst[i] = pSrc[start + i];
+					    }
+					} pCopy;
+					//
+
+					btScalar h = timeStep;
+					#define output &scratch_r[bod->getNumDofs()]
+					//calc qdd0 from: q0 & qd0	
+					bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0., scratch_r, scratch_v, scratch_m);
+					pCopy(output, scratch_qdd0, 0, numDofs);
+					//calc q1 = q0 + h/2 * qd0
+					pResetQx();
+					bod->stepPositionsMultiDof(btScalar(.5)*h, scratch_qx, scratch_qd0);
+					//calc qd1 = qd0 + h/2 * qdd0
+					pEulerIntegrate(btScalar(.5)*h, scratch_qdd0, scratch_qd0, scratch_qd1, numDofs);
+					//
+					//calc qdd1 from: q1 & qd1
+					pCopyToVelocityVector(bod, scratch_qd1);
+					bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0., scratch_r, scratch_v, scratch_m);
+					pCopy(output, scratch_qdd1, 0, numDofs);
+					//calc q2 = q0 + h/2 * qd1
+					pResetQx();
+					bod->stepPositionsMultiDof(btScalar(.5)*h, scratch_qx, scratch_qd1);
+					//calc qd2 = qd0 + h/2 * qdd1
+					pEulerIntegrate(btScalar(.5)*h, scratch_qdd1, scratch_qd0, scratch_qd2, numDofs);
+					//
+					//calc qdd2 from: q2 & qd2
+					pCopyToVelocityVector(bod, scratch_qd2);
+					bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0., scratch_r, scratch_v, scratch_m);
+					pCopy(output, scratch_qdd2, 0, numDofs);
+					//calc q3 = q0 + h * qd2
+					pResetQx();
+					bod->stepPositionsMultiDof(h, scratch_qx, scratch_qd2);
+					//calc qd3 = qd0 + h * qdd2
+					pEulerIntegrate(h, scratch_qdd2, scratch_qd0, scratch_qd3, numDofs);
+					//
+					//calc qdd3 from: q3 & qd3
+					pCopyToVelocityVector(bod, scratch_qd3);
+					bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0., scratch_r, scratch_v, scratch_m);
+					pCopy(output, scratch_qdd3, 0, numDofs);
+
+					//
+					//calc q = q0 + h/6(qd0 + 2*(qd1 + qd2) + qd3)
+					//calc qd = qd0 + h/6(qdd0 + 2*(qdd1 + qdd2) + qdd3)						
+					btAlignedObjectArray<btScalar> delta_q; delta_q.resize(numDofs);
+					btAlignedObjectArray<btScalar> delta_qd; delta_qd.resize(numDofs);
+					for(int i = 0; i < numDofs; ++i)
+					{
+						delta_q[i] = h/btScalar(6.)*(scratch_qd0[i] + 2*scratch_qd1[i] + 2*scratch_qd2[i] + scratch_qd3[i]);
+						delta_qd[i] = h/btScalar(6.)*(scratch_qdd0[i] + 2*scratch_qdd1[i] + 2*scratch_qdd2[i] + scratch_qdd3[i]);							
+						//delta_q[i] = h*scratch_qd0[i];
+						//delta_qd[i] = h*scratch_qdd0[i];
+					}
+					//
+					pCopyToVelocityVector(bod, scratch_qd0);
+					bod->applyDeltaVeeMultiDof(&delta_qd[0], 1);						
+					//
+					if(!doNotUpdatePos)
+					{
+						btScalar *pRealBuf = const_cast<btScalar *>(bod->getVelocityVector());
+						pRealBuf += 6 + bod->getNumDofs() + bod->getNumDofs()*bod->getNumDofs();
+
+						for(int i = 0; i < numDofs; ++i)
+							pRealBuf[i] = delta_q[i];
+
+						//bod->stepPositionsMultiDof(1, 0, &delta_q[0]);
+						bod->setPosUpdated(true);							
+					}
+
+					//ugly hack which resets the cached data to t0 (needed for constraint solver)
+					{
+						for(int link = 0; link < bod->getNumLinks(); ++link)
+							bod->getLink(link).updateCacheMultiDof();
+						bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0, scratch_r, scratch_v, scratch_m);
+					}
+					
+				}
+			}
+			
+#ifndef BT_USE_VIRTUAL_CLEARFORCES_AND_GRAVITY
+			bod->clearForcesAndTorques();
+#endif //BT_USE_VIRTUAL_CLEARFORCES_AND_GRAVITY
+		} else if (phase == BT_MULTIBODY_CONSTRAINT_VELOCITIES)
+		{
+			scratch_r.resize(bod->getNumLinks()+1);
+			scratch_v.resize(bod->getNumLinks()+1);
+			scratch_m.resize(bod->getNumLinks()+1);
+			if(!bod->isUsingRK4Integration())
+			{
+				bool isConstraintPass = true;
+				bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(timeStep, scratch_r, scratch_v, scratch_m, isConstraintPass);
+			}
+			bod->processDeltaVeeMultiDof2();
+		} else
+		{
+			if(!bod->isPosUpdated())
+				bod->stepPositionsMultiDof(timeStep);
+			else
+			{
+				btScalar *pRealBuf = const_cast<btScalar *>(bod->getVelocityVector());
+				pRealBuf += 6 + bod->getNumDofs() + bod->getNumDofs()*bod->getNumDofs();
+
+				bod->stepPositionsMultiDof(1, 0, pRealBuf);
+				bod->setPosUpdated(false);
+			}
+
+			bod->updateCollisionObjectWorldTransforms(world_to_local,local_origin);
+		}
+	}
+}
+
+void	btMultiBodyDynamicsWorld::forwardKinematics()
+{
+	stepMultiBodies(BT_MULTIBODY_FORWARD_KINEMATICS,0);
+}
+void	btMultiBodyDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
+{
+	forwardKinematics();
 
 
 	BT_PROFILE("solveConstraints");
@@ -462,11 +739,6 @@ void	btMultiBodyDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
 
 			if (!isSleeping)
 			{
-				//useless? they get resized in stepVelocities once again (AND DIFFERENTLY)
-				scratch_r.resize(bod->getNumLinks()+1);			//multidof? ("Y"s use it and it is used to store qdd)
-				scratch_v.resize(bod->getNumLinks()+1);
-				scratch_m.resize(bod->getNumLinks()+1);
-
 				bod->addBaseForce(m_gravity * bod->getBaseMass());
 
 				for (int j = 0; j < bod->getNumLinks(); ++j) 
@@ -481,197 +753,7 @@ void	btMultiBodyDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
 
 	{
 		BT_PROFILE("btMultiBody stepVelocities");
-		for (int i=0;i<this->m_multiBodies.size();i++)
-		{
-			btMultiBody* bod = m_multiBodies[i];
-
-			bool isSleeping = false;
-			
-			if (bod->getBaseCollider() && bod->getBaseCollider()->getActivationState() == ISLAND_SLEEPING)
-			{
-				isSleeping = true;
-			} 
-			for (int b=0;b<bod->getNumLinks();b++)
-			{
-				if (bod->getLink(b).m_collider && bod->getLink(b).m_collider->getActivationState()==ISLAND_SLEEPING)
-					isSleeping = true;
-			} 
-
-			if (!isSleeping)
-			{
-				//useless? they get resized in stepVelocities once again (AND DIFFERENTLY)
-				scratch_r.resize(bod->getNumLinks()+1);			//multidof? ("Y"s use it and it is used to store qdd)
-				scratch_v.resize(bod->getNumLinks()+1);
-				scratch_m.resize(bod->getNumLinks()+1);
-				bool doNotUpdatePos = false;
-
-				{
-					if(!bod->isUsingRK4Integration())
-					{
-						bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(solverInfo.m_timeStep, scratch_r, scratch_v, scratch_m);
-					}
-					else
-					{						
-						//
-						int numDofs = bod->getNumDofs() + 6;
-						int numPosVars = bod->getNumPosVars() + 7;
-						btAlignedObjectArray<btScalar> scratch_r2; scratch_r2.resize(2*numPosVars + 8*numDofs);
-						//convenience
-						btScalar *pMem = &scratch_r2[0];
-						btScalar *scratch_q0 = pMem; pMem += numPosVars;
-						btScalar *scratch_qx = pMem; pMem += numPosVars;
-						btScalar *scratch_qd0 = pMem; pMem += numDofs;
-						btScalar *scratch_qd1 = pMem; pMem += numDofs;
-						btScalar *scratch_qd2 = pMem; pMem += numDofs;
-						btScalar *scratch_qd3 = pMem; pMem += numDofs;
-						btScalar *scratch_qdd0 = pMem; pMem += numDofs;
-						btScalar *scratch_qdd1 = pMem; pMem += numDofs;
-						btScalar *scratch_qdd2 = pMem; pMem += numDofs;
-						btScalar *scratch_qdd3 = pMem; pMem += numDofs;
-						btAssert((pMem - (2*numPosVars + 8*numDofs)) == &scratch_r2[0]);
-
-						/////						
-						//copy q0 to scratch_q0 and qd0 to scratch_qd0
-						scratch_q0[0] = bod->getWorldToBaseRot().x();
-						scratch_q0[1] = bod->getWorldToBaseRot().y();
-						scratch_q0[2] = bod->getWorldToBaseRot().z();
-						scratch_q0[3] = bod->getWorldToBaseRot().w();
-						scratch_q0[4] = bod->getBasePos().x();
-						scratch_q0[5] = bod->getBasePos().y();
-						scratch_q0[6] = bod->getBasePos().z();
-						//
-						for(int link = 0; link < bod->getNumLinks(); ++link)
-						{
-							for(int dof = 0; dof < bod->getLink(link).m_posVarCount; ++dof)
-								scratch_q0[7 + bod->getLink(link).m_cfgOffset + dof] = bod->getLink(link).m_jointPos[dof];							
-						}
-						//
-						for(int dof = 0; dof < numDofs; ++dof)								
-							scratch_qd0[dof] = bod->getVelocityVector()[dof];
-						////
-						struct
-						{
-						    btMultiBody *bod;
-                            btScalar *scratch_qx, *scratch_q0;
-
-						    void operator()()
-						    {
-						        for(int dof = 0; dof < bod->getNumPosVars() + 7; ++dof)
-                                    scratch_qx[dof] = scratch_q0[dof];
-						    }
-						} pResetQx = {bod, scratch_qx, scratch_q0};
-						//
-						struct
-						{
-						    void operator()(btScalar dt, const btScalar *pDer, const btScalar *pCurVal, btScalar *pVal, int size)
-						    {
-						        for(int i = 0; i < size; ++i)
-                                    pVal[i] = pCurVal[i] + dt * pDer[i];
-						    }
-
-						} pEulerIntegrate;
-						//
-						struct
-                        {
-                            void operator()(btMultiBody *pBody, const btScalar *pData)
-                            {
-                                btScalar *pVel = const_cast<btScalar*>(pBody->getVelocityVector());
-
-                                for(int i = 0; i < pBody->getNumDofs() + 6; ++i)
-                                    pVel[i] = pData[i];
-
-                            }
-                        } pCopyToVelocityVector;
-						//
-                        struct
-						{
-						    void operator()(const btScalar *pSrc, btScalar *pDst, int start, int size)
-						    {
-						        for(int i = 0; i < size; ++i)
-                                    pDst[i] = pSrc[start + i];
-						    }
-						} pCopy;
-						//
-
-						btScalar h = solverInfo.m_timeStep;
-						#define output &scratch_r[bod->getNumDofs()]
-						//calc qdd0 from: q0 & qd0	
-						bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0., scratch_r, scratch_v, scratch_m);
-						pCopy(output, scratch_qdd0, 0, numDofs);
-						//calc q1 = q0 + h/2 * qd0
-						pResetQx();
-						bod->stepPositionsMultiDof(btScalar(.5)*h, scratch_qx, scratch_qd0);
-						//calc qd1 = qd0 + h/2 * qdd0
-						pEulerIntegrate(btScalar(.5)*h, scratch_qdd0, scratch_qd0, scratch_qd1, numDofs);
-						//
-						//calc qdd1 from: q1 & qd1
-						pCopyToVelocityVector(bod, scratch_qd1);
-						bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0., scratch_r, scratch_v, scratch_m);
-						pCopy(output, scratch_qdd1, 0, numDofs);
-						//calc q2 = q0 + h/2 * qd1
-						pResetQx();
-						bod->stepPositionsMultiDof(btScalar(.5)*h, scratch_qx, scratch_qd1);
-						//calc qd2 = qd0 + h/2 * qdd1
-						pEulerIntegrate(btScalar(.5)*h, scratch_qdd1, scratch_qd0, scratch_qd2, numDofs);
-						//
-						//calc qdd2 from: q2 & qd2
-						pCopyToVelocityVector(bod, scratch_qd2);
-						bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0., scratch_r, scratch_v, scratch_m);
-						pCopy(output, scratch_qdd2, 0, numDofs);
-						//calc q3 = q0 + h * qd2
-						pResetQx();
-						bod->stepPositionsMultiDof(h, scratch_qx, scratch_qd2);
-						//calc qd3 = qd0 + h * qdd2
-						pEulerIntegrate(h, scratch_qdd2, scratch_qd0, scratch_qd3, numDofs);
-						//
-						//calc qdd3 from: q3 & qd3
-						pCopyToVelocityVector(bod, scratch_qd3);
-						bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0., scratch_r, scratch_v, scratch_m);
-						pCopy(output, scratch_qdd3, 0, numDofs);
-
-						//
-						//calc q = q0 + h/6(qd0 + 2*(qd1 + qd2) + qd3)
-						//calc qd = qd0 + h/6(qdd0 + 2*(qdd1 + qdd2) + qdd3)						
-						btAlignedObjectArray<btScalar> delta_q; delta_q.resize(numDofs);
-						btAlignedObjectArray<btScalar> delta_qd; delta_qd.resize(numDofs);
-						for(int i = 0; i < numDofs; ++i)
-						{
-							delta_q[i] = h/btScalar(6.)*(scratch_qd0[i] + 2*scratch_qd1[i] + 2*scratch_qd2[i] + scratch_qd3[i]);
-							delta_qd[i] = h/btScalar(6.)*(scratch_qdd0[i] + 2*scratch_qdd1[i] + 2*scratch_qdd2[i] + scratch_qdd3[i]);							
-							//delta_q[i] = h*scratch_qd0[i];
-							//delta_qd[i] = h*scratch_qdd0[i];
-						}
-						//
-						pCopyToVelocityVector(bod, scratch_qd0);
-						bod->applyDeltaVeeMultiDof(&delta_qd[0], 1);						
-						//
-						if(!doNotUpdatePos)
-						{
-							btScalar *pRealBuf = const_cast<btScalar *>(bod->getVelocityVector());
-							pRealBuf += 6 + bod->getNumDofs() + bod->getNumDofs()*bod->getNumDofs();
-
-							for(int i = 0; i < numDofs; ++i)
-								pRealBuf[i] = delta_q[i];
-
-							//bod->stepPositionsMultiDof(1, 0, &delta_q[0]);
-							bod->setPosUpdated(true);							
-						}
-
-						//ugly hack which resets the cached data to t0 (needed for constraint solver)
-						{
-							for(int link = 0; link < bod->getNumLinks(); ++link)
-								bod->getLink(link).updateCacheMultiDof();
-							bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0, scratch_r, scratch_v, scratch_m);
-						}
-						
-					}
-				}
-				
-#ifndef BT_USE_VIRTUAL_CLEARFORCES_AND_GRAVITY
-				bod->clearForcesAndTorques();
-#endif //BT_USE_VIRTUAL_CLEARFORCES_AND_GRAVITY
-			}//if (!isSleeping)
-		}
+		stepMultiBodies(BT_MULTIBODY_STEP_VELOCITIES,solverInfo.m_timeStep);
 	}
 
 	clearMultiBodyConstraintForces();
@@ -681,46 +763,8 @@ void	btMultiBodyDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
 	m_constraintSolver->allSolved(solverInfo, m_debugDrawer);
 
 	{
-                BT_PROFILE("btMultiBody stepVelocities");
-                for (int i=0;i<this->m_multiBodies.size();i++)
-                {
-                        btMultiBody* bod = m_multiBodies[i];
-
-                        bool isSleeping = false;
-
-                        if (bod->getBaseCollider() && bod->getBaseCollider()->getActivationState() == ISLAND_SLEEPING)
-                        {
-                                isSleeping = true;
-                        }
-                        for (int b=0;b<bod->getNumLinks();b++)
-                        {
-                                if (bod->getLink(b).m_collider && bod->getLink(b).m_collider->getActivationState()==ISLAND_SLEEPING)
-                                        isSleeping = true;
-                        }
-
-                        if (!isSleeping)
-                        {
-                                //useless? they get resized in stepVelocities once again (AND DIFFERENTLY)
-                                scratch_r.resize(bod->getNumLinks()+1);                 //multidof? ("Y"s use it and it is used to store qdd)
-                                scratch_v.resize(bod->getNumLinks()+1);
-                                scratch_m.resize(bod->getNumLinks()+1);
-
-                                
-                            {
-                                if(!bod->isUsingRK4Integration())
-                                {
-									bool isConstraintPass = true;
-                                    bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof(solverInfo.m_timeStep, scratch_r, scratch_v, scratch_m, isConstraintPass);
-                                }
-				}
-			}
-		}
-	}
-
-	for (int i=0;i<this->m_multiBodies.size();i++)
-	{
-		btMultiBody* bod = m_multiBodies[i];
-		bod->processDeltaVeeMultiDof2();
+		BT_PROFILE("btMultiBody stepVelocities");
+		stepMultiBodies(BT_MULTIBODY_CONSTRAINT_VELOCITIES,solverInfo.m_timeStep);
 	}
 
 }
@@ -732,54 +776,7 @@ void	btMultiBodyDynamicsWorld::integrateTransforms(btScalar timeStep)
 	{
 		BT_PROFILE("btMultiBody stepPositions");
 		//integrate and update the Featherstone hierarchies
-		btAlignedObjectArray<btQuaternion> world_to_local;
-		btAlignedObjectArray<btVector3> local_origin;
-
-		for (int b=0;b<m_multiBodies.size();b++)
-		{
-			btMultiBody* bod = m_multiBodies[b];
-			bool isSleeping = false;
-			if (bod->getBaseCollider() && bod->getBaseCollider()->getActivationState() == ISLAND_SLEEPING)
-			{
-				isSleeping = true;
-			} 
-			for (int b=0;b<bod->getNumLinks();b++)
-			{
-				if (bod->getLink(b).m_collider && bod->getLink(b).m_collider->getActivationState()==ISLAND_SLEEPING)
-					isSleeping = true;
-			}
-
-
-			if (!isSleeping)
-			{
-				int nLinks = bod->getNumLinks();
-
-				///base + num m_links
-			
-				
-				{
-					if(!bod->isPosUpdated())
-						bod->stepPositionsMultiDof(timeStep);
-					else
-					{
-						btScalar *pRealBuf = const_cast<btScalar *>(bod->getVelocityVector());
-						pRealBuf += 6 + bod->getNumDofs() + bod->getNumDofs()*bod->getNumDofs();
-
-						bod->stepPositionsMultiDof(1, 0, pRealBuf);
-						bod->setPosUpdated(false);
-					}
-				}
-				
-				world_to_local.resize(nLinks+1);
-				local_origin.resize(nLinks+1);
-
-				bod->updateCollisionObjectWorldTransforms(world_to_local,local_origin);
-				
-			} else
-			{
-				bod->clearVelocities();
-			}
-		}
+		stepMultiBodies(BT_MULTIBODY_STEP_POSITIONS,timeStep);
 	}
 }
 
@@ -35,6 +35,9 @@ protected:
 	btAlignedObjectArray<btMultiBodyConstraint*> m_sortedMultiBodyConstraints;
 	btMultiBodyConstraintSolver*	m_multiBodyConstraintSolver;
 	MultiBodyInplaceSolverIslandCallback*	m_solverMultiBodyIslandCallback;
+	bool	m_multithreaded;
+
+	friend struct btMultiBodyStepLoop;
 
 	virtual void	calculateSimulationIslands();
 	virtual void	updateActivationState(btScalar timeStep);
@@ -42,6 +45,10 @@ protected:
 	
 	virtual void	serializeMultiBodies(btSerializer* serializer);
 
+	///stepMultiBodies runs one phase of the Featherstone step (see btMultiBodyStepPhase) over all multibodies
+	void	stepMultiBodies(int phase, btScalar timeStep);
+	void	stepMultiBodyRange(int phase, int iBegin, int iEnd, btScalar timeStep);
+
 public:
 
 	btMultiBodyDynamicsWorld(btDispatcher* dispatcher,btBroadphaseInterface* pairCache,btMultiBodyConstraintSolver* constraintSolver,btCollisionConfiguration* collisionConfiguration);
@@ -88,6 +95,19 @@ public:
 	virtual void	debugDrawMultiBodyConstraint(btMultiBodyConstraint* constraint);
 	
 	void	forwardKinematics();
+
+	///with multithreading enabled the articulated body algorithm, the position integration and the forward kinematics
+	///of the multibodies run in parallel through btParallelFor, one multibody per task. The results don't depend on the number of threads.
+	void	setMultithreaded(bool multithreaded)
+	{
+		m_multithreaded = multithreaded;
+	}
+
+	bool	isMultithreaded() const
+	{
+		return m_multithreaded;
+	}
+
 	virtual void clearForces();
 	virtual void clearMultiBodyConstraintForces();
 	virtual void clearMultiBodyForces();
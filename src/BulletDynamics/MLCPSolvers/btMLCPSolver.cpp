@@ -17,13 +17,22 @@ subject to the following restrictions:
 #include "btMLCPSolver.h"
 #include "LinearMath/btMatrixX.h"
 #include "LinearMath/btQuickprof.h"
+#include "LinearMath/btThreads.h"
 #include "btSolveProjectedGaussSeidel.h"
 
 
 btMLCPSolver::btMLCPSolver(	 btMLCPSolverInterface* solver)
-:m_solver(solver),
+:m_useSparseMatrix(false),
+m_multithreaded(false),
+m_solver(solver),
 m_fallback(0),
-m_cfm(0.000001)//0.0000001
+m_cfm(0.000001),//0.0000001
+m_warmStartActiveSet(false),
+m_activeSetHits(0),
+m_activeSetIterations(8),
+m_activeSetMisses(0),
+m_activeSetSkip(0),
+m_activeSetTolerance(btScalar(1e-4))
 {
 }
 
@@ -31,6 +40,23 @@ btMLCPSolver::~btMLCPSolver()
 {
 }
 
+void btMLCPSolver::prepareSolve(int numBodies, int numManifolds)
+{
+	btSequentialImpulseConstraintSolver::prepareSolve(numBodies, numManifolds);
+	//every island of the previous step added its joint rows, they warm start this step
+	m_jointCache.clear();
+	for (int i=0;i<m_nextJointCache.size();i++)
+	{
+		const btMLCPCachedJoint* cached = m_nextJointCache.getAtIndex(i);
+		m_jointCache.insert(btHashPtr(cached->m_constraint), *cached);
+	}
+	m_jointCacheImpulses.copyFromArray(m_nextJointCacheImpulses);
+	m_jointCachePushImpulses.copyFromArray(m_nextJointCachePushImpulses);
+	m_nextJointCache.clear();
+	m_nextJointCacheImpulses.resize(0);
+	m_nextJointCachePushImpulses.resize(0);
+}
+
 bool gUseMatrixMultiply = false;
 bool interleaveContactAndFriction = false;
 
@@ -104,11 +130,17 @@ btScalar btMLCPSolver::solveGroupCacheFriendlySetup(btCollisionObject** bodies,
 	}
 
 	
+	m_useSparseMatrix = !gUseMatrixMultiply && m_solver->supportsSparseMatrix();
 	if (gUseMatrixMultiply)
 	{
 		BT_PROFILE("createMLCP");
 		createMLCP(infoGlobal);
 	}
+	else if (m_useSparseMatrix)
+	{
+		BT_PROFILE("createMLCPSparse");
+		createMLCPSparse(infoGlobal);
+	}
 	else
 	{
 		BT_PROFILE("createMLCPFast");
@@ -122,26 +154,315 @@ bool btMLCPSolver::solveMLCP(const btContactSolverInfo& infoGlobal)
 {
 	bool result = true;
 
-	if (m_A.rows()==0)
+	if (m_b.rows()==0)
 		return true;
 
+	if (m_useSparseMatrix)
+	{
+		//the sparse solvers don't modify A, both (M)LCPs share it. The active set warm start needs the dense A, the
+		//iterative sparse solvers only start from the warm started joint rows of createMLCPVectors
+		result = m_solver->solveSparseMLCP(m_sparseA, m_b, m_x, m_lo,m_hi, m_limitDependencies,infoGlobal.m_numIterations );
+		if (result && infoGlobal.m_splitImpulse)
+			result = m_solver->solveSparseMLCP(m_sparseA, m_bSplit, m_xSplit, m_lo,m_hi, m_limitDependencies,infoGlobal.m_numIterations );
+		return result;
+	}
+
+	bool warmStart = m_warmStartActiveSet;
+	if (warmStart && m_activeSetSkip>0)
+	{
+		m_activeSetSkip--;
+		warmStart = false;
+	}
+	bool missed = false;
+
 	//if using split impulse, we solve 2 separate (M)LCPs
 	if (infoGlobal.m_splitImpulse)
 	{
 		btMatrixXu Acopy = m_A;
 		btAlignedObjectArray<int> limitDependenciesCopy = m_limitDependencies;
 //		printf("solve first LCP\n");
-		result = m_solver->solveMLCP(m_A, m_b, m_x, m_lo,m_hi, m_limitDependencies,infoGlobal.m_numIterations );
-		if (result)
+		if (!warmStart || !solveActiveSet(m_b, m_x, m_x))
+		{
+			missed = warmStart;
+			result = m_solver->solveMLCP(m_A, m_b, m_x, m_lo,m_hi, m_limitDependencies,infoGlobal.m_numIterations );
+		}
+		//push impulses are not warm started for contacts, the velocity solution is the next best guess of their active set
+		if (result && (!warmStart || (!solveActiveSet(m_bSplit, m_xSplit, m_xSplit) && !solveActiveSet(m_bSplit, m_xSplit, m_x))))
+		{
+			missed = warmStart;
 			result = m_solver->solveMLCP(Acopy, m_bSplit, m_xSplit, m_lo,m_hi, limitDependenciesCopy,infoGlobal.m_numIterations );
+		}
 
 	} else
 	{
-		result = m_solver->solveMLCP(m_A, m_b, m_x, m_lo,m_hi, m_limitDependencies,infoGlobal.m_numIterations );
+		if (!warmStart || !solveActiveSet(m_b, m_x, m_x))
+		{
+			missed = warmStart;
+			result = m_solver->solveMLCP(m_A, m_b, m_x, m_lo,m_hi, m_limitDependencies,infoGlobal.m_numIterations );
+		}
+	}
+
+	//a missed guess costs a factorization on top of the MLCP solver, skip the next steps while the active set keeps changing
+	if (missed)
+	{
+		m_activeSetMisses = btMin(m_activeSetMisses+1, 4);
+		m_activeSetSkip = (1<<m_activeSetMisses)-1;
+	} else if (warmStart)
+	{
+		m_activeSetMisses = 0;
 	}
 	return result;
 }
 
+void btMLCPSolver::warmStartJointRows()
+{
+	//the joint rows come first in m_allConstraintPtrArray, in the order of m_tmpSolverNonContactConstraintPool
+	int row = 0;
+	for (int c=0;c<m_tmpConstraintSizesPool.size();c++)
+	{
+		int numRows = m_tmpConstraintSizesPool[c].m_numConstraintRows;
+		if (!numRows)
+			continue;
+		const btMLCPCachedJoint* cached = m_jointCache.find(btHashPtr(m_tmpSolverNonContactConstraintPool[row].m_originalContactPoint));
+		if (cached && cached->m_numRows==numRows)
+		{
+			for (int r=0;r<numRows;r++)
+			{
+				m_x[row+r] = m_jointCacheImpulses[cached->m_firstRow+r];
+				m_xSplit[row+r] = m_jointCachePushImpulses[cached->m_firstRow+r];
+			}
+		}
+		row += numRows;
+	}
+}
+
+void btMLCPSolver::cacheJointRows()
+{
+	int row = 0;
+	for (int c=0;c<m_tmpConstraintSizesPool.size();c++)
+	{
+		int numRows = m_tmpConstraintSizesPool[c].m_numConstraintRows;
+		if (!numRows)
+			continue;
+		btMLCPCachedJoint cached;
+		cached.m_constraint = m_tmpSolverNonContactConstraintPool[row].m_originalContactPoint;
+		cached.m_firstRow = m_nextJointCacheImpulses.size();
+		cached.m_numRows = numRows;
+		m_nextJointCache.insert(btHashPtr(cached.m_constraint), cached);
+		for (int r=0;r<numRows;r++)
+		{
+			m_nextJointCacheImpulses.push_back(m_tmpSolverNonContactConstraintPool[row+r].m_appliedImpulse);
+			m_nextJointCachePushImpulses.push_back(m_tmpSolverNonContactConstraintPool[row+r].m_appliedPushImpulse);
+		}
+		row += numRows;
+	}
+}
+
+//friction limits depend on the normal impulse, like the findex of btSolveDantzigLCP
+void btMLCPSolver::activeSetLimits(int row, const btVectorXu& x, btScalar& lo, btScalar& hi) const
+{
+	int dependency = m_limitDependencies[row];
+	if (dependency>=0)
+	{
+		hi = btFabs(m_hi[row]*x[dependency]);
+		lo = -hi;
+	} else
+	{
+		lo = m_lo[row];
+		hi = m_hi[row];
+	}
+}
+
+//in place Cholesky factorization of the lower triangle of a row major n x n matrix, restricted to its envelope:
+//row i of A (and L) is zero before column first[i]. Constraints only couple through shared bodies, so the envelope is
+//usually much smaller than the full triangle.
+static bool btCholeskyFactor(btScalar* L, const int* first, int n)
+{
+	for (int j=0;j<n;j++)
+	{
+		btScalar* Lj = L+(size_t)j*n;
+		btScalar d = Lj[j];
+		for (int k=first[j];k<j;k++)
+			d -= Lj[k]*Lj[k];
+		if (!(d>btScalar(0)))
+			return false;
+		d = btSqrt(d);
+		Lj[j] = d;
+		btScalar invD = btScalar(1)/d;
+		for (int i=j+1;i<n;i++)
+		{
+			if (first[i]>j)
+				continue;
+			btScalar* Li = L+(size_t)i*n;
+			btScalar sum = Li[j];
+			for (int k=btMax(first[i],first[j]);k<j;k++)
+				sum -= Li[k]*Lj[k];
+			Li[j] = sum*invD;
+		}
+	}
+	return true;
+}
+
+static void btCholeskySolve(const btScalar* L, const int* first, int n, btScalar* x)
+{
+	for (int i=0;i<n;i++)
+	{
+		const btScalar* Li = L+(size_t)i*n;
+		btScalar sum = x[i];
+		for (int k=first[i];k<i;k++)
+			sum -= Li[k]*x[k];
+		x[i] = sum/Li[i];
+	}
+	for (int i=n-1;i>=0;i--)
+	{
+		const btScalar* Li = L+(size_t)i*n;
+		x[i] /= Li[i];
+		for (int k=first[i];k<i;k++)
+			x[k] -= Li[k]*x[i];
+	}
+}
+
+///solveActiveSet takes the rows at a limit in 'guess' as the active set: those rows are fixed at their limit and the free rows
+///are solved directly (A is symmetric positive definite, thanks to the cfm). Rows that violate their limits or the
+///complementarity conditions switch sets for up to m_activeSetIterations solves. The solution is only written to x
+///when it is a valid MLCP solution, so the caller can fall back to the MLCP solver.
+bool btMLCPSolver::solveActiveSet(const btVectorXu& b, btVectorXu& x, const btVectorXu& guess)
+{
+	BT_PROFILE("solveActiveSet");
+	int n = m_A.rows();
+	const btScalar* A = m_A.getBufferPointer();
+	const btScalar tol = m_activeSetTolerance;
+
+	m_activeSetState.resizeNoInitialize(n);
+	m_activeSetX = guess;
+	for (int i=0;i<n;i++)
+	{
+		btScalar lo, hi;
+		activeSetLimits(i, guess, lo, hi);
+		int state = 0;
+		if (lo>-BT_INFINITY && guess[i]<=lo+tol*btFabs(lo))
+			state = -1;
+		else if (hi<BT_INFINITY && guess[i]>=hi-tol*btFabs(hi))
+			state = 1;
+		m_activeSetState[i] = state;
+	}
+
+	for (int iteration=0;iteration<m_activeSetIterations;iteration++)
+	{
+		m_activeSetRows.resize(0);
+		bool dependentLimits = false;
+		for (int i=0;i<n;i++)
+		{
+			if (!m_activeSetState[i])
+				m_activeSetRows.push_back(i);
+			else if (m_limitDependencies[i]>=0)
+				dependentLimits = true;
+		}
+
+		int f = m_activeSetRows.size();
+		m_activeSetL.resizeNoInitialize(f*f);
+		m_activeSetFirst.resizeNoInitialize(f);
+		m_activeSetRhs.resizeNoInitialize(f);
+		for (int r=0;r<f;r++)
+		{
+			const btScalar* Arow = A+(size_t)m_activeSetRows[r]*n;
+			btScalar* Lrow = &m_activeSetL[r*f];
+			int first = r;
+			for (int c=0;c<=r;c++)
+			{
+				Lrow[c] = Arow[m_activeSetRows[c]];
+				if (Lrow[c]!=btScalar(0) && c<first)
+					first = c;
+			}
+			m_activeSetFirst[r] = first;
+		}
+		if (f && !btCholeskyFactor(&m_activeSetL[0], &m_activeSetFirst[0], f))
+			return false;
+
+		//the limits of clamped friction rows follow the normal impulse, a second pass uses the updated normal impulses
+		int numPasses = dependentLimits ? 2 : 1;
+		for (int pass=0;pass<numPasses;pass++)
+		{
+			for (int i=0;i<n;i++)
+			{
+				if (m_activeSetState[i])
+				{
+					btScalar lo, hi;
+					activeSetLimits(i, m_activeSetX, lo, hi);
+					m_activeSetX[i] = m_activeSetState[i]<0 ? lo : hi;
+				}
+			}
+			for (int r=0;r<f;r++)
+			{
+				int i = m_activeSetRows[r];
+				const btScalar* Arow = A+(size_t)i*n;
+				btScalar rhs = b[i];
+				for (int j=0;j<n;j++)
+				{
+					if (m_activeSetState[j])
+						rhs -= Arow[j]*m_activeSetX[j];
+				}
+				m_activeSetRhs[r] = rhs;
+			}
+			if (f)
+				btCholeskySolve(&m_activeSetL[0], &m_activeSetFirst[0], f, &m_activeSetRhs[0]);
+			for (int r=0;r<f;r++)
+				m_activeSetX[m_activeSetRows[r]] = m_activeSetRhs[r];
+		}
+
+		//free rows must be within their limits, clamped rows must push in the right direction: w = A*x-b >= 0 at lo, <= 0 at hi
+		bool valid = true;
+		for (int i=0;i<n;i++)
+		{
+			const btScalar* Arow = A+(size_t)i*n;
+			btScalar xi = m_activeSetX[i];
+			if (!(btFabs(xi)<BT_INFINITY))
+				return false;
+			btScalar lo, hi;
+			activeSetLimits(i, m_activeSetX, lo, hi);
+			btScalar slack = tol*(btFabs(xi)+btFabs(b[i])/Arow[i])+SIMD_EPSILON;
+			int state = m_activeSetState[i];
+			if (!state)
+			{
+				if (xi<lo-slack)
+				{
+					m_activeSetState[i] = -1;
+					valid = false;
+				} else if (xi>hi+slack)
+				{
+					m_activeSetState[i] = 1;
+					valid = false;
+				}
+				continue;
+			}
+			btScalar bound = state<0 ? lo : hi;
+			if (btFabs(xi-bound)>slack)
+				valid = false;
+			btScalar w = -b[i];
+			for (int j=0;j<n;j++)
+				w += Arow[j]*m_activeSetX[j];
+			if (w*btScalar(state) > tol*(btFabs(b[i])+Arow[i]*btFabs(xi))+SIMD_EPSILON)
+			{
+				m_activeSetState[i] = 0;
+				valid = false;
+			}
+		}
+
+		if (valid)
+		{
+			for (int i=0;i<n;i++)
+			{
+				btScalar lo, hi;
+				activeSetLimits(i, m_activeSetX, lo, hi);
+				x[i] = btMax(lo, btMin(hi, m_activeSetX[i]));
+			}
+			m_activeSetHits++;
+			return true;
+		}
+	}
+	return false;
+}
+
 struct btJointNode
 {
 	int jointIndex;     // pointer to enclosing dxJoint object
@@ -152,12 +473,9 @@ struct btJointNode
 
 
 
-void btMLCPSolver::createMLCPFast(const btContactSolverInfo& infoGlobal)
+void btMLCPSolver::createMLCPVectors(const btContactSolverInfo& infoGlobal)
 {
-	int numContactRows = interleaveContactAndFriction ? 3 : 1;
-
 	int numConstraintRows = m_allConstraintPtrArray.size();
-	int n = numConstraintRows;
 	{
 		BT_PROFILE("init b (rhs)");
 		m_b.resize(numConstraintRows);
@@ -201,6 +519,38 @@ void btMLCPSolver::createMLCPFast(const btContactSolverInfo& infoGlobal)
 		}
 	}
 
+	{
+		BT_PROFILE("resize/init x");
+		m_x.resize(numConstraintRows);
+		m_xSplit.resize(numConstraintRows);
+
+		if (infoGlobal.m_solverMode&SOLVER_USE_WARMSTARTING)
+		{
+			for (int i=0;i<m_allConstraintPtrArray.size();i++)
+			{
+				const btSolverConstraint& c = *m_allConstraintPtrArray[i];
+				m_x[i]=c.m_appliedImpulse;
+				m_xSplit[i] = c.m_appliedPushImpulse;
+			}
+		} else
+		{
+			m_x.setZero();
+			m_xSplit.setZero();
+		}
+		if (m_warmStartActiveSet)
+			warmStartJointRows();
+	}
+}
+
+void btMLCPSolver::createMLCPFast(const btContactSolverInfo& infoGlobal)
+{
+	int numContactRows = interleaveContactAndFriction ? 3 : 1;
+
+	int numConstraintRows = m_allConstraintPtrArray.size();
+	int n = numConstraintRows;
+
+	createMLCPVectors(infoGlobal);
+
 	//
 	int m=m_allConstraintPtrArray.size();
 
@@ -446,26 +796,256 @@ void btMLCPSolver::createMLCPFast(const btContactSolverInfo& infoGlobal)
 		m_A.copyLowerToUpperTriangle();
 	}
 
+}
+
+enum btMLCPSparseAssemblyPhase
+{
+	BT_MLCP_JACOBIANS,		//J and J*invM rows, and the number of coupled blocks of each block row
+	BT_MLCP_BLOCK_COLUMNS,
+	BT_MLCP_BLOCK_VALUES
+};
+
+#define BT_MLCP_ASSEMBLY_GRAIN 64
+
+struct btMLCPSparseAssemblyLoop : public btIParallelForBody
+{
+	btMLCPSolver* m_solver;
+	int m_phase;
+
+	btMLCPSparseAssemblyLoop(btMLCPSolver* solver, int phase)
+		:m_solver(solver), m_phase(phase)
+	{
+	}
+	void forLoop(int iBegin, int iEnd) const
+	{
+		m_solver->assembleSparseRange(m_phase, iBegin, iEnd);
+	}
+	void run(int numBlocks) const
+	{
+		if (m_solver->m_multithreaded)
+		{
+			btParallelFor(0, numBlocks, BT_MLCP_ASSEMBLY_GRAIN, *this);
+		} else
+		{
+			forLoop(0, numBlocks);
+		}
+	}
+};
+
+//only bodies with a non-zero inverse mass couple the constraints acting on them
+static bool btIsCoupledSolverBody(const btSolverBody& body)
+{
+	return body.m_originalBody && body.m_originalBody->getInvMass()!=btScalar(0);
+}
+
+//rows use the same 8 wide layout as J3/JinvM3 in createMLCPFast
+static void btSetJacobianRow(btScalar* J, btScalar* JinvM, const btVector3& normal, const btVector3& relPosCrossNormal, const btRigidBody* body)
+{
+	btVector3 n(0,0,0), r(0,0,0), normalInvMass(0,0,0), relPosCrossNormalInvInertia(0,0,0);
+	if (body)
 	{
-		BT_PROFILE("resize/init x");
-		m_x.resize(numConstraintRows);
-		m_xSplit.resize(numConstraintRows);
+		n = normal;
+		r = relPosCrossNormal;
+		normalInvMass = normal * body->getInvMass();
+		relPosCrossNormalInvInertia = relPosCrossNormal * body->getInvInertiaTensorWorld();
+	}
+	for (int i=0;i<3;i++)
+	{
+		J[i] = n[i];
+		J[i+4] = r[i];
+		JinvM[i] = normalInvMass[i];
+		JinvM[i+4] = relPosCrossNormalInvInertia[i];
+	}
+	J[3] = J[7] = JinvM[3] = JinvM[7] = 0;
+}
 
-		if (infoGlobal.m_solverMode&SOLVER_USE_WARMSTARTING)
+static SIMD_FORCE_INLINE btScalar btJacobianRowDot(const btScalar* a, const btScalar* b)
+{
+	return a[0]*b[0]+a[1]*b[1]+a[2]*b[2]+a[4]*b[4]+a[5]*b[5]+a[6]*b[6];
+}
+
+int btMLCPSolver::gatherCoupledBlocks(int block, btAlignedObjectArray<int>& coupledBlocks) const
+{
+	coupledBlocks.resize(0);
+	const btSolverConstraint& c = *m_allConstraintPtrArray[m_blockOffsets[block]];
+	int cur[2] = {0,0};
+	int end[2] = {0,0};
+	if (btIsCoupledSolverBody(m_tmpSolverBodyPool[c.m_solverBodyIdA]))
+	{
+		cur[0] = m_bodyBlockStart[c.m_solverBodyIdA];
+		end[0] = m_bodyBlockStart[c.m_solverBodyIdA+1];
+	}
+	if (btIsCoupledSolverBody(m_tmpSolverBodyPool[c.m_solverBodyIdB]))
+	{
+		cur[1] = m_bodyBlockStart[c.m_solverBodyIdB];
+		end[1] = m_bodyBlockStart[c.m_solverBodyIdB+1];
+	}
+	//merge the sorted block lists of both bodies
+	while (cur[0]<end[0] || cur[1]<end[1])
+	{
+		int next;
+		if (cur[1]>=end[1] || (cur[0]<end[0] && m_bodyBlocks[cur[0]]<=m_bodyBlocks[cur[1]]))
+			next = m_bodyBlocks[cur[0]];
+		else
+			next = m_bodyBlocks[cur[1]];
+		if (cur[0]<end[0] && m_bodyBlocks[cur[0]]==next)
+			cur[0]++;
+		if (cur[1]<end[1] && m_bodyBlocks[cur[1]]==next)
+			cur[1]++;
+		coupledBlocks.push_back(next);
+	}
+	//a constraint between two static/kinematic bodies still needs its diagonal block for the cfm
+	if (!coupledBlocks.size())
+		coupledBlocks.push_back(block);
+	return coupledBlocks.size();
+}
+
+void btMLCPSolver::assembleSparseRange(int phase, int blockBegin, int blockEnd)
+{
+	btAlignedObjectArray<int> coupledBlocks;
+	for (int b=blockBegin;b<blockEnd;b++)
+	{
+		int row0 = m_blockOffsets[b];
+		int numRows = m_blockSizes[b];
+		switch (phase)
 		{
-			for (int i=0;i<m_allConstraintPtrArray.size();i++)
+		case BT_MLCP_JACOBIANS:
 			{
-				const btSolverConstraint& c = *m_allConstraintPtrArray[i];
-				m_x[i]=c.m_appliedImpulse;
-				m_xSplit[i] = c.m_appliedPushImpulse;
+				btScalar* J = m_J.getBufferPointerWritable() + 2*8*(size_t)row0;
+				btScalar* JinvM = m_JinvM.getBufferPointerWritable() + 2*8*(size_t)row0;
+				for (int row=0;row<numRows;row++)
+				{
+					const btSolverConstraint& c = *m_allConstraintPtrArray[row0+row];
+					btSetJacobianRow(J+8*row, JinvM+8*row, c.m_contactNormal1, c.m_relpos1CrossNormal, m_tmpSolverBodyPool[c.m_solverBodyIdA].m_originalBody);
+					btSetJacobianRow(J+8*(numRows+row), JinvM+8*(numRows+row), c.m_contactNormal2, c.m_relpos2CrossNormal, m_tmpSolverBodyPool[c.m_solverBodyIdB].m_originalBody);
+				}
+				m_blocksPerRow[b] = gatherCoupledBlocks(b, coupledBlocks);
+				break;
 			}
-		} else
+		case BT_MLCP_BLOCK_COLUMNS:
+			{
+				int numCoupled = gatherCoupledBlocks(b, coupledBlocks);
+				int* columns = m_sparseA.getBlockColumns(b);
+				for (int k=0;k<numCoupled;k++)
+					columns[k] = coupledBlocks[k];
+				break;
+			}
+		case BT_MLCP_BLOCK_VALUES:
+			{
+				const btSolverConstraint& c = *m_allConstraintPtrArray[row0];
+				int bodies[2] = {c.m_solverBodyIdA, c.m_solverBodyIdB};
+				bool coupled[2] = {btIsCoupledSolverBody(m_tmpSolverBodyPool[bodies[0]]), btIsCoupledSolverBody(m_tmpSolverBodyPool[bodies[1]])};
+				const btScalar* JinvMrow = m_JinvM.getBufferPointer() + 2*8*(size_t)row0;
+				for (int k=m_sparseA.m_blockRowPtr[b];k<m_sparseA.m_blockRowPtr[b+1];k++)
+				{
+					int other = m_sparseA.m_blockColumn[k];
+					int otherRow0 = m_blockOffsets[other];
+					int numRowsOther = m_blockSizes[other];
+					const btSolverConstraint& co = *m_allConstraintPtrArray[otherRow0];
+					btScalar* block = m_sparseA.getBlockValues(k);
+					for (int side=0;side<2;side++)
+					{
+						if (!coupled[side])
+							continue;
+						int otherSide;
+						if (co.m_solverBodyIdB==bodies[side])
+							otherSide = 1;
+						else if (co.m_solverBodyIdA==bodies[side])
+							otherSide = 0;
+						else
+							continue;
+						const btScalar* JinvMside = JinvMrow + 8*(size_t)(side*numRows);
+						const btScalar* Jother = m_J.getBufferPointer() + 2*8*(size_t)otherRow0 + 8*(size_t)(otherSide*numRowsOther);
+						for (int r=0;r<numRows;r++)
+							for (int j=0;j<numRowsOther;j++)
+								block[r*numRowsOther+j] += btJacobianRowDot(JinvMside+8*r, Jother+8*j);
+					}
+					if (other==b)
+					{
+						for (int r=0;r<numRows;r++)
+							block[r*numRows+r] += m_sparseCfm;
+					}
+				}
+				break;
+			}
+		default:
+			btAssert(0);
+		}
+	}
+}
+
+///createMLCPSparse builds the same matrix as createMLCPFast, but only stores the blocks of constraints that share a body,
+///each block row is computed independently so the assembly runs through btParallelFor when multithreaded
+void btMLCPSolver::createMLCPSparse(const btContactSolverInfo& infoGlobal)
+{
+	int numContactRows = interleaveContactAndFriction ? 3 : 1;
+	int m = m_allConstraintPtrArray.size();
+	int numBodies = m_tmpSolverBodyPool.size();
+
+	createMLCPVectors(infoGlobal);
+
+	{
+		BT_PROFILE("constraint blocks");
+		m_blockOffsets.resize(0);
+		m_blockSizes.resize(0);
+		int numRows = 0;
+		int c = 0;
+		for (int i=0;i<m;i+=numRows,c++)
 		{
-			m_x.setZero();
-			m_xSplit.setZero();
+			numRows = i<m_tmpSolverNonContactConstraintPool.size() ? m_tmpConstraintSizesPool[c].m_numConstraintRows : numContactRows;
+			m_blockOffsets.push_back(i);
+			m_blockSizes.push_back(numRows);
 		}
 	}
+	int numBlocks = m_blockSizes.size();
 
+	{
+		BT_PROFILE("body blocks");
+		m_bodyBlockStart.resize(0);
+		m_bodyBlockStart.resize(numBodies+1,0);
+		for (int b=0;b<numBlocks;b++)
+		{
+			const btSolverConstraint& c = *m_allConstraintPtrArray[m_blockOffsets[b]];
+			if (btIsCoupledSolverBody(m_tmpSolverBodyPool[c.m_solverBodyIdA]))
+				m_bodyBlockStart[c.m_solverBodyIdA+1]++;
+			if (btIsCoupledSolverBody(m_tmpSolverBodyPool[c.m_solverBodyIdB]))
+				m_bodyBlockStart[c.m_solverBodyIdB+1]++;
+		}
+		for (int i=0;i<numBodies;i++)
+			m_bodyBlockStart[i+1] += m_bodyBlockStart[i];
+
+		//blocks are appended in ascending order, so the list of each body is sorted
+		btAlignedObjectArray<int> cursor;
+		cursor.resizeNoInitialize(numBodies);
+		for (int i=0;i<numBodies;i++)
+			cursor[i] = m_bodyBlockStart[i];
+		m_bodyBlocks.resizeNoInitialize(m_bodyBlockStart[numBodies]);
+		for (int b=0;b<numBlocks;b++)
+		{
+			const btSolverConstraint& c = *m_allConstraintPtrArray[m_blockOffsets[b]];
+			if (btIsCoupledSolverBody(m_tmpSolverBodyPool[c.m_solverBodyIdA]))
+				m_bodyBlocks[cursor[c.m_solverBodyIdA]++] = b;
+			if (btIsCoupledSolverBody(m_tmpSolverBodyPool[c.m_solverBodyIdB]))
+				m_bodyBlocks[cursor[c.m_solverBodyIdB]++] = b;
+		}
+	}
+
+	m_sparseCfm = m_cfm / infoGlobal.m_timeStep;
+	m_J.resize(2*m,8);
+	m_JinvM.resize(2*m,8);
+	m_blocksPerRow.resizeNoInitialize(numBlocks);
+	{
+		BT_PROFILE("Compute J and JinvM");
+		btMLCPSparseAssemblyLoop(this, BT_MLCP_JACOBIANS).run(numBlocks);
+	}
+	{
+		BT_PROFILE("Compute sparse A");
+		m_sparseA.beginAssembly(m_blockSizes, m_blocksPerRow);
+		btMLCPSparseAssemblyLoop(this, BT_MLCP_BLOCK_COLUMNS).run(numBlocks);
+		m_sparseA.allocateValues();
+		btMLCPSparseAssemblyLoop(this, BT_MLCP_BLOCK_VALUES).run(numBlocks);
+	}
+	m_A.resize(0,0);
 }
 
 void btMLCPSolver::createMLCP(const btContactSolverInfo& infoGlobal)
@@ -634,6 +1214,9 @@ btScalar btMLCPSolver::solveGroupCacheFriendlyIterations(btCollisionObject** bod
 		btSequentialImpulseConstraintSolver::solveGroupCacheFriendlyIterations(bodies ,numBodies,manifoldPtr, numManifolds,constraints,numConstraints,infoGlobal,debugDrawer);
 	}
 
+	if (m_warmStartActiveSet)
+		cacheJointRows();
+
 	return 0.f;
 }
 
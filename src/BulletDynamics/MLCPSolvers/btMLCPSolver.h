@@ -20,6 +20,15 @@ subject to the following restrictions:
 #include "BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolver.h"
 #include "LinearMath/btMatrixX.h"
 #include "BulletDynamics/MLCPSolvers/btMLCPSolverInterface.h"
+#include "LinearMath/btHashMap.h"
+
+///first row and number of rows of a btTypedConstraint in the joint impulse cache of btMLCPSolver
+struct btMLCPCachedJoint
+{
+	const void* m_constraint;
+	int m_firstRow;
+	int m_numRows;
+};
 
 class btMLCPSolver : public btSequentialImpulseConstraintSolver
 {
@@ -27,6 +36,11 @@ class btMLCPSolver : public btSequentialImpulseConstraintSolver
 protected:
 	
 	btMatrixXu m_A;
+	///used instead of m_A when the MLCP solver supportsSparseMatrix, that is btSolveProjectedGaussSeidel,
+	///the pivoting solvers get the dense m_A of createMLCPFast
+	btSparseMatrixXu m_sparseA;
+	bool m_useSparseMatrix;
+	bool m_multithreaded;
 	btVectorXu m_b;
 	btVectorXu m_x;
 	btVectorXu m_lo;
@@ -44,12 +58,57 @@ protected:
 	int m_fallback;
 	btScalar m_cfm;
 
+	///sparse assembly data: rows of each constraint block, J and J*invM of both bodies (like J3/JinvM3 in createMLCPFast)
+	///and the blocks of each solver body that has a non-zero inverse mass
+	btAlignedObjectArray<int> m_blockOffsets;
+	btAlignedObjectArray<int> m_blockSizes;
+	btAlignedObjectArray<int> m_blocksPerRow;
+	btAlignedObjectArray<int> m_bodyBlockStart;
+	btAlignedObjectArray<int> m_bodyBlocks;
+	btMatrixXu m_J;
+	btMatrixXu m_JinvM;
+	btScalar m_sparseCfm;
+
+	friend struct btMLCPSparseAssemblyLoop;
+
+	///warm starting: impulses of the joint rows of the previous step, keyed by btTypedConstraint,
+	///and the scratch memory of the active set solve. The islands of a step cache their rows in m_nextJointCache,
+	///prepareSolve turns it into m_jointCache for the next step
+	bool m_warmStartActiveSet;
+	int m_activeSetHits;
+	int m_activeSetIterations;
+	int m_activeSetMisses;
+	int m_activeSetSkip;
+	btScalar m_activeSetTolerance;
+	btHashMap<btHashPtr,btMLCPCachedJoint> m_jointCache;
+	btAlignedObjectArray<btScalar> m_jointCacheImpulses;
+	btAlignedObjectArray<btScalar> m_jointCachePushImpulses;
+	btHashMap<btHashPtr,btMLCPCachedJoint> m_nextJointCache;
+	btAlignedObjectArray<btScalar> m_nextJointCacheImpulses;
+	btAlignedObjectArray<btScalar> m_nextJointCachePushImpulses;
+	btAlignedObjectArray<int> m_activeSetState;
+	btAlignedObjectArray<int> m_activeSetRows;
+	btAlignedObjectArray<int> m_activeSetFirst;
+	btAlignedObjectArray<btScalar> m_activeSetL;
+	btAlignedObjectArray<btScalar> m_activeSetRhs;
+	btVectorXu m_activeSetX;
+
 	virtual btScalar solveGroupCacheFriendlySetup(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds,btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal,btIDebugDraw* debugDrawer);
 	virtual btScalar solveGroupCacheFriendlyIterations(btCollisionObject** bodies ,int numBodies,btPersistentManifold** manifoldPtr, int numManifolds,btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal,btIDebugDraw* debugDrawer);
 
 
 	virtual void createMLCP(const btContactSolverInfo& infoGlobal);
 	virtual void createMLCPFast(const btContactSolverInfo& infoGlobal);
+	virtual void createMLCPSparse(const btContactSolverInfo& infoGlobal);
+
+	void createMLCPVectors(const btContactSolverInfo& infoGlobal);
+	int gatherCoupledBlocks(int block, btAlignedObjectArray<int>& coupledBlocks) const;
+	void assembleSparseRange(int phase, int blockBegin, int blockEnd);
+
+	void warmStartJointRows();
+	void cacheJointRows();
+	void activeSetLimits(int row, const btVectorXu& x, btScalar& lo, btScalar& hi) const;
+	bool solveActiveSet(const btVectorXu& b, btVectorXu& x, const btVectorXu& guess);
 
 	//return true is it solves the problem successfully
 	virtual bool solveMLCP(const btContactSolverInfo& infoGlobal);
@@ -59,6 +118,8 @@ public:
 	btMLCPSolver(	 btMLCPSolverInterface* solver);
 	virtual ~btMLCPSolver();
 
+	virtual void prepareSolve(int numBodies, int numManifolds);
+
 	void setMLCPSolver(btMLCPSolverInterface* solver)
 	{
 		m_solver = solver;
@@ -73,6 +134,50 @@ public:
 		m_fallback = num;
 	}
 
+	///with multithreading enabled the sparse MLCP matrix is assembled through btParallelFor
+	void setMultithreaded(bool multithreaded)
+	{
+		m_multithreaded = multithreaded;
+	}
+	bool isMultithreaded() const
+	{
+		return m_multithreaded;
+	}
+
+	///with the active set warm start, the joint rows start from the impulses of the previous step (contact rows already do through
+	///their manifold points), and before calling a dense MLCP solver (Dantzig, Lemke, ..) the active set implied by the warm started
+	///solution is tried: the free rows are solved directly, and the result is kept when it satisfies the complementarity conditions.
+	///After a miss the next steps go straight to the MLCP solver (1, 3, 7 and at most 15 steps).
+	///The active set solve needs the dense matrix: with a solver that supportsSparseMatrix (btSolveProjectedGaussSeidel) only the
+	///joint rows are warm started, and the iterative solver starts from them. getNumActiveSetHits stays 0 then.
+	void setWarmStartActiveSet(bool warmStart)
+	{
+		m_warmStartActiveSet = warmStart;
+	}
+	bool getWarmStartActiveSet() const
+	{
+		return m_warmStartActiveSet;
+	}
+	///number of (M)LCPs solved by the active set guess, without calling the MLCP solver
+	int getNumActiveSetHits() const
+	{
+		return m_activeSetHits;
+	}
+	void setNumActiveSetHits(int num)
+	{
+		m_activeSetHits = num;
+	}
+	///number of direct solves per (M)LCP: the first one uses the guessed active set, the next ones switch the violating rows
+	void setActiveSetIterations(int iterations)
+	{
+		m_activeSetIterations = iterations;
+	}
+	///relative tolerance on the bounds and complementarity conditions of the active set solution
+	void setActiveSetTolerance(btScalar tolerance)
+	{
+		m_activeSetTolerance = tolerance;
+	}
+
 	btScalar	getCfm() const
 	{
 		return m_cfm;
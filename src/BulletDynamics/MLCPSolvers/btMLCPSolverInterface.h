@@ -28,6 +28,21 @@ public:
 
 	//return true is it solves the problem successfully
 	virtual bool solveMLCP(const btMatrixXu & A, const btVectorXu & b, btVectorXu& x, const btVectorXu & lo,const btVectorXu & hi,const btAlignedObjectArray<int>& limitDependency, int numIterations, bool useSparsity = true)=0;
+
+	///solvers that work directly on a btSparseMatrixXu return true, btMLCPSolver then never builds the dense matrix.
+	///Of the solvers in this directory only btSolveProjectedGaussSeidel does, Dantzig, Lemke and PATH pivot on the dense matrix
+	virtual bool supportsSparseMatrix() const
+	{
+		return false;
+	}
+
+	///the default implementation expands A and calls solveMLCP
+	virtual bool solveSparseMLCP(const btSparseMatrixXu & A, const btVectorXu & b, btVectorXu& x, const btVectorXu & lo,const btVectorXu & hi,const btAlignedObjectArray<int>& limitDependency, int numIterations)
+	{
+		btMatrixXu dense;
+		A.toDense(dense);
+		return solveMLCP(dense, b, x, lo, hi, limitDependency, numIterations);
+	}
 };
 
 #endif //BT_MLCP_SOLVER_INTERFACE_H
@@ -21,6 +21,7 @@ subject to the following restrictions:
 #include "btMLCPSolverInterface.h"
 
 ///This solver is mainly for debug/learning purposes: it is functionally equivalent to the btSequentialImpulseConstraintSolver solver, but much slower (it builds the full LCP matrix)
+///With solveSparseMLCP it only builds and visits the non-zero blocks of the LCP matrix, see btSparseMatrixX
 class btSolveProjectedGaussSeidel : public btMLCPSolverInterface
 {
 public:
@@ -81,6 +82,44 @@ public:
 		return true;
 	}
 
+	virtual bool supportsSparseMatrix() const
+	{
+		return true;
+	}
+
+	///same iterations as solveMLCP, each row only visits the blocks it is coupled with
+	virtual bool solveSparseMLCP(const btSparseMatrixXu & A, const btVectorXu & b, btVectorXu& x, const btVectorXu & lo,const btVectorXu & hi,const btAlignedObjectArray<int>& limitDependency, int numIterations)
+	{
+		int numRows = A.rows();
+		if (!numRows)
+			return true;
+		btAssert(numRows == b.rows());
+
+		for (int k = 0; k <numIterations; k++)
+		{
+			for (int i = 0; i <numRows; i++)
+			{
+				btScalar delta = A.rowDot(i,&x[0],true);
+				btScalar aDiag = A.getDiagonal(i);
+				x [i] = (b [i] - delta) / aDiag;
+				btScalar s = 1.f;
+
+				if (limitDependency[i]>=0)
+				{
+					s = x[limitDependency[i]];
+					if (s<0)
+						s=1;
+				}
+			
+				if (x[i]<lo[i]*s)
+					x[i]=lo[i]*s;
+				if (x[i]>hi[i]*s)
+					x[i]=hi[i]*s;
+			}
+		}
+		return true;
+	}
+
 };
 
 #endif //BT_SOLVE_PROJECTED_GAUSS_SEIDEL_H
@@ -164,28 +164,40 @@ void	btRaycastVehicle::updateWheelTransformsWS(btWheelInfo& wheel , bool interpo
 	wheel.m_raycastInfo.m_wheelAxleWS = chassisTrans.getBasis() * wheel.m_wheelAxleCS;
 }
 
-btScalar btRaycastVehicle::rayCast(btWheelInfo& wheel)
+void	btRaycastVehicle::prepareRayCast(btWheelInfo& wheel, btVector3& rayFrom, btVector3& rayTo)
 {
 	updateWheelTransformsWS( wheel,false);
 
-	
-	btScalar depth = -1;
-	
 	btScalar raylen = wheel.getSuspensionRestLength()+wheel.m_wheelsRadius;
 
 	btVector3 rayvector = wheel.m_raycastInfo.m_wheelDirectionWS * (raylen);
-	const btVector3& source = wheel.m_raycastInfo.m_hardPointWS;
-	wheel.m_raycastInfo.m_contactPointWS = source + rayvector;
-	const btVector3& target = wheel.m_raycastInfo.m_contactPointWS;
+	rayFrom = wheel.m_raycastInfo.m_hardPointWS;
+	wheel.m_raycastInfo.m_contactPointWS = rayFrom + rayvector;
+	rayTo = wheel.m_raycastInfo.m_contactPointWS;
+}
+
+btScalar btRaycastVehicle::rayCast(btWheelInfo& wheel)
+{
+	btVector3 source, target;
+	prepareRayCast(wheel,source,target);
 
-	btScalar param = btScalar(0.);
-	
 	btVehicleRaycaster::btVehicleRaycasterResult	rayResults;
 
 	btAssert(m_vehicleRaycaster);
 
 	void* object = m_vehicleRaycaster->castRay(source,target,rayResults);
 
+	return processRayCastResult(wheel,object,rayResults);
+}
+
+btScalar	btRaycastVehicle::processRayCastResult(btWheelInfo& wheel, void* object, const btVehicleRaycaster::btVehicleRaycasterResult& rayResults)
+{
+	btScalar depth = -1;
+	
+	btScalar raylen = wheel.getSuspensionRestLength()+wheel.m_wheelsRadius;
+
+	btScalar param = btScalar(0.);
+
 	wheel.m_raycastInfo.m_groundObject = 0;
 
 	if (object)
@@ -266,6 +278,25 @@ const btTransform& btRaycastVehicle::getChassisWorldTransform() const
 
 
 void btRaycastVehicle::updateVehicle( btScalar step )
+{
+	beginVehicleUpdate();
+
+	//
+	// simulate suspension
+	//
+	
+	int i=0;
+	for (i=0;i<m_wheelInfo.size();i++)
+	{
+		//btScalar depth; 
+		//depth = 
+		rayCast( m_wheelInfo[i]);
+	}
+
+	endVehicleUpdate(step);
+}
+
+void	btRaycastVehicle::beginVehicleUpdate()
 {
 	{
 		for (int i=0;i<getNumWheels();i++)
@@ -288,18 +319,11 @@ void btRaycastVehicle::updateVehicle( btScalar step )
 	{
 		m_currentVehicleSpeedKmHour *= btScalar(-1.);
 	}
+}
 
-	//
-	// simulate suspension
-	//
-	
+void	btRaycastVehicle::endVehicleUpdate(btScalar step)
+{
 	int i=0;
-	for (i=0;i<m_wheelInfo.size();i++)
-	{
-		//btScalar depth; 
-		//depth = 
-		rayCast( m_wheelInfo[i]);
-	}
 
 	updateSuspension(step);
 
@@ -770,3 +794,36 @@ void* btDefaultVehicleRaycaster::castRay(const btVector3& from,const btVector3&
 	return 0;
 }
 
+void btDefaultVehicleRaycaster::castRays(int numRays, const btVector3* from, const btVector3* to, btVehicleRaycasterResult* results, void** hitObjects)
+{
+	m_rayQueries.resize(numRays);
+	m_rayQueryResults.resize(numRays);
+	for (int i=0;i<numRays;i++)
+	{
+		m_rayQueries[i].m_rayFromWorld = from[i];
+		m_rayQueries[i].m_rayToWorld = to[i];
+	}
+	if (numRays)
+	{
+		m_dynamicsWorld->rayTestBatch(&m_rayQueries[0],numRays,&m_rayQueryResults[0],
+			m_multithreaded ? btCollisionWorld::BQF_MULTITHREADED : btCollisionWorld::BQF_NONE);
+	}
+
+	for (int i=0;i<numRays;i++)
+	{
+		const btCollisionWorld::ClosestRayQueryResult& rayResult = m_rayQueryResults[i];
+		hitObjects[i] = 0;
+		if (rayResult.m_collisionObject)
+		{
+			const btRigidBody* body = btRigidBody::upcast(rayResult.m_collisionObject);
+			if (body && body->hasContactResponse())
+			{
+				results[i].m_hitPointInWorld = rayResult.m_hitPointWorld;
+				results[i].m_hitNormalInWorld = rayResult.m_hitNormalWorld;
+				results[i].m_hitNormalInWorld.normalize();
+				results[i].m_distFraction = rayResult.m_closestHitFraction;
+				hitObjects[i] = (void*)body;
+			}
+		}
+	}
+}
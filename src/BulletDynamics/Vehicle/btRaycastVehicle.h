@@ -12,6 +12,7 @@
 #define BT_RAYCASTVEHICLE_H
 
 #include "BulletDynamics/Dynamics/btRigidBody.h"
+#include "BulletCollision/CollisionDispatch/btCollisionWorld.h"
 #include "BulletDynamics/ConstraintSolver/btTypedConstraint.h"
 #include "btVehicleRaycaster.h"
 class btDynamicsWorld;
@@ -94,7 +95,19 @@ public:
 	
 	btScalar rayCast(btWheelInfo& wheel);
 
+	///prepareRayCast updates the wheel in world space and returns its suspension ray, see processRayCastResult
+	void	prepareRayCast(btWheelInfo& wheel, btVector3& rayFrom, btVector3& rayTo);
+
+	///processRayCastResult updates the suspension of the wheel from the result of its ray, object is 0 if the ray missed
+	btScalar	processRayCastResult(btWheelInfo& wheel, void* object, const btVehicleRaycaster::btVehicleRaycasterResult& rayResults);
+
 	virtual void updateVehicle(btScalar step);
+
+	///updateVehicle is split in beginVehicleUpdate, a rayCast of every wheel, and endVehicleUpdate,
+	///so a btRaycastVehicleManager can batch the wheel rays of many vehicles
+	void	beginVehicleUpdate();
+
+	void	endVehicleUpdate(btScalar step);
 	
 	
 	void resetSuspension();
@@ -219,14 +232,27 @@ public:
 class btDefaultVehicleRaycaster : public btVehicleRaycaster
 {
 	btDynamicsWorld*	m_dynamicsWorld;
+	bool	m_multithreaded;
+	btAlignedObjectArray<btCollisionWorld::RayQuery>	m_rayQueries;
+	btAlignedObjectArray<btCollisionWorld::ClosestRayQueryResult>	m_rayQueryResults;
 public:
 	btDefaultVehicleRaycaster(btDynamicsWorld* world)
-		:m_dynamicsWorld(world)
+		:m_dynamicsWorld(world),
+		m_multithreaded(false)
 	{
 	}
 
 	virtual void* castRay(const btVector3& from,const btVector3& to, btVehicleRaycasterResult& result);
 
+	///castRays runs all rays through btCollisionWorld::rayTestBatch
+	virtual void castRays(int numRays, const btVector3* from, const btVector3* to, btVehicleRaycasterResult* results, void** hitObjects);
+
+	///with multithreading enabled castRays distributes the rays over btParallelFor
+	void	setMultithreaded(bool multithreaded)
+	{
+		m_multithreaded = multithreaded;
+	}
+
 };
 
 
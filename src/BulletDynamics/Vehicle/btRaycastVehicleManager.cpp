@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2005 Erwin Coumans http://continuousphysics.com/Bullet/
+ *
+ * Permission to use, copy, modify, distribute and sell this software
+ * and its documentation for any purpose is hereby granted without fee,
+ * provided that the above copyright notice appear in all copies.
+ * Erwin Coumans makes no representations about the suitability 
+ * of this software for any purpose.  
+ * It is provided "as is" without express or implied warranty.
+*/
+#include "btRaycastVehicleManager.h"
+#include "LinearMath/btQuickprof.h"
+
+btRaycastVehicleManager::btRaycastVehicleManager(btVehicleRaycaster* raycaster)
+:m_raycaster(raycaster)
+{
+}
+
+btRaycastVehicleManager::~btRaycastVehicleManager()
+{
+}
+
+void	btRaycastVehicleManager::addVehicle(btRaycastVehicle* vehicle)
+{
+	m_vehicles.push_back(vehicle);
+}
+
+void	btRaycastVehicleManager::removeVehicle(btRaycastVehicle* vehicle)
+{
+	m_vehicles.remove(vehicle);
+}
+
+void	btRaycastVehicleManager::updateAction(btCollisionWorld* collisionWorld, btScalar step)
+{
+	BT_PROFILE("btRaycastVehicleManager::updateAction");
+	(void)collisionWorld;
+
+	int numRays = 0;
+	for (int v=0;v<m_vehicles.size();v++)
+	{
+		numRays += m_vehicles[v]->getNumWheels();
+	}
+	m_rayFrom.resize(numRays);
+	m_rayTo.resize(numRays);
+	m_rayResults.resize(numRays);
+	m_hitObjects.resize(numRays);
+
+	int ray = 0;
+	for (int v=0;v<m_vehicles.size();v++)
+	{
+		btRaycastVehicle* vehicle = m_vehicles[v];
+		vehicle->beginVehicleUpdate();
+		for (int w=0;w<vehicle->getNumWheels();w++)
+		{
+			vehicle->prepareRayCast(vehicle->getWheelInfo(w),m_rayFrom[ray],m_rayTo[ray]);
+			m_rayResults[ray] = btVehicleRaycaster::btVehicleRaycasterResult();
+			ray++;
+		}
+	}
+
+	if (numRays)
+	{
+		m_raycaster->castRays(numRays,&m_rayFrom[0],&m_rayTo[0],&m_rayResults[0],&m_hitObjects[0]);
+	}
+
+	ray = 0;
+	for (int v=0;v<m_vehicles.size();v++)
+	{
+		btRaycastVehicle* vehicle = m_vehicles[v];
+		for (int w=0;w<vehicle->getNumWheels();w++)
+		{
+			vehicle->processRayCastResult(vehicle->getWheelInfo(w),m_hitObjects[ray],m_rayResults[ray]);
+			ray++;
+		}
+		vehicle->endVehicleUpdate(step);
+	}
+}
+
+void	btRaycastVehicleManager::debugDraw(btIDebugDraw* debugDrawer)
+{
+	for (int v=0;v<m_vehicles.size();v++)
+	{
+		m_vehicles[v]->debugDraw(debugDrawer);
+	}
+}
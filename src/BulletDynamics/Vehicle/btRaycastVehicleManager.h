@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2005 Erwin Coumans http://continuousphysics.com/Bullet/
+ *
+ * Permission to use, copy, modify, distribute and sell this software
+ * and its documentation for any purpose is hereby granted without fee,
+ * provided that the above copyright notice appear in all copies.
+ * Erwin Coumans makes no representations about the suitability 
+ * of this software for any purpose.  
+ * It is provided "as is" without express or implied warranty.
+*/
+#ifndef BT_RAYCASTVEHICLE_MANAGER_H
+#define BT_RAYCASTVEHICLE_MANAGER_H
+
+#include "btRaycastVehicle.h"
+
+///btRaycastVehicleManager updates a fleet of btRaycastVehicle with a single batch of wheel rays per step.
+///It gathers the suspension rays of all wheels, casts them with btVehicleRaycaster::castRays
+///(btDefaultVehicleRaycaster uses btCollisionWorld::rayTestBatch), then updates suspension and friction of every vehicle.
+///Add the manager as action to the world, instead of the vehicles themselves.
+///Vehicles that override updateVehicle are updated through the split begin/endVehicleUpdate, and bypass the override.
+class btRaycastVehicleManager : public btActionInterface
+{
+	btVehicleRaycaster*	m_raycaster;
+	btAlignedObjectArray<btRaycastVehicle*>	m_vehicles;
+
+	btAlignedObjectArray<btVector3>	m_rayFrom;
+	btAlignedObjectArray<btVector3>	m_rayTo;
+	btAlignedObjectArray<btVehicleRaycaster::btVehicleRaycasterResult>	m_rayResults;
+	btAlignedObjectArray<void*>	m_hitObjects;
+
+public:
+
+	btRaycastVehicleManager(btVehicleRaycaster* raycaster);
+
+	virtual ~btRaycastVehicleManager();
+
+	void	addVehicle(btRaycastVehicle* vehicle);
+
+	void	removeVehicle(btRaycastVehicle* vehicle);
+
+	int	getNumVehicles() const
+	{
+		return m_vehicles.size();
+	}
+
+	btRaycastVehicle*	getVehicle(int index)
+	{
+		return m_vehicles[index];
+	}
+
+	///btActionInterface interface
+	virtual void	updateAction(btCollisionWorld* collisionWorld, btScalar step);
+
+	///btActionInterface interface
+	virtual void	debugDraw(btIDebugDraw* debugDrawer);
+};
+
+#endif //BT_RAYCASTVEHICLE_MANAGER_H
@@ -29,6 +29,16 @@ virtual ~btVehicleRaycaster()
 
 	virtual void* castRay(const btVector3& from,const btVector3& to, btVehicleRaycasterResult& result) = 0;
 
+	///castRays casts numRays rays at once, hitObjects receives what castRay would return for each ray.
+	///The default implementation calls castRay for every ray, raycasters can override it to batch the queries.
+	virtual void castRays(int numRays, const btVector3* from, const btVector3* to, btVehicleRaycasterResult* results, void** hitObjects)
+	{
+		for (int i=0;i<numRays;i++)
+		{
+			hitObjects[i] = castRay(from[i],to[i],results[i]);
+		}
+	}
+
 };
 
 #endif //BT_VEHICLE_RAYCASTER_H
@@ -61,6 +61,24 @@ int MultiBodyTree::getBodyLinearAcceleration(const int body_index, vec3 *world_a
 	return m_impl->getBodyLinearAcceleration(body_index, world_acceleration);
 }
 
+int MultiBodyTree::getBodyJacobianRot(const int body_index, matxx *world_jac_rot) const {
+	return m_impl->getBodyJacobianRot(body_index, world_jac_rot);
+}
+
+int MultiBodyTree::getBodyJacobianTrans(const int body_index, matxx *world_jac_trans) const {
+	return m_impl->getBodyJacobianTrans(body_index, world_jac_trans);
+}
+
+int MultiBodyTree::getBodyDotJacobianRotU(const int body_index,
+										  vec3 *world_dot_jac_rot_u) const {
+	return m_impl->getBodyDotJacobianRotU(body_index, world_dot_jac_rot_u);
+}
+
+int MultiBodyTree::getBodyDotJacobianTransU(const int body_index,
+											vec3 *world_dot_jac_trans_u) const {
+	return m_impl->getBodyDotJacobianTransU(body_index, world_dot_jac_trans_u);
+}
+
 void MultiBodyTree::printTree() { m_impl->printTree(); }
 void MultiBodyTree::printTreeData() { m_impl->printTreeData(); }
 
@@ -81,6 +99,22 @@ int MultiBodyTree::calculateInverseDynamics(const vecx &q, const vecx &u, const
 	return 0;
 }
 
+int MultiBodyTree::calculateInverseDynamicsDerivatives(const vecx &q, const vecx &u,
+													   const vecx &dot_u, vecx *joint_forces,
+													   matxx *d_joint_forces_d_q,
+													   matxx *d_joint_forces_d_u) {
+	if (false == m_is_finalized) {
+		error_message("system has not been initialized\n");
+		return -1;
+	}
+	if (-1 == m_impl->calculateInverseDynamicsDerivatives(q, u, dot_u, joint_forces,
+														  d_joint_forces_d_q, d_joint_forces_d_u)) {
+		error_message("error in inverse dynamics derivative calculation\n");
+		return -1;
+	}
+	return 0;
+}
+
 int MultiBodyTree::calculateMassMatrix(const vecx &q, const bool update_kinematics,
 									   const bool initialize_matrix,
 									   const bool set_lower_triangular_matrix, matxx *mass_matrix) {
@@ -99,6 +133,71 @@ int MultiBodyTree::calculateMassMatrix(const vecx &q, const bool update_kinemati
 int MultiBodyTree::calculateMassMatrix(const vecx &q, matxx *mass_matrix) {
 	return calculateMassMatrix(q, true, true, true, mass_matrix);
 }
+
+int MultiBodyTree::calculateForwardDynamics(const vecx &q, const vecx &u,
+											const vecx &joint_forces, vecx *dot_u) {
+	if (false == m_is_finalized) {
+		error_message("system has not been initialized\n");
+		return -1;
+	}
+	if (-1 == m_impl->calculateForwardDynamics(q, u, joint_forces, dot_u)) {
+		error_message("error in forward dynamics calculation\n");
+		return -1;
+	}
+	return 0;
+}
+
+int MultiBodyTree::calculateJacobians(const vecx &q, const vecx &u) {
+	if (false == m_is_finalized) {
+		error_message("system has not been initialized\n");
+		return -1;
+	}
+	if (-1 == m_impl->calculateJacobians(q, u, MultiBodyImpl::POSITION_VELOCITY)) {
+		error_message("error in jacobian calculation\n");
+		return -1;
+	}
+	return 0;
+}
+
+int MultiBodyTree::calculateJacobians(const vecx &q) {
+	if (false == m_is_finalized) {
+		error_message("system has not been initialized\n");
+		return -1;
+	}
+	if (-1 == m_impl->calculateJacobians(q, q, MultiBodyImpl::POSITION_ONLY)) {
+		error_message("error in jacobian calculation\n");
+		return -1;
+	}
+	return 0;
+}
+
+int MultiBodyTree::calculateInverseDynamicsBatch(const matxx &q, const matxx &u,
+												 const matxx &dot_u, matxx *joint_forces,
+												 const bool use_float) {
+	if (false == m_is_finalized) {
+		error_message("system has not been initialized\n");
+		return -1;
+	}
+	if (-1 == m_impl->calculateInverseDynamicsBatch(q, u, dot_u, joint_forces, use_float)) {
+		error_message("error in batch inverse dynamics calculation\n");
+		return -1;
+	}
+	return 0;
+}
+
+int MultiBodyTree::calculateMassMatrixBatch(const matxx &q, matxx *mass_matrices,
+											const bool use_float) {
+	if (false == m_is_finalized) {
+		error_message("system has not been initialized\n");
+		return -1;
+	}
+	if (-1 == m_impl->calculateMassMatrixBatch(q, mass_matrices, use_float)) {
+		error_message("error in batch mass matrix calculation\n");
+		return -1;
+	}
+	return 0;
+}
+
 int MultiBodyTree::addBody(int body_index, int parent_index, JointType joint_type,
 						   const vec3 &parent_r_parent_body_ref, const mat33 &body_T_parent_ref,
 						   const vec3 &body_axis_of_motion_, idScalar mass,
@@ -126,6 +126,23 @@ public:
 	/// @return 0 on success, -1 on error
 	int calculateInverseDynamics(const vecx& q, const vecx& u, const vecx& dot_u,
 								 vecx* joint_forces);
+	/// Calculate joint forces and their partial derivatives with respect to q and u.
+	/// The derivative with respect to dot_u is the mass matrix (see calculateMassMatrix).
+	/// The cost is one inverse dynamics evaluation plus one sweep over the subtree and the
+	/// ancestors of each body for every degree of freedom, ie, O(dim(u)^2) in the worst case.
+	/// This also updates the kinematic state, like calculateInverseDynamics.
+	/// @param q generalized coordinates
+	/// @param u generalized velocities
+	/// @param dot_u time derivative of u
+	/// @param joint_forces resulting joint forces, dim(joint_forces) = dim(u)
+	/// @param d_joint_forces_d_q element (i,j) is the partial derivative of joint_forces(i)
+	///		with respect to q(j), dim(d_joint_forces_d_q) = dim(u) x dim(q)
+	/// @param d_joint_forces_d_u element (i,j) is the partial derivative of joint_forces(i)
+	///		with respect to u(j), dim(d_joint_forces_d_u) = dim(u) x dim(u)
+	/// @return 0 on success, -1 on error
+	int calculateInverseDynamicsDerivatives(const vecx& q, const vecx& u, const vecx& dot_u,
+											vecx* joint_forces, matxx* d_joint_forces_d_q,
+											matxx* d_joint_forces_d_u);
 	/// Calculate joint space mass matrix
 	/// @param q generalized coordinates
 	/// @param initialize_matrix if true, initialize mass matrix with zero.
@@ -148,6 +165,63 @@ public:
 	/// @return -1 on error, 0 on success
 	int calculateMassMatrix(const vecx& q, matxx* mass_matrix);
 
+	/// Calculate generalized accelerations for given generalized state and joint forces
+	/// (forward dynamics), using the O(n) articulated body algorithm.
+	/// This is the inverse of calculateInverseDynamics: user forces and gravity are
+	/// included in the same way, and the kinematic state (including accelerations)
+	/// is updated, so the body accelerations can be read with the getters afterwards.
+	/// Bodies with zero mass and inertia must not be leaves of the tree.
+	/// @param q generalized coordinates
+	/// @param u generalized velocities
+	/// @param joint_forces generalized forces, dim(joint_forces) = dim(u)
+	/// @param dot_u this is where the resulting generalized accelerations will be stored.
+	///		dim(dot_u) = dim(u)
+	/// @return 0 on success, -1 on error
+	int calculateForwardDynamics(const vecx& q, const vecx& u, const vecx& joint_forces,
+								 vecx* dot_u);
+
+	/// Calculate the Jacobians of the angular velocity and the linear velocity of the origin
+	/// of all body-fixed frames with respect to u, and the time derivatives of the Jacobians
+	/// times u. The results can be read with getBodyJacobianRot, getBodyJacobianTrans,
+	/// getBodyDotJacobianRotU and getBodyDotJacobianTransU.
+	/// This also updates the position and velocity kinematics.
+	/// @param q generalized coordinates
+	/// @param u generalized velocities
+	/// @return 0 on success, -1 on error
+	int calculateJacobians(const vecx& q, const vecx& u);
+	/// Calculate Jacobians only, see calculateJacobians(const vecx&, const vecx&)
+	/// @param q generalized coordinates
+	/// @return 0 on success, -1 on error
+	int calculateJacobians(const vecx& q);
+
+	/// Calculate joint forces for many samples at once.
+	/// Each column holds one sample, each row one DoF, so dim(q) = numDoFs() x number of samples.
+	/// The samples are processed in blocks of eight with btParallelFor, using the
+	/// current task scheduler. Unlike calculateInverseDynamics, this does not update
+	/// the kinematic state returned by the getBody* functions.
+	/// The blocks are plain loops over the samples for the compiler to vectorize, there are
+	/// no SIMD intrinsics. On one thread this is only about 1.5 times as fast as calling
+	/// calculateInverseDynamics for each sample, larger gains need several threads.
+	/// @param q generalized coordinates
+	/// @param u generalized velocities, same dimensions as q
+	/// @param dot_u generalized accelerations, same dimensions as q
+	/// @param joint_forces generalized forces, must have the same dimensions as q
+	/// @param use_float if true, calculate in single precision. This is only a separate path
+	///		when idScalar is double (BT_USE_DOUBLE_PRECISION), the default build already
+	///		calculates in float and ignores it.
+	/// @return 0 on success, -1 on error
+	int calculateInverseDynamicsBatch(const matxx& q, const matxx& u, const matxx& dot_u,
+									  matxx* joint_forces, const bool use_float = false);
+	/// Calculate joint space mass matrices for many samples at once.
+	/// On one thread this is about 3 times as fast as calling calculateMassMatrix for each sample.
+	/// @param q generalized coordinates, one sample per column (see calculateInverseDynamicsBatch)
+	/// @param mass_matrices output, dim(mass_matrices) = (numDoFs()*numDoFs()) x number of samples.
+	///		Element (row, col) of the mass matrix of sample s is stored at
+	///		(row*numDoFs() + col, s). Both triangular sections are populated.
+	/// @param use_float if true and idScalar is double, calculate in single precision
+	/// @return -1 on error, 0 on success
+	int calculateMassMatrixBatch(const matxx& q, matxx* mass_matrices, const bool use_float = false);
+
 	/// set gravitational acceleration
 	/// the default is [0;0;-9.8] in the world frame
 	/// @param gravity the gravitational acceleration in world frame
@@ -200,6 +274,30 @@ public:
 	/// @param world_origin pointer for return data
 	/// @return 0 on success, -1 on error
 	int getBodyLinearAcceleration(const int body_index, vec3* world_acceleration) const;
+	/// get the Jacobian of a body's angular velocity with respect to u, in world frame.
+	/// Requires a prior call to calculateJacobians.
+	/// @param body_index index for frame/body
+	/// @param world_jac_rot pointer for return data, must be 3 x numDoFs()
+	/// @return 0 on success, -1 on error
+	int getBodyJacobianRot(const int body_index, matxx* world_jac_rot) const;
+	/// get the Jacobian of the linear velocity of a body-fixed frame's origin
+	/// with respect to u, in world frame. Requires a prior call to calculateJacobians.
+	/// @param body_index index for frame/body
+	/// @param world_jac_trans pointer for return data, must be 3 x numDoFs()
+	/// @return 0 on success, -1 on error
+	int getBodyJacobianTrans(const int body_index, matxx* world_jac_trans) const;
+	/// get the time derivative of a body's rotational Jacobian times u, in world frame.
+	/// Requires a prior call to calculateJacobians(q, u).
+	/// @param body_index index for frame/body
+	/// @param world_dot_jac_rot_u pointer for return data
+	/// @return 0 on success, -1 on error
+	int getBodyDotJacobianRotU(const int body_index, vec3* world_dot_jac_rot_u) const;
+	/// get the time derivative of a body's translational Jacobian times u, in world frame.
+	/// Requires a prior call to calculateJacobians(q, u).
+	/// @param body_index index for frame/body
+	/// @param world_dot_jac_trans_u pointer for return data
+	/// @return 0 on success, -1 on error
+	int getBodyDotJacobianTransU(const int body_index, vec3* world_dot_jac_trans_u) const;
 	/// returns the (internal) index of body
 	/// @param body_index is the index of a body (internal: TODO: fix/clarify
 	/// indexing!)
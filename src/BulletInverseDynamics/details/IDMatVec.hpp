@@ -90,8 +90,8 @@ public:
 	}
 	~matxx() { idFree(m_data); }
 	const matxx& operator=(const matxx& rhs);
-	idScalar& operator()(int row, int col) { return m_data[row * m_rows + col]; }
-	const idScalar& operator()(int row, int col) const { return m_data[row * m_rows + col]; }
+	idScalar& operator()(int row, int col) { return m_data[row * m_cols + col]; }
+	const idScalar& operator()(int row, int col) const { return m_data[row * m_cols + col]; }
 	const int& rows() const { return m_rows; }
 	const int& cols() const { return m_cols; }
 
@@ -0,0 +1,797 @@
+// Batched versions of the inverse dynamics and mass matrix calculations in MultiBodyTreeImpl.cpp.
+// Samples are processed in blocks of ID_BATCH_LANES, and all per-body quantities of a block
+// are stored lane-wise (structure of arrays), so that every operation is a short fixed-length
+// loop over the lanes that the compiler can vectorize.
+// The algorithms are the same as in MultiBodyTreeImpl.cpp, see there for details.
+// There are no SIMD intrinsics and the float kernels are only instantiated separately when
+// idScalar is double, so the single threaded gain is modest: about 1.5x for the inverse
+// dynamics and about 3x for the mass matrix.
+
+#include "MultiBodyTreeImpl.hpp"
+
+#include <cmath>
+
+#ifndef BT_ID_WO_BULLET
+#include "LinearMath/btThreads.h"
+#endif
+
+namespace btInverseDynamics {
+
+// number of samples processed together
+#define ID_BATCH_LANES 8
+
+// btMatrixX::setElem counts its calls, which is not thread safe,
+// so the batch results are written to the matrix storage directly.
+#ifdef ID_LINEAR_MATH_USE_BULLET
+#define setBatchElem(mat, row, col, val) \
+	(mat)->getBufferPointerWritable()[(row) * (mat)->cols() + (col)] = (val)
+#else
+#define setBatchElem(mat, row, col, val) (*(mat))(row, col) = (val)
+#endif
+
+template <typename T>
+struct BatchVec3 {
+	T v[3][ID_BATCH_LANES];
+};
+
+template <typename T>
+struct BatchMat33 {
+	T m[3][3][ID_BATCH_LANES];
+};
+
+// per-body data that does not depend on q, u or dot_u, broadcast to all lanes
+template <typename T>
+struct BatchBodyConstants {
+	JointType m_joint_type;
+	int m_q_index;
+	T m_mass[ID_BATCH_LANES];
+	T m_subtree_mass;
+	BatchVec3<T> m_body_mass_com;
+	BatchMat33<T> m_body_I_body;
+	BatchVec3<T> m_Jac_JR;
+	BatchVec3<T> m_Jac_JT;
+	BatchVec3<T> m_parent_Jac_JT;
+	BatchVec3<T> m_parent_pos_parent_body_ref;
+	BatchMat33<T> m_body_T_parent_ref;
+	BatchVec3<T> m_body_force_user;
+	BatchVec3<T> m_body_moment_user;
+};
+
+// per-body kinematic and dynamic state of one block of samples
+template <typename T>
+struct BatchBodyState {
+	BatchMat33<T> m_body_T_parent;
+	BatchVec3<T> m_parent_pos_parent_body;
+	BatchVec3<T> m_body_ang_vel_rel;
+	BatchVec3<T> m_parent_vel_rel;
+	BatchVec3<T> m_body_ang_acc_rel;
+	BatchVec3<T> m_parent_acc_rel;
+	BatchVec3<T> m_body_ang_vel;
+	BatchVec3<T> m_body_vel;
+	BatchVec3<T> m_body_ang_acc;
+	BatchVec3<T> m_body_acc;
+	BatchVec3<T> m_force_at_joint;
+	BatchVec3<T> m_moment_at_joint;
+	BatchVec3<T> m_body_subtree_mass_com;
+	BatchMat33<T> m_body_subtree_I_body;
+};
+
+// lane-wise operations. Outputs must not alias inputs.
+template <typename T>
+static inline void batchSetZero(BatchVec3<T>* a) {
+	for (int r = 0; r < 3; r++)
+		for (int l = 0; l < ID_BATCH_LANES; l++) a->v[r][l] = T(0);
+}
+
+template <typename T>
+static inline void batchBroadcast(const vec3& x, BatchVec3<T>* a) {
+	for (int r = 0; r < 3; r++)
+		for (int l = 0; l < ID_BATCH_LANES; l++) a->v[r][l] = static_cast<T>(x(r));
+}
+
+template <typename T>
+static inline void batchBroadcast(const mat33& x, BatchMat33<T>* a) {
+	for (int r = 0; r < 3; r++)
+		for (int c = 0; c < 3; c++)
+			for (int l = 0; l < ID_BATCH_LANES; l++) a->m[r][c][l] = static_cast<T>(x(r, c));
+}
+
+template <typename T>
+static inline void batchAdd(const BatchVec3<T>& a, const BatchVec3<T>& b, BatchVec3<T>* out) {
+	for (int r = 0; r < 3; r++)
+		for (int l = 0; l < ID_BATCH_LANES; l++) out->v[r][l] = a.v[r][l] + b.v[r][l];
+}
+
+template <typename T>
+static inline void batchSub(const BatchVec3<T>& a, const BatchVec3<T>& b, BatchVec3<T>* out) {
+	for (int r = 0; r < 3; r++)
+		for (int l = 0; l < ID_BATCH_LANES; l++) out->v[r][l] = a.v[r][l] - b.v[r][l];
+}
+
+// a*s, with a lane-wise scalar s
+template <typename T>
+static inline void batchScale(const BatchVec3<T>& a, const T* s, BatchVec3<T>* out) {
+	for (int r = 0; r < 3; r++)
+		for (int l = 0; l < ID_BATCH_LANES; l++) out->v[r][l] = a.v[r][l] * s[l];
+}
+
+template <typename T>
+static inline void batchCross(const BatchVec3<T>& a, const BatchVec3<T>& b, BatchVec3<T>* out) {
+	for (int l = 0; l < ID_BATCH_LANES; l++) {
+		out->v[0][l] = a.v[1][l] * b.v[2][l] - a.v[2][l] * b.v[1][l];
+		out->v[1][l] = a.v[2][l] * b.v[0][l] - a.v[0][l] * b.v[2][l];
+		out->v[2][l] = a.v[0][l] * b.v[1][l] - a.v[1][l] * b.v[0][l];
+	}
+}
+
+template <typename T>
+static inline void batchDot(const BatchVec3<T>& a, const BatchVec3<T>& b, T* out) {
+	for (int l = 0; l < ID_BATCH_LANES; l++)
+		out[l] = a.v[0][l] * b.v[0][l] + a.v[1][l] * b.v[1][l] + a.v[2][l] * b.v[2][l];
+}
+
+// A*x
+template <typename T>
+static inline void batchMul(const BatchMat33<T>& A, const BatchVec3<T>& x, BatchVec3<T>* out) {
+	for (int r = 0; r < 3; r++)
+		for (int l = 0; l < ID_BATCH_LANES; l++)
+			out->v[r][l] =
+				A.m[r][0][l] * x.v[0][l] + A.m[r][1][l] * x.v[1][l] + A.m[r][2][l] * x.v[2][l];
+}
+
+// A^T*x
+template <typename T>
+static inline void batchMulTranspose(const BatchMat33<T>& A, const BatchVec3<T>& x,
+									 BatchVec3<T>* out) {
+	for (int r = 0; r < 3; r++)
+		for (int l = 0; l < ID_BATCH_LANES; l++)
+			out->v[r][l] =
+				A.m[0][r][l] * x.v[0][l] + A.m[1][r][l] * x.v[1][l] + A.m[2][r][l] * x.v[2][l];
+}
+
+// A*B
+template <typename T>
+static inline void batchMul(const BatchMat33<T>& A, const BatchMat33<T>& B, BatchMat33<T>* out) {
+	for (int r = 0; r < 3; r++)
+		for (int c = 0; c < 3; c++)
+			for (int l = 0; l < ID_BATCH_LANES; l++)
+				out->m[r][c][l] = A.m[r][0][l] * B.m[0][c][l] + A.m[r][1][l] * B.m[1][c][l] +
+								  A.m[r][2][l] * B.m[2][c][l];
+}
+
+// A^T*B*A
+template <typename T>
+static inline void batchRotateTensor(const BatchMat33<T>& A, const BatchMat33<T>& B,
+									 BatchMat33<T>* out) {
+	BatchMat33<T> BA;
+	batchMul(B, A, &BA);
+	for (int r = 0; r < 3; r++)
+		for (int c = 0; c < 3; c++)
+			for (int l = 0; l < ID_BATCH_LANES; l++)
+				out->m[r][c][l] = A.m[0][r][l] * BA.m[0][c][l] + A.m[1][r][l] * BA.m[1][c][l] +
+								  A.m[2][r][l] * BA.m[2][c][l];
+}
+
+// the transforms below match bodyTParentFromAxisAngle and transformX/Y/Z in IDMath.cpp.
+// trigonometric functions are evaluated per lane.
+template <typename T>
+static inline void batchTParentFromAxisAngle(const BatchVec3<T>& axis, const T* angle,
+											 BatchMat33<T>* out) {
+	for (int l = 0; l < ID_BATCH_LANES; l++) {
+		const T c = std::cos(angle[l]);
+		const T s = -std::sin(angle[l]);
+		const T one_m_c = T(1) - c;
+		const T x = axis.v[0][l];
+		const T y = axis.v[1][l];
+		const T z = axis.v[2][l];
+
+		out->m[0][0][l] = x * x * one_m_c + c;
+		out->m[0][1][l] = x * y * one_m_c - z * s;
+		out->m[0][2][l] = x * z * one_m_c + y * s;
+
+		out->m[1][0][l] = x * y * one_m_c + z * s;
+		out->m[1][1][l] = y * y * one_m_c + c;
+		out->m[1][2][l] = y * z * one_m_c - x * s;
+
+		out->m[2][0][l] = x * z * one_m_c - y * s;
+		out->m[2][1][l] = y * z * one_m_c + x * s;
+		out->m[2][2][l] = z * z * one_m_c + c;
+	}
+}
+
+// transformZ(gamma)*transformY(beta)*transformX(alpha)
+template <typename T>
+static inline void batchTransformZYX(const T* alpha, const T* beta, const T* gamma,
+									 BatchMat33<T>* out) {
+	for (int l = 0; l < ID_BATCH_LANES; l++) {
+		const T ca = std::cos(alpha[l]);
+		const T sa = std::sin(alpha[l]);
+		const T cb = std::cos(beta[l]);
+		const T sb = std::sin(beta[l]);
+		const T cg = std::cos(gamma[l]);
+		const T sg = std::sin(gamma[l]);
+
+		out->m[0][0][l] = cg * cb;
+		out->m[0][1][l] = cg * sb * sa + sg * ca;
+		out->m[0][2][l] = -cg * sb * ca + sg * sa;
+
+		out->m[1][0][l] = -sg * cb;
+		out->m[1][1][l] = -sg * sb * sa + cg * ca;
+		out->m[1][2][l] = sg * sb * ca + cg * sa;
+
+		out->m[2][0][l] = sb;
+		out->m[2][1][l] = -cb * sa;
+		out->m[2][2][l] = cb * ca;
+	}
+}
+
+// copy rows [row, row+3) of samples [first, first+num) into lanes, padding unused lanes with zero
+template <typename T>
+static inline void batchLoad(const matxx& x, const int row, const int first, const int num,
+							 BatchVec3<T>* out) {
+	for (int r = 0; r < 3; r++)
+		for (int l = 0; l < ID_BATCH_LANES; l++)
+			out->v[r][l] = l < num ? static_cast<T>(x(row + r, first + l)) : T(0);
+}
+
+template <typename T>
+static inline void batchLoad(const matxx& x, const int row, const int first, const int num,
+							 T* out) {
+	for (int l = 0; l < ID_BATCH_LANES; l++)
+		out[l] = l < num ? static_cast<T>(x(row, first + l)) : T(0);
+}
+
+static inline void setSixDoFJacobians(const int dof, vec3* Jac_JR, vec3* Jac_JT) {
+	setZero(*Jac_JR);
+	setZero(*Jac_JT);
+	if (dof < 3) {
+		(*Jac_JR)(dof) = 1;
+	} else {
+		(*Jac_JT)(dof - 3) = 1;
+	}
+}
+
+// read-only data shared by all blocks of one batch call
+template <typename T>
+struct BatchTree {
+	int m_num_bodies;
+	int m_num_dofs;
+	const BatchBodyConstants<T>* m_bodies;
+	const int* m_parent_index;
+	const idArray<idArray<int>::type>::type* m_child_indices;
+	BatchVec3<T> m_world_gravity;
+	// 6-dof jacobians for floating joints
+	BatchVec3<T> m_six_dof_Jac_JR[6];
+	BatchVec3<T> m_six_dof_Jac_JT[6];
+};
+
+template <typename T>
+static void setupBatchTree(const idArray<RigidBody>::type& body_list,
+						   const idArray<int>::type& parent_index,
+						   const idArray<idArray<int>::type>::type& child_indices,
+						   const vec3& world_gravity, const int num_dofs,
+						   typename idArray<BatchBodyConstants<T> >::type* constants,
+						   BatchTree<T>* tree) {
+	const int num_bodies = static_cast<int>(body_list.size());
+	constants->resize(num_bodies);
+	for (int i = num_bodies - 1; i >= 0; i--) {
+		const RigidBody& body = body_list[i];
+		BatchBodyConstants<T>& c = (*constants)[i];
+		c.m_joint_type = body.m_joint_type;
+		c.m_q_index = body.m_q_index;
+		for (int l = 0; l < ID_BATCH_LANES; l++) c.m_mass[l] = static_cast<T>(body.m_mass);
+		batchBroadcast(body.m_body_mass_com, &c.m_body_mass_com);
+		batchBroadcast(body.m_body_I_body, &c.m_body_I_body);
+		batchBroadcast(body.m_Jac_JR, &c.m_Jac_JR);
+		batchBroadcast(body.m_Jac_JT, &c.m_Jac_JT);
+		batchBroadcast(body.m_parent_Jac_JT, &c.m_parent_Jac_JT);
+		batchBroadcast(body.m_parent_pos_parent_body_ref, &c.m_parent_pos_parent_body_ref);
+		batchBroadcast(body.m_body_T_parent_ref, &c.m_body_T_parent_ref);
+		batchBroadcast(body.m_body_force_user, &c.m_body_force_user);
+		batchBroadcast(body.m_body_moment_user, &c.m_body_moment_user);
+		// the subtree mass does not depend on the configuration
+		c.m_subtree_mass = static_cast<T>(body.m_mass);
+		for (idArrayIdx k = 0; k < child_indices[i].size(); k++) {
+			c.m_subtree_mass += (*constants)[child_indices[i][k]].m_subtree_mass;
+		}
+	}
+	tree->m_num_bodies = num_bodies;
+	tree->m_num_dofs = num_dofs;
+	tree->m_bodies = num_bodies > 0 ? &(*constants)[0] : 0x0;
+	tree->m_parent_index = num_bodies > 0 ? &parent_index[0] : 0x0;
+	tree->m_child_indices = &child_indices;
+	batchBroadcast(world_gravity, &tree->m_world_gravity);
+	for (int dof = 0; dof < 6; dof++) {
+		vec3 Jac_JR, Jac_JT;
+		setSixDoFJacobians(dof, &Jac_JR, &Jac_JT);
+		batchBroadcast(Jac_JR, &tree->m_six_dof_Jac_JR[dof]);
+		batchBroadcast(Jac_JT, &tree->m_six_dof_Jac_JT[dof]);
+	}
+}
+
+// relative kinematics of one block, see section 1 of calculateInverseDynamics.
+// u and dot_u may be null, then only positions are updated.
+template <typename T>
+static void batchRelativeKinematics(const BatchTree<T>& tree, const matxx& q, const matxx* u,
+									const matxx* dot_u, const int first, const int num,
+									BatchBodyState<T>* state) {
+	for (int i = 0; i < tree.m_num_bodies; i++) {
+		const BatchBodyConstants<T>& c = tree.m_bodies[i];
+		BatchBodyState<T>& s = state[i];
+		switch (c.m_joint_type) {
+			case FIXED:
+				s.m_body_T_parent = c.m_body_T_parent_ref;
+				s.m_parent_pos_parent_body = c.m_parent_pos_parent_body_ref;
+				if (u) {
+					batchSetZero(&s.m_body_ang_vel_rel);
+					batchSetZero(&s.m_parent_vel_rel);
+					batchSetZero(&s.m_body_ang_acc_rel);
+					batchSetZero(&s.m_parent_acc_rel);
+				}
+				break;
+			case REVOLUTE: {
+				T qi[ID_BATCH_LANES];
+				batchLoad(q, c.m_q_index, first, num, qi);
+				BatchMat33<T> body_T_body_ref;
+				batchTParentFromAxisAngle(c.m_Jac_JR, qi, &body_T_body_ref);
+				batchMul(body_T_body_ref, c.m_body_T_parent_ref, &s.m_body_T_parent);
+				s.m_parent_pos_parent_body = c.m_parent_pos_parent_body_ref;
+				if (u) {
+					T ui[ID_BATCH_LANES], dot_ui[ID_BATCH_LANES];
+					batchLoad(*u, c.m_q_index, first, num, ui);
+					batchLoad(*dot_u, c.m_q_index, first, num, dot_ui);
+					batchScale(c.m_Jac_JR, ui, &s.m_body_ang_vel_rel);
+					batchScale(c.m_Jac_JR, dot_ui, &s.m_body_ang_acc_rel);
+					batchSetZero(&s.m_parent_vel_rel);
+					batchSetZero(&s.m_parent_acc_rel);
+				}
+				break;
+			}
+			case PRISMATIC: {
+				T qi[ID_BATCH_LANES];
+				batchLoad(q, c.m_q_index, first, num, qi);
+				BatchVec3<T> offset;
+				batchScale(c.m_parent_Jac_JT, qi, &offset);
+				s.m_body_T_parent = c.m_body_T_parent_ref;
+				batchAdd(c.m_parent_pos_parent_body_ref, offset, &s.m_parent_pos_parent_body);
+				if (u) {
+					T ui[ID_BATCH_LANES], dot_ui[ID_BATCH_LANES];
+					batchLoad(*u, c.m_q_index, first, num, ui);
+					batchLoad(*dot_u, c.m_q_index, first, num, dot_ui);
+					batchScale(c.m_parent_Jac_JT, ui, &s.m_parent_vel_rel);
+					batchScale(c.m_parent_Jac_JT, dot_ui, &s.m_parent_acc_rel);
+					batchSetZero(&s.m_body_ang_vel_rel);
+					batchSetZero(&s.m_body_ang_acc_rel);
+				}
+				break;
+			}
+			case FLOATING: {
+				T alpha[ID_BATCH_LANES], beta[ID_BATCH_LANES], gamma[ID_BATCH_LANES];
+				batchLoad(q, c.m_q_index + 0, first, num, alpha);
+				batchLoad(q, c.m_q_index + 1, first, num, beta);
+				batchLoad(q, c.m_q_index + 2, first, num, gamma);
+				batchTransformZYX(alpha, beta, gamma, &s.m_body_T_parent);
+				BatchVec3<T> tmp;
+				batchLoad(q, c.m_q_index + 3, first, num, &tmp);
+				batchMul(s.m_body_T_parent, tmp, &s.m_parent_pos_parent_body);
+				if (u) {
+					batchLoad(*u, c.m_q_index + 0, first, num, &s.m_body_ang_vel_rel);
+					batchLoad(*dot_u, c.m_q_index + 0, first, num, &s.m_body_ang_acc_rel);
+					batchLoad(*u, c.m_q_index + 3, first, num, &tmp);
+					batchMulTranspose(s.m_body_T_parent, tmp, &s.m_parent_vel_rel);
+					batchLoad(*dot_u, c.m_q_index + 3, first, num, &tmp);
+					batchMulTranspose(s.m_body_T_parent, tmp, &s.m_parent_acc_rel);
+				}
+				break;
+			}
+		}
+	}
+}
+
+// inverse dynamics for samples [first, first+num), num <= ID_BATCH_LANES
+template <typename T>
+static void batchInverseDynamicsBlock(const BatchTree<T>& tree, const matxx& q, const matxx& u,
+									  const matxx& dot_u, const int first, const int num,
+									  BatchBodyState<T>* state, matxx* joint_forces) {
+	// 1. relative kinematics
+	batchRelativeKinematics(tree, q, &u, &dot_u, first, num, state);
+
+	// 3. absolute kinematics
+	BatchVec3<T> tmp0, tmp1, tmp2;
+	for (int i = 0; i < tree.m_num_bodies; i++) {
+		BatchBodyState<T>& body = state[i];
+		if (0 == i) {
+			body.m_body_ang_vel = body.m_body_ang_vel_rel;
+			batchMul(body.m_body_T_parent, body.m_parent_vel_rel, &body.m_body_vel);
+			body.m_body_ang_acc = body.m_body_ang_acc_rel;
+			// add gravitational acceleration to root body
+			batchSub(body.m_parent_acc_rel, tree.m_world_gravity, &tmp0);
+			batchMul(body.m_body_T_parent, tmp0, &body.m_body_acc);
+			continue;
+		}
+		const BatchBodyState<T>& parent = state[tree.m_parent_index[i]];
+		const BatchVec3<T>& r = body.m_parent_pos_parent_body;
+
+		// 3.2 velocities
+		BatchVec3<T> parent_ang_vel;
+		batchMul(body.m_body_T_parent, parent.m_body_ang_vel, &parent_ang_vel);
+		batchAdd(parent_ang_vel, body.m_body_ang_vel_rel, &body.m_body_ang_vel);
+
+		batchCross(parent.m_body_ang_vel, r, &tmp0);
+		batchAdd(parent.m_body_vel, tmp0, &tmp1);
+		batchAdd(tmp1, body.m_parent_vel_rel, &tmp0);
+		batchMul(body.m_body_T_parent, tmp0, &body.m_body_vel);
+
+		// 3.3 accelerations
+		batchMul(body.m_body_T_parent, parent.m_body_ang_acc, &tmp0);
+		batchCross(body.m_body_ang_vel_rel, parent_ang_vel, &tmp1);
+		batchSub(tmp0, tmp1, &tmp2);
+		batchAdd(tmp2, body.m_body_ang_acc_rel, &body.m_body_ang_acc);
+
+		BatchVec3<T> acc;
+		batchCross(parent.m_body_ang_acc, r, &tmp0);
+		batchAdd(parent.m_body_acc, tmp0, &acc);
+		batchCross(parent.m_body_ang_vel, r, &tmp0);
+		batchCross(parent.m_body_ang_vel, tmp0, &tmp1);
+		batchAdd(acc, tmp1, &tmp2);
+		batchCross(parent.m_body_ang_vel, body.m_parent_vel_rel, &tmp0);
+		for (int k = 0; k < 3; k++)
+			for (int l = 0; l < ID_BATCH_LANES; l++)
+				acc.v[k][l] = tmp2.v[k][l] + T(2) * tmp0.v[k][l] + body.m_parent_acc_rel.v[k][l];
+		batchMul(body.m_body_T_parent, acc, &body.m_body_acc);
+	}
+
+	// 3.4 and 4. equations of motion and forces at the joints, from the leaves to the root.
+	// children have larger indices than their parents, so all children are done
+	// when a body is reached.
+	for (int i = tree.m_num_bodies - 1; i >= 0; i--) {
+		const BatchBodyConstants<T>& c = tree.m_bodies[i];
+		BatchBodyState<T>& body = state[i];
+
+		BatchVec3<T> eom_rot, eom_trans;
+		batchMul(c.m_body_I_body, body.m_body_ang_acc, &eom_rot);
+		batchCross(c.m_body_mass_com, body.m_body_acc, &tmp0);
+		batchAdd(eom_rot, tmp0, &tmp1);
+		batchMul(c.m_body_I_body, body.m_body_ang_vel, &tmp0);
+		batchCross(body.m_body_ang_vel, tmp0, &tmp2);
+		batchAdd(tmp1, tmp2, &tmp0);
+		batchSub(tmp0, c.m_body_moment_user, &eom_rot);
+
+		batchCross(body.m_body_ang_acc, c.m_body_mass_com, &tmp0);
+		batchScale(body.m_body_acc, c.m_mass, &tmp1);
+		batchAdd(tmp0, tmp1, &eom_trans);
+		batchCross(body.m_body_ang_vel, c.m_body_mass_com, &tmp0);
+		batchCross(body.m_body_ang_vel, tmp0, &tmp1);
+		batchAdd(eom_trans, tmp1, &tmp0);
+		batchSub(tmp0, c.m_body_force_user, &eom_trans);
+
+		// forces and moments of the children are subtracted from the sums,
+		// so they are added to the equations of motion here
+		const idArray<int>::type& children = (*tree.m_child_indices)[i];
+		for (idArrayIdx k = 0; k < children.size(); k++) {
+			const BatchBodyState<T>& child = state[children[k]];
+			BatchVec3<T> child_force, child_moment;
+			batchMulTranspose(child.m_body_T_parent, child.m_force_at_joint, &child_force);
+			batchMulTranspose(child.m_body_T_parent, child.m_moment_at_joint, &child_moment);
+			batchCross(child.m_parent_pos_parent_body, child_force, &tmp0);
+			batchAdd(eom_trans, child_force, &tmp1);
+			eom_trans = tmp1;
+			batchAdd(child_moment, tmp0, &tmp1);
+			batchAdd(eom_rot, tmp1, &tmp2);
+			eom_rot = tmp2;
+		}
+		body.m_force_at_joint = eom_trans;
+		body.m_moment_at_joint = eom_rot;
+	}
+
+	// 4. joint forces
+	for (int i = 0; i < tree.m_num_bodies; i++) {
+		const BatchBodyConstants<T>& c = tree.m_bodies[i];
+		const BatchBodyState<T>& body = state[i];
+		switch (c.m_joint_type) {
+			case FIXED:
+				break;
+			case REVOLUTE: {
+				T f[ID_BATCH_LANES];
+				batchDot(c.m_Jac_JR, body.m_moment_at_joint, f);
+				for (int l = 0; l < num; l++) setBatchElem(joint_forces, c.m_q_index, first + l, f[l]);
+				break;
+			}
+			case PRISMATIC: {
+				T f[ID_BATCH_LANES];
+				batchDot(c.m_Jac_JT, body.m_force_at_joint, f);
+				for (int l = 0; l < num; l++) setBatchElem(joint_forces, c.m_q_index, first + l, f[l]);
+				break;
+			}
+			case FLOATING:
+				for (int k = 0; k < 3; k++) {
+					for (int l = 0; l < num; l++) {
+						setBatchElem(joint_forces, c.m_q_index + k, first + l,
+									 body.m_moment_at_joint.v[k][l]);
+						setBatchElem(joint_forces, c.m_q_index + 3 + k, first + l,
+									 body.m_force_at_joint.v[k][l]);
+					}
+				}
+				break;
+		}
+	}
+}
+
+// number of dofs and jacobians of a joint, see setSixDoFJacobians in MultiBodyTreeImpl.cpp
+template <typename T>
+static inline int batchJointDoFs(const BatchTree<T>& tree, const BatchBodyConstants<T>& c,
+								 const int dof, const BatchVec3<T>** Jac_JR,
+								 const BatchVec3<T>** Jac_JT) {
+	if (FLOATING == c.m_joint_type) {
+		*Jac_JR = &tree.m_six_dof_Jac_JR[dof];
+		*Jac_JT = &tree.m_six_dof_Jac_JT[dof];
+		return 6;
+	}
+	*Jac_JR = &c.m_Jac_JR;
+	*Jac_JT = &c.m_Jac_JT;
+	return FIXED == c.m_joint_type ? 0 : 1;
+}
+
+// mass matrices for samples [first, first+num), num <= ID_BATCH_LANES
+template <typename T>
+static void batchMassMatrixBlock(const BatchTree<T>& tree, const matxx& q, const int first,
+								 const int num, BatchBodyState<T>* state, matxx* mass_matrices) {
+	const int n = tree.m_num_dofs;
+	for (int row = 0; row < n * n; row++) {
+		for (int l = 0; l < num; l++) setBatchElem(mass_matrices, row, first + l, idScalar(0));
+	}
+
+	// 1. relative kinematics (positions only)
+	batchRelativeKinematics<T>(tree, q, 0x0, 0x0, first, num, state);
+
+	// 2. composite rigid bodies
+	BatchVec3<T> tmp0, tmp1;
+	for (int i = tree.m_num_bodies - 1; i >= 0; i--) {
+		const BatchBodyConstants<T>& c = tree.m_bodies[i];
+		BatchBodyState<T>& body = state[i];
+		body.m_body_subtree_mass_com = c.m_body_mass_com;
+		body.m_body_subtree_I_body = c.m_body_I_body;
+
+		const idArray<int>::type& children = (*tree.m_child_indices)[i];
+		for (idArrayIdx k = 0; k < children.size(); k++) {
+			const BatchBodyConstants<T>& child_c = tree.m_bodies[children[k]];
+			const BatchBodyState<T>& child = state[children[k]];
+			const T child_mass = child_c.m_subtree_mass;
+
+			BatchVec3<T> child_mass_com;
+			batchMulTranspose(child.m_body_T_parent, child.m_body_subtree_mass_com, &child_mass_com);
+			BatchMat33<T> child_I;
+			batchRotateTensor(child.m_body_T_parent, child.m_body_subtree_I_body, &child_I);
+
+			for (int r = 0; r < 3; r++) {
+				for (int l = 0; l < ID_BATCH_LANES; l++) {
+					body.m_body_subtree_mass_com.v[r][l] +=
+						child_mass_com.v[r][l] + child.m_parent_pos_parent_body.v[r][l] * child_mass;
+				}
+				for (int cc = 0; cc < 3; cc++)
+					for (int l = 0; l < ID_BATCH_LANES; l++)
+						body.m_body_subtree_I_body.m[r][cc][l] += child_I.m[r][cc][l];
+			}
+
+			if (child_mass > 0) {
+				// parallel axis theorem, with tilde(a)*tilde(a) = a*a^T - (a.a)*1
+				const T inv_mass = T(1) / child_mass;
+				for (int r = 0; r < 3; r++)
+					for (int l = 0; l < ID_BATCH_LANES; l++) {
+						tmp0.v[r][l] = child_mass_com.v[r][l] * inv_mass;
+						tmp1.v[r][l] = child.m_parent_pos_parent_body.v[r][l] + tmp0.v[r][l];
+					}
+				T r_child_sq[ID_BATCH_LANES], r_body_sq[ID_BATCH_LANES];
+				batchDot(tmp0, tmp0, r_child_sq);
+				batchDot(tmp1, tmp1, r_body_sq);
+				for (int r = 0; r < 3; r++)
+					for (int cc = 0; cc < 3; cc++)
+						for (int l = 0; l < ID_BATCH_LANES; l++) {
+							T d = tmp0.v[r][l] * tmp0.v[cc][l] - tmp1.v[r][l] * tmp1.v[cc][l];
+							if (r == cc) {
+								d += r_body_sq[l] - r_child_sq[l];
+							}
+							body.m_body_subtree_I_body.m[r][cc][l] += child_mass * d;
+						}
+			}
+		}
+	}
+
+	// 3. mass matrix columns, walking up the tree from each body
+	for (int i = tree.m_num_bodies - 1; i >= 0; i--) {
+		const BatchBodyConstants<T>& c = tree.m_bodies[i];
+		const BatchBodyState<T>& body = state[i];
+		T subtree_mass[ID_BATCH_LANES];
+		for (int l = 0; l < ID_BATCH_LANES; l++) subtree_mass[l] = c.m_subtree_mass;
+
+		const BatchVec3<T>* Jac_JR;
+		const BatchVec3<T>* Jac_JT;
+		const int num_body_dofs = batchJointDoFs(tree, c, 0, &Jac_JR, &Jac_JT);
+		for (int dof = num_body_dofs - 1; dof >= 0; dof--) {
+			const int col = c.m_q_index + dof;
+			batchJointDoFs(tree, c, dof, &Jac_JR, &Jac_JT);
+
+			BatchVec3<T> eom_rot, eom_trans;
+			batchMul(body.m_body_subtree_I_body, *Jac_JR, &tmp0);
+			batchCross(body.m_body_subtree_mass_com, *Jac_JT, &tmp1);
+			batchAdd(tmp0, tmp1, &eom_rot);
+			batchScale(*Jac_JT, subtree_mass, &tmp0);
+			batchCross(body.m_body_subtree_mass_com, *Jac_JR, &tmp1);
+			batchSub(tmp0, tmp1, &eom_trans);
+
+			// 1. dofs of this body, up to and including the diagonal
+			for (int row_dof = dof; row_dof >= 0; row_dof--) {
+				const int row = c.m_q_index + row_dof;
+				batchJointDoFs(tree, c, row_dof, &Jac_JR, &Jac_JT);
+				T Mrc[ID_BATCH_LANES], Mt[ID_BATCH_LANES];
+				batchDot(*Jac_JR, eom_rot, Mrc);
+				batchDot(*Jac_JT, eom_trans, Mt);
+				for (int l = 0; l < num; l++) {
+					setBatchElem(mass_matrices, col * n + row, first + l, Mrc[l] + Mt[l]);
+					setBatchElem(mass_matrices, row * n + col, first + l, Mrc[l] + Mt[l]);
+				}
+			}
+			// 2. ancestor dofs
+			int child_idx = i;
+			int parent_idx = tree.m_parent_index[i];
+			while (parent_idx >= 0) {
+				const BatchBodyState<T>& child_body = state[child_idx];
+				const BatchBodyConstants<T>& parent_c = tree.m_bodies[parent_idx];
+
+				batchMulTranspose(child_body.m_body_T_parent, eom_trans, &tmp0);
+				eom_trans = tmp0;
+				batchMulTranspose(child_body.m_body_T_parent, eom_rot, &tmp0);
+				batchCross(child_body.m_parent_pos_parent_body, eom_trans, &tmp1);
+				batchAdd(tmp0, tmp1, &eom_rot);
+
+				const int num_parent_dofs = batchJointDoFs(tree, parent_c, 0, &Jac_JR, &Jac_JT);
+				for (int row_dof = num_parent_dofs - 1; row_dof >= 0; row_dof--) {
+					const int row = parent_c.m_q_index + row_dof;
+					batchJointDoFs(tree, parent_c, row_dof, &Jac_JR, &Jac_JT);
+					T Mrc[ID_BATCH_LANES], Mt[ID_BATCH_LANES];
+					batchDot(*Jac_JR, eom_rot, Mrc);
+					batchDot(*Jac_JT, eom_trans, Mt);
+					for (int l = 0; l < num; l++) {
+						setBatchElem(mass_matrices, col * n + row, first + l, Mrc[l] + Mt[l]);
+						setBatchElem(mass_matrices, row * n + col, first + l, Mrc[l] + Mt[l]);
+					}
+				}
+
+				child_idx = parent_idx;
+				parent_idx = tree.m_parent_index[child_idx];
+			}
+		}
+	}
+}
+
+template <typename T>
+struct BatchLoop
+#ifndef BT_ID_WO_BULLET
+	: public btIParallelForBody
+#endif
+{
+	const BatchTree<T>* m_tree;
+	const matxx* m_q;
+	const matxx* m_u;
+	const matxx* m_dot_u;
+	matxx* m_out;
+	int m_num_samples;
+
+	// processes blocks [iBegin, iEnd)
+	void forLoop(int iBegin, int iEnd) const {
+		typename idArray<BatchBodyState<T> >::type state;
+		state.resize(m_tree->m_num_bodies);
+		for (int block = iBegin; block < iEnd; block++) {
+			const int first = block * ID_BATCH_LANES;
+			const int num = BT_ID_MIN(ID_BATCH_LANES, m_num_samples - first);
+			if (m_u) {
+				batchInverseDynamicsBlock(*m_tree, *m_q, *m_u, *m_dot_u, first, num, &state[0],
+										  m_out);
+			} else {
+				batchMassMatrixBlock(*m_tree, *m_q, first, num, &state[0], m_out);
+			}
+		}
+	}
+};
+
+template <typename T>
+static void runBatch(const BatchTree<T>& tree, const matxx& q, const matxx* u, const matxx* dot_u,
+					 matxx* out) {
+	BatchLoop<T> loop;
+	loop.m_tree = &tree;
+	loop.m_q = &q;
+	loop.m_u = u;
+	loop.m_dot_u = dot_u;
+	loop.m_out = out;
+	loop.m_num_samples = static_cast<int>(q.cols());
+	const int num_blocks = (loop.m_num_samples + ID_BATCH_LANES - 1) / ID_BATCH_LANES;
+#ifndef BT_ID_WO_BULLET
+	btParallelFor(0, num_blocks, 1, loop);
+#else
+	loop.forLoop(0, num_blocks);
+#endif
+}
+
+template <typename T>
+static void calculateInverseDynamicsBatch(const idArray<RigidBody>::type& body_list,
+										  const idArray<int>::type& parent_index,
+										  const idArray<idArray<int>::type>::type& child_indices,
+										  const vec3& world_gravity, const int num_dofs,
+										  const matxx& q, const matxx& u, const matxx& dot_u,
+										  matxx* joint_forces) {
+	typename idArray<BatchBodyConstants<T> >::type constants;
+	BatchTree<T> tree;
+	setupBatchTree<T>(body_list, parent_index, child_indices, world_gravity, num_dofs, &constants,
+					  &tree);
+	runBatch(tree, q, &u, &dot_u, joint_forces);
+}
+
+template <typename T>
+static void calculateMassMatrixBatch(const idArray<RigidBody>::type& body_list,
+									 const idArray<int>::type& parent_index,
+									 const idArray<idArray<int>::type>::type& child_indices,
+									 const vec3& world_gravity, const int num_dofs,
+									 const matxx& q, matxx* mass_matrices) {
+	typename idArray<BatchBodyConstants<T> >::type constants;
+	BatchTree<T> tree;
+	setupBatchTree<T>(body_list, parent_index, child_indices, world_gravity, num_dofs, &constants,
+					  &tree);
+	runBatch<T>(tree, q, 0x0, 0x0, mass_matrices);
+}
+
+int MultiBodyTree::MultiBodyImpl::calculateInverseDynamicsBatch(const matxx &q, const matxx &u,
+																const matxx &dot_u,
+																matxx *joint_forces,
+																const bool use_float) {
+	const int num_samples = static_cast<int>(q.cols());
+	if (q.rows() != m_num_dofs || u.rows() != m_num_dofs || dot_u.rows() != m_num_dofs ||
+		joint_forces->rows() != m_num_dofs || u.cols() != num_samples ||
+		dot_u.cols() != num_samples || joint_forces->cols() != num_samples) {
+		error_message("wrong matrix dimension. system has %d DOFs,\n"
+					  "but dim(q)= %d x %d, dim(u)= %d x %d, dim(dot_u)= %d x %d, "
+					  "dim(joint_forces)= %d x %d\n",
+					  m_num_dofs, static_cast<int>(q.rows()), static_cast<int>(q.cols()),
+					  static_cast<int>(u.rows()), static_cast<int>(u.cols()),
+					  static_cast<int>(dot_u.rows()), static_cast<int>(dot_u.cols()),
+					  static_cast<int>(joint_forces->rows()),
+					  static_cast<int>(joint_forces->cols()));
+		return -1;
+	}
+	if (use_float) {
+		btInverseDynamics::calculateInverseDynamicsBatch<float>(
+			m_body_list, m_parent_index, m_child_indices, m_world_gravity, m_num_dofs, q, u, dot_u,
+			joint_forces);
+	} else {
+		btInverseDynamics::calculateInverseDynamicsBatch<idScalar>(
+			m_body_list, m_parent_index, m_child_indices, m_world_gravity, m_num_dofs, q, u, dot_u,
+			joint_forces);
+	}
+	return 0;
+}
+
+int MultiBodyTree::MultiBodyImpl::calculateMassMatrixBatch(const matxx &q, matxx *mass_matrices,
+														   const bool use_float) {
+	const int num_samples = static_cast<int>(q.cols());
+	if (q.rows() != m_num_dofs || mass_matrices->rows() != m_num_dofs * m_num_dofs ||
+		mass_matrices->cols() != num_samples) {
+		error_message("Dimension error. System has %d DOFs,\n"
+					  "but dim(q)= %d x %d, dim(mass_matrices)= %d x %d\n",
+					  m_num_dofs, static_cast<int>(q.rows()), static_cast<int>(q.cols()),
+					  static_cast<int>(mass_matrices->rows()),
+					  static_cast<int>(mass_matrices->cols()));
+		return -1;
+	}
+	if (use_float) {
+		btInverseDynamics::calculateMassMatrixBatch<float>(m_body_list, m_parent_index,
+														   m_child_indices, m_world_gravity,
+														   m_num_dofs, q, mass_matrices);
+	} else {
+		btInverseDynamics::calculateMassMatrixBatch<idScalar>(m_body_list, m_parent_index,
+															  m_child_indices, m_world_gravity,
+															  m_num_dofs, q, mass_matrices);
+	}
+	return 0;
+}
+
+#undef setBatchElem
+}
@@ -0,0 +1,339 @@
+// Partial derivatives of the inverse dynamics (recursive Newton-Euler) with respect to q and u.
+// The derivatives are calculated by differentiating each step of calculateInverseDynamics
+// (forward mode) for one degree of freedom at a time.
+// Perturbing a degree of freedom of body k only changes the kinematics of the subtree rooted in k,
+// and the joint forces of that subtree and of the ancestors of k, so only these bodies are visited.
+
+#include "MultiBodyTreeImpl.hpp"
+
+#include "../IDMath.hpp"
+
+namespace btInverseDynamics {
+
+// derivatives of the kinematic and dynamic quantities of one body
+// with respect to a single q or u component
+struct RigidBodyTangent {
+	ID_DECLARE_ALIGNED_ALLOCATOR();
+	RigidBodyTangent() {
+		setZero(m_body_T_parent);
+		setZero(m_parent_pos_parent_body);
+		setZero(m_body_ang_vel_rel);
+		setZero(m_parent_vel_rel);
+		setZero(m_parent_acc_rel);
+		setZero(m_body_ang_vel);
+		setZero(m_body_vel);
+		setZero(m_body_ang_acc);
+		setZero(m_body_acc);
+		setZero(m_force_at_joint);
+		setZero(m_moment_at_joint);
+	}
+	// relative kinematics, only non-zero for the perturbed body
+	mat33 m_body_T_parent;
+	vec3 m_parent_pos_parent_body;
+	vec3 m_body_ang_vel_rel;
+	vec3 m_parent_vel_rel;
+	vec3 m_parent_acc_rel;
+	// absolute kinematics
+	vec3 m_body_ang_vel;
+	vec3 m_body_vel;
+	vec3 m_body_ang_acc;
+	vec3 m_body_acc;
+	// forces at the joint
+	vec3 m_force_at_joint;
+	vec3 m_moment_at_joint;
+};
+
+static inline void setZeroRelative(RigidBodyTangent *tangent) {
+	setZero(tangent->m_body_T_parent);
+	setZero(tangent->m_parent_pos_parent_body);
+	setZero(tangent->m_body_ang_vel_rel);
+	setZero(tangent->m_parent_vel_rel);
+	setZero(tangent->m_parent_acc_rel);
+}
+
+static inline void setZeroAbsolute(RigidBodyTangent *tangent) {
+	setZero(tangent->m_body_ang_vel);
+	setZero(tangent->m_body_vel);
+	setZero(tangent->m_body_ang_acc);
+	setZero(tangent->m_body_acc);
+}
+
+// spin tensor of -v, ie, the derivative of a transform T(q)=exp(-q*tilde(v))
+// is -tilde(v)*T
+static inline mat33 negativeTildeOperator(const vec3 &v) {
+	vec3 minus_v;
+	setZero(minus_v);
+	minus_v -= v;
+	return tildeOperator(minus_v);
+}
+
+int MultiBodyTree::MultiBodyImpl::calculateInverseDynamicsDerivatives(
+	const vecx &q, const vecx &u, const vecx &dot_u, vecx *joint_forces,
+	matxx *d_joint_forces_d_q, matxx *d_joint_forces_d_u) {
+// Macro for setting matrix elements depending on underlying math library.
+#ifdef ID_LINEAR_MATH_USE_BULLET
+#define setDerivativeElem(matrix, row, col, val) (matrix)->setElem(row, col, val)
+#else
+#define setDerivativeElem(matrix, row, col, val) (*(matrix))(row, col) = val
+#endif
+
+	if (d_joint_forces_d_q->rows() != m_num_dofs || d_joint_forces_d_q->cols() != m_num_dofs ||
+		d_joint_forces_d_u->rows() != m_num_dofs || d_joint_forces_d_u->cols() != m_num_dofs) {
+		error_message("Dimension error. System has %d DOFs,\n"
+					  "but dim(d_joint_forces_d_q)= %d x %d, dim(d_joint_forces_d_u)= %d x %d\n",
+					  m_num_dofs, static_cast<int>(d_joint_forces_d_q->rows()),
+					  static_cast<int>(d_joint_forces_d_q->cols()),
+					  static_cast<int>(d_joint_forces_d_u->rows()),
+					  static_cast<int>(d_joint_forces_d_u->cols()));
+		return -1;
+	}
+	// nominal solution, this also checks the remaining dimensions
+	if (-1 == calculateInverseDynamics(q, u, dot_u, joint_forces)) {
+		return -1;
+	}
+
+	for (int i = 0; i < m_num_dofs; i++) {
+		for (int j = 0; j < m_num_dofs; j++) {
+			setDerivativeElem(d_joint_forces_d_q, i, j, 0.0);
+			setDerivativeElem(d_joint_forces_d_u, i, j, 0.0);
+		}
+	}
+
+	const int num_bodies = m_body_list.size();
+	idArray<RigidBodyTangent>::type tangents;
+	tangents.resize(num_bodies);
+	// in_subtree[i]: kinematics of i depend on the perturbed dof
+	// has_force_tangent[i]: forces of i depend on the perturbed dof
+	idArray<bool>::type in_subtree;
+	idArray<bool>::type has_force_tangent;
+	in_subtree.resize(num_bodies);
+	has_force_tangent.resize(num_bodies);
+
+	for (int k = 0; k < num_bodies; k++) {
+		const RigidBody &perturbed = m_body_list[k];
+		int num_body_dofs = 0;
+		switch (perturbed.m_joint_type) {
+			case FIXED:
+				break;
+			case REVOLUTE:
+			case PRISMATIC:
+				num_body_dofs = 1;
+				break;
+			case FLOATING:
+				num_body_dofs = 6;
+				break;
+		}
+
+		for (int seed = 0; seed < 2 * num_body_dofs; seed++) {
+			const bool wrt_q = seed < num_body_dofs;
+			const int dof = wrt_q ? seed : seed - num_body_dofs;
+			const int q_index = perturbed.m_q_index + dof;
+
+			// 0. flags
+			for (int i = 0; i < num_bodies; i++) {
+				in_subtree[i] = i == k || (i > k && in_subtree[m_parent_index[i]]);
+				has_force_tangent[i] = in_subtree[i];
+			}
+			for (int i = m_parent_index[k]; i >= 0; i = m_parent_index[i]) {
+				has_force_tangent[i] = true;
+				setZeroRelative(&tangents[i]);
+			}
+
+			// 1. derivatives of the relative kinematics of the perturbed body
+			RigidBodyTangent &seed_tangent = tangents[k];
+			setZeroRelative(&seed_tangent);
+			switch (perturbed.m_joint_type) {
+				case FIXED:
+					break;
+				case REVOLUTE:
+					if (wrt_q) {
+						seed_tangent.m_body_T_parent =
+							negativeTildeOperator(perturbed.m_Jac_JR) * perturbed.m_body_T_parent;
+					} else {
+						seed_tangent.m_body_ang_vel_rel = perturbed.m_Jac_JR;
+					}
+					break;
+				case PRISMATIC:
+					if (wrt_q) {
+						seed_tangent.m_parent_pos_parent_body = perturbed.m_parent_Jac_JT;
+					} else {
+						seed_tangent.m_parent_vel_rel = perturbed.m_parent_Jac_JT;
+					}
+					break;
+				case FLOATING: {
+					const int qi = perturbed.m_q_index;
+					vec3 unit;
+					setZero(unit);
+					unit(dof % 3) = 1.0;
+					if (wrt_q && dof < 3) {
+						// body_T_parent = transformZ(q2) * transformY(q1) * transformX(q0)
+						const mat33 Tx = transformX(q(qi));
+						const mat33 Ty = transformY(q(qi + 1));
+						const mat33 Tz = transformZ(q(qi + 2));
+						mat33 dT;
+						if (0 == dof) {
+							dT = Tz * Ty * negativeTildeOperator(unit) * Tx;
+						} else if (1 == dof) {
+							dT = Tz * negativeTildeOperator(unit) * Ty * Tx;
+						} else {
+							dT = negativeTildeOperator(unit) * Tz * Ty * Tx;
+						}
+						vec3 pos, vel, acc;
+						for (int r = 0; r < 3; r++) {
+							pos(r) = q(qi + 3 + r);
+							vel(r) = u(qi + 3 + r);
+							acc(r) = dot_u(qi + 3 + r);
+						}
+						seed_tangent.m_body_T_parent = dT;
+						seed_tangent.m_parent_pos_parent_body = dT * pos;
+						seed_tangent.m_parent_vel_rel = dT.transpose() * vel;
+						seed_tangent.m_parent_acc_rel = dT.transpose() * acc;
+					} else if (wrt_q) {
+						seed_tangent.m_parent_pos_parent_body = perturbed.m_body_T_parent * unit;
+					} else if (dof < 3) {
+						seed_tangent.m_body_ang_vel_rel = unit;
+					} else {
+						seed_tangent.m_parent_vel_rel = perturbed.m_body_T_parent.transpose() * unit;
+					}
+					break;
+				}
+			}
+
+			// 3. derivatives of absolute kinematics and equations of motion
+			for (int i = k; i < num_bodies; i++) {
+				if (!in_subtree[i]) {
+					continue;
+				}
+				const RigidBody &body = m_body_list[i];
+				RigidBodyTangent &d_body = tangents[i];
+				if (i != k) {
+					setZeroRelative(&d_body);
+				}
+				const mat33 &T = body.m_body_T_parent;
+				const mat33 &dT = d_body.m_body_T_parent;
+				if (0 == i) {
+					d_body.m_body_ang_vel = d_body.m_body_ang_vel_rel;
+					d_body.m_body_vel = dT * body.m_parent_vel_rel + T * d_body.m_parent_vel_rel;
+					setZero(d_body.m_body_ang_acc);
+					d_body.m_body_acc = dT * (body.m_parent_acc_rel - m_world_gravity) +
+										T * d_body.m_parent_acc_rel;
+				} else {
+					const RigidBody &parent = m_body_list[m_parent_index[i]];
+					RigidBodyTangent zero_tangent;
+					if (!in_subtree[m_parent_index[i]]) {
+						setZeroAbsolute(&zero_tangent);
+					}
+					const RigidBodyTangent &d_parent =
+						in_subtree[m_parent_index[i]] ? tangents[m_parent_index[i]] : zero_tangent;
+					const vec3 &r = body.m_parent_pos_parent_body;
+					const vec3 &dr = d_body.m_parent_pos_parent_body;
+
+					const vec3 parent_ang_vel = T * parent.m_body_ang_vel;
+					const vec3 d_parent_ang_vel =
+						dT * parent.m_body_ang_vel + T * d_parent.m_body_ang_vel;
+					d_body.m_body_ang_vel = d_parent_ang_vel + d_body.m_body_ang_vel_rel;
+
+					d_body.m_body_vel =
+						dT * (parent.m_body_vel + parent.m_body_ang_vel.cross(r) +
+							  body.m_parent_vel_rel) +
+						T * (d_parent.m_body_vel + d_parent.m_body_ang_vel.cross(r) +
+							 parent.m_body_ang_vel.cross(dr) + d_body.m_parent_vel_rel);
+
+					d_body.m_body_ang_acc =
+						dT * parent.m_body_ang_acc + T * d_parent.m_body_ang_acc -
+						d_body.m_body_ang_vel_rel.cross(parent_ang_vel) -
+						body.m_body_ang_vel_rel.cross(d_parent_ang_vel);
+
+					const vec3 parent_acc =
+						parent.m_body_acc + parent.m_body_ang_acc.cross(r) +
+						parent.m_body_ang_vel.cross(parent.m_body_ang_vel.cross(r)) +
+						2.0 * parent.m_body_ang_vel.cross(body.m_parent_vel_rel) +
+						body.m_parent_acc_rel;
+					const vec3 d_parent_acc =
+						d_parent.m_body_acc + d_parent.m_body_ang_acc.cross(r) +
+						parent.m_body_ang_acc.cross(dr) +
+						d_parent.m_body_ang_vel.cross(parent.m_body_ang_vel.cross(r)) +
+						parent.m_body_ang_vel.cross(d_parent.m_body_ang_vel.cross(r) +
+													parent.m_body_ang_vel.cross(dr)) +
+						2.0 * (d_parent.m_body_ang_vel.cross(body.m_parent_vel_rel) +
+							   parent.m_body_ang_vel.cross(d_body.m_parent_vel_rel)) +
+						d_body.m_parent_acc_rel;
+					d_body.m_body_acc = dT * parent_acc + T * d_parent_acc;
+				}
+			}
+
+			// 4. derivatives of the forces at the joints, from the leaves to the root
+			for (int i = num_bodies - 1; i >= 0; i--) {
+				if (!has_force_tangent[i]) {
+					continue;
+				}
+				const RigidBody &body = m_body_list[i];
+				RigidBodyTangent &d_body = tangents[i];
+				vec3 d_force;
+				vec3 d_moment;
+				if (in_subtree[i]) {
+					d_moment = body.m_body_I_body * d_body.m_body_ang_acc +
+							   body.m_body_mass_com.cross(d_body.m_body_acc) +
+							   d_body.m_body_ang_vel.cross(body.m_body_I_body * body.m_body_ang_vel) +
+							   body.m_body_ang_vel.cross(body.m_body_I_body * d_body.m_body_ang_vel);
+					d_force = d_body.m_body_ang_acc.cross(body.m_body_mass_com) +
+							  body.m_mass * d_body.m_body_acc +
+							  d_body.m_body_ang_vel.cross(
+								  body.m_body_ang_vel.cross(body.m_body_mass_com)) +
+							  body.m_body_ang_vel.cross(
+								  d_body.m_body_ang_vel.cross(body.m_body_mass_com));
+				} else {
+					setZero(d_force);
+					setZero(d_moment);
+				}
+				for (idArrayIdx c = 0; c < m_child_indices[i].size(); c++) {
+					const int child_index = m_child_indices[i][c];
+					if (!has_force_tangent[child_index]) {
+						continue;
+					}
+					const RigidBody &child = m_body_list[child_index];
+					const RigidBodyTangent &d_child = tangents[child_index];
+					const mat33 parent_T_child = child.m_body_T_parent.transpose();
+					const mat33 d_parent_T_child = d_child.m_body_T_parent.transpose();
+					const vec3 child_force = parent_T_child * child.m_force_at_joint;
+					const vec3 d_child_force = d_parent_T_child * child.m_force_at_joint +
+											   parent_T_child * d_child.m_force_at_joint;
+					d_force += d_child_force;
+					d_moment += d_parent_T_child * child.m_moment_at_joint +
+								parent_T_child * d_child.m_moment_at_joint +
+								d_child.m_parent_pos_parent_body.cross(child_force) +
+								child.m_parent_pos_parent_body.cross(d_child_force);
+				}
+				d_body.m_force_at_joint = d_force;
+				d_body.m_moment_at_joint = d_moment;
+
+				// joint force derivatives
+				matxx *d_joint_forces = wrt_q ? d_joint_forces_d_q : d_joint_forces_d_u;
+				switch (body.m_joint_type) {
+					case FIXED:
+						break;
+					case REVOLUTE:
+						setDerivativeElem(d_joint_forces, body.m_q_index, q_index,
+										  body.m_Jac_JR.dot(d_moment));
+						break;
+					case PRISMATIC:
+						setDerivativeElem(d_joint_forces, body.m_q_index, q_index,
+										  body.m_Jac_JT.dot(d_force));
+						break;
+					case FLOATING:
+						for (int r = 0; r < 3; r++) {
+							setDerivativeElem(d_joint_forces, body.m_q_index + r, q_index,
+											  d_moment(r));
+							setDerivativeElem(d_joint_forces, body.m_q_index + 3 + r, q_index,
+											  d_force(r));
+						}
+						break;
+				}
+			}
+		}
+	}
+
+#undef setDerivativeElem
+	return 0;
+}
+}
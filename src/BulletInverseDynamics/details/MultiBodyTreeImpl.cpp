@@ -1,5 +1,7 @@
 #include "MultiBodyTreeImpl.hpp"
 
+#include <cmath>
+
 namespace btInverseDynamics {
 
 MultiBodyTree::MultiBodyImpl::MultiBodyImpl(int num_bodies_, int num_dofs_)
@@ -208,16 +210,23 @@ void MultiBodyTree::MultiBodyImpl::calculateStaticData() {
 	}
 }
 
-int MultiBodyTree::MultiBodyImpl::calculateInverseDynamics(const vecx &q, const vecx &u,
-														   const vecx &dot_u, vecx *joint_forces) {
-	if (q.size() != m_num_dofs || u.size() != m_num_dofs || dot_u.size() != m_num_dofs ||
-		joint_forces->size() != m_num_dofs) {
+int MultiBodyTree::MultiBodyImpl::calculateKinematics(const vecx &q, const vecx &u,
+													  const vecx &dot_u,
+													  const KinUpdateType type) {
+	if (q.size() != m_num_dofs || (type != POSITION_ONLY && u.size() != m_num_dofs) ||
+		(type == POSITION_VELOCITY_ACCELERATION && dot_u.size() != m_num_dofs)) {
 		error_message("wrong vector dimension. system has %d DOFs,\n"
-					  "but dim(q)= %d, dim(u)= %d, dim(dot_u)= %d, dim(joint_forces)= %d\n",
+					  "but dim(q)= %d, dim(u)= %d, dim(dot_u)= %d\n",
 					  m_num_dofs, static_cast<int>(q.size()), static_cast<int>(u.size()),
-					  static_cast<int>(dot_u.size()), static_cast<int>(joint_forces->size()));
+					  static_cast<int>(dot_u.size()));
 		return -1;
 	}
+	if (type != POSITION_ONLY && type != POSITION_VELOCITY &&
+		type != POSITION_VELOCITY_ACCELERATION) {
+		error_message("invalid type %d\n", type);
+		return -1;
+	}
+
 	// 1. update relative kinematics
 	// 1.1 for revolute
 	for (idArrayIdx i = 0; i < m_body_revolute_list.size(); i++) {
@@ -225,14 +234,17 @@ int MultiBodyTree::MultiBodyImpl::calculateInverseDynamics(const vecx &q, const
 		mat33 T;
 		bodyTParentFromAxisAngle(body.m_Jac_JR, q(body.m_q_index), &T);
 		body.m_body_T_parent = T * body.m_body_T_parent_ref;
-
-		// body.m_parent_r_parent_body= fixed
-		body.m_body_ang_vel_rel = body.m_Jac_JR * u(body.m_q_index);
-		// body.m_parent_dot_r_rel = fixed;
-		// NOTE: this assumes that Jac_JR is constant, which is true for revolute
-		// joints, but not in the general case (eg, slider-crank type mechanisms)
-		body.m_body_ang_acc_rel = body.m_Jac_JR * dot_u(body.m_q_index);
-		// body.m_parent_ddot_r_rel = fixed;
+		if (type >= POSITION_VELOCITY) {
+			// body.m_parent_r_parent_body= fixed
+			body.m_body_ang_vel_rel = body.m_Jac_JR * u(body.m_q_index);
+		}
+		if (type >= POSITION_VELOCITY_ACCELERATION) {
+			// body.m_parent_dot_r_rel = fixed;
+			// NOTE: this assumes that Jac_JR is constant, which is true for revolute
+			// joints, but not in the general case (eg, slider-crank type mechanisms)
+			body.m_body_ang_acc_rel = body.m_Jac_JR * dot_u(body.m_q_index);
+			// body.m_parent_ddot_r_rel = fixed;
+		}
 	}
 	// 1.2 for prismatic
 	for (idArrayIdx i = 0; i < m_body_prismatic_list.size(); i++) {
@@ -240,13 +252,17 @@ int MultiBodyTree::MultiBodyImpl::calculateInverseDynamics(const vecx &q, const
 		// body.m_body_T_parent= fixed
 		body.m_parent_pos_parent_body =
 			body.m_parent_pos_parent_body_ref + body.m_parent_Jac_JT * q(body.m_q_index);
-		// body.m_parent_omega_rel = 0;
-		body.m_parent_vel_rel =
-			body.m_body_T_parent_ref.transpose() * body.m_Jac_JT * u(body.m_q_index);
-		// body.parent_dot_omega_rel = 0;
-		// NOTE: this assumes that Jac_JT is constant, which is true for
-		// prismatic joints, but not in the general case
-		body.m_parent_acc_rel = body.m_parent_Jac_JT * dot_u(body.m_q_index);
+		if (type >= POSITION_VELOCITY) {
+			// body.m_parent_omega_rel = 0;
+			body.m_parent_vel_rel =
+				body.m_body_T_parent_ref.transpose() * body.m_Jac_JT * u(body.m_q_index);
+		}
+		if (type >= POSITION_VELOCITY_ACCELERATION) {
+			// body.parent_dot_omega_rel = 0;
+			// NOTE: this assumes that Jac_JT is constant, which is true for
+			// prismatic joints, but not in the general case
+			body.m_parent_acc_rel = body.m_parent_Jac_JT * dot_u(body.m_q_index);
+		}
 	}
 	// 1.3 fixed joints: nothing to do
 	// 1.4 6dof joints:
@@ -258,89 +274,118 @@ int MultiBodyTree::MultiBodyImpl::calculateInverseDynamics(const vecx &q, const
 		body.m_parent_pos_parent_body(0) = q(body.m_q_index + 3);
 		body.m_parent_pos_parent_body(1) = q(body.m_q_index + 4);
 		body.m_parent_pos_parent_body(2) = q(body.m_q_index + 5);
+		body.m_parent_pos_parent_body = body.m_body_T_parent * body.m_parent_pos_parent_body;
 
-		body.m_body_ang_vel_rel(0) = u(body.m_q_index + 0);
-		body.m_body_ang_vel_rel(1) = u(body.m_q_index + 1);
-		body.m_body_ang_vel_rel(2) = u(body.m_q_index + 2);
+		if (type >= POSITION_VELOCITY) {
+			body.m_body_ang_vel_rel(0) = u(body.m_q_index + 0);
+			body.m_body_ang_vel_rel(1) = u(body.m_q_index + 1);
+			body.m_body_ang_vel_rel(2) = u(body.m_q_index + 2);
 
-		body.m_parent_vel_rel(0) = u(body.m_q_index + 3);
-		body.m_parent_vel_rel(1) = u(body.m_q_index + 4);
-		body.m_parent_vel_rel(2) = u(body.m_q_index + 5);
+			body.m_parent_vel_rel(0) = u(body.m_q_index + 3);
+			body.m_parent_vel_rel(1) = u(body.m_q_index + 4);
+			body.m_parent_vel_rel(2) = u(body.m_q_index + 5);
 
-		body.m_body_ang_acc_rel(0) = dot_u(body.m_q_index + 0);
-		body.m_body_ang_acc_rel(1) = dot_u(body.m_q_index + 1);
-		body.m_body_ang_acc_rel(2) = dot_u(body.m_q_index + 2);
+			body.m_parent_vel_rel = body.m_body_T_parent.transpose() * body.m_parent_vel_rel;
+		}
+		if (type >= POSITION_VELOCITY_ACCELERATION) {
+			body.m_body_ang_acc_rel(0) = dot_u(body.m_q_index + 0);
+			body.m_body_ang_acc_rel(1) = dot_u(body.m_q_index + 1);
+			body.m_body_ang_acc_rel(2) = dot_u(body.m_q_index + 2);
 
-		body.m_parent_acc_rel(0) = dot_u(body.m_q_index + 3);
-		body.m_parent_acc_rel(1) = dot_u(body.m_q_index + 4);
-		body.m_parent_acc_rel(2) = dot_u(body.m_q_index + 5);
+			body.m_parent_acc_rel(0) = dot_u(body.m_q_index + 3);
+			body.m_parent_acc_rel(1) = dot_u(body.m_q_index + 4);
+			body.m_parent_acc_rel(2) = dot_u(body.m_q_index + 5);
 
-		body.m_parent_pos_parent_body = body.m_body_T_parent * body.m_parent_pos_parent_body;
-		body.m_parent_vel_rel = body.m_body_T_parent.transpose() * body.m_parent_vel_rel;
-		body.m_parent_acc_rel = body.m_body_T_parent.transpose() * body.m_parent_acc_rel;
+			body.m_parent_acc_rel = body.m_body_T_parent.transpose() * body.m_parent_acc_rel;
+		}
 	}
 
-	// 3. absolute kinematic quantities & dynamic quantities
+	// 2. absolute kinematic quantities
 	// NOTE: this should be optimized by specializing for different body types
 	// (e.g., relative rotation is always zero for prismatic joints, etc.)
 
 	// calculations for root body
 	{
 		RigidBody &body = m_body_list[0];
-		// 3.1 update absolute positions and orientations:
+		// 2.1 update absolute positions and orientations:
 		// will be required if we add force elements (eg springs between bodies,
 		// or contacts)
 		// not required right now, added here for debugging purposes
 		body.m_body_pos = body.m_body_T_parent * body.m_parent_pos_parent_body;
 		body.m_body_T_world = body.m_body_T_parent;
 
-		// 3.2 update absolute velocities
-		body.m_body_ang_vel = body.m_body_ang_vel_rel;
-		body.m_body_vel = body.m_parent_vel_rel;
-
-		// 3.3 update absolute accelerations
-		// NOTE: assumption: dot(J_JR) = 0; true here, but not for general joints
-		body.m_body_ang_acc = body.m_body_ang_acc_rel;
-		body.m_body_acc = body.m_body_T_parent * body.m_parent_acc_rel;
-		// add gravitational acceleration to root body
-		// this is an efficient way to add gravitational terms,
-		// but it does mean that the kinematics are no longer
-		// correct at the acceleration level
-		// NOTE: To get correct acceleration kinematics, just set world_gravity to zero
-		body.m_body_acc = body.m_body_acc - body.m_body_T_parent * m_world_gravity;
+		if (type >= POSITION_VELOCITY) {
+			// 2.2 update absolute velocities
+			// (the relative linear velocity is in the parent frame, like for all other bodies)
+			body.m_body_ang_vel = body.m_body_ang_vel_rel;
+			body.m_body_vel = body.m_body_T_parent * body.m_parent_vel_rel;
+		}
+		if (type >= POSITION_VELOCITY_ACCELERATION) {
+			// 2.3 update absolute accelerations
+			// NOTE: assumption: dot(J_JR) = 0; true here, but not for general joints
+			body.m_body_ang_acc = body.m_body_ang_acc_rel;
+			body.m_body_acc = body.m_body_T_parent * body.m_parent_acc_rel;
+			// add gravitational acceleration to root body
+			// this is an efficient way to add gravitational terms,
+			// but it does mean that the kinematics are no longer
+			// correct at the acceleration level
+			// NOTE: To get correct acceleration kinematics, just set world_gravity to zero
+			body.m_body_acc = body.m_body_acc - body.m_body_T_parent * m_world_gravity;
+		}
 	}
 
 	for (idArrayIdx i = 1; i < m_body_list.size(); i++) {
 		RigidBody &body = m_body_list[i];
 		RigidBody &parent = m_body_list[m_parent_index[i]];
-		// 3.1 update absolute positions and orientations:
+		// 2.1 update absolute positions and orientations:
 		// will be required if we add force elements (eg springs between bodies,
 		// or contacts)  not required right now added here for debugging purposes
 		body.m_body_pos =
 			body.m_body_T_parent * (parent.m_body_pos + body.m_parent_pos_parent_body);
 		body.m_body_T_world = body.m_body_T_parent * parent.m_body_T_world;
 
-		// 3.2 update absolute velocities
-		body.m_body_ang_vel =
-			body.m_body_T_parent * parent.m_body_ang_vel + body.m_body_ang_vel_rel;
-
-		body.m_body_vel =
-			body.m_body_T_parent *
-			(parent.m_body_vel + parent.m_body_ang_vel.cross(body.m_parent_pos_parent_body) +
-			 body.m_parent_vel_rel);
-
-		// 3.3 update absolute accelerations
-		// NOTE: assumption: dot(J_JR) = 0; true here, but not for general joints
-		body.m_body_ang_acc =
-			body.m_body_T_parent * parent.m_body_ang_acc -
-			body.m_body_ang_vel_rel.cross(body.m_body_T_parent * parent.m_body_ang_vel) +
-			body.m_body_ang_acc_rel;
-		body.m_body_acc =
-			body.m_body_T_parent *
-			(parent.m_body_acc + parent.m_body_ang_acc.cross(body.m_parent_pos_parent_body) +
-			 parent.m_body_ang_vel.cross(
-				 parent.m_body_ang_vel.cross(body.m_parent_pos_parent_body)) +
-			 2.0 * parent.m_body_ang_vel.cross(body.m_parent_vel_rel) + body.m_parent_acc_rel);
+		if (type >= POSITION_VELOCITY) {
+			// 2.2 update absolute velocities
+			body.m_body_ang_vel =
+				body.m_body_T_parent * parent.m_body_ang_vel + body.m_body_ang_vel_rel;
+
+			body.m_body_vel =
+				body.m_body_T_parent *
+				(parent.m_body_vel + parent.m_body_ang_vel.cross(body.m_parent_pos_parent_body) +
+				 body.m_parent_vel_rel);
+		}
+		if (type >= POSITION_VELOCITY_ACCELERATION) {
+			// 2.3 update absolute accelerations
+			// NOTE: assumption: dot(J_JR) = 0; true here, but not for general joints
+			body.m_body_ang_acc =
+				body.m_body_T_parent * parent.m_body_ang_acc -
+				body.m_body_ang_vel_rel.cross(body.m_body_T_parent * parent.m_body_ang_vel) +
+				body.m_body_ang_acc_rel;
+			body.m_body_acc =
+				body.m_body_T_parent *
+				(parent.m_body_acc + parent.m_body_ang_acc.cross(body.m_parent_pos_parent_body) +
+				 parent.m_body_ang_vel.cross(
+					 parent.m_body_ang_vel.cross(body.m_parent_pos_parent_body)) +
+				 2.0 * parent.m_body_ang_vel.cross(body.m_parent_vel_rel) + body.m_parent_acc_rel);
+		}
+	}
+
+	return 0;
+}
+
+int MultiBodyTree::MultiBodyImpl::calculateInverseDynamics(const vecx &q, const vecx &u,
+														   const vecx &dot_u, vecx *joint_forces) {
+	if (q.size() != m_num_dofs || u.size() != m_num_dofs || dot_u.size() != m_num_dofs ||
+		joint_forces->size() != m_num_dofs) {
+		error_message("wrong vector dimension. system has %d DOFs,\n"
+					  "but dim(q)= %d, dim(u)= %d, dim(dot_u)= %d, dim(joint_forces)= %d\n",
+					  m_num_dofs, static_cast<int>(q.size()), static_cast<int>(u.size()),
+					  static_cast<int>(dot_u.size()), static_cast<int>(joint_forces->size()));
+		return -1;
+	}
+	if (-1 == calculateKinematics(q, u, dot_u, POSITION_VELOCITY_ACCELERATION)) {
+		error_message("error in calculateKinematics\n");
+		return -1;
 	}
 
 	for (idArrayIdx i = 0; i < m_body_list.size(); i++) {
@@ -513,35 +558,10 @@ int MultiBodyTree::MultiBodyImpl::calculateMassMatrix(const vecx &q, const bool
 	}
 
 	if (update_kinematics) {
-		// 1. update relative kinematics
-		// 1.1 for revolute joints
-		for (idArrayIdx i = 0; i < m_body_revolute_list.size(); i++) {
-			RigidBody &body = m_body_list[m_body_revolute_list[i]];
-			// from reference orientation (q=0) of body-fixed frame to current orientation
-			mat33 body_T_body_ref;
-			bodyTParentFromAxisAngle(body.m_Jac_JR, q(body.m_q_index), &body_T_body_ref);
-			body.m_body_T_parent = body_T_body_ref * body.m_body_T_parent_ref;
-		}
-		// 1.2 for prismatic joints
-		for (idArrayIdx i = 0; i < m_body_prismatic_list.size(); i++) {
-			RigidBody &body = m_body_list[m_body_prismatic_list[i]];
-			// body.m_body_T_parent= fixed
-			body.m_parent_pos_parent_body =
-				body.m_parent_pos_parent_body_ref + body.m_parent_Jac_JT * q(body.m_q_index);
-		}
-		// 1.3 fixed joints: nothing to do
-		// 1.4 6dof joints:
-		for (idArrayIdx i = 0; i < m_body_floating_list.size(); i++) {
-			RigidBody &body = m_body_list[m_body_floating_list[i]];
-
-			body.m_body_T_parent = transformZ(q(body.m_q_index + 2)) *
-								   transformY(q(body.m_q_index + 1)) *
-								   transformX(q(body.m_q_index));
-			body.m_parent_pos_parent_body(0) = q(body.m_q_index + 3);
-			body.m_parent_pos_parent_body(1) = q(body.m_q_index + 4);
-			body.m_parent_pos_parent_body(2) = q(body.m_q_index + 5);
-
-			body.m_parent_pos_parent_body = body.m_body_T_parent * body.m_parent_pos_parent_body;
+		// only positions are needed, u and dot_u are ignored
+		if (-1 == calculateKinematics(q, q, q, POSITION_ONLY)) {
+			error_message("error in calculateKinematics\n");
+			return -1;
 		}
 	}
 	for (int i = m_body_list.size() - 1; i >= 0; i--) {
@@ -656,6 +676,394 @@ int MultiBodyTree::MultiBodyImpl::calculateMassMatrix(const vecx &q, const bool
 	return 0;
 }
 
+// a*b^T
+static inline mat33 outerProduct(const vec3 &a, const vec3 &b) {
+	mat33 result;
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			result(i, j) = a(i) * b(j);
+		}
+	}
+	return result;
+}
+
+// Acceleration terms of a body that depend on velocities only, ie, the acceleration
+// of a body with dot_u= 0 and a parent at rest with respect to the world frame
+// (same terms as in the absolute acceleration update of calculateKinematics).
+static inline void velocityProductAcceleration(const RigidBody &body, const RigidBody &parent,
+											   vec3 *c_rot, vec3 *c_trans) {
+	*c_rot = (body.m_body_T_parent * parent.m_body_ang_vel).cross(body.m_body_ang_vel_rel);
+	*c_trans = body.m_body_T_parent *
+			   (parent.m_body_ang_vel.cross(
+					parent.m_body_ang_vel.cross(body.m_parent_pos_parent_body)) +
+				2.0 * parent.m_body_ang_vel.cross(body.m_parent_vel_rel));
+}
+
+// Add a body's articulated inertia to its parent's, ie, transform the spatial inertia
+// [I_rot, I_coupling; I_coupling^T, I_trans] from the body to the parent frame.
+static inline void addArticulatedInertiaToParent(const RigidBody &body, const mat33 &I_rot,
+												 const mat33 &I_coupling, const mat33 &I_trans,
+												 RigidBody *parent) {
+	const mat33 parent_T_body = body.m_body_T_parent.transpose();
+	const mat33 tilde_r = tildeOperator(body.m_parent_pos_parent_body);
+	const mat33 rot = parent_T_body * I_rot * body.m_body_T_parent;
+	const mat33 coupling = parent_T_body * I_coupling * body.m_body_T_parent;
+	const mat33 trans = parent_T_body * I_trans * body.m_body_T_parent;
+	const mat33 coupling_tilde_r = coupling * tilde_r;
+
+	parent->m_aba_I_rot +=
+		rot - coupling_tilde_r - coupling_tilde_r.transpose() - tilde_r * trans * tilde_r;
+	parent->m_aba_I_coupling += coupling + tilde_r * trans;
+	parent->m_aba_I_trans += trans;
+}
+
+// Add a body's articulated bias force to its parent's
+static inline void addBiasForceToParent(const RigidBody &body, const vec3 &moment,
+										const vec3 &force, RigidBody *parent) {
+	const vec3 parent_force = body.m_body_T_parent.transpose() * force;
+	parent->m_aba_bias_force += parent_force;
+	parent->m_aba_bias_moment += body.m_body_T_parent.transpose() * moment +
+								 body.m_parent_pos_parent_body.cross(parent_force);
+}
+
+// Solve [I_rot, I_coupling; I_coupling^T, I_trans]*[x_rot; x_trans] = [b_rot; b_trans]
+// for a positive definite spatial inertia using a Cholesky decomposition.
+// @return 0 on success, -1 if the inertia is not positive definite
+static int solveSpatialInertia(const mat33 &I_rot, const mat33 &I_coupling, const mat33 &I_trans,
+							   const vec3 &b_rot, const vec3 &b_trans, vec3 *x_rot,
+							   vec3 *x_trans) {
+	idScalar L[6][6];
+	idScalar x[6];
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			L[i][j] = I_rot(i, j);
+			L[i + 3][j] = I_coupling(j, i);
+			L[i + 3][j + 3] = I_trans(i, j);
+		}
+		x[i] = b_rot(i);
+		x[i + 3] = b_trans(i);
+	}
+	// lower triangular factor, in place
+	for (int j = 0; j < 6; j++) {
+		idScalar diag = L[j][j];
+		for (int k = 0; k < j; k++) {
+			diag -= L[j][k] * L[j][k];
+		}
+		if (diag <= 0) {
+			return -1;
+		}
+		L[j][j] = std::sqrt(diag);
+		for (int i = j + 1; i < 6; i++) {
+			idScalar sum = L[i][j];
+			for (int k = 0; k < j; k++) {
+				sum -= L[i][k] * L[j][k];
+			}
+			L[i][j] = sum / L[j][j];
+		}
+	}
+	// forward and back substitution
+	for (int i = 0; i < 6; i++) {
+		for (int k = 0; k < i; k++) {
+			x[i] -= L[i][k] * x[k];
+		}
+		x[i] /= L[i][i];
+	}
+	for (int i = 5; i >= 0; i--) {
+		for (int k = i + 1; k < 6; k++) {
+			x[i] -= L[k][i] * x[k];
+		}
+		x[i] /= L[i][i];
+	}
+	for (int i = 0; i < 3; i++) {
+		(*x_rot)(i) = x[i];
+		(*x_trans)(i) = x[i + 3];
+	}
+	return 0;
+}
+
+int MultiBodyTree::MultiBodyImpl::calculateForwardDynamics(const vecx &q, const vecx &u,
+														   const vecx &joint_forces,
+														   vecx *dot_u) {
+	// This is the "articulated body algorithm" (Featherstone, "Rigid Body Dynamics
+	// Algorithms", 2008), with spatial vectors split into rotational and translational parts
+	// and written in body-fixed frames, like the other algorithms in this file.
+	// As in calculateInverseDynamics, gravity is included as an acceleration of the root's
+	// parent, so the resulting absolute accelerations include the gravitational acceleration.
+	if (q.size() != m_num_dofs || u.size() != m_num_dofs || joint_forces.size() != m_num_dofs ||
+		dot_u->size() != m_num_dofs) {
+		error_message("wrong vector dimension. system has %d DOFs,\n"
+					  "but dim(q)= %d, dim(u)= %d, dim(joint_forces)= %d, dim(dot_u)= %d\n",
+					  m_num_dofs, static_cast<int>(q.size()), static_cast<int>(u.size()),
+					  static_cast<int>(joint_forces.size()), static_cast<int>(dot_u->size()));
+		return -1;
+	}
+
+	// 1. positions and velocities
+	if (-1 == calculateKinematics(q, u, u, POSITION_VELOCITY)) {
+		error_message("error in calculateKinematics\n");
+		return -1;
+	}
+
+	// 2. rigid body inertias, bias forces and velocity product accelerations
+	for (idArrayIdx i = 0; i < m_body_list.size(); i++) {
+		RigidBody &body = m_body_list[i];
+		body.m_aba_I_rot = body.m_body_I_body;
+		body.m_aba_I_coupling = tildeOperator(body.m_body_mass_com);
+		setZero(body.m_aba_I_trans);
+		body.m_aba_I_trans(0, 0) = body.m_mass;
+		body.m_aba_I_trans(1, 1) = body.m_mass;
+		body.m_aba_I_trans(2, 2) = body.m_mass;
+
+		body.m_aba_bias_moment =
+			body.m_body_ang_vel.cross(body.m_body_I_body * body.m_body_ang_vel) -
+			body.m_body_moment_user;
+		body.m_aba_bias_force =
+			body.m_body_ang_vel.cross(body.m_body_ang_vel.cross(body.m_body_mass_com)) -
+			body.m_body_force_user;
+
+		if (m_parent_index[i] >= 0) {
+			velocityProductAcceleration(body, m_body_list[m_parent_index[i]], &body.m_aba_c_rot,
+										&body.m_aba_c_trans);
+		} else {
+			setZero(body.m_aba_c_rot);
+			setZero(body.m_aba_c_trans);
+		}
+	}
+
+	// 3. articulated body inertias and bias forces, from the leaves to the root
+	for (int i = m_body_list.size() - 1; i >= 0; i--) {
+		RigidBody &body = m_body_list[i];
+		const int parent_index = m_parent_index[i];
+
+		switch (body.m_joint_type) {
+			case REVOLUTE:
+			case PRISMATIC: {
+				// one of the joint Jacobians is zero
+				body.m_aba_U_rot = body.m_aba_I_rot * body.m_Jac_JR +
+								   body.m_aba_I_coupling * body.m_Jac_JT;
+				body.m_aba_U_trans = body.m_aba_I_coupling.transpose() * body.m_Jac_JR +
+									 body.m_aba_I_trans * body.m_Jac_JT;
+				body.m_aba_D =
+					body.m_Jac_JR.dot(body.m_aba_U_rot) + body.m_Jac_JT.dot(body.m_aba_U_trans);
+				if (body.m_aba_D <= 0) {
+					error_message("articulated inertia of body %d is not positive (%e)\n", i,
+								  body.m_aba_D);
+					return -1;
+				}
+				body.m_aba_u = joint_forces(body.m_q_index) -
+							   body.m_Jac_JR.dot(body.m_aba_bias_moment) -
+							   body.m_Jac_JT.dot(body.m_aba_bias_force);
+				if (parent_index < 0) {
+					break;
+				}
+				const idScalar inv_D = 1.0 / body.m_aba_D;
+				const mat33 I_rot =
+					body.m_aba_I_rot - outerProduct(body.m_aba_U_rot, body.m_aba_U_rot) * inv_D;
+				const mat33 I_coupling =
+					body.m_aba_I_coupling -
+					outerProduct(body.m_aba_U_rot, body.m_aba_U_trans) * inv_D;
+				const mat33 I_trans = body.m_aba_I_trans -
+									  outerProduct(body.m_aba_U_trans, body.m_aba_U_trans) * inv_D;
+				const idScalar u_D = body.m_aba_u * inv_D;
+				const vec3 moment = body.m_aba_bias_moment + I_rot * body.m_aba_c_rot +
+									I_coupling * body.m_aba_c_trans + body.m_aba_U_rot * u_D;
+				const vec3 force = body.m_aba_bias_force +
+								   I_coupling.transpose() * body.m_aba_c_rot +
+								   I_trans * body.m_aba_c_trans + body.m_aba_U_trans * u_D;
+				addArticulatedInertiaToParent(body, I_rot, I_coupling, I_trans,
+											  &m_body_list[parent_index]);
+				addBiasForceToParent(body, moment, force, &m_body_list[parent_index]);
+			} break;
+			case FIXED:
+				if (parent_index >= 0) {
+					const vec3 moment = body.m_aba_bias_moment +
+										body.m_aba_I_rot * body.m_aba_c_rot +
+										body.m_aba_I_coupling * body.m_aba_c_trans;
+					const vec3 force = body.m_aba_bias_force +
+									   body.m_aba_I_coupling.transpose() * body.m_aba_c_rot +
+									   body.m_aba_I_trans * body.m_aba_c_trans;
+					addArticulatedInertiaToParent(body, body.m_aba_I_rot, body.m_aba_I_coupling,
+												  body.m_aba_I_trans, &m_body_list[parent_index]);
+					addBiasForceToParent(body, moment, force, &m_body_list[parent_index]);
+				}
+				break;
+			case FLOATING:
+				// the articulated inertia transmitted through a 6-DoF joint is zero, and the
+				// bias force is the joint force
+				if (parent_index >= 0) {
+					vec3 moment;
+					vec3 force;
+					for (int k = 0; k < 3; k++) {
+						moment(k) = joint_forces(body.m_q_index + k);
+						force(k) = joint_forces(body.m_q_index + 3 + k);
+					}
+					addBiasForceToParent(body, moment, force, &m_body_list[parent_index]);
+				}
+				break;
+			default:
+				error_message("unsupported joint type %d\n", body.m_joint_type);
+				return -1;
+		}
+	}
+
+	// 4. accelerations, from the root to the leaves
+	for (idArrayIdx i = 0; i < m_body_list.size(); i++) {
+		RigidBody &body = m_body_list[i];
+		const int parent_index = m_parent_index[i];
+		// acceleration without contribution from this body's joint
+		vec3 ang_acc;
+		vec3 acc;
+		if (parent_index >= 0) {
+			const RigidBody &parent = m_body_list[parent_index];
+			ang_acc = body.m_body_T_parent * parent.m_body_ang_acc + body.m_aba_c_rot;
+			acc = body.m_body_T_parent *
+					  (parent.m_body_acc +
+					   parent.m_body_ang_acc.cross(body.m_parent_pos_parent_body)) +
+				  body.m_aba_c_trans;
+		} else {
+			// gravity, see calculateKinematics
+			setZero(ang_acc);
+			setZero(acc);
+			acc -= body.m_body_T_parent * m_world_gravity;
+		}
+
+		switch (body.m_joint_type) {
+			case REVOLUTE: {
+				const idScalar ddot_q = (body.m_aba_u - body.m_aba_U_rot.dot(ang_acc) -
+										 body.m_aba_U_trans.dot(acc)) /
+										body.m_aba_D;
+				(*dot_u)(body.m_q_index) = ddot_q;
+				body.m_body_ang_acc_rel = body.m_Jac_JR * ddot_q;
+				body.m_body_ang_acc = ang_acc + body.m_body_ang_acc_rel;
+				body.m_body_acc = acc;
+			} break;
+			case PRISMATIC: {
+				const idScalar ddot_q = (body.m_aba_u - body.m_aba_U_rot.dot(ang_acc) -
+										 body.m_aba_U_trans.dot(acc)) /
+										body.m_aba_D;
+				(*dot_u)(body.m_q_index) = ddot_q;
+				body.m_parent_acc_rel = body.m_parent_Jac_JT * ddot_q;
+				body.m_body_ang_acc = ang_acc;
+				body.m_body_acc = acc + body.m_Jac_JT * ddot_q;
+			} break;
+			case FIXED:
+				body.m_body_ang_acc = ang_acc;
+				body.m_body_acc = acc;
+				break;
+			case FLOATING: {
+				vec3 moment;
+				vec3 force;
+				for (int k = 0; k < 3; k++) {
+					moment(k) = joint_forces(body.m_q_index + k);
+					force(k) = joint_forces(body.m_q_index + 3 + k);
+				}
+				if (-1 == solveSpatialInertia(body.m_aba_I_rot, body.m_aba_I_coupling,
+											  body.m_aba_I_trans, moment - body.m_aba_bias_moment,
+											  force - body.m_aba_bias_force, &body.m_body_ang_acc,
+											  &body.m_body_acc)) {
+					error_message("articulated inertia of body %d is not positive definite\n",
+								  static_cast<int>(i));
+					return -1;
+				}
+				body.m_body_ang_acc_rel = body.m_body_ang_acc - ang_acc;
+				const vec3 acc_rel = body.m_body_acc - acc;
+				for (int k = 0; k < 3; k++) {
+					(*dot_u)(body.m_q_index + k) = body.m_body_ang_acc_rel(k);
+					(*dot_u)(body.m_q_index + 3 + k) = acc_rel(k);
+				}
+				body.m_parent_acc_rel = body.m_body_T_parent.transpose() * acc_rel;
+			} break;
+			default:
+				error_message("unsupported joint type %d\n", body.m_joint_type);
+				return -1;
+		}
+	}
+
+	return 0;
+}
+
+int MultiBodyTree::MultiBodyImpl::calculateJacobians(const vecx &q, const vecx &u,
+													 const KinUpdateType type) {
+	if (type != POSITION_ONLY && type != POSITION_VELOCITY) {
+		error_message("invalid update type %d\n", type);
+		return -1;
+	}
+	if (-1 == calculateKinematics(q, u, u, type)) {
+		error_message("error in calculateKinematics\n");
+		return -1;
+	}
+
+	m_body_Jac_R.resize(m_num_bodies * m_num_dofs);
+	m_body_Jac_T.resize(m_num_bodies * m_num_dofs);
+
+	for (idArrayIdx i = 0; i < m_body_list.size(); i++) {
+		RigidBody &body = m_body_list[i];
+		const int parent_index = m_parent_index[i];
+		const int offset = i * m_num_dofs;
+
+		// 1. columns of the parent's Jacobians, moved to this body
+		if (parent_index >= 0) {
+			const int parent_offset = parent_index * m_num_dofs;
+			for (int j = 0; j < m_num_dofs; j++) {
+				const vec3 &parent_Jac_R = m_body_Jac_R[parent_offset + j];
+				m_body_Jac_R[offset + j] = body.m_body_T_parent * parent_Jac_R;
+				m_body_Jac_T[offset + j] =
+					body.m_body_T_parent *
+					(m_body_Jac_T[parent_offset + j] +
+					 parent_Jac_R.cross(body.m_parent_pos_parent_body));
+			}
+		} else {
+			for (int j = 0; j < m_num_dofs; j++) {
+				setZero(m_body_Jac_R[offset + j]);
+				setZero(m_body_Jac_T[offset + j]);
+			}
+		}
+
+		// 2. columns for this body's joint
+		switch (body.m_joint_type) {
+			case REVOLUTE:
+				m_body_Jac_R[offset + body.m_q_index] += body.m_Jac_JR;
+				break;
+			case PRISMATIC:
+				m_body_Jac_T[offset + body.m_q_index] += body.m_Jac_JT;
+				break;
+			case FIXED:
+				break;
+			case FLOATING:
+				// relative velocities are given in the body-fixed frame
+				for (int k = 0; k < 3; k++) {
+					m_body_Jac_R[offset + body.m_q_index + k](k) += 1.0;
+					m_body_Jac_T[offset + body.m_q_index + 3 + k](k) += 1.0;
+				}
+				break;
+			default:
+				error_message("unsupported joint type %d\n", body.m_joint_type);
+				return -1;
+		}
+
+		// 3. dot(Jacobian)*u
+		if (POSITION_VELOCITY == type) {
+			if (parent_index >= 0) {
+				const RigidBody &parent = m_body_list[parent_index];
+				vec3 c_rot;
+				vec3 c_trans;
+				velocityProductAcceleration(body, parent, &c_rot, &c_trans);
+				body.m_body_dot_Jac_R_u = body.m_body_T_parent * parent.m_body_dot_Jac_R_u + c_rot;
+				body.m_body_dot_Jac_T_u =
+					body.m_body_T_parent *
+						(parent.m_body_dot_Jac_T_u +
+						 parent.m_body_dot_Jac_R_u.cross(body.m_parent_pos_parent_body)) +
+					c_trans;
+			} else {
+				setZero(body.m_body_dot_Jac_R_u);
+				setZero(body.m_body_dot_Jac_T_u);
+			}
+		}
+	}
+
+	return 0;
+}
+
 // utility macro
 #define CHECK_IF_BODY_INDEX_IS_VALID(index)														\
 	do {																						   \
@@ -766,6 +1174,65 @@ int MultiBodyTree::MultiBodyImpl::getBodyLinearAcceleration(int body_index,
 	return 0;
 }
 
+int MultiBodyTree::MultiBodyImpl::getBodyJacobianRot(const int body_index,
+													 matxx *world_jac_rot) const {
+	CHECK_IF_BODY_INDEX_IS_VALID(body_index);
+	return getWorldJacobian(body_index, m_body_Jac_R, world_jac_rot);
+}
+
+int MultiBodyTree::MultiBodyImpl::getBodyJacobianTrans(const int body_index,
+													   matxx *world_jac_trans) const {
+	CHECK_IF_BODY_INDEX_IS_VALID(body_index);
+	return getWorldJacobian(body_index, m_body_Jac_T, world_jac_trans);
+}
+
+int MultiBodyTree::MultiBodyImpl::getBodyDotJacobianRotU(const int body_index,
+														 vec3 *world_dot_jac_rot_u) const {
+	CHECK_IF_BODY_INDEX_IS_VALID(body_index);
+	const RigidBody &body = m_body_list[body_index];
+	*world_dot_jac_rot_u = body.m_body_T_world.transpose() * body.m_body_dot_Jac_R_u;
+	return 0;
+}
+
+int MultiBodyTree::MultiBodyImpl::getBodyDotJacobianTransU(const int body_index,
+														   vec3 *world_dot_jac_trans_u) const {
+	CHECK_IF_BODY_INDEX_IS_VALID(body_index);
+	const RigidBody &body = m_body_list[body_index];
+	*world_dot_jac_trans_u = body.m_body_T_world.transpose() * body.m_body_dot_Jac_T_u;
+	return 0;
+}
+
+int MultiBodyTree::MultiBodyImpl::getWorldJacobian(const int body_index,
+												   const idArray<vec3>::type &body_jac,
+												   matxx *world_jac) const {
+#ifdef ID_LINEAR_MATH_USE_BULLET
+#define setJacobianElem(row, col, val) world_jac->setElem(row, col, val)
+#else
+#define setJacobianElem(row, col, val) (*world_jac)(row, col) = val
+#endif
+	if (world_jac->rows() != 3 || world_jac->cols() != m_num_dofs) {
+		error_message("Dimension error. System has %d DOFs,\n"
+					  "but dim(jacobian)= %d x %d (should be 3 x %d)\n",
+					  m_num_dofs, static_cast<int>(world_jac->rows()),
+					  static_cast<int>(world_jac->cols()), m_num_dofs);
+		return -1;
+	}
+	if (body_jac.size() != m_num_bodies * m_num_dofs) {
+		error_message("Jacobians have not been calculated, call calculateJacobians first\n");
+		return -1;
+	}
+	const RigidBody &body = m_body_list[body_index];
+	const mat33 world_T_body = body.m_body_T_world.transpose();
+	for (int col = 0; col < m_num_dofs; col++) {
+		const vec3 world_col = world_T_body * body_jac[body_index * m_num_dofs + col];
+		setJacobianElem(0, col, world_col(0));
+		setJacobianElem(1, col, world_col(1));
+		setJacobianElem(2, col, world_col(2));
+	}
+#undef setJacobianElem
+	return 0;
+}
+
 int MultiBodyTree::MultiBodyImpl::getJointType(const int body_index, JointType *joint_type) const {
 	CHECK_IF_BODY_INDEX_IS_VALID(body_index);
 	*joint_type = m_body_list[body_index].m_joint_type;
@@ -110,6 +110,38 @@ struct RigidBody {
 	vec3 m_body_subtree_mass_com;
 	/// moment of inertia of subtree rooted in this body, w.r.t. body origin, in body-fixed frame
 	mat33 m_body_subtree_I_body;
+
+	// 7 Scratch data for forward dynamics using the "articulated body algorithm".
+	// Spatial quantities are split into rotational and translational parts, refer to
+	// the body-fixed frame's origin and are written in the body-fixed frame.
+	/// articulated body inertia, rotational block (moment of inertia)
+	mat33 m_aba_I_rot;
+	/// articulated body inertia, coupling block (first mass moment)
+	mat33 m_aba_I_coupling;
+	/// articulated body inertia, translational block (mass)
+	mat33 m_aba_I_trans;
+	/// articulated body bias force, moment part
+	vec3 m_aba_bias_moment;
+	/// articulated body bias force, force part
+	vec3 m_aba_bias_force;
+	/// velocity product acceleration, angular part
+	vec3 m_aba_c_rot;
+	/// velocity product acceleration, linear part
+	vec3 m_aba_c_trans;
+	/// articulated inertia times joint axis (1-DoF joints), rotational part
+	vec3 m_aba_U_rot;
+	/// articulated inertia times joint axis (1-DoF joints), translational part
+	vec3 m_aba_U_trans;
+	/// joint space articulated inertia (1-DoF joints)
+	idScalar m_aba_D;
+	/// joint force minus bias force projected on the joint axis (1-DoF joints)
+	idScalar m_aba_u;
+
+	// 8 Jacobian derivative times generalized velocities, see calculateJacobians
+	/// dot(J_R)*u, ie, angular acceleration for dot_u=0 and no gravity, in body-fixed frame
+	vec3 m_body_dot_Jac_R_u;
+	/// dot(J_T)*u, ie, linear acceleration for dot_u=0 and no gravity, in body-fixed frame
+	vec3 m_body_dot_Jac_T_u;
 };
 
 /// The MBS implements a tree structured multibody system
@@ -119,6 +151,13 @@ class MultiBodyTree::MultiBodyImpl {
 public:
 	ID_DECLARE_ALIGNED_ALLOCATOR();
 
+	/// which kinematic quantities calculateKinematics and calculateJacobians update
+	enum KinUpdateType {
+		POSITION_ONLY,
+		POSITION_VELOCITY,
+		POSITION_VELOCITY_ACCELERATION
+	};
+
 	/// constructor
 	/// @param num_bodies the number of bodies in the system
 	/// @param num_dofs number of degrees of freedom in the system
@@ -131,6 +170,20 @@ public:
 	int calculateMassMatrix(const vecx& q, const bool update_kinematics,
 							const bool initialize_matrix, const bool set_lower_triangular_matrix,
 							matxx* mass_matrix);
+	/// \copydoc MultiBodyTree::calculateForwardDynamics
+	int calculateForwardDynamics(const vecx& q, const vecx& u, const vecx& joint_forces,
+								 vecx* dot_u);
+	/// \copydoc MultiBodyTree::calculateJacobians(const vecx&, const vecx&)
+	int calculateJacobians(const vecx& q, const vecx& u, const KinUpdateType type);
+	/// \copydoc MultiBodyTree::calculateInverseDynamicsDerivatives
+	int calculateInverseDynamicsDerivatives(const vecx& q, const vecx& u, const vecx& dot_u,
+											vecx* joint_forces, matxx* d_joint_forces_d_q,
+											matxx* d_joint_forces_d_u);
+	/// \copydoc MultiBodyTree::calculateInverseDynamicsBatch
+	int calculateInverseDynamicsBatch(const matxx& q, const matxx& u, const matxx& dot_u,
+									  matxx* joint_forces, const bool use_float);
+	/// \copydoc MultiBodyTree::calculateMassMatrixBatch
+	int calculateMassMatrixBatch(const matxx& q, matxx* mass_matrices, const bool use_float);
 	/// generate additional index sets from the parent_index array
 	/// @return -1 on error, 0 on success
 	int generateIndexSets();
@@ -170,6 +223,14 @@ public:
 	int getBodyAngularAcceleration(const int body_index, vec3* world_dot_omega) const;
 	/// \copydoc MultiBodyTree::getBodyLinearAcceleration
 	int getBodyLinearAcceleration(const int body_index, vec3* world_acceleration) const;
+	/// \copydoc MultiBodyTree::getBodyJacobianRot
+	int getBodyJacobianRot(const int body_index, matxx* world_jac_rot) const;
+	/// \copydoc MultiBodyTree::getBodyJacobianTrans
+	int getBodyJacobianTrans(const int body_index, matxx* world_jac_trans) const;
+	/// \copydoc MultiBodyTree::getBodyDotJacobianRotU
+	int getBodyDotJacobianRotU(const int body_index, vec3* world_dot_jac_rot_u) const;
+	/// \copydoc MultiBodyTree::getBodyDotJacobianTransU
+	int getBodyDotJacobianTransU(const int body_index, vec3* world_dot_jac_trans_u) const;
 	/// \copydoc MultiBodyTree::getUserInt
 	int getUserInt(const int body_index, int* user_int) const;
 	/// \copydoc MultiBodyTree::getUserPtr
@@ -198,6 +259,18 @@ public:
 	int addUserMoment(const int body_index, const vec3& body_moment);
 
 private:
+	// update relative and absolute positions and, depending on type,
+	// velocities and accelerations of all bodies.
+	// u is only used for POSITION_VELOCITY and up, dot_u only for
+	// POSITION_VELOCITY_ACCELERATION.
+	// @return 0 on success, -1 on error
+	int calculateKinematics(const vecx& q, const vecx& u, const vecx& dot_u,
+							const KinUpdateType type);
+	// transform a body's Jacobian columns in body_jac to the world frame and store them in
+	// world_jac
+	// @return 0 on success, -1 on error
+	int getWorldJacobian(const int body_index, const idArray<vec3>::type& body_jac,
+						 matxx* world_jac) const;
 	// debug function. print tree structure to stdout
 	void printTree(int index, int indentation);
 	// get string representation of JointType (for debugging)
@@ -231,6 +304,10 @@ private:
 	idArray<int>::type m_user_int;
 	// a user-provided pointer
 	idArray<void*>::type m_user_ptr;
+	// columns of the rotational and translational Jacobians of all bodies,
+	// in body-fixed frame. Column j of body i is at index i*m_num_dofs+j
+	idArray<vec3>::type m_body_Jac_R;
+	idArray<vec3>::type m_body_Jac_T;
 };
 }
 #endif
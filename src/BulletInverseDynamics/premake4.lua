@@ -9,4 +9,6 @@
 		"MultiBodyTree.cpp",
 		"details/MultiBodyTreeInitCache.cpp",
 		"details/MultiBodyTreeImpl.cpp",
+		"details/MultiBodyTreeBatch.cpp",
+		"details/MultiBodyTreeDerivatives.cpp",
 	}
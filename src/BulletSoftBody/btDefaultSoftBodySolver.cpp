@@ -20,6 +20,80 @@ subject to the following restrictions:
 #include "btDefaultSoftBodySolver.h"
 #include "BulletCollision/CollisionShapes/btCapsuleShape.h"
 #include "BulletSoftBody/btSoftBody.h"
+#include "LinearMath/btThreads.h"
+
+
+struct btSoftBodyPredictMotionLoop : public btIParallelForBody
+{
+	btSoftBody** m_softBodies;
+	btScalar m_timeStep;
+
+	btSoftBodyPredictMotionLoop( btSoftBody** softBodies, btScalar timeStep )
+		:m_softBodies(softBodies), m_timeStep(timeStep)
+	{
+	}
+	void forLoop( int iBegin, int iEnd ) const
+	{
+		for ( int i = iBegin; i < iEnd; ++i )
+		{
+			m_softBodies[i]->predictMotion( m_timeStep );
+		}
+	}
+};
+
+struct btSoftBodySolveConstraintsLoop : public btIParallelForBody
+{
+	btSoftBody** m_softBodies;
+
+	btSoftBodySolveConstraintsLoop( btSoftBody** softBodies )
+		:m_softBodies(softBodies)
+	{
+	}
+	void forLoop( int iBegin, int iEnd ) const
+	{
+		for ( int i = iBegin; i < iEnd; ++i )
+		{
+			m_softBodies[i]->solveConstraints();
+		}
+	}
+};
+
+struct btSoftBodyIntegrateMotionLoop : public btIParallelForBody
+{
+	btSoftBody** m_softBodies;
+
+	btSoftBodyIntegrateMotionLoop( btSoftBody** softBodies )
+		:m_softBodies(softBodies)
+	{
+	}
+	void forLoop( int iBegin, int iEnd ) const
+	{
+		for ( int i = iBegin; i < iEnd; ++i )
+		{
+			m_softBodies[i]->integrateMotion();
+		}
+	}
+};
+
+// A soft body is coupled to others if its solver writes to objects it doesn't own:
+// dynamic rigid bodies through anchors and rigid contacts, or the faces of other soft bodies through soft contacts
+static bool btIsCoupledSoftBody( const btSoftBody* psb )
+{
+	if ( psb->m_scontacts.size() )
+		return true;
+	for ( int i = 0; i < psb->m_anchors.size(); ++i )
+	{
+		if ( !psb->m_anchors[i].m_body->isStaticOrKinematicObject() )
+			return true;
+	}
+	for ( int i = 0; i < psb->m_rcontacts.size(); ++i )
+	{
+		const btCollisionObject* colObj = psb->m_rcontacts[i].m_cti.m_colObj;
+		if ( btRigidBody::upcast( colObj ) && !colObj->isStaticOrKinematicObject() )
+			return true;
+	}
+	return false;
+}
 
 
 btDefaultSoftBodySolver::btDefaultSoftBodySolver()
@@ -28,6 +102,7 @@ btDefaultSoftBodySolver::btDefaultSoftBodySolver()
 	// For now this is global for the cloths linked with this solver - we should probably make this body specific 
 	// for performance in future once we understand more clearly when constants need to be updated
 	m_updateSolverConstants = true;
+	m_multithreaded = false;
 }
 
 btDefaultSoftBodySolver::~btDefaultSoftBodySolver()
@@ -47,6 +122,23 @@ void btDefaultSoftBodySolver::optimize( btAlignedObjectArray< btSoftBody * > &so
 
 void btDefaultSoftBodySolver::updateSoftBodies( )
 {
+	if ( m_multithreaded )
+	{
+		m_independentBodies.resize(0);
+		for ( int i=0; i < m_softBodySet.size(); i++)
+		{
+			if (m_softBodySet[i]->isActive())
+			{
+				m_independentBodies.push_back( m_softBodySet[i] );
+			}
+		}
+		if ( m_independentBodies.size() )
+		{
+			btParallelFor( 0, m_independentBodies.size(), 1, btSoftBodyIntegrateMotionLoop( &m_independentBodies[0] ) );
+		}
+		return;
+	}
+
 	for ( int i=0; i < m_softBodySet.size(); i++)
 	{
 		btSoftBody*	psb=(btSoftBody*)m_softBodySet[i];
@@ -64,12 +156,49 @@ bool btDefaultSoftBodySolver::checkInitialized()
 
 void btDefaultSoftBodySolver::solveConstraints( float solverdt )
 {
+	if ( m_multithreaded )
+	{
+		m_independentBodies.resize(0);
+		m_coupledBodies.resize(0);
+		for(int i=0; i < m_softBodySet.size(); ++i)
+		{
+			btSoftBody*	psb = m_softBodySet[i];
+			if (psb->isActive())
+			{
+				if (!psb->hasLinkBatches())
+				{
+					psb->generateLinkBatches();
+				}
+				psb->m_bParallelLinkBatches = true;
+				if (btIsCoupledSoftBody(psb))
+				{
+					m_coupledBodies.push_back(psb);
+				} else
+				{
+					m_independentBodies.push_back(psb);
+				}
+			}
+		}
+		// Independent bodies run in parallel, their link batches then run inline on each thread
+		if ( m_independentBodies.size() )
+		{
+			btParallelFor( 0, m_independentBodies.size(), 1, btSoftBodySolveConstraintsLoop( &m_independentBodies[0] ) );
+		}
+		// Coupled bodies run one at a time, with their link batches spread over the threads
+		for(int i=0; i < m_coupledBodies.size(); ++i)
+		{
+			m_coupledBodies[i]->solveConstraints();
+		}
+		return;
+	}
+
 	// Solve constraints for non-solver softbodies
 	for(int i=0; i < m_softBodySet.size(); ++i)
 	{
 		btSoftBody*	psb = static_cast<btSoftBody*>(m_softBodySet[i]);
 		if (psb->isActive())
 		{
+			psb->m_bParallelLinkBatches = false;
 			psb->solveConstraints();
 		}
 	}	
@@ -138,6 +267,32 @@ void btDefaultSoftBodySolver::processCollision( btSoftBody *softBody, const btCo
 
 void btDefaultSoftBodySolver::predictMotion( float timeStep )
 {
+	if ( m_multithreaded )
+	{
+		m_independentBodies.resize(0);
+		for ( int i=0; i < m_softBodySet.size(); ++i)
+		{
+			btSoftBody*	psb = m_softBodySet[i];
+			if (psb->isActive())
+			{
+				// The broadphase is not thread safe, bounds are pushed in body order once all bodies moved
+				psb->m_bDeferAabb = true;
+				m_independentBodies.push_back(psb);
+			}
+		}
+		if ( m_independentBodies.size() )
+		{
+			btParallelFor( 0, m_independentBodies.size(), 1, btSoftBodyPredictMotionLoop( &m_independentBodies[0], timeStep ) );
+		}
+		for ( int i=0; i < m_independentBodies.size(); ++i)
+		{
+			btSoftBody*	psb = m_independentBodies[i];
+			psb->m_bDeferAabb = false;
+			psb->updateBroadphaseAabb();
+		}
+		return;
+	}
+
 	for ( int i=0; i < m_softBodySet.size(); ++i)
 	{
 		btSoftBody*	psb = m_softBodySet[i];
@@ -29,6 +29,11 @@ protected:
 
 	btAlignedObjectArray< btSoftBody * > m_softBodySet;
 
+	bool m_multithreaded;
+
+	/** Active soft bodies that are solved in parallel, and the ones that share rigid or soft bodies and are solved one after the other */
+	btAlignedObjectArray< btSoftBody * > m_independentBodies;
+	btAlignedObjectArray< btSoftBody * > m_coupledBodies;
 
 public:
 	btDefaultSoftBodySolver();
@@ -58,6 +63,19 @@ public:
 
 	virtual void processCollision( btSoftBody*, btSoftBody* );
 
+	/** With multithreading enabled the soft bodies are distributed over btParallelFor,
+	 *  and the links of each body are solved in batches of links that share no node (see btSoftBody::generateLinkBatches).
+	 *  Bodies anchored to or touching dynamic rigid bodies, and bodies with soft-soft contacts, are solved one at a time. */
+	void setMultithreaded( bool multithreaded )
+	{
+		m_multithreaded = multithreaded;
+	}
+
+	bool isMultithreaded() const
+	{
+		return m_multithreaded;
+	}
+
 };
 
 #endif // #ifndef BT_ACCELERATED_SOFT_BODY_CPU_SOLVER_H
@@ -18,6 +18,7 @@ subject to the following restrictions:
 #include "BulletSoftBody/btSoftBodySolvers.h"
 #include "btSoftBodyData.h"
 #include "LinearMath/btSerializer.h"
+#include "LinearMath/btThreads.h"
 
 
 //
@@ -97,6 +98,15 @@ void	btSoftBody::initDefaults()
 	m_tag				=	0;
 	m_timeacc			=	0;
 	m_bUpdateRtCst		=	true;
+	m_bDeferAabb		=	false;
+	m_bParallelLinkBatches	=	false;
+	m_bPackNodes		=	false;
+	m_nodeRevision		=	0;
+	m_packedRevision	=	-1;
+	m_bRefitTrees		=	false;
+	m_treeRebuildRatio	=	2;
+	m_treeCost[0]		=	-1;
+	m_treeCost[1]		=	-1;
 	m_bounds[0]			=	btVector3(0,0,0);
 	m_bounds[1]			=	btVector3(0,0,0);
 	m_worldTransform.setIdentity();
@@ -254,6 +264,7 @@ void			btSoftBody::appendNode(	const btVector3& x,btScalar m)
 	n.m_im			=	m>0?1/m:0;
 	n.m_material	=	m_materials[0];
 	n.m_leaf		=	m_ndbvt.insert(btDbvtVolume::FromCR(n.m_x,margin),&n);
+	nodesChanged();
 }
 
 //
@@ -265,6 +276,8 @@ void			btSoftBody::appendLink(int model,Material* mat)
 	else
 	{ ZeroInitialize(l);l.m_material=mat?mat:m_materials[0]; }
 	m_links.push_back(l);
+	m_linkBatches.resize(0);
+	nodesChanged();
 }
 
 //
@@ -673,6 +686,7 @@ void			btSoftBody::setMass(int node,btScalar mass)
 {
 	m_nodes[node].m_im=mass>0?1/mass:0;
 	m_bUpdateRtCst=true;
+	nodesChanged();
 }
 
 //
@@ -727,6 +741,7 @@ void			btSoftBody::setTotalMass(btScalar mass,bool fromfaces)
 		m_nodes[i].m_im/=itm*mass;
 	}
 	m_bUpdateRtCst=true;
+	nodesChanged();
 }
 
 //
@@ -856,6 +871,7 @@ void btSoftBody::setRestLengthScale(btScalar restLengthScale)
 		l.m_c1	=	l.m_rl*l.m_rl;
 	}
 	m_restLengthScale = restLengthScale;
+	nodesChanged();
 	
 	if (getActivationState() == ISLAND_SLEEPING)
 		activate();
@@ -920,6 +936,7 @@ void				btSoftBody::resetLinkRestLengths()
 		l.m_rl	=	(l.m_n[0]->m_x-l.m_n[1]->m_x).length();
 		l.m_c1	=	l.m_rl*l.m_rl;
 	}
+	nodesChanged();
 }
 
 //
@@ -1170,6 +1187,58 @@ void			btSoftBody::randomizeConstraints()
 		btSwap(m_faces[i],m_faces[NEXTRAND%ni]);
 	}
 #undef NEXTRAND
+	m_linkBatches.resize(0);
+	nodesChanged();
+}
+
+//
+int				btSoftBody::generateLinkBatches()
+{
+	const int		nlinks=m_links.size();
+	btAlignedObjectArray<int>	batch;
+	btAlignedObjectArray<int>	stamps;
+	btAlignedObjectArray<int>	pending;
+	int i,ni,nbatches=0;
+
+	batch.resize(nlinks,-1);
+	stamps.resize(m_nodes.size(),-1);
+	pending.resize(nlinks);
+	for(i=0;i<nlinks;++i) pending[i]=i;
+	/* Greedy coloring, each pass takes every remaining link whose nodes are still free	*/ 
+	while(pending.size()>0)
+	{
+		int	nleft=0;
+		for(i=0,ni=pending.size();i<ni;++i)
+		{
+			const Link&	l=m_links[pending[i]];
+			const int	ia=int(l.m_n[0]-&m_nodes[0]);
+			const int	ib=int(l.m_n[1]-&m_nodes[0]);
+			if((stamps[ia]!=nbatches)&&(stamps[ib]!=nbatches))
+			{
+				stamps[ia]=stamps[ib]=nbatches;
+				batch[pending[i]]=nbatches;
+			}
+			else
+			{
+				pending[nleft++]=pending[i];
+			}
+		}
+		pending.resize(nleft);
+		++nbatches;
+	}
+	/* Reorder links by batch, keeping the original order inside a batch	*/ 
+	m_linkBatches.resize(0);
+	m_linkBatches.resize(nbatches+1,0);
+	for(i=0;i<nlinks;++i) ++m_linkBatches[batch[i]+1];
+	for(i=0;i<nbatches;++i) m_linkBatches[i+1]+=m_linkBatches[i];
+	btAlignedObjectArray<int>	offsets;
+	offsets.copyFromArray(m_linkBatches);
+	tLinkArray	links;
+	links.resize(nlinks);
+	for(i=0;i<nlinks;++i) links[offsets[batch[i]]++]=m_links[i];
+	m_links.copyFromArray(links);
+	nodesChanged();
+	return(nbatches);
 }
 
 //
@@ -1630,6 +1699,7 @@ void			btSoftBody::refine(ImplicitFn* ifn,btScalar accurary,bool cut)
 #endif
 	}
 	m_bUpdateRtCst=true;
+	nodesChanged();
 }
 
 //
@@ -1745,6 +1815,9 @@ void			btSoftBody::predictMotion(btScalar dt)
 	if(m_bUpdateRtCst)
 	{
 		m_bUpdateRtCst=false;
+		m_linkBatches.resize(0);
+		nodesChanged();
+		m_treeCost[0]=m_treeCost[1]=-1;
 		updateConstants();
 		m_fdbvt.clear();
 		if(m_cfg.collisions&fCollision::VF_SS)
@@ -1793,18 +1866,36 @@ void			btSoftBody::predictMotion(btScalar dt)
 	updateBounds();	
 	/* Nodes				*/ 
 	ATTRIBUTE_ALIGNED16(btDbvtVolume)	vol;
-	for(i=0,ni=m_nodes.size();i<ni;++i)
+	if(m_bRefitTrees)
 	{
-		Node&	n=m_nodes[i];
-		vol = btDbvtVolume::FromCR(n.m_x,m_sst.radmrg);
-		m_ndbvt.update(	n.m_leaf,
-			vol,
-			n.m_v*m_sst.velmrg,
-			m_sst.updmrg);
+		bool	moved=false;
+		for(i=0,ni=m_nodes.size();i<ni;++i)
+		{
+			Node&	n=m_nodes[i];
+			vol = btDbvtVolume::FromCR(n.m_x,m_sst.radmrg);
+			moved |= m_ndbvt.refitLeaf(	n.m_leaf,
+				vol,
+				n.m_v*m_sst.velmrg,
+				m_sst.updmrg);
+		}
+		if(moved) refitTree(m_ndbvt,m_treeCost[0]);
+	}
+	else
+	{
+		for(i=0,ni=m_nodes.size();i<ni;++i)
+		{
+			Node&	n=m_nodes[i];
+			vol = btDbvtVolume::FromCR(n.m_x,m_sst.radmrg);
+			m_ndbvt.update(	n.m_leaf,
+				vol,
+				n.m_v*m_sst.velmrg,
+				m_sst.updmrg);
+		}
 	}
 	/* Faces				*/ 
 	if(!m_fdbvt.empty())
 	{
+		bool	moved=false;
 		for(int i=0;i<m_faces.size();++i)
 		{
 			Face&			f=m_faces[i];
@@ -1812,11 +1903,22 @@ void			btSoftBody::predictMotion(btScalar dt)
 				f.m_n[1]->m_v+
 				f.m_n[2]->m_v)/3;
 			vol = VolumeOf(f,m_sst.radmrg);
-			m_fdbvt.update(	f.m_leaf,
-				vol,
-				v*m_sst.velmrg,
-				m_sst.updmrg);
+			if(m_bRefitTrees)
+			{
+				moved |= m_fdbvt.refitLeaf(	f.m_leaf,
+					vol,
+					v*m_sst.velmrg,
+					m_sst.updmrg);
+			}
+			else
+			{
+				m_fdbvt.update(	f.m_leaf,
+					vol,
+					v*m_sst.velmrg,
+					m_sst.updmrg);
+			}
 		}
+		if(moved) refitTree(m_fdbvt,m_treeCost[1]);
 	}
 	/* Pose					*/ 
 	updatePose();
@@ -1838,11 +1940,26 @@ void			btSoftBody::predictMotion(btScalar dt)
 	m_rcontacts.resize(0);
 	m_scontacts.resize(0);
 	/* Optimize dbvt's		*/ 
-	m_ndbvt.optimizeIncremental(1);
-	m_fdbvt.optimizeIncremental(1);
+	if(!m_bRefitTrees)
+	{
+		m_ndbvt.optimizeIncremental(1);
+		m_fdbvt.optimizeIncremental(1);
+	}
 	m_cdbvt.optimizeIncremental(1);
 }
 
+//
+void			btSoftBody::refitTree(btDbvt& tree,btScalar& cost)
+{
+	const btScalar	current=tree.refit();
+	if((cost<0)||(current>cost*m_treeRebuildRatio))
+	{
+		/* A small bottom-up treshold keeps the rebuild near O(n log n)	*/ 
+		tree.optimizeTopDown(8);
+		cost=tree.refit();
+	}
+}
+
 //
 void			btSoftBody::solveConstraints()
 {
@@ -1892,7 +2009,11 @@ void			btSoftBody::solveConstraints()
 		}
 	}
 	/* Solve positions		*/ 
-	if(m_cfg.piterations>0)
+	if((m_cfg.piterations>0)&&m_bPackNodes&&(m_nodes.size()>0))
+	{
+		solvePackedPositions();
+	}
+	else if(m_cfg.piterations>0)
 	{
 		for(int isolve=0;isolve<m_cfg.piterations;++isolve)
 		{
@@ -2136,6 +2257,7 @@ void				btSoftBody::indicesToPointers(const int* map)
 		}
 	}
 #undef	IDX2PTR
+	nodesChanged();
 }
 
 //
@@ -2325,12 +2447,9 @@ void					btSoftBody::updateBounds()
 				csm)*1; // ??? to investigate...
 			m_bounds[0]=mins-mrg;
 			m_bounds[1]=maxs+mrg;
-			if(0!=getBroadphaseHandle())
-			{					
-				m_worldInfo->m_broadphase->setAabb(	getBroadphaseHandle(),
-					m_bounds[0],
-					m_bounds[1],
-					m_worldInfo->m_dispatcher);
+			if(!m_bDeferAabb)
+			{
+				updateBroadphaseAabb();
 			}
 		}
 		else
@@ -2341,6 +2460,18 @@ void					btSoftBody::updateBounds()
 	//}
 }
 
+//
+void					btSoftBody::updateBroadphaseAabb()
+{
+	if(m_ndbvt.m_root&&(0!=getBroadphaseHandle()))
+	{
+		m_worldInfo->m_broadphase->setAabb(	getBroadphaseHandle(),
+			m_bounds[0],
+			m_bounds[1],
+			m_worldInfo->m_dispatcher);
+	}
+}
+
 
 //
 void					btSoftBody::updatePose()
@@ -2455,6 +2586,7 @@ void				btSoftBody::updateLinkConstants()
 		Material&	m=*l.m_material;
 		l.m_c0	=	(l.m_n[0]->m_im+l.m_n[1]->m_im)/m.m_kLST;
 	}
+	nodesChanged();
 }
 
 void				btSoftBody::updateConstants()
@@ -2998,6 +3130,19 @@ void				btSoftBody::applyForces()
 	}
 }
 
+//
+static inline void	AnchorSolve(const btSoftBody::Anchor& a,btVector3& x,const btVector3& q,btScalar kAHR,btScalar dt)
+{
+	const btTransform&	t=a.m_body->getWorldTransform();
+	const btVector3		wa=t*a.m_local;
+	const btVector3		va=a.m_body->getVelocityInLocalPoint(a.m_c1)*dt;
+	const btVector3		vb=x-q;
+	const btVector3		vr=(va-vb)+(wa-x)*kAHR;
+	const btVector3		impulse=a.m_c0*vr*a.m_influence;
+	x+=impulse*a.m_c2;
+	a.m_body->applyImpulse(-impulse,a.m_c1);
+}
+
 //
 void				btSoftBody::PSolve_Anchors(btSoftBody* psb,btScalar kst,btScalar ti)
 {
@@ -3006,15 +3151,28 @@ void				btSoftBody::PSolve_Anchors(btSoftBody* psb,btScalar kst,btScalar ti)
 	for(int i=0,ni=psb->m_anchors.size();i<ni;++i)
 	{
 		const Anchor&		a=psb->m_anchors[i];
-		const btTransform&	t=a.m_body->getWorldTransform();
-		Node&				n=*a.m_node;
-		const btVector3		wa=t*a.m_local;
-		const btVector3		va=a.m_body->getVelocityInLocalPoint(a.m_c1)*dt;
-		const btVector3		vb=n.m_x-n.m_q;
-		const btVector3		vr=(va-vb)+(wa-n.m_x)*kAHR;
-		const btVector3		impulse=a.m_c0*vr*a.m_influence;
-		n.m_x+=impulse*a.m_c2;
-		a.m_body->applyImpulse(-impulse,a.m_c1);
+		AnchorSolve(a,a.m_node->m_x,a.m_node->m_q,kAHR,dt);
+	}
+}
+
+//
+static inline void	RContactSolve(const btSoftBody::RContact& c,btVector3& x,const btVector3& q,btScalar kst,btScalar dt,btScalar mrg)
+{
+	const btSoftBody::sCti&	cti = c.m_cti;	
+	btRigidBody* tmpRigid = (btRigidBody*)btRigidBody::upcast(cti.m_colObj);
+	const btVector3		va = tmpRigid ? tmpRigid->getVelocityInLocalPoint(c.m_c1)*dt : btVector3(0,0,0);
+	const btVector3		vb = x-q;	
+	const btVector3		vr = vb-va;
+	const btScalar		dn = btDot(vr, cti.m_normal);		
+	if(dn<=SIMD_EPSILON)
+	{
+		const btScalar		dp = btMin( (btDot(x, cti.m_normal) + cti.m_offset), mrg );
+		const btVector3		fv = vr - (cti.m_normal * dn);
+		// c0 is the impulse matrix, c3 is 1 - the friction coefficient or 0, c4 is the contact hardness coefficient
+		const btVector3		impulse = c.m_c0 * ( (vr - (fv * c.m_c3) + (cti.m_normal * (dp * c.m_c4))) * kst );
+		x -= impulse * c.m_c2;
+		if (tmpRigid)
+			tmpRigid->applyImpulse(impulse,c.m_c1);
 	}
 }
 
@@ -3026,24 +3184,9 @@ void btSoftBody::PSolve_RContacts(btSoftBody* psb, btScalar kst, btScalar ti)
 	for(int i=0,ni=psb->m_rcontacts.size();i<ni;++i)
 	{
 		const RContact&		c = psb->m_rcontacts[i];
-		const sCti&			cti = c.m_cti;	
-		if (cti.m_colObj->hasContactResponse()) 
+		if (c.m_cti.m_colObj->hasContactResponse()) 
 		{
-			btRigidBody* tmpRigid = (btRigidBody*)btRigidBody::upcast(cti.m_colObj);
-			const btVector3		va = tmpRigid ? tmpRigid->getVelocityInLocalPoint(c.m_c1)*dt : btVector3(0,0,0);
-			const btVector3		vb = c.m_node->m_x-c.m_node->m_q;	
-			const btVector3		vr = vb-va;
-			const btScalar		dn = btDot(vr, cti.m_normal);		
-			if(dn<=SIMD_EPSILON)
-			{
-				const btScalar		dp = btMin( (btDot(c.m_node->m_x, cti.m_normal) + cti.m_offset), mrg );
-				const btVector3		fv = vr - (cti.m_normal * dn);
-				// c0 is the impulse matrix, c3 is 1 - the friction coefficient or 0, c4 is the contact hardness coefficient
-				const btVector3		impulse = c.m_c0 * ( (vr - (fv * c.m_c3) + (cti.m_normal * (dp * c.m_c4))) * kst );
-				c.m_node->m_x -= impulse * c.m_c2;
-				if (tmpRigid)
-					tmpRigid->applyImpulse(impulse,c.m_c1);
-			}
+			RContactSolve(c,c.m_node->m_x,c.m_node->m_q,kst,dt,mrg);
 		}
 	}
 }
@@ -3082,40 +3225,249 @@ void				btSoftBody::PSolve_SContacts(btSoftBody* psb,btScalar,btScalar ti)
 }
 
 //
-void				btSoftBody::PSolve_Links(btSoftBody* psb,btScalar kst,btScalar ti)
+// Links of one batch share no node, so a batch is split over threads
+#define BT_SOFTBODY_LINK_GRAIN	256
+
+//
+static inline void	LinkSolve(btVector3& xa,btScalar ima,btVector3& xb,btScalar imb,btScalar c0,btScalar c1,btScalar kst)
 {
-	for(int i=0,ni=psb->m_links.size();i<ni;++i)
-	{			
-		Link&	l=psb->m_links[i];
-		if(l.m_c0>0)
+	if(c0>0)
+	{
+		const btVector3	del=xb-xa;
+		const btScalar	len=del.length2();
+		if (c1+len > SIMD_EPSILON)
 		{
-			Node&			a=*l.m_n[0];
-			Node&			b=*l.m_n[1];
-			const btVector3	del=b.m_x-a.m_x;
-			const btScalar	len=del.length2();
-			if (l.m_c1+len > SIMD_EPSILON)
-			{
-				const btScalar	k=((l.m_c1-len)/(l.m_c0*(l.m_c1+len)))*kst;
-				a.m_x-=del*(k*a.m_im);
-				b.m_x+=del*(k*b.m_im);
-			}
+			const btScalar	k=((c1-len)/(c0*(c1+len)))*kst;
+			xa-=del*(k*ima);
+			xb+=del*(k*imb);
 		}
 	}
 }
 
 //
-void				btSoftBody::VSolve_Links(btSoftBody* psb,btScalar kst)
+static void			PSolveLinkRange(btSoftBody::Link* links,int ibegin,int iend,btScalar kst)
+{
+	for(int i=ibegin;i<iend;++i)
+	{			
+		btSoftBody::Link&	l=links[i];
+		btSoftBody::Node&	a=*l.m_n[0];
+		btSoftBody::Node&	b=*l.m_n[1];
+		LinkSolve(a.m_x,a.m_im,b.m_x,b.m_im,l.m_c0,l.m_c1,kst);
+	}
+}
+
+//
+static void			PackedPSolveLinkRange(const btSoftBody::PackedLink* links,btVector3* x,const btScalar* im,int ibegin,int iend,btScalar kst)
+{
+	for(int i=ibegin;i<iend;++i)
+	{			
+		const btSoftBody::PackedLink&	l=links[i];
+		const int	a=l.m_n[0];
+		const int	b=l.m_n[1];
+		LinkSolve(x[a],im[a],x[b],im[b],l.m_c0,l.m_c1,kst);
+	}
+}
+
+//
+static void			VSolveLinkRange(btSoftBody::Link* links,int ibegin,int iend,btScalar kst)
 {
-	for(int i=0,ni=psb->m_links.size();i<ni;++i)
+	for(int i=ibegin;i<iend;++i)
 	{			
-		Link&			l=psb->m_links[i];
-		Node**			n=l.m_n;
+		btSoftBody::Link&	l=links[i];
+		btSoftBody::Node**	n=l.m_n;
 		const btScalar	j=-btDot(l.m_c3,n[0]->m_v-n[1]->m_v)*l.m_c2*kst;
 		n[0]->m_v+=	l.m_c3*(j*n[0]->m_im);
 		n[1]->m_v-=	l.m_c3*(j*n[1]->m_im);
 	}
 }
 
+//
+enum	btSoftBodyLinkKernel
+{
+	BT_LINK_POSITIONS,
+	BT_LINK_VELOCITIES,
+	BT_LINK_PACKED_POSITIONS
+};
+
+//
+struct btSoftBodyLinkBatchLoop : public btIParallelForBody
+{
+	btSoftBody*				m_psb;
+	btScalar				m_kst;
+	btSoftBodyLinkKernel	m_kernel;
+
+	btSoftBodyLinkBatchLoop(btSoftBody* psb,btScalar kst,btSoftBodyLinkKernel kernel)
+		:m_psb(psb),m_kst(kst),m_kernel(kernel)
+	{
+	}
+	void forLoop(int iBegin,int iEnd) const
+	{
+		switch(m_kernel)
+		{
+		case	BT_LINK_POSITIONS:
+			PSolveLinkRange(&m_psb->m_links[0],iBegin,iEnd,m_kst);
+			break;
+		case	BT_LINK_VELOCITIES:
+			VSolveLinkRange(&m_psb->m_links[0],iBegin,iEnd,m_kst);
+			break;
+		case	BT_LINK_PACKED_POSITIONS:
+			PackedPSolveLinkRange(&m_psb->m_packedLinks[0],&m_psb->m_packedX[0],&m_psb->m_packedIm[0],iBegin,iEnd,m_kst);
+			break;
+		}
+	}
+};
+
+//
+static void			SolveLinkBatches(btSoftBody* psb,btScalar kst,btSoftBodyLinkKernel kernel)
+{
+	const btAlignedObjectArray<int>&	batches=psb->m_linkBatches;
+	btSoftBodyLinkBatchLoop				loop(psb,kst,kernel);
+	for(int i=0,ni=batches.size()-1;i<ni;++i)
+	{
+		if(psb->m_bParallelLinkBatches)
+			btParallelFor(batches[i],batches[i+1],BT_SOFTBODY_LINK_GRAIN,loop);
+		else
+			loop.forLoop(batches[i],batches[i+1]);
+	}
+}
+
+//
+void				btSoftBody::PSolve_Links(btSoftBody* psb,btScalar kst,btScalar ti)
+{
+	if(psb->m_links.size()==0)
+		return;
+	if(psb->hasLinkBatches())
+		SolveLinkBatches(psb,kst,BT_LINK_POSITIONS);
+	else
+		PSolveLinkRange(&psb->m_links[0],0,psb->m_links.size(),kst);
+}
+
+//
+void				btSoftBody::VSolve_Links(btSoftBody* psb,btScalar kst)
+{
+	if(psb->m_links.size()==0)
+		return;
+	if(psb->hasLinkBatches())
+		SolveLinkBatches(psb,kst,BT_LINK_VELOCITIES);
+	else
+		VSolveLinkRange(&psb->m_links[0],0,psb->m_links.size(),kst);
+}
+
+//
+void				btSoftBody::packNodes()
+{
+	const int	nnodes=m_nodes.size();
+	m_packedX.resize(nnodes);
+	m_packedQ.resize(nnodes);
+	for(int i=0;i<nnodes;++i)
+	{
+		const Node&	n=m_nodes[i];
+		m_packedX[i]=n.m_x;
+		m_packedQ[i]=n.m_q;
+	}
+	/* Masses only change with the nodes, see nodesChanged	*/ 
+	if(m_packedRevision==m_nodeRevision)
+		return;
+	m_packedIm.resize(nnodes);
+	for(int i=0;i<nnodes;++i)
+	{
+		m_packedIm[i]=m_nodes[i].m_im;
+	}
+}
+
+//
+void				btSoftBody::packLinks()
+{
+	if(m_packedRevision==m_nodeRevision)
+		return;
+	m_packedLinks.resize(m_links.size());
+	for(int i=0,ni=m_links.size();i<ni;++i)
+	{
+		const Link&		l=m_links[i];
+		PackedLink&		pl=m_packedLinks[i];
+		pl.m_n[0]	=	int(l.m_n[0]-&m_nodes[0]);
+		pl.m_n[1]	=	int(l.m_n[1]-&m_nodes[0]);
+		pl.m_c0		=	l.m_c0;
+		pl.m_c1		=	l.m_c1;
+	}
+}
+
+//
+void				btSoftBody::solvePackedPositions()
+{
+	/* Links of a batch are independent, so consecutive updates don't wait on each other	*/ 
+	if(!hasLinkBatches())
+	{
+		generateLinkBatches();
+	}
+	packNodes();
+	packLinks();
+	m_packedRevision=m_nodeRevision;
+	const int		nnodes=m_nodes.size();
+	const btScalar	kAHR=m_cfg.kAHR;
+	const btScalar	dt=m_sst.sdt;
+	const btScalar	mrg=getCollisionShape()->getMargin();
+	btVector3*		px=&m_packedX[0];
+	const btVector3*	pq=&m_packedQ[0];
+	int i,ni;
+
+	for(int isolve=0;isolve<m_cfg.piterations;++isolve)
+	{
+		const btScalar ti=isolve/(btScalar)m_cfg.piterations;
+		for(int iseq=0;iseq<m_cfg.m_psequence.size();++iseq)
+		{
+			const ePSolver::_	solver=m_cfg.m_psequence[iseq];
+			switch(solver)
+			{
+			case	ePSolver::Linear:
+				if(m_packedLinks.size()==0)
+					break;
+				if(hasLinkBatches())
+					SolveLinkBatches(this,1,BT_LINK_PACKED_POSITIONS);
+				else
+					PackedPSolveLinkRange(&m_packedLinks[0],px,&m_packedIm[0],0,m_packedLinks.size(),1);
+				break;
+			case	ePSolver::Anchors:
+				for(i=0,ni=m_anchors.size();i<ni;++i)
+				{
+					const Anchor&	a=m_anchors[i];
+					const int		n=int(a.m_node-&m_nodes[0]);
+					AnchorSolve(a,px[n],pq[n],kAHR,dt);
+				}
+				break;
+			case	ePSolver::RContacts:
+				for(i=0,ni=m_rcontacts.size();i<ni;++i)
+				{
+					const RContact&	c=m_rcontacts[i];
+					if(c.m_cti.m_colObj->hasContactResponse())
+					{
+						const int	n=int(c.m_node-&m_nodes[0]);
+						RContactSolve(c,px[n],pq[n],1,dt,mrg);
+					}
+				}
+				break;
+			default:
+				/* Other solvers work on m_nodes, sync the positions around them	*/ 
+				if((solver==ePSolver::SContacts)&&(m_scontacts.size()==0))
+					break;
+				for(i=0;i<nnodes;++i) m_nodes[i].m_x=px[i];
+				getSolver(solver)(this,1,ti);
+				for(i=0;i<nnodes;++i) px[i]=m_nodes[i].m_x;
+				break;
+			}
+		}
+	}
+	/* Unpack, together with the velocity update	*/ 
+	const btScalar	vc=m_sst.isdt*(1-m_cfg.kDP);
+	for(i=0;i<nnodes;++i)
+	{
+		Node&	n=m_nodes[i];
+		n.m_x	=	px[i];
+		n.m_v	=	(px[i]-pq[i])*vc;
+		n.m_f	=	btVector3(0,0,0);
+	}
+}
+
 //
 btSoftBody::psolver_t	btSoftBody::getSolver(ePSolver::_ solver)
 {
@@ -242,6 +242,13 @@ public:
 		btScalar				m_c2;			// |gradient|^2/c0
 		btVector3				m_c3;			// gradient
 	};
+	/* PackedLink	*/ 
+	struct	PackedLink
+	{
+		int						m_n[2];			// Node indices
+		btScalar				m_c0;			// (ima+imb)*kLST
+		btScalar				m_c1;			// rl^2
+	};
 	/* Face			*/ 
 	struct	Face : Feature
 	{
@@ -655,6 +662,17 @@ public:
 	tNoteArray				m_notes;		// Notes
 	tNodeArray				m_nodes;		// Nodes
 	tLinkArray				m_links;		// Links
+	btAlignedObjectArray<int>	m_linkBatches;	// First link of each batch, see generateLinkBatches
+	btAlignedObjectArray<PackedLink>	m_packedLinks;	// Links by node index
+	tVector3Array			m_packedX;		// Packed positions
+	tVector3Array			m_packedQ;		// Packed previous step positions
+	tScalarArray			m_packedIm;		// Packed 1/mass
+	bool					m_bPackNodes;	// Solve positions on the packed arrays
+	int						m_nodeRevision;	// Bumped by every change of the nodes or links, see nodesChanged
+	int						m_packedRevision;	// m_nodeRevision that m_packedLinks and m_packedIm were packed at
+	bool					m_bRefitTrees;	// Refit m_ndbvt and m_fdbvt instead of reinserting moved leaves
+	btScalar				m_treeRebuildRatio;	// Rebuild a refitted tree once its cost grew by this ratio
+	btScalar				m_treeCost[2];	// Cost of m_ndbvt and m_fdbvt after their last rebuild, <0 if none
 	tFaceArray				m_faces;		// Faces
 	tTetraArray				m_tetras;		// Tetras
 	tAnchorArray			m_anchors;		// Anchors
@@ -665,6 +683,8 @@ public:
 	btScalar				m_timeacc;		// Time accumulator
 	btVector3				m_bounds[2];	// Spatial bounds	
 	bool					m_bUpdateRtCst;	// Update runtime constants
+	bool					m_bDeferAabb;	// Leave the broadphase aabb update to the solver
+	bool					m_bParallelLinkBatches;	// Solve link batches through btParallelFor, set by a multithreaded solver
 	btDbvt					m_ndbvt;		// Nodes tree
 	btDbvt					m_fdbvt;		// Faces tree
 	btDbvt					m_cdbvt;		// Clusters tree
@@ -848,6 +868,12 @@ public:
 		Material* mat=0);
 	/* Randomize constraints to reduce solver bias							*/ 
 	void				randomizeConstraints();
+	/* Sort links into batches that share no node, for parallel solving	*/ 
+	int					generateLinkBatches();
+	bool				hasLinkBatches() const
+	{
+		return (m_linkBatches.size()>0)&&(m_linkBatches[m_linkBatches.size()-1]==m_links.size());
+	}
 	/* Release clusters														*/ 
 	void				releaseCluster(int index);
 	void				releaseClusters();
@@ -867,6 +893,28 @@ public:
 		sRayCast& results);
 	/* Solver presets														*/ 
 	void				setSolver(eSolverPresets::_ preset);
+	/* Solve positions on packed copies of the node positions and masses,	*/ 
+	/* links are solved in the order of generateLinkBatches					*/ 
+	void				setPackNodes(bool packNodes)
+	{
+		m_bPackNodes=packNodes;
+	}
+	/* Repack the masses and links before the next packed solve, call it	*/ 
+	/* after editing m_nodes or m_links directly							*/ 
+	void				nodesChanged()
+	{
+		++m_nodeRevision;
+	}
+	/* Refit the node and face trees in one pass per step, rebuilding them	*/ 
+	/* when their cost exceeds rebuildRatio times the cost after a rebuild	*/ 
+	/* The trees find the same contacts, but in another order, so the		*/ 
+	/* results differ by rounding once bodies touch							*/ 
+	void				setRefitTrees(bool refitTrees,btScalar rebuildRatio=2)
+	{
+		m_bRefitTrees=refitTrees;
+		m_treeRebuildRatio=rebuildRatio;
+		m_treeCost[0]=m_treeCost[1]=-1;
+	}
 	/* predictMotion														*/ 
 	void				predictMotion(btScalar dt);
 	/* solveConstraints														*/ 
@@ -965,6 +1013,11 @@ public:
 	bool				checkContact(const btCollisionObjectWrapper* colObjWrap,const btVector3& x,btScalar margin,btSoftBody::sCti& cti) const;
 	void				updateNormals();
 	void				updateBounds();
+	void				updateBroadphaseAabb();
+	void				packNodes();
+	void				refitTree(btDbvt& tree,btScalar& cost);
+	void				packLinks();
+	void				solvePackedPositions();
 	void				updatePose();
 	void				updateConstants();
 	void				updateLinkConstants();
@@ -19,6 +19,8 @@ subject to the following restrictions:
 
 #include "BulletCollision/CollisionDispatch/btCollisionObject.h"
 #include "BulletCollision/NarrowPhaseCollision/btGjkEpa2.h"
+#include "LinearMath/btThreads.h"
+#include "LinearMath/btHashMap.h"
 
 // Modified Paul Hsieh hash
 template <const int DWORDLEN>
@@ -40,6 +42,84 @@ unsigned int HsiehHash(const void* pdata)
 	return(hash);
 }
 
+///btSdfGridHeader is the layout of a baked distance grid, in memory or in a file.
+///The header is followed by m_dims[0]*m_dims[1]*m_dims[2] floats, x varying fastest.
+struct	btSdfGridHeader
+{
+	enum	{ MAGIC = 0x46445342, VERSION = 1 }; // "BSDF"
+	int					m_magic;
+	int					m_version;
+	int					m_dims[3];
+	float				m_origin[3];
+	float				m_voxelSize;
+};
+
+///btSdfGrid samples a baked, dense distance grid of a collision shape in shape local space.
+///The samples are not copied, so the grid can point straight into a memory mapped file.
+struct	btSdfGrid
+{
+	const float*		m_data;
+	int					m_dims[3];
+	btVector3			m_origin;
+	btScalar			m_voxelSize;
+
+	btSdfGrid() : m_data(0)
+	{
+		m_dims[0]=m_dims[1]=m_dims[2]=0;
+	}
+	//
+	bool				InitFromMemory(const void* memory,size_t size)
+	{
+		const btSdfGridHeader*	header=(const btSdfGridHeader*)memory;
+		m_data=0;
+		if(	(size<sizeof(btSdfGridHeader))				||
+			(header->m_magic!=btSdfGridHeader::MAGIC)	||
+			(header->m_version!=btSdfGridHeader::VERSION)	||
+			(header->m_dims[0]<2)||(header->m_dims[1]<2)||(header->m_dims[2]<2)	||
+			(header->m_voxelSize<=0))
+		{ return(false); }
+		const size_t	count=size_t(header->m_dims[0])*header->m_dims[1]*header->m_dims[2];
+		if(size<sizeof(btSdfGridHeader)+count*sizeof(float))
+		{ return(false); }
+		for(int i=0;i<3;++i) m_dims[i]=header->m_dims[i];
+		m_origin.setValue(header->m_origin[0],header->m_origin[1],header->m_origin[2]);
+		m_voxelSize=header->m_voxelSize;
+		m_data=(const float*)(header+1);
+		return(true);
+	}
+	//
+	float				Sample(int i,int j,int k) const
+	{
+		return(m_data[(k*m_dims[1]+j)*m_dims[0]+i]);
+	}
+	///Lookup returns false when x lies outside of the grid
+	bool				Lookup(const btVector3& x,btScalar d[8],btScalar f[3]) const
+	{
+		if(!m_data) return(false);
+		const btVector3	g=(x-m_origin)/m_voxelSize;
+		int				o[3];
+		for(int i=0;i<3;++i)
+		{
+			if((g[i]<0)||(g[i]>=(btScalar)(m_dims[i]-1))) return(false);
+			o[i]=(int)g[i];
+			f[i]=g[i]-o[i];
+		}
+		d[0]=Sample(o[0]+0,o[1]+0,o[2]+0);
+		d[1]=Sample(o[0]+1,o[1]+0,o[2]+0);
+		d[2]=Sample(o[0]+1,o[1]+1,o[2]+0);
+		d[3]=Sample(o[0]+0,o[1]+1,o[2]+0);
+		d[4]=Sample(o[0]+0,o[1]+0,o[2]+1);
+		d[5]=Sample(o[0]+1,o[1]+0,o[2]+1);
+		d[6]=Sample(o[0]+1,o[1]+1,o[2]+1);
+		d[7]=Sample(o[0]+0,o[1]+1,o[2]+1);
+		return(true);
+	}
+};
+
+///btSparseSdf caches the distance field of the rigid shapes touched by soft bodies, in cells built on demand.
+///Evaluate can be called from several threads: each hash bucket has its own lock and cells are built outside of it.
+///The cache is bounded, see SetMemoryBudget, the least recently used cells are evicted when it is full.
+///Initialize, Reset, GarbageCollect, RemoveReferences and the grid registration must not run concurrently with Evaluate.
 template <const int CELLSIZE>
 struct	btSparseSdf
 {
@@ -57,6 +137,7 @@ struct	btSparseSdf
 		btScalar			d[CELLSIZE+1][CELLSIZE+1][CELLSIZE+1];
 		int					c[3];
 		int					puid;
+		long long			stamp;	// value of m_stamp at the last access
 		unsigned			hash;
 		const btCollisionShape*	pclient;
 		Cell*				next;
@@ -66,12 +147,16 @@ struct	btSparseSdf
 	//
 
 	btAlignedObjectArray<Cell*>		cells;	
+	btAlignedObjectArray<btSpinMutex>	m_locks;
+	btSpinMutex						m_evictLock;
+	btHashMap<btHashPtr,const btSdfGrid*>	m_grids;
 	btScalar						voxelsz;
 	int								puid;
 	int								ncells;
 	int								m_clampCells;
-	int								nprobes;
-	int								nqueries;	
+	long long						m_stamp;	// incremented by every cell access, orders the cells for eviction
+	int								nprobes;	// cells compared by the cell lookups, updated atomically, see GarbageCollect
+	int								nqueries;	// cell lookups, updated atomically
 
 	//
 	// Methods
@@ -81,12 +166,33 @@ struct	btSparseSdf
 	void					Initialize(int hashsize=2383, int clampCells = 256*1024)
 	{
 		//avoid a crash due to running out of memory, so clamp the maximum number of cells allocated
-		//if this limit is reached, the SDF is reset (at the cost of some performance during the reset)
+		//if this limit is reached, the least recently used cells are evicted
 		m_clampCells = clampCells;
 		cells.resize(hashsize,0);
+		m_locks.resize(hashsize);
 		Reset();
 	}
 	//
+	void					SetMemoryBudget(size_t bytes)
+	{
+		m_clampCells = btMax(1,(int)btMin(bytes/sizeof(Cell),size_t(0x7fffffff)));
+	}
+	//
+	size_t					GetMemoryUsage() const
+	{
+		return(size_t(ncells)*sizeof(Cell)+cells.size()*(sizeof(Cell*)+sizeof(btSpinMutex)));
+	}
+	///RegisterGrid makes Evaluate use a baked grid for the shape, the grid must outlive the registration
+	void					RegisterGrid(const btCollisionShape* shape,const btSdfGrid* grid)
+	{
+		m_grids.insert(btHashPtr(shape),grid);
+	}
+	//
+	void					UnregisterGrid(const btCollisionShape* shape)
+	{
+		m_grids.remove(btHashPtr(shape));
+	}
+	//
 	void					Reset()
 	{
 		for(int i=0,ni=cells.size();i<ni;++i)
@@ -103,6 +209,7 @@ struct	btSparseSdf
 		voxelsz		=0.25;
 		puid		=0;
 		ncells		=0;
+		m_stamp		=0;
 		nprobes		=1;
 		nqueries	=1;
 	}
@@ -136,6 +243,7 @@ struct	btSparseSdf
 	int						RemoveReferences(btCollisionShape* pcs)
 	{
 		int	refcount=0;
+		m_grids.remove(btHashPtr(pcs));
 		for(int i=0;i<cells.size();++i)
 		{
 			Cell*&	root=cells[i];
@@ -147,7 +255,7 @@ struct	btSparseSdf
 				if(pc->pclient==pcs)
 				{
 					if(pp) pp->next=pn; else root=pn;
-					delete pc;pc=pp;++refcount;
+					delete pc;pc=pp;++refcount;--ncells;
 				}
 				pp=pc;pc=pn;
 			}
@@ -160,58 +268,141 @@ struct	btSparseSdf
 		btVector3& normal,
 		btScalar margin)
 	{
+		btScalar		d[8];
+		/* Baked grid			*/ 
+		if(m_grids.size())
+		{
+			const btSdfGrid* const*	grid=m_grids.find(btHashPtr(shape));
+			btScalar				f[3];
+			if(grid&&(*grid)->Lookup(x,d,f))
+			{
+				return(Interpolate(d,f[0],f[1],f[2],normal)-margin);
+			}
+		}
 		/* Lookup cell			*/ 
 		const btVector3	scx=x/voxelsz;
 		const IntFrac	ix=Decompose(scx.x());
 		const IntFrac	iy=Decompose(scx.y());
 		const IntFrac	iz=Decompose(scx.z());
 		const unsigned	h=Hash(ix.b,iy.b,iz.b,shape);
-		Cell*&			root=cells[static_cast<int>(h%cells.size())];
-		Cell*			c=root;
-		++nqueries;
-		while(c)
-		{
-			++nprobes;
-			if(	(c->hash==h)	&&
-				(c->c[0]==ix.b)	&&
-				(c->c[1]==iy.b)	&&
-				(c->c[2]==iz.b)	&&
-				(c->pclient==shape))
-			{ break; }
-			else
-			{ c=c->next; }
-		}
+		const int		bucket=static_cast<int>(h%cells.size());
+		int				probes=0;
+		m_locks[bucket].lock();
+		Cell*			c=Find(bucket,h,ix.b,iy.b,iz.b,shape,&probes);
 		if(!c)
 		{
-			++nprobes;		
-			++ncells;
-			int sz = sizeof(Cell);
-			if (ncells>m_clampCells)
+			++probes;
+			/* Build outside of the lock, another thread may insert the same cell meanwhile	*/ 
+			m_locks[bucket].unlock();
+			Cell*	nc=new Cell();
+			nc->pclient=shape;
+			nc->hash=h;
+			nc->c[0]=ix.b;nc->c[1]=iy.b;nc->c[2]=iz.b;
+			BuildCell(*nc);
+			m_locks[bucket].lock();
+			c=Find(bucket,h,ix.b,iy.b,iz.b,shape);
+			if(c)
 			{
-				static int numResets=0;
-				numResets++;
-//				printf("numResets=%d\n",numResets);
-				Reset();
+				delete nc;
+			}
+			else
+			{
+				c=nc;
+				c->next=cells[bucket];cells[bucket]=c;
+				btAtomicIncrement(&ncells);
 			}
-
-			c=new Cell();
-			c->next=root;root=c;
-			c->pclient=shape;
-			c->hash=h;
-			c->c[0]=ix.b;c->c[1]=iy.b;c->c[2]=iz.b;
-			BuildCell(*c);
 		}
 		c->puid=puid;
+		c->stamp=btAtomicIncrement64(&m_stamp);
 		/* Extract infos		*/ 
 		const int		o[]={	ix.i,iy.i,iz.i};
-		const btScalar	d[]={	c->d[o[0]+0][o[1]+0][o[2]+0],
-			c->d[o[0]+1][o[1]+0][o[2]+0],
-			c->d[o[0]+1][o[1]+1][o[2]+0],
-			c->d[o[0]+0][o[1]+1][o[2]+0],
-			c->d[o[0]+0][o[1]+0][o[2]+1],
-			c->d[o[0]+1][o[1]+0][o[2]+1],
-			c->d[o[0]+1][o[1]+1][o[2]+1],
-			c->d[o[0]+0][o[1]+1][o[2]+1]};
+		d[0]=c->d[o[0]+0][o[1]+0][o[2]+0];
+		d[1]=c->d[o[0]+1][o[1]+0][o[2]+0];
+		d[2]=c->d[o[0]+1][o[1]+1][o[2]+0];
+		d[3]=c->d[o[0]+0][o[1]+1][o[2]+0];
+		d[4]=c->d[o[0]+0][o[1]+0][o[2]+1];
+		d[5]=c->d[o[0]+1][o[1]+0][o[2]+1];
+		d[6]=c->d[o[0]+1][o[1]+1][o[2]+1];
+		d[7]=c->d[o[0]+0][o[1]+1][o[2]+1];
+		m_locks[bucket].unlock();
+		btAtomicIncrement(&nqueries);
+		btAtomicAdd(&nprobes,probes);
+		if(ncells>m_clampCells)
+		{
+			Evict();
+		}
+		return(Interpolate(d,ix.f,iy.f,iz.f,normal)-margin);
+	}
+	//
+	Cell*					Find(int bucket,unsigned h,int x,int y,int z,const btCollisionShape* shape,int* probes=0) const
+	{
+		for(Cell* c=cells[bucket];c;c=c->next)
+		{
+			if(probes) ++*probes;
+			if(	(c->hash==h)	&&
+				(c->c[0]==x)	&&
+				(c->c[1]==y)	&&
+				(c->c[2]==z)	&&
+				(c->pclient==shape))
+			{ return(c); }
+		}
+		return(0);
+	}
+	//
+	struct					StampLess
+	{
+		bool operator()(long long a,long long b) const
+		{
+			return(a<b);
+		}
+	};
+	///Evict brings the cache back to 3/4 of its budget, dropping the least recently used cells.
+	///Only one thread evicts at a time, the others keep going. Cells accessed meanwhile get newer stamps and are kept.
+	void					Evict()
+	{
+		if(!m_evictLock.tryLock()) return;
+		btAlignedObjectArray<long long>	stamps;
+		stamps.reserve(ncells);
+		for(int i=0;i<cells.size();++i)
+		{
+			m_locks[i].lock();
+			for(Cell* c=cells[i];c;c=c->next) stamps.push_back(c->stamp);
+			m_locks[i].unlock();
+		}
+		const int	nremove=stamps.size()-(m_clampCells/4)*3;
+		if(nremove>0)
+		{
+			/* Stamps are unique, so exactly the nremove oldest cells go	*/ 
+			stamps.quickSort(StampLess());
+			const long long	threshold=stamps[nremove-1];
+			for(int i=0;i<cells.size();++i)
+			{
+				m_locks[i].lock();
+				Cell*	pp=0;
+				Cell*	pc=cells[i];
+				while(pc)
+				{
+					Cell*	pn=pc->next;
+					if(pc->stamp<=threshold)
+					{
+						if(pp) pp->next=pn; else cells[i]=pn;
+						delete pc;
+						btAtomicAdd(&ncells,-1);
+					}
+					else
+					{
+						pp=pc;
+					}
+					pc=pn;
+				}
+				m_locks[i].unlock();
+			}
+		}
+		m_evictLock.unlock();
+	}
+	//
+	static inline btScalar	Interpolate(const btScalar d[8],btScalar fx,btScalar fy,btScalar fz,btVector3& normal)
+	{
 		/* Normal	*/ 
 #if 1
 		const btScalar	gx[]={	d[1]-d[0],d[2]-d[3],
@@ -220,22 +411,69 @@ struct	btSparseSdf
 			d[7]-d[4],d[6]-d[5]};
 		const btScalar	gz[]={	d[4]-d[0],d[5]-d[1],
 			d[7]-d[3],d[6]-d[2]};
-		normal.setX(Lerp(	Lerp(gx[0],gx[1],iy.f),
-			Lerp(gx[2],gx[3],iy.f),iz.f));
-		normal.setY(Lerp(	Lerp(gy[0],gy[1],ix.f),
-			Lerp(gy[2],gy[3],ix.f),iz.f));
-		normal.setZ(Lerp(	Lerp(gz[0],gz[1],ix.f),
-			Lerp(gz[2],gz[3],ix.f),iy.f));
+		normal.setX(Lerp(	Lerp(gx[0],gx[1],fy),
+			Lerp(gx[2],gx[3],fy),fz));
+		normal.setY(Lerp(	Lerp(gy[0],gy[1],fx),
+			Lerp(gy[2],gy[3],fx),fz));
+		normal.setZ(Lerp(	Lerp(gz[0],gz[1],fx),
+			Lerp(gz[2],gz[3],fx),fy));
 		normal		=	normal.normalized();
 #else
 		normal		=	btVector3(d[1]-d[0],d[3]-d[0],d[4]-d[0]).normalized();
 #endif
 		/* Distance	*/ 
-		const btScalar	d0=Lerp(Lerp(d[0],d[1],ix.f),
-			Lerp(d[3],d[2],ix.f),iy.f);
-		const btScalar	d1=Lerp(Lerp(d[4],d[5],ix.f),
-			Lerp(d[7],d[6],ix.f),iy.f);
-		return(Lerp(d0,d1,iz.f)-margin);
+		const btScalar	d0=Lerp(Lerp(d[0],d[1],fx),
+			Lerp(d[3],d[2],fx),fy);
+		const btScalar	d1=Lerp(Lerp(d[4],d[5],fx),
+			Lerp(d[7],d[6],fx),fy);
+		return(Lerp(d0,d1,fz));
+	}
+	///BakeGrid samples the shape over its local aabb grown by padding, in the btSdfGridHeader layout.
+	///The buffer can be written to a file and loaded back with btSdfGrid::InitFromMemory.
+	///It returns false and leaves the buffer empty when the grid doesn't fit in a buffer of 2GB.
+	static bool				BakeGrid(	const btCollisionShape* shape,
+		btScalar voxelSize,
+		btScalar padding,
+		btAlignedObjectArray<unsigned char>& buffer)
+	{
+		const size_t	maxCount=(size_t(0x7fffffff)-sizeof(btSdfGridHeader))/sizeof(float);
+		buffer.resize(0);
+		if(!(voxelSize>0)) return(false);
+		btTransform	unit;
+		unit.setIdentity();
+		btVector3	mins,maxs;
+		shape->getAabb(unit,mins,maxs);
+		mins-=btVector3(padding,padding,padding);
+		maxs+=btVector3(padding,padding,padding);
+		btSdfGridHeader	header;
+		header.m_magic=btSdfGridHeader::MAGIC;
+		header.m_version=btSdfGridHeader::VERSION;
+		size_t		count=1;
+		for(int i=0;i<3;++i)
+		{
+			const btScalar	steps=(maxs[i]-mins[i])/voxelSize;
+			if(!(steps<btScalar(maxCount))) return(false);
+			header.m_dims[i]=(int)steps+2;
+			header.m_origin[i]=(float)mins[i];
+			if(size_t(header.m_dims[i])>maxCount/count) return(false);
+			count*=size_t(header.m_dims[i]);
+		}
+		header.m_voxelSize=(float)voxelSize;
+		buffer.resize(int(sizeof(btSdfGridHeader)+count*sizeof(float)));
+		*(btSdfGridHeader*)&buffer[0]=header;
+		float*		data=(float*)(&buffer[0]+sizeof(btSdfGridHeader));
+		for(int k=0;k<header.m_dims[2];++k)
+		{
+			for(int j=0;j<header.m_dims[1];++j)
+			{
+				for(int i=0;i<header.m_dims[0];++i)
+				{
+					const btVector3	x=mins+btVector3((btScalar)i,(btScalar)j,(btScalar)k)*voxelSize;
+					*data++=(float)DistanceToShape(x,shape);
+				}
+			}
+		}
+		return(true);
 	}
 	//
 	void					BuildCell(Cell& c)
@@ -304,11 +542,14 @@ struct	btSparseSdf
 		};
 
 		btS myset;
-
+		/* Zero the padding before p, it is hashed too	*/ 
+		memset(&myset,0,sizeof(btS));
 		myset.x=x;myset.y=y;myset.z=z;myset.p=(void*)shape;
-		const void* ptr = &myset;
+		/* HsiehHash reads shorts, copy rather than alias the struct	*/ 
+		unsigned short data[sizeof(btS)/sizeof(unsigned short)];
+		memcpy(data,&myset,sizeof(btS));
 
-		unsigned int result = HsiehHash<sizeof(btS)/4> (ptr);
+		unsigned int result = HsiehHash<sizeof(btS)/4> (data);
 
 
 		return result;
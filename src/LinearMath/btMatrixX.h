@@ -481,12 +481,217 @@ struct btMatrixX
 };
 
 
+///btSparseMatrixX is a square, symmetric-structured block sparse matrix, such as the MLCP matrix A = J*invM*J^T:
+///the rows are grouped into blocks (one per constraint), and each block row only stores the dense blocks
+///of the block columns it is coupled with, so memory and matrix-vector products scale with the non-zeros.
+///It is assembled in two phases, each block row can be filled independently (and in parallel):
+///first the block columns of every block row (beginAssembly/getBlockColumns), then the values (allocateValues/getBlockValues).
+///There is no sparse factorization: only iterative MLCP solvers such as btSolveProjectedGaussSeidel solve on it directly,
+///the pivoting solvers (btDantzigSolver, btLemkeSolver, btPATHSolver) keep using the dense btMatrixX.
+template <typename T>
+struct btSparseMatrixX
+{
+	btAlignedObjectArray<int>	m_blockStart;		//first row of each block, followed by the number of rows
+	btAlignedObjectArray<int>	m_rowBlock;			//block of each row
+	btAlignedObjectArray<int>	m_blockRowPtr;		//first stored block of each block row, followed by the number of stored blocks
+	btAlignedObjectArray<int>	m_blockColumn;		//block column of each stored block, ascending within a block row
+	btAlignedObjectArray<int>	m_blockValues;		//offset of each stored block in m_values, blocks are stored row major
+	btAlignedObjectArray<int>	m_diagonalBlock;	//stored diagonal block of each block row, -1 if there is none
+	btAlignedObjectArray<T>		m_values;
+
+	int rows() const
+	{
+		return m_rowBlock.size();
+	}
+	int cols() const
+	{
+		return m_rowBlock.size();
+	}
+	int numBlocks() const
+	{
+		return m_blockStart.size() ? m_blockStart.size()-1 : 0;
+	}
+	int blockSize(int block) const
+	{
+		return m_blockStart[block+1]-m_blockStart[block];
+	}
+	int nonZeros() const
+	{
+		return m_values.size();
+	}
+
+	///beginAssembly sets the block sizes and the number of stored blocks of each block row, and clears the values
+	void beginAssembly(const btAlignedObjectArray<int>& blockSizes, const btAlignedObjectArray<int>& blocksPerRow)
+	{
+		btAssert(blockSizes.size() == blocksPerRow.size());
+		int numBlocks = blockSizes.size();
+		m_blockStart.resizeNoInitialize(numBlocks+1);
+		m_blockRowPtr.resizeNoInitialize(numBlocks+1);
+		int row = 0;
+		int entry = 0;
+		for (int b=0;b<numBlocks;b++)
+		{
+			m_blockStart[b] = row;
+			m_blockRowPtr[b] = entry;
+			row += blockSizes[b];
+			entry += blocksPerRow[b];
+		}
+		m_blockStart[numBlocks] = row;
+		m_blockRowPtr[numBlocks] = entry;
+
+		m_rowBlock.resizeNoInitialize(row);
+		for (int b=0;b<numBlocks;b++)
+			for (int r=m_blockStart[b];r<m_blockStart[b+1];r++)
+				m_rowBlock[r] = b;
+
+		m_blockColumn.resizeNoInitialize(entry);
+		m_blockValues.resizeNoInitialize(entry);
+		m_diagonalBlock.resizeNoInitialize(numBlocks);
+		m_values.resize(0);
+	}
+
+	int* getBlockColumns(int blockRow)
+	{
+		return m_blockColumn.size() ? &m_blockColumn[m_blockRowPtr[blockRow]] : 0;
+	}
+
+	///allocateValues computes the value offsets once all block columns are known, the values are zeroed
+	void allocateValues()
+	{
+		int numBlocks = this->numBlocks();
+		int offset = 0;
+		for (int b=0;b<numBlocks;b++)
+		{
+			m_diagonalBlock[b] = -1;
+			for (int k=m_blockRowPtr[b];k<m_blockRowPtr[b+1];k++)
+			{
+				int col = m_blockColumn[k];
+				btAssert(k==m_blockRowPtr[b] || m_blockColumn[k-1]<col);
+				if (col==b)
+					m_diagonalBlock[b] = k;
+				m_blockValues[k] = offset;
+				offset += blockSize(b)*blockSize(col);
+			}
+		}
+		m_values.resize(0);
+		m_values.resize(offset,T(0));
+	}
+
+	T* getBlockValues(int entry)
+	{
+		return &m_values[m_blockValues[entry]];
+	}
+	const T* getBlockValues(int entry) const
+	{
+		return &m_values[m_blockValues[entry]];
+	}
+
+	T getDiagonal(int row) const
+	{
+		int b = m_rowBlock[row];
+		int k = m_diagonalBlock[b];
+		if (k<0)
+			return T(0);
+		int r = row-m_blockStart[b];
+		return getBlockValues(k)[r*blockSize(b)+r];
+	}
+
+	void addDiagonal(T value)
+	{
+		for (int b=0;b<numBlocks();b++)
+		{
+			int k = m_diagonalBlock[b];
+			btAssert(k>=0);
+			int n = blockSize(b);
+			T* v = getBlockValues(k);
+			for (int r=0;r<n;r++)
+				v[r*n+r] += value;
+		}
+	}
+
+	///rowDot returns row 'row' of the matrix times x, optionally skipping the diagonal element
+	T rowDot(int row, const T* x, bool skipDiagonal) const
+	{
+		int b = m_rowBlock[row];
+		int r = row-m_blockStart[b];
+		T sum = T(0);
+		for (int k=m_blockRowPtr[b];k<m_blockRowPtr[b+1];k++)
+		{
+			int col = m_blockColumn[k];
+			int c0 = m_blockStart[col];
+			int nc = m_blockStart[col+1]-c0;
+			const T* v = getBlockValues(k)+r*nc;
+			const T* xc = x+c0;
+			for (int j=0;j<nc;j++)
+			{
+				sum += v[j]*xc[j];
+			}
+			if (skipDiagonal && col==b)
+			{
+				sum -= v[r]*xc[r];
+			}
+		}
+		return sum;
+	}
+
+	T operator() (int row,int col) const
+	{
+		int b = m_rowBlock[row];
+		int cb = m_rowBlock[col];
+		for (int k=m_blockRowPtr[b];k<m_blockRowPtr[b+1];k++)
+		{
+			if (m_blockColumn[k]==cb)
+			{
+				return getBlockValues(k)[(row-m_blockStart[b])*blockSize(cb)+col-m_blockStart[cb]];
+			}
+		}
+		return T(0);
+	}
+
+	void multiply(const btVectorX<T>& x, btVectorX<T>& result) const
+	{
+		btAssert(x.rows()==rows());
+		result.resize(rows());
+		for (int i=0;i<rows();i++)
+			result[i] = rowDot(i,&x[0],false);
+	}
+
+	///toDense expands the matrix, for MLCP solvers that only work on btMatrixX
+	void toDense(btMatrixX<T>& dense) const
+	{
+		BT_PROFILE("btSparseMatrixX::toDense");
+		dense.resize(rows(),cols());
+		dense.setZero();
+		for (int b=0;b<numBlocks();b++)
+		{
+			int r0 = m_blockStart[b];
+			int nr = blockSize(b);
+			for (int k=m_blockRowPtr[b];k<m_blockRowPtr[b+1];k++)
+			{
+				int col = m_blockColumn[k];
+				int c0 = m_blockStart[col];
+				int nc = blockSize(col);
+				const T* v = getBlockValues(k);
+				for (int r=0;r<nr;r++)
+					for (int c=0;c<nc;c++)
+					{
+						if (v[r*nc+c])
+							dense.setElem(r0+r,c0+c,v[r*nc+c]);
+					}
+			}
+		}
+	}
+};
+
+
 
 typedef btMatrixX<float> btMatrixXf;
 typedef btVectorX<float> btVectorXf;
+typedef btSparseMatrixX<float> btSparseMatrixXf;
 
 typedef btMatrixX<double> btMatrixXd;
 typedef btVectorX<double> btVectorXd;
+typedef btSparseMatrixX<double> btSparseMatrixXd;
 
 
 #ifdef BT_DEBUG_OSTREAM
@@ -544,9 +749,11 @@ inline void setElem(btMatrixXf& mat, int row, int col, float val)
 #ifdef BT_USE_DOUBLE_PRECISION
 	#define btVectorXu btVectorXd
 	#define btMatrixXu btMatrixXd
+	#define btSparseMatrixXu btSparseMatrixXd
 #else
 	#define btVectorXu btVectorXf
 	#define btMatrixXu btMatrixXf
+	#define btSparseMatrixXu btSparseMatrixXf
 #endif //BT_USE_DOUBLE_PRECISION
 
 
@@ -14,6 +14,7 @@
 // Ogre (www.ogre3d.org).
 
 #include "btQuickprof.h"
+#include "btThreads.h"
 
 #ifndef BT_NO_PROFILE
 
@@ -455,6 +456,11 @@ unsigned long int			CProfileManager::ResetTime = 0;
  *=============================================================================================*/
 void	CProfileManager::Start_Profile( const char * name )
 {
+	//the profile tree is not thread safe, only thread index 0 is profiled. That is the first thread that called
+	//btGetCurrentThreadIndex, normally the one that installed the task scheduler or runs btParallelFor
+	if (btGetCurrentThreadIndex() != 0) {
+		return;
+	}
 	if (name != CurrentNode->Get_Name()) {
 		CurrentNode = CurrentNode->Get_Sub_Node( name );
 	}
@@ -468,6 +474,9 @@ void	CProfileManager::Start_Profile( const char * name )
  *=============================================================================================*/
 void	CProfileManager::Stop_Profile( void )
 {
+	if (btGetCurrentThreadIndex() != 0) {
+		return;
+	}
 	// Return will indicate whether we should back up to our parent (we may
 	// be profiling a recursive function)
 	if (CurrentNode->Return()) {
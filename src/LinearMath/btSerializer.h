@@ -23,6 +23,7 @@ subject to the following restrictions:
 #include <memory.h>
 #endif
 #include <string.h>
+#include <stdio.h>
 
 
 
@@ -62,7 +63,11 @@ enum	btSerializationFlags
 {
 	BT_SERIALIZE_NO_BVH = 1,
 	BT_SERIALIZE_NO_TRIANGLEINFOMAP = 2,
-	BT_SERIALIZE_NO_DUPLICATE_ASSERT = 4
+	BT_SERIALIZE_NO_DUPLICATE_ASSERT = 4,
+	///pad each chunk with zero bytes so the data of the next chunk starts 16 byte aligned in the file,
+	///btBulletWorldImporter::loadFileMapped can then reference the data in place. The padding is part of m_length,
+	///loaders size the structs by m_number, so older versions still read these files.
+	BT_SERIALIZE_ALIGN_CHUNKS = 8
 };
 
 class	btSerializer
@@ -614,17 +619,37 @@ public:
 
 
 
+		///returns the number of zero bytes to append to a chunk that ends at the given file offset,
+		///so the data of the next chunk starts 16 byte aligned in the file (and in a mapping of the file)
+		static int	getChunkPadding(int chunkEnd)
+		{
+			return (16-((chunkEnd+int(sizeof(btChunk)))&15))&15;
+		}
+
 		virtual	btChunk*	allocate(size_t size, int numElements)
 		{
+			int length = int(size)*numElements;
+			int padding = 0;
+			if (m_serializationFlags&BT_SERIALIZE_ALIGN_CHUNKS)
+			{
+				//chunks are laid out in allocation order, the header is only prepended later without a preallocated buffer
+				int fileOffset = m_totalSize? m_currentSize : m_currentSize+BT_HEADER_LENGTH;
+				padding = getChunkPadding(fileOffset+int(sizeof(btChunk))+length);
+				//a preallocated buffer has a fixed size, rather leave the chunk unaligned than overrun the buffer
+				if (m_totalSize && m_currentSize+int(sizeof(btChunk))+length+padding>=m_totalSize)
+					padding = 0;
+			}
 
-			unsigned char* ptr = internalAlloc(int(size)*numElements+sizeof(btChunk));
+			unsigned char* ptr = internalAlloc(length+padding+sizeof(btChunk));
 
+			//the serialize methods leave the padding of the structs alone, clear it so the file is reproducible
 			unsigned char* data = ptr + sizeof(btChunk);
+			memset(data,0,length+padding);
 
 			btChunk* chunk = (btChunk*)ptr;
 			chunk->m_chunkCode = 0;
 			chunk->m_oldPtr = data;
-			chunk->m_length = int(size)*numElements;
+			chunk->m_length = length+padding;
 			chunk->m_number = numElements;
 
 			m_chunkPtrs.push_back(chunk);
@@ -697,6 +722,272 @@ public:
 };
 
 
+///btSerializerSink receives the bytes of a .bullet file while it is being written by the btStreamingSerializer.
+///Derive from it to send the data to a socket, a compression stream or a background writer thread.
+class btSerializerSink
+{
+public:
+
+	virtual ~btSerializerSink() {}
+
+	///return false on a write error, the btStreamingSerializer will then discard the remaining chunks
+	virtual bool	write(const void* data, int numBytes) = 0;
+
+	virtual void	flush() {}
+};
+
+///btFileSerializerSink writes the serialized data to a file, either opened by name or provided by the user
+class btFileSerializerSink : public btSerializerSink
+{
+	FILE*	m_file;
+	bool	m_ownsFile;
+
+public:
+
+	btFileSerializerSink(const char* fileName)
+		:m_file(fopen(fileName,"wb")),
+		m_ownsFile(true)
+	{
+	}
+
+	btFileSerializerSink(FILE* file)
+		:m_file(file),
+		m_ownsFile(false)
+	{
+	}
+
+	virtual ~btFileSerializerSink()
+	{
+		if (m_file && m_ownsFile)
+			fclose(m_file);
+	}
+
+	bool	isOpen() const
+	{
+		return m_file!=0;
+	}
+
+	virtual bool	write(const void* data, int numBytes)
+	{
+		if (!m_file)
+			return false;
+		return fwrite(data,1,numBytes,m_file)==size_t(numBytes);
+	}
+
+	virtual void	flush()
+	{
+		if (m_file)
+			fflush(m_file);
+	}
+};
+
+///The btStreamingSerializer writes each chunk to a btSerializerSink as soon as it and all chunks allocated
+///before it are finalized, instead of keeping all chunks in memory and concatenating them in finishSerialization.
+///The chunks are written in allocation order, like btDefaultSerializer, so the stream is byte identical to its buffer.
+///Chunk data lives in a fixed size scratch buffer, chunks that don't fit fall back to btAlignedAlloc and are freed
+///right after writing. A chunk that is finalized while an earlier one is still open (the child chunks of a shape
+///or an array) is held until that one is finalized too. Only the pointer maps are kept for the whole world,
+///so peak memory no longer grows with the size of the data.
+///The DNA is parsed once, so the same serializer can be reused for periodic checkpoints.
+///The serializer has no global state: it can run on a worker thread, as long as the serialized objects
+///(for example a copy of the world) are not modified while it runs.
+class btStreamingSerializer : public btDefaultSerializer
+{
+	btSerializerSink*	m_sink;
+	bool				m_sinkError;
+
+	unsigned char*		m_scratch;
+	int					m_scratchSize;
+	int					m_scratchTop;
+
+	///chunks that are allocated but not written yet, in allocation order, from m_firstPendingChunk on
+	btAlignedObjectArray<btChunk*>	m_pendingChunks;
+	btAlignedObjectArray<bool>		m_pendingChunkDone;
+	int					m_firstPendingChunk;
+
+	///file offset of the next allocated chunk, the header included
+	int					m_allocatedSize;
+
+	int					m_numChunks;
+
+	bool	isScratchChunk(const btChunk* chunk) const
+	{
+		const unsigned char* ptr = (const unsigned char*)chunk;
+		return ptr>=m_scratch && ptr<m_scratch+m_scratchSize;
+	}
+
+	void	writeToSink(const void* data, int numBytes)
+	{
+		if (m_sinkError)
+			return;
+		if (!m_sink->write(data,numBytes))
+		{
+			m_sinkError = true;
+			return;
+		}
+		m_currentSize += numBytes;
+	}
+
+	void	releaseChunk(btChunk* chunk)
+	{
+		//array chunks are often registered by the address of their own data, which is reused
+		//by a later chunk, so forget it to get a fresh unique pointer for that chunk
+		void* data = (unsigned char*)chunk + sizeof(btChunk);
+		m_uniquePointers.remove(data);
+		m_chunkP.remove(data);
+
+		if (!isScratchChunk(chunk))
+		{
+			btAlignedFree(chunk);
+		}
+	}
+
+	///writes the finalized chunks at the start of the pending list
+	void	writePendingChunks()
+	{
+		while (m_firstPendingChunk<m_pendingChunks.size() && m_pendingChunkDone[m_firstPendingChunk])
+		{
+			btChunk* chunk = m_pendingChunks[m_firstPendingChunk++];
+			writeToSink(chunk,int(sizeof(btChunk))+chunk->m_length);
+			m_numChunks++;
+			releaseChunk(chunk);
+		}
+		//the scratch buffer is free again once every chunk is written
+		if (m_firstPendingChunk==m_pendingChunks.size())
+		{
+			m_pendingChunks.resize(0);
+			m_pendingChunkDone.resize(0);
+			m_firstPendingChunk = 0;
+			m_scratchTop = 0;
+		}
+	}
+
+public:
+
+	btStreamingSerializer(btSerializerSink* sink, int scratchSize=1024*1024)
+		:m_sink(sink),
+		m_sinkError(false),
+		m_scratchSize(scratchSize),
+		m_scratchTop(0),
+		m_firstPendingChunk(0),
+		m_allocatedSize(0),
+		m_numChunks(0)
+	{
+		m_scratch = m_scratchSize?(unsigned char*)btAlignedAlloc(m_scratchSize,16):0;
+	}
+
+	virtual ~btStreamingSerializer()
+	{
+		if (m_scratch)
+			btAlignedFree(m_scratch);
+	}
+
+	///returns true if the sink reported a write error during the last serialization
+	bool	hasSinkError() const
+	{
+		return m_sinkError;
+	}
+
+	virtual	void	startSerialization()
+	{
+		btDefaultSerializer::startSerialization();
+		m_sinkError = false;
+		m_currentSize = 0;
+		m_allocatedSize = BT_HEADER_LENGTH;
+		m_numChunks = 0;
+
+		unsigned char header[BT_HEADER_LENGTH];
+		writeHeader(header);
+		writeToSink(header,BT_HEADER_LENGTH);
+	}
+
+	virtual	void	finishSerialization()
+	{
+		writeDNA();
+		m_sink->flush();
+
+		//keep the parsed DNA, only reset the per-serialization state
+		btAssert(m_pendingChunks.size()==0);
+		m_pendingChunks.clear();
+		m_pendingChunkDone.clear();
+		m_firstPendingChunk = 0;
+		m_scratchTop = 0;
+		m_skipPointers.clear();
+		m_chunkP.clear();
+		m_nameMap.clear();
+		m_uniquePointers.clear();
+	}
+
+	virtual	btChunk*	allocate(size_t size, int numElements)
+	{
+		//the same padding as btDefaultSerializer, the chunk is written at m_allocatedSize
+		int length = int(size)*numElements;
+		int padding = (m_serializationFlags&BT_SERIALIZE_ALIGN_CHUNKS)? getChunkPadding(m_allocatedSize+int(sizeof(btChunk))+length) : 0;
+		int chunkSize = int(sizeof(btChunk))+length+padding;
+		int alignedSize = (chunkSize+15)&~15;
+		m_allocatedSize += chunkSize;
+
+		unsigned char* ptr = 0;
+		if (m_scratchTop+alignedSize<=m_scratchSize)
+		{
+			ptr = m_scratch+m_scratchTop;
+			m_scratchTop += alignedSize;
+		} else
+		{
+			ptr = (unsigned char*)btAlignedAlloc(chunkSize,16);
+		}
+		m_pendingChunks.push_back((btChunk*)ptr);
+		m_pendingChunkDone.push_back(false);
+
+		unsigned char* data = ptr + sizeof(btChunk);
+		memset(data,0,length+padding);
+
+		btChunk* chunk = (btChunk*)ptr;
+		chunk->m_chunkCode = 0;
+		chunk->m_oldPtr = data;
+		chunk->m_length = length+padding;
+		chunk->m_number = numElements;
+		return chunk;
+	}
+
+	virtual	void	finalizeChunk(btChunk* chunk, const char* structType, int chunkCode,void* oldPtr)
+	{
+		btDefaultSerializer::finalizeChunk(chunk,structType,chunkCode,oldPtr);
+		int index = m_pendingChunks.size()-1;
+		while (index>=m_firstPendingChunk && m_pendingChunks[index]!=chunk)
+			index--;
+		btAssert(index>=m_firstPendingChunk);
+		m_pendingChunkDone[index] = true;
+		writePendingChunks();
+	}
+
+	///the data is not kept in memory, the buffer pointer is always null
+	virtual	const unsigned char*		getBufferPointer() const
+	{
+		return 0;
+	}
+
+	///returns the number of bytes written to the sink so far
+	virtual	int					getCurrentBufferSize() const
+	{
+		return	m_currentSize;
+	}
+
+	///returns the number of chunks written to the sink so far
+	virtual int getNumChunks() const
+	{
+		return m_numChunks;
+	}
+
+	///chunks are released after writing, so they cannot be accessed afterwards
+	virtual const btChunk* getChunk(int chunkIndex) const
+	{
+		(void)chunkIndex;
+		return 0;
+	}
+};
+
+
 ///In general it is best to use btDefaultSerializer,
 ///in particular when writing the data to disk or sending it over the network.
 ///The btInMemorySerializer is experimental and only suitable in a few cases.
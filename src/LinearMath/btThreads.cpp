@@ -0,0 +1,235 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2015 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btThreads.h"
+#include "btMinMax.h"
+
+#if BT_USE_OPENMP
+#include <omp.h>
+#endif //BT_USE_OPENMP
+
+#if defined(_MSC_VER)
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <intrin.h>
+
+#define BT_THREAD_LOCAL __declspec(thread)
+
+static int btCompareAndSwap(volatile int* value, int expected, int desired)
+{
+	return (int)_InterlockedCompareExchange((volatile long*)value, (long)desired, (long)expected);
+}
+
+int btAtomicAdd(volatile int* value, int delta)
+{
+	return (int)_InterlockedExchangeAdd((volatile long*)value, (long)delta) + delta;
+}
+
+long long btAtomicIncrement64(volatile long long* value)
+{
+	return (long long)InterlockedIncrement64((volatile LONGLONG*)value);
+}
+
+static void btThreadYield()
+{
+	YieldProcessor();
+}
+
+#else //_MSC_VER
+
+#define BT_THREAD_LOCAL __thread
+
+static int btCompareAndSwap(volatile int* value, int expected, int desired)
+{
+	return __sync_val_compare_and_swap(value, expected, desired);
+}
+
+int btAtomicAdd(volatile int* value, int delta)
+{
+	return __sync_add_and_fetch(value, delta);
+}
+
+long long btAtomicIncrement64(volatile long long* value)
+{
+	return __sync_add_and_fetch(value, 1LL);
+}
+
+static void btThreadYield()
+{
+#if defined (__i386__) || defined (__x86_64__)
+	__asm__ __volatile__("pause");
+#endif
+}
+
+#endif //_MSC_VER
+
+int btAtomicIncrement(volatile int* value)
+{
+	return btAtomicAdd(value, 1);
+}
+
+bool btSpinMutex::tryLock()
+{
+	return btCompareAndSwap(&m_lock, 0, 1) == 0;
+}
+
+void btSpinMutex::lock()
+{
+	while (!tryLock())
+	{
+		//spin on a plain read until the lock looks free, to avoid hammering the cache line
+		while (*(volatile int*)&m_lock)
+		{
+			btThreadYield();
+		}
+	}
+}
+
+void btSpinMutex::unlock()
+{
+	btCompareAndSwap(&m_lock, 1, 0);
+}
+
+
+static volatile int gThreadCounter = 0;
+static BT_THREAD_LOCAL int gThreadIndex = -1;
+
+unsigned int btGetCurrentThreadIndex()
+{
+	if (gThreadIndex < 0)
+	{
+		//threads beyond BT_MAX_THREAD_COUNT share the last index, index 0 must never be handed out twice
+		int index = btAtomicIncrement(&gThreadCounter) - 1;
+		gThreadIndex = (index >= 0 && index < BT_MAX_THREAD_COUNT) ? index : BT_MAX_THREAD_COUNT - 1;
+	}
+	return (unsigned int)gThreadIndex;
+}
+
+
+///btTaskSchedulerSequential runs the whole loop on the calling thread
+class btTaskSchedulerSequential : public btITaskScheduler
+{
+public:
+	btTaskSchedulerSequential()
+		:btITaskScheduler("Sequential")
+	{
+	}
+	virtual int getMaxNumThreads() const
+	{
+		return 1;
+	}
+	virtual int getNumThreads() const
+	{
+		return 1;
+	}
+	virtual void setNumThreads(int numThreads)
+	{
+		(void)numThreads;
+	}
+	virtual void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body)
+	{
+		(void)grainSize;
+		body.forLoop(iBegin, iEnd);
+	}
+};
+
+#if BT_USE_OPENMP
+///btTaskSchedulerOpenMP hands out grainSize chunks to the OpenMP thread team
+class btTaskSchedulerOpenMP : public btITaskScheduler
+{
+	int m_numThreads;
+public:
+	btTaskSchedulerOpenMP()
+		:btITaskScheduler("OpenMP"),
+		m_numThreads(omp_get_max_threads())
+	{
+	}
+	virtual int getMaxNumThreads() const
+	{
+		return omp_get_max_threads();
+	}
+	virtual int getNumThreads() const
+	{
+		return m_numThreads;
+	}
+	virtual void setNumThreads(int numThreads)
+	{
+		m_numThreads = btMax(1, btMin(numThreads, int(BT_MAX_THREAD_COUNT)));
+		omp_set_num_threads(m_numThreads);
+	}
+	virtual void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body)
+	{
+		int numChunks = (iEnd - iBegin + grainSize - 1) / grainSize;
+#pragma omp parallel for schedule(dynamic, 1)
+		for (int chunk = 0; chunk < numChunks; ++chunk)
+		{
+			int i0 = iBegin + chunk * grainSize;
+			body.forLoop(i0, btMin(i0 + grainSize, iEnd));
+		}
+	}
+};
+#endif //BT_USE_OPENMP
+
+
+static btTaskSchedulerSequential gSequentialTaskScheduler;
+static btITaskScheduler* gTaskScheduler = &gSequentialTaskScheduler;
+static volatile int gParallelForDepth = 0;
+
+void btSetTaskScheduler(btITaskScheduler* taskScheduler)
+{
+	//claim an index before any worker runs Bullet code, so the thread that drives the simulation gets index 0
+	btGetCurrentThreadIndex();
+	gTaskScheduler = taskScheduler ? taskScheduler : &gSequentialTaskScheduler;
+}
+
+btITaskScheduler* btGetTaskScheduler()
+{
+	return gTaskScheduler;
+}
+
+btITaskScheduler* btGetSequentialTaskScheduler()
+{
+	return &gSequentialTaskScheduler;
+}
+
+btITaskScheduler* btGetOpenMPTaskScheduler()
+{
+#if BT_USE_OPENMP
+	static btTaskSchedulerOpenMP sOpenMPTaskScheduler;
+	return &sOpenMPTaskScheduler;
+#else
+	return 0;
+#endif
+}
+
+void btParallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body)
+{
+	if (iEnd <= iBegin)
+		return;
+	if (grainSize < 1)
+		grainSize = 1;
+
+	//small ranges and nested loops run inline, spawning work from inside a parallel region would oversubscribe the pool
+	if ((iEnd - iBegin) <= grainSize || gParallelForDepth > 0)
+	{
+		body.forLoop(iBegin, iEnd);
+		return;
+	}
+	btGetCurrentThreadIndex();
+	btAtomicIncrement(&gParallelForDepth);
+	gTaskScheduler->parallelFor(iBegin, iEnd, grainSize, body);
+	btAtomicAdd(&gParallelForDepth, -1);
+}
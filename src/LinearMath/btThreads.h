@@ -0,0 +1,119 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2015 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_THREADS_H
+#define BT_THREADS_H
+
+#include "btScalar.h"
+
+///maximum number of threads that btGetCurrentThreadIndex can distinguish, use it to size per-thread scratch data
+#define BT_MAX_THREAD_COUNT 64
+
+///btSpinMutex is a small busy-waiting lock, meant for very short critical sections in multithreaded code paths.
+///It has no constructor side effects, so it can be a member of a pooled or memcpy'd structure.
+class btSpinMutex
+{
+	int m_lock;
+
+public:
+	btSpinMutex()
+		:m_lock(0)
+	{
+	}
+
+	void lock();
+	void unlock();
+	bool tryLock();
+};
+
+///btMutexLockGuard releases the btSpinMutex when it goes out of scope
+class btMutexLockGuard
+{
+	btSpinMutex& m_mutex;
+
+	btMutexLockGuard(const btMutexLockGuard&);
+	btMutexLockGuard& operator=(const btMutexLockGuard&);
+public:
+	btMutexLockGuard(btSpinMutex& mutex)
+		:m_mutex(mutex)
+	{
+		m_mutex.lock();
+	}
+	~btMutexLockGuard()
+	{
+		m_mutex.unlock();
+	}
+};
+
+///btAtomicIncrement/btAtomicAdd return the value after the operation
+int btAtomicIncrement(volatile int* value);
+int btAtomicAdd(volatile int* value, int delta);
+///btAtomicIncrement64 returns the value after the increment, for counters that must never wrap around
+long long btAtomicIncrement64(volatile long long* value);
+
+///btGetCurrentThreadIndex returns a small, stable index in [0,BT_MAX_THREAD_COUNT) for the calling thread.
+///The thread that first calls it gets 0. btSetTaskScheduler and btParallelFor call it on the dispatching thread before
+///any worker runs, so that is the thread driving the simulation, unless another thread used Bullet before.
+///Threads beyond the first BT_MAX_THREAD_COUNT all get BT_MAX_THREAD_COUNT-1, so the index is not unique for them.
+unsigned int btGetCurrentThreadIndex();
+
+///btIParallelForBody is the body of a btParallelFor loop, forLoop is called with disjoint [iBegin,iEnd) ranges, possibly concurrently
+class btIParallelForBody
+{
+public:
+	virtual ~btIParallelForBody() {}
+	virtual void forLoop(int iBegin, int iEnd) const = 0;
+};
+
+///btITaskScheduler lets the application plug its own thread pool (or job system) into Bullet.
+///Bullet only ever calls parallelFor, and never from more than one thread at a time.
+class btITaskScheduler
+{
+	const char* m_name;
+public:
+	btITaskScheduler(const char* name)
+		:m_name(name)
+	{
+	}
+	virtual ~btITaskScheduler() {}
+
+	const char* getName() const
+	{
+		return m_name;
+	}
+
+	virtual int getMaxNumThreads() const = 0;
+	virtual int getNumThreads() const = 0;
+	virtual void setNumThreads(int numThreads) = 0;
+	virtual void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body) = 0;
+};
+
+///btSetTaskScheduler installs the task scheduler used by btParallelFor, passing 0 restores the sequential scheduler.
+///The scheduler is not owned by Bullet, and must outlive its use.
+void btSetTaskScheduler(btITaskScheduler* taskScheduler);
+
+btITaskScheduler* btGetTaskScheduler();
+
+///btGetSequentialTaskScheduler returns the default scheduler, it runs the whole range on the calling thread
+btITaskScheduler* btGetSequentialTaskScheduler();
+
+///btGetOpenMPTaskScheduler returns 0 unless Bullet was built with BT_USE_OPENMP
+btITaskScheduler* btGetOpenMPTaskScheduler();
+
+///btParallelFor splits [iBegin,iEnd) in chunks of about grainSize iterations and runs body.forLoop on them through the current task scheduler.
+///Nested calls (from within a forLoop) run sequentially on the calling thread.
+void btParallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body);
+
+#endif //BT_THREADS_H
@@ -0,0 +1,41 @@
+
+	-- gtest-only tests of the dynamics world, the characters, vehicles and solvers
+	local dynamicsTests = {
+		{ "Test_KinematicCrowd", "test_kinematic_crowd.cpp" },
+		{ "Test_VehicleFleet", "test_vehicle_fleet.cpp" },
+		{ "Test_MlcpSolver", "test_mlcp_solver.cpp" },
+		{ "Test_MultiBodyParallel", "test_multibody_parallel.cpp" },
+	}
+
+	for _, test in ipairs(dynamicsTests) do
+
+	project (test[1])
+
+	kind "ConsoleApp"
+
+	includedirs
+	{
+		".",
+		"../../src",
+		"../gtest-1.7.0/include"
+
+	}
+
+
+	if os.is("Windows") then
+		--see http://stackoverflow.com/questions/12558327/google-test-in-visual-studio-2012
+		defines {"_VARIADIC_MAX=10"}
+	end
+
+	links {"BulletDynamics", "BulletCollision", "LinearMath", "gtest"}
+
+	files {
+		test[2],
+		"../Utils/TestTaskScheduler.h",
+	}
+
+	if os.is("Linux") then
+                links {"pthread"}
+        end
+
+	end
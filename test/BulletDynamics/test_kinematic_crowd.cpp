@@ -0,0 +1,270 @@
+// btKinematicCrowdController: characters of a crowd have to walk, slide, step up and fall like the same
+// characters driven by btKinematicCharacterController, and give the same result on several threads.
+
+#include <string.h>
+
+#include <gtest/gtest.h>
+
+#include "btBulletDynamicsCommon.h"
+#include "BulletCollision/CollisionDispatch/btGhostObject.h"
+#include "BulletDynamics/Character/btKinematicCharacterController.h"
+#include "BulletDynamics/Character/btKinematicCrowdController.h"
+#include "LinearMath/btThreads.h"
+#include "../Utils/TestTaskScheduler.h"
+
+const int kNumPaths = 5;
+const int kNumSteps = 240;
+const btScalar kTimeStep = btScalar(1.) / btScalar(60.);
+const btScalar kStepHeight = btScalar(0.35);
+// height of the capsule center above the ground when the character stands, the sweeps keep the collision margin
+const btScalar kRestHeight = btScalar(0.76);
+
+// every path has its own lane along x: walk into a wall at an angle, walk up a step, walk off a ledge,
+// walk into another character, jump
+static btVector3 startPosition(int path) { return btVector3(0, path == 2 ? kRestHeight + 2 : kRestHeight, btScalar(path * 10)); }
+
+static btVector3 walkDirection(int path) {
+    switch (path) {
+        case 0:
+            return btVector3(btScalar(0.05), 0, btScalar(0.03));
+        case 3:
+            // two characters walk towards each other, see opponentStartPosition
+            return btVector3(btScalar(0.04), 0, 0);
+        default:
+            return btVector3(btScalar(0.05), 0, 0);
+    }
+}
+
+// the character that path 3 walks into, it starts at the end of the lane and walks back
+static btVector3 opponentStartPosition() { return btVector3(6, kRestHeight, 30); }
+static btVector3 opponentWalkDirection() { return btVector3(btScalar(-0.04), 0, 0); }
+
+// the static scene that is shared by both worlds, and the shapes of the characters
+class CharacterScene {
+public:
+    CharacterScene() {
+        m_collisionConfiguration = new btDefaultCollisionConfiguration();
+        m_dispatcher = new btCollisionDispatcher(m_collisionConfiguration);
+        m_broadphase = new btDbvtBroadphase();
+        m_ghostPairCallback = new btGhostPairCallback();
+        m_broadphase->getOverlappingPairCache()->setInternalGhostPairCallback(m_ghostPairCallback);
+        m_solver = new btSequentialImpulseConstraintSolver();
+        m_world = new btDiscreteDynamicsWorld(m_dispatcher, m_broadphase, m_solver, m_collisionConfiguration);
+
+        addStaticBox(btVector3(50, 1, 50), btVector3(0, -1, 20));
+        // path 0: a wall across the lane
+        addStaticBox(btVector3(btScalar(0.2), 2, 5), btVector3(5, 2, 0));
+        // path 1: a low step, the capsule walks up its edge
+        addStaticBox(btVector3(3, btScalar(0.05), 2), btVector3(6, btScalar(0.05), 10));
+        // path 2: a platform to walk off
+        addStaticBox(btVector3(3, 1, 2), btVector3(0, 1, 20));
+
+        m_characterShape = new btCapsuleShape(btScalar(0.3), btScalar(1.0));
+    }
+
+    virtual ~CharacterScene() {
+        for (int i = m_world->getNumCollisionObjects() - 1; i >= 0; i--) {
+            btCollisionObject* obj = m_world->getCollisionObjectArray()[i];
+            m_world->removeCollisionObject(obj);
+            delete obj;
+        }
+        for (int i = 0; i < m_shapes.size(); i++) {
+            delete m_shapes[i];
+        }
+        delete m_characterShape;
+        delete m_world;
+        delete m_solver;
+        delete m_ghostPairCallback;
+        delete m_broadphase;
+        delete m_dispatcher;
+        delete m_collisionConfiguration;
+    }
+
+    void addStaticBox(const btVector3& halfExtents, const btVector3& origin) {
+        btCollisionShape* shape = new btBoxShape(halfExtents);
+        m_shapes.push_back(shape);
+        btCollisionObject* obj = new btCollisionObject();
+        obj->setCollisionShape(shape);
+        obj->getWorldTransform().setOrigin(origin);
+        m_world->addCollisionObject(obj, btBroadphaseProxy::StaticFilter,
+                                    btBroadphaseProxy::AllFilter ^ btBroadphaseProxy::StaticFilter);
+    }
+
+    btCollisionObject* addCharacterObject(btCollisionObject* obj, const btVector3& position) {
+        obj->setCollisionShape(m_characterShape);
+        obj->getWorldTransform().setIdentity();
+        obj->getWorldTransform().setOrigin(position);
+        obj->setCollisionFlags(btCollisionObject::CF_CHARACTER_OBJECT);
+        m_world->addCollisionObject(obj, btBroadphaseProxy::CharacterFilter,
+                                    btBroadphaseProxy::StaticFilter | btBroadphaseProxy::DefaultFilter |
+                                        btBroadphaseProxy::CharacterFilter);
+        return obj;
+    }
+
+    btDefaultCollisionConfiguration* m_collisionConfiguration;
+    btCollisionDispatcher* m_dispatcher;
+    btBroadphaseInterface* m_broadphase;
+    btGhostPairCallback* m_ghostPairCallback;
+    btSequentialImpulseConstraintSolver* m_solver;
+    btDiscreteDynamicsWorld* m_world;
+    btAlignedObjectArray<btCollisionShape*> m_shapes;
+    btCapsuleShape* m_characterShape;
+};
+
+// one btKinematicCharacterController per path
+class ControllerScene : public CharacterScene {
+public:
+    ControllerScene() {
+        for (int i = 0; i <= kNumPaths; i++) {
+            btPairCachingGhostObject* ghost = new btPairCachingGhostObject();
+            addCharacterObject(ghost, i < kNumPaths ? startPosition(i) : opponentStartPosition());
+            btKinematicCharacterController* controller =
+                new btKinematicCharacterController(ghost, m_characterShape, kStepHeight);
+            controller->setWalkDirection(i < kNumPaths ? walkDirection(i) : opponentWalkDirection());
+            m_world->addAction(controller);
+            m_objects.push_back(ghost);
+            m_controllers.push_back(controller);
+        }
+    }
+
+    virtual ~ControllerScene() {
+        for (int i = 0; i < m_controllers.size(); i++) {
+            m_world->removeAction(m_controllers[i]);
+            delete m_controllers[i];
+        }
+    }
+
+    void jump(int i) { m_controllers[i]->jump(); }
+    bool onGround(int i) const { return m_controllers[i]->onGround(); }
+
+    btAlignedObjectArray<btCollisionObject*> m_objects;
+    btAlignedObjectArray<btKinematicCharacterController*> m_controllers;
+};
+
+// the same characters in one btKinematicCrowdController
+class CrowdScene : public CharacterScene {
+public:
+    CrowdScene() {
+        for (int i = 0; i <= kNumPaths; i++) {
+            btCollisionObject* obj =
+                addCharacterObject(new btCollisionObject(), i < kNumPaths ? startPosition(i) : opponentStartPosition());
+            int index = m_crowd.addCharacter(obj, m_characterShape, kStepHeight);
+            m_crowd.setWalkDirection(index, i < kNumPaths ? walkDirection(i) : opponentWalkDirection());
+            m_objects.push_back(obj);
+        }
+        m_world->addAction(&m_crowd);
+    }
+
+    virtual ~CrowdScene() { m_world->removeAction(&m_crowd); }
+
+    void jump(int i) { m_crowd.jump(i); }
+    bool onGround(int i) const { return m_crowd.getCharacter(i).onGround(); }
+
+    btKinematicCrowdController m_crowd;
+    btAlignedObjectArray<btCollisionObject*> m_objects;
+};
+
+template <class Scene>
+static void step(Scene& scene, int stepIndex) {
+    if (stepIndex == 100 && scene.onGround(4)) {
+        scene.jump(4);
+    }
+    scene.m_world->stepSimulation(kTimeStep, 0);
+}
+
+// the positions of all characters after each step
+template <class Scene>
+static void simulate(Scene& scene, btAlignedObjectArray<btVector3>& positions) {
+    for (int s = 0; s < kNumSteps; s++) {
+        step(scene, s);
+        for (int i = 0; i <= kNumPaths; i++) {
+            positions.push_back(scene.m_objects[i]->getWorldTransform().getOrigin());
+        }
+    }
+}
+
+static const btVector3& position(const btAlignedObjectArray<btVector3>& positions, int stepIndex, int character) {
+    return positions[stepIndex * (kNumPaths + 1) + character];
+}
+
+static void expectNear(const btVector3& expected, const btVector3& actual, btScalar tolerance, int character, int stepIndex) {
+    EXPECT_NEAR(expected.x(), actual.x(), tolerance) << "character " << character << " step " << stepIndex;
+    EXPECT_NEAR(expected.y(), actual.y(), tolerance) << "character " << character << " step " << stepIndex;
+    EXPECT_NEAR(expected.z(), actual.z(), tolerance) << "character " << character << " step " << stepIndex;
+}
+
+// what has to happen on each path, with either controller
+static void expectCollisions(const btAlignedObjectArray<btVector3>& positions, const char* name) {
+    SCOPED_TRACE(name);
+    // the wall stops the character until it slid past its end, the face of the wall is at x=4.8
+    for (int s = 0; s < kNumSteps; s++) {
+        const btVector3& p = position(positions, s, 0);
+        if (p.z() < btScalar(5.)) {
+            ASSERT_LT(p.x(), btScalar(4.8 - 0.3 + 0.07)) << "step " << s;
+        }
+    }
+    EXPECT_GT(position(positions, kNumSteps - 1, 0).x(), btScalar(6.));
+    // on top of the step
+    EXPECT_NEAR(position(positions, 120, 1).y(), kRestHeight + 0.1, 0.01);
+    // down from the platform
+    EXPECT_NEAR(position(positions, 120, 2).y(), kRestHeight, 0.01);
+    // the two characters stopped each other
+    btScalar distance = (position(positions, kNumSteps - 1, 3) - position(positions, kNumSteps - 1, kNumPaths)).length();
+    EXPECT_GT(distance, 0.6 - 0.07);
+    EXPECT_LT(distance, 0.6 + 0.07);
+    // jumped and landed again
+    btScalar maxJumpHeight = 0;
+    for (int s = 0; s < kNumSteps; s++) {
+        maxJumpHeight = btMax(maxJumpHeight, position(positions, s, 4).y());
+    }
+    EXPECT_GT(maxJumpHeight, kRestHeight + 0.5);
+    EXPECT_NEAR(position(positions, kNumSteps - 1, 4).y(), kRestHeight, 0.01);
+}
+
+TEST(KinematicCrowdController, CollidesLikeCharacterController) {
+    btAlignedObjectArray<btVector3> expected;
+    btAlignedObjectArray<btVector3> actual;
+    {
+        ControllerScene controllers;
+        simulate(controllers, expected);
+    }
+    {
+        CrowdScene crowd;
+        simulate(crowd, actual);
+    }
+    expectCollisions(expected, "btKinematicCharacterController");
+    expectCollisions(actual, "btKinematicCrowdController");
+
+    // walking, stepping up and jumping follow the same path, the rounded capsule climbs the edge of the step a bit
+    // differently. The crowd slides along the wall and the other character without the jitter of the manifold based
+    // penetration recovery, and sees the ground one step earlier when falling, as it doesn't wait for the pair cache
+    // of a ghost object
+    for (int s = 0; s < kNumSteps; s++) {
+        expectNear(position(expected, s, 1), position(actual, s, 1), btScalar(0.01), 1, s);
+        expectNear(position(expected, s, 4), position(actual, s, 4), btScalar(1e-3), 4, s);
+    }
+    expectNear(position(expected, kNumSteps - 1, 2), position(actual, kNumSteps - 1, 2), btScalar(0.01), 2, kNumSteps - 1);
+}
+
+TEST(KinematicCrowdController, MultithreadedMatchesSequential) {
+    CrowdScene sequential;
+    CrowdScene parallel;
+    parallel.m_crowd.setMultithreaded(true);
+    TestTaskScheduler scheduler(4);
+    for (int s = 0; s < kNumSteps; s++) {
+        step(sequential, s);
+        btSetTaskScheduler(&scheduler);
+        step(parallel, s);
+        btSetTaskScheduler(0);
+        for (int i = 0; i <= kNumPaths; i++) {
+            const btVector3& expected = sequential.m_objects[i]->getWorldTransform().getOrigin();
+            const btVector3& actual = parallel.m_objects[i]->getWorldTransform().getOrigin();
+            ASSERT_EQ(0, memcmp(&expected, &actual, 3 * sizeof(btScalar))) << "character " << i << " step " << s;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,303 @@
+// btMLCPSolver: the sparse MLCP matrix of createMLCPSparse has to hold the same A and b as the dense matrix of
+// createMLCPFast, on one thread and on several. The active set warm start has to save MLCP solves on a resting stack.
+
+#include <string.h>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "btBulletDynamicsCommon.h"
+#include "BulletDynamics/MLCPSolvers/btMLCPSolver.h"
+#include "BulletDynamics/MLCPSolvers/btSolveProjectedGaussSeidel.h"
+#include "BulletDynamics/MLCPSolvers/btDantzigSolver.h"
+#include "LinearMath/btThreads.h"
+#include "../Utils/TestTaskScheduler.h"
+
+const int kNumSteps = 60;
+const btScalar kTimeStep = btScalar(1.) / btScalar(60.);
+
+// builds both matrices before every solve and compares them, then solves with the one the MLCP solver asked for
+class AssemblyCheckingSolver : public btMLCPSolver {
+public:
+    explicit AssemblyCheckingSolver(btMLCPSolverInterface* solver) : btMLCPSolver(solver), m_numChecks(0), m_maxRows(0) {}
+
+    virtual bool solveMLCP(const btContactSolverInfo& infoGlobal) {
+        if (m_b.rows()) {
+            compareAssemblies(infoGlobal);
+        }
+        return btMLCPSolver::solveMLCP(infoGlobal);
+    }
+
+    void compareAssemblies(const btContactSolverInfo& infoGlobal) {
+        const bool multithreaded = isMultithreaded();
+        setMultithreaded(false);
+        createMLCPSparse(infoGlobal);
+        btSparseMatrixXu sparseA = m_sparseA;
+        btVectorXu sparseB = m_b;
+        btVectorXu sparseBSplit = m_bSplit;
+        btVectorXu sparseLo = m_lo;
+        btVectorXu sparseHi = m_hi;
+        if (multithreaded) {
+            // the block rows are filled independently, so the threads produce the same values
+            setMultithreaded(true);
+            createMLCPSparse(infoGlobal);
+            ASSERT_EQ(sparseA.nonZeros(), m_sparseA.nonZeros());
+            ASSERT_EQ(0, memcmp(&sparseA.m_values[0], &m_sparseA.m_values[0], sparseA.nonZeros() * sizeof(btScalar)));
+            ASSERT_EQ(0, memcmp(&sparseA.m_blockColumn[0], &m_sparseA.m_blockColumn[0],
+                                sparseA.m_blockColumn.size() * sizeof(int)));
+        }
+
+        createMLCPFast(infoGlobal);
+        const int n = m_b.rows();
+        ASSERT_EQ(n, sparseA.rows());
+        ASSERT_EQ(n, m_A.rows());
+        ASSERT_EQ(n, m_A.cols());
+        for (int i = 0; i < n; i++) {
+            ASSERT_EQ(m_b[i], sparseB[i]) << "row " << i;
+            ASSERT_EQ(m_bSplit[i], sparseBSplit[i]) << "row " << i;
+            ASSERT_EQ(m_lo[i], sparseLo[i]) << "row " << i;
+            ASSERT_EQ(m_hi[i], sparseHi[i]) << "row " << i;
+            for (int j = 0; j < n; j++) {
+                // the coupling sums are added up in another order
+                const btScalar expected = m_A(i, j);
+                ASSERT_NEAR(expected, sparseA(i, j), btScalar(1e-5) * (1 + btFabs(expected))) << "element " << i << ", " << j;
+            }
+        }
+        // the diagonal holds the cfm on top of the coupling of the rows with themselves
+        for (int i = 0; i < n; i++) {
+            ASSERT_EQ(sparseA(i, i), sparseA.getDiagonal(i));
+        }
+        m_numChecks++;
+        m_maxRows = btMax(m_maxRows, n);
+
+        setMultithreaded(multithreaded);
+        if (m_useSparseMatrix) {
+            createMLCPSparse(infoGlobal);
+        }
+    }
+
+    int m_numChecks;
+    int m_maxRows;
+};
+
+// boxes on the static ground, stepped with the given btMLCPSolver
+class MlcpWorld {
+public:
+    explicit MlcpWorld(btMLCPSolver* solver) {
+        m_collisionConfiguration = new btDefaultCollisionConfiguration();
+        m_dispatcher = new btCollisionDispatcher(m_collisionConfiguration);
+        m_broadphase = new btDbvtBroadphase();
+        m_world = new btDiscreteDynamicsWorld(m_dispatcher, m_broadphase, solver, m_collisionConfiguration);
+        m_world->setGravity(btVector3(0, -10, 0));
+        // the MLCP solvers get one problem per island
+        m_world->getSolverInfo().m_minimumSolverBatchSize = 1;
+
+        m_groundShape = new btBoxShape(btVector3(20, 1, 20));
+        addBody(m_groundShape, 0, btVector3(0, -1, 0));
+        m_boxShape = new btBoxShape(btVector3(btScalar(0.5), btScalar(0.25), btScalar(0.5)));
+    }
+
+    // a stack of boxes resting on the ground, slightly shifted
+    void addStack(int numBoxes, btScalar shift) {
+        for (int i = 0; i < numBoxes; i++) {
+            m_stack.push_back(addBody(m_boxShape, 1, btVector3(shift * i, btScalar(0.25) + btScalar(0.5) * i, 0)));
+        }
+    }
+
+    // a chain of boxes with ball joints that hangs from a kinematic box
+    void addChain(const btVector3& anchorOrigin) {
+        btRigidBody* anchor = addBody(m_boxShape, 0, anchorOrigin);
+        anchor->setCollisionFlags(anchor->getCollisionFlags() | btCollisionObject::CF_KINEMATIC_OBJECT);
+        anchor->setActivationState(DISABLE_DEACTIVATION);
+        btRigidBody* previous = anchor;
+        for (int i = 0; i < 5; i++) {
+            btRigidBody* link = addBody(m_boxShape, 1, anchorOrigin + btVector3(btScalar(0.6) * (i + 1), 0, 0));
+            btPoint2PointConstraint* joint =
+                new btPoint2PointConstraint(*previous, *link, btVector3(btScalar(0.3), 0, 0), btVector3(btScalar(-0.3), 0, 0));
+            m_world->addConstraint(joint, true);
+            m_constraints.push_back(joint);
+            previous = link;
+        }
+    }
+
+    virtual ~MlcpWorld() {
+        for (size_t i = 0; i < m_constraints.size(); i++) {
+            m_world->removeConstraint(m_constraints[i]);
+            delete m_constraints[i];
+        }
+        for (int i = m_world->getNumCollisionObjects() - 1; i >= 0; i--) {
+            btCollisionObject* obj = m_world->getCollisionObjectArray()[i];
+            m_world->removeCollisionObject(obj);
+            delete obj;
+        }
+        delete m_boxShape;
+        delete m_groundShape;
+        delete m_world;
+        delete m_broadphase;
+        delete m_dispatcher;
+        delete m_collisionConfiguration;
+    }
+
+    btRigidBody* addBody(btCollisionShape* shape, btScalar mass, const btVector3& origin) {
+        btVector3 localInertia(0, 0, 0);
+        if (mass != 0) {
+            shape->calculateLocalInertia(mass, localInertia);
+        }
+        btRigidBody* body = new btRigidBody(btRigidBody::btRigidBodyConstructionInfo(mass, 0, shape, localInertia));
+        body->setWorldTransform(btTransform(btQuaternion::getIdentity(), origin));
+        m_world->addRigidBody(body);
+        return body;
+    }
+
+    btDefaultCollisionConfiguration* m_collisionConfiguration;
+    btCollisionDispatcher* m_dispatcher;
+    btBroadphaseInterface* m_broadphase;
+    btDiscreteDynamicsWorld* m_world;
+    btCollisionShape* m_groundShape;
+    btCollisionShape* m_boxShape;
+    std::vector<btTypedConstraint*> m_constraints;
+    std::vector<btRigidBody*> m_stack;
+};
+
+// a chain that swings onto a stack, so the problems have contacts, friction, joint rows and a kinematic body
+static void expectSameAssemblies(btMLCPSolverInterface* mlcp, bool multithreaded) {
+    AssemblyCheckingSolver solver(mlcp);
+    MlcpWorld world(&solver);
+    world.addStack(4, btScalar(0.02));
+    world.addChain(btVector3(3, 5, 0));
+    solver.setMultithreaded(multithreaded);
+    TestTaskScheduler scheduler(4);
+    if (multithreaded) {
+        btSetTaskScheduler(&scheduler);
+    }
+    for (int s = 0; s < kNumSteps && !::testing::Test::HasFatalFailure(); s++) {
+        world.m_world->stepSimulation(kTimeStep, 0);
+    }
+    btSetTaskScheduler(0);
+    // contacts, friction and joint rows were assembled in every step
+    EXPECT_GE(solver.m_numChecks, kNumSteps);
+    EXPECT_GT(solver.m_maxRows, 20);
+}
+
+TEST(MlcpSolver, SparseAssemblyMatchesDenseWithProjectedGaussSeidel) {
+    btSolveProjectedGaussSeidel mlcp;
+    expectSameAssemblies(&mlcp, false);
+}
+
+TEST(MlcpSolver, SparseAssemblyMatchesDenseWithDantzig) {
+    btDantzigSolver mlcp;
+    expectSameAssemblies(&mlcp, false);
+}
+
+TEST(MlcpSolver, MultithreadedSparseAssemblyMatchesDense) {
+    btSolveProjectedGaussSeidel mlcp;
+    expectSameAssemblies(&mlcp, true);
+}
+
+// counts the MLCPs that reach the pivoting solver
+class CountingDantzigSolver : public btDantzigSolver {
+public:
+    CountingDantzigSolver() : m_numSolves(0) {}
+    virtual bool solveMLCP(const btMatrixXu& A, const btVectorXu& b, btVectorXu& x, const btVectorXu& lo,
+                           const btVectorXu& hi, const btAlignedObjectArray<int>& limitDependency, int numIterations,
+                           bool useSparsity = true) {
+        m_numSolves++;
+        return btDantzigSolver::solveMLCP(A, b, x, lo, hi, limitDependency, numIterations, useSparsity);
+    }
+    int m_numSolves;
+};
+
+// the heights of the boxes of a resting stack after kNumRestingSteps
+const int kNumRestingSteps = 240;
+
+static void simulateRestingStack(bool warmStart, CountingDantzigSolver& mlcp, btMLCPSolver& solver,
+                                 std::vector<btScalar>& heights) {
+    solver.setWarmStartActiveSet(warmStart);
+    MlcpWorld world(&solver);
+    world.addStack(6, 0);
+    for (size_t i = 0; i < world.m_stack.size(); i++) {
+        world.m_stack[i]->setActivationState(DISABLE_DEACTIVATION);
+    }
+    for (int s = 0; s < kNumRestingSteps; s++) {
+        world.m_world->stepSimulation(kTimeStep, 0);
+    }
+    heights.clear();
+    for (size_t i = 0; i < world.m_stack.size(); i++) {
+        heights.push_back(world.m_stack[i]->getWorldTransform().getOrigin().y());
+    }
+}
+
+TEST(MlcpSolver, ActiveSetWarmStartSavesSolvesOnRestingStack) {
+    CountingDantzigSolver coldMlcp;
+    btMLCPSolver coldSolver(&coldMlcp);
+    std::vector<btScalar> coldHeights;
+    simulateRestingStack(false, coldMlcp, coldSolver, coldHeights);
+    CountingDantzigSolver warmMlcp;
+    btMLCPSolver warmSolver(&warmMlcp);
+    std::vector<btScalar> warmHeights;
+    simulateRestingStack(true, warmMlcp, warmSolver, warmHeights);
+
+    // every step solves the velocity and the split impulse MLCPs with Dantzig, the warm start guesses most of them
+    // the first steps, before the boxes touch each other, have no split impulse MLCP
+    EXPECT_GE(coldMlcp.m_numSolves, 2 * kNumRestingSteps - 2);
+    EXPECT_EQ(0, coldSolver.getNumActiveSetHits());
+    EXPECT_GT(warmSolver.getNumActiveSetHits(), kNumRestingSteps);
+    EXPECT_LT(warmMlcp.m_numSolves, coldMlcp.m_numSolves / 4);
+    // the guessed solutions are MLCP solutions, the stack rests at the same heights
+    for (size_t i = 0; i < coldHeights.size(); i++) {
+        EXPECT_NEAR(btScalar(0.25) + btScalar(0.5) * i, warmHeights[i], btScalar(0.02)) << "box " << i;
+        EXPECT_NEAR(coldHeights[i], warmHeights[i], btScalar(1e-3)) << "box " << i;
+    }
+}
+
+// the five ball joints of the chain are the first rows of every problem
+const int kNumChainJointRows = 15;
+
+// the joint rows that the sparse solver starts from
+class StartRecordingGaussSeidel : public btSolveProjectedGaussSeidel {
+public:
+    StartRecordingGaussSeidel() : m_numWarmStarts(0), m_numSolves(0) {}
+    virtual bool solveSparseMLCP(const btSparseMatrixXu& A, const btVectorXu& b, btVectorXu& x, const btVectorXu& lo,
+                                 const btVectorXu& hi, const btAlignedObjectArray<int>& limitDependency,
+                                 int numIterations) {
+        bool warmStarted = false;
+        for (int i = 0; i < kNumChainJointRows && i < x.rows(); i++) {
+            warmStarted = warmStarted || x[i] != 0;
+        }
+        m_numWarmStarts += warmStarted ? 1 : 0;
+        m_numSolves++;
+        return btSolveProjectedGaussSeidel::solveSparseMLCP(A, b, x, lo, hi, limitDependency, numIterations);
+    }
+    int m_numWarmStarts;
+    int m_numSolves;
+};
+
+TEST(MlcpSolver, SparseSolverStartsFromWarmStartedJointRows) {
+    for (int warmStart = 0; warmStart < 2; warmStart++) {
+        StartRecordingGaussSeidel mlcp;
+        btMLCPSolver solver(&mlcp);
+        solver.setWarmStartActiveSet(warmStart != 0);
+        {
+            // the contacts between the links are warm started either way, only the joint rows are checked
+            MlcpWorld world(&solver);
+            world.addChain(btVector3(0, 5, 0));
+            for (int s = 0; s < kNumSteps; s++) {
+                world.m_world->stepSimulation(kTimeStep, 0);
+            }
+        }
+        EXPECT_GE(mlcp.m_numSolves, kNumSteps) << "warm start " << warmStart;
+        // the active set solve is skipped on the sparse path
+        EXPECT_EQ(0, solver.getNumActiveSetHits()) << "warm start " << warmStart;
+        if (warmStart) {
+            // the steps after the first one start from the impulses of the previous step, unless the joints were idle
+            EXPECT_GT(mlcp.m_numWarmStarts, mlcp.m_numSolves * 9 / 10);
+        } else {
+            EXPECT_EQ(0, mlcp.m_numWarmStarts);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
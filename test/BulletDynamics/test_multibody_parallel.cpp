@@ -0,0 +1,252 @@
+// btMultiBodyConstraintSolver::setMultithreaded: solving the independent groups of multibody rows in parallel has
+// to give exactly the same joint positions and velocities as solving all rows in one group on one thread.
+// btMultiBodyDynamicsWorld::setMultithreaded: stepping the multibodies in parallel has to give exactly the same
+// state with the sequential scheduler and with several threads.
+
+#include <string.h>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "btBulletDynamicsCommon.h"
+#include "BulletDynamics/Featherstone/btMultiBody.h"
+#include "BulletDynamics/Featherstone/btMultiBodyConstraintSolver.h"
+#include "BulletDynamics/Featherstone/btMultiBodyDynamicsWorld.h"
+#include "BulletDynamics/Featherstone/btMultiBodyJointLimitConstraint.h"
+#include "BulletDynamics/Featherstone/btMultiBodyJointMotor.h"
+#include "BulletDynamics/Featherstone/btMultiBodyLinkCollider.h"
+#include "LinearMath/btThreads.h"
+#include "../Utils/TestTaskScheduler.h"
+
+const int kNumSteps = 120;
+const btScalar kTimeStep = btScalar(1.) / btScalar(60.);
+const int kNumMultiBodies = 10;
+const int kNumLinks = 3;
+
+// floating articulations and a rigid box that fall onto the ground, all solved in one call of the solver
+class MultiBodyWorld {
+public:
+    explicit MultiBodyWorld(btMultiBodyConstraintSolver* solver) : m_solver(solver) {
+        m_collisionConfiguration = new btDefaultCollisionConfiguration();
+        m_dispatcher = new btCollisionDispatcher(m_collisionConfiguration);
+        m_broadphase = new btDbvtBroadphase();
+        m_world = new btMultiBodyDynamicsWorld(m_dispatcher, m_broadphase, solver, m_collisionConfiguration);
+        m_world->setGravity(btVector3(0, -10, 0));
+        // the islands are batched, so the solver sees several independent groups at once
+        m_world->getSolverInfo().m_minimumSolverBatchSize = 1000;
+
+        m_groundShape = new btBoxShape(btVector3(30, 1, 30));
+        m_linkShape = new btBoxShape(btVector3(btScalar(0.1), btScalar(0.3), btScalar(0.1)));
+        m_boxShape = new btBoxShape(btVector3(btScalar(0.4), btScalar(0.2), btScalar(0.4)));
+        addRigidBody(m_groundShape, 0, btVector3(0, -1, 0));
+
+        for (int i = 0; i < kNumMultiBodies; i++) {
+            // the last one falls onto the one before it, and the third one onto the rigid box
+            const btVector3 basePos = i == kNumMultiBodies - 1
+                                          ? btVector3(btScalar(2) * (i - 1) + btScalar(0.2), 5, btScalar(0.1))
+                                          : btVector3(btScalar(2) * i, btScalar(2.5) + btScalar(0.1) * i, 0);
+            addMultiBody(basePos, btQuaternion(btVector3(1, 0, 1).normalized(), btScalar(0.3) * (i + 1)));
+        }
+        m_box = addRigidBody(m_boxShape, 1, btVector3(4, btScalar(0.2), 0));
+    }
+
+    virtual ~MultiBodyWorld() {
+        for (size_t i = 0; i < m_constraints.size(); i++) {
+            m_world->removeMultiBodyConstraint(m_constraints[i]);
+            delete m_constraints[i];
+        }
+        for (int i = m_world->getNumCollisionObjects() - 1; i >= 0; i--) {
+            btCollisionObject* obj = m_world->getCollisionObjectArray()[i];
+            m_world->removeCollisionObject(obj);
+            delete obj;
+        }
+        for (size_t i = 0; i < m_multiBodies.size(); i++) {
+            m_world->removeMultiBody(m_multiBodies[i]);
+            delete m_multiBodies[i];
+        }
+        delete m_boxShape;
+        delete m_linkShape;
+        delete m_groundShape;
+        delete m_world;
+        delete m_broadphase;
+        delete m_dispatcher;
+        delete m_collisionConfiguration;
+    }
+
+    btRigidBody* addRigidBody(btCollisionShape* shape, btScalar mass, const btVector3& origin) {
+        btVector3 localInertia(0, 0, 0);
+        if (mass != 0) {
+            shape->calculateLocalInertia(mass, localInertia);
+        }
+        btRigidBody* body = new btRigidBody(btRigidBody::btRigidBodyConstructionInfo(mass, 0, shape, localInertia));
+        body->setWorldTransform(btTransform(btQuaternion::getIdentity(), origin));
+        body->setActivationState(DISABLE_DEACTIVATION);
+        m_world->addRigidBody(body);
+        return body;
+    }
+
+    // a base with a revolute, a spherical and a revolute link, a joint limit on the first and a motor on the last
+    void addMultiBody(const btVector3& basePos, const btQuaternion& baseRot) {
+        btVector3 inertia;
+        m_linkShape->calculateLocalInertia(1, inertia);
+        btMultiBody* mb = new btMultiBody(kNumLinks, 1, inertia, false, false, false);
+        const btVector3 parentComToPivot(0, btScalar(-0.3), 0);
+        const btVector3 pivotToCom(0, btScalar(-0.3), 0);
+        const btQuaternion identity(0, 0, 0, 1);
+        mb->setupRevolute(0, 1, inertia, -1, identity, btVector3(0, 0, 1), parentComToPivot, pivotToCom, true);
+        mb->setupSpherical(1, 1, inertia, 0, identity, parentComToPivot, pivotToCom, true);
+        mb->setupRevolute(2, 1, inertia, 1, identity, btVector3(1, 0, 0), parentComToPivot, pivotToCom, true);
+        mb->finalizeMultiDof();
+        mb->setBasePos(basePos);
+        mb->setWorldToBaseRot(baseRot);
+        mb->setJointPos(0, btScalar(0.4));
+        mb->setJointVel(2, 2);
+        m_world->addMultiBody(mb);
+        m_multiBodies.push_back(mb);
+
+        for (int link = -1; link < kNumLinks; link++) {
+            btMultiBodyLinkCollider* collider = new btMultiBodyLinkCollider(mb, link);
+            collider->setCollisionShape(m_linkShape);
+            collider->setFriction(btScalar(0.8));
+            m_world->addCollisionObject(collider, btBroadphaseProxy::DefaultFilter, btBroadphaseProxy::AllFilter);
+            if (link < 0) {
+                mb->setBaseCollider(collider);
+            } else {
+                mb->getLink(link).m_collider = collider;
+            }
+        }
+        btAlignedObjectArray<btQuaternion> scratchQ;
+        btAlignedObjectArray<btVector3> scratchM;
+        mb->forwardKinematics(scratchQ, scratchM);
+        mb->updateCollisionObjectWorldTransforms(scratchQ, scratchM);
+
+        addConstraint(new btMultiBodyJointLimitConstraint(mb, 0, btScalar(-0.5), btScalar(0.5)));
+        addConstraint(new btMultiBodyJointMotor(mb, 2, btScalar(-1), btScalar(0.2)));
+    }
+
+    void addConstraint(btMultiBodyConstraint* constraint) {
+        m_world->addMultiBodyConstraint(constraint);
+        m_constraints.push_back(constraint);
+    }
+
+    // base transforms, joint positions and all velocities, and the state of the rigid box
+    void getState(std::vector<btScalar>& state) const {
+        state.clear();
+        for (size_t i = 0; i < m_multiBodies.size(); i++) {
+            const btMultiBody* mb = m_multiBodies[i];
+            const btVector3& pos = mb->getBasePos();
+            const btQuaternion& rot = mb->getWorldToBaseRot();
+            state.insert(state.end(), &pos[0], &pos[0] + 3);
+            state.push_back(rot.x());
+            state.push_back(rot.y());
+            state.push_back(rot.z());
+            state.push_back(rot.w());
+            for (int link = 0; link < mb->getNumLinks(); link++) {
+                const btScalar* q = mb->getJointPosMultiDof(link);
+                state.insert(state.end(), q, q + mb->getLink(link).m_posVarCount);
+            }
+            const btScalar* qdot = mb->getVelocityVector();
+            state.insert(state.end(), qdot, qdot + 6 + mb->getNumDofs());
+        }
+        const btTransform& tr = m_box->getWorldTransform();
+        state.insert(state.end(), &tr.getOrigin()[0], &tr.getOrigin()[0] + 3);
+        for (int r = 0; r < 3; r++) {
+            state.insert(state.end(), &tr.getBasis()[r][0], &tr.getBasis()[r][0] + 3);
+        }
+        state.insert(state.end(), &m_box->getLinearVelocity()[0], &m_box->getLinearVelocity()[0] + 3);
+        state.insert(state.end(), &m_box->getAngularVelocity()[0], &m_box->getAngularVelocity()[0] + 3);
+    }
+
+    btMultiBodyConstraintSolver* m_solver;
+    btDefaultCollisionConfiguration* m_collisionConfiguration;
+    btCollisionDispatcher* m_dispatcher;
+    btBroadphaseInterface* m_broadphase;
+    btMultiBodyDynamicsWorld* m_world;
+    btCollisionShape* m_groundShape;
+    btCollisionShape* m_linkShape;
+    btCollisionShape* m_boxShape;
+    btRigidBody* m_box;
+    std::vector<btMultiBody*> m_multiBodies;
+    std::vector<btMultiBodyConstraint*> m_constraints;
+};
+
+TEST(MultiBodyParallel, IndependentGroupSolveMatchesSingleGroupSolve) {
+    btMultiBodyConstraintSolver expectedSolver;
+    btMultiBodyConstraintSolver actualSolver;
+    actualSolver.setMultithreaded(true);
+    MultiBodyWorld expected(&expectedSolver);
+    MultiBodyWorld actual(&actualSolver);
+    TestTaskScheduler scheduler(4);
+    std::vector<btScalar> expectedState;
+    std::vector<btScalar> actualState;
+    int minGroups = kNumMultiBodies;
+    int maxGroups = 0;
+    for (int s = 0; s < kNumSteps; s++) {
+        expected.m_world->stepSimulation(kTimeStep, 0);
+        btSetTaskScheduler(&scheduler);
+        actual.m_world->stepSimulation(kTimeStep, 0);
+        btSetTaskScheduler(0);
+        EXPECT_EQ(0, expectedSolver.getNumIndependentGroups());
+        minGroups = btMin(minGroups, actualSolver.getNumIndependentGroups());
+        maxGroups = btMax(maxGroups, actualSolver.getNumIndependentGroups());
+        expected.getState(expectedState);
+        actual.getState(actualState);
+        ASSERT_EQ(expectedState.size(), actualState.size());
+        ASSERT_EQ(0, memcmp(&expectedState[0], &actualState[0], expectedState.size() * sizeof(btScalar))) << "step " << s;
+    }
+    // each articulation has its joint rows, and the two that fall onto each other share a group while they touch
+    EXPECT_EQ(kNumMultiBodies, maxGroups);
+    EXPECT_EQ(kNumMultiBodies - 1, minGroups);
+    EXPECT_GT(actual.m_dispatcher->getNumManifolds(), kNumMultiBodies * 4);
+}
+
+// steps a serial world, a multithreaded world on the sequential scheduler and one on four threads
+static void expectSameSteps(bool useRK4) {
+    btMultiBodyConstraintSolver serialSolver;
+    btMultiBodyConstraintSolver sequentialSolver;
+    btMultiBodyConstraintSolver parallelSolver;
+    MultiBodyWorld serial(&serialSolver);
+    MultiBodyWorld sequential(&sequentialSolver);
+    MultiBodyWorld parallel(&parallelSolver);
+    sequential.m_world->setMultithreaded(true);
+    parallel.m_world->setMultithreaded(true);
+    for (int i = 0; i < kNumMultiBodies; i++) {
+        serial.m_multiBodies[i]->useRK4Integration(useRK4);
+        sequential.m_multiBodies[i]->useRK4Integration(useRK4);
+        parallel.m_multiBodies[i]->useRK4Integration(useRK4);
+    }
+    TestTaskScheduler scheduler(4);
+    std::vector<btScalar> serialState;
+    std::vector<btScalar> sequentialState;
+    std::vector<btScalar> parallelState;
+    for (int s = 0; s < kNumSteps; s++) {
+        ASSERT_EQ(btGetSequentialTaskScheduler(), btGetTaskScheduler());
+        serial.m_world->stepSimulation(kTimeStep, 0);
+        sequential.m_world->stepSimulation(kTimeStep, 0);
+        btSetTaskScheduler(&scheduler);
+        parallel.m_world->stepSimulation(kTimeStep, 0);
+        btSetTaskScheduler(0);
+        serial.getState(serialState);
+        sequential.getState(sequentialState);
+        parallel.getState(parallelState);
+        ASSERT_EQ(serialState.size(), parallelState.size());
+        ASSERT_EQ(0, memcmp(&serialState[0], &sequentialState[0], serialState.size() * sizeof(btScalar))) << "step " << s;
+        ASSERT_EQ(0, memcmp(&sequentialState[0], &parallelState[0], serialState.size() * sizeof(btScalar))) << "step " << s;
+    }
+    // the colliders followed the links
+    for (int i = 0; i < kNumMultiBodies; i++) {
+        const btMultiBody* mb = parallel.m_multiBodies[i];
+        const btVector3& origin = mb->getBaseCollider()->getWorldTransform().getOrigin();
+        EXPECT_EQ(0, memcmp(&mb->getBasePos()[0], &origin[0], 3 * sizeof(btScalar))) << "multibody " << i;
+    }
+    EXPECT_GT(parallel.m_dispatcher->getNumManifolds(), kNumMultiBodies * 4);
+}
+
+TEST(MultiBodyParallel, ParallelStepMatchesSequentialStep) { expectSameSteps(false); }
+
+TEST(MultiBodyParallel, ParallelRungeKuttaStepMatchesSequentialStep) { expectSameSteps(true); }
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,228 @@
+// btRaycastVehicleManager: a fleet updated with one batch of wheel rays has to end up in exactly the same state
+// as the same vehicles updated one by one, each with its own castRay per wheel.
+
+#include <string.h>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "btBulletDynamicsCommon.h"
+#include "BulletDynamics/Vehicle/btRaycastVehicleManager.h"
+#include "LinearMath/btThreads.h"
+#include "../Utils/TestTaskScheduler.h"
+
+const int kNumVehicles = 12;
+const int kNumSteps = 180;
+const btScalar kTimeStep = btScalar(1.) / btScalar(60.);
+
+enum FleetUpdate {
+    // every vehicle is an action of the world
+    UPDATE_VEHICLES,
+    // a btRaycastVehicleManager with btDefaultVehicleRaycaster::castRays
+    UPDATE_MANAGER,
+    // the same, the rays on several threads
+    UPDATE_MANAGER_MULTITHREADED,
+    // a btRaycastVehicleManager with the castRays fallback that loops castRay
+    UPDATE_MANAGER_SINGLE_RAYS
+};
+
+// leaves castRays alone, so the base class loops castRay
+class SingleRayVehicleRaycaster : public btDefaultVehicleRaycaster {
+public:
+    explicit SingleRayVehicleRaycaster(btDynamicsWorld* world) : btDefaultVehicleRaycaster(world) {}
+    virtual void castRays(int numRays, const btVector3* from, const btVector3* to, btVehicleRaycasterResult* results,
+                          void** hitObjects) {
+        btVehicleRaycaster::castRays(numRays, from, to, results, hitObjects);
+    }
+};
+
+// vehicles on a bumpy ground, each with its own engine force and steering
+class VehicleFleet {
+public:
+    explicit VehicleFleet(FleetUpdate update) {
+        m_collisionConfiguration = new btDefaultCollisionConfiguration();
+        m_dispatcher = new btCollisionDispatcher(m_collisionConfiguration);
+        m_broadphase = new btDbvtBroadphase();
+        m_solver = new btSequentialImpulseConstraintSolver();
+        m_world = new btDiscreteDynamicsWorld(m_dispatcher, m_broadphase, m_solver, m_collisionConfiguration);
+        m_world->setGravity(btVector3(0, -10, 0));
+
+        btCollisionShape* groundShape = new btBoxShape(btVector3(100, 1, 100));
+        m_shapes.push_back(groundShape);
+        addBody(groundShape, 0, btTransform(btQuaternion::getIdentity(), btVector3(0, -1, 0)));
+        btCollisionShape* bumpShape = new btBoxShape(btVector3(1, btScalar(0.1), btScalar(0.3)));
+        m_shapes.push_back(bumpShape);
+        for (int i = 0; i < 40; i++) {
+            btTransform transform(btQuaternion(btVector3(0, 1, 0), btScalar(i * 0.7)),
+                                  btVector3(btScalar((i * 7) % 24 - 12), 0, btScalar(i % 10) * 2 + 3));
+            addBody(bumpShape, 0, transform);
+        }
+
+        m_chassisShape = new btBoxShape(btVector3(1, btScalar(0.5), 2));
+        m_shapes.push_back(m_chassisShape);
+        if (update == UPDATE_MANAGER_SINGLE_RAYS) {
+            m_raycaster = new SingleRayVehicleRaycaster(m_world);
+        } else {
+            btDefaultVehicleRaycaster* raycaster = new btDefaultVehicleRaycaster(m_world);
+            raycaster->setMultithreaded(update == UPDATE_MANAGER_MULTITHREADED);
+            m_raycaster = raycaster;
+        }
+        m_manager = update == UPDATE_VEHICLES ? 0 : new btRaycastVehicleManager(m_raycaster);
+        for (int i = 0; i < kNumVehicles; i++) {
+            addVehicle(btVector3(btScalar((i % 4) * 6 - 9), 1, btScalar((i / 4) * 6)));
+        }
+        if (m_manager) {
+            m_world->addAction(m_manager);
+        }
+    }
+
+    virtual ~VehicleFleet() {
+        if (m_manager) {
+            m_world->removeAction(m_manager);
+            delete m_manager;
+        }
+        for (size_t i = 0; i < m_vehicles.size(); i++) {
+            if (!m_manager) {
+                m_world->removeAction(m_vehicles[i]);
+            }
+            delete m_vehicles[i];
+        }
+        for (int i = m_world->getNumCollisionObjects() - 1; i >= 0; i--) {
+            btCollisionObject* obj = m_world->getCollisionObjectArray()[i];
+            m_world->removeCollisionObject(obj);
+            delete obj;
+        }
+        for (size_t i = 0; i < m_shapes.size(); i++) {
+            delete m_shapes[i];
+        }
+        delete m_raycaster;
+        delete m_world;
+        delete m_solver;
+        delete m_broadphase;
+        delete m_dispatcher;
+        delete m_collisionConfiguration;
+    }
+
+    btRigidBody* addBody(btCollisionShape* shape, btScalar mass, const btTransform& transform) {
+        btVector3 localInertia(0, 0, 0);
+        if (mass != 0) {
+            shape->calculateLocalInertia(mass, localInertia);
+        }
+        btRigidBody* body = new btRigidBody(btRigidBody::btRigidBodyConstructionInfo(mass, 0, shape, localInertia));
+        body->setWorldTransform(transform);
+        m_world->addRigidBody(body);
+        return body;
+    }
+
+    void addVehicle(const btVector3& position) {
+        btRigidBody* chassis = addBody(m_chassisShape, 800, btTransform(btQuaternion::getIdentity(), position));
+        chassis->setActivationState(DISABLE_DEACTIVATION);
+        btRaycastVehicle::btVehicleTuning tuning;
+        btRaycastVehicle* vehicle = new btRaycastVehicle(tuning, chassis, m_raycaster);
+        vehicle->setCoordinateSystem(0, 1, 2);
+        const btVector3 wheelDirection(0, -1, 0);
+        const btVector3 wheelAxle(-1, 0, 0);
+        for (int w = 0; w < 4; w++) {
+            btVector3 connectionPoint(w % 2 ? btScalar(-0.8) : btScalar(0.8), btScalar(0.2), w < 2 ? btScalar(1.5) : btScalar(-1.5));
+            btWheelInfo& wheel = vehicle->addWheel(connectionPoint, wheelDirection, wheelAxle, btScalar(0.6), btScalar(0.5),
+                                                   tuning, w < 2);
+            wheel.m_suspensionStiffness = 20;
+            wheel.m_wheelsDampingRelaxation = btScalar(2.3);
+            wheel.m_wheelsDampingCompression = btScalar(4.4);
+            wheel.m_frictionSlip = 1000;
+            wheel.m_rollInfluence = btScalar(0.1);
+        }
+        int index = (int)m_vehicles.size();
+        for (int w = 0; w < 4; w++) {
+            vehicle->applyEngineForce(btScalar(200 + 100 * (index % 5)), w);
+        }
+        vehicle->setSteeringValue(btScalar(0.05) * btScalar(index % 3 - 1), 0);
+        vehicle->setSteeringValue(btScalar(0.05) * btScalar(index % 3 - 1), 1);
+        if (!m_manager) {
+            m_world->addAction(vehicle);
+        } else {
+            m_manager->addVehicle(vehicle);
+        }
+        m_vehicles.push_back(vehicle);
+    }
+
+    // chassis and wheel state of all vehicles, the w components of the vectors are left out
+    void getState(std::vector<btScalar>& state) const {
+        state.clear();
+        for (size_t i = 0; i < m_vehicles.size(); i++) {
+            const btRigidBody* chassis = m_vehicles[i]->getRigidBody();
+            addVector(state, chassis->getWorldTransform().getOrigin());
+            for (int r = 0; r < 3; r++) {
+                addVector(state, chassis->getWorldTransform().getBasis()[r]);
+            }
+            addVector(state, chassis->getLinearVelocity());
+            addVector(state, chassis->getAngularVelocity());
+            for (int w = 0; w < m_vehicles[i]->getNumWheels(); w++) {
+                const btWheelInfo& wheel = m_vehicles[i]->getWheelInfo(w);
+                state.push_back(wheel.m_raycastInfo.m_isInContact ? 1 : 0);
+                state.push_back(wheel.m_raycastInfo.m_suspensionLength);
+                addVector(state, wheel.m_raycastInfo.m_contactPointWS);
+                state.push_back(wheel.m_rotation);
+                state.push_back(wheel.m_skidInfo);
+            }
+        }
+    }
+
+    static void addVector(std::vector<btScalar>& state, const btVector3& v) {
+        state.push_back(v.x());
+        state.push_back(v.y());
+        state.push_back(v.z());
+    }
+
+    btDefaultCollisionConfiguration* m_collisionConfiguration;
+    btCollisionDispatcher* m_dispatcher;
+    btBroadphaseInterface* m_broadphase;
+    btSequentialImpulseConstraintSolver* m_solver;
+    btDiscreteDynamicsWorld* m_world;
+    btCollisionShape* m_chassisShape;
+    btVehicleRaycaster* m_raycaster;
+    btRaycastVehicleManager* m_manager;
+    std::vector<btCollisionShape*> m_shapes;
+    std::vector<btRaycastVehicle*> m_vehicles;
+};
+
+class VehicleFleetTest : public ::testing::TestWithParam<FleetUpdate> {};
+
+TEST_P(VehicleFleetTest, MatchesVehicleUpdates) {
+    TestTaskScheduler scheduler(4);
+    if (GetParam() == UPDATE_MANAGER_MULTITHREADED) {
+        btSetTaskScheduler(&scheduler);
+    }
+    VehicleFleet expected(UPDATE_VEHICLES);
+    VehicleFleet actual(GetParam());
+    std::vector<btScalar> expectedState;
+    std::vector<btScalar> actualState;
+    int numContacts = 0;
+    for (int s = 0; s < kNumSteps; s++) {
+        expected.m_world->stepSimulation(kTimeStep, 0);
+        actual.m_world->stepSimulation(kTimeStep, 0);
+        expected.getState(expectedState);
+        actual.getState(actualState);
+        ASSERT_EQ(expectedState.size(), actualState.size());
+        ASSERT_EQ(0, memcmp(&expectedState[0], &actualState[0], expectedState.size() * sizeof(btScalar))) << "step " << s;
+        for (size_t i = 0; i < actual.m_vehicles.size(); i++) {
+            for (int w = 0; w < actual.m_vehicles[i]->getNumWheels(); w++) {
+                numContacts += actual.m_vehicles[i]->getWheelInfo(w).m_raycastInfo.m_isInContact ? 1 : 0;
+            }
+        }
+    }
+    btSetTaskScheduler(0);
+    // the wheels stood on the ground most of the time, and the vehicles drove off
+    EXPECT_GT(numContacts, kNumSteps * kNumVehicles * 4 / 2);
+    for (size_t i = 0; i < actual.m_vehicles.size(); i++) {
+        EXPECT_GT(actual.m_vehicles[i]->getCurrentSpeedKmHour(), 1);
+    }
+}
+
+INSTANTIATE_TEST_CASE_P(Raycasters, VehicleFleetTest,
+                        ::testing::Values(UPDATE_MANAGER, UPDATE_MANAGER_MULTITHREADED, UPDATE_MANAGER_SINGLE_RAYS));
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,129 @@
+#ifndef SOFT_BODY_TEST_WORLD_H
+#define SOFT_BODY_TEST_WORLD_H
+
+#include <vector>
+
+#include "btBulletDynamicsCommon.h"
+#include "BulletSoftBody/btSoftRigidDynamicsWorld.h"
+#include "BulletSoftBody/btSoftBodyRigidBodyCollisionConfiguration.h"
+#include "BulletSoftBody/btDefaultSoftBodySolver.h"
+#include "BulletSoftBody/btSoftBodyHelpers.h"
+#include "BulletSoftBody/btSoftBody.h"
+
+// SoftBodyTestWorld is a soft rigid world on a static ground box, that the soft body tests fill with cloth patches
+// and step side by side with differently configured copies of the same scene.
+class SoftBodyTestWorld {
+public:
+    SoftBodyTestWorld() {
+        m_collisionConfiguration = new btSoftBodyRigidBodyCollisionConfiguration();
+        m_dispatcher = new btCollisionDispatcher(m_collisionConfiguration);
+        m_broadphase = new btDbvtBroadphase();
+        m_solver = new btSequentialImpulseConstraintSolver();
+        m_softBodySolver = new btDefaultSoftBodySolver();
+        m_world = new btSoftRigidDynamicsWorld(m_dispatcher, m_broadphase, m_solver, m_collisionConfiguration,
+                                               m_softBodySolver);
+        m_world->setGravity(btVector3(0, -10, 0));
+
+        m_groundShape = new btBoxShape(btVector3(50, 1, 50));
+        addRigidBody(m_groundShape, 0, btTransform(btQuaternion::getIdentity(), btVector3(0, -1, 0)));
+    }
+
+    virtual ~SoftBodyTestWorld() {
+        for (int i = m_world->getSoftBodyArray().size() - 1; i >= 0; i--) {
+            btSoftBody* psb = m_world->getSoftBodyArray()[i];
+            m_world->removeSoftBody(psb);
+            delete psb;
+        }
+        for (int i = m_world->getNumCollisionObjects() - 1; i >= 0; i--) {
+            btCollisionObject* obj = m_world->getCollisionObjectArray()[i];
+            m_world->removeCollisionObject(obj);
+            delete obj;
+        }
+        for (size_t i = 0; i < m_shapes.size(); i++) {
+            delete m_shapes[i];
+        }
+        delete m_groundShape;
+        delete m_world;
+        delete m_softBodySolver;
+        delete m_solver;
+        delete m_broadphase;
+        delete m_dispatcher;
+        delete m_collisionConfiguration;
+    }
+
+    btRigidBody* addRigidBody(btCollisionShape* shape, btScalar mass, const btTransform& transform) {
+        btVector3 localInertia(0, 0, 0);
+        if (mass != 0) {
+            shape->calculateLocalInertia(mass, localInertia);
+        }
+        btRigidBody* body = new btRigidBody(btRigidBody::btRigidBodyConstructionInfo(mass, 0, shape, localInertia));
+        body->setWorldTransform(transform);
+        m_world->addRigidBody(body);
+        return body;
+    }
+
+    // a square cloth of res x res nodes with the given center and half size, tilted around z
+    btSoftBody* addCloth(const btVector3& center, btScalar halfSize, int res, btScalar tilt) {
+        const btScalar dy = halfSize * btSin(tilt);
+        const btScalar dx = halfSize * btCos(tilt);
+        btSoftBody* psb = btSoftBodyHelpers::CreatePatch(
+            m_world->getWorldInfo(), center + btVector3(-dx, -dy, -halfSize), center + btVector3(dx, dy, -halfSize),
+            center + btVector3(-dx, -dy, halfSize), center + btVector3(dx, dy, halfSize), res, res, 0, true);
+        psb->getCollisionShape()->setMargin(btScalar(0.05));
+        psb->m_cfg.piterations = 4;
+        psb->setTotalMass(1);
+        m_world->addSoftBody(psb);
+        return psb;
+    }
+
+    // a cloth hanging from a dynamic box at two corners, the box falls onto the ground with it
+    btSoftBody* addAnchoredCloth(const btVector3& center, btScalar halfSize, int res) {
+        btCollisionShape* boxShape = new btBoxShape(btVector3(halfSize, btScalar(0.2), btScalar(0.2)));
+        m_shapes.push_back(boxShape);
+        btRigidBody* box = addRigidBody(boxShape, 2, btTransform(btQuaternion::getIdentity(),
+                                                                 center + btVector3(0, 0, -halfSize - btScalar(0.3))));
+        box->setActivationState(DISABLE_DEACTIVATION);
+        btSoftBody* psb = addCloth(center, halfSize, res, 0);
+        psb->appendAnchor(0, box);
+        psb->appendAnchor(res - 1, box);
+        return psb;
+    }
+
+    // positions and velocities of all nodes, and the state of the rigid bodies, without the w components
+    void getState(std::vector<btScalar>& state) const {
+        state.clear();
+        const btSoftBodyArray& softBodies = m_world->getSoftBodyArray();
+        for (int i = 0; i < softBodies.size(); i++) {
+            const btSoftBody* psb = softBodies[i];
+            for (int n = 0; n < psb->m_nodes.size(); n++) {
+                addVector(state, psb->m_nodes[n].m_x);
+                addVector(state, psb->m_nodes[n].m_v);
+            }
+        }
+        for (int i = 0; i < m_world->getNumCollisionObjects(); i++) {
+            const btRigidBody* body = btRigidBody::upcast(m_world->getCollisionObjectArray()[i]);
+            if (body) {
+                addVector(state, body->getWorldTransform().getOrigin());
+                addVector(state, body->getLinearVelocity());
+                addVector(state, body->getAngularVelocity());
+            }
+        }
+    }
+
+    static void addVector(std::vector<btScalar>& state, const btVector3& v) {
+        state.push_back(v.x());
+        state.push_back(v.y());
+        state.push_back(v.z());
+    }
+
+    btSoftBodyRigidBodyCollisionConfiguration* m_collisionConfiguration;
+    btCollisionDispatcher* m_dispatcher;
+    btBroadphaseInterface* m_broadphase;
+    btSequentialImpulseConstraintSolver* m_solver;
+    btDefaultSoftBodySolver* m_softBodySolver;
+    btSoftRigidDynamicsWorld* m_world;
+    btCollisionShape* m_groundShape;
+    std::vector<btCollisionShape*> m_shapes;
+};
+
+#endif  // SOFT_BODY_TEST_WORLD_H
@@ -0,0 +1,42 @@
+
+	-- gtest-only tests of the soft body solver and its acceleration structures
+	local softBodyTests = {
+		{ "Test_SoftBodySolver", "test_soft_body_solver.cpp" },
+		{ "Test_SparseSdf", "test_sparse_sdf.cpp" },
+		{ "Test_PackedNodes", "test_packed_nodes.cpp" },
+		{ "Test_RefitTrees", "test_refit_trees.cpp" },
+	}
+
+	for _, test in ipairs(softBodyTests) do
+
+	project (test[1])
+
+	kind "ConsoleApp"
+
+	includedirs
+	{
+		".",
+		"../../src",
+		"../gtest-1.7.0/include"
+
+	}
+
+
+	if os.is("Windows") then
+		--see http://stackoverflow.com/questions/12558327/google-test-in-visual-studio-2012
+		defines {"_VARIADIC_MAX=10"}
+	end
+
+	links {"BulletSoftBody", "BulletDynamics", "BulletCollision", "LinearMath", "gtest"}
+
+	files {
+		test[2],
+		"SoftBodyTestWorld.h",
+		"../Utils/TestTaskScheduler.h",
+	}
+
+	if os.is("Linux") then
+                links {"pthread"}
+        end
+
+	end
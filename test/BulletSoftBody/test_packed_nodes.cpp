@@ -0,0 +1,100 @@
+// btSoftBody::setPackNodes: the positions solved on the packed node arrays have to match the solve on m_nodes
+// exactly, also when the masses and links change between the steps and the packed arrays have to be rebuilt.
+
+#include <string.h>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "SoftBodyTestWorld.h"
+
+const int kNumSteps = 120;
+const btScalar kTimeStep = btScalar(1.) / btScalar(60.);
+const int kRes = 10;
+
+// a cloth hanging from a box, with the links in the batch order that the packed solver uses
+static btSoftBody* createScene(SoftBodyTestWorld& world, bool packNodes) {
+    btSoftBody* psb = world.addAnchoredCloth(btVector3(0, 3, 0), 2, kRes);
+    psb->generateLinkBatches();
+    psb->setPackNodes(packNodes);
+    return psb;
+}
+
+// the changes between the steps, the same on both cloths
+static void mutate(btSoftBody* psb, int stepIndex) {
+    switch (stepIndex) {
+        case 20:
+            // pin a node in the middle of the far edge
+            psb->setMass(kRes * (kRes - 1) + kRes / 2, 0);
+            break;
+        case 40:
+            // edit the nodes and links directly: a node gets heavier, a link is attached to another node and
+            // pulls it to the rest length of the old one. The link count stays the same
+            {
+                psb->m_nodes[kRes * 5 + 5].m_im *= btScalar(0.25);
+                btSoftBody::Link& l = psb->m_links[psb->m_links.size() / 2];
+                l.m_n[1] = &psb->m_nodes[kRes * 8 + 2];
+                l.m_c0 = (l.m_n[0]->m_im + l.m_n[1]->m_im) / l.m_material->m_kLST;
+                psb->nodesChanged();
+            }
+            break;
+        case 60:
+            // more mass on all nodes, through the API
+            psb->setTotalMass(3);
+            break;
+        case 80:
+            // a cut adds nodes and links, the links get new batches
+            psb->cutLink(kRes * 2 + 3, kRes * 2 + 4, btScalar(0.5));
+            psb->generateLinkBatches();
+            break;
+    }
+}
+
+TEST(PackedNodes, MatchesUnpackedSolveWhenNodesChange) {
+    SoftBodyTestWorld expected;
+    SoftBodyTestWorld actual;
+    btSoftBody* expectedBody = createScene(expected, false);
+    btSoftBody* actualBody = createScene(actual, true);
+    std::vector<btScalar> expectedState;
+    std::vector<btScalar> actualState;
+    for (int s = 0; s < kNumSteps; s++) {
+        mutate(expectedBody, s);
+        mutate(actualBody, s);
+        expected.m_world->stepSimulation(kTimeStep, 0);
+        actual.m_world->stepSimulation(kTimeStep, 0);
+        expected.getState(expectedState);
+        actual.getState(actualState);
+        ASSERT_EQ(expectedState.size(), actualState.size()) << "step " << s;
+        ASSERT_EQ(0, memcmp(&expectedState[0], &actualState[0], expectedState.size() * sizeof(btScalar))) << "step " << s;
+    }
+    EXPECT_EQ(kRes * kRes + 2, actualBody->m_nodes.size());
+}
+
+TEST(PackedNodes, RepacksOnlyAfterChanges) {
+    SoftBodyTestWorld world;
+    btSoftBody* psb = createScene(world, true);
+    world.m_world->stepSimulation(kTimeStep, 0);
+    const int revision = psb->m_nodeRevision;
+    ASSERT_EQ(revision, psb->m_packedRevision);
+    world.m_world->stepSimulation(kTimeStep, 0);
+    EXPECT_EQ(revision, psb->m_nodeRevision);
+
+    // every change of the nodes or links bumps the revision
+    psb->setMass(0, 2);
+    EXPECT_NE(revision, psb->m_nodeRevision);
+    world.m_world->stepSimulation(kTimeStep, 0);
+    EXPECT_EQ(psb->m_nodeRevision, psb->m_packedRevision);
+    EXPECT_EQ(psb->m_nodes[0].m_im, psb->m_packedIm[0]);
+    const int numLinks = psb->m_links.size();
+    psb->appendLink(0, kRes * kRes - 1);
+    psb->appendNode(btVector3(0, 4, 0), 1);
+    EXPECT_NE(psb->m_nodeRevision, psb->m_packedRevision);
+    world.m_world->stepSimulation(kTimeStep, 0);
+    EXPECT_EQ(numLinks + 1, psb->m_packedLinks.size());
+    EXPECT_EQ(psb->m_nodes.size(), psb->m_packedIm.size());
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
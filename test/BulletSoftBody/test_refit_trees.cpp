@@ -0,0 +1,130 @@
+// btSoftBody::setRefitTrees: refitting the node and face trees once per step, and rebuilding them when they
+// degrade, has to find the same contacts as reinserting every moved leaf.
+
+#include <string.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "SoftBodyTestWorld.h"
+
+const int kNumSteps = 150;
+const btScalar kTimeStep = btScalar(1.) / btScalar(60.);
+
+// two cloths that fall onto each other and onto the ground, colliding with their face trees
+static void createScene(SoftBodyTestWorld& world, bool refitTrees, btScalar rebuildRatio) {
+    for (int i = 0; i < 2; i++) {
+        btSoftBody* psb = world.addCloth(btVector3(btScalar(0.5) * i, btScalar(1 + i), 0), 2, 12, btScalar(0.3) * i);
+        psb->m_cfg.collisions |= btSoftBody::fCollision::VF_SS;
+        psb->setRefitTrees(refitTrees, rebuildRatio);
+    }
+}
+
+// body and node or face index of a feature, the soft bodies of both worlds are in the same order
+template <class T>
+static int featureIndex(const btSoftRigidDynamicsWorld* world, const T* feature,
+                        const btAlignedObjectArray<T> btSoftBody::*features) {
+    const btSoftBodyArray& softBodies = world->getSoftBodyArray();
+    for (int i = 0; i < softBodies.size(); i++) {
+        const btAlignedObjectArray<T>& array = softBodies[i]->*features;
+        if (array.size() && feature >= &array[0] && feature < &array[0] + array.size()) {
+            return i * 100000 + int(feature - &array[0]);
+        }
+    }
+    return -1;
+}
+
+// the soft and rigid contacts found in the last step, sorted, as the trees report them in their own order
+static void getContacts(const SoftBodyTestWorld& world, std::vector<std::pair<int, int> >& contacts) {
+    contacts.clear();
+    const btSoftBodyArray& softBodies = world.m_world->getSoftBodyArray();
+    for (int i = 0; i < softBodies.size(); i++) {
+        const btSoftBody* psb = softBodies[i];
+        for (int c = 0; c < psb->m_scontacts.size(); c++) {
+            const btSoftBody::SContact& contact = psb->m_scontacts[c];
+            contacts.push_back(std::make_pair(featureIndex(world.m_world, contact.m_node, &btSoftBody::m_nodes),
+                                              featureIndex(world.m_world, contact.m_face, &btSoftBody::m_faces)));
+        }
+        for (int c = 0; c < psb->m_rcontacts.size(); c++) {
+            const btSoftBody::RContact& contact = psb->m_rcontacts[c];
+            contacts.push_back(std::make_pair(featureIndex(world.m_world, contact.m_node, &btSoftBody::m_nodes),
+                                              -1 - world.m_world->getCollisionObjectArray().findLinearSearch(
+                                                       const_cast<btCollisionObject*>(contact.m_cti.m_colObj))));
+        }
+    }
+    std::sort(contacts.begin(), contacts.end());
+}
+
+// the soft bodies of the actual world continue from the state of the expected one
+static void copyNodes(const SoftBodyTestWorld& from, SoftBodyTestWorld& to) {
+    for (int i = 0; i < from.m_world->getSoftBodyArray().size(); i++) {
+        const btSoftBody* source = from.m_world->getSoftBodyArray()[i];
+        btSoftBody* target = to.m_world->getSoftBodyArray()[i];
+        for (int n = 0; n < source->m_nodes.size(); n++) {
+            btSoftBody::Node& node = target->m_nodes[n];
+            node.m_x = source->m_nodes[n].m_x;
+            node.m_q = source->m_nodes[n].m_q;
+            node.m_v = source->m_nodes[n].m_v;
+            node.m_f = source->m_nodes[n].m_f;
+            node.m_n = source->m_nodes[n].m_n;
+        }
+    }
+}
+
+// The contacts are generated in the traversal order of the trees, and solved in that order, so the two worlds
+// drift apart by rounding once the cloths touch. Each step starts both worlds from the same nodes instead, their
+// trees have to find exactly the same contacts.
+static void expectSameContacts(btScalar rebuildRatio) {
+    SoftBodyTestWorld expected;
+    SoftBodyTestWorld actual;
+    createScene(expected, false, rebuildRatio);
+    createScene(actual, true, rebuildRatio);
+    std::vector<btScalar> expectedState;
+    std::vector<btScalar> actualState;
+    std::vector<std::pair<int, int> > expectedContacts;
+    std::vector<std::pair<int, int> > actualContacts;
+    int numSoftContacts = 0;
+    bool sameState = true;
+    for (int s = 0; s < kNumSteps; s++) {
+        expected.m_world->stepSimulation(kTimeStep, 0);
+        actual.m_world->stepSimulation(kTimeStep, 0);
+        getContacts(expected, expectedContacts);
+        getContacts(actual, actualContacts);
+        ASSERT_EQ(expectedContacts, actualContacts) << "step " << s;
+        // until the first contact the steps are the same
+        expected.getState(expectedState);
+        actual.getState(actualState);
+        if (sameState && expectedContacts.empty()) {
+            ASSERT_EQ(0, memcmp(&expectedState[0], &actualState[0], expectedState.size() * sizeof(btScalar))) << "step " << s;
+        }
+        sameState = sameState && expectedContacts.empty();
+        for (size_t c = 0; c < actualContacts.size(); c++) {
+            numSoftContacts += actualContacts[c].second >= 0 ? 1 : 0;
+        }
+        copyNodes(expected, actual);
+    }
+    // the cloths landed and touched each other
+    EXPECT_FALSE(sameState);
+    EXPECT_GT(numSoftContacts, 0);
+    const btSoftBodyArray& softBodies = actual.m_world->getSoftBodyArray();
+    for (int i = 0; i < softBodies.size(); i++) {
+        const btSoftBody* psb = softBodies[i];
+        EXPECT_FALSE(psb->m_fdbvt.empty());
+        EXPECT_EQ(psb->m_nodes.size(), btDbvt::countLeaves(psb->m_ndbvt.m_root));
+        EXPECT_EQ(psb->m_faces.size(), btDbvt::countLeaves(psb->m_fdbvt.m_root));
+        EXPECT_GT(psb->m_treeCost[0], 0);
+        EXPECT_GT(psb->m_treeCost[1], 0);
+    }
+}
+
+TEST(RefitTrees, FindsTheContactsOfReinsertedLeaves) { expectSameContacts(2); }
+
+// rebuilds after almost every refit
+TEST(RefitTrees, FindsTheContactsOfReinsertedLeavesWithFrequentRebuilds) { expectSameContacts(btScalar(1.01)); }
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,106 @@
+// Multithreaded btDefaultSoftBodySolver: the result may not depend on the number of threads, and with the links in
+// the batch order of generateLinkBatches it has to match the serial solver exactly.
+
+#include <string.h>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "SoftBodyTestWorld.h"
+#include "LinearMath/btThreads.h"
+#include "../Utils/TestTaskScheduler.h"
+
+const int kNumSteps = 120;
+const btScalar kTimeStep = btScalar(1.) / btScalar(60.);
+
+// cloths that fall onto the ground on their own, and one that hangs from a falling box and is solved coupled
+static void createScene(SoftBodyTestWorld& world, bool linkBatches) {
+    for (int i = 0; i < 6; i++) {
+        world.addCloth(btVector3(btScalar(i % 3) * 5 - 5, btScalar(1 + i), btScalar(i / 3) * 5), 2, 12, btScalar(0.2) * i);
+    }
+    world.addAnchoredCloth(btVector3(0, 3, 12), 2, 10);
+    if (linkBatches) {
+        // the serial solver keeps this order, the multithreaded one creates the same batches again from it
+        const btSoftBodyArray& softBodies = world.m_world->getSoftBodyArray();
+        for (int i = 0; i < softBodies.size(); i++) {
+            softBodies[i]->generateLinkBatches();
+        }
+    }
+}
+
+static void expectSameSimulation(SoftBodyTestWorld& expected, TestTaskScheduler* expectedScheduler,
+                                 SoftBodyTestWorld& actual, TestTaskScheduler* actualScheduler) {
+    std::vector<btScalar> expectedState;
+    std::vector<btScalar> actualState;
+    for (int s = 0; s < kNumSteps; s++) {
+        btSetTaskScheduler(expectedScheduler);
+        expected.m_world->stepSimulation(kTimeStep, 0);
+        btSetTaskScheduler(actualScheduler);
+        actual.m_world->stepSimulation(kTimeStep, 0);
+        btSetTaskScheduler(0);
+        expected.getState(expectedState);
+        actual.getState(actualState);
+        ASSERT_EQ(expectedState.size(), actualState.size());
+        ASSERT_EQ(0, memcmp(&expectedState[0], &actualState[0], expectedState.size() * sizeof(btScalar))) << "step " << s;
+    }
+    // the cloths landed on the ground box, they sink in a bit but don't fall through
+    const btSoftBodyArray& softBodies = actual.m_world->getSoftBodyArray();
+    for (int i = 0; i < softBodies.size(); i++) {
+        btVector3 aabbMin, aabbMax;
+        softBodies[i]->getAabb(aabbMin, aabbMax);
+        EXPECT_LT(aabbMin.y(), 0.2) << "soft body " << i;
+        EXPECT_GT(aabbMin.y(), -1) << "soft body " << i;
+    }
+}
+
+TEST(SoftBodySolver, MultithreadedIndependentOfThreadCount) {
+    SoftBodyTestWorld expected;
+    SoftBodyTestWorld actual;
+    createScene(expected, false);
+    createScene(actual, false);
+    expected.m_softBodySolver->setMultithreaded(true);
+    actual.m_softBodySolver->setMultithreaded(true);
+    // without a task scheduler btParallelFor runs the whole range on the calling thread
+    TestTaskScheduler scheduler(4);
+    expectSameSimulation(expected, 0, actual, &scheduler);
+}
+
+TEST(SoftBodySolver, MultithreadedMatchesSerialWithLinkBatches) {
+    SoftBodyTestWorld expected;
+    SoftBodyTestWorld actual;
+    createScene(expected, true);
+    createScene(actual, true);
+    actual.m_softBodySolver->setMultithreaded(true);
+    TestTaskScheduler scheduler(4);
+    expectSameSimulation(expected, 0, actual, &scheduler);
+}
+
+TEST(SoftBodySolver, LinkBatchesShareNoNode) {
+    SoftBodyTestWorld world;
+    btSoftBody* psb = world.addCloth(btVector3(0, 1, 0), 2, 12, 0);
+    const int numLinks = psb->m_links.size();
+    const int numBatches = psb->generateLinkBatches();
+    ASSERT_TRUE(psb->hasLinkBatches());
+    ASSERT_EQ(numBatches + 1, psb->m_linkBatches.size());
+    EXPECT_EQ(numLinks, psb->m_links.size());
+    // a node has at most 8 links in a patch with diagonals, greedy coloring needs a few more batches
+    EXPECT_LE(numBatches, 16);
+    std::vector<int> batchOfNode(psb->m_nodes.size());
+    for (int b = 0; b < numBatches; b++) {
+        for (int i = psb->m_linkBatches[b]; i < psb->m_linkBatches[b + 1]; i++) {
+            for (int j = 0; j < 2; j++) {
+                int node = int(psb->m_links[i].m_n[j] - &psb->m_nodes[0]);
+                EXPECT_NE(b + 1, batchOfNode[node]) << "batch " << b << " link " << i;
+                batchOfNode[node] = b + 1;
+            }
+        }
+    }
+    // appending a link drops the batches
+    psb->appendLink(0, psb->m_nodes.size() - 1);
+    EXPECT_FALSE(psb->hasLinkBatches());
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,185 @@
+// btSparseSdf: Evaluate on several threads, with a budget small enough that cells are evicted all the time, has to
+// return the same distances as a cache that never evicts. Baked grids have to be rejected when they are too big.
+
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "btBulletCollisionCommon.h"
+#include "BulletSoftBody/btSparseSDF.h"
+
+typedef btSparseSdf<3> SparseSdf;
+
+const int kNumThreads = 4;
+const int kNumQueriesPerThread = 4000;
+// the threads keep coming back to the same hot point, so its cell is always among the most recently used
+const int kHotPointInterval = 8;
+
+struct SdfQuery {
+    btVector3 m_position;
+    int m_shape;
+};
+
+struct SdfResult {
+    btScalar m_distance;
+    btVector3 m_normal;
+};
+
+class SparseSdfTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        m_shapes.push_back(new btSphereShape(btScalar(0.8)));
+        m_shapes.push_back(new btBoxShape(btVector3(btScalar(0.6), btScalar(0.4), btScalar(0.9))));
+        m_shapes.push_back(new btCapsuleShape(btScalar(0.3), btScalar(1.0)));
+        srand(5);
+        for (int t = 0; t < kNumThreads; t++) {
+            std::vector<SdfQuery> queries;
+            SdfQuery hot;
+            hot.m_position = btVector3(btScalar(0.3), btScalar(1.1), 0);
+            hot.m_shape = 0;
+            for (int i = 0; i < kNumQueriesPerThread; i++) {
+                if (i % kHotPointInterval == 0) {
+                    queries.push_back(hot);
+                    continue;
+                }
+                SdfQuery query;
+                query.m_position = btVector3(randRange(-3, 3), randRange(-3, 3), randRange(-3, 3));
+                query.m_shape = rand() % m_shapes.size();
+                queries.push_back(query);
+            }
+            m_queries.push_back(queries);
+        }
+    }
+
+    virtual void TearDown() {
+        for (size_t i = 0; i < m_shapes.size(); i++) {
+            delete m_shapes[i];
+        }
+    }
+
+public:
+    static btScalar randRange(btScalar minValue, btScalar maxValue) {
+        return minValue + (maxValue - minValue) * btScalar(rand()) / btScalar(RAND_MAX);
+    }
+
+    void evaluate(SparseSdf* sdf, int thread, std::vector<SdfResult>* results) const {
+        const std::vector<SdfQuery>& queries = m_queries[thread];
+        results->resize(queries.size());
+        for (size_t i = 0; i < queries.size(); i++) {
+            SdfResult& result = (*results)[i];
+            result.m_distance = sdf->Evaluate(queries[i].m_position, m_shapes[queries[i].m_shape], result.m_normal, 0);
+        }
+    }
+
+    std::vector<btCollisionShape*> m_shapes;
+    std::vector<std::vector<SdfQuery> > m_queries;
+};
+
+TEST_F(SparseSdfTest, ConcurrentEvaluateWithEvictionMatchesUnboundedCache) {
+    SparseSdf reference;
+    reference.Initialize();
+    std::vector<std::vector<SdfResult> > expected(kNumThreads);
+    for (int t = 0; t < kNumThreads; t++) {
+        evaluate(&reference, t, &expected[t]);
+    }
+    const int numCells = reference.ncells;
+    ASSERT_GT(numCells, 200);
+
+    // a few buckets, so threads meet in the same bucket lists, and room for a tenth of the cells
+    SparseSdf sdf;
+    const int clampCells = numCells / 10;
+    sdf.Initialize(31, clampCells);
+    std::vector<std::vector<SdfResult> > actual(kNumThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kNumThreads; t++) {
+        threads.push_back(std::thread(&SparseSdfTest::evaluate, this, &sdf, t, &actual[t]));
+    }
+    for (int t = 0; t < kNumThreads; t++) {
+        threads[t].join();
+    }
+
+    // the cells are built the same way whether they were evicted before or not
+    for (int t = 0; t < kNumThreads; t++) {
+        for (int i = 0; i < kNumQueriesPerThread; i++) {
+            ASSERT_EQ(expected[t][i].m_distance, actual[t][i].m_distance) << "thread " << t << " query " << i;
+            ASSERT_EQ(expected[t][i].m_normal.x(), actual[t][i].m_normal.x()) << "thread " << t << " query " << i;
+            ASSERT_EQ(expected[t][i].m_normal.y(), actual[t][i].m_normal.y()) << "thread " << t << " query " << i;
+            ASSERT_EQ(expected[t][i].m_normal.z(), actual[t][i].m_normal.z()) << "thread " << t << " query " << i;
+        }
+    }
+    // an eviction can miss the cells that other threads add while it runs
+    EXPECT_LE(sdf.ncells, clampCells + kNumThreads);
+    int numListed = 0;
+    for (int i = 0; i < sdf.cells.size(); i++) {
+        for (SparseSdf::Cell* c = sdf.cells[i]; c; c = c->next) {
+            numListed++;
+        }
+    }
+    EXPECT_EQ(sdf.ncells, numListed);
+
+    // every Evaluate without a baked grid is one query, and compares at least one cell
+    EXPECT_EQ(1 + kNumThreads * kNumQueriesPerThread, sdf.nqueries);
+    EXPECT_GE(sdf.nprobes, sdf.nqueries);
+    EXPECT_EQ(1 + kNumThreads * kNumQueriesPerThread, reference.nqueries);
+    sdf.GarbageCollect();
+    EXPECT_EQ(1, sdf.nqueries);
+    EXPECT_EQ(1, sdf.nprobes);
+
+    // the hot point was used by every thread until the end, its cell survived the evictions
+    const int numCellsBefore = sdf.ncells;
+    btVector3 normal;
+    sdf.Evaluate(m_queries[0][0].m_position, m_shapes[m_queries[0][0].m_shape], normal, 0);
+    EXPECT_EQ(numCellsBefore, sdf.ncells);
+    EXPECT_LT(1, sdf.nprobes);
+}
+
+TEST_F(SparseSdfTest, LeastRecentlyUsedCellsAreEvicted) {
+    SparseSdf sdf;
+    sdf.Initialize(31, 8);
+    btVector3 normal;
+    const btVector3 hot(0, btScalar(1.1), 0);
+    // cells of 3 voxels of 0.25, one cell per query along x
+    for (int i = 0; i < 40; i++) {
+        sdf.Evaluate(btVector3(btScalar(i) * btScalar(0.75) + btScalar(2.1), 0, 0), m_shapes[0], normal, 0);
+        const int numCells = sdf.ncells;
+        sdf.Evaluate(hot, m_shapes[0], normal, 0);
+        if (i > 0) {
+            EXPECT_EQ(numCells, sdf.ncells) << "query " << i;
+        }
+        EXPECT_LE(sdf.ncells, 8);
+    }
+    // the last cell along x is still there, the first one was evicted and is built again
+    int numCells = sdf.ncells;
+    sdf.Evaluate(btVector3(btScalar(39) * btScalar(0.75) + btScalar(2.1), 0, 0), m_shapes[0], normal, 0);
+    EXPECT_EQ(numCells, sdf.ncells);
+    sdf.Evaluate(btVector3(btScalar(2.1), 0, 0), m_shapes[0], normal, 0);
+    EXPECT_NE(numCells, sdf.ncells);
+}
+
+TEST_F(SparseSdfTest, BakedGridMatchesShapeAndRejectsOversizedGrids) {
+    btAlignedObjectArray<unsigned char> buffer;
+    ASSERT_TRUE(SparseSdf::BakeGrid(m_shapes[1], btScalar(0.05), btScalar(0.2), buffer));
+    btSdfGrid grid;
+    ASSERT_TRUE(grid.InitFromMemory(&buffer[0], buffer.size()));
+    SparseSdf sdf;
+    sdf.Initialize();
+    sdf.RegisterGrid(m_shapes[1], &grid);
+    btVector3 normal;
+    // on a grid point the baked sample is the distance itself
+    const btVector3 x = grid.m_origin + btVector3(10, 7, 12) * grid.m_voxelSize;
+    EXPECT_NEAR(SparseSdf::DistanceToShape(x, m_shapes[1]), sdf.Evaluate(x, m_shapes[1], normal, 0), 1e-5);
+    EXPECT_EQ(0, sdf.ncells);
+
+    // 1e-4 voxels over a box of 1.2 x 0.8 x 1.8 are far more than 2GB, the size has to be checked before the resize
+    EXPECT_FALSE(SparseSdf::BakeGrid(m_shapes[1], btScalar(1e-4), 0, buffer));
+    EXPECT_EQ(0, buffer.size());
+    EXPECT_FALSE(SparseSdf::BakeGrid(m_shapes[1], 0, 0, buffer));
+    EXPECT_FALSE(SparseSdf::BakeGrid(m_shapes[1], btScalar(1e-12), 0, buffer));
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
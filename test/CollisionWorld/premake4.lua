@@ -0,0 +1,40 @@
+
+	-- gtest-only tests of the collision world queries
+	local collisionWorldTests = {
+		{ "Test_BatchQueries", "test_batch_queries.cpp" },
+		{ "Test_TriggerObject", "test_trigger_object.cpp" },
+		{ "Test_DbvtRefit", "test_dbvt_refit.cpp" },
+	}
+
+	for _, test in ipairs(collisionWorldTests) do
+
+	project (test[1])
+
+	kind "ConsoleApp"
+
+	includedirs
+	{
+		".",
+		"../../src",
+		"../gtest-1.7.0/include"
+
+	}
+
+
+	if os.is("Windows") then
+		--see http://stackoverflow.com/questions/12558327/google-test-in-visual-studio-2012
+		defines {"_VARIADIC_MAX=10"}
+	end
+
+	links {"BulletCollision", "LinearMath", "gtest"}
+
+	files {
+		test[2],
+		"../Utils/TestTaskScheduler.h",
+	}
+
+	if os.is("Linux") then
+                links {"pthread"}
+        end
+
+	end
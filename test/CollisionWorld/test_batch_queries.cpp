@@ -0,0 +1,269 @@
+// Batched collision world queries: overlapTestBatch, contactTestBatch and rayTestBatch have to report
+// the same objects and contact points as the single contactTest and rayTest, also on several threads.
+
+#include <stdlib.h>
+
+#include <gtest/gtest.h>
+
+#include "btBulletCollisionCommon.h"
+#include "LinearMath/btThreads.h"
+#include "../Utils/TestTaskScheduler.h"
+
+const int kNumQueries = 300;
+
+static btScalar randRange(btScalar minValue, btScalar maxValue) {
+    return minValue + (maxValue - minValue) * btScalar(rand()) / btScalar(RAND_MAX);
+}
+
+// a contact point of one query, in the order it was reported for that object
+struct QueryContact {
+    int m_uid;
+    btScalar m_distance;
+    btVector3 m_positionWorldOnB;
+};
+
+static bool lessUid(const QueryContact& a, const QueryContact& b) {
+    return a.m_uid < b.m_uid;
+}
+
+// boxes, spheres and capsules on a jittered grid, above a static plane
+class QueryWorld {
+public:
+    QueryWorld() {
+        m_collisionConfiguration = new btDefaultCollisionConfiguration();
+        m_dispatcher = new btCollisionDispatcher(m_collisionConfiguration);
+        m_broadphase = new btDbvtBroadphase();
+        m_world = new btCollisionWorld(m_dispatcher, m_broadphase, m_collisionConfiguration);
+
+        m_shapes.push_back(new btStaticPlaneShape(btVector3(0, 1, 0), 0));
+        m_shapes.push_back(new btBoxShape(btVector3(0.5, 0.4, 0.6)));
+        m_shapes.push_back(new btSphereShape(0.55));
+        m_shapes.push_back(new btCapsuleShape(0.3, 0.8));
+        addObject(m_shapes[0], btTransform::getIdentity());
+
+        srand(7);
+        for (int x = 0; x < 8; x++) {
+            for (int y = 0; y < 3; y++) {
+                for (int z = 0; z < 8; z++) {
+                    btTransform transform;
+                    transform.setRotation(btQuaternion(randRange(0, SIMD_2_PI), randRange(0, 1), randRange(0, 1)));
+                    transform.setOrigin(btVector3(x * 1.5 + randRange(-0.2, 0.2), 0.5 + y * 1.5,
+                                                  z * 1.5 + randRange(-0.2, 0.2)));
+                    addObject(m_shapes[1 + (x + y + z) % 3], transform);
+                }
+            }
+        }
+        m_world->updateAabbs();
+
+        m_queryShapes.push_back(new btSphereShape(0.7));
+        m_queryShapes.push_back(new btBoxShape(btVector3(0.8, 0.3, 0.5)));
+        m_queryShapes.push_back(new btCylinderShape(btVector3(0.4, 0.6, 0.4)));
+        for (int i = 0; i < kNumQueries; i++) {
+            btTransform transform;
+            transform.setRotation(btQuaternion(randRange(0, SIMD_2_PI), randRange(0, 1), randRange(0, 1)));
+            transform.setOrigin(btVector3(randRange(-1, 12), randRange(-0.5, 4.5), randRange(-1, 12)));
+            m_queries.push_back(btCollisionWorld::OverlapQuery(m_queryShapes[i % m_queryShapes.size()], transform));
+        }
+    }
+
+    virtual ~QueryWorld() {
+        for (int i = m_world->getNumCollisionObjects() - 1; i >= 0; i--) {
+            btCollisionObject* obj = m_world->getCollisionObjectArray()[i];
+            m_world->removeCollisionObject(obj);
+            delete obj;
+        }
+        for (int i = 0; i < m_shapes.size(); i++) {
+            delete m_shapes[i];
+        }
+        for (int i = 0; i < m_queryShapes.size(); i++) {
+            delete m_queryShapes[i];
+        }
+        delete m_world;
+        delete m_broadphase;
+        delete m_dispatcher;
+        delete m_collisionConfiguration;
+    }
+
+    void addObject(btCollisionShape* shape, const btTransform& transform) {
+        btCollisionObject* obj = new btCollisionObject();
+        obj->setCollisionShape(shape);
+        obj->setWorldTransform(transform);
+        m_world->addCollisionObject(obj);
+    }
+
+    // the contacts of contactTest with a temporary object, sorted by object (stable, so the order per object stays)
+    void singleContacts(int queryIndex, btAlignedObjectArray<QueryContact>& contacts) {
+        struct Callback : public btCollisionWorld::ContactResultCallback {
+            btAlignedObjectArray<QueryContact>* m_contacts;
+            virtual btScalar addSingleResult(btManifoldPoint& cp, const btCollisionObjectWrapper* colObj0Wrap, int, int,
+                                             const btCollisionObjectWrapper* colObj1Wrap, int, int) {
+                QueryContact contact;
+                contact.m_uid = colObj1Wrap->getCollisionObject()->getBroadphaseHandle()->getUid();
+                contact.m_distance = cp.getDistance();
+                contact.m_positionWorldOnB = cp.getPositionWorldOnB();
+                m_contacts->push_back(contact);
+                (void)colObj0Wrap;
+                return 0;
+            }
+        } callback;
+        callback.m_contacts = &contacts;
+        const btCollisionWorld::OverlapQuery& query = m_queries[queryIndex];
+        btCollisionObject queryObject;
+        queryObject.setCollisionShape(const_cast<btCollisionShape*>(query.m_shape));
+        queryObject.setWorldTransform(query.m_worldTransform);
+        m_world->contactTest(&queryObject, callback);
+        stableSortByUid(contacts);
+    }
+
+    static void stableSortByUid(btAlignedObjectArray<QueryContact>& contacts) {
+        // insertion sort, the arrays are short
+        for (int i = 1; i < contacts.size(); i++) {
+            for (int j = i; j > 0 && lessUid(contacts[j], contacts[j - 1]); j--) {
+                contacts.swap(j, j - 1);
+            }
+        }
+    }
+
+    btDefaultCollisionConfiguration* m_collisionConfiguration;
+    btCollisionDispatcher* m_dispatcher;
+    btBroadphaseInterface* m_broadphase;
+    btCollisionWorld* m_world;
+    btAlignedObjectArray<btCollisionShape*> m_shapes;
+    btAlignedObjectArray<btCollisionShape*> m_queryShapes;
+    btAlignedObjectArray<btCollisionWorld::OverlapQuery> m_queries;
+};
+
+struct BatchContactCallback : public btCollisionWorld::BatchContactResultCallback {
+    btSpinMutex m_mutex;
+    btAlignedObjectArray<btAlignedObjectArray<QueryContact> > m_contacts;
+
+    explicit BatchContactCallback(int numQueries) { m_contacts.resize(numQueries); }
+
+    virtual btScalar addSingleResult(int queryIndex, btManifoldPoint& cp, const btCollisionObjectWrapper* colObj0Wrap, int,
+                                     int, const btCollisionObjectWrapper* colObj1Wrap, int, int) {
+        QueryContact contact;
+        contact.m_uid = colObj1Wrap->getCollisionObject()->getBroadphaseHandle()->getUid();
+        contact.m_distance = cp.getDistance();
+        contact.m_positionWorldOnB = cp.getPositionWorldOnB();
+        btMutexLockGuard lock(m_mutex);
+        m_contacts[queryIndex].push_back(contact);
+        (void)colObj0Wrap;
+        return 0;
+    }
+};
+
+// the w component of the vectors is not written by the queries
+static void expectEqualXyz(const btVector3& expected, const btVector3& actual, int query) {
+    EXPECT_EQ(expected.x(), actual.x()) << "query " << query;
+    EXPECT_EQ(expected.y(), actual.y()) << "query " << query;
+    EXPECT_EQ(expected.z(), actual.z()) << "query " << query;
+}
+
+class BatchQueriesTest : public ::testing::TestWithParam<int> {
+protected:
+    virtual void SetUp() {
+        m_scheduler = GetParam() > 1 ? new TestTaskScheduler(GetParam()) : 0;
+        btSetTaskScheduler(m_scheduler);
+        m_flags = m_scheduler ? btCollisionWorld::BQF_MULTITHREADED : btCollisionWorld::BQF_NONE;
+    }
+    virtual void TearDown() {
+        btSetTaskScheduler(0);
+        delete m_scheduler;
+    }
+
+    TestTaskScheduler* m_scheduler;
+    int m_flags;
+};
+
+TEST_P(BatchQueriesTest, ContactTestBatchMatchesContactTest) {
+    QueryWorld world;
+    BatchContactCallback batchCallback(kNumQueries);
+    world.m_world->contactTestBatch(&world.m_queries[0], kNumQueries, batchCallback, m_flags);
+
+    int numContacts = 0;
+    for (int q = 0; q < kNumQueries; q++) {
+        btAlignedObjectArray<QueryContact> single;
+        world.singleContacts(q, single);
+        btAlignedObjectArray<QueryContact>& batch = batchCallback.m_contacts[q];
+        QueryWorld::stableSortByUid(batch);
+        ASSERT_EQ(single.size(), batch.size()) << "query " << q;
+        for (int i = 0; i < single.size(); i++) {
+            EXPECT_EQ(single[i].m_uid, batch[i].m_uid) << "query " << q;
+            EXPECT_EQ(single[i].m_distance, batch[i].m_distance) << "query " << q;
+            expectEqualXyz(single[i].m_positionWorldOnB, batch[i].m_positionWorldOnB, q);
+        }
+        numContacts += single.size();
+    }
+    EXPECT_GT(numContacts, kNumQueries / 2);
+}
+
+TEST_P(BatchQueriesTest, OverlapTestBatchMatchesContactTest) {
+    QueryWorld world;
+    btAlignedObjectArray<btCollisionWorld::OverlapResult> results;
+    world.m_world->overlapTestBatch(&world.m_queries[0], kNumQueries, results, m_flags);
+    btAlignedObjectArray<btCollisionWorld::OverlapResult> firstHits;
+    world.m_world->overlapTestBatch(&world.m_queries[0], kNumQueries, firstHits,
+                                    m_flags | btCollisionWorld::BQF_FIRST_HIT_ONLY);
+
+    int r = 0;
+    int f = 0;
+    for (int q = 0; q < kNumQueries; q++) {
+        // an object overlaps when contactTest reports a touching or penetrating point
+        btAlignedObjectArray<QueryContact> single;
+        world.singleContacts(q, single);
+        btAlignedObjectArray<int> overlapping;
+        for (int i = 0; i < single.size(); i++) {
+            if (single[i].m_distance <= 0 && (!overlapping.size() || overlapping[overlapping.size() - 1] != single[i].m_uid)) {
+                overlapping.push_back(single[i].m_uid);
+            }
+        }
+        for (int i = 0; i < overlapping.size(); i++, r++) {
+            ASSERT_LT(r, results.size());
+            EXPECT_EQ(q, results[r].m_queryIndex);
+            EXPECT_EQ(overlapping[i], results[r].m_collisionObject->getBroadphaseHandle()->getUid()) << "query " << q;
+        }
+        if (overlapping.size()) {
+            ASSERT_LT(f, firstHits.size());
+            EXPECT_EQ(q, firstHits[f].m_queryIndex);
+            EXPECT_EQ(overlapping[0], firstHits[f].m_collisionObject->getBroadphaseHandle()->getUid()) << "query " << q;
+            f++;
+        }
+    }
+    EXPECT_EQ(r, results.size());
+    EXPECT_EQ(f, firstHits.size());
+    EXPECT_GT(results.size(), kNumQueries / 4);
+}
+
+TEST_P(BatchQueriesTest, RayTestBatchMatchesRayTest) {
+    QueryWorld world;
+    btAlignedObjectArray<btCollisionWorld::RayQuery> rays;
+    for (int i = 0; i < kNumQueries; i++) {
+        btVector3 from(randRange(-2, 13), randRange(0, 6), randRange(-2, 13));
+        btVector3 to = from + btVector3(randRange(-4, 4), randRange(-6, 1), randRange(-4, 4));
+        rays.push_back(btCollisionWorld::RayQuery(from, to));
+    }
+    btAlignedObjectArray<btCollisionWorld::ClosestRayQueryResult> results;
+    results.resize(kNumQueries);
+    world.m_world->rayTestBatch(&rays[0], kNumQueries, &results[0], m_flags);
+
+    int numHits = 0;
+    for (int i = 0; i < kNumQueries; i++) {
+        btCollisionWorld::ClosestRayResultCallback callback(rays[i].m_rayFromWorld, rays[i].m_rayToWorld);
+        world.m_world->rayTest(rays[i].m_rayFromWorld, rays[i].m_rayToWorld, callback);
+        ASSERT_EQ(callback.m_collisionObject, results[i].m_collisionObject) << "ray " << i;
+        if (callback.hasHit()) {
+            EXPECT_EQ(callback.m_closestHitFraction, results[i].m_closestHitFraction) << "ray " << i;
+            expectEqualXyz(callback.m_hitPointWorld, results[i].m_hitPointWorld, i);
+            expectEqualXyz(callback.m_hitNormalWorld, results[i].m_hitNormalWorld, i);
+            numHits++;
+        }
+    }
+    EXPECT_GT(numHits, kNumQueries / 4);
+}
+
+INSTANTIATE_TEST_CASE_P(Threads, BatchQueriesTest, ::testing::Values(1, 4));
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
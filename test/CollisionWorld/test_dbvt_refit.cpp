@@ -0,0 +1,168 @@
+// btDbvt::refitLeaf and refit: a tree whose leaves are grown in place and refitted once per frame has to hold
+// the same leaf volumes as a tree updated leaf by leaf, and answer queries like a rebuilt tree and brute force.
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "BulletCollision/BroadphaseCollision/btDbvt.h"
+
+const int kNumLeaves = 500;
+const int kNumFrames = 30;
+const int kNumQueries = 60;
+const btScalar kRadius = btScalar(0.2);
+const btScalar kMargin = btScalar(0.05);
+const btScalar kVelocityMargin = btScalar(0.5);
+
+static btScalar randRange(btScalar minValue, btScalar maxValue) {
+    return minValue + (maxValue - minValue) * btScalar(rand()) / btScalar(RAND_MAX);
+}
+
+static btVector3 randVector(btScalar extent) {
+    return btVector3(randRange(-extent, extent), randRange(-extent, extent), randRange(-extent, extent));
+}
+
+static int leafIndex(const btDbvtNode* leaf) { return int((char*)leaf->data - (char*)0); }
+
+static void* leafData(int index) { return (char*)0 + index; }
+
+// the data of the leaves that a query box overlaps
+struct CollectLeaves : btDbvt::ICollide {
+    void Process(const btDbvtNode* leaf) { m_leaves.push_back(leafIndex(leaf)); }
+    std::vector<int> m_leaves;
+};
+
+// the same cost as btDbvt::refit, summed in the same order
+static btScalar volumeCost(const btDbvtVolume& volume) {
+    const btVector3 edges = volume.Lengths();
+    return edges.x() * edges.y() * edges.z() + edges.x() + edges.y() + edges.z();
+}
+
+static btScalar internalCost(const btDbvtNode* node) {
+    if (node->isleaf()) {
+        return 0;
+    }
+    const btScalar cost = internalCost(node->childs[0]) + internalCost(node->childs[1]);
+    return cost + volumeCost(node->volume);
+}
+
+static bool sameVolume(const btDbvtVolume& a, const btDbvtVolume& b) {
+    return memcmp(&a.Mins(), &b.Mins(), 3 * sizeof(btScalar)) == 0 &&
+           memcmp(&a.Maxs(), &b.Maxs(), 3 * sizeof(btScalar)) == 0;
+}
+
+// every internal volume is exactly the merge of its children
+static void expectTight(const btDbvtNode* node) {
+    if (node->isleaf()) {
+        return;
+    }
+    btDbvtVolume merged;
+    Merge(node->childs[0]->volume, node->childs[1]->volume, merged);
+    ASSERT_TRUE(sameVolume(merged, node->volume));
+    EXPECT_EQ(node, node->childs[0]->parent);
+    EXPECT_EQ(node, node->childs[1]->parent);
+    expectTight(node->childs[0]);
+    expectTight(node->childs[1]);
+}
+
+static std::vector<int> query(const btDbvt& tree, const btDbvtVolume& box) {
+    CollectLeaves collector;
+    tree.collideTV(tree.m_root, box, collector);
+    std::sort(collector.m_leaves.begin(), collector.m_leaves.end());
+    return collector.m_leaves;
+}
+
+TEST(DbvtRefit, MatchesSequentialUpdatesRebuildAndBruteForce) {
+    srand(11);
+    std::vector<btVector3> positions(kNumLeaves);
+    std::vector<btVector3> velocities(kNumLeaves);
+    btDbvt refitted;
+    btDbvt sequential;
+    std::vector<btDbvtNode*> refittedLeaves(kNumLeaves);
+    std::vector<btDbvtNode*> sequentialLeaves(kNumLeaves);
+    for (int i = 0; i < kNumLeaves; i++) {
+        positions[i] = randVector(10);
+        velocities[i] = randVector(btScalar(0.3));
+        const btDbvtVolume volume = btDbvtVolume::FromCR(positions[i], kRadius);
+        refittedLeaves[i] = refitted.insert(volume, leafData(i));
+        sequentialLeaves[i] = sequential.insert(volume, leafData(i));
+    }
+    refitted.optimizeTopDown(8);
+    ASSERT_EQ(internalCost(refitted.m_root), refitted.refit());
+
+    int numMoved = 0;
+    for (int f = 0; f < kNumFrames; f++) {
+        // the leaves drift and some of them turn around, so volumes grow and also move out of their margin
+        for (int i = 0; i < kNumLeaves; i++) {
+            if (rand() % 8 == 0) {
+                velocities[i] = randVector(btScalar(0.3));
+            }
+            positions[i] += velocities[i];
+            btDbvtVolume refittedVolume = btDbvtVolume::FromCR(positions[i], kRadius);
+            btDbvtVolume sequentialVolume = refittedVolume;
+            const bool moved = refitted.refitLeaf(refittedLeaves[i], refittedVolume, velocities[i] * kVelocityMargin, kMargin);
+            EXPECT_EQ(moved, sequential.update(sequentialLeaves[i], sequentialVolume, velocities[i] * kVelocityMargin, kMargin));
+            numMoved += moved ? 1 : 0;
+        }
+        const btScalar cost = refitted.refit();
+        if (f == kNumFrames / 2) {
+            // the rebuild of btSoftBody::refitTree
+            refitted.optimizeTopDown(8);
+            refitted.refit();
+        }
+        SCOPED_TRACE(f);
+        EXPECT_EQ(internalCost(refitted.m_root), f == kNumFrames / 2 ? refitted.refit() : cost);
+        expectTight(refitted.m_root);
+        ASSERT_EQ(kNumLeaves, btDbvt::countLeaves(refitted.m_root));
+        for (int i = 0; i < kNumLeaves; i++) {
+            ASSERT_EQ(i, leafIndex(refittedLeaves[i]));
+            ASSERT_TRUE(sameVolume(sequentialLeaves[i]->volume, refittedLeaves[i]->volume)) << "leaf " << i;
+            // the leaf still bounds its sphere
+            ASSERT_TRUE(refittedLeaves[i]->volume.Contain(btDbvtVolume::FromCR(positions[i], kRadius))) << "leaf " << i;
+        }
+
+        btDbvt rebuilt;
+        for (int i = 0; i < kNumLeaves; i++) {
+            rebuilt.insert(refittedLeaves[i]->volume, leafData(i));
+        }
+        rebuilt.optimizeTopDown();
+        for (int q = 0; q < kNumQueries; q++) {
+            const btDbvtVolume box = btDbvtVolume::FromCE(randVector(12), randVector(2).absolute());
+            std::vector<int> expected;
+            for (int i = 0; i < kNumLeaves; i++) {
+                if (Intersect(box, refittedLeaves[i]->volume)) {
+                    expected.push_back(i);
+                }
+            }
+            EXPECT_EQ(expected, query(refitted, box)) << "query " << q;
+            EXPECT_EQ(expected, query(sequential, box)) << "query " << q;
+            EXPECT_EQ(expected, query(rebuilt, box)) << "query " << q;
+        }
+    }
+    // most frames grew leaves out of their margin, some stayed inside
+    EXPECT_GT(numMoved, kNumLeaves * kNumFrames / 4);
+    EXPECT_LT(numMoved, kNumLeaves * kNumFrames);
+}
+
+TEST(DbvtRefit, EmptyAndSingleLeafTrees) {
+    btDbvt tree;
+    EXPECT_EQ(0, tree.refit());
+    btDbvtVolume volume = btDbvtVolume::FromCR(btVector3(0, 0, 0), 1);
+    btDbvtNode* leaf = tree.insert(volume, 0);
+    EXPECT_EQ(0, tree.refit());
+    // inside the leaf nothing changes
+    volume = btDbvtVolume::FromCR(btVector3(btScalar(0.1), 0, 0), btScalar(0.5));
+    EXPECT_FALSE(tree.refitLeaf(leaf, volume, btVector3(0, 0, 0), kMargin));
+    volume = btDbvtVolume::FromCR(btVector3(2, 0, 0), 1);
+    EXPECT_TRUE(tree.refitLeaf(leaf, volume, btVector3(1, 0, 0), kMargin));
+    EXPECT_EQ(btScalar(3) + kMargin + 1, leaf->volume.Maxs().x());
+    EXPECT_EQ(btScalar(1) - kMargin, leaf->volume.Mins().x());
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
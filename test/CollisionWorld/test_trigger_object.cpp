@@ -0,0 +1,206 @@
+// btTriggerObject: the begin and end overlap events have to come out in the order the overlaps changed,
+// with the overlaps that begin and end between two clearEvents cancelled out.
+
+#include <stdlib.h>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "btBulletCollisionCommon.h"
+#include "BulletCollision/CollisionDispatch/btGhostObject.h"
+
+const int kNumObjects = 40;
+
+// a trigger box at the origin and small spheres that are moved in and out of it one at a time
+class TriggerWorld {
+public:
+    TriggerWorld() {
+        m_collisionConfiguration = new btDefaultCollisionConfiguration();
+        m_dispatcher = new btCollisionDispatcher(m_collisionConfiguration);
+        // the sweep and prune reports the end of an overlap in the same update, the dbvt cleans up the pairs over several
+        m_broadphase = new btAxisSweep3(btVector3(-50, -50, -50), btVector3(50, 50, 50));
+        m_ghostPairCallback = new btGhostPairCallback();
+        m_broadphase->getOverlappingPairCache()->setInternalGhostPairCallback(m_ghostPairCallback);
+        m_world = new btCollisionWorld(m_dispatcher, m_broadphase, m_collisionConfiguration);
+
+        m_triggerShape = new btBoxShape(btVector3(5, 5, 5));
+        m_trigger = new btTriggerObject();
+        m_trigger->setCollisionShape(m_triggerShape);
+        m_trigger->setCollisionFlags(btCollisionObject::CF_NO_CONTACT_RESPONSE);
+        m_world->addCollisionObject(m_trigger);
+
+        m_sphereShape = new btSphereShape(0.5);
+        for (int i = 0; i < kNumObjects; i++) {
+            btCollisionObject* obj = new btCollisionObject();
+            obj->setCollisionShape(m_sphereShape);
+            m_objects.push_back(obj);
+            m_inside.push_back(false);
+            move(i, false);
+            m_world->addCollisionObject(obj);
+        }
+        update();
+    }
+
+    virtual ~TriggerWorld() {
+        for (int i = m_world->getNumCollisionObjects() - 1; i >= 0; i--) {
+            m_world->removeCollisionObject(m_world->getCollisionObjectArray()[i]);
+        }
+        for (size_t i = 0; i < m_objects.size(); i++) {
+            delete m_objects[i];
+        }
+        delete m_trigger;
+        delete m_sphereShape;
+        delete m_triggerShape;
+        delete m_world;
+        delete m_ghostPairCallback;
+        delete m_broadphase;
+        delete m_dispatcher;
+        delete m_collisionConfiguration;
+    }
+
+    // each object has its own place inside and outside the trigger
+    void move(int i, bool inside) {
+        btTransform transform;
+        transform.setIdentity();
+        transform.setOrigin(btVector3(btScalar(i % 8) - 4, btScalar(i / 8) - 2, inside ? 0 : 20));
+        m_objects[i]->setWorldTransform(transform);
+        m_inside[i] = inside;
+    }
+
+    void update() { m_world->performDiscreteCollisionDetection(); }
+
+    btDefaultCollisionConfiguration* m_collisionConfiguration;
+    btCollisionDispatcher* m_dispatcher;
+    btBroadphaseInterface* m_broadphase;
+    btGhostPairCallback* m_ghostPairCallback;
+    btCollisionWorld* m_world;
+    btCollisionShape* m_triggerShape;
+    btCollisionShape* m_sphereShape;
+    btTriggerObject* m_trigger;
+    std::vector<btCollisionObject*> m_objects;
+    std::vector<bool> m_inside;
+};
+
+// the events as the documentation describes them: a BEGIN_OVERLAP is erased when its overlap ends before clearEvents
+class ReferenceEvents {
+public:
+    void begin(const btCollisionObject* obj) { add(obj, btTriggerObject::BEGIN_OVERLAP); }
+
+    void end(const btCollisionObject* obj) {
+        for (size_t i = 0; i < m_events.size(); i++) {
+            if (m_events[i].m_object == obj && m_events[i].m_type == btTriggerObject::BEGIN_OVERLAP) {
+                m_events.erase(m_events.begin() + i);
+                return;
+            }
+        }
+        add(obj, btTriggerObject::END_OVERLAP);
+    }
+
+    void clear() { m_events.clear(); }
+
+    void add(const btCollisionObject* obj, int type) {
+        btTriggerObject::Event ev;
+        ev.m_object = obj;
+        ev.m_type = type;
+        m_events.push_back(ev);
+    }
+
+    std::vector<btTriggerObject::Event> m_events;
+};
+
+static void expectEvents(const ReferenceEvents& expected, const btTriggerObject* trigger, int step) {
+    ASSERT_EQ((int)expected.m_events.size(), trigger->getNumEvents()) << "step " << step;
+    for (int i = 0; i < trigger->getNumEvents(); i++) {
+        EXPECT_EQ(expected.m_events[i].m_object, trigger->getEvent(i).m_object) << "step " << step << " event " << i;
+        EXPECT_EQ(expected.m_events[i].m_type, trigger->getEvent(i).m_type) << "step " << step << " event " << i;
+    }
+}
+
+TEST(TriggerObject, CancelledBeginKeepsTheOrder) {
+    TriggerWorld world;
+    ReferenceEvents expected;
+    for (int i = 0; i < 3; i++) {
+        world.move(i, true);
+        world.update();
+        expected.begin(world.m_objects[i]);
+    }
+    // cancels the first event
+    world.move(0, false);
+    world.update();
+    expected.end(world.m_objects[0]);
+    expectEvents(expected, world.m_trigger, 0);
+
+    // the events were compacted by reading them, the pending BEGIN_OVERLAP of the others moved
+    world.move(3, true);
+    world.update();
+    expected.begin(world.m_objects[3]);
+    world.move(2, false);
+    world.update();
+    expected.end(world.m_objects[2]);
+    world.move(1, false);
+    world.update();
+    expected.end(world.m_objects[1]);
+    expectEvents(expected, world.m_trigger, 1);
+    EXPECT_FALSE(world.m_trigger->isOverlapping(world.m_objects[1]));
+    EXPECT_TRUE(world.m_trigger->isOverlapping(world.m_objects[3]));
+
+    // an overlap that was already reported ends with END_OVERLAP
+    world.m_trigger->clearEvents();
+    expected.clear();
+    world.move(3, false);
+    world.update();
+    expected.end(world.m_objects[3]);
+    expectEvents(expected, world.m_trigger, 2);
+    ASSERT_EQ(1, world.m_trigger->getNumEvents());
+    EXPECT_EQ(btTriggerObject::END_OVERLAP, world.m_trigger->getEvent(0).m_type);
+}
+
+TEST(TriggerObject, RandomOverlapsMatchReference) {
+    TriggerWorld world;
+    ReferenceEvents expected;
+    srand(11);
+    for (int step = 0; step < 2000; step++) {
+        int i = rand() % kNumObjects;
+        bool inside = !world.m_inside[i];
+        world.move(i, inside);
+        world.update();
+        if (inside) {
+            expected.begin(world.m_objects[i]);
+        } else {
+            expected.end(world.m_objects[i]);
+        }
+        // read the events only now and then, so several cancellations pile up between the reads
+        int action = rand() % 16;
+        if (action == 0) {
+            expectEvents(expected, world.m_trigger, step);
+        } else if (action == 1) {
+            expectEvents(expected, world.m_trigger, step);
+            world.m_trigger->clearEvents();
+            expected.clear();
+        }
+    }
+    expectEvents(expected, world.m_trigger, -1);
+    int numInside = 0;
+    for (int i = 0; i < kNumObjects; i++) {
+        EXPECT_EQ(world.m_inside[i], world.m_trigger->isOverlapping(world.m_objects[i])) << "object " << i;
+        numInside += world.m_inside[i] ? 1 : 0;
+    }
+    EXPECT_EQ(numInside, world.m_trigger->getNumOverlappingObjects());
+}
+
+TEST(TriggerObject, RemovedObjectEndsItsOverlap) {
+    TriggerWorld world;
+    world.move(5, true);
+    world.update();
+    world.m_trigger->clearEvents();
+    world.m_world->removeCollisionObject(world.m_objects[5]);
+    ASSERT_EQ(1, world.m_trigger->getNumEvents());
+    EXPECT_EQ(world.m_objects[5], world.m_trigger->getEvent(0).m_object);
+    EXPECT_EQ(btTriggerObject::END_OVERLAP, world.m_trigger->getEvent(0).m_type);
+    EXPECT_FALSE(world.m_trigger->isOverlapping(world.m_objects[5]));
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
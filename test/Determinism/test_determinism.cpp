@@ -0,0 +1,263 @@
+// Determinism tests: a world restored from a btWorldCheckpoint has to re-simulate bit-exactly,
+// so rollback networking can replay frames and end up in the same state as the original run.
+
+#include <cstring>
+
+#include <gtest/gtest.h>
+
+#include "btBulletDynamicsCommon.h"
+#include "BulletDynamics/Dynamics/btWorldCheckpoint.h"
+#include "BulletDynamics/Dynamics/btDeltaSnapshotBuffer.h"
+
+const int kNumCheckpointSteps = 60;
+const int kNumReplaySteps = 120;
+const btScalar kFixedTimeStep = btScalar(1.) / btScalar(60.);
+
+// box pyramid, a row of spheres, a hinged plank and a heavy box falling into the pile
+class DeterminismWorld {
+public:
+    DeterminismWorld() {
+        m_collisionConfiguration = new btDefaultCollisionConfiguration();
+        m_dispatcher = new btCollisionDispatcher(m_collisionConfiguration);
+        m_broadphase = new btDbvtBroadphase();
+        m_solver = new btSequentialImpulseConstraintSolver();
+        m_world = new btDiscreteDynamicsWorld(m_dispatcher, m_broadphase, m_solver,
+                                              m_collisionConfiguration);
+        m_world->setGravity(btVector3(0, -10, 0));
+        // randomized constraint order, so the solver seed is part of the state
+        m_world->getSolverInfo().m_solverMode |= SOLVER_RANDMIZE_ORDER;
+
+        m_groundShape = new btBoxShape(btVector3(50, 1, 50));
+        m_boxShape = new btBoxShape(btVector3(0.5, 0.5, 0.5));
+        m_sphereShape = new btSphereShape(0.4);
+        m_plankShape = new btBoxShape(btVector3(2, 0.1, 0.5));
+
+        addBody(0, m_groundShape, btVector3(0, -1, 0));
+        const int kLevels = 5;
+        for (int level = 0; level < kLevels; level++) {
+            for (int i = 0; i < kLevels - level; i++) {
+                addBody(1, m_boxShape,
+                        btVector3(i * 1.01 + level * 0.505 - 2, 0.5 + level * 1.001, 0));
+            }
+        }
+        for (int i = 0; i < 6; i++) {
+            addBody(0.5, m_sphereShape, btVector3(i - 3, 1 + i * 0.7, 3));
+        }
+        btRigidBody* plank = addBody(2, m_plankShape, btVector3(0, 4, -3));
+        btHingeConstraint* hinge = new btHingeConstraint(*plank, btVector3(0, 0, 0), btVector3(0, 0, 1));
+        m_world->addConstraint(hinge);
+        btRigidBody* heavy = addBody(10, m_boxShape, btVector3(0.3, 9, 0.2));
+        heavy->setAngularVelocity(btVector3(1, 2, 3));
+    }
+
+    virtual ~DeterminismWorld() {
+        for (int i = m_world->getNumConstraints() - 1; i >= 0; i--) {
+            btTypedConstraint* constraint = m_world->getConstraint(i);
+            m_world->removeConstraint(constraint);
+            delete constraint;
+        }
+        for (int i = m_world->getNumCollisionObjects() - 1; i >= 0; i--) {
+            btCollisionObject* obj = m_world->getCollisionObjectArray()[i];
+            m_world->removeCollisionObject(obj);
+            delete obj;
+        }
+        delete m_world;
+        delete m_solver;
+        delete m_broadphase;
+        delete m_dispatcher;
+        delete m_collisionConfiguration;
+        delete m_groundShape;
+        delete m_boxShape;
+        delete m_sphereShape;
+        delete m_plankShape;
+    }
+
+    // append the raw bytes of the transforms and velocities of all bodies
+    void appendState(btAlignedObjectArray<unsigned char>* state) const {
+        for (int i = 0; i < m_world->getNumCollisionObjects(); i++) {
+            const btRigidBody* body = btRigidBody::upcast(m_world->getCollisionObjectArray()[i]);
+            appendBytes(state, &body->getWorldTransform(), sizeof(btTransform));
+            appendBytes(state, &body->getLinearVelocity(), sizeof(btVector3));
+            appendBytes(state, &body->getAngularVelocity(), sizeof(btVector3));
+            const int activation = body->getActivationState();
+            appendBytes(state, &activation, sizeof(int));
+        }
+    }
+
+    // move the dynamic bodies up, out of contact
+    void liftBodies(btScalar height) {
+        for (int i = 0; i < m_world->getNumCollisionObjects(); i++) {
+            btRigidBody* body = btRigidBody::upcast(m_world->getCollisionObjectArray()[i]);
+            if (body->isStaticObject()) {
+                continue;
+            }
+            btTransform transform = body->getWorldTransform();
+            transform.getOrigin() += btVector3(0, height, 0);
+            body->setWorldTransform(transform);
+            body->activate(true);
+        }
+    }
+
+    // step and record the state after every step
+    void stepAndRecord(int numSteps, btAlignedObjectArray<unsigned char>* states) {
+        for (int i = 0; i < numSteps; i++) {
+            m_world->stepSimulation(kFixedTimeStep * btScalar(0.7), 2, kFixedTimeStep);
+            appendState(states);
+        }
+    }
+
+    btDiscreteDynamicsWorld* m_world;
+    btDbvtBroadphase* m_broadphase;
+
+private:
+    btRigidBody* addBody(btScalar mass, btCollisionShape* shape, const btVector3& origin) {
+        btVector3 inertia(0, 0, 0);
+        if (mass) {
+            shape->calculateLocalInertia(mass, inertia);
+        }
+        btTransform transform;
+        transform.setIdentity();
+        transform.setOrigin(origin);
+        btRigidBody* body = new btRigidBody(mass, 0, shape, inertia);
+        body->setWorldTransform(transform);
+        m_world->addRigidBody(body);
+        return body;
+    }
+
+    static void appendBytes(btAlignedObjectArray<unsigned char>* state, const void* data, int size) {
+        const int offset = state->size();
+        state->resize(offset + size);
+        memcpy(&(*state)[offset], data, size);
+    }
+
+    btDefaultCollisionConfiguration* m_collisionConfiguration;
+    btCollisionDispatcher* m_dispatcher;
+    btSequentialImpulseConstraintSolver* m_solver;
+    btCollisionShape* m_groundShape;
+    btCollisionShape* m_boxShape;
+    btCollisionShape* m_sphereShape;
+    btCollisionShape* m_plankShape;
+};
+
+bool statesEqual(const btAlignedObjectArray<unsigned char>& a,
+                 const btAlignedObjectArray<unsigned char>& b) {
+    return a.size() == b.size() && (a.size() == 0 || memcmp(&a[0], &b[0], a.size()) == 0);
+}
+
+TEST(Determinism, identicalWorldsStayIdentical) {
+    DeterminismWorld world0;
+    DeterminismWorld world1;
+    btAlignedObjectArray<unsigned char> states0;
+    btAlignedObjectArray<unsigned char> states1;
+    world0.stepAndRecord(kNumCheckpointSteps + kNumReplaySteps, &states0);
+    world1.stepAndRecord(kNumCheckpointSteps + kNumReplaySteps, &states1);
+    EXPECT_TRUE(statesEqual(states0, states1));
+}
+
+TEST(Determinism, checkpointReplayIsBitExact) {
+    DeterminismWorld world;
+    btAlignedObjectArray<unsigned char> ignored;
+    world.stepAndRecord(kNumCheckpointSteps, &ignored);
+
+    btWorldCheckpoint checkpoint;
+    EXPECT_FALSE(checkpoint.restore(world.m_world, world.m_broadphase));
+    checkpoint.capture(world.m_world, world.m_broadphase);
+    ASSERT_TRUE(checkpoint.isValid());
+
+    btAlignedObjectArray<unsigned char> reference;
+    world.stepAndRecord(kNumReplaySteps, &reference);
+
+    // replay twice, the second time from a diverged world
+    for (int replay = 0; replay < 2; replay++) {
+        ASSERT_TRUE(checkpoint.restore(world.m_world, world.m_broadphase));
+        btAlignedObjectArray<unsigned char> states;
+        world.stepAndRecord(kNumReplaySteps, &states);
+        ASSERT_EQ(reference.size(), states.size());
+        for (int step = 0; step < kNumReplaySteps; step++) {
+            const int stepSize = reference.size() / kNumReplaySteps;
+            ASSERT_EQ(0, memcmp(&reference[step * stepSize], &states[step * stepSize], stepSize))
+                << "replay " << replay << " diverged at step " << step;
+        }
+        world.m_world->getCollisionObjectArray()[3]->getWorldTransform().getOrigin() += btVector3(0, 3, 0);
+        btRigidBody::upcast(world.m_world->getCollisionObjectArray()[5])->setLinearVelocity(btVector3(5, 0, 0));
+        world.stepAndRecord(17, &ignored);
+    }
+}
+
+TEST(Determinism, checkpointRejectsChangedWorld) {
+    DeterminismWorld world;
+    btWorldCheckpoint checkpoint;
+    checkpoint.capture(world.m_world, world.m_broadphase);
+    btCollisionObject* obj = world.m_world->getCollisionObjectArray()[1];
+    world.m_world->removeCollisionObject(obj);
+    EXPECT_FALSE(checkpoint.restore(world.m_world, world.m_broadphase));
+    delete obj;
+}
+
+TEST(Determinism, deltaSnapshotRestoresExactState) {
+    DeterminismWorld world;
+    btAlignedObjectArray<unsigned char> ignored;
+    btDeltaSnapshotBuffer snapshots(1 << 16);
+    world.stepAndRecord(10, &ignored);
+    const int snapshotId = snapshots.captureSnapshot(world.m_world);
+    ASSERT_GE(snapshotId, 0);
+    btAlignedObjectArray<unsigned char> reference;
+    world.appendState(&reference);
+
+    world.stepAndRecord(30, &ignored);
+    ASSERT_TRUE(snapshots.restoreSnapshot(world.m_world, snapshotId));
+    btAlignedObjectArray<unsigned char> restored;
+    world.appendState(&restored);
+    EXPECT_TRUE(statesEqual(reference, restored));
+}
+
+TEST(Determinism, deltaSnapshotsRestoreExactStateAfterWrapping) {
+    DeterminismWorld world;
+    btAlignedObjectArray<unsigned char> ignored;
+    // room for a few snapshots, the ring wraps many times. The pile is lifted out of contact now and then,
+    // so the size of the snapshots changes with the stored contacts, and a large snapshot wraps to the start
+    // of the buffer while smaller snapshots of the previous lap are left at the end
+    const int kBufferSize = 16 * 1024;
+    btDeltaSnapshotBuffer snapshots(kBufferSize, BT_SNAPSHOT_CONTACT_IMPULSES, 1);
+    btAlignedObjectArray<unsigned char> references;
+    int stateSize = 0;
+    int capturedBytes = 0;
+    for (int step = 0; step < 600; step++) {
+        if (step % 23 == 22) {
+            world.liftBodies(btScalar(0.5));
+        }
+        world.stepAndRecord(1, &ignored);
+        const int snapshotId = snapshots.captureSnapshot(world.m_world);
+        ASSERT_GE(snapshotId, 0);
+        capturedBytes += snapshots.getSnapshotSize(snapshotId);
+        btAlignedObjectArray<unsigned char> state;
+        world.appendState(&state);
+        stateSize = state.size();
+        ASSERT_EQ(snapshotId * stateSize, references.size());
+        references.resize(references.size() + stateSize);
+        memcpy(&references[snapshotId * stateSize], &state[0], stateSize);
+
+        if (step % 50 != 49) {
+            continue;
+        }
+        // every snapshot that is still in the buffer restores the state it captured
+        const int oldest = snapshots.getOldestSnapshotId();
+        const int newest = snapshots.getNewestSnapshotId();
+        ASSERT_EQ(snapshotId, newest);
+        ASSERT_GT(newest, oldest);
+        for (int id = oldest; id <= newest; id++) {
+            ASSERT_TRUE(snapshots.hasSnapshot(id)) << "snapshot " << id;
+            ASSERT_TRUE(snapshots.restoreSnapshot(world.m_world, id)) << "snapshot " << id;
+            btAlignedObjectArray<unsigned char> restored;
+            world.appendState(&restored);
+            ASSERT_EQ(stateSize, restored.size());
+            EXPECT_EQ(0, memcmp(&references[id * stateSize], &restored[0], stateSize)) << "snapshot " << id;
+        }
+    }
+    EXPECT_GT(capturedBytes, 4 * kBufferSize);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
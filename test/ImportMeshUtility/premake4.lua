@@ -0,0 +1,35 @@
+
+	project "Test_LoadTriangleMesh"
+
+	kind "ConsoleApp"
+
+--	defines {  }
+
+
+
+	includedirs
+	{
+		".",
+		"../../src",
+		"../../examples",
+		"../gtest-1.7.0/include"
+
+	}
+
+
+	if os.is("Windows") then
+		--see http://stackoverflow.com/questions/12558327/google-test-in-visual-studio-2012
+		defines {"_VARIADIC_MAX=10"}
+	end
+
+	links {"BulletCollision", "LinearMath", "gtest"}
+
+	files {
+		"test_load_triangle_mesh.cpp",
+		"../../examples/Importers/ImportMeshUtility/LoadTriangleMesh.cpp",
+		"../../examples/Importers/ImportMeshUtility/LoadTriangleMesh.h",
+	}
+
+	if os.is("Linux") then
+                links {"pthread"}
+        end
@@ -0,0 +1,113 @@
+// LoadTriangleMesh tests: the OBJ and STL loaders on the small meshes in data/test_mesh.
+
+#include <cstring>
+
+#include <gtest/gtest.h>
+
+#include "Importers/ImportMeshUtility/LoadTriangleMesh.h"
+#include "Bullet3Common/b3FileUtils.h"
+
+static LoadedTriangleMesh* loadMesh(const char* name, const btVector3& scale = btVector3(1, 1, 1)) {
+    char fileName[1024];
+    if (!b3FileUtils::findFile(name, fileName, sizeof(fileName))) {
+        ADD_FAILURE() << "cannot find " << name;
+        return 0;
+    }
+    int length = strlen(fileName);
+    if (length > 4 && strcmp(fileName + length - 4, ".obj") == 0) {
+        return LoadTriangleMeshFromObj(fileName, scale);
+    }
+    return LoadTriangleMeshFromSTL(fileName, scale);
+}
+
+static void expectTriangle(const LoadedTriangleMesh* mesh, int triangle, int i0, int i1, int i2) {
+    ASSERT_LT(triangle, mesh->getNumTriangles());
+    EXPECT_EQ(i0, mesh->m_indices[triangle * 3]) << "triangle " << triangle;
+    EXPECT_EQ(i1, mesh->m_indices[triangle * 3 + 1]) << "triangle " << triangle;
+    EXPECT_EQ(i2, mesh->m_indices[triangle * 3 + 2]) << "triangle " << triangle;
+}
+
+static void expectVertex(const LoadedTriangleMesh* mesh, int vertex, btScalar x, btScalar y, btScalar z) {
+    ASSERT_LT(vertex, mesh->getNumVertices());
+    EXPECT_EQ(x, mesh->m_vertices[vertex * 3]) << "vertex " << vertex;
+    EXPECT_EQ(y, mesh->m_vertices[vertex * 3 + 1]) << "vertex " << vertex;
+    EXPECT_EQ(z, mesh->m_vertices[vertex * 3 + 2]) << "vertex " << vertex;
+}
+
+TEST(LoadTriangleMesh, ObjTextureCoordinatesNormalsAndNegativeIndices) {
+    LoadedTriangleMesh* mesh = loadMesh("test_mesh/vt_vn_negative.obj");
+    ASSERT_TRUE(mesh != 0);
+    // the vertex that isn't used by a face is dropped
+    EXPECT_EQ(7, mesh->getNumVertices());
+    ASSERT_EQ(4, mesh->getNumTriangles());
+    expectTriangle(mesh, 0, 0, 1, 2);
+    expectTriangle(mesh, 1, 0, 2, 3);
+    expectTriangle(mesh, 2, 4, 5, 6);
+    expectTriangle(mesh, 3, 6, 5, 4);
+    expectVertex(mesh, 2, 1, 1, 0);
+    expectVertex(mesh, 5, 1, 0, 1);
+    EXPECT_EQ(4, mesh->getIndexedMeshArray()[0].m_numTriangles);
+    EXPECT_EQ(7, mesh->getIndexedMeshArray()[0].m_numVertices);
+    delete mesh;
+}
+
+TEST(LoadTriangleMesh, ObjWeldsVerticesAndDropsDegenerateTriangles) {
+    LoadedTriangleMesh* mesh = loadMesh("test_mesh/degenerate.obj", btVector3(2, 3, 4));
+    ASSERT_TRUE(mesh != 0);
+    EXPECT_EQ(3, mesh->getNumVertices());
+    ASSERT_EQ(2, mesh->getNumTriangles());
+    expectTriangle(mesh, 0, 0, 1, 2);
+    expectTriangle(mesh, 1, 1, 2, 0);
+    expectVertex(mesh, 1, 2, 0, 0);
+    expectVertex(mesh, 2, 0, 3, 0);
+    delete mesh;
+}
+
+TEST(LoadTriangleMesh, AsciiStlPolygonFan) {
+    LoadedTriangleMesh* mesh = loadMesh("test_mesh/hexagon_ascii.stl");
+    ASSERT_TRUE(mesh != 0);
+    // the facet with 2 vertices is dropped, its vertices are shared with the last facet
+    EXPECT_EQ(9, mesh->getNumVertices());
+    ASSERT_EQ(5, mesh->getNumTriangles());
+    expectTriangle(mesh, 0, 0, 1, 2);
+    expectTriangle(mesh, 1, 0, 2, 3);
+    expectTriangle(mesh, 2, 0, 3, 4);
+    expectTriangle(mesh, 3, 0, 4, 5);
+    expectTriangle(mesh, 4, 6, 7, 8);
+    expectVertex(mesh, 4, -1, btScalar(-1.5), 0);
+    delete mesh;
+}
+
+TEST(LoadTriangleMesh, BinaryStlMatchesAsciiStl) {
+    LoadedTriangleMesh* ascii = loadMesh("test_mesh/tetrahedron_ascii.stl");
+    // the header of the binary file starts with 'solid' too
+    LoadedTriangleMesh* binary = loadMesh("test_mesh/tetrahedron_binary.stl");
+    ASSERT_TRUE(ascii != 0);
+    ASSERT_TRUE(binary != 0);
+    // each corner is shared by 3 facets
+    EXPECT_EQ(4, ascii->getNumVertices());
+    ASSERT_EQ(4, ascii->getNumTriangles());
+    expectTriangle(ascii, 0, 0, 1, 2);
+    expectTriangle(ascii, 3, 2, 1, 3);
+    expectVertex(ascii, 3, 0, 0, 1);
+    ASSERT_EQ(ascii->getNumVertices(), binary->getNumVertices());
+    ASSERT_EQ(ascii->getNumTriangles(), binary->getNumTriangles());
+    for (int i = 0; i < ascii->m_vertices.size(); i++) {
+        EXPECT_EQ(ascii->m_vertices[i], binary->m_vertices[i]);
+    }
+    for (int i = 0; i < ascii->m_indices.size(); i++) {
+        EXPECT_EQ(ascii->m_indices[i], binary->m_indices[i]);
+    }
+    delete ascii;
+    delete binary;
+}
+
+TEST(LoadTriangleMesh, MissingFile) {
+    EXPECT_TRUE(LoadTriangleMeshFromObj("test_mesh/does_not_exist.obj") == 0);
+    EXPECT_TRUE(LoadTriangleMeshFromSTL("test_mesh/does_not_exist.stl") == 0);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -36,6 +36,48 @@
 
 
 
+	-- gtest-only tests of the inverse dynamics library
+	local invdynTests = {
+		{ "Test_InverseDynamicsBatch", "test_invdyn_batch.cpp" },
+		{ "Test_InverseDynamicsDerivatives", "test_invdyn_derivatives.cpp" },
+		{ "Test_InverseDynamicsForwardDynamics", "test_invdyn_forward_dynamics.cpp" },
+	}
+
+	for _, test in ipairs(invdynTests) do
+
+	project (test[1])
+
+	kind "ConsoleApp"
+
+	includedirs
+	{
+		".",
+		"../../src",
+		"../../Extras/InverseDynamics",
+		"../gtest-1.7.0/include"
+
+	}
+
+
+	if os.is("Windows") then
+		defines {"_VARIADIC_MAX=10"}
+	end
+
+	links {"BulletInverseDynamicsUtils", "BulletInverseDynamics","Bullet3Common","LinearMath", "gtest"}
+
+	files {
+		test[2],
+	}
+
+	if os.is("Linux") then
+                links {"pthread"}
+        end
+
+	end
+
+
+
+
 
         project "Test_InverseForwardDynamics"
 
@@ -73,6 +115,8 @@
         "../../examples/Importers/ImportURDFDemo/MyMultiBodyCreator.h",
         "../../examples/Importers/ImportURDFDemo/BulletUrdfImporter.cpp",
         "../../examples/Importers/ImportURDFDemo/BulletUrdfImporter.h",
+        "../../examples/Importers/ImportURDFDemo/BulletUrdfImportCache.cpp",
+        "../../examples/Importers/ImportURDFDemo/BulletUrdfImportCache.h",
         "../../examples/Importers/ImportURDFDemo/UrdfParser.cpp",
         "../../examples/Importers/ImportURDFDemo/BulletUrdfImporter.cpp",
         "../../examples/Importers/ImportURDFDemo/BulletUrdfImporter.h",
@@ -90,6 +134,8 @@
         "../../examples/Importers/ImportObjDemo/LoadMeshFromObj.cpp",
         "../../examples/Importers/ImportSTLDemo/ImportSTLSetup.h",
         "../../examples/Importers/ImportSTLDemo/LoadMeshFromSTL.h",
+        "../../examples/Importers/ImportMeshUtility/LoadTriangleMesh.cpp",
+        "../../examples/Importers/ImportMeshUtility/LoadTriangleMesh.h",
         "../../examples/Importers/ImportColladaDemo/LoadMeshFromCollada.cpp",
         "../../examples/Importers/ImportColladaDemo/ColladaGraphicsInstance.h",
         "../../examples/ThirdPartyLibs/Wavefront/tiny_obj_loader.cpp",
@@ -0,0 +1,124 @@
+// Test of batched inverse dynamics and mass matrix calculation:
+// the batch results must match the single sample versions
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <gtest/gtest.h>
+
+#include "../Extras/InverseDynamics/CoilCreator.hpp"
+#include "../Extras/InverseDynamics/DillCreator.hpp"
+#include "../Extras/InverseDynamics/SimpleTreeCreator.hpp"
+#include "../Extras/InverseDynamics/IDRandomUtil.hpp"
+#include "../Extras/InverseDynamics/RandomTreeCreator.hpp"
+#include "BulletInverseDynamics/MultiBodyTree.hpp"
+
+using namespace btInverseDynamics;
+
+const int kLevel = 4;
+const int kNumBodies = BT_ID_POW(2, kLevel);
+// not a multiple of the batch block size, to test partial blocks
+const int kNumSamples = 21;
+
+// maximum relative difference between batch and single sample results
+void calculateBatchErrors(MultiBodyTree* tree, const bool use_float, idScalar* id_error,
+                          idScalar* mass_matrix_error) {
+    const int ndofs = tree->numDoFs();
+    matxx q(ndofs, kNumSamples);
+    matxx u(ndofs, kNumSamples);
+    matxx dot_u(ndofs, kNumSamples);
+    for (int s = 0; s < kNumSamples; s++) {
+        for (int i = 0; i < ndofs; i++) {
+            q.setElem(i, s, randomFloat(-1.0, 1.0));
+            u.setElem(i, s, randomFloat(-1.0, 1.0));
+            dot_u.setElem(i, s, randomFloat(-1.0, 1.0));
+        }
+    }
+    matxx joint_forces(ndofs, kNumSamples);
+    matxx mass_matrices(ndofs * ndofs, kNumSamples);
+    ASSERT_EQ(0, tree->calculateInverseDynamicsBatch(q, u, dot_u, &joint_forces, use_float));
+    ASSERT_EQ(0, tree->calculateMassMatrixBatch(q, &mass_matrices, use_float));
+
+    *id_error = 0;
+    *mass_matrix_error = 0;
+    vecx qs(ndofs);
+    vecx us(ndofs);
+    vecx dot_us(ndofs);
+    vecx joint_forces_s(ndofs);
+    matxx mass_matrix_s(ndofs, ndofs);
+    for (int s = 0; s < kNumSamples; s++) {
+        for (int i = 0; i < ndofs; i++) {
+            qs(i) = q(i, s);
+            us(i) = u(i, s);
+            dot_us(i) = dot_u(i, s);
+        }
+        ASSERT_EQ(0, tree->calculateInverseDynamics(qs, us, dot_us, &joint_forces_s));
+        ASSERT_EQ(0, tree->calculateMassMatrix(qs, &mass_matrix_s));
+        for (int i = 0; i < ndofs; i++) {
+            const idScalar error = std::fabs(joint_forces(i, s) - joint_forces_s(i)) /
+                                   (1.0 + std::fabs(joint_forces_s(i)));
+            *id_error = BT_ID_MAX(*id_error, error);
+            for (int j = 0; j < ndofs; j++) {
+                const idScalar error = std::fabs(mass_matrices(i * ndofs + j, s) - mass_matrix_s(i, j)) /
+                                       (1.0 + std::fabs(mass_matrix_s(i, j)));
+                *mass_matrix_error = BT_ID_MAX(*mass_matrix_error, error);
+            }
+        }
+    }
+}
+
+void testBatch(MultiBodyTree* tree) {
+    ASSERT_TRUE(0x0 != tree);
+#ifdef BT_ID_USE_DOUBLE_PRECISION
+    const idScalar kMaxError = 1e-10;
+#else
+    const idScalar kMaxError = 1e-4;
+#endif
+    const idScalar kMaxFloatError = 1e-3;
+    idScalar id_error;
+    idScalar mass_matrix_error;
+
+    calculateBatchErrors(tree, false, &id_error, &mass_matrix_error);
+    EXPECT_LT(id_error, kMaxError);
+    EXPECT_LT(mass_matrix_error, kMaxError);
+
+    calculateBatchErrors(tree, true, &id_error, &mass_matrix_error);
+    EXPECT_LT(id_error, kMaxFloatError);
+    EXPECT_LT(mass_matrix_error, kMaxFloatError);
+    delete tree;
+}
+
+TEST(InvDynBatch, matchesSingleSample) {
+    randomInit(0);
+    CoilCreator coil_creator(kNumBodies);
+    DillCreator dill_creator(kLevel);
+    SimpleTreeCreator simple_creator(kNumBodies);
+
+    testBatch(CreateMultiBodyTree(coil_creator));
+    testBatch(CreateMultiBodyTree(dill_creator));
+    testBatch(CreateMultiBodyTree(simple_creator));
+    RandomTreeCreator random_creator(kNumBodies);
+    MultiBodyTree* random_tree = CreateMultiBodyTree(random_creator);
+    ASSERT_TRUE(0x0 != random_tree);
+    ASSERT_EQ(0, addRandomUserForce(kNumBodies - 1, random_tree));
+    testBatch(random_tree);
+}
+
+TEST(InvDynBatch, dimensionErrors) {
+    CoilCreator coil_creator(kNumBodies);
+    MultiBodyTree* tree = CreateMultiBodyTree(coil_creator);
+    ASSERT_TRUE(0x0 != tree);
+    const int ndofs = tree->numDoFs();
+    matxx q(ndofs, kNumSamples);
+    matxx joint_forces(ndofs, kNumSamples + 1);
+    matxx mass_matrices(ndofs, kNumSamples);
+    EXPECT_EQ(-1, tree->calculateInverseDynamicsBatch(q, q, q, &joint_forces));
+    EXPECT_EQ(-1, tree->calculateMassMatrixBatch(q, &mass_matrices));
+    delete tree;
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
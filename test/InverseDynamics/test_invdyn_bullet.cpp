@@ -105,6 +105,70 @@ TEST(InvDynCompare, bulletUrdfR2D2) {
     EXPECT_LT(max_acc_error, std::numeric_limits<idScalar>::epsilon()*1e5);
 }
 
+/// compare forward dynamics of the inverse dynamics model (articulated body algorithm)
+/// to btMultiBody for random input
+TEST(InvDynCompare, bulletUrdfR2D2ForwardDynamics) {
+    MyBtMultiBodyFromURDF mb_load(gravity, kBaseFixed);
+
+    char relativeFileName[1024];
+
+    ASSERT_TRUE(b3ResourcePath::findResourcePath(kUrdfFile, relativeFileName, 1024));
+
+    mb_load.setFileName(relativeFileName);
+    mb_load.init();
+
+    btMultiBodyTreeCreator id_creator;
+    btMultiBody *btmb = mb_load.getBtMultiBody();
+    ASSERT_EQ(id_creator.createFromBtMultiBody(btmb), 0);
+
+    MultiBodyTree *id_tree = CreateMultiBodyTree(id_creator);
+    ASSERT_EQ(0x0 != id_tree, true);
+
+    vecx q(id_tree->numDoFs());
+    vecx u(id_tree->numDoFs());
+    vecx joint_forces(id_tree->numDoFs());
+
+    const int kNLoops = 10;
+    double max_acc_error = 0;
+    double max_jac_error = 0;
+
+    b3Srand(0);
+
+    for (int loop = 0; loop < kNLoops; loop++) {
+        for (int i = 0; i < q.size(); i++) {
+            q(i) = b3RandRange(-B3_PI, B3_PI);
+            u(i) = b3RandRange(-B3_PI, B3_PI);
+            joint_forces(i) = b3RandRange(-B3_PI, B3_PI);
+        }
+
+        double acc_error;
+        double jac_error;
+        btmb->clearForcesAndTorques();
+        id_tree->clearAllUserForcesAndMoments();
+
+        EXPECT_EQ(compareForwardDynamics(q, u, joint_forces, gravity, FLAGS_verbose, btmb, id_tree,
+                                         &acc_error),
+                  0);
+        EXPECT_EQ(compareJacobians(q, u, FLAGS_verbose, btmb, id_tree, &jac_error), 0);
+
+        if (acc_error > max_acc_error) {
+            max_acc_error = acc_error;
+        }
+        if (jac_error > max_jac_error) {
+            max_jac_error = jac_error;
+        }
+    }
+
+    if (FLAGS_verbose) {
+        printf("max_acc_error= %e\n", max_acc_error);
+        printf("max_jac_error= %e\n", max_jac_error);
+    }
+
+    EXPECT_LT(max_acc_error, std::numeric_limits<idScalar>::epsilon()*1e5);
+    EXPECT_LT(max_jac_error, std::numeric_limits<idScalar>::epsilon()*1e4);
+    delete id_tree;
+}
+
 int main(int argc, char **argv) {
     b3CommandLineArgs myArgs(argc,argv);
     FLAGS_verbose = myArgs.CheckCmdLineFlag("verbose");
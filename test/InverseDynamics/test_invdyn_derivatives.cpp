@@ -0,0 +1,102 @@
+// Test of inverse dynamics derivatives: compare analytic partial derivatives of the
+// joint forces with respect to q and u with central finite differences
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <gtest/gtest.h>
+
+#include "../Extras/InverseDynamics/CoilCreator.hpp"
+#include "../Extras/InverseDynamics/DillCreator.hpp"
+#include "../Extras/InverseDynamics/SimpleTreeCreator.hpp"
+#include "../Extras/InverseDynamics/IDRandomUtil.hpp"
+#include "../Extras/InverseDynamics/RandomTreeCreator.hpp"
+#include "BulletInverseDynamics/MultiBodyTree.hpp"
+
+using namespace btInverseDynamics;
+
+const int kLevel = 3;
+const int kNumBodies = BT_ID_POW(2, kLevel);
+
+#ifdef BT_ID_USE_DOUBLE_PRECISION
+const idScalar kDelta = 1e-6;
+const idScalar kMaxError = 1e-6;
+#else
+const idScalar kDelta = 1e-2;
+const idScalar kMaxError = 1e-3;
+#endif
+
+// maximum difference between analytic and finite difference derivatives,
+// relative to the largest derivative
+void calculateDerivativeErrors(MultiBodyTree* tree, idScalar* error_q, idScalar* error_u) {
+    const int ndofs = tree->numDoFs();
+    vecx q(ndofs);
+    vecx u(ndofs);
+    vecx dot_u(ndofs);
+    for (int i = 0; i < ndofs; i++) {
+        q(i) = randomFloat(-1.0, 1.0);
+        u(i) = randomFloat(-1.0, 1.0);
+        dot_u(i) = randomFloat(-1.0, 1.0);
+    }
+    vecx joint_forces(ndofs);
+    matxx d_joint_forces_d_q(ndofs, ndofs);
+    matxx d_joint_forces_d_u(ndofs, ndofs);
+    ASSERT_EQ(0, tree->calculateInverseDynamicsDerivatives(q, u, dot_u, &joint_forces,
+                                                           &d_joint_forces_d_q,
+                                                           &d_joint_forces_d_u));
+
+    vecx joint_forces_plus(ndofs);
+    vecx joint_forces_minus(ndofs);
+    idScalar max_error[2] = {0, 0};
+    idScalar max_value[2] = {0, 0};
+    for (int j = 0; j < ndofs; j++) {
+        for (int wrt_u = 0; wrt_u < 2; wrt_u++) {
+            vecx& x = wrt_u ? u : q;
+            const matxx& analytic = wrt_u ? d_joint_forces_d_u : d_joint_forces_d_q;
+            const idScalar x_j = x(j);
+            x(j) = x_j + kDelta;
+            ASSERT_EQ(0, tree->calculateInverseDynamics(q, u, dot_u, &joint_forces_plus));
+            x(j) = x_j - kDelta;
+            ASSERT_EQ(0, tree->calculateInverseDynamics(q, u, dot_u, &joint_forces_minus));
+            x(j) = x_j;
+            for (int i = 0; i < ndofs; i++) {
+                const idScalar fd = (joint_forces_plus(i) - joint_forces_minus(i)) / (2.0 * kDelta);
+                max_error[wrt_u] = BT_ID_MAX(max_error[wrt_u], std::fabs(fd - analytic(i, j)));
+                max_value[wrt_u] = BT_ID_MAX(max_value[wrt_u], std::fabs(fd));
+            }
+        }
+    }
+    *error_q = max_error[0] / (1.0 + max_value[0]);
+    *error_u = max_error[1] / (1.0 + max_value[1]);
+}
+
+void testDerivatives(MultiBodyTree* tree) {
+    ASSERT_TRUE(0x0 != tree);
+    idScalar error_q;
+    idScalar error_u;
+    calculateDerivativeErrors(tree, &error_q, &error_u);
+    EXPECT_LT(error_q, kMaxError);
+    EXPECT_LT(error_u, kMaxError);
+    delete tree;
+}
+
+TEST(InvDynDerivatives, finiteDifferences) {
+    randomInit(0);
+    CoilCreator coil_creator(kNumBodies);
+    DillCreator dill_creator(kLevel);
+    SimpleTreeCreator simple_creator(kNumBodies);
+
+    testDerivatives(CreateMultiBodyTree(coil_creator));
+    testDerivatives(CreateMultiBodyTree(dill_creator));
+    testDerivatives(CreateMultiBodyTree(simple_creator));
+    for (int i = 0; i < 5; i++) {
+        RandomTreeCreator random_creator(kNumBodies);
+        testDerivatives(CreateMultiBodyTree(random_creator));
+    }
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
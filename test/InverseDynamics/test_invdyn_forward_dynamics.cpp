@@ -0,0 +1,177 @@
+// Test of forward dynamics and Jacobians:
+// forward dynamics must invert inverse dynamics, and Jacobians must reproduce the
+// velocities and accelerations calculated by the inverse dynamics kinematics
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <gtest/gtest.h>
+
+#include "../Extras/InverseDynamics/CoilCreator.hpp"
+#include "../Extras/InverseDynamics/DillCreator.hpp"
+#include "../Extras/InverseDynamics/SimpleTreeCreator.hpp"
+#include "../Extras/InverseDynamics/IDRandomUtil.hpp"
+#include "../Extras/InverseDynamics/RandomTreeCreator.hpp"
+#include "BulletInverseDynamics/MultiBodyTree.hpp"
+
+using namespace btInverseDynamics;
+
+const int kLevel = 4;
+const int kNumBodies = BT_ID_POW(2, kLevel);
+
+#ifdef BT_ID_USE_DOUBLE_PRECISION
+const idScalar kMaxError = 1e-10;
+#else
+const idScalar kMaxError = 1e-3;
+#endif
+
+void randomState(const int ndofs, vecx* q, vecx* u, vecx* dot_u) {
+    for (int i = 0; i < ndofs; i++) {
+        (*q)(i) = randomFloat(-1.0, 1.0);
+        (*u)(i) = randomFloat(-1.0, 1.0);
+        (*dot_u)(i) = randomFloat(-1.0, 1.0);
+    }
+}
+
+idScalar maxRelativeError(const vec3& value, const vec3& reference) {
+    idScalar error = 0;
+    for (int k = 0; k < 3; k++) {
+        const idScalar error_k =
+            std::fabs(value(k) - reference(k)) / (1.0 + std::fabs(reference(k)));
+        error = BT_ID_MAX(error, error_k);
+    }
+    return error;
+}
+
+// apply forward dynamics to the joint forces from inverse dynamics
+idScalar calculateForwardDynamicsError(MultiBodyTree* tree) {
+    const int ndofs = tree->numDoFs();
+    vecx q(ndofs);
+    vecx u(ndofs);
+    vecx dot_u(ndofs);
+    randomState(ndofs, &q, &u, &dot_u);
+
+    vecx joint_forces(ndofs);
+    vecx dot_u_fd(ndofs);
+    EXPECT_EQ(0, tree->calculateInverseDynamics(q, u, dot_u, &joint_forces));
+    EXPECT_EQ(0, tree->calculateForwardDynamics(q, u, joint_forces, &dot_u_fd));
+
+    idScalar error = 0;
+    for (int i = 0; i < ndofs; i++) {
+        const idScalar error_i =
+            std::fabs(dot_u_fd(i) - dot_u(i)) / (1.0 + std::fabs(dot_u(i)));
+        error = BT_ID_MAX(error, error_i);
+    }
+    return error;
+}
+
+// compare J*u and J*dot_u + dot(J)*u with absolute velocities and accelerations
+idScalar calculateJacobianError(MultiBodyTree* tree) {
+    const int ndofs = tree->numDoFs();
+    vecx q(ndofs);
+    vecx u(ndofs);
+    vecx dot_u(ndofs);
+    randomState(ndofs, &q, &u, &dot_u);
+
+    vecx joint_forces(ndofs);
+    vec3 gravity;
+    setZero(gravity);
+    tree->setGravityInWorldFrame(gravity);
+    tree->clearAllUserForcesAndMoments();
+    EXPECT_EQ(0, tree->calculateJacobians(q, u));
+    EXPECT_EQ(0, tree->calculateInverseDynamics(q, u, dot_u, &joint_forces));
+
+    matxx jac_rot(3, ndofs);
+    matxx jac_trans(3, ndofs);
+    idScalar error = 0;
+    for (int body = 0; body < tree->numBodies(); body++) {
+        EXPECT_EQ(0, tree->getBodyJacobianRot(body, &jac_rot));
+        EXPECT_EQ(0, tree->getBodyJacobianTrans(body, &jac_trans));
+        vec3 dot_jac_rot_u;
+        vec3 dot_jac_trans_u;
+        EXPECT_EQ(0, tree->getBodyDotJacobianRotU(body, &dot_jac_rot_u));
+        EXPECT_EQ(0, tree->getBodyDotJacobianTransU(body, &dot_jac_trans_u));
+
+        vec3 omega;
+        vec3 vel;
+        vec3 dot_omega;
+        vec3 acc;
+        setZero(omega);
+        setZero(vel);
+        dot_omega = dot_jac_rot_u;
+        acc = dot_jac_trans_u;
+        for (int j = 0; j < ndofs; j++) {
+            for (int k = 0; k < 3; k++) {
+                omega(k) += jac_rot(k, j) * u(j);
+                vel(k) += jac_trans(k, j) * u(j);
+                dot_omega(k) += jac_rot(k, j) * dot_u(j);
+                acc(k) += jac_trans(k, j) * dot_u(j);
+            }
+        }
+
+        vec3 omega_ref;
+        vec3 vel_ref;
+        vec3 dot_omega_ref;
+        vec3 acc_ref;
+        EXPECT_EQ(0, tree->getBodyAngularVelocity(body, &omega_ref));
+        EXPECT_EQ(0, tree->getBodyLinearVelocity(body, &vel_ref));
+        EXPECT_EQ(0, tree->getBodyAngularAcceleration(body, &dot_omega_ref));
+        EXPECT_EQ(0, tree->getBodyLinearAcceleration(body, &acc_ref));
+        error = BT_ID_MAX(error, maxRelativeError(omega, omega_ref));
+        error = BT_ID_MAX(error, maxRelativeError(vel, vel_ref));
+        error = BT_ID_MAX(error, maxRelativeError(dot_omega, dot_omega_ref));
+        error = BT_ID_MAX(error, maxRelativeError(acc, acc_ref));
+    }
+    return error;
+}
+
+void testForwardDynamicsAndJacobians(MultiBodyTree* tree) {
+    ASSERT_TRUE(0x0 != tree);
+    EXPECT_LT(calculateForwardDynamicsError(tree), kMaxError);
+    EXPECT_LT(calculateJacobianError(tree), kMaxError);
+    delete tree;
+}
+
+TEST(InvDynForwardDynamics, inverseDynamicsConsistency) {
+    // fixed seed: a few random trees with tiny masses are badly conditioned in single precision
+    randomInit(0);
+    CoilCreator coil_creator(kNumBodies);
+    DillCreator dill_creator(kLevel);
+    SimpleTreeCreator simple_creator(kNumBodies);
+
+    testForwardDynamicsAndJacobians(CreateMultiBodyTree(coil_creator));
+    testForwardDynamicsAndJacobians(CreateMultiBodyTree(dill_creator));
+    testForwardDynamicsAndJacobians(CreateMultiBodyTree(simple_creator));
+    for (int i = 0; i < 5; i++) {
+        RandomTreeCreator random_creator(kNumBodies);
+        MultiBodyTree* random_tree = CreateMultiBodyTree(random_creator);
+        ASSERT_TRUE(0x0 != random_tree);
+        ASSERT_EQ(0, addRandomUserForce(kNumBodies - 1, random_tree));
+        testForwardDynamicsAndJacobians(random_tree);
+    }
+}
+
+TEST(InvDynForwardDynamics, dimensionErrors) {
+    CoilCreator coil_creator(kNumBodies);
+    MultiBodyTree* tree = CreateMultiBodyTree(coil_creator);
+    ASSERT_TRUE(0x0 != tree);
+    const int ndofs = tree->numDoFs();
+    vecx q(ndofs);
+    vecx dot_u(ndofs + 1);
+    matxx jac(3, ndofs + 1);
+    setZero(q);
+    EXPECT_EQ(-1, tree->calculateForwardDynamics(q, q, q, &dot_u));
+    // Jacobians not calculated yet
+    matxx jac_ok(3, ndofs);
+    EXPECT_EQ(-1, tree->getBodyJacobianRot(0, &jac_ok));
+    EXPECT_EQ(0, tree->calculateJacobians(q));
+    EXPECT_EQ(0, tree->getBodyJacobianRot(0, &jac_ok));
+    EXPECT_EQ(-1, tree->getBodyJacobianTrans(0, &jac));
+    delete tree;
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
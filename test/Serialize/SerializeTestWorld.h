@@ -0,0 +1,237 @@
+#ifndef SERIALIZE_TEST_WORLD_H
+#define SERIALIZE_TEST_WORLD_H
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "btBulletDynamicsCommon.h"
+#include "LinearMath/btSerializer.h"
+#include "BulletWorldImporter/btBulletWorldImporter.h"
+
+// SerializeTestWorld holds the objects whose chunks nest in a .bullet file: a static grid trimesh with a quantized
+// bvh, a compound, a convex hull, a hinge between two boxes and named bodies.
+class SerializeTestWorld {
+public:
+    explicit SerializeTestWorld(int gridSize = 20) {
+        m_collisionConfiguration = new btDefaultCollisionConfiguration();
+        m_dispatcher = new btCollisionDispatcher(m_collisionConfiguration);
+        m_broadphase = new btDbvtBroadphase();
+        m_solver = new btSequentialImpulseConstraintSolver();
+        m_world = new btDiscreteDynamicsWorld(m_dispatcher, m_broadphase, m_solver, m_collisionConfiguration);
+        m_world->setGravity(btVector3(0, -10, 0));
+
+        // a bumpy grid, so the bvh has many nodes
+        for (int z = 0; z <= gridSize; z++) {
+            for (int x = 0; x <= gridSize; x++) {
+                m_vertices.push_back(btScalar(x) - btScalar(gridSize) / 2);
+                m_vertices.push_back(btScalar(0.2) * btSin(btScalar(x * z) * btScalar(0.3)));
+                m_vertices.push_back(btScalar(z) - btScalar(gridSize) / 2);
+            }
+        }
+        for (int z = 0; z < gridSize; z++) {
+            for (int x = 0; x < gridSize; x++) {
+                const int i = z * (gridSize + 1) + x;
+                const int quad[6] = {i, i + gridSize + 1, i + 1, i + 1, i + gridSize + 1, i + gridSize + 2};
+                m_indices.insert(m_indices.end(), quad, quad + 6);
+            }
+        }
+        m_mesh = new btTriangleIndexVertexArray(int(m_indices.size()) / 3, &m_indices[0], 3 * sizeof(int),
+                                                int(m_vertices.size()) / 3, &m_vertices[0], 3 * sizeof(btScalar));
+        btBvhTriangleMeshShape* groundShape = new btBvhTriangleMeshShape(m_mesh, true);
+        m_shapes.push_back(groundShape);
+        addRigidBody(groundShape, 0, btVector3(0, 0, 0), "ground");
+
+        btCollisionShape* box = addShape(new btBoxShape(btVector3(btScalar(0.5), btScalar(0.3), btScalar(0.4))));
+        btCollisionShape* sphere = addShape(new btSphereShape(btScalar(0.4)));
+        btCompoundShape* compound = new btCompoundShape();
+        compound->addChildShape(btTransform(btQuaternion::getIdentity(), btVector3(btScalar(-0.6), 0, 0)), box);
+        compound->addChildShape(btTransform(btQuaternion(btVector3(0, 1, 0), btScalar(0.5)), btVector3(btScalar(0.6), 0, 0)),
+                                sphere);
+        addShape(compound);
+        btConvexHullShape* hull = new btConvexHullShape();
+        for (int i = 0; i < 12; i++) {
+            hull->addPoint(btVector3(btCos(btScalar(i)), btScalar(i % 3) * btScalar(0.3), btSin(btScalar(i) * btScalar(1.3))));
+        }
+        addShape(hull);
+
+        addRigidBody(sphere, 1, btVector3(-2, 2, 0), "sphere");
+        addRigidBody(compound, 2, btVector3(0, 3, 0), "compound");
+        addRigidBody(hull, 1, btVector3(2, 2, 1), 0);
+        btRigidBody* left = addRigidBody(box, 1, btVector3(-1, 4, 2), "left");
+        btRigidBody* right = addRigidBody(box, 1, btVector3(btScalar(0.2), 4, 2), 0);
+        btHingeConstraint* hinge = new btHingeConstraint(*left, *right, btVector3(btScalar(0.6), 0, 0),
+                                                         btVector3(btScalar(-0.6), 0, 0), btVector3(0, 0, 1),
+                                                         btVector3(0, 0, 1));
+        hinge->setLimit(btScalar(-0.5), btScalar(0.5));
+        m_world->addConstraint(hinge, true);
+        m_constraints.push_back(hinge);
+    }
+
+    virtual ~SerializeTestWorld() {
+        for (size_t i = 0; i < m_constraints.size(); i++) {
+            m_world->removeConstraint(m_constraints[i]);
+            delete m_constraints[i];
+        }
+        for (int i = m_world->getNumCollisionObjects() - 1; i >= 0; i--) {
+            btCollisionObject* obj = m_world->getCollisionObjectArray()[i];
+            m_world->removeCollisionObject(obj);
+            delete obj;
+        }
+        for (size_t i = 0; i < m_shapes.size(); i++) {
+            delete m_shapes[i];
+        }
+        delete m_mesh;
+        delete m_world;
+        delete m_solver;
+        delete m_broadphase;
+        delete m_dispatcher;
+        delete m_collisionConfiguration;
+    }
+
+    btCollisionShape* addShape(btCollisionShape* shape) {
+        m_shapes.push_back(shape);
+        return shape;
+    }
+
+    btRigidBody* addRigidBody(btCollisionShape* shape, btScalar mass, const btVector3& origin, const char* name) {
+        btVector3 localInertia(0, 0, 0);
+        if (mass != 0) {
+            shape->calculateLocalInertia(mass, localInertia);
+        }
+        btRigidBody* body = new btRigidBody(btRigidBody::btRigidBodyConstructionInfo(mass, 0, shape, localInertia));
+        body->setWorldTransform(btTransform(btQuaternion(btVector3(1, 0, 1).normalized(), btScalar(0.1) * origin.x()), origin));
+        m_world->addRigidBody(body);
+        if (name) {
+            m_names.push_back(std::make_pair(body, name));
+        }
+        return body;
+    }
+
+    // the names have to be registered with every serializer before the world is serialized
+    void registerNames(btSerializer* serializer) const {
+        for (size_t i = 0; i < m_names.size(); i++) {
+            serializer->registerNameForPointer(m_names[i].first, m_names[i].second);
+        }
+    }
+
+    btDefaultCollisionConfiguration* m_collisionConfiguration;
+    btCollisionDispatcher* m_dispatcher;
+    btBroadphaseInterface* m_broadphase;
+    btSequentialImpulseConstraintSolver* m_solver;
+    btDiscreteDynamicsWorld* m_world;
+    std::vector<btScalar> m_vertices;
+    std::vector<int> m_indices;
+    btTriangleIndexVertexArray* m_mesh;
+    std::vector<btCollisionShape*> m_shapes;
+    std::vector<btTypedConstraint*> m_constraints;
+    std::vector<std::pair<btCollisionObject*, const char*> > m_names;
+};
+
+// ImportedWorld is an empty world that a btBulletWorldImporter fills from a .bullet file
+class ImportedWorld {
+public:
+    ImportedWorld() {
+        m_collisionConfiguration = new btDefaultCollisionConfiguration();
+        m_dispatcher = new btCollisionDispatcher(m_collisionConfiguration);
+        m_broadphase = new btDbvtBroadphase();
+        m_solver = new btSequentialImpulseConstraintSolver();
+        m_world = new btDiscreteDynamicsWorld(m_dispatcher, m_broadphase, m_solver, m_collisionConfiguration);
+        m_importer = new btBulletWorldImporter(m_world);
+    }
+
+    virtual ~ImportedWorld() {
+        m_importer->deleteAllData();
+        delete m_importer;
+        delete m_world;
+        delete m_solver;
+        delete m_broadphase;
+        delete m_dispatcher;
+        delete m_collisionConfiguration;
+    }
+
+    btDefaultCollisionConfiguration* m_collisionConfiguration;
+    btCollisionDispatcher* m_dispatcher;
+    btBroadphaseInterface* m_broadphase;
+    btSequentialImpulseConstraintSolver* m_solver;
+    btDiscreteDynamicsWorld* m_world;
+    btBulletWorldImporter* m_importer;
+};
+
+inline void expectSameVector(const btVector3& expected, const btVector3& actual) {
+    EXPECT_EQ(expected.x(), actual.x());
+    EXPECT_EQ(expected.y(), actual.y());
+    EXPECT_EQ(expected.z(), actual.z());
+}
+
+inline void expectSameTransform(const btTransform& expected, const btTransform& actual) {
+    expectSameVector(expected.getOrigin(), actual.getOrigin());
+    for (int r = 0; r < 3; r++) {
+        expectSameVector(expected.getBasis()[r], actual.getBasis()[r]);
+    }
+}
+
+inline void expectSameShape(const btCollisionShape* expected, const btCollisionShape* actual) {
+    ASSERT_EQ(expected->getShapeType(), actual->getShapeType());
+    btVector3 expectedMin, expectedMax, actualMin, actualMax;
+    expected->getAabb(btTransform::getIdentity(), expectedMin, expectedMax);
+    actual->getAabb(btTransform::getIdentity(), actualMin, actualMax);
+    expectSameVector(expectedMin, actualMin);
+    expectSameVector(expectedMax, actualMax);
+    EXPECT_EQ(expected->getMargin(), actual->getMargin());
+    if (expected->isCompound()) {
+        const btCompoundShape* expectedCompound = (const btCompoundShape*)expected;
+        const btCompoundShape* actualCompound = (const btCompoundShape*)actual;
+        ASSERT_EQ(expectedCompound->getNumChildShapes(), actualCompound->getNumChildShapes());
+        for (int i = 0; i < expectedCompound->getNumChildShapes(); i++) {
+            expectSameTransform(expectedCompound->getChildTransform(i), actualCompound->getChildTransform(i));
+            expectSameShape(expectedCompound->getChildShape(i), actualCompound->getChildShape(i));
+        }
+    }
+    if (expected->getShapeType() == CONVEX_HULL_SHAPE_PROXYTYPE) {
+        const btConvexHullShape* expectedHull = (const btConvexHullShape*)expected;
+        const btConvexHullShape* actualHull = (const btConvexHullShape*)actual;
+        ASSERT_EQ(expectedHull->getNumPoints(), actualHull->getNumPoints());
+        for (int i = 0; i < expectedHull->getNumPoints(); i++) {
+            expectSameVector(expectedHull->getUnscaledPoints()[i], actualHull->getUnscaledPoints()[i]);
+        }
+    }
+}
+
+// the bodies, shapes and constraints of two worlds are the same, in the same order
+inline void expectSameObjects(const btDiscreteDynamicsWorld* expected, const btDiscreteDynamicsWorld* actual) {
+    ASSERT_EQ(expected->getNumCollisionObjects(), actual->getNumCollisionObjects());
+    ASSERT_EQ(expected->getNumConstraints(), actual->getNumConstraints());
+    for (int i = 0; i < expected->getNumCollisionObjects(); i++) {
+        SCOPED_TRACE(i);
+        const btRigidBody* expectedBody = btRigidBody::upcast(expected->getCollisionObjectArray()[i]);
+        const btRigidBody* actualBody = btRigidBody::upcast(actual->getCollisionObjectArray()[i]);
+        ASSERT_TRUE(expectedBody && actualBody);
+        expectSameTransform(expectedBody->getWorldTransform(), actualBody->getWorldTransform());
+        expectSameVector(expectedBody->getLinearVelocity(), actualBody->getLinearVelocity());
+        expectSameVector(expectedBody->getAngularVelocity(), actualBody->getAngularVelocity());
+        expectSameVector(expectedBody->getInvInertiaDiagLocal(), actualBody->getInvInertiaDiagLocal());
+        EXPECT_EQ(expectedBody->getInvMass(), actualBody->getInvMass());
+        EXPECT_EQ(expectedBody->getFriction(), actualBody->getFriction());
+        EXPECT_EQ(expectedBody->getRestitution(), actualBody->getRestitution());
+        EXPECT_EQ(expectedBody->getCollisionFlags(), actualBody->getCollisionFlags());
+        expectSameShape(expectedBody->getCollisionShape(), actualBody->getCollisionShape());
+    }
+    for (int i = 0; i < expected->getNumConstraints(); i++) {
+        SCOPED_TRACE(i);
+        const btTypedConstraint* expectedConstraint = expected->getConstraint(i);
+        const btTypedConstraint* actualConstraint = actual->getConstraint(i);
+        ASSERT_EQ(expectedConstraint->getConstraintType(), actualConstraint->getConstraintType());
+        EXPECT_EQ(expectedConstraint->getBreakingImpulseThreshold(), actualConstraint->getBreakingImpulseThreshold());
+        if (expectedConstraint->getConstraintType() == HINGE_CONSTRAINT_TYPE) {
+            const btHingeConstraint* expectedHinge = (const btHingeConstraint*)expectedConstraint;
+            const btHingeConstraint* actualHinge = (const btHingeConstraint*)actualConstraint;
+            expectSameTransform(expectedHinge->getAFrame(), actualHinge->getAFrame());
+            expectSameTransform(expectedHinge->getBFrame(), actualHinge->getBFrame());
+            EXPECT_EQ(expectedHinge->getLowerLimit(), actualHinge->getLowerLimit());
+            EXPECT_EQ(expectedHinge->getUpperLimit(), actualHinge->getUpperLimit());
+        }
+    }
+}
+
+#endif  // SERIALIZE_TEST_WORLD_H
@@ -0,0 +1,40 @@
+
+	-- gtest-only tests of the serializers and the .bullet file loader
+	local serializeTests = {
+		{ "Test_Serializer", "test_serializer.cpp" },
+		{ "Test_BulletFile", "test_bullet_file.cpp" },
+	}
+
+	for _, test in ipairs(serializeTests) do
+
+	project (test[1])
+
+	kind "ConsoleApp"
+
+	includedirs
+	{
+		".",
+		"../../src",
+		"../../Extras/Serialize",
+		"../gtest-1.7.0/include"
+
+	}
+
+
+	if os.is("Windows") then
+		--see http://stackoverflow.com/questions/12558327/google-test-in-visual-studio-2012
+		defines {"_VARIADIC_MAX=10"}
+	end
+
+	links {"BulletWorldImporter", "BulletFileLoader", "BulletDynamics", "BulletCollision", "LinearMath", "gtest"}
+
+	files {
+		test[2],
+		"SerializeTestWorld.h",
+	}
+
+	if os.is("Linux") then
+                links {"pthread"}
+        end
+
+	end
@@ -0,0 +1,212 @@
+// bFile conversion plans: a world loaded from a .bullet file, written again and loaded again has to come back with
+// the same objects. The sample files in data/ have 32 bit pointers and older DNA, so their structs go through the
+// compiled conversion plans, and their byte swapped copies through the plans with endian swaps.
+// loadFileMapped has to load the same world as the copying loader, referencing only aligned data in place.
+// The sample files are loaded from the data folder, the working directory of the test.
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "SerializeTestWorld.h"
+
+static void serialize(btDiscreteDynamicsWorld* world, std::vector<char>& data) {
+    btDefaultSerializer serializer;
+    world->serialize(&serializer);
+    data.assign((const char*)serializer.getBufferPointer(),
+                (const char*)serializer.getBufferPointer() + serializer.getCurrentBufferSize());
+}
+
+// the file header: 'BULLET', precision, pointer size, endianness and version
+static std::string readHeader(const char* fileName) {
+    char header[BT_HEADER_LENGTH + 1] = {0};
+    FILE* file = fopen(fileName, "rb");
+    if (file) {
+        if (fread(header, 1, BT_HEADER_LENGTH, file) != BT_HEADER_LENGTH) {
+            header[0] = 0;
+        }
+        fclose(file);
+    }
+    return header;
+}
+
+TEST(BulletFile, NativeFileRoundTrip) {
+    SerializeTestWorld world;
+    std::vector<char> data;
+    serialize(world.m_world, data);
+    // the loader resolves the pointers in the buffer
+    std::vector<char> buffer(data);
+    ImportedWorld imported;
+    ASSERT_TRUE(imported.m_importer->loadFileFromMemory(&buffer[0], int(buffer.size())));
+    expectSameObjects(world.m_world, imported.m_world);
+    EXPECT_EQ(1, imported.m_importer->getNumBvhs());
+
+    // a file of the loaded world loads the same world again
+    std::vector<char> reloadedData;
+    serialize(imported.m_world, reloadedData);
+    buffer = reloadedData;
+    ImportedWorld reloaded;
+    ASSERT_TRUE(reloaded.m_importer->loadFileFromMemory(&buffer[0], int(buffer.size())));
+    expectSameObjects(world.m_world, reloaded.m_world);
+}
+
+class ConvertedFileTest : public ::testing::TestWithParam<const char*> {};
+
+TEST_P(ConvertedFileTest, RoundTrip) {
+    const char* fileName = GetParam();
+    // 32 bit pointers, little endian, converted to the memory DNA
+    ASSERT_EQ('_', readHeader(fileName)[7]);
+    const std::string swappedFileName = std::string(fileName) + ".swapped";
+    ImportedWorld converted;
+    ASSERT_TRUE(converted.m_importer->loadFile(fileName, swappedFileName.c_str()));
+    ASSERT_GT(converted.m_world->getNumCollisionObjects(), 5);
+
+    // a native file of the converted world loads the same objects
+    std::vector<char> data;
+    serialize(converted.m_world, data);
+    ImportedWorld native;
+    ASSERT_TRUE(native.m_importer->loadFileFromMemory(&data[0], int(data.size())));
+    expectSameObjects(converted.m_world, native.m_world);
+
+    // and so does the big endian copy that the importer wrote
+    EXPECT_EQ('V', readHeader(swappedFileName.c_str())[8]);
+    ImportedWorld swapped;
+    const bool loaded = swapped.m_importer->loadFile(swappedFileName.c_str());
+    remove(swappedFileName.c_str());
+    ASSERT_TRUE(loaded);
+    expectSameObjects(converted.m_world, swapped.m_world);
+}
+
+INSTANTIATE_TEST_CASE_P(SampleFiles, ConvertedFileTest,
+                        ::testing::Values("spider.bullet", "testFileFracture.bullet"));
+
+// tells whether the imported objects reference the mapped file
+class MappedImporter : public btBulletWorldImporter {
+public:
+    explicit MappedImporter(btDynamicsWorld* world) : btBulletWorldImporter(world) {}
+
+    bool isMapped(const void* ptr) const { return isPersistentData(ptr); }
+};
+
+class MappedWorld : public ImportedWorld {
+public:
+    MappedWorld() {
+        delete m_importer;
+        m_importer = m_mappedImporter = new MappedImporter(m_world);
+    }
+
+    MappedImporter* m_mappedImporter;
+};
+
+static bool writeFile(const char* fileName, btDiscreteDynamicsWorld* world, int serializationFlags) {
+    btDefaultSerializer serializer;
+    serializer.setSerializationFlags(serializationFlags);
+    world->serialize(&serializer);
+    FILE* file = fopen(fileName, "wb");
+    if (!file) {
+        return false;
+    }
+    const size_t size = size_t(serializer.getCurrentBufferSize());
+    const bool written = fwrite(serializer.getBufferPointer(), 1, size, file) == size;
+    fclose(file);
+    return written;
+}
+
+static btBvhTriangleMeshShape* findTriangleMesh(btDiscreteDynamicsWorld* world) {
+    for (int i = 0; i < world->getNumCollisionObjects(); i++) {
+        btCollisionShape* shape = world->getCollisionObjectArray()[i]->getCollisionShape();
+        if (shape->getShapeType() == TRIANGLE_MESH_SHAPE_PROXYTYPE) {
+            return (btBvhTriangleMeshShape*)shape;
+        }
+    }
+    return 0;
+}
+
+// a mapped file loads the same world as a copied one, and it simulates the same way
+static void expectSameAsCopied(const char* fileName, MappedWorld& mapped) {
+    ImportedWorld copied;
+    ASSERT_TRUE(copied.m_importer->loadFile(fileName));
+    ASSERT_TRUE(mapped.m_importer->loadFileMapped(fileName));
+    expectSameObjects(copied.m_world, mapped.m_world);
+    ASSERT_EQ(copied.m_importer->getNumBvhs(), mapped.m_importer->getNumBvhs());
+
+    btBvhTriangleMeshShape* copiedMesh = findTriangleMesh(copied.m_world);
+    btBvhTriangleMeshShape* mappedMesh = findTriangleMesh(mapped.m_world);
+    ASSERT_EQ(copiedMesh == 0, mappedMesh == 0);
+    if (mappedMesh) {
+        QuantizedNodeArray& copiedNodes = copiedMesh->getOptimizedBvh()->getQuantizedNodeArray();
+        QuantizedNodeArray& mappedNodes = mappedMesh->getOptimizedBvh()->getQuantizedNodeArray();
+        ASSERT_EQ(copiedNodes.size(), mappedNodes.size());
+        ASSERT_GT(mappedNodes.size(), 0);
+        EXPECT_EQ(0, memcmp(&copiedNodes[0], &mappedNodes[0], mappedNodes.size() * sizeof(btQuantizedBvhNode)));
+    }
+
+    for (int i = 0; i < 60; i++) {
+        copied.m_world->stepSimulation(btScalar(1.) / btScalar(60.), 0);
+        mapped.m_world->stepSimulation(btScalar(1.) / btScalar(60.), 0);
+    }
+    expectSameObjects(copied.m_world, mapped.m_world);
+}
+
+// the mapped data that the trimesh references in place has the alignment of the memory structs
+static void expectAlignedInPlace(MappedWorld& mapped) {
+    btBvhTriangleMeshShape* mesh = findTriangleMesh(mapped.m_world);
+    ASSERT_TRUE(mesh != 0);
+    const btIndexedMesh& part = ((btTriangleIndexVertexArray*)mesh->getMeshInterface())->getIndexedMeshArray()[0];
+    const btQuantizedBvhNode* nodes = &mesh->getOptimizedBvh()->getQuantizedNodeArray()[0];
+    if (mapped.m_mappedImporter->isMapped(part.m_vertexBase)) {
+        EXPECT_EQ(0u, (size_t)part.m_vertexBase & 15);
+    }
+    if (mapped.m_mappedImporter->isMapped(part.m_triangleIndexBase)) {
+        EXPECT_EQ(0u, (size_t)part.m_triangleIndexBase & 15);
+    }
+    if (mapped.m_mappedImporter->isMapped(nodes)) {
+        EXPECT_EQ(0u, (size_t)nodes & 15);
+    }
+}
+
+TEST(BulletFile, MappedAlignedFileReferencesTheMapping) {
+    SerializeTestWorld world;
+    const char* fileName = "mappedAlignedWorld.bullet";
+    ASSERT_TRUE(writeFile(fileName, world.m_world, BT_SERIALIZE_ALIGN_CHUNKS));
+    MappedWorld mapped;
+    expectSameAsCopied(fileName, mapped);
+    remove(fileName);
+
+    // the triangles and the bvh nodes are not copied
+    btBvhTriangleMeshShape* mesh = findTriangleMesh(mapped.m_world);
+    ASSERT_TRUE(mesh != 0);
+    const btIndexedMesh& part = ((btTriangleIndexVertexArray*)mesh->getMeshInterface())->getIndexedMeshArray()[0];
+    EXPECT_TRUE(mapped.m_mappedImporter->isMapped(part.m_vertexBase));
+    EXPECT_TRUE(mapped.m_mappedImporter->isMapped(part.m_triangleIndexBase));
+    EXPECT_TRUE(mapped.m_mappedImporter->isMapped(&mesh->getOptimizedBvh()->getQuantizedNodeArray()[0]));
+    expectAlignedInPlace(mapped);
+}
+
+TEST(BulletFile, MappedUnalignedFileFallsBackToCopying) {
+    SerializeTestWorld world;
+    const char* fileName = "mappedUnalignedWorld.bullet";
+    ASSERT_TRUE(writeFile(fileName, world.m_world, 0));
+    MappedWorld mapped;
+    expectSameAsCopied(fileName, mapped);
+    remove(fileName);
+    expectAlignedInPlace(mapped);
+}
+
+TEST(BulletFile, MappedConvertedFileIsCopied) {
+    // 32 bit pointers, nothing matches the memory layout
+    MappedWorld mapped;
+    expectSameAsCopied("testFileFracture.bullet", mapped);
+    btBvhTriangleMeshShape* mesh = findTriangleMesh(mapped.m_world);
+    if (mesh) {
+        const btIndexedMesh& part = ((btTriangleIndexVertexArray*)mesh->getMeshInterface())->getIndexedMeshArray()[0];
+        EXPECT_FALSE(mapped.m_mappedImporter->isMapped(part.m_vertexBase));
+    }
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
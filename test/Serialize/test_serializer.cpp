@@ -0,0 +1,139 @@
+// btStreamingSerializer: the stream written to the sink has to be byte identical to the buffer of btDefaultSerializer,
+// with the chunks in the scratch buffer or allocated one by one, when one serializer is reused, and with aligned chunks.
+
+#include <string.h>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "SerializeTestWorld.h"
+
+// collects the stream in memory
+class MemorySink : public btSerializerSink {
+public:
+    MemorySink() : m_numFlushes(0) {}
+
+    virtual bool write(const void* data, int numBytes) {
+        m_data.insert(m_data.end(), (const unsigned char*)data, (const unsigned char*)data + numBytes);
+        return true;
+    }
+
+    virtual void flush() { m_numFlushes++; }
+
+    std::vector<unsigned char> m_data;
+    int m_numFlushes;
+};
+
+// stops accepting data after a number of bytes
+class FullSink : public btSerializerSink {
+public:
+    explicit FullSink(int capacity) : m_capacity(capacity) {}
+
+    virtual bool write(const void* data, int numBytes) {
+        (void)data;
+        if (numBytes > m_capacity) {
+            return false;
+        }
+        m_capacity -= numBytes;
+        return true;
+    }
+
+    int m_capacity;
+};
+
+static void serializeDefault(const SerializeTestWorld& world, std::vector<unsigned char>& data,
+                             int serializationFlags = 0) {
+    btDefaultSerializer serializer;
+    serializer.setSerializationFlags(serializationFlags);
+    world.registerNames(&serializer);
+    world.m_world->serialize(&serializer);
+    data.assign(serializer.getBufferPointer(), serializer.getBufferPointer() + serializer.getCurrentBufferSize());
+}
+
+// the number of chunks of a serialized file, the DNA included
+static int countChunks(const std::vector<unsigned char>& data) {
+    int numChunks = 0;
+    for (size_t offset = BT_HEADER_LENGTH; offset < data.size(); numChunks++) {
+        const btChunk* chunk = (const btChunk*)&data[offset];
+        offset += sizeof(btChunk) + chunk->m_length;
+    }
+    return numChunks;
+}
+
+static void expectSameBytes(const std::vector<unsigned char>& expected, const std::vector<unsigned char>& actual) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        ASSERT_EQ(expected[i], actual[i]) << "byte " << i;
+    }
+}
+
+// the scratch buffer holds all chunks, only a few of them, or none
+class StreamingSerializerTest : public ::testing::TestWithParam<int> {};
+
+TEST_P(StreamingSerializerTest, MatchesDefaultSerializer) {
+    SerializeTestWorld world;
+    std::vector<unsigned char> expected;
+    serializeDefault(world, expected);
+
+    MemorySink sink;
+    btStreamingSerializer serializer(&sink, GetParam());
+    world.registerNames(&serializer);
+    world.m_world->serialize(&serializer);
+    EXPECT_FALSE(serializer.hasSinkError());
+    EXPECT_EQ(1, sink.m_numFlushes);
+    EXPECT_EQ(int(sink.m_data.size()), serializer.getCurrentBufferSize());
+    expectSameBytes(expected, sink.m_data);
+
+    // reused for a checkpoint of the next step, with the names registered again
+    world.m_world->stepSimulation(btScalar(1.) / btScalar(60.), 0);
+    serializeDefault(world, expected);
+    sink.m_data.clear();
+    world.registerNames(&serializer);
+    world.m_world->serialize(&serializer);
+    expectSameBytes(expected, sink.m_data);
+}
+
+INSTANTIATE_TEST_CASE_P(ScratchSizes, StreamingSerializerTest, ::testing::Values(1024 * 1024, 512, 0));
+
+TEST_P(StreamingSerializerTest, MatchesDefaultSerializerWithAlignedChunks) {
+    SerializeTestWorld world;
+    std::vector<unsigned char> expected;
+    serializeDefault(world, expected, BT_SERIALIZE_ALIGN_CHUNKS);
+
+    MemorySink sink;
+    btStreamingSerializer serializer(&sink, GetParam());
+    serializer.setSerializationFlags(BT_SERIALIZE_ALIGN_CHUNKS);
+    world.registerNames(&serializer);
+    world.m_world->serialize(&serializer);
+    expectSameBytes(expected, sink.m_data);
+
+    // the data of every chunk but the first starts 16 byte aligned in the file
+    size_t offset = BT_HEADER_LENGTH + sizeof(btChunk) + ((const btChunk*)&expected[BT_HEADER_LENGTH])->m_length;
+    while (offset < expected.size()) {
+        const btChunk* chunk = (const btChunk*)&expected[offset];
+        EXPECT_EQ(0u, (offset + sizeof(btChunk)) & 15) << "chunk at " << offset;
+        offset += sizeof(btChunk) + chunk->m_length;
+    }
+}
+
+TEST(StreamingSerializer, CountsChunksAndReportsSinkErrors) {
+    SerializeTestWorld world;
+    MemorySink sink;
+    btStreamingSerializer serializer(&sink);
+    world.m_world->serialize(&serializer);
+    EXPECT_EQ(countChunks(sink.m_data), serializer.getNumChunks());
+    EXPECT_GT(serializer.getNumChunks(), 20);
+    EXPECT_EQ(0, serializer.getBufferPointer());
+
+    // a full sink loses the rest of the stream, the serializer keeps going and reports it
+    FullSink fullSink(int(sink.m_data.size()) / 2);
+    btStreamingSerializer failing(&fullSink, 512);
+    world.m_world->serialize(&failing);
+    EXPECT_TRUE(failing.hasSinkError());
+    EXPECT_LT(failing.getCurrentBufferSize(), int(sink.m_data.size()) / 2 + 1);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -76,7 +76,9 @@ project ("Test_PhysicsServerLoopBack")
 			"../../examples/Importers/ImportColladaDemo/LoadMeshFromCollada.cpp",
 			"../../examples/Importers/ImportObjDemo/LoadMeshFromObj.cpp",
 			"../../examples/Importers/ImportObjDemo/Wavefront2GLInstanceGraphicsShape.cpp",
+			"../../examples/Importers/ImportMeshUtility/LoadTriangleMesh.cpp",
 			"../../examples/Importers/ImportURDFDemo/BulletUrdfImporter.cpp",
+			"../../examples/Importers/ImportURDFDemo/BulletUrdfImportCache.cpp",
 			"../../examples/Importers/ImportURDFDemo/MyMultiBodyCreator.cpp",
 			"../../examples/Importers/ImportURDFDemo/URDF2Bullet.cpp",
 			"../../examples/Importers/ImportURDFDemo/UrdfParser.cpp",
@@ -112,6 +114,10 @@ project ("Test_PhysicsServerLoopBack")
 			"../../examples/SharedMemory/PhysicsDirect.h",
 			"../../examples/SharedMemory/PhysicsDirectC_API.cpp",
 			"../../examples/SharedMemory/PhysicsDirectC_API.h",
+			"../../examples/SharedMemory/PhysicsMultiEnvironment.cpp",
+			"../../examples/SharedMemory/PhysicsMultiEnvironment.h",
+			"../../examples/SharedMemory/PhysicsMultiEnvironmentC_API.cpp",
+			"../../examples/SharedMemory/PhysicsMultiEnvironmentC_API.h",
 			"../../examples/SharedMemory/PhysicsServerCommandProcessor.cpp",
 			"../../examples/SharedMemory/PhysicsServerCommandProcessor.h",
 			"../../examples/SharedMemory/PhysicsClientSharedMemory.cpp",
@@ -133,12 +139,188 @@ project ("Test_PhysicsServerLoopBack")
 			"../../examples/Importers/ImportColladaDemo/LoadMeshFromCollada.cpp",
 			"../../examples/Importers/ImportObjDemo/LoadMeshFromObj.cpp",
 			"../../examples/Importers/ImportObjDemo/Wavefront2GLInstanceGraphicsShape.cpp",
+			"../../examples/Importers/ImportMeshUtility/LoadTriangleMesh.cpp",
 			"../../examples/Importers/ImportURDFDemo/BulletUrdfImporter.cpp",
+			"../../examples/Importers/ImportURDFDemo/BulletUrdfImportCache.cpp",
+			"../../examples/Importers/ImportURDFDemo/MyMultiBodyCreator.cpp",
+			"../../examples/Importers/ImportURDFDemo/URDF2Bullet.cpp",
+			"../../examples/Importers/ImportURDFDemo/UrdfParser.cpp",
+			"../../examples/Importers/ImportURDFDemo/urdfStringSplit.cpp",
+		}
+
+if not _OPTIONS["no-gtest"] then
+
+	project ("Test_PhysicsMultiEnvironment")
+
+		language "C++"
+		kind "ConsoleApp"
+
+		includedirs {"../../src", "../../examples",
+		"../../examples/ThirdPartyLibs",
+		"../gtest-1.7.0/include"}
+		if os.is("Windows") then
+			defines {"_VARIADIC_MAX=10"}
+		end
+		links {
+			"BulletFileLoader",
+			"BulletWorldImporter",
+			"Bullet3Common",
+			"BulletDynamics", 
+			"BulletCollision", 
+			"LinearMath",
+			"gtest"
+		}
+		if os.is("Linux") then
+			links {"pthread"}
+		end
+
+		files {
+			"test_multi_environment.cpp",
+			"../Utils/TestTaskScheduler.h",
+			"../../examples/SharedMemory/PhysicsClient.cpp",
+			"../../examples/SharedMemory/PhysicsClient.h",
+			"../../examples/SharedMemory/PhysicsDirect.cpp",
+			"../../examples/SharedMemory/PhysicsDirect.h",
+			"../../examples/SharedMemory/PhysicsMultiEnvironment.cpp",
+			"../../examples/SharedMemory/PhysicsMultiEnvironment.h",
+			"../../examples/SharedMemory/PhysicsMultiEnvironmentC_API.cpp",
+			"../../examples/SharedMemory/PhysicsMultiEnvironmentC_API.h",
+			"../../examples/SharedMemory/PhysicsServerCommandProcessor.cpp",
+			"../../examples/SharedMemory/PhysicsServerCommandProcessor.h",
+			"../../examples/SharedMemory/PhysicsClientSharedMemory.cpp",
+			"../../examples/SharedMemory/PhysicsClientSharedMemory.h",
+			"../../examples/SharedMemory/PhysicsClientC_API.cpp",
+			"../../examples/SharedMemory/PhysicsClientC_API.h",
+			"../../examples/SharedMemory/Win32SharedMemory.cpp",
+			"../../examples/SharedMemory/Win32SharedMemory.h",
+			"../../examples/SharedMemory/PosixSharedMemory.cpp",
+			"../../examples/SharedMemory/PosixSharedMemory.h",
+			"../../examples/Utils/b3ResourcePath.cpp",
+			"../../examples/Utils/b3ResourcePath.h",
+			"../../examples/ThirdPartyLibs/tinyxml/tinystr.cpp",
+			"../../examples/ThirdPartyLibs/tinyxml/tinyxml.cpp",
+			"../../examples/ThirdPartyLibs/tinyxml/tinyxmlerror.cpp",
+			"../../examples/ThirdPartyLibs/tinyxml/tinyxmlparser.cpp",
+			"../../examples/ThirdPartyLibs/Wavefront/tiny_obj_loader.cpp",
+			"../../examples/ThirdPartyLibs/Wavefront/tiny_obj_loader.h",
+			"../../examples/Importers/ImportColladaDemo/LoadMeshFromCollada.cpp",
+			"../../examples/Importers/ImportObjDemo/LoadMeshFromObj.cpp",
+			"../../examples/Importers/ImportObjDemo/Wavefront2GLInstanceGraphicsShape.cpp",
+			"../../examples/Importers/ImportMeshUtility/LoadTriangleMesh.cpp",
+			"../../examples/Importers/ImportURDFDemo/BulletUrdfImporter.cpp",
+			"../../examples/Importers/ImportURDFDemo/BulletUrdfImportCache.cpp",
+			"../../examples/Importers/ImportURDFDemo/MyMultiBodyCreator.cpp",
+			"../../examples/Importers/ImportURDFDemo/URDF2Bullet.cpp",
+			"../../examples/Importers/ImportURDFDemo/UrdfParser.cpp",
+			"../../examples/Importers/ImportURDFDemo/urdfStringSplit.cpp",
+		}
+
+	project ("Test_SharedMemoryRing")
+
+		language "C++"
+		kind "ConsoleApp"
+
+		includedirs {"../../src", "../../examples",
+		"../../examples/ThirdPartyLibs",
+		"../gtest-1.7.0/include"}
+		if os.is("Windows") then
+			defines {"_VARIADIC_MAX=10"}
+		end
+		links {
+			"BulletFileLoader",
+			"BulletWorldImporter",
+			"Bullet3Common",
+			"BulletDynamics", 
+			"BulletCollision", 
+			"LinearMath",
+			"gtest"
+		}
+		if os.is("Linux") then
+			links {"pthread"}
+		end
+
+		files {
+			"test_shared_memory_ring.cpp",
+			"../../examples/SharedMemory/PhysicsClient.cpp",
+			"../../examples/SharedMemory/PhysicsClient.h",
+			"../../examples/SharedMemory/PhysicsServer.cpp",
+			"../../examples/SharedMemory/PhysicsServer.h",
+			"../../examples/SharedMemory/PhysicsServerSharedMemory.cpp",
+			"../../examples/SharedMemory/PhysicsServerSharedMemory.h",
+			"../../examples/SharedMemory/PhysicsServerCommandProcessor.cpp",
+			"../../examples/SharedMemory/PhysicsServerCommandProcessor.h",
+			"../../examples/SharedMemory/PhysicsClientC_API.cpp",
+			"../../examples/SharedMemory/PhysicsClientC_API.h",
+			"../../examples/SharedMemory/PhysicsClientSharedMemory.cpp",
+			"../../examples/SharedMemory/PhysicsClientSharedMemory.h",
+			"../../examples/SharedMemory/PosixSharedMemory.cpp",
+			"../../examples/SharedMemory/PosixSharedMemory.h",
+			"../../examples/SharedMemory/Win32SharedMemory.cpp",
+			"../../examples/SharedMemory/Win32SharedMemory.h",
+			"../../examples/Utils/b3ResourcePath.cpp",
+			"../../examples/Utils/b3ResourcePath.h",
+			"../../examples/ThirdPartyLibs/tinyxml/tinystr.cpp",
+			"../../examples/ThirdPartyLibs/tinyxml/tinyxml.cpp",
+			"../../examples/ThirdPartyLibs/tinyxml/tinyxmlerror.cpp",
+			"../../examples/ThirdPartyLibs/tinyxml/tinyxmlparser.cpp",
+			"../../examples/ThirdPartyLibs/Wavefront/tiny_obj_loader.cpp",
+			"../../examples/ThirdPartyLibs/Wavefront/tiny_obj_loader.h",
+			"../../examples/Importers/ImportColladaDemo/LoadMeshFromCollada.cpp",
+			"../../examples/Importers/ImportObjDemo/LoadMeshFromObj.cpp",
+			"../../examples/Importers/ImportObjDemo/Wavefront2GLInstanceGraphicsShape.cpp",
+			"../../examples/Importers/ImportMeshUtility/LoadTriangleMesh.cpp",
+			"../../examples/Importers/ImportURDFDemo/BulletUrdfImporter.cpp",
+			"../../examples/Importers/ImportURDFDemo/BulletUrdfImportCache.cpp",
+			"../../examples/Importers/ImportURDFDemo/MyMultiBodyCreator.cpp",
+			"../../examples/Importers/ImportURDFDemo/URDF2Bullet.cpp",
+			"../../examples/Importers/ImportURDFDemo/UrdfParser.cpp",
+			"../../examples/Importers/ImportURDFDemo/urdfStringSplit.cpp",
+		}
+
+	project ("Test_UrdfImportCache")
+
+		language "C++"
+		kind "ConsoleApp"
+
+		includedirs {"../../src", "../../examples",
+		"../../examples/ThirdPartyLibs",
+		"../gtest-1.7.0/include"}
+		if os.is("Windows") then
+			defines {"_VARIADIC_MAX=10"}
+		end
+		links {
+			"BulletFileLoader",
+			"BulletWorldImporter",
+			"Bullet3Common",
+			"BulletDynamics", 
+			"BulletCollision", 
+			"LinearMath",
+			"gtest"
+		}
+		if os.is("Linux") then
+			links {"pthread"}
+		end
+
+		files {
+			"test_urdf_import_cache.cpp",
+			"../../examples/Utils/b3ResourcePath.cpp",
+			"../../examples/Utils/b3ResourcePath.h",
+			"../../examples/ThirdPartyLibs/tinyxml/tinystr.cpp",
+			"../../examples/ThirdPartyLibs/tinyxml/tinyxml.cpp",
+			"../../examples/ThirdPartyLibs/tinyxml/tinyxmlerror.cpp",
+			"../../examples/ThirdPartyLibs/tinyxml/tinyxmlparser.cpp",
+			"../../examples/ThirdPartyLibs/Wavefront/tiny_obj_loader.cpp",
+			"../../examples/ThirdPartyLibs/Wavefront/tiny_obj_loader.h",
+			"../../examples/Importers/ImportColladaDemo/LoadMeshFromCollada.cpp",
+			"../../examples/Importers/ImportObjDemo/LoadMeshFromObj.cpp",
+			"../../examples/Importers/ImportObjDemo/Wavefront2GLInstanceGraphicsShape.cpp",
+			"../../examples/Importers/ImportMeshUtility/LoadTriangleMesh.cpp",
+			"../../examples/Importers/ImportURDFDemo/BulletUrdfImporter.cpp",
+			"../../examples/Importers/ImportURDFDemo/BulletUrdfImportCache.cpp",
 			"../../examples/Importers/ImportURDFDemo/MyMultiBodyCreator.cpp",
 			"../../examples/Importers/ImportURDFDemo/URDF2Bullet.cpp",
 			"../../examples/Importers/ImportURDFDemo/UrdfParser.cpp",
 			"../../examples/Importers/ImportURDFDemo/urdfStringSplit.cpp",
 		}
-		
 
-	
+end
@@ -163,6 +163,42 @@ int main(int argc, char* argv[])
         {
             b3SubmitClientCommandAndWaitStatus(sm, b3InitStepSimulationCommand(sm));
         }
+
+        ///submit a simulation step and a state request as a single batch, the statuses arrive in order
+        {
+            b3SharedMemoryCommandHandle commands[2];
+            b3SharedMemoryStatusHandle statusHandle;
+            commands[0] = b3InitStepSimulationCommand(sm);
+            commands[1] = b3RequestActualStateCommandInit(sm,bodyIndex);
+            if (b3SubmitClientCommands(sm, commands, 2))
+            {
+                statusHandle = b3WaitForServerStatus(sm, 1000*1000);
+                b3Printf("batched step status = %d\n", statusHandle ? b3GetStatusType(statusHandle) : -1);
+                statusHandle = b3WaitForServerStatus(sm, 1000*1000);
+                b3Printf("batched state status = %d\n", statusHandle ? b3GetStatusType(statusHandle) : -1);
+            }
+        }
+
+        ///read the state of all bodies from the state region, without a request command
+        {
+            b3StateRegionHandle stateRegion = b3GetStateRegion(sm);
+            int sequence = b3GetStateSequence(stateRegion);
+            int numBodies = b3GetStateNumBodies(stateRegion, sequence);
+            struct b3BodyState bodyState;
+            for (i=0;i<numBodies;i++)
+            {
+                if (b3GetStateBody(stateRegion, sequence, i, &bodyState))
+                {
+                    b3Printf("body %d has %d position variables, base at %f,%f,%f\n", bodyState.m_bodyUniqueId,
+                        bodyState.m_numDegreeOfFreedomQ, bodyState.m_actualStateQ[0],
+                        bodyState.m_actualStateQ[1], bodyState.m_actualStateQ[2]);
+                }
+            }
+            if (!b3IsStateValid(stateRegion, sequence))
+            {
+                b3Printf("state %d was overwritten while reading it\n", sequence);
+            }
+        }
         
         {
             b3SharedMemoryStatusHandle state = b3SubmitClientCommandAndWaitStatus(sm, b3RequestActualStateCommandInit(sm,bodyIndex));
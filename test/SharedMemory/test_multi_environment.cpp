@@ -0,0 +1,144 @@
+// PhysicsMultiEnvironment tests: environments stepped in one parallel batch have to stay isolated,
+// each one has to end up in the same state as the same environment simulated on its own,
+// also when the batch runs on worker threads.
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "SharedMemory/PhysicsMultiEnvironmentC_API.h"
+#include "SharedMemory/SharedMemoryCommands.h"
+#include "LinearMath/btThreads.h"
+#include "../Utils/TestTaskScheduler.h"
+
+const int kNumEnvironments = 4;
+const int kNumSteps = 60;
+const int kNumObservations = 2 * MAX_DEGREE_OF_FREEDOM;
+
+// runs the chunks in reverse order, so an environment that depends on the stepping order of another one shows up,
+// also without worker threads
+class ReverseTaskScheduler : public btITaskScheduler {
+public:
+    ReverseTaskScheduler() : btITaskScheduler("Reverse") {}
+    virtual int getMaxNumThreads() const { return 1; }
+    virtual int getNumThreads() const { return 1; }
+    virtual void setNumThreads(int numThreads) { (void)numThreads; }
+    virtual void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body) {
+        for (int i0 = iEnd - grainSize; i0 > iBegin - grainSize; i0 -= grainSize) {
+            body.forLoop(i0 < iBegin ? iBegin : i0, i0 + grainSize);
+        }
+    }
+};
+
+// torques for each joint degree of freedom, different for each environment
+static double action(int environment, int step, int dof) {
+    return (environment + 1) * 0.5 * ((step + dof) % 7 - 3);
+}
+
+class MultiEnvironment {
+public:
+    explicit MultiEnvironment(int numEnvironments) {
+        m_client = b3ConnectPhysicsMultiEnvironment(numEnvironments);
+        b3SharedMemoryCommandHandle command = b3InitPhysicsParamCommand(m_client);
+        b3PhysicsParamSetGravity(command, 0, 0, -10);
+        b3SubmitClientCommandAndWaitStatus(m_client, command);
+        command = b3LoadUrdfCommandInit(m_client, "r2d2.urdf");
+        b3LoadUrdfCommandSetStartPosition(command, 0, 0, 1);
+        b3SharedMemoryStatusHandle status = b3SubmitClientCommandAndWaitStatus(m_client, command);
+        m_bodyUniqueId = b3GetStatusType(status) == CMD_URDF_LOADING_COMPLETED ? b3GetStatusBodyIndex(status) : -1;
+        m_numActions = 0;
+        if (m_bodyUniqueId >= 0) {
+            int numDofQ = 0;
+            int numDofU = 0;
+            status = b3SubmitClientCommandAndWaitStatus(m_client, b3RequestActualStateCommandInit(m_client, m_bodyUniqueId));
+            b3GetStatusActualState(status, 0, &numDofQ, &numDofU, 0, 0, 0, 0);
+            m_numActions = numDofU - 6;
+        }
+        m_control = b3JointControlCommandInit(m_client, CONTROL_MODE_TORQUE);
+        for (int i = 0; i < 6; i++) {
+            b3JointControlSetDesiredForceTorque(m_control, i, 0);
+        }
+    }
+
+    virtual ~MultiEnvironment() { b3DisconnectSharedMemory(m_client); }
+
+    // steps environment i with the actions of firstEnvironment+i
+    bool step(int firstEnvironment, int stepIndex, double* observations) {
+        int numEnvironments = b3GetNumEnvironments(m_client);
+        std::vector<double> actions(numEnvironments * m_numActions);
+        for (int i = 0; i < numEnvironments; i++) {
+            for (int j = 0; j < m_numActions; j++) {
+                actions[i * m_numActions + j] = action(firstEnvironment + i, stepIndex, j);
+            }
+        }
+        return b3StepEnvironments(m_client, m_control, actions.empty() ? 0 : &actions[0], m_numActions, m_bodyUniqueId,
+                                  observations, kNumObservations) != 0;
+    }
+
+    b3PhysicsClientHandle m_client;
+    b3SharedMemoryCommandHandle m_control;
+    int m_bodyUniqueId;
+    int m_numActions;
+};
+
+// steps all environments in one batch with the scheduler, and each one again on its own
+static void expectSameAsSequentialRun(btITaskScheduler* scheduler) {
+    btSetTaskScheduler(scheduler);
+    MultiEnvironment batch(kNumEnvironments);
+    ASSERT_GE(batch.m_bodyUniqueId, 0);
+    ASSERT_GT(batch.m_numActions, 0);
+    std::vector<double> observations(kNumEnvironments * kNumObservations);
+    for (int step = 0; step < kNumSteps; step++) {
+        ASSERT_TRUE(batch.step(0, step, &observations[0]));
+    }
+    btSetTaskScheduler(0);
+
+    for (int i = 1; i < kNumEnvironments; i++) {
+        EXPECT_NE(0, memcmp(&observations[0], &observations[i * kNumObservations], kNumObservations * sizeof(double)))
+            << "environment " << i << " has the same observation as environment 0";
+    }
+
+    // each environment again, one after the other with the sequential scheduler
+    for (int i = 0; i < kNumEnvironments; i++) {
+        MultiEnvironment single(1);
+        ASSERT_EQ(batch.m_bodyUniqueId, single.m_bodyUniqueId);
+        std::vector<double> observation(kNumObservations);
+        for (int step = 0; step < kNumSteps; step++) {
+            ASSERT_TRUE(single.step(i, step, &observation[0]));
+        }
+        for (int j = 0; j < kNumObservations; j++) {
+            EXPECT_EQ(observation[j], observations[i * kNumObservations + j]) << "environment " << i << " value " << j;
+        }
+    }
+}
+
+TEST(PhysicsMultiEnvironment, MatchesSequentialRun) {
+    ReverseTaskScheduler scheduler;
+    expectSameAsSequentialRun(&scheduler);
+}
+
+static void getThreadIndex(unsigned int* index) { *index = btGetCurrentThreadIndex(); }
+
+TEST(PhysicsMultiEnvironment, MatchesSequentialRunOnThreads) {
+    // starts 3 worker threads for each step
+    TestTaskScheduler scheduler(4);
+    expectSameAsSequentialRun(&scheduler);
+
+    // once there were more than BT_MAX_THREAD_COUNT threads, new ones share the last index,
+    // only this thread has index 0 and is profiled
+    EXPECT_EQ(0u, btGetCurrentThreadIndex());
+    std::vector<unsigned int> indices(2 * BT_MAX_THREAD_COUNT);
+    for (size_t i = 0; i < indices.size(); i++) {
+        std::thread thread(getThreadIndex, &indices[i]);
+        thread.join();
+        EXPECT_NE(0u, indices[i]) << "thread " << i;
+    }
+    EXPECT_EQ(unsigned(BT_MAX_THREAD_COUNT - 1), indices.back());
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,293 @@
+// Command ring buffer of the shared memory block: several clients in one process submit commands to a server thread
+// at the same time, in batches, many times around the ring. Every client has to get the status of each of its own
+// commands, in order, also when the ring is full and a client has to wait for the slots of another one.
+// A client that reads the state region while the server writes it must never accept a torn copy of the state.
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#include <gtest/gtest.h>
+
+#include "CommonInterfaces/CommonGUIHelperInterface.h"
+#include "SharedMemory/PhysicsClientC_API.h"
+#include "SharedMemory/PhysicsClientSharedMemory.h"
+#include "SharedMemory/PhysicsServerSharedMemory.h"
+#include "SharedMemory/SharedMemoryBlock.h"
+#include "SharedMemory/SharedMemoryStateRegion.h"
+#include "SharedMemory/SharedMemorySync.h"
+
+const int kNumProducers = 4;
+const int kNumCommandsPerProducer = 400;
+// the batches of all producers together don't fit in the ring, so producers wait for the slots of the others
+const int kMaxBatchSize = 12;
+const int kTimeOutInMicroSeconds = 10 * 1000 * 1000;
+const int kNumBoxes = 100;
+const int kNumSteps = 200;
+
+// a key per test and process, so tests running at the same time don't share a block
+static int sharedMemoryKey(int test) { return SHARED_MEMORY_KEY + 16 * (getpid() & 0xfff) + test; }
+
+// processes the commands of all clients until it is destroyed
+class ServerThread {
+public:
+    explicit ServerThread(int key) : m_stop(false) {
+        m_server.setSharedMemoryKey(key);
+        m_connected = m_server.connectSharedMemory(&m_guiHelper);
+        if (m_connected) {
+            m_thread = std::thread(&ServerThread::run, this);
+        }
+    }
+
+    ~ServerThread() {
+        m_stop = true;
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+        m_server.disconnectSharedMemory(true);
+    }
+
+    bool isConnected() const { return m_connected; }
+
+private:
+    void run() {
+        while (!m_stop) {
+            m_server.waitForClientCommands(1000);
+            m_server.processClientCommands();
+        }
+    }
+
+    DummyGUIHelper m_guiHelper;
+    PhysicsServerSharedMemory m_server;
+    std::atomic<bool> m_stop;
+    bool m_connected;
+    std::thread m_thread;
+};
+
+struct ProducerResult {
+    ProducerResult() : m_connected(false), m_numSubmitted(0), m_numStatuses(0), m_firstMismatch(-1) {}
+
+    bool m_connected;
+    int m_numSubmitted;
+    int m_numStatuses;
+    // the sequence number of the first status that isn't the next one of this producer
+    int m_firstMismatch;
+};
+
+// submits batches of 1 to kMaxBatchSize commands and waits for their statuses, the sequence numbers of a producer
+// are producer * kNumCommandsPerProducer + 0, 1, 2, ...
+static void produce(int key, int producer, const std::atomic<bool>* start, ProducerResult* result) {
+    PhysicsClientSharedMemory client;
+    client.setSharedMemoryKey(key);
+    result->m_connected = client.connect();
+    if (!result->m_connected) {
+        return;
+    }
+    while (!*start) {
+        b3SharedMemoryYield();
+    }
+    std::vector<SharedMemoryCommand> commands(kMaxBatchSize);
+    std::vector<const SharedMemoryCommand*> batch(kMaxBatchSize);
+    int next = 0;
+    while (next < kNumCommandsPerProducer && result->m_firstMismatch < 0) {
+        int batchSize = 1 + (next + producer) % kMaxBatchSize;
+        if (batchSize > kNumCommandsPerProducer - next) {
+            batchSize = kNumCommandsPerProducer - next;
+        }
+        for (int i = 0; i < batchSize; i++) {
+            commands[i].m_type = CMD_SEND_PHYSICS_SIMULATION_PARAMETERS;
+            commands[i].m_updateFlags = 0;
+            commands[i].m_sequenceNumber = producer * kNumCommandsPerProducer + next + i;
+            batch[i] = &commands[i];
+        }
+        if (!client.submitClientCommands(&batch[0], batchSize)) {
+            break;
+        }
+        result->m_numSubmitted += batchSize;
+        for (int i = 0; i < batchSize; i++) {
+            const SharedMemoryStatus* status = client.waitForServerStatus(kTimeOutInMicroSeconds);
+            if (!status) {
+                break;
+            }
+            result->m_numStatuses++;
+            if (result->m_firstMismatch < 0 && (status->m_type != CMD_CLIENT_COMMAND_COMPLETED ||
+                                                 status->m_sequenceNumber != commands[i].m_sequenceNumber)) {
+                result->m_firstMismatch = status->m_sequenceNumber;
+            }
+        }
+        if (client.getNumOutstandingCommands()) {
+            break;
+        }
+        next += batchSize;
+    }
+    client.disconnectSharedMemory();
+}
+
+TEST(SharedMemoryRing, ProducersGetTheirOwnStatusesInOrder) {
+    const int key = sharedMemoryKey(0);
+    ServerThread server(key);
+    ASSERT_TRUE(server.isConnected());
+
+    std::vector<ProducerResult> results(kNumProducers);
+    std::vector<std::thread> producers;
+    std::atomic<bool> start(false);
+    for (int i = 0; i < kNumProducers; i++) {
+        producers.push_back(std::thread(produce, key, i, &start, &results[i]));
+    }
+    start = true;
+    for (int i = 0; i < kNumProducers; i++) {
+        producers[i].join();
+    }
+
+    // the tickets of all producers went around the ring many times
+    ASSERT_GT(kNumProducers * kNumCommandsPerProducer, 20 * SHARED_MEMORY_MAX_COMMANDS);
+    for (int i = 0; i < kNumProducers; i++) {
+        SCOPED_TRACE(i);
+        ASSERT_TRUE(results[i].m_connected);
+        EXPECT_EQ(-1, results[i].m_firstMismatch);
+        EXPECT_EQ(kNumCommandsPerProducer, results[i].m_numSubmitted);
+        EXPECT_EQ(kNumCommandsPerProducer, results[i].m_numStatuses);
+    }
+
+    // all slots were released, a full batch of a new client fits in the ring
+    PhysicsClientSharedMemory client;
+    client.setSharedMemoryKey(key);
+    ASSERT_TRUE(client.connect());
+    std::vector<SharedMemoryCommand> commands(SHARED_MEMORY_MAX_COMMANDS);
+    std::vector<const SharedMemoryCommand*> batch(SHARED_MEMORY_MAX_COMMANDS);
+    for (int i = 0; i < SHARED_MEMORY_MAX_COMMANDS; i++) {
+        commands[i].m_type = CMD_SEND_PHYSICS_SIMULATION_PARAMETERS;
+        commands[i].m_updateFlags = 0;
+        commands[i].m_sequenceNumber = i;
+        batch[i] = &commands[i];
+    }
+    ASSERT_TRUE(client.submitClientCommands(&batch[0], SHARED_MEMORY_MAX_COMMANDS));
+    for (int i = 0; i < SHARED_MEMORY_MAX_COMMANDS; i++) {
+        const SharedMemoryStatus* status = client.waitForServerStatus(kTimeOutInMicroSeconds);
+        ASSERT_TRUE(status != 0);
+        EXPECT_EQ(i, status->m_sequenceNumber);
+    }
+    client.disconnectSharedMemory();
+}
+
+// a copy of the state with sequence number s, empty if there is none
+typedef std::vector<std::vector<char> > StateCopies;
+
+// copies the state buffer of this sequence number, and tells whether the server overwrote it meanwhile.
+// A copy in several pieces yields in between, so the server also writes during the copy on a single core.
+static bool copyState(SharedMemoryStateRegion* region, int sequence, int numPieces, std::vector<char>& copy) {
+    const char* buffer = GetSharedMemoryStateBuffer(region, sequence);
+    int sizeInBytes = ((const SharedMemoryStateHeader*)buffer)->m_sizeInBytes;
+    if (sizeInBytes < int(sizeof(SharedMemoryStateHeader)) || sizeInBytes > region->m_bufferCapacity) {
+        sizeInBytes = sizeof(SharedMemoryStateHeader);
+    }
+    copy.resize(sizeInBytes);
+    for (int i = 0; i < numPieces; i++) {
+        int begin = sizeInBytes * i / numPieces;
+        int end = sizeInBytes * (i + 1) / numPieces;
+        memcpy(&copy[begin], buffer + begin, end - begin);
+        if (numPieces > 1) {
+            b3SharedMemoryYield();
+        }
+    }
+    return IsSharedMemoryStateValid(region, sequence);
+}
+
+// reads the latest state over and over, in 1, 4, 16 or 64 pieces, so some copies take several steps of the server.
+// The first accepted copy of each sequence number is kept, and every later accepted copy of it has to be the same
+static void readStates(int key, const std::atomic<bool>* done, std::atomic<int>* numReads, StateCopies* accepted,
+                       int* numMismatches) {
+    PhysicsClientSharedMemory client;
+    client.setSharedMemoryKey(key);
+    if (!client.connect()) {
+        return;
+    }
+    std::vector<char> copy;
+    while (!*done) {
+        SharedMemoryStateRegion* region = (SharedMemoryStateRegion*)client.getStateRegion();
+        int sequence = region ? b3SharedMemoryLoad(&region->m_sequence) : 0;
+        if (sequence <= 0 || sequence >= int(accepted->size())) {
+            b3SharedMemoryYield();
+            continue;
+        }
+        int numPieces = 1 << (2 * (*numReads % 4));
+        (*numReads)++;
+        if (copyState(region, sequence, numPieces, copy)) {
+            std::vector<char>& first = (*accepted)[sequence];
+            if (first.empty()) {
+                first = copy;
+            } else if (first != copy) {
+                (*numMismatches)++;
+            }
+        }
+    }
+    client.disconnectSharedMemory();
+}
+
+TEST(SharedMemoryRing, ReaderNeverAcceptsATornState) {
+    const int key = sharedMemoryKey(1);
+    ServerThread server(key);
+    ASSERT_TRUE(server.isConnected());
+    b3PhysicsClientHandle client = b3ConnectSharedMemory(key);
+    ASSERT_TRUE(b3CanSubmitCommand(client));
+
+    // falling boxes, so each step changes the whole state
+    b3SharedMemoryCommandHandle command = b3InitPhysicsParamCommand(client);
+    b3PhysicsParamSetGravity(command, 0, 0, -10);
+    ASSERT_TRUE(b3SubmitClientCommandAndWaitStatus(client, command) != 0);
+    for (int i = 0; i < kNumBoxes; i++) {
+        command = b3CreateBoxShapeCommandInit(client);
+        b3CreateBoxCommandSetStartPosition(command, 3 * i, 0, i);
+        b3CreateBoxCommandSetMass(command, 1);
+        ASSERT_TRUE(b3SubmitClientCommandAndWaitStatus(client, command) != 0);
+    }
+
+    // the server doesn't write while there is no command, so the state after each step is known
+    StateCopies expected(kNumBoxes + 2 * kNumSteps);
+    StateCopies accepted(expected.size());
+    std::atomic<bool> done(false);
+    std::atomic<int> numReads(0);
+    int numMismatches = 0;
+    std::thread reader(readStates, key, &done, &numReads, &accepted, &numMismatches);
+    while (!numReads) {
+        b3SharedMemoryYield();
+    }
+    for (int i = 0; i < kNumSteps; i++) {
+        ASSERT_TRUE(b3SubmitClientCommandAndWaitStatus(client, b3InitStepSimulationCommand(client)) != 0);
+        SharedMemoryStateRegion* region = (SharedMemoryStateRegion*)b3GetStateRegion(client);
+        ASSERT_TRUE(region != 0);
+        int sequence = b3GetStateSequence((b3StateRegionHandle)region);
+        ASSERT_GT(sequence, 0);
+        ASSERT_LT(sequence, int(expected.size()));
+        ASSERT_TRUE(copyState(region, sequence, 1, expected[sequence]));
+        ASSERT_EQ(kNumBoxes, b3GetStateNumBodies((b3StateRegionHandle)region, sequence));
+        // let the reader run between the steps on a single core
+        b3SharedMemoryYield();
+    }
+    done = true;
+    reader.join();
+    b3DisconnectSharedMemory(client);
+
+    EXPECT_EQ(0, numMismatches);
+    int numAccepted = 0;
+    for (size_t sequence = 0; sequence < accepted.size(); sequence++) {
+        if (!accepted[sequence].empty() && !expected[sequence].empty()) {
+            numAccepted++;
+            EXPECT_TRUE(accepted[sequence] == expected[sequence]) << "state " << sequence;
+        }
+    }
+    EXPECT_GT(numAccepted, 0);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,144 @@
+// BulletURDFImportCache: importers that share a cache have to get the same collision shape for the same mesh file,
+// converted once, and a mesh file loaded with another scale has to get its own shape.
+// The URDF files are loaded from the data folder, the working directory of the test.
+
+#include <stdio.h>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "btBulletDynamicsCommon.h"
+#include "CommonInterfaces/CommonGUIHelperInterface.h"
+#include "Importers/ImportURDFDemo/BulletUrdfImportCache.h"
+#include "Importers/ImportURDFDemo/BulletUrdfImporter.h"
+#include "Importers/ImportURDFDemo/UrdfParser.h"
+
+// the first collision shape of the link with this name, 0 if there is none. The compound is returned as well,
+// the caller deletes it, the shape belongs to the cache
+static btCollisionShape* findCollisionShape(BulletURDFImporter& importer, int linkIndex, const char* linkName,
+                                            btCompoundShape** compound) {
+    if (importer.getLinkName(linkIndex) == linkName) {
+        btTransform identity = btTransform::getIdentity();
+        *compound = importer.convertLinkCollisionShapes(linkIndex, importer.getPathPrefix(), identity);
+        return (*compound)->getNumChildShapes() ? (*compound)->getChildShape(0) : 0;
+    }
+    btAlignedObjectArray<int> childIndices;
+    importer.getLinkChildIndices(linkIndex, childIndices);
+    for (int i = 0; i < childIndices.size(); i++) {
+        btCollisionShape* shape = findCollisionShape(importer, childIndices[i], linkName, compound);
+        if (shape) {
+            return shape;
+        }
+    }
+    return 0;
+}
+
+class LinkShape {
+public:
+    LinkShape(BulletURDFImporter& importer, const char* linkName) : m_compound(0) {
+        m_shape = findCollisionShape(importer, importer.getRootLinkIndex(), linkName, &m_compound);
+    }
+
+    ~LinkShape() { delete m_compound; }
+
+    btCompoundShape* m_compound;
+    btCollisionShape* m_shape;
+};
+
+TEST(UrdfImportCache, MeshShapesAreKeyedByPathAndScale) {
+    BulletURDFImportCache cache;
+    btBoxShape* box = new btBoxShape(btVector3(1, 1, 1));
+    cache.insertMeshCollisionShape("meshes/a.stl", btVector3(1, 1, 1), box);
+    EXPECT_EQ(box, cache.findMeshCollisionShape("meshes/a.stl", btVector3(1, 1, 1)));
+    EXPECT_TRUE(cache.findMeshCollisionShape("meshes/a.stl", btVector3(2, 2, 2)) == 0);
+    EXPECT_TRUE(cache.findMeshCollisionShape("meshes/a.stl", btVector3(1, 1, 1.5)) == 0);
+    EXPECT_TRUE(cache.findMeshCollisionShape("meshes/b.stl", btVector3(1, 1, 1)) == 0);
+
+    btBoxShape* scaledBox = new btBoxShape(btVector3(2, 2, 2));
+    cache.insertMeshCollisionShape("meshes/a.stl", btVector3(2, 2, 2), scaledBox);
+    EXPECT_EQ(scaledBox, cache.findMeshCollisionShape("meshes/a.stl", btVector3(2, 2, 2)));
+    EXPECT_EQ(box, cache.findMeshCollisionShape("meshes/a.stl", btVector3(1, 1, 1)));
+    EXPECT_EQ(2, cache.getNumMeshCollisionShapes());
+
+    // parsed files are keyed by forceFixedBase too
+    UrdfParser* parser = new UrdfParser;
+    cache.insertParsedUrdf("a.urdf", false, parser);
+    EXPECT_EQ(parser, cache.findParsedUrdf("a.urdf", false));
+    EXPECT_TRUE(cache.findParsedUrdf("a.urdf", true) == 0);
+    EXPECT_EQ(1, cache.getNumParsedUrdfs());
+
+    cache.clear();
+    EXPECT_EQ(0, cache.getNumMeshCollisionShapes());
+    EXPECT_EQ(0, cache.getNumParsedUrdfs());
+}
+
+TEST(UrdfImportCache, ImportersShareMeshShapes) {
+    DummyGUIHelper guiHelper;
+    BulletURDFImportCache cache;
+    BulletURDFImporter first(&guiHelper, &cache);
+    ASSERT_TRUE(first.loadURDF("kuka_lwr/kuka.urdf"));
+    EXPECT_EQ(1, cache.getNumParsedUrdfs());
+    const int numMeshShapes = cache.getNumMeshCollisionShapes();
+    EXPECT_GT(numMeshShapes, 0);
+
+    // arm 1 and arm 3 use the same collision mesh
+    LinkShape arm1(first, "kuka_arm_1_link");
+    LinkShape arm3(first, "kuka_arm_3_link");
+    ASSERT_TRUE(arm1.m_shape != 0);
+    EXPECT_EQ(CONVEX_HULL_SHAPE_PROXYTYPE, arm1.m_shape->getShapeType());
+    EXPECT_EQ(arm1.m_shape, arm3.m_shape);
+
+    // a cache hit returns the same shape, without parsing or converting anything again
+    BulletURDFImporter second(&guiHelper, &cache);
+    ASSERT_TRUE(second.loadURDF("kuka_lwr/kuka.urdf"));
+    LinkShape secondArm1(second, "kuka_arm_1_link");
+    EXPECT_EQ(arm1.m_shape, secondArm1.m_shape);
+    EXPECT_EQ(1, cache.getNumParsedUrdfs());
+    EXPECT_EQ(numMeshShapes, cache.getNumMeshCollisionShapes());
+
+    // the same mesh with another scale is converted again, the shape of the kuka doesn't change
+    const char* scaledFileName = "kuka_lwr/scaled_arm.urdf";
+    FILE* file = fopen(scaledFileName, "w");
+    ASSERT_TRUE(file != 0);
+    fputs(
+        "<?xml version=\"1.0\"?>\n"
+        "<robot name=\"scaled_arm\">\n"
+        "  <link name=\"scaled_arm_link\">\n"
+        "    <inertial>\n"
+        "      <mass value=\"2.0\"/>\n"
+        "      <inertia ixx=\"0.01\" ixy=\"0\" ixz=\"0\" iyy=\"0.01\" iyz=\"0\" izz=\"0.01\"/>\n"
+        "    </inertial>\n"
+        "    <collision>\n"
+        "      <geometry>\n"
+        "        <mesh filename=\"meshes_arm/convex/arm_segment_a_convex.stl\" scale=\"2 2 2\"/>\n"
+        "      </geometry>\n"
+        "    </collision>\n"
+        "  </link>\n"
+        "</robot>\n",
+        file);
+    fclose(file);
+    BulletURDFImporter scaled(&guiHelper, &cache);
+    const bool loaded = scaled.loadURDF(scaledFileName);
+    remove(scaledFileName);
+    ASSERT_TRUE(loaded);
+    LinkShape scaledArm(scaled, "scaled_arm_link");
+    ASSERT_TRUE(scaledArm.m_shape != 0);
+    EXPECT_NE(arm1.m_shape, scaledArm.m_shape);
+    EXPECT_EQ(numMeshShapes + 1, cache.getNumMeshCollisionShapes());
+    ASSERT_EQ(CONVEX_HULL_SHAPE_PROXYTYPE, scaledArm.m_shape->getShapeType());
+    const btConvexHullShape* hull = (const btConvexHullShape*)arm1.m_shape;
+    const btConvexHullShape* scaledHull = (const btConvexHullShape*)scaledArm.m_shape;
+    ASSERT_EQ(hull->getNumPoints(), scaledHull->getNumPoints());
+    for (int i = 0; i < hull->getNumPoints(); i++) {
+        btVector3 point = 2 * hull->getUnscaledPoints()[i];
+        const btVector3& scaledPoint = scaledHull->getUnscaledPoints()[i];
+        EXPECT_NEAR(point.x(), scaledPoint.x(), 1e-5) << "point " << i;
+        EXPECT_NEAR(point.y(), scaledPoint.y(), 1e-5) << "point " << i;
+        EXPECT_NEAR(point.z(), scaledPoint.z(), 1e-5) << "point " << i;
+    }
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
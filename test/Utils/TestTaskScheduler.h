@@ -0,0 +1,57 @@
+#ifndef TEST_TASK_SCHEDULER_H
+#define TEST_TASK_SCHEDULER_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "LinearMath/btThreads.h"
+
+// TestTaskScheduler runs btParallelFor on real threads: the calling thread and numThreads-1 threads started
+// for each call take grainSize chunks of the range until it is done. It is meant for the unit tests, that
+// compare the results of the multithreaded code paths with the sequential ones.
+class TestTaskScheduler : public btITaskScheduler {
+    int m_numThreads;
+
+    struct Job {
+        std::atomic<int> m_next;
+        int m_end;
+        int m_grainSize;
+        const btIParallelForBody* m_body;
+
+        void run() {
+            for (;;) {
+                int i0 = m_next.fetch_add(m_grainSize);
+                if (i0 >= m_end) {
+                    break;
+                }
+                m_body->forLoop(i0, i0 + m_grainSize < m_end ? i0 + m_grainSize : m_end);
+            }
+        }
+    };
+
+public:
+    explicit TestTaskScheduler(int numThreads) : btITaskScheduler("TestThreads"), m_numThreads(numThreads) {}
+
+    virtual int getMaxNumThreads() const { return BT_MAX_THREAD_COUNT; }
+    virtual int getNumThreads() const { return m_numThreads; }
+    virtual void setNumThreads(int numThreads) { m_numThreads = numThreads; }
+
+    virtual void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body) {
+        Job job;
+        job.m_next = iBegin;
+        job.m_end = iEnd;
+        job.m_grainSize = grainSize;
+        job.m_body = &body;
+        std::vector<std::thread> threads;
+        for (int i = 1; i < m_numThreads; i++) {
+            threads.push_back(std::thread(&Job::run, &job));
+        }
+        job.run();
+        for (size_t i = 0; i < threads.size(); i++) {
+            threads[i].join();
+        }
+    }
+};
+
+#endif  // TEST_TASK_SCHEDULER_H